@@ -4,6 +4,7 @@
 #include "common/DataHelper.h"
 #include "common/DirectionMaps.h"
 #include "common/Exception.hpp"
+#include "common/Profiler.h"
 #include "common/MathFuncs.h"
 #include "common/UuidUtility.h"
 
@@ -12,6 +13,7 @@
 
 #include "logic/annotation/Annotation.h"
 #include "logic/annotation/LandmarkGroup.h"
+#include "logic/app/ProjectPreloader.h"
 #include "logic/camera/MathUtility.h"
 #include "logic/serialization/ProjectSerialization.h"
 #include "logic/states/FsmList.hpp"
@@ -69,6 +71,8 @@ EntropyApp::EntropyApp()
   : m_imageLoadCancelled(false)
   , m_imagesReady(false)
   , m_imageLoadFailed(false)
+  , m_loadingStatusChanged(false)
+  , m_seedSegTitleStatus()
   ,
 
   // GLFW creates the OpenGL contex
@@ -81,6 +85,8 @@ EntropyApp::EntropyApp()
   , // Requires OpenGL context
   m_callbackHandler(m_data, m_glfw, m_rendering)
   , m_imgui(m_glfw.window(), m_data, m_callbackHandler) // Requires OpenGL context
+  , m_componentMapScheduler(m_data.taskScheduler(), [this]() { m_glfw.postEmptyEvent(); })
+  , m_imageSaveScheduler(m_data.taskScheduler(), [this]() { m_glfw.postEmptyEvent(); })
 //      m_IPCHandler()
 {
   spdlog::debug("Begin constructing application");
@@ -96,7 +102,13 @@ EntropyApp::EntropyApp()
 
 EntropyApp::~EntropyApp()
 {
-  m_futureLoadProject.wait();
+  if (m_futureLoadProject.valid())
+  {
+    m_futureLoadProject.wait();
+  }
+
+  // Finish the running tasks before the UI and data that they update are destroyed
+  m_data.taskScheduler().shutdown();
 
   //    if ( m_IPCHandler.IsAttached() )
   //    {
@@ -138,8 +150,9 @@ void EntropyApp::run()
     m_imagesReady, m_imageLoadFailed, checkIfAppShouldQuit, [this]() { onImagesReady(); }
   );
 
-  // Cancel image loading, in case it's still going on
+  // Cancel image loading and component map computation, in case they're still going on
   m_imageLoadCancelled = true;
+  m_componentMapScheduler.cancel();
 
   spdlog::debug("Done application run loop");
 }
@@ -169,6 +182,16 @@ void EntropyApp::onImagesReady()
 
   spdlog::debug("Textures and uniforms ready; rendering enabled");
 
+  // Compute the noise estimates and distance maps of the image components in the background,
+  // starting with the reference image:
+  for (const auto& imageUid : m_data.imageUidsOrdered())
+  {
+    if (const Image* image = m_data.image(imageUid))
+    {
+      m_componentMapScheduler.schedule(imageUid, *image);
+    }
+  }
+
   // Stop animation rendering (which plays during loading) and render only on events:
   m_glfw.setEventProcessingMode(EventProcessingMode::Wait);
   m_glfw.setWindowTitleStatus(m_data.getAllImageDisplayNames());
@@ -363,6 +386,131 @@ void EntropyApp::logPreamble()
   spdlog::debug("Build timestamp: {}", ENTROPY_BUILD_TIMESTAMP);
 }
 
+void EntropyApp::showLoadingStatus()
+{
+  // The window title can only be set from the main thread
+  if (m_loadingStatusChanged.exchange(false))
+  {
+    m_glfw.setWindowTitleStatus("Loading project: " + m_data.state().loadingStatus());
+  }
+}
+
+void EntropyApp::addComputedComponentMaps()
+{
+  bool addedDistanceMap = false;
+
+  for (auto& maps : m_componentMapScheduler.takeCompletedMaps())
+  {
+    if (maps.m_noiseEstimate)
+    {
+      m_data.addNoiseEstimate(
+        maps.m_imageUid,
+        maps.m_component,
+        std::move(*maps.m_noiseEstimate),
+        maps.m_noiseEstimateRadius
+      );
+    }
+
+    if (maps.m_distanceMap)
+    {
+      addedDistanceMap |= m_data.addDistanceMap(
+        maps.m_imageUid,
+        maps.m_component,
+        std::move(*maps.m_distanceMap),
+        maps.m_distanceMapBoundaryValue
+      );
+    }
+  }
+
+  if (addedDistanceMap)
+  {
+    m_rendering.updateDistanceMapTextures();
+  }
+}
+
+void EntropyApp::addCompletedSaves()
+{
+  for (const auto& result : m_imageSaveScheduler.takeCompletedSaves())
+  {
+    if (!result.m_details.success)
+    {
+      spdlog::error("Error saving segmentation image to file {}", result.m_fileName);
+      continue;
+    }
+
+    spdlog::info("Saved segmentation image to file {}", result.m_fileName);
+
+    if (!result.m_details.imageUid)
+    {
+      continue;
+    }
+
+    // The segmentation may have been removed while it was saved
+    if (Image* seg = m_data.seg(*result.m_details.imageUid))
+    {
+      seg->header().setFileName(result.m_fileName);
+    }
+  }
+
+  // Segmentations that are still being saved are marked in the UI
+  auto& savingSegUids = m_data.guiData().m_savingSegUids;
+  savingSegUids.clear();
+
+  for (const auto& details : m_imageSaveScheduler.pendingSaves())
+  {
+    if (details.imageUid)
+    {
+      savingSegUids.insert(*details.imageUid);
+    }
+  }
+}
+
+void EntropyApp::addCompletedSeedSegmentation()
+{
+  m_callbackHandler.addCompletedSeedSegmentation();
+
+  std::string status;
+
+  if (const auto task = m_data.state().seedSegmentationTask())
+  {
+    status = m_data.state().seedSegmentationStatus() + " ("
+             + std::to_string(static_cast<int>(100.0f * task->progress())) + "%)";
+  }
+
+  // The window title can only be set from the main thread
+  if (status != m_seedSegTitleStatus)
+  {
+    m_seedSegTitleStatus = status;
+    m_glfw.setWindowTitleStatus(status);
+  }
+}
+
+template<class T, class OpenFn>
+std::optional<T> EntropyApp::takePreloaded(
+  std::optional<std::optional<T> > (ProjectPreloader::*take)(const fs::path&),
+  const fs::path& fileName,
+  OpenFn open
+)
+{
+  if (m_preloader)
+  {
+    try
+    {
+      if (auto preloaded = ((*m_preloader).*take)(fileName))
+      {
+        return std::move(*preloaded);
+      }
+    }
+    catch (const std::exception& e)
+    {
+      spdlog::error("Exception loading file {}: {}", fileName, e.what());
+      return std::nullopt;
+    }
+  }
+
+  return open(fileName);
+}
+
 std::pair<std::optional<uuids::uuid>, bool> EntropyApp::loadImage(
   const fs::path& fileName, bool ignoreIfAlreadyLoaded
 )
@@ -384,9 +532,15 @@ std::pair<std::optional<uuids::uuid>, bool> EntropyApp::loadImage(
     }
   }
 
-  Image image(
-    fileName, Image::ImageRepresentation::Image, Image::MultiComponentBufferType::SeparateImages
-  );
+  // Take the image from the project preloader if it was decoded there; otherwise decode it now
+  std::optional<Image> decoded = m_preloader ? m_preloader->takeImage(fileName) : std::nullopt;
+
+  if (!decoded)
+  {
+    decoded = ProjectPreloader::decodeImage(fileName, m_data.settings().retainSortedImageBuffers());
+  }
+
+  Image& image = *decoded;
 
   spdlog::info("Read image from file {}", fileName);
 
@@ -398,7 +552,8 @@ std::pair<std::optional<uuids::uuid>, bool> EntropyApp::loadImage(
   spdlog::info("Transformation:\n{}", image.transformations());
   spdlog::info("Settings:\n{}", image.settings());
 
-  return {m_data.addImage(std::move(image)), true};
+  const uuids::uuid imageUid = m_data.addImage(std::move(image));
+  return {imageUid, true};
 }
 
 std::pair<std::optional<uuids::uuid>, bool> EntropyApp::loadSegmentation(
@@ -430,11 +585,11 @@ std::pair<std::optional<uuids::uuid>, bool> EntropyApp::loadSegmentation(
 
   // Creating an image as a segmentation will convert the pixel components to the most
   // suitable unsigned integer type
-  Image seg(
-    fileName,
-    Image::ImageRepresentation::Segmentation,
-    Image::MultiComponentBufferType::SeparateImages
-  );
+  std::optional<Image> preloadedSeg = m_preloader ? m_preloader->takeSegmentation(fileName)
+                                                  : std::nullopt;
+
+  Image seg = preloadedSeg ? std::move(*preloadedSeg)
+                           : ProjectPreloader::decodeSegmentation(fileName);
 
   // Set the default opacity:
   seg.settings().setOpacity(0.5);
@@ -592,9 +747,11 @@ std::pair<std::optional<uuids::uuid>, bool> EntropyApp::loadDeformationField(con
   }
 
   // Components of a deformation field image are loaded as interleaved images
-  Image def(
-    fileName, Image::ImageRepresentation::Image, Image::MultiComponentBufferType::InterleavedImage
-  );
+  std::optional<Image> preloadedDef = m_preloader ? m_preloader->takeDeformationField(fileName)
+                                                  : std::nullopt;
+
+  Image def = preloadedDef ? std::move(*preloadedDef)
+                           : ProjectPreloader::decodeDeformationField(fileName);
 
   if (def.header().numComponentsPerPixel() < 3)
   {
@@ -824,10 +981,24 @@ bool EntropyApp::loadSerializedImage(const serialize::Image& serializedImage, bo
   // Set annotations from file:
   if (serializedImage.m_annotationsFileName)
   {
-    std::vector<Annotation> annots;
+    std::optional<ProjectPreloader::Annotations> annotsOpt = takePreloaded(
+      &ProjectPreloader::takeAnnotations,
+      *serializedImage.m_annotationsFileName,
+      [](const fs::path& fileName) -> std::optional<ProjectPreloader::Annotations>
+      {
+        std::vector<Annotation> annots;
+        if (serialize::openAnnotationsFromJsonFile(annots, fileName))
+        {
+          return annots;
+        }
+        return std::nullopt;
+      }
+    );
 
-    if (serialize::openAnnotationsFromJsonFile(annots, *serializedImage.m_annotationsFileName))
+    if (annotsOpt)
     {
+      std::vector<Annotation>& annots = *annotsOpt;
+
       spdlog::info(
         "Loaded annotations from JSON file {} for image {}",
         *serializedImage.m_annotationsFileName,
@@ -867,10 +1038,24 @@ bool EntropyApp::loadSerializedImage(const serialize::Image& serializedImage, bo
   // Set landmarks from file:
   for (const auto& lm : serializedImage.m_landmarkGroups)
   {
-    std::map<size_t, PointRecord<glm::vec3> > landmarks;
+    std::optional<ProjectPreloader::Landmarks> landmarksOpt = takePreloaded(
+      &ProjectPreloader::takeLandmarks,
+      lm.m_csvFileName,
+      [](const fs::path& fileName) -> std::optional<ProjectPreloader::Landmarks>
+      {
+        std::map<size_t, PointRecord<glm::vec3> > landmarks;
+        if (serialize::openLandmarkGroupCsvFile(landmarks, fileName))
+        {
+          return landmarks;
+        }
+        return std::nullopt;
+      }
+    );
 
-    if (serialize::openLandmarkGroupCsvFile(landmarks, lm.m_csvFileName))
+    if (landmarksOpt)
     {
+      std::map<size_t, PointRecord<glm::vec3> >& landmarks = *landmarksOpt;
+
       spdlog::info("Loaded landmarks from CSV file {} for image {}", lm.m_csvFileName, *imageUid);
 
       // Assign random colors to the landmarks. Make sure that landmarks with the same index
@@ -931,139 +1116,6 @@ bool EntropyApp::loadSerializedImage(const serialize::Image& serializedImage, bo
     }
   }
 
-  //        spdlog::info( "Quantiles..." );
-  //        int qq = 0;
-  //        for ( const auto& x : image->settings().componentStatistics(0).m_quantiles )
-  //        {
-  //            std::cout << qq++ << " " << x << std::endl;
-  //        }
-
-  // Compute the distance transformation map for the foreground of image component:
-  /// @todo Put this in separate function, so that the distance map can be calculated upon user request.
-
-  // To conserve GPU memory, the map is downsampled by a factor of 0.5 relative to the
-  // original image size. Also, the map is stored with uint8_t components.
-  /// @todo make configurable
-  static constexpr float sk_downsamplingFactor = 0.5f;
-
-  // The isosurface threshold for separating foreground and background is set at the
-  // 50th quantile image value. This seems to do a pretty good job for CT, T1, and T2 images.
-  /// @todo Eventually, we should do a proper foreground/background segmentation.
-  static constexpr uint32_t sk_thresholdQuantile = 50; // 50th percentile
-
-  // If the image has multiple, interleaved components, then do not compute the distance map
-  // for the components, since we have not yet written functions to perform distance map
-  // calculations on images with interleaved components.
-  if (image->header().interleavedComponents())
-  {
-    spdlog::info(
-      "Image {} has multiple, interleaved components, "
-      "so the distance and noise estimate maps will not be computed",
-      *imageUid
-    );
-  }
-  else if (!image->settings().useDistanceMapForRaycasting())
-  {
-    spdlog::info("Image {} has disabled using the distance map for raycasting", *imageUid);
-  }
-  else
-  {
-    // Create ITK images with float components from which distance maps and noise estimates are computed
-    using ItkImageCompType = float;
-
-    // To save GPU memory, use uint8_t components for the distance map image
-    using DistanceMapCompType = uint8_t;
-
-    using ImageType = itk::Image<ItkImageCompType, 3>;
-    using NoiseImageType = itk::Image<ItkImageCompType, 3>;
-    using DistanceMapImageType = itk::Image<DistanceMapCompType, 3>;
-
-    constexpr uint32_t radius = 1;
-
-    for (uint32_t comp = 0; comp < image->header().numComponentsPerPixel(); ++comp)
-    {
-      /// @note It is somewhat wasteful to recreate an ITK image for each component,
-      /// especially since the image was originally loaded using ITK. But the utility
-      /// functions that we use require an ITK image as input.
-
-      const ImageType::Pointer compImage
-        = createItkImageFromImageComponent<ItkImageCompType>(*image, comp);
-      const NoiseImageType::Pointer noiseEstimateItkImage
-        = computeNoiseEstimate<ItkImageCompType>(compImage, radius);
-
-      if (noiseEstimateItkImage)
-      {
-        const std::string displayName = std::string("Noise estimate for component ")
-                                        + std::to_string(comp) + " of '"
-                                        + image->settings().displayName() + "'";
-
-        Image noiseEstimateImage
-          = createImageFromItkImage<ItkImageCompType>(noiseEstimateItkImage, displayName);
-        const glm::uvec3 noiseImgSize = noiseEstimateImage.header().pixelDimensions();
-
-        // m_data.addImage( noiseEstimateImage ); // Add noise estimate as an image for debug purposes
-        m_data.addNoiseEstimate(*imageUid, comp, std::move(noiseEstimateImage), radius);
-
-        spdlog::debug(
-          "Created noise estimate map (with dimensions {}x{}x{} voxels) with radius {} for "
-          "component {} of image {}",
-          noiseImgSize.x,
-          noiseImgSize.y,
-          noiseImgSize.z,
-          radius,
-          comp,
-          *imageUid
-        );
-      }
-      else
-      {
-        spdlog::error("Unable to create noise estimate for component {} of image {}", comp, *imageUid);
-      }
-
-      // Compute foreground distance map for image component:
-      const auto& stats = image->settings().componentStatistics(comp);
-      const float minThreshold = static_cast<float>(stats.m_quantiles[sk_thresholdQuantile]);
-      const float maxThreshold = static_cast<float>(stats.m_maximum);
-
-      const DistanceMapImageType::Pointer distMapItkImage
-        = computeEuclideanDistanceMap<ItkImageCompType, DistanceMapCompType>(
-          compImage, comp, minThreshold, maxThreshold, sk_downsamplingFactor
-        );
-
-      if (distMapItkImage)
-      {
-        const std::string displayName = std::string("Distance map for component ")
-                                        + std::to_string(comp) + " of '"
-                                        + image->settings().displayName() + "'";
-
-        Image distMapImage
-          = createImageFromItkImage<DistanceMapCompType>(distMapItkImage, displayName);
-        const glm::uvec3 distMapSize = distMapImage.header().pixelDimensions();
-
-        // m_data.addImage( distMapImage ); // Add distance map as an image for debug purposes
-        m_data.addDistanceMap(
-          *imageUid, comp, std::move(distMapImage), static_cast<double>(minThreshold)
-        );
-
-        spdlog::debug(
-          "Created distance map (with dimensions {}x{}x{} voxels) to foreground region [{}, {}] "
-          "of component {} of image {}",
-          distMapSize.x,
-          distMapSize.y,
-          distMapSize.z,
-          minThreshold,
-          maxThreshold,
-          comp,
-          *imageUid
-        );
-      }
-      else
-      {
-        spdlog::error("Unable to create distance map for component {} of image {}", comp, *imageUid);
-      }
-    }
-  }
-
   // Load segmentation images:
 
   // Structure for holding information about a segmentation being loaded
@@ -1241,7 +1293,7 @@ void EntropyApp::loadImagesFromParams(const InputParams& params)
 {
   spdlog::debug("Begin loading images from parameters");
 
-  // The image loader function is called from a new thread
+  // The image loader function is called from a worker thread of the task scheduler
   auto projectLoader =
     [this](
       const serialize::EntropyProject& project,
@@ -1260,19 +1312,51 @@ void EntropyApp::loadImagesFromParams(const InputParams& params)
     if (m_imageLoadCancelled)
     {
       onProjectLoadingDone(false);
+      return;
     }
 
+    // Decode all project files concurrently. They are added to AppData below, in project order,
+    // as each one becomes available.
+    m_preloader = std::make_unique<ProjectPreloader>(
+      m_data.taskScheduler(),
+      m_data.settings().numProjectLoadingThreads(),
+      m_data.settings().retainSortedImageBuffers(),
+      [this](const ProjectPreloader::Progress& progress)
+      {
+        m_data.state().setLoadingStatus(
+          "Loaded " + std::to_string(progress.m_numFilesDecoded) + " of "
+          + std::to_string(progress.m_numFiles) + " files ("
+          + progress.m_lastFileName.filename().string() + ")"
+        );
+        m_loadingStatusChanged = true;
+        m_glfw.postEmptyEvent();
+      }
+    );
+
+    m_preloader->preload(project);
+
+    // Destroy the preloader (cancelling decoding of files that are no longer needed)
+    // before returning from this function:
+    auto releasePreloader = [this]()
+    {
+      m_preloader.reset();
+    };
+
     if (!loadSerializedImage(project.m_referenceImage, true))
     {
       spdlog::critical(
         "Could not load reference image from {}", project.m_referenceImage.m_imageFileName
       );
+      releasePreloader();
       onProjectLoadingDone(false);
+      return;
     }
 
     if (m_imageLoadCancelled)
     {
+      releasePreloader();
       onProjectLoadingDone(false);
+      return;
     }
 
     for (const auto& additionalImage : project.m_additionalImages)
@@ -1286,10 +1370,14 @@ void EntropyApp::loadImagesFromParams(const InputParams& params)
 
       if (m_imageLoadCancelled)
       {
+        releasePreloader();
         onProjectLoadingDone(false);
+        return;
       }
     }
 
+    releasePreloader();
+
     const auto refImageUid = m_data.imageUid(sk_defaultReferenceImageIndex);
 
     if (refImageUid && m_data.setRefImageUid(*refImageUid))
@@ -1300,6 +1388,7 @@ void EntropyApp::loadImagesFromParams(const InputParams& params)
     {
       spdlog::critical("Unable to set {} as the reference image", *refImageUid);
       onProjectLoadingDone(false);
+      return;
     }
 
     const auto desiredActiveImageUid = (sk_defaultActiveImageIndex < m_data.numImages())
@@ -1344,17 +1433,37 @@ void EntropyApp::loadImagesFromParams(const InputParams& params)
 
   m_glfw.setWindowTitleStatus("Loading project...");
 
+  m_data.settings().setRetainSortedImageBuffers(params.retainSortedImageBuffers);
+  m_data.settings().setNumProjectLoadingThreads(params.numLoadingThreads);
   m_data.setProject(serialize::createProjectFromInputParams(params));
 
-  m_futureLoadProject
-    = std::async(std::launch::async, projectLoader, m_data.project(), onProjectLoadingDone);
+  m_futureLoadProject = m_data.taskScheduler().submit(
+    AsyncTasks::ProjectLoading,
+    [projectLoader, onProjectLoadingDone, project = m_data.project()](const TaskToken&)
+    { projectLoader(project, onProjectLoadingDone); }
+  );
 
   spdlog::debug("Done loading images from parameters");
 }
 
 void EntropyApp::setCallbacks()
 {
-  m_glfw.setCallbacks([this]() { m_rendering.render(); }, [this]() { m_imgui.render(); });
+  m_glfw.setCallbacks(
+    [this]()
+    {
+      {
+        PROFILE_SCOPE("Add background results");
+        showLoadingStatus();
+        addComputedComponentMaps();
+        addCompletedSaves();
+        addCompletedSeedSegmentation();
+        m_callbackHandler.applyCompletedSegMorphology();
+      }
+
+      m_rendering.render();
+    },
+    [this]() { m_imgui.render(); }
+  );
 
   m_imgui.setCallbacks(
     [this]() { m_glfw.postEmptyEvent(); },
@@ -1568,11 +1677,18 @@ void EntropyApp::setCallbacks()
     [this](const uuids::uuid& segUid) -> bool
     {
       bool success = false;
+      m_callbackHandler.removeSegFromEditHistory(segUid);
       success |= m_data.removeSeg(segUid);
       success |= m_rendering.removeSegTexture(segUid);
       return success;
     },
 
+    [this](const uuids::uuid& segUid, const fs::path& fileName) -> bool
+    {
+      const Image* seg = m_data.seg(segUid);
+      return seg && m_imageSaveScheduler.schedule(segUid, *seg, 0, fileName).has_value();
+    },
+
     [this](
       const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const SeedSegmentationType& segType
     ) -> bool
@@ -5,7 +5,10 @@
 #include "common/filesystem.h"
 
 #include "logic/app/CallbackHandler.h"
+#include "logic/app/ComponentMapScheduler.h"
+#include "logic/app/ImageSaveScheduler.h"
 #include "logic/app/Data.h"
+#include "logic/app/ProjectPreloader.h"
 #include "logic/app/Settings.h"
 #include "logic/app/State.h"
 
@@ -18,6 +21,7 @@
 
 #include <atomic>
 #include <future>
+#include <memory>
 #include <optional>
 #include <string>
 
@@ -121,8 +125,35 @@ private:
     const fs::path& fileName, bool ignoreIfAlreadyLoaded
   );
 
+  /// Take a file decoded by the project preloader, or open it now if it was not preloaded
+  /// @return The file contents, or std::nullopt if the file could not be opened
+  template<class T, class OpenFn>
+  std::optional<T> takePreloaded(
+    std::optional<std::optional<T> > (ProjectPreloader::*take)(const fs::path&),
+    const fs::path& fileName,
+    OpenFn open
+  );
+
+  /// Show the project loading status in the window title (called from the main thread)
+  void showLoadingStatus();
+
+  /// Add the component maps computed in the background to the app data and update their
+  /// textures (called from the main thread)
+  void addComputedComponentMaps();
+
+  /// Set the file names of the images saved in the background and mark the segmentations that
+  /// are still being saved in the UI (called from the main thread)
+  void addCompletedSaves();
+
+  /// Show the progress of the seed segmentation that runs in the background in the window title
+  /// and add its result once it finishes (called from the main thread)
+  void addCompletedSeedSegmentation();
+
   std::future<void> m_futureLoadProject;
 
+  /// Decodes project files concurrently while a project is being loaded
+  std::unique_ptr<ProjectPreloader> m_preloader;
+
   /// Atomic boolean that is set to true iff image loading is cancelled
   std::atomic<bool> m_imageLoadCancelled;
 
@@ -134,11 +165,23 @@ private:
   /// If true, this flag will cause the render loop to exit.
   std::atomic<bool> m_imageLoadFailed;
 
+  /// Atomic boolean set to true when the project loading status changes
+  std::atomic<bool> m_loadingStatusChanged;
+
+  /// Seed segmentation progress shown in the window title
+  std::string m_seedSegTitleStatus;
+
   GlfwWrapper m_glfw;                //!< GLFW wrapper
   AppData m_data;                    //!< Application data
   Rendering m_rendering;             //!< Render logic
   CallbackHandler m_callbackHandler; //!< UI callback handlers
   ImGuiWrapper m_imgui;              //!< ImGui wrapper
+
+  /// Computes image component noise estimates and distance maps in the background
+  ComponentMapScheduler m_componentMapScheduler;
+
+  /// Saves segmentations in the background. Scheduled saves finish before the app exits.
+  ImageSaveScheduler m_imageSaveScheduler;
 };
 
 #endif // ENTROPY_APP_H
@@ -11,10 +11,46 @@
  */
 enum class AsyncTasks
 {
+  ComponentMapsComputation, //!< Noise estimate and distance map of an image component
   GraphCutsSegmentation,
-  IsosurfaceMeshGeneration
+  ImageComponentSave,       //!< Save of an image component (e.g. a segmentation) to disk
+  IsosurfaceMeshGeneration,
+  LabelMeshGeneration,      //!< Meshes of the labels of a segmentation
+  PoissonSegmentation,
+  ProjectLoading,           //!< Loading of the project images from disk
+  SegMorphology             //!< Morphological operation on a segmentation
 };
 
+/**
+ * Priority of a task in the task scheduler
+ */
+enum class TaskPriority
+{
+  Interactive, //!< Task whose result the user is waiting on; runs before background tasks
+  Background   //!< Task that the user is not waiting on
+};
+
+/// @brief Get the scheduling priority of a type of task
+inline TaskPriority taskPriority(AsyncTasks task)
+{
+  switch (task)
+  {
+  case AsyncTasks::GraphCutsSegmentation:
+  case AsyncTasks::IsosurfaceMeshGeneration:
+  case AsyncTasks::LabelMeshGeneration:
+  case AsyncTasks::PoissonSegmentation:
+  case AsyncTasks::ProjectLoading:
+  case AsyncTasks::SegMorphology:
+    return TaskPriority::Interactive;
+
+  case AsyncTasks::ComponentMapsComputation:
+  case AsyncTasks::ImageComponentSave:
+    return TaskPriority::Background;
+  }
+
+  return TaskPriority::Background;
+}
+
 struct AsyncTaskDetails
 {
   AsyncTasks task;         //!< Type of task
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <vector>
 
 /**
  * @brief Method used to compute number of histogram bins in a scalar (single component) image
@@ -16,6 +18,29 @@ enum class NumBinsComputationMethod
   FreedmanDiaconis
 };
 
+/**
+ * @brief Bin counts of the histogram of a single image component. The counts are cached, since
+ * binning all values of the component is too slow to repeat every frame.
+ */
+struct HistogramCache
+{
+  bool m_isValid = false;                  //!< Whether the counts have been computed
+  int m_numBins = 0;                       //!< Number of bins of the counts
+  std::array<double, 2> m_range{0.0, 0.0}; //!< Intensity range (inclusive) of the counts
+
+  std::vector<double> m_binCenters; //!< Intensity at the center of each bin
+  std::vector<double> m_binCounts;  //!< Number of values in each bin
+
+  uint64_t m_numValues = 0;     //!< Number of values of the component, including outliers
+  uint64_t m_numBelowRange = 0; //!< Number of values below the intensity range
+
+  /// Whether the counts were computed with the given number of bins and intensity range
+  bool matches(int numBins, double rangeMin, double rangeMax) const
+  {
+    return m_isValid && numBins == m_numBins && rangeMin == m_range[0] && rangeMax == m_range[1];
+  }
+};
+
 /**
  * @brief Settings used for computing and displaying the histogram of a single image component
  */
@@ -38,4 +63,8 @@ struct HistogramSettings
   /// If not defined, then the image component's [min, max] range will be used
   std::array<double, 2> m_intensityRange{0.0, 0.0};
   bool m_useCustomIntensityRange = false; //!< Whether to use the custom intensity range
+
+  /// Bin counts computed with the number of bins and intensity range above. They are recomputed
+  /// when either setting changes and cleared when the component values change.
+  HistogramCache m_cache;
 };
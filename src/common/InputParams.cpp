@@ -16,6 +16,8 @@ std::ostream& operator<<(std::ostream& os, const InputParams& p)
   if (p.projectFile)
     os << "\nProject file: " << *p.projectFile;
   os << "\nConsole log level: " << p.consoleLogLevel;
+  os << "\nRetain sorted image buffers: " << std::boolalpha << p.retainSortedImageBuffers;
+  os << "\nNumber of loading threads: " << p.numLoadingThreads;
 
   return os;
 }
@@ -3,6 +3,7 @@
 
 #include <spdlog/spdlog.h>
 
+#include <cstddef>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -26,6 +27,12 @@ struct InputParams
   /// Console logging level
   spdlog::level::level_enum consoleLogLevel;
 
+  /// Keep sorted copies of image components in memory (for exact quantiles of float images)
+  bool retainSortedImageBuffers = false;
+
+  /// Number of threads used to load project files (0 means one per hardware thread)
+  std::size_t numLoadingThreads = 0;
+
   /// Flag indicating that the parameters been successfully set
   bool set = false;
 };
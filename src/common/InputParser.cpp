@@ -116,6 +116,18 @@ int parseCommandLine(const int argc, char* argv[], InputParams& params)
 
   program.add_argument("-p", "--project").help("project file in JSON format");
 
+  program.add_argument("--sorted-buffers")
+    .default_value(false)
+    .implicit_value(true)
+    .help("keep sorted copies of image components in memory for exact quantiles of "
+          "floating-point images (doubles image memory use)");
+
+  program.add_argument("--load-threads")
+    .default_value(0)
+    .scan<'i', int>()
+    .help("number of threads used to load images and other project files "
+          "(0 uses one thread per hardware thread)");
+
   program.add_argument("images")
     .remaining() // so that a list of images can be provided
     .action(parseImageSegPair)
@@ -165,6 +177,10 @@ int parseCommandLine(const int argc, char* argv[], InputParams& params)
     }
 
     logLevel = program.get<std::string>("-l");
+    params.retainSortedImageBuffers = program.get<bool>("--sorted-buffers");
+    params.numLoadingThreads = static_cast<std::size_t>(
+      std::max(program.get<int>("--load-threads"), 0)
+    );
   }
   catch (const std::exception& e)
   {
@@ -0,0 +1,177 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+
+/// @brief Number of hardware threads available for data-parallel loops (at least one)
+inline std::size_t numThreads()
+{
+  static const std::size_t s_numThreads
+    = std::max(std::size_t{1}, static_cast<std::size_t>(std::thread::hardware_concurrency()));
+  return s_numThreads;
+}
+
+/**
+ * @brief Compute the number of contiguous chunks into which an index range is split
+ * @param[in] N Number of elements in the range [0, N)
+ * @param[in] minChunkSize Minimum number of elements per chunk
+ * @param[in] maxChunks Maximum number of chunks (0 means one chunk per hardware thread)
+ */
+inline std::size_t numChunks(std::size_t N, std::size_t minChunkSize, std::size_t maxChunks = 0)
+{
+  if (0 == N)
+  {
+    return 0;
+  }
+
+  const std::size_t maxC = (0 == maxChunks) ? numThreads() : std::min(maxChunks, numThreads());
+  const std::size_t byChunkSize = N / std::max(minChunkSize, std::size_t{1});
+  return std::clamp(byChunkSize, std::size_t{1}, std::max(maxC, std::size_t{1}));
+}
+
+namespace detail
+{
+
+/**
+ * @brief Run the chunks [0, numChunks) as subtasks of the task scheduler. The calling thread runs
+ * chunks until none are left to start, then waits for the chunks started by other workers, so it
+ * never waits on a subtask that is queued. Defined in TaskScheduler.cpp.
+ *
+ * Chunks are submitted to the scheduler of the calling worker, or to the default scheduler if the
+ * calling thread is not a worker. If there is no scheduler, then all chunks run on the calling
+ * thread.
+ */
+void runChunks(std::size_t numChunks, const std::function<void(std::size_t chunk)>& runChunk);
+
+} // namespace detail
+
+/**
+ * @brief Split the index range [0, N) into contiguous chunks and process them concurrently as
+ * subtasks of the task scheduler. The calling thread processes chunks too, so a loop called from
+ * a scheduler task runs inline on its worker and never creates threads.
+ *
+ * @param[in] N Number of elements
+ * @param[in] minChunkSize Minimum number of elements per chunk
+ * @param[in] fn Function with signature void(std::size_t chunk, std::size_t begin, std::size_t end)
+ * @param[in] maxChunks Maximum number of chunks (0 means one chunk per hardware thread)
+ *
+ * @return Number of chunks processed, which equals \c numChunks(N, minChunkSize, maxChunks)
+ * @note The first exception thrown by \c fn is re-thrown on the calling thread.
+ */
+template<class Fn>
+std::size_t forEachChunk(
+  std::size_t N, std::size_t minChunkSize, Fn&& fn, std::size_t maxChunks = 0
+)
+{
+  const std::size_t C = numChunks(N, minChunkSize, maxChunks);
+
+  if (C <= 1)
+  {
+    if (1 == C)
+    {
+      fn(std::size_t{0}, std::size_t{0}, N);
+    }
+    return C;
+  }
+
+  const std::size_t chunkSize = N / C;
+  const std::size_t remainder = N % C;
+
+  auto chunkBegin = [&chunkSize, &remainder](std::size_t c)
+  { return c * chunkSize + std::min(c, remainder); };
+
+  std::vector<std::exception_ptr> errors(C, nullptr);
+
+  detail::runChunks(
+    C,
+    [&fn, &errors, &chunkBegin](std::size_t c)
+    {
+      try
+      {
+        fn(c, chunkBegin(c), chunkBegin(c + 1));
+      }
+      catch (...)
+      {
+        errors[c] = std::current_exception();
+      }
+    }
+  );
+
+  for (const auto& e : errors)
+  {
+    if (e)
+    {
+      std::rethrow_exception(e);
+    }
+  }
+
+  return C;
+}
+
+/// @brief Minimum number of slices per slab, so that a slab has at least minVoxelsPerSlab voxels
+inline std::size_t minSlicesPerSlab(std::size_t voxelsPerSlice, std::size_t minVoxelsPerSlab)
+{
+  return std::max(std::size_t{1}, minVoxelsPerSlab / std::max(std::size_t{1}, voxelsPerSlice));
+}
+
+/**
+ * @brief Compute the number of slabs of contiguous slices into which a volume is split by
+ * \c forEachSlab
+ * @param[in] numSlices Number of slices of the volume
+ * @param[in] voxelsPerSlice Number of voxels per slice
+ * @param[in] minVoxelsPerSlab Minimum number of voxels per slab
+ * @param[in] maxSlabs Maximum number of slabs (0 means one slab per hardware thread)
+ */
+inline std::size_t numSlabs(
+  int numSlices, std::size_t voxelsPerSlice, std::size_t minVoxelsPerSlab, std::size_t maxSlabs = 0
+)
+{
+  return numChunks(
+    static_cast<std::size_t>(std::max(numSlices, 0)),
+    minSlicesPerSlab(voxelsPerSlice, minVoxelsPerSlab),
+    maxSlabs
+  );
+}
+
+/**
+ * @brief Split the slices [0, numSlices) of a volume into slabs of contiguous slices and process
+ * them concurrently with \c forEachChunk. A slice may be a slice of any axis of the volume.
+ *
+ * @param[in] numSlices Number of slices of the volume
+ * @param[in] voxelsPerSlice Number of voxels per slice
+ * @param[in] minVoxelsPerSlab Minimum number of voxels per slab
+ * @param[in] fn Function with signature void(std::size_t slab, int begin, int end)
+ * @param[in] maxSlabs Maximum number of slabs (0 means one slab per hardware thread)
+ *
+ * @return Number of slabs processed, which equals
+ * \c numSlabs(numSlices, voxelsPerSlice, minVoxelsPerSlab, maxSlabs)
+ */
+template<class Fn>
+std::size_t forEachSlab(
+  int numSlices,
+  std::size_t voxelsPerSlice,
+  std::size_t minVoxelsPerSlab,
+  Fn&& fn,
+  std::size_t maxSlabs = 0
+)
+{
+  return forEachChunk(
+    static_cast<std::size_t>(std::max(numSlices, 0)),
+    minSlicesPerSlab(voxelsPerSlice, minVoxelsPerSlab),
+    [&fn](std::size_t slab, std::size_t begin, std::size_t end)
+    { fn(slab, static_cast<int>(begin), static_cast<int>(end)); },
+    maxSlabs
+  );
+}
+
+} // namespace parallel
+
+#endif // PARALLEL_FOR_H
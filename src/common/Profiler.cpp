@@ -0,0 +1,370 @@
+#include "common/Profiler.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+/// Write a string as a JSON string
+void writeJsonString(std::ostream& os, const char* str)
+{
+  os << '"';
+
+  for (const char* c = str; *c; ++c)
+  {
+    if ('"' == *c || '\\' == *c)
+    {
+      os << '\\';
+    }
+
+    os << *c;
+  }
+
+  os << '"';
+}
+
+} // namespace
+
+struct Profiler::ThreadBuffer
+{
+  /// Guards the members below. It is only contended while the buffer is merged or traced.
+  std::mutex m_mutex;
+
+  const std::thread::id m_thread = std::this_thread::get_id(); //!< Thread that owns the buffer
+
+  std::vector<double> m_currentMs;         //!< Time of each frame stage since the last merge
+  std::vector<std::size_t> m_currentCalls; //!< Calls of each frame stage since the last merge
+  std::vector<TraceEvent> m_traceEvents;   //!< Trace events of the thread
+
+  bool m_retired = false; //!< Has the thread exited?
+};
+
+class Profiler::ThreadBufferOwner
+{
+public:
+  explicit ThreadBufferOwner(std::shared_ptr<ThreadBuffer> buffer)
+    : m_buffer(std::move(buffer))
+  {
+  }
+
+  ~ThreadBufferOwner()
+  {
+    std::lock_guard<std::mutex> lock(m_buffer->m_mutex);
+    m_buffer->m_retired = true;
+  }
+
+  ThreadBufferOwner(const ThreadBufferOwner&) = delete;
+  ThreadBufferOwner& operator=(const ThreadBufferOwner&) = delete;
+
+  ThreadBuffer& buffer()
+  {
+    return *m_buffer;
+  }
+
+private:
+  std::shared_ptr<ThreadBuffer> m_buffer;
+};
+
+Profiler& Profiler::instance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler()
+  : m_enabled(false)
+  , m_tracing(false)
+  , m_numTraceEvents(0)
+  , m_epoch(Clock::now())
+{
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+  if (!enabled)
+  {
+    stopTrace();
+  }
+
+  m_enabled = enabled;
+}
+
+Profiler::StageId Profiler::stageId(const char* name)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const auto [it, inserted]
+    = m_stageIds.try_emplace(name, static_cast<StageId>(m_stageNames.size()));
+
+  if (inserted)
+  {
+    m_stageNames.push_back(name);
+    m_stages.emplace_back();
+  }
+
+  return it->second;
+}
+
+void Profiler::record(StageId id, StageKind kind, Clock::time_point start, Clock::time_point end)
+{
+  using namespace std::chrono;
+
+  ThreadBuffer& buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.m_mutex);
+
+  if (StageKind::Frame == kind)
+  {
+    if (buffer.m_currentCalls.size() <= id)
+    {
+      buffer.m_currentMs.resize(id + 1, 0.0);
+      buffer.m_currentCalls.resize(id + 1, 0);
+    }
+
+    buffer.m_currentMs[id] += duration<double, std::milli>(end - start).count();
+    ++buffer.m_currentCalls[id];
+  }
+
+  if (m_tracing && m_numTraceEvents.fetch_add(1, std::memory_order_relaxed) < sk_maxTraceEvents)
+  {
+    buffer.m_traceEvents.push_back(
+      {id,
+       duration_cast<microseconds>(start - m_epoch).count(),
+       duration_cast<microseconds>(end - start).count()}
+    );
+  }
+}
+
+void Profiler::endFrame()
+{
+  if (!isEnabled())
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  mergeThreadBuffers();
+
+  for (Stage& stage : m_stages)
+  {
+    if (0 == stage.m_currentCalls)
+    {
+      continue;
+    }
+
+    stage.m_frameMs[stage.m_head] = stage.m_currentMs;
+    stage.m_frameCalls[stage.m_head] = stage.m_currentCalls;
+    stage.m_head = (stage.m_head + 1) % sk_numFrames;
+    stage.m_numFrames = std::min(stage.m_numFrames + 1, sk_numFrames);
+
+    stage.m_currentMs = 0.0;
+    stage.m_currentCalls = 0;
+  }
+}
+
+std::vector<Profiler::StageStats> Profiler::stats() const
+{
+  std::vector<StageStats> allStats;
+  std::vector<double> sorted;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (std::size_t id = 0; id < m_stages.size(); ++id)
+  {
+    const Stage& stage = m_stages[id];
+
+    if (0 == stage.m_numFrames)
+    {
+      continue;
+    }
+
+    // The ring buffer is full, or holds the frames [0, m_numFrames)
+    sorted.assign(
+      std::begin(stage.m_frameMs), std::next(std::begin(stage.m_frameMs), stage.m_numFrames)
+    );
+    std::sort(std::begin(sorted), std::end(sorted));
+
+    const std::size_t last = (stage.m_head + sk_numFrames - 1) % sk_numFrames;
+    const std::size_t p99 = (99 * sorted.size() + 99) / 100 - 1;
+
+    StageStats s;
+    s.m_name = m_stageNames[id];
+    s.m_numFrames = stage.m_numFrames;
+    s.m_numCalls = stage.m_frameCalls[last];
+    s.m_lastMs = stage.m_frameMs[last];
+    s.m_minMs = sorted.front();
+    s.m_avgMs = std::accumulate(std::begin(sorted), std::end(sorted), 0.0)
+                / static_cast<double>(sorted.size());
+    s.m_p99Ms = sorted[p99];
+
+    allStats.emplace_back(std::move(s));
+  }
+
+  std::sort(
+    std::begin(allStats),
+    std::end(allStats),
+    [](const StageStats& a, const StageStats& b) { return a.m_name < b.m_name; }
+  );
+
+  return allStats;
+}
+
+void Profiler::clearStats()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // Times recorded by the threads since the last frame are cleared too
+  mergeThreadBuffers();
+
+  for (Stage& stage : m_stages)
+  {
+    stage = Stage{};
+  }
+}
+
+void Profiler::startTrace()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_retiredTraceEvents.clear();
+
+  for (const auto& buffer : m_threadBuffers)
+  {
+    std::lock_guard<std::mutex> bufferLock(buffer->m_mutex);
+    buffer->m_traceEvents.clear();
+  }
+
+  m_numTraceEvents = 0;
+  m_tracing = true;
+
+  spdlog::info("Started recording profiler trace");
+}
+
+void Profiler::stopTrace()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_tracing)
+  {
+    m_tracing = false;
+    spdlog::info("Stopped recording profiler trace with {} events", numTraceEvents());
+  }
+}
+
+bool Profiler::isTracing() const
+{
+  return m_tracing;
+}
+
+std::size_t Profiler::numTraceEvents() const
+{
+  // Events beyond the maximum are counted but dropped
+  return std::min(m_numTraceEvents.load(std::memory_order_relaxed), sk_maxTraceEvents);
+}
+
+bool Profiler::writeTrace(const fs::path& fileName) const
+{
+  std::ofstream file(fileName);
+
+  if (!file)
+  {
+    spdlog::error("Unable to open file {} to write profiler trace", fileName);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::size_t numEvents = 0;
+
+  auto writeEvent = [this, &file, &numEvents](std::thread::id thread, const TraceEvent& e)
+  {
+    file << (0 == numEvents ? "\n" : ",\n") << "{\"name\":";
+    writeJsonString(file, m_stageNames[e.m_stage]);
+    file << ",\"cat\":\"entropy\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+         << std::hash<std::thread::id>{}(thread) % std::numeric_limits<uint32_t>::max()
+         << ",\"ts\":" << e.m_startUs << ",\"dur\":" << e.m_durationUs << "}";
+    ++numEvents;
+  };
+
+  // Complete ('X') events, with times in microseconds
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  for (const auto& [thread, e] : m_retiredTraceEvents)
+  {
+    writeEvent(thread, e);
+  }
+
+  for (const auto& buffer : m_threadBuffers)
+  {
+    std::lock_guard<std::mutex> bufferLock(buffer->m_mutex);
+
+    for (const TraceEvent& e : buffer->m_traceEvents)
+    {
+      writeEvent(buffer->m_thread, e);
+    }
+  }
+
+  file << "\n]}\n";
+
+  if (!file)
+  {
+    spdlog::error("Error writing profiler trace to file {}", fileName);
+    return false;
+  }
+
+  spdlog::info("Wrote profiler trace with {} events to file {}", numEvents, fileName);
+  return true;
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+  thread_local ThreadBufferOwner owner(
+    [this]()
+    {
+      auto buffer = std::make_shared<ThreadBuffer>();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_threadBuffers.push_back(buffer);
+      return buffer;
+    }()
+  );
+
+  return owner.buffer();
+}
+
+void Profiler::mergeThreadBuffers()
+{
+  for (auto it = std::begin(m_threadBuffers); it != std::end(m_threadBuffers);)
+  {
+    ThreadBuffer& buffer = **it;
+    bool retired = false;
+
+    {
+      std::lock_guard<std::mutex> bufferLock(buffer.m_mutex);
+
+      for (std::size_t id = 0; id < buffer.m_currentCalls.size(); ++id)
+      {
+        m_stages[id].m_currentMs += buffer.m_currentMs[id];
+        m_stages[id].m_currentCalls += buffer.m_currentCalls[id];
+        buffer.m_currentMs[id] = 0.0;
+        buffer.m_currentCalls[id] = 0;
+      }
+
+      // The trace events of a thread that exited are kept by the profiler
+      if (buffer.m_retired)
+      {
+        for (const TraceEvent& e : buffer.m_traceEvents)
+        {
+          m_retiredTraceEvents.emplace_back(buffer.m_thread, e);
+        }
+
+        retired = true;
+      }
+    }
+
+    it = retired ? m_threadBuffers.erase(it) : std::next(it);
+  }
+}
@@ -0,0 +1,228 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "common/filesystem.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Profiler of the CPU time of the stages of the application, measured by scoped timers.
+ *
+ * The times of each frame stage are summed over each frame and kept in a ring buffer of the most
+ * recent frames, from which the UI shows statistics. Background stages (e.g. tasks of the task
+ * scheduler) are not tied to frames, so they are only traced. While a trace is recorded, every
+ * timed scope is also kept as an event of a Chrome trace (viewable in chrome://tracing or
+ * Perfetto).
+ *
+ * Stage names are interned to integer IDs once per timed scope. Each thread records its times and
+ * trace events in its own buffer, which is merged into the stages at the end of each frame.
+ *
+ * When the profiler is disabled, a scoped timer costs one relaxed atomic load.
+ *
+ * @note All functions are thread-safe. Stages timed on threads other than the main thread are
+ * summed into the frame that is current when they finish.
+ */
+class Profiler
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// ID of an interned stage name
+  using StageId = uint32_t;
+
+  /// Kind of a stage
+  enum class StageKind
+  {
+    Frame,     //!< Stage of the frame, whose times are summed per frame
+    Background //!< Stage of a background task, which is only traced
+  };
+
+  /// Number of frames of the ring buffer of each stage
+  static constexpr std::size_t sk_numFrames = 240;
+
+  /// Maximum number of events of a trace. Events beyond it are dropped.
+  static constexpr std::size_t sk_maxTraceEvents = std::size_t{1} << 20;
+
+  /// Statistics of the time of a frame stage per frame, over the frames in the ring buffer in
+  /// which the stage ran
+  struct StageStats
+  {
+    std::string m_name;          //!< Stage name
+    std::size_t m_numFrames = 0; //!< Number of frames in which the stage ran
+    std::size_t m_numCalls = 0;  //!< Number of times the stage ran in the last of these frames
+    double m_lastMs = 0.0;       //!< Time of the last of these frames
+    double m_minMs = 0.0;        //!< Minimum time
+    double m_avgMs = 0.0;        //!< Average time
+    double m_p99Ms = 0.0;        //!< 99th percentile time
+  };
+
+  /// The profiler of the application
+  static Profiler& instance();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  /// Enable or disable the profiler. Disabling it stops the trace, if one is recorded.
+  void setEnabled(bool enabled);
+
+  bool isEnabled() const
+  {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Intern a stage name
+   * @param[in] name Stage name, which must outlive the profiler (e.g. be a string literal)
+   * @return ID of the stage, which is the same for all calls with equal names
+   */
+  StageId stageId(const char* name);
+
+  /// Record the time of a stage in the buffer of the calling thread
+  void record(StageId id, StageKind kind, Clock::time_point start, Clock::time_point end);
+
+  /// End the current frame, pushing the times of the frame stages that ran in it to their ring
+  /// buffers
+  void endFrame();
+
+  /// Statistics of all frame stages, ordered by name
+  std::vector<StageStats> stats() const;
+
+  /// Clear the times of all stages
+  void clearStats();
+
+  /// Start recording a trace, discarding the events of the prior trace
+  void startTrace();
+
+  /// Stop recording the trace. Its events are kept until the next trace starts.
+  void stopTrace();
+
+  bool isTracing() const;
+
+  /// Number of events of the trace
+  std::size_t numTraceEvents() const;
+
+  /**
+   * @brief Write the events of the trace to a file in the Chrome trace event (JSON) format
+   * @return True iff the file was written
+   */
+  bool writeTrace(const fs::path& fileName) const;
+
+private:
+  Profiler();
+
+  /// Times of a frame stage
+  struct Stage
+  {
+    /// Ring buffers of the times and numbers of calls per frame
+    std::array<double, sk_numFrames> m_frameMs{};
+    std::array<std::size_t, sk_numFrames> m_frameCalls{};
+
+    std::size_t m_head = 0;         //!< Next frame of the ring buffers
+    std::size_t m_numFrames = 0;    //!< Number of frames in the ring buffers
+    double m_currentMs = 0.0;       //!< Time in the current frame
+    std::size_t m_currentCalls = 0; //!< Number of calls in the current frame
+  };
+
+  /// Complete event of the trace
+  struct TraceEvent
+  {
+    StageId m_stage;      //!< Stage
+    int64_t m_startUs;    //!< Start time, relative to the creation of the profiler
+    int64_t m_durationUs; //!< Duration
+  };
+
+  /// Times and trace events recorded by one thread since they were last merged
+  struct ThreadBuffer;
+
+  /// Owner of the buffer of a thread, which retires the buffer when the thread exits
+  class ThreadBufferOwner;
+
+  /// Buffer of the calling thread, which is registered with the profiler on first use
+  ThreadBuffer& threadBuffer();
+
+  /// Merge the frame times of all thread buffers into the current frame of the stages
+  void mergeThreadBuffers();
+
+  std::atomic<bool> m_enabled;
+  std::atomic<bool> m_tracing;
+  std::atomic<std::size_t> m_numTraceEvents; //!< Number of events recorded in the trace
+  const Clock::time_point m_epoch;           //!< Time at which the profiler was created
+
+  mutable std::mutex m_mutex; //!< Guards all members below
+
+  std::map<std::string, StageId> m_stageIds; //!< Interned stage names
+  std::vector<const char*> m_stageNames;     //!< Stage names, indexed by ID
+  std::vector<Stage> m_stages;               //!< Frame stages, indexed by ID
+
+  std::vector<std::shared_ptr<ThreadBuffer> > m_threadBuffers; //!< Buffers of all threads
+
+  /// Trace events of threads that exited, with the threads on which they ran
+  std::vector<std::pair<std::thread::id, TraceEvent> > m_retiredTraceEvents;
+};
+
+/**
+ * @brief Timer of a scope, which records the time of a stage with the profiler when it is
+ * destroyed
+ */
+class ScopedTimer
+{
+public:
+  ScopedTimer(Profiler::StageId id, Profiler::StageKind kind)
+    : m_id(id)
+    , m_kind(kind)
+    , m_enabled(Profiler::instance().isEnabled())
+  {
+    if (m_enabled)
+    {
+      m_start = Profiler::Clock::now();
+    }
+  }
+
+  ~ScopedTimer()
+  {
+    if (m_enabled)
+    {
+      Profiler::instance().record(m_id, m_kind, m_start, Profiler::Clock::now());
+    }
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+  const Profiler::StageId m_id;
+  const Profiler::StageKind m_kind;
+  const bool m_enabled; //!< Was the profiler enabled when the scope began?
+  Profiler::Clock::time_point m_start;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+/// Time the enclosing scope as a stage of the given kind. The name is interned once per scope.
+#define PROFILE_SCOPE_OF_KIND(name, kind)                                                          \
+  static const Profiler::StageId PROFILE_CONCAT(profileStageId_, __LINE__)                         \
+    = Profiler::instance().stageId(name);                                                          \
+  const ScopedTimer PROFILE_CONCAT(profileScopedTimer_, __LINE__)(                                 \
+    PROFILE_CONCAT(profileStageId_, __LINE__), kind                                                \
+  )
+
+/// Time the enclosing scope as a frame stage with the given name
+#define PROFILE_SCOPE(name) PROFILE_SCOPE_OF_KIND(name, Profiler::StageKind::Frame)
+
+/// Time the enclosing scope of a background task as a stage with the given name, which is traced
+/// but not summed per frame
+#define PROFILE_BACKGROUND_SCOPE(name) PROFILE_SCOPE_OF_KIND(name, Profiler::StageKind::Background)
+
+#endif // PROFILER_H
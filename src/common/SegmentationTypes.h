@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <map>
+#include <optional>
 
 using LabelType = int64_t;
 
@@ -32,6 +33,48 @@ enum class GraphNeighborhoodType
   Neighbors26 // 26 face, edge, and vertex neighbors
 };
 
+enum class RegionGrowConnectivity
+{
+  Neighbors6,  // 6 face neighbors
+  Neighbors18, // 18 face and edge neighbors
+  Neighbors26  // 26 face, edge, and vertex neighbors
+};
+
+/// Intensity range of the voxels added to a region by region growing
+enum class RegionGrowThreshold
+{
+  WindowLevel, // Window of the image component
+  SeedValue    // Value of the seed voxel, plus or minus a tolerance
+};
+
+enum class MorphologyOperation
+{
+  Dilate,
+  Erode,
+  Open,     // Erode, then dilate
+  Close,    // Dilate, then erode
+  FillHoles // Fill the regions that are enclosed by a label
+};
+
+enum class MorphologyElement
+{
+  Ball, // Ellipsoid in voxels, which is a ball in physical space
+  Box   // Box in voxels
+};
+
+/// Morphological operation on the labels of a segmentation
+struct MorphologyParams
+{
+  MorphologyOperation operation = MorphologyOperation::Dilate;
+  MorphologyElement element = MorphologyElement::Ball;
+
+  /// Radius of the structuring element (mm). Unused by hole filling.
+  double radius = 1.0;
+
+  /// Label to which the operation is applied, or none to apply it to each non-zero label
+  std::optional<LabelType> label;
+};
+
 struct LabelIndexMaps
 {
   /// Map from segmentation label to label index
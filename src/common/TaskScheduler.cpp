@@ -0,0 +1,402 @@
+#include "common/TaskScheduler.h"
+#include "common/ParallelFor.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+namespace
+{
+constexpr std::size_t sk_interactive = 0;
+constexpr std::size_t sk_background = 1;
+
+/// Scheduler and index of the worker that runs on this thread, if any
+thread_local TaskScheduler* t_scheduler = nullptr;
+thread_local std::size_t t_worker = 0;
+
+/// Priority of the job running on this worker thread
+thread_local TaskPriority t_priority = TaskPriority::Interactive;
+
+/// Scheduler of the data-parallel loops called from threads that are not workers
+std::atomic<TaskScheduler*> s_defaultScheduler{nullptr};
+
+/// Chunks of a data-parallel loop, shared by the calling thread and the subtasks that help it
+struct LoopChunks
+{
+  /// Runs a chunk. It is only called for chunks that are started before the loop returns.
+  const std::function<void(std::size_t)>* m_runChunk = nullptr;
+  std::size_t m_numChunks = 0;
+
+  std::atomic<std::size_t> m_nextChunk{0}; //!< Index of the next chunk to start
+  std::atomic<std::size_t> m_numDone{0};   //!< Number of chunks that are done
+
+  std::mutex m_mutex;                  //!< Guards waiting for the chunks
+  std::condition_variable m_condition; //!< Signals that all chunks are done
+};
+
+/// Run the chunks of a loop that are not started, until none are left
+void runAvailableChunks(LoopChunks& chunks)
+{
+  for (std::size_t c = chunks.m_nextChunk++; c < chunks.m_numChunks; c = chunks.m_nextChunk++)
+  {
+    (*chunks.m_runChunk)(c);
+
+    if (chunks.m_numChunks == ++chunks.m_numDone)
+    {
+      std::lock_guard<std::mutex> lock(chunks.m_mutex);
+      chunks.m_condition.notify_all();
+    }
+  }
+}
+
+std::size_t priorityIndex(TaskPriority priority)
+{
+  return (TaskPriority::Interactive == priority) ? sk_interactive : sk_background;
+}
+
+} // namespace
+
+TaskToken::TaskToken()
+  : m_state(std::make_shared<State>())
+{
+}
+
+void TaskToken::cancel() const
+{
+  m_state->m_cancelled = true;
+}
+
+bool TaskToken::isCancelled() const
+{
+  return m_state->m_cancelled;
+}
+
+void TaskToken::setProgress(float fraction) const
+{
+  m_state->m_progress = std::clamp(fraction, 0.0f, 1.0f);
+}
+
+float TaskToken::progress() const
+{
+  return m_state->m_progress;
+}
+
+TaskScheduler::TaskScheduler(std::size_t numWorkers)
+  : m_stopping(false)
+  , m_numQueued{0, 0}
+  , m_numRunningBackground(0)
+  , m_numRunning(0)
+{
+  const std::size_t N = (0 == numWorkers) ? parallel::numThreads() : numWorkers;
+
+  // Leave one worker free for interactive tasks, unless there is only one
+  m_maxRunningBackground = std::max(std::size_t{1}, N - 1);
+
+  // All workers exist before any thread starts, since workers steal from each other
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    m_workers.emplace_back(std::make_unique<Worker>());
+  }
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    m_threads.emplace_back(&TaskScheduler::work, this, i);
+  }
+
+  // The first scheduler runs the data-parallel loops of threads that are not workers
+  TaskScheduler* noScheduler = nullptr;
+  s_defaultScheduler.compare_exchange_strong(noScheduler, this);
+
+  spdlog::debug("Started task scheduler with {} workers", N);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+  shutdown();
+}
+
+void TaskScheduler::shutdown()
+{
+  TaskScheduler* self = this;
+  s_defaultScheduler.compare_exchange_strong(self, nullptr);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_stopping)
+    {
+      return;
+    }
+
+    // Dropping the queued jobs breaks the promises of their futures
+    m_stopping = true;
+
+    for (std::size_t p = 0; p < sk_numPriorities; ++p)
+    {
+      m_numQueued[p] -= m_shared[p].size();
+      m_shared[p].clear();
+    }
+  }
+
+  for (auto& worker : m_workers)
+  {
+    std::lock_guard<std::mutex> lock(worker->m_mutex);
+
+    for (std::size_t p = 0; p < sk_numPriorities; ++p)
+    {
+      m_numQueued[p] -= worker->m_queues[p].size();
+      worker->m_queues[p].clear();
+    }
+
+    if (worker->m_running)
+    {
+      worker->m_running->cancel();
+    }
+  }
+
+  m_condition.notify_all();
+
+  for (auto& thread : m_threads)
+  {
+    if (thread.joinable())
+    {
+      thread.join();
+    }
+  }
+
+  m_threads.clear();
+
+  spdlog::debug("Shut down task scheduler");
+}
+
+std::size_t TaskScheduler::numWorkers() const
+{
+  return m_workers.size();
+}
+
+std::size_t TaskScheduler::numPendingTasks() const
+{
+  return m_numQueued[sk_interactive] + m_numQueued[sk_background] + m_numRunning;
+}
+
+void TaskScheduler::enqueue(TaskPriority priority, Job job)
+{
+  const std::size_t p = priorityIndex(priority);
+
+  if (this == t_scheduler)
+  {
+    // Tasks submitted by a worker go to its own queue
+    Worker& worker = *m_workers[t_worker];
+    std::lock_guard<std::mutex> lock(worker.m_mutex);
+    worker.m_queues[p].emplace_back(std::move(job));
+    ++m_numQueued[p];
+  }
+  else
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_stopping)
+    {
+      spdlog::warn("Dropping task submitted after the task scheduler shut down");
+      return;
+    }
+
+    m_shared[p].emplace_back(std::move(job));
+    ++m_numQueued[p];
+  }
+
+  {
+    // Synchronize with workers that checked for jobs and are about to wait
+    std::lock_guard<std::mutex> lock(m_mutex);
+  }
+
+  m_condition.notify_one();
+}
+
+bool TaskScheduler::takeJob(std::size_t worker, std::size_t priority, Job& job)
+{
+  auto take = [this, priority, &job](std::deque<Job>& queue, bool newest)
+  {
+    if (queue.empty())
+    {
+      return false;
+    }
+
+    if (newest)
+    {
+      job = std::move(queue.back());
+      queue.pop_back();
+    }
+    else
+    {
+      job = std::move(queue.front());
+      queue.pop_front();
+    }
+
+    --m_numQueued[priority];
+    return true;
+  };
+
+  // The newest job of the worker's own queue is most likely to use data still in its cache
+  {
+    Worker& own = *m_workers[worker];
+    std::lock_guard<std::mutex> lock(own.m_mutex);
+
+    if (take(own.m_queues[priority], true))
+    {
+      return true;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (take(m_shared[priority], false))
+    {
+      return true;
+    }
+  }
+
+  // Steal the oldest job of another worker
+  for (std::size_t i = 1; i < m_workers.size(); ++i)
+  {
+    Worker& victim = *m_workers[(worker + i) % m_workers.size()];
+    std::lock_guard<std::mutex> lock(victim.m_mutex);
+
+    if (take(victim.m_queues[priority], false))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool TaskScheduler::hasRunnableJob() const
+{
+  return (0 < m_numQueued[sk_interactive])
+         || (0 < m_numQueued[sk_background] && m_numRunningBackground < m_maxRunningBackground);
+}
+
+bool TaskScheduler::reserveBackgroundSlot()
+{
+  std::size_t running = m_numRunningBackground;
+
+  while (running < m_maxRunningBackground)
+  {
+    if (m_numRunningBackground.compare_exchange_weak(running, running + 1))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TaskScheduler::work(std::size_t worker)
+{
+  t_scheduler = this;
+  t_worker = worker;
+
+  Worker& self = *m_workers[worker];
+
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this]() { return m_stopping || hasRunnableJob(); });
+
+      if (m_stopping)
+      {
+        return;
+      }
+    }
+
+    Job job;
+    bool background = false;
+
+    if (!takeJob(worker, sk_interactive, job))
+    {
+      if (!reserveBackgroundSlot())
+      {
+        continue;
+      }
+
+      if (!takeJob(worker, sk_background, job))
+      {
+        --m_numRunningBackground;
+        continue;
+      }
+
+      background = true;
+    }
+
+    // A job that was cancelled before it started is dropped, which breaks its promise
+    if (!job.m_token.isCancelled())
+    {
+      {
+        std::lock_guard<std::mutex> lock(self.m_mutex);
+        self.m_running = job.m_token;
+      }
+
+      // Cancel the job if the scheduler shut down after the job was taken
+      if (m_stopping)
+      {
+        job.m_token.cancel();
+      }
+
+      t_priority = background ? TaskPriority::Background : TaskPriority::Interactive;
+
+      ++m_numRunning;
+      job.m_run(); // Exceptions thrown by the task are stored in its future
+      --m_numRunning;
+
+      std::lock_guard<std::mutex> lock(self.m_mutex);
+      self.m_running.reset();
+    }
+
+    if (background)
+    {
+      --m_numRunningBackground;
+
+      {
+        // A queued background job may now run on another worker
+        std::lock_guard<std::mutex> lock(m_mutex);
+      }
+
+      m_condition.notify_one();
+    }
+  }
+}
+
+void parallel::detail::runChunks(
+  std::size_t numChunks, const std::function<void(std::size_t chunk)>& runChunk
+)
+{
+  // Loops called by workers are run by their own scheduler, at the priority of the calling job.
+  // Loops called by other threads (e.g. the UI thread) have a user waiting on them.
+  TaskScheduler* scheduler = t_scheduler ? t_scheduler : s_defaultScheduler.load();
+  const TaskPriority priority = t_scheduler ? t_priority : TaskPriority::Interactive;
+
+  auto chunks = std::make_shared<LoopChunks>();
+  chunks->m_runChunk = &runChunk;
+  chunks->m_numChunks = numChunks;
+
+  if (scheduler)
+  {
+    // Subtasks that start after the loop returns find no chunks left and do not call runChunk
+    for (std::size_t c = 1; c < numChunks; ++c)
+    {
+      scheduler->submit(priority, [chunks](const TaskToken&) { runAvailableChunks(*chunks); });
+    }
+  }
+
+  runAvailableChunks(*chunks);
+
+  std::unique_lock<std::mutex> lock(chunks->m_mutex);
+  chunks->m_condition.wait(
+    lock, [&chunks]() { return chunks->m_numChunks == chunks->m_numDone; }
+  );
+}
@@ -0,0 +1,176 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include "common/AsyncTasks.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Token shared by a task and its submitter, through which the task is cancelled and
+ * reports its progress. Copies of a token share its state.
+ *
+ * Cancellation is cooperative: a task that has started must poll \c isCancelled() and return
+ * early. A task that is cancelled before it starts is not run.
+ */
+class TaskToken
+{
+public:
+  TaskToken();
+
+  /// Request cancellation of the task
+  void cancel() const;
+
+  /// Has cancellation of the task been requested?
+  bool isCancelled() const;
+
+  /// Set the fraction of the task that is done, in [0, 1]
+  void setProgress(float fraction) const;
+
+  /// Get the fraction of the task that is done, in [0, 1]
+  float progress() const;
+
+private:
+  struct State
+  {
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<float> m_progress{0.0f};
+  };
+
+  std::shared_ptr<State> m_state;
+};
+
+/**
+ * @brief Work-stealing scheduler of the application's long-running tasks, with one worker thread
+ * per hardware thread.
+ *
+ * Each worker has its own queues of tasks. Tasks submitted by a worker are pushed onto its own
+ * queues, which it pops from the back; tasks submitted by other threads are pushed onto shared
+ * queues. An idle worker takes tasks from its own queues, then from the shared queues, then
+ * steals from the front of the other workers' queues.
+ *
+ * Interactive tasks are always taken before background tasks. Background tasks run on at most all
+ * but one of the workers, so that an interactive task never waits behind background tasks.
+ *
+ * The chunks of data-parallel loops (parallel::forEachChunk) are subtasks of the scheduler: a loop
+ * called by a task runs at the priority of the task, and the first scheduler constructed runs the
+ * loops of threads that are not workers.
+ */
+class TaskScheduler
+{
+public:
+  /// @param[in] numWorkers Number of worker threads (0 means one per hardware thread)
+  explicit TaskScheduler(std::size_t numWorkers = 0);
+
+  /// Calls shutdown()
+  ~TaskScheduler();
+
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  /**
+   * @brief Submit a task
+   *
+   * @param[in] priority Task priority
+   * @param[in] fn Task function with signature R(const TaskToken&)
+   * @param[in] token Token through which the task is cancelled and reports progress
+   *
+   * @return Future of the result of the task. If the task is cancelled before it starts or the
+   * scheduler shuts down before it runs, then the future holds a broken promise error.
+   */
+  template<class Fn>
+  std::future<std::invoke_result_t<Fn&, const TaskToken&> > submit(
+    TaskPriority priority, Fn&& fn, TaskToken token = TaskToken()
+  )
+  {
+    using R = std::invoke_result_t<Fn&, const TaskToken&>;
+
+    auto task = std::make_shared<std::packaged_task<R()> >(
+      [fn = std::forward<Fn>(fn), token]() mutable { return fn(token); }
+    );
+
+    std::future<R> future = task->get_future();
+    enqueue(priority, Job{[task]() { (*task)(); }, std::move(token)});
+    return future;
+  }
+
+  /// @brief Submit a task with the priority of its type of asynchronous task
+  /// @see submit(TaskPriority, Fn&&, TaskToken)
+  template<class Fn>
+  std::future<std::invoke_result_t<Fn&, const TaskToken&> > submit(
+    AsyncTasks taskType, Fn&& fn, TaskToken token = TaskToken()
+  )
+  {
+    return submit(taskPriority(taskType), std::forward<Fn>(fn), std::move(token));
+  }
+
+  /// Cancel the running tasks, drop the queued tasks, and join the workers. Tasks submitted after
+  /// shutdown are dropped.
+  void shutdown();
+
+  /// Number of worker threads
+  std::size_t numWorkers() const;
+
+  /// Number of tasks that are queued or running
+  std::size_t numPendingTasks() const;
+
+private:
+  static constexpr std::size_t sk_numPriorities = 2;
+
+  /// Queued task
+  struct Job
+  {
+    std::function<void()> m_run; //!< Runs the task and sets its future
+    TaskToken m_token;           //!< Token of the task
+  };
+
+  /// Queues of a worker, one per priority, and the token of its running task
+  struct Worker
+  {
+    std::mutex m_mutex; //!< Guards the queues and the running token
+    std::deque<Job> m_queues[sk_numPriorities]; //!< Jobs submitted by the worker, per priority
+    std::optional<TaskToken> m_running;          //!< Token of the running job
+  };
+
+  void enqueue(TaskPriority priority, Job job);
+
+  /// Take a job of a priority for a worker: from its own queue, then the shared queue, then by
+  /// stealing from another worker
+  bool takeJob(std::size_t worker, std::size_t priority, Job& job);
+
+  /// Can a worker take a job? The shared mutex must be locked.
+  bool hasRunnableJob() const;
+
+  /// Reserve a slot for running a background job
+  /// @return True iff fewer than the maximum number of background jobs were running
+  bool reserveBackgroundSlot();
+
+  /// Worker thread loop
+  void work(std::size_t worker);
+
+  std::vector<std::unique_ptr<Worker> > m_workers;
+  std::vector<std::thread> m_threads;
+
+  mutable std::mutex m_mutex;          //!< Guards the shared queues and sleeping of the workers
+  std::condition_variable m_condition; //!< Signals the workers that jobs are queued
+  std::deque<Job> m_shared[sk_numPriorities]; //!< Jobs submitted by threads that are not workers
+  std::atomic<bool> m_stopping;               //!< Set when the scheduler shuts down
+
+  std::atomic<std::size_t> m_numQueued[sk_numPriorities]; //!< Number of queued jobs per priority
+  std::atomic<std::size_t> m_numRunningBackground; //!< Number of running background jobs
+  std::atomic<std::size_t> m_numRunning;           //!< Number of running jobs
+  std::size_t m_maxRunningBackground; //!< Maximum number of concurrently running background jobs
+};
+
+#endif // TASK_SCHEDULER_H
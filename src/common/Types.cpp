@@ -146,6 +146,9 @@ std::string typeString(const MouseMode& mouseMode)
      "Zoom view (Z)\nLeft button: zoom to crosshairs\nRight button: zoom to cursor"},
     {MouseMode::Segment,
      "Segment (B)\nLeft button: paint foreground label\nRight button: paint background label"},
+    {MouseMode::RegionGrow,
+     "Region grow (G)\nLeft button: fill region with foreground label\nRight button: fill region "
+     "with background label"},
     {MouseMode::Annotate, "Annotate"},
     {MouseMode::ImageTranslate,
      "Translate image (T)\nLeft button: translate in plane\nRight button: translate out of plane"},
@@ -197,6 +200,7 @@ const char* toolbarButtonIcon(const MouseMode& mouseMode)
   static const std::unordered_map<MouseMode, const char*> s_typeToIconMap{
     {MouseMode::Pointer, ICON_FK_MOUSE_POINTER},
     {MouseMode::Segment, ICON_FK_PAINT_BRUSH},
+    {MouseMode::RegionGrow, ICON_FK_MAGIC},
     {MouseMode::Annotate, ICON_FK_PENCIL},
     {MouseMode::WindowLevel, ICON_FK_ADJUST},
     {MouseMode::CameraTranslate, ICON_FK_HAND_PAPER_O},
@@ -120,6 +120,7 @@ enum class MouseMode
   Pointer,         //!< Move the crosshairs
   WindowLevel,     //!< Adjust window and level of the active image
   Segment,         //!< Segment the active image
+  RegionGrow,      //!< Segment the active image by growing a region from a seed voxel
   Annotate,        //!< Annotate the active image
   CameraTranslate, //!< Translate the view camera in plane
   CameraRotate,    //!< Rotate the view camera in plane and out of plane
@@ -132,13 +133,14 @@ enum class MouseMode
 /**
  * @brief Array of all available mouse modes in the Toolbar
  */
-inline std::array<MouseMode, 9> const AllMouseModes = {
+inline std::array<MouseMode, 10> const AllMouseModes = {
   MouseMode::Pointer,
   MouseMode::WindowLevel,
   MouseMode::CameraTranslate,
   MouseMode::CameraRotate,
   MouseMode::CameraZoom,
   MouseMode::Segment,
+  MouseMode::RegionGrow,
   MouseMode::Annotate,
   MouseMode::ImageTranslate,
   MouseMode::ImageRotate
@@ -0,0 +1,122 @@
+#ifndef COMPONENT_DISPATCH_H
+#define COMPONENT_DISPATCH_H
+
+#include "common/Types.h"
+#include "image/Image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief Call a function with a null pointer of the type of a segmentation component
+ * @return False iff the component type is not valid for a segmentation
+ */
+template<typename Func>
+bool dispatchSegComponentType(const ComponentType& compType, Func&& func)
+{
+  switch (compType)
+  {
+  case ComponentType::UInt8:
+    func(static_cast<uint8_t*>(nullptr));
+    return true;
+  case ComponentType::UInt16:
+    func(static_cast<uint16_t*>(nullptr));
+    return true;
+  case ComponentType::UInt32:
+    func(static_cast<uint32_t*>(nullptr));
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Call a function with a null pointer of the type of an image component
+ * @return False iff the component type is not valid for an image
+ */
+template<typename Func>
+bool dispatchImageComponentType(const ComponentType& compType, Func&& func)
+{
+  switch (compType)
+  {
+  case ComponentType::Int8:
+    func(static_cast<int8_t*>(nullptr));
+    return true;
+  case ComponentType::UInt8:
+    func(static_cast<uint8_t*>(nullptr));
+    return true;
+  case ComponentType::Int16:
+    func(static_cast<int16_t*>(nullptr));
+    return true;
+  case ComponentType::UInt16:
+    func(static_cast<uint16_t*>(nullptr));
+    return true;
+  case ComponentType::Int32:
+    func(static_cast<int32_t*>(nullptr));
+    return true;
+  case ComponentType::UInt32:
+    func(static_cast<uint32_t*>(nullptr));
+    return true;
+  case ComponentType::Float32:
+    func(static_cast<float*>(nullptr));
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Values of one image component in the image buffer
+struct ComponentBuffer
+{
+  const void* m_data = nullptr; //!< Value of the component at the first voxel
+  std::size_t m_stride = 1;     //!< Number of values between consecutive voxels
+};
+
+/**
+ * @brief Get the values of one component of an image. The components of an interleaved image
+ * share one buffer, so the values of a component are strided in it.
+ * @note The data is null if the image has no buffer for the component.
+ */
+inline ComponentBuffer componentBuffer(const Image& image, uint32_t component)
+{
+  const bool interleaved
+    = (Image::MultiComponentBufferType::InterleavedImage == image.bufferType());
+
+  ComponentBuffer buffer;
+
+  if (interleaved)
+  {
+    const uint8_t* data = static_cast<const uint8_t*>(image.bufferAsVoid(0));
+    buffer.m_stride = image.header().numComponentsPerPixel();
+    buffer.m_data = data ? data + component * image.header().memoryComponentSizeInBytes() : nullptr;
+  }
+  else
+  {
+    buffer.m_data = image.bufferAsVoid(component);
+  }
+
+  return buffer;
+}
+
+/**
+ * @brief Call a function with the values of an image component, cast to the component type,
+ * and the number of values between consecutive voxels
+ * @return False iff the component type is not valid for an image
+ */
+template<typename Func>
+bool visitComponentBuffer(const Image& image, uint32_t component, Func&& func)
+{
+  const ComponentBuffer buffer = componentBuffer(image, component);
+
+  return dispatchImageComponentType(
+    image.header().memoryComponentType(),
+    [&buffer, &func](auto* typeTag)
+    {
+      using T = std::remove_pointer_t<decltype(typeTag)>;
+      func(static_cast<const T*>(buffer.m_data), buffer.m_stride);
+    }
+  );
+}
+
+#endif // COMPONENT_DISPATCH_H
@@ -0,0 +1,141 @@
+#include "image/ComponentFloatView.h"
+#include "image/ComponentDispatch.h"
+#include "image/Image.h"
+
+#include "common/ParallelFor.h"
+
+#include <spdlog/spdlog.h>
+
+#include <exception>
+
+namespace
+{
+/// Minimum number of voxels converted to float by a thread
+constexpr std::size_t sk_minVoxelsPerChunk = std::size_t{1} << 20;
+
+using FloatItkImage = ComponentFloatView::ItkImageType;
+
+/// Create an ITK image with the geometry of an image. Its buffer is not allocated.
+FloatItkImage::Pointer createItkImage(const ImageHeader& header)
+{
+  FloatItkImage::IndexType start;
+  FloatItkImage::SizeType size;
+  FloatItkImage::PointType origin;
+  FloatItkImage::SpacingType spacing;
+  FloatItkImage::DirectionType direction;
+
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    const int ii = static_cast<int>(i);
+    start[i] = 0;
+    size[i] = header.pixelDimensions()[ii];
+    origin[i] = static_cast<double>(header.origin()[ii]);
+    spacing[i] = static_cast<double>(header.spacing()[ii]);
+
+    for (uint32_t j = 0; j < 3; ++j)
+    {
+      // Column j of the direction matrix is the direction of axis j
+      direction[i][j] = static_cast<double>(header.directions()[static_cast<int>(j)][ii]);
+    }
+  }
+
+  FloatItkImage::Pointer image = FloatItkImage::New();
+  image->SetRegions(FloatItkImage::RegionType(start, size));
+  image->SetOrigin(origin);
+  image->SetSpacing(spacing);
+  image->SetDirection(direction);
+  return image;
+}
+
+/// Convert one image component, which may be interleaved with the other components, to float
+template<typename T>
+void convertToFloat(const T* data, std::size_t stride, std::size_t numPixels, float* out)
+{
+  parallel::forEachChunk(
+    numPixels,
+    sk_minVoxelsPerChunk,
+    [data, stride, out](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+    {
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        out[i] = static_cast<float>(data[i * stride]);
+      }
+    }
+  );
+}
+
+} // namespace
+
+std::optional<ComponentFloatView> createComponentFloatView(const Image& image, uint32_t component)
+{
+  const ImageHeader& header = image.header();
+  const uint32_t numComps = header.numComponentsPerPixel();
+
+  if (numComps <= component)
+  {
+    spdlog::error(
+      "Invalid image component {} to view as float; image has only {} components",
+      component,
+      numComps
+    );
+    return std::nullopt;
+  }
+
+  const ComponentBuffer buffer = componentBuffer(image, component);
+  const std::size_t numPixels = header.numPixels();
+
+  if (!buffer.m_data)
+  {
+    spdlog::error("Null buffer for image component {} to view as float", component);
+    return std::nullopt;
+  }
+
+  ComponentFloatView view;
+
+  try
+  {
+    view.m_itkImage = createItkImage(header);
+
+    if (ComponentType::Float32 == header.memoryComponentType() && 1 == buffer.m_stride)
+    {
+      // Alias the Image buffer. The ITK image does not free it.
+      static constexpr bool sk_containerDoesNotOwnVoxels = false;
+
+      view.m_itkImage->GetPixelContainer()->SetImportPointer(
+        const_cast<float*>(static_cast<const float*>(buffer.m_data)),
+        numPixels,
+        sk_containerDoesNotOwnVoxels
+      );
+      view.m_aliasesImage = true;
+    }
+    else
+    {
+      view.m_itkImage->Allocate();
+      view.m_numBytes = numPixels * sizeof(float);
+
+      float* out = view.m_itkImage->GetBufferPointer();
+
+      const bool valid = visitComponentBuffer(
+        image,
+        component,
+        [&](const auto* data, std::size_t stride) { convertToFloat(data, stride, numPixels, out); }
+      );
+
+      if (!valid)
+      {
+        spdlog::error(
+          "Invalid component type '{}' to view as float",
+          componentTypeString(header.memoryComponentType())
+        );
+        return std::nullopt;
+      }
+    }
+  }
+  catch (const std::exception& e)
+  {
+    spdlog::error("Exception creating float view of image component {}: {}", component, e.what());
+    return std::nullopt;
+  }
+
+  return view;
+}
@@ -0,0 +1,39 @@
+#ifndef COMPONENT_FLOAT_VIEW_H
+#define COMPONENT_FLOAT_VIEW_H
+
+#include <itkImage.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+class Image;
+
+/**
+ * @brief Float ITK view of an image component, used as the input of ITK filters that run on
+ * components (e.g. noise estimates and distance maps).
+ *
+ * If the component is non-interleaved Float32, then the view aliases the Image buffer and nothing
+ * is copied. Otherwise, the component is converted to float in parallel.
+ */
+struct ComponentFloatView
+{
+  using ItkImageType = itk::Image<float, 3>;
+
+  ItkImageType::Pointer m_itkImage; //!< ITK image of the component
+  bool m_aliasesImage = false;      //!< Does the view alias the Image buffer?
+  std::size_t m_numBytes = 0;       //!< Number of bytes owned by the view
+};
+
+/**
+ * @brief Create the float view of an image component
+ *
+ * @param[in] image Image. A view that aliases its buffer must not outlive it, and the image must
+ * not be written while the view is created.
+ * @param[in] component Image component
+ *
+ * @return View, or std::nullopt if the view could not be created
+ */
+std::optional<ComponentFloatView> createComponentFloatView(const Image& image, uint32_t component);
+
+#endif // COMPONENT_FLOAT_VIEW_H
@@ -0,0 +1,314 @@
+#ifndef COMPONENT_STATISTICS_TPP
+#define COMPONENT_STATISTICS_TPP
+
+#include "common/HistogramSettings.h"
+#include "common/ParallelFor.h"
+#include "common/Types.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace component_stats_detail
+{
+
+/// Minimum number of component values processed by a thread
+static constexpr std::size_t MIN_CHUNK_SIZE = (std::size_t{1} << 18);
+
+/// Number of values in a block. The moments of a block are computed exactly with two passes
+/// over the block while it is resident in cache, then merged into the moments of its chunk.
+static constexpr std::size_t BLOCK_SIZE = (std::size_t{1} << 14);
+
+/**
+ * @brief Count, extrema, mean, and sum of squared deviations from the mean of a set of values.
+ * Moments of disjoint sets are combined with the pairwise update of Chan, Golub, and LeVeque,
+ * which is numerically stable and does not depend on the order in which sets are merged.
+ */
+struct Moments
+{
+  uint64_t m_count = 0;
+  double m_min = std::numeric_limits<double>::max();
+  double m_max = std::numeric_limits<double>::lowest();
+  double m_mean = 0.0;
+  double m_M2 = 0.0;
+
+  void merge(const Moments& other)
+  {
+    if (0 == other.m_count)
+    {
+      return;
+    }
+
+    if (0 == m_count)
+    {
+      *this = other;
+      return;
+    }
+
+    const double nA = static_cast<double>(m_count);
+    const double nB = static_cast<double>(other.m_count);
+    const double n = nA + nB;
+    const double delta = other.m_mean - m_mean;
+
+    m_mean += delta * (nB / n);
+    m_M2 += other.m_M2 + delta * delta * (nA * nB / n);
+    m_count += other.m_count;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+  }
+};
+
+/// Compute the moments of the values [begin, end) of a strided buffer, block by block
+template<typename T>
+Moments computeMoments(const T* data, std::size_t begin, std::size_t end, std::size_t stride)
+{
+  Moments moments;
+
+  for (std::size_t blockBegin = begin; blockBegin < end; blockBegin += BLOCK_SIZE)
+  {
+    const std::size_t blockEnd = std::min(blockBegin + BLOCK_SIZE, end);
+
+    Moments block;
+    double sum = 0.0;
+
+    for (std::size_t i = blockBegin; i < blockEnd; ++i)
+    {
+      const double v = static_cast<double>(data[i * stride]);
+
+      if constexpr (std::is_floating_point_v<T>)
+      {
+        if (std::isnan(v))
+        {
+          continue;
+        }
+      }
+
+      sum += v;
+      block.m_min = std::min(block.m_min, v);
+      block.m_max = std::max(block.m_max, v);
+      ++block.m_count;
+    }
+
+    if (0 == block.m_count)
+    {
+      continue;
+    }
+
+    block.m_mean = sum / static_cast<double>(block.m_count);
+
+    for (std::size_t i = blockBegin; i < blockEnd; ++i)
+    {
+      const double v = static_cast<double>(data[i * stride]);
+
+      if constexpr (std::is_floating_point_v<T>)
+      {
+        if (std::isnan(v))
+        {
+          continue;
+        }
+      }
+
+      const double diff = v - block.m_mean;
+      block.m_M2 += diff * diff;
+    }
+
+    moments.merge(block);
+  }
+
+  return moments;
+}
+
+} // namespace component_stats_detail
+
+/**
+ * @brief Compute the statistics of one image component directly from its (unsorted) buffer.
+ *
+ * The minimum, maximum, sum, mean, and variance are computed in one multi-threaded pass over
+ * the buffer, without allocating memory proportional to the number of values. The buffer is
+ * split into chunks processed concurrently; the moments of the chunks are merged pairwise.
+ * The 101 percentiles are provided by \c quantileToValue, which is typically backed by the
+ * quantile index of the component.
+ *
+ * @tparam T Component type
+ * @param[in] data Pointer to the first value of the component
+ * @param[in] numElements Number of values in the component
+ * @param[in] stride Distance between consecutive values of the component in the buffer
+ * @param[in] quantileToValue Function that converts a quantile in [0, 1] to a component value
+ *
+ * @note NaN values of floating-point components are excluded from the statistics.
+ */
+template<typename T, class QuantileToValueFn>
+ComponentStats computeComponentStatistics(
+  const T* data, std::size_t numElements, std::size_t stride, QuantileToValueFn quantileToValue
+)
+{
+  using namespace component_stats_detail;
+
+  ComponentStats stats;
+
+  if (!data || 0 == numElements)
+  {
+    return stats;
+  }
+
+  std::vector<Moments> chunkMoments(parallel::numChunks(numElements, MIN_CHUNK_SIZE));
+
+  parallel::forEachChunk(
+    numElements,
+    MIN_CHUNK_SIZE,
+    [&](std::size_t chunk, std::size_t begin, std::size_t end)
+    { chunkMoments[chunk] = computeMoments(data, begin, end, stride); }
+  );
+
+  Moments moments;
+  for (const Moments& m : chunkMoments)
+  {
+    moments.merge(m);
+  }
+
+  if (0 == moments.m_count)
+  {
+    return stats;
+  }
+
+  const double N = static_cast<double>(moments.m_count);
+
+  stats.m_minimum = moments.m_min;
+  stats.m_maximum = moments.m_max;
+  stats.m_mean = moments.m_mean;
+  stats.m_sum = moments.m_mean * N;
+  stats.m_variance = moments.m_M2 / N;
+  stats.m_stdDeviation = std::sqrt(stats.m_variance);
+
+  for (std::size_t i = 0; i <= 100; ++i)
+  {
+    stats.m_quantiles[i] = quantileToValue(static_cast<double>(i) / 100.0);
+  }
+
+  return stats;
+}
+
+/**
+ * @brief Compute the histogram of one image component directly from its (unsorted) buffer.
+ *
+ * Values are binned as by ImPlot's histogram: the range [rangeMin, rangeMax] is split into
+ * \c numBins bins of equal width and the last bin includes rangeMax. The buffer is split into
+ * chunks that are binned concurrently into separate counts, which are then summed.
+ *
+ * @tparam T Component type
+ * @param[in] data Pointer to the first value of the component
+ * @param[in] numElements Number of values in the component
+ * @param[in] stride Distance between consecutive values of the component in the buffer
+ * @param[in] numBins Number of bins
+ * @param[in] rangeMin Minimum intensity of the histogram
+ * @param[in] rangeMax Maximum intensity of the histogram
+ *
+ * @note NaN values of floating-point components are excluded from the histogram.
+ */
+template<typename T>
+HistogramCache computeComponentHistogram(
+  const T* data,
+  std::size_t numElements,
+  std::size_t stride,
+  int numBins,
+  double rangeMin,
+  double rangeMax
+)
+{
+  using namespace component_stats_detail;
+
+  HistogramCache hist;
+  hist.m_isValid = true;
+  hist.m_numBins = numBins;
+  hist.m_range = {rangeMin, rangeMax};
+
+  if (!data || 0 == numElements || numBins <= 0)
+  {
+    return hist;
+  }
+
+  const std::size_t B = static_cast<std::size_t>(numBins);
+  const double binWidth = (rangeMax - rangeMin) / static_cast<double>(numBins);
+
+  hist.m_binCenters.resize(B);
+  for (std::size_t b = 0; b < B; ++b)
+  {
+    hist.m_binCenters[b] = rangeMin + (static_cast<double>(b) + 0.5) * binWidth;
+  }
+
+  /// Counts of a chunk
+  struct ChunkCounts
+  {
+    std::vector<uint64_t> m_binCounts;
+    uint64_t m_numValues = 0;
+    uint64_t m_numBelowRange = 0;
+  };
+
+  std::vector<ChunkCounts> chunkCounts(parallel::numChunks(numElements, MIN_CHUNK_SIZE));
+
+  parallel::forEachChunk(
+    numElements,
+    MIN_CHUNK_SIZE,
+    [&](std::size_t chunk, std::size_t begin, std::size_t end)
+    {
+      ChunkCounts& counts = chunkCounts[chunk];
+      counts.m_binCounts.assign(B, 0);
+
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        const double v = static_cast<double>(data[i * stride]);
+
+        if constexpr (std::is_floating_point_v<T>)
+        {
+          if (std::isnan(v))
+          {
+            continue;
+          }
+        }
+
+        ++counts.m_numValues;
+
+        if (v < rangeMin)
+        {
+          ++counts.m_numBelowRange;
+          continue;
+        }
+
+        if (v > rangeMax)
+        {
+          continue;
+        }
+
+        // All values fall in the first bin if the range is empty
+        std::size_t b = 0;
+
+        if (binWidth > 0.0)
+        {
+          b = std::min(static_cast<std::size_t>((v - rangeMin) / binWidth), B - 1);
+        }
+
+        ++counts.m_binCounts[b];
+      }
+    }
+  );
+
+  hist.m_binCounts.assign(B, 0.0);
+
+  for (const ChunkCounts& counts : chunkCounts)
+  {
+    for (std::size_t b = 0; b < B; ++b)
+    {
+      hist.m_binCounts[b] += static_cast<double>(counts.m_binCounts[b]);
+    }
+
+    hist.m_numValues += counts.m_numValues;
+    hist.m_numBelowRange += counts.m_numBelowRange;
+  }
+
+  return hist;
+}
+
+#endif // COMPONENT_STATISTICS_TPP
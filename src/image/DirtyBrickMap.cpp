@@ -0,0 +1,214 @@
+#include "image/DirtyBrickMap.h"
+
+#include <glm/common.hpp>
+
+#include <algorithm>
+
+namespace
+{
+uint32_t numBricks(uint32_t numVoxels)
+{
+  return (numVoxels + DirtyBrickMap::sk_brickSize - 1) / DirtyBrickMap::sk_brickSize;
+}
+} // namespace
+
+DirtyBrickMap::DirtyBrickMap(const glm::uvec3& dims, std::size_t bytesPerVoxel)
+  : m_dims(dims)
+  , m_gridDims(numBricks(dims.x), numBricks(dims.y), numBricks(dims.z))
+  , m_bytesPerVoxel(bytesPerVoxel)
+  , m_dirty(static_cast<std::size_t>(m_gridDims.x) * m_gridDims.y * m_gridDims.z, 0)
+  , m_numDirtyBricks(0)
+{
+}
+
+bool DirtyBrickMap::isTracking() const
+{
+  return !m_dirty.empty();
+}
+
+std::size_t DirtyBrickMap::numDirtyBricks() const
+{
+  return m_numDirtyBricks;
+}
+
+void DirtyBrickMap::markRow(uint32_t y, uint32_t z, uint32_t xBegin, uint32_t xEnd)
+{
+  if (m_dirty.empty() || xBegin >= xEnd)
+  {
+    return;
+  }
+
+  const uint32_t by = y / sk_brickSize;
+  const uint32_t bz = z / sk_brickSize;
+
+  for (uint32_t bx = xBegin / sk_brickSize; bx <= (xEnd - 1) / sk_brickSize; ++bx)
+  {
+    uint8_t& flag = m_dirty[brickIndex(bx, by, bz)];
+
+    if (!flag)
+    {
+      flag = 1;
+      ++m_numDirtyBricks;
+    }
+  }
+}
+
+void DirtyBrickMap::markBlock(const glm::uvec3& offset, const glm::uvec3& size)
+{
+  if (m_dirty.empty())
+  {
+    return;
+  }
+
+  const glm::uvec3 end = glm::min(offset + size, m_dims);
+
+  if (offset.x >= end.x || offset.y >= end.y || offset.z >= end.z)
+  {
+    return;
+  }
+
+  const glm::uvec3 brickBegin = offset / sk_brickSize;
+  const glm::uvec3 brickEnd = (end - 1u) / sk_brickSize + 1u;
+
+  for (uint32_t bz = brickBegin.z; bz < brickEnd.z; ++bz)
+  {
+    for (uint32_t by = brickBegin.y; by < brickEnd.y; ++by)
+    {
+      for (uint32_t bx = brickBegin.x; bx < brickEnd.x; ++bx)
+      {
+        uint8_t& flag = m_dirty[brickIndex(bx, by, bz)];
+
+        if (!flag)
+        {
+          flag = 1;
+          ++m_numDirtyBricks;
+        }
+      }
+    }
+  }
+}
+
+void DirtyBrickMap::markAll()
+{
+  std::fill(std::begin(m_dirty), std::end(m_dirty), 1);
+  m_numDirtyBricks = m_dirty.size();
+}
+
+void DirtyBrickMap::clear()
+{
+  std::fill(std::begin(m_dirty), std::end(m_dirty), 0);
+  m_numDirtyBricks = 0;
+}
+
+DirtyBrickMap::UploadPlan DirtyBrickMap::takeUploadPlan()
+{
+  UploadPlan plan;
+  plan.m_numDirtyBricks = m_numDirtyBricks;
+
+  if (0 == m_numDirtyBricks)
+  {
+    return plan;
+  }
+
+  if (static_cast<float>(m_numDirtyBricks)
+      >= sk_wholeImageFraction * static_cast<float>(m_dirty.size()))
+  {
+    plan.m_boxes.push_back(Box{glm::uvec3{0u}, m_dims});
+    plan.m_numBytes = numBytes(plan.m_boxes.back());
+    clear();
+    return plan;
+  }
+
+  auto isDirty = [this](uint32_t bx, uint32_t by, uint32_t bz)
+  { return 0 != m_dirty[brickIndex(bx, by, bz)]; };
+
+  // Bricks are cleared as they are added to boxes, so each brick is in exactly one box
+  for (uint32_t bz = 0; bz < m_gridDims.z; ++bz)
+  {
+    for (uint32_t by = 0; by < m_gridDims.y; ++by)
+    {
+      for (uint32_t bx = 0; bx < m_gridDims.x; ++bx)
+      {
+        if (!isDirty(bx, by, bz))
+        {
+          continue;
+        }
+
+        // Grow the box along x:
+        uint32_t ex = bx + 1;
+        while (ex < m_gridDims.x && isDirty(ex, by, bz))
+        {
+          ++ex;
+        }
+
+        // Grow the box along y while whole rows of it are dirty:
+        auto rowIsDirty = [&](uint32_t y, uint32_t z)
+        {
+          for (uint32_t x = bx; x < ex; ++x)
+          {
+            if (!isDirty(x, y, z))
+              return false;
+          }
+          return true;
+        };
+
+        uint32_t ey = by + 1;
+        while (ey < m_gridDims.y && rowIsDirty(ey, bz))
+        {
+          ++ey;
+        }
+
+        // Grow the box along z while whole slabs of it are dirty:
+        auto slabIsDirty = [&](uint32_t z)
+        {
+          for (uint32_t y = by; y < ey; ++y)
+          {
+            if (!rowIsDirty(y, z))
+              return false;
+          }
+          return true;
+        };
+
+        uint32_t ez = bz + 1;
+        while (ez < m_gridDims.z && slabIsDirty(ez))
+        {
+          ++ez;
+        }
+
+        for (uint32_t z = bz; z < ez; ++z)
+        {
+          for (uint32_t y = by; y < ey; ++y)
+          {
+            std::fill_n(m_dirty.begin() + brickIndex(bx, y, z), ex - bx, 0);
+          }
+        }
+
+        const glm::uvec3 begin = glm::uvec3{bx, by, bz} * sk_brickSize;
+        const glm::uvec3 end = glm::min(glm::uvec3{ex, ey, ez} * sk_brickSize, m_dims);
+
+        plan.m_boxes.push_back(Box{begin, end - begin});
+        plan.m_numBytes += numBytes(plan.m_boxes.back());
+      }
+    }
+  }
+
+  m_numDirtyBricks = 0;
+  return plan;
+}
+
+void DirtyBrickMap::UploadStats::add(const UploadPlan& plan)
+{
+  if (0 == plan.m_numDirtyBricks)
+  {
+    return;
+  }
+
+  ++m_numMaps;
+  m_numBoxes += plan.m_boxes.size();
+  m_numBytes += plan.m_numBytes;
+}
+
+std::size_t DirtyBrickMap::numBytes(const Box& box) const
+{
+  return static_cast<std::size_t>(box.m_size.x) * box.m_size.y * box.m_size.z * m_bytesPerVoxel;
+}
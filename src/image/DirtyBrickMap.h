@@ -0,0 +1,125 @@
+#ifndef DIRTY_BRICK_MAP_H
+#define DIRTY_BRICK_MAP_H
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Bitmap of the bricks of an image whose voxels changed since its texture was last updated.
+ *
+ * The image is divided into bricks of 16^3 voxels. Writers of the image mark the voxels that they
+ * change. Once per frame, the dirty bricks are coalesced into boxes of voxels to upload to the
+ * texture, which clears the map. The map does not depend on OpenGL.
+ *
+ * @note Marking is not thread-safe: like the image buffers, the map must only be written by
+ * one thread at a time.
+ */
+class DirtyBrickMap
+{
+public:
+  /// Side length of the bricks, in voxels
+  static constexpr uint32_t sk_brickSize = 16;
+
+  /// If at least this fraction of the bricks is dirty, the whole image is uploaded as one box
+  static constexpr float sk_wholeImageFraction = 0.5f;
+
+  /// Box of voxels
+  struct Box
+  {
+    glm::uvec3 m_offset{0u}; //!< Offset of the box, in voxels
+    glm::uvec3 m_size{0u};   //!< Size of the box, in voxels
+  };
+
+  /// Boxes of voxels to upload to the texture, with counters of the transfer
+  struct UploadPlan
+  {
+    std::vector<Box> m_boxes;         //!< Boxes to upload, which cover all dirty bricks
+    std::size_t m_numDirtyBricks = 0; //!< Number of dirty bricks
+    std::size_t m_numBytes = 0;       //!< Number of bytes uploaded by the boxes
+  };
+
+  /// Counters of the uploads of the plans of one or more maps
+  struct UploadStats
+  {
+    std::size_t m_numMaps = 0;  //!< Number of maps with dirty bricks
+    std::size_t m_numBoxes = 0; //!< Number of boxes uploaded
+    std::size_t m_numBytes = 0; //!< Number of bytes uploaded
+
+    /// Count the upload of a plan
+    void add(const UploadPlan& plan);
+  };
+
+  /// Construct a map that tracks nothing
+  DirtyBrickMap() = default;
+
+  /**
+   * @param[in] dims Image dimensions, in voxels
+   * @param[in] bytesPerVoxel Number of bytes per voxel in the texture
+   */
+  DirtyBrickMap(const glm::uvec3& dims, std::size_t bytesPerVoxel);
+
+  /// Does the map track an image?
+  bool isTracking() const;
+
+  /// Number of dirty bricks
+  std::size_t numDirtyBricks() const;
+
+  /// Mark the voxel (i, j, k), which must be inside of the image
+  void markVoxel(uint32_t i, uint32_t j, uint32_t k)
+  {
+    if (m_dirty.empty())
+    {
+      return;
+    }
+
+    const std::size_t b = brickIndex(i / sk_brickSize, j / sk_brickSize, k / sk_brickSize);
+
+    if (!m_dirty[b])
+    {
+      m_dirty[b] = 1;
+      ++m_numDirtyBricks;
+    }
+  }
+
+  /// Mark the voxels [xBegin, xEnd) of the row (y, z), which must be inside of the image
+  void markRow(uint32_t y, uint32_t z, uint32_t xBegin, uint32_t xEnd);
+
+  /// Mark a block of voxels. The block is clamped to the image.
+  void markBlock(const glm::uvec3& offset, const glm::uvec3& size);
+
+  /// Mark all voxels
+  void markAll();
+
+  /// Clear all marks
+  void clear();
+
+  /**
+   * @brief Coalesce the dirty bricks into boxes of voxels to upload and clear the map.
+   *
+   * Runs of dirty bricks are grown greedily along x, then y, then z into boxes that only cover
+   * dirty bricks. If at least \c sk_wholeImageFraction of the bricks is dirty, a single box
+   * covering the image is returned instead.
+   */
+  UploadPlan takeUploadPlan();
+
+private:
+  std::size_t brickIndex(uint32_t bx, uint32_t by, uint32_t bz) const
+  {
+    return (static_cast<std::size_t>(bz) * m_gridDims.y + by) * m_gridDims.x + bx;
+  }
+
+  /// Number of bytes of a box of voxels
+  std::size_t numBytes(const Box& box) const;
+
+  glm::uvec3 m_dims{0u};     //!< Image dimensions, in voxels
+  glm::uvec3 m_gridDims{0u}; //!< Dimensions of the brick grid
+  std::size_t m_bytesPerVoxel = 0;
+
+  std::vector<uint8_t> m_dirty;     //!< Flag of each brick, set iff the brick is dirty
+  std::size_t m_numDirtyBricks = 0; //!< Number of set flags
+};
+
+#endif // DIRTY_BRICK_MAP_H
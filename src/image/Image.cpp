@@ -2,6 +2,9 @@
 #include "image/ImageCastHelper.tpp"
 #include "image/ImageUtility.h"
 #include "image/ImageUtility.tpp"
+#include "image/QuantileIndex.tpp"
+
+#include "common/ParallelFor.h"
 
 // clang-format off
 #include <spdlog/spdlog.h>
@@ -10,17 +13,261 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <system_error>
 
 namespace
 {
 // Maximum number of components to load for images with interleaved buffer components
 static constexpr uint32_t MAX_INTERLEAVED_COMPS = 4;
+
+using CType = itk::IOComponentEnum;
+
+/// Write the data of an image component to a file
+template<typename T>
+bool writeComponent(
+  const Image::ComponentSnapshot& geometry, const void* data, const fs::path& fileName
+)
+{
+  constexpr uint32_t DIM = 3;
+  constexpr bool s_isVectorImage = false;
+
+  auto image = makeScalarImage(
+    geometry.m_dims,
+    geometry.m_origin,
+    geometry.m_spacing,
+    geometry.m_directions,
+    static_cast<const T*>(data)
+  );
+
+  return writeImage<T, DIM, s_isVectorImage>(image, fileName);
+}
+
+/// Write the data of an image component to a temporary file in the directory of the file,
+/// then rename the temporary file to the file name. The temporary file name keeps the extension
+/// of the file name, since it determines the file format.
+bool writeComponentAtomically(
+  const Image::ComponentSnapshot& geometry, const void* data, const fs::path& fileName
+)
+{
+  const fs::path tempFileName = fileName.parent_path()
+                                / (".saving_" + fileName.filename().string());
+
+  bool written = false;
+
+  switch (geometry.m_componentType)
+  {
+  case ComponentType::Int8:
+    written = writeComponent<int8_t>(geometry, data, tempFileName);
+    break;
+  case ComponentType::UInt8:
+    written = writeComponent<uint8_t>(geometry, data, tempFileName);
+    break;
+  case ComponentType::Int16:
+    written = writeComponent<int16_t>(geometry, data, tempFileName);
+    break;
+  case ComponentType::UInt16:
+    written = writeComponent<uint16_t>(geometry, data, tempFileName);
+    break;
+  case ComponentType::Int32:
+    written = writeComponent<int32_t>(geometry, data, tempFileName);
+    break;
+  case ComponentType::UInt32:
+    written = writeComponent<uint32_t>(geometry, data, tempFileName);
+    break;
+  case ComponentType::Float32:
+    written = writeComponent<float>(geometry, data, tempFileName);
+    break;
+  default:
+    break;
+  }
+
+  std::error_code error;
+
+  if (!written)
+  {
+    fs::remove(tempFileName, error);
+    return false;
+  }
+
+  fs::rename(tempFileName, fileName, error);
+
+  if (error)
+  {
+    spdlog::error(
+      "Unable to rename temporary file {} to {}: {}", tempFileName, fileName, error.message()
+    );
+    fs::remove(tempFileName, error);
+    return false;
+  }
+
+  return true;
+}
+
+/// Component type of image data in memory, given the component type of its source data.
+/// Images hold 8-, 16-, and 32-bit integer and 32-bit floating-point components; wider
+/// components are narrowed. Segmentations hold 8-, 16-, and 32-bit unsigned integer components.
+CType memoryComponentType(const Image::ImageRepresentation& imageRep, const CType& srcType)
+{
+  switch (imageRep)
+  {
+  case Image::ImageRepresentation::Image:
+  {
+    switch (srcType)
+    {
+    case CType::UCHAR:
+    case CType::CHAR:
+    case CType::USHORT:
+    case CType::SHORT:
+    case CType::UINT:
+    case CType::INT:
+    case CType::FLOAT:
+      return srcType;
+    case CType::ULONG:
+    case CType::ULONGLONG:
+      return CType::UINT;
+    case CType::LONG:
+    case CType::LONGLONG:
+      return CType::INT;
+    case CType::DOUBLE:
+    case CType::LDOUBLE:
+      return CType::FLOAT;
+    default:
+      return CType::UNKNOWNCOMPONENTTYPE;
+    }
+  }
+  case Image::ImageRepresentation::Segmentation:
+  {
+    switch (srcType)
+    {
+    case CType::UCHAR:
+    case CType::CHAR:
+      return CType::UCHAR;
+    case CType::USHORT:
+    case CType::SHORT:
+      return CType::USHORT;
+    case CType::UINT:
+    case CType::INT:
+    case CType::ULONG:
+    case CType::LONG:
+    case CType::ULONGLONG:
+    case CType::LONGLONG:
+    case CType::FLOAT:
+    case CType::DOUBLE:
+    case CType::LDOUBLE:
+      return CType::UINT;
+    default:
+      return CType::UNKNOWNCOMPONENTTYPE;
+    }
+  }
+  }
+
+  return CType::UNKNOWNCOMPONENTTYPE;
+}
+
+bool isFloatingPointComponent(const CType& type)
+{
+  return (CType::FLOAT == type || CType::DOUBLE == type || CType::LDOUBLE == type);
+}
+
+bool isSignedComponent(const CType& type)
+{
+  return (CType::CHAR == type || CType::SHORT == type || CType::INT == type || CType::LONG == type
+          || CType::LONGLONG == type || isFloatingPointComponent(type));
+}
+
+std::size_t componentSizeInBytes(const CType& type)
+{
+  switch (type)
+  {
+  case CType::UCHAR:
+  case CType::CHAR:
+    return 1;
+  case CType::USHORT:
+  case CType::SHORT:
+    return 2;
+  case CType::UINT:
+  case CType::INT:
+  case CType::FLOAT:
+    return 4;
+  case CType::ULONG:
+  case CType::LONG:
+    return sizeof(long);
+  case CType::ULONGLONG:
+  case CType::LONGLONG:
+  case CType::DOUBLE:
+    return 8;
+  case CType::LDOUBLE:
+    return sizeof(long double);
+  default:
+    return 0;
+  }
+}
+
+/// Copy and sort each component of an image
+template<typename T>
+void sortComponents(
+  const std::vector<std::vector<T>>& data,
+  std::vector<std::vector<T>>& dataSorted,
+  std::size_t numComps,
+  std::size_t numPixels,
+  bool interleaved
+)
+{
+  dataSorted.clear();
+
+  for (std::size_t c = 0; c < numComps; ++c)
+  {
+    if (interleaved)
+    {
+      // Component c of pixel p is at index (numComps * p + c) of the single interleaved buffer
+      auto& dst = dataSorted.emplace_back(numPixels);
+      for (std::size_t p = 0; p < numPixels; ++p)
+      {
+        dst[p] = data[0][numComps * p + c];
+      }
+      std::sort(std::begin(dst), std::end(dst));
+    }
+    else
+    {
+      const auto& src = data[c];
+      auto& dst = dataSorted.emplace_back(src.size());
+      std::partial_sort_copy(std::begin(src), std::end(src), std::begin(dst), std::end(dst));
+    }
+  }
+}
+
+/// Build the quantile index of each component of an image
+template<typename T>
+void indexComponents(
+  const std::vector<std::vector<T>>& data,
+  std::vector<QuantileIndex>& indices,
+  std::size_t numComps,
+  std::size_t numPixels,
+  bool interleaved
+)
+{
+  indices.clear();
+
+  for (std::size_t c = 0; c < numComps; ++c)
+  {
+    if (interleaved)
+    {
+      indices.emplace_back(buildQuantileIndex<T>(data[0].data() + c, numPixels, numComps));
+    }
+    else
+    {
+      indices.emplace_back(buildQuantileIndex<T>(data[c].data(), numPixels, 1));
+    }
+  }
+}
 } // namespace
 
 Image::Image(
   const fs::path& fileName,
   const ImageRepresentation& imageRep,
-  const MultiComponentBufferType& bufferType
+  const MultiComponentBufferType& bufferType,
+  bool retainSortedBuffers
 )
   : m_data_int8()
   , m_data_uint8()
@@ -38,6 +285,8 @@ Image::Image(
   , m_dataSorted_int32()
   , m_dataSorted_uint32()
   , m_dataSorted_float32()
+  , m_retainSortedBuffers(retainSortedBuffers)
+  , m_quantileIndices()
   ,
 
   m_imageRep(imageRep)
@@ -64,20 +313,6 @@ Image::Image(
   // The information in memory (destination image) may not match the information on disk (source image)
   m_ioInfoInMemory = m_ioInfoOnDisk;
 
-  const bool isComponentFloatingPoint = m_ioInfoOnDisk.m_componentInfo.m_componentType
-                                          == itk::IOComponentEnum::FLOAT
-                                        || m_ioInfoOnDisk.m_componentInfo.m_componentType
-                                             == itk::IOComponentEnum::DOUBLE
-                                        || m_ioInfoOnDisk.m_componentInfo.m_componentType
-                                             == itk::IOComponentEnum::LDOUBLE;
-
-  // Source and destination component ITK types: Floating point images are loaded with 32-bit float
-  // components and integer images are loaded with 64-bit signed integer components.
-  const itk::IOComponentEnum srcItkCompType = isComponentFloatingPoint ? itk::IOComponentEnum::FLOAT
-                                                                       : itk::IOComponentEnum::LONG;
-
-  const itk::IOComponentEnum dstItkCompType = m_ioInfoInMemory.m_componentInfo.m_componentType;
-
   const std::size_t numPixels = m_ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels;
   const uint32_t numCompsOnDisk = m_ioInfoOnDisk.m_pixelInfo.m_numComponents;
   const bool isVectorImage = (numCompsOnDisk > 1);
@@ -130,41 +365,9 @@ Image::Image(
     throw_debug("No components to load for image")
   }
 
-  std::function<bool(const void* buffer, std::size_t numElements)> loadBufferFn = nullptr;
-
-  switch (m_imageRep)
-  {
-  case ImageRepresentation::Image:
-  {
-    loadBufferFn =
-      [this, &srcItkCompType, &dstItkCompType](const void* buffer, std::size_t numElements)
-    { return loadImageBuffer(buffer, numElements, srcItkCompType, dstItkCompType); };
-    break;
-  }
-  case ImageRepresentation::Segmentation:
-  {
-    loadBufferFn =
-      [this, &srcItkCompType, &dstItkCompType](const void* buffer, std::size_t numElements)
-    { return loadSegBuffer(buffer, numElements, srcItkCompType, dstItkCompType); };
-    break;
-  }
-  }
-
-  bool loaded = false;
-  if (isComponentFloatingPoint)
-  {
-    // Read image with floating point components from disk to an ITK image with 32-bit float point pixel components
-    loaded = loadImage<float>(
-      fileName, numPixels, numCompsOnDisk, numCompsToLoad, isVectorImage, m_bufferType, loadBufferFn
-    );
-  }
-  else
-  {
-    // Read image with integer components from disk to an ITK image with 64-bit signed integer pixel components
-    loaded = loadImage<int64_t>(
-      fileName, numPixels, numCompsOnDisk, numCompsToLoad, isVectorImage, m_bufferType, loadBufferFn
-    );
-  }
+  // Read the image from disk in its own component type directly into the buffers of the
+  // component type in memory:
+  const bool loaded = readComponents(imageIo.GetPointer(), numCompsToLoad);
 
   if (!loaded)
   {
@@ -174,6 +377,8 @@ Image::Image(
   m_header = ImageHeader(
     m_ioInfoOnDisk, m_ioInfoInMemory, (MultiComponentBufferType::InterleavedImage == m_bufferType)
   );
+  m_header.setNumComponentsPerPixel(numCompsToLoad);
+
   m_headerOverrides = ImageHeaderOverrides(
     m_header.pixelDimensions(), m_header.spacing(), m_header.origin(), m_header.directions()
   );
@@ -181,6 +386,12 @@ Image::Image(
     m_header.pixelDimensions(), m_header.spacing(), m_header.origin(), m_header.directions()
   );
 
+  if (!generateQuantileIndices())
+  {
+    spdlog::error("Error generating image component quantile indices");
+    throw_debug("Error generating image component quantile indices")
+  }
+
   if (!generateSortedBuffers())
   {
     spdlog::error("Error generating sorted image component buffers");
@@ -196,6 +407,15 @@ Image::Image(
     std::move(componentStats)
   );
 
+  if (ImageRepresentation::Segmentation == m_imageRep)
+  {
+    m_dirtyBricks = DirtyBrickMap(
+      glm::uvec3{m_header.pixelDimensions()}, m_header.memoryComponentSizeInBytes()
+    );
+  }
+
+  generateMinMaxTrees();
+
   m_settings.histogramSettings();
 }
 
@@ -204,7 +424,8 @@ Image::Image(
   const std::string& displayName,
   const ImageRepresentation& imageRep,
   const MultiComponentBufferType& bufferType,
-  const std::vector<const void*>& imageDataComponents
+  const std::vector<const void*>& imageDataComponents,
+  bool retainSortedBuffers
 )
   : m_data_int8()
   , m_data_uint8()
@@ -222,6 +443,8 @@ Image::Image(
   , m_dataSorted_int32()
   , m_dataSorted_uint32()
   , m_dataSorted_float32()
+  , m_retainSortedBuffers(retainSortedBuffers)
+  , m_quantileIndices()
   ,
 
   m_imageRep(imageRep)
@@ -248,58 +471,8 @@ Image::Image(
 
   m_ioInfoInMemory = m_ioInfoOnDisk;
 
-  // Source and destination component ITK types
-  using CType = itk::IOComponentEnum;
+  // Source component ITK type
   const CType srcItkCompType = m_ioInfoInMemory.m_componentInfo.m_componentType;
-  CType dstItkCompType = itk::IOComponentEnum::UNKNOWNCOMPONENTTYPE;
-
-  switch (srcItkCompType)
-  {
-  case CType::UCHAR:
-    dstItkCompType = CType::UCHAR;
-    break;
-  case CType::CHAR:
-    dstItkCompType = CType::CHAR;
-    break;
-  case CType::USHORT:
-    dstItkCompType = CType::USHORT;
-    break;
-  case CType::SHORT:
-    dstItkCompType = CType::SHORT;
-    break;
-  case CType::UINT:
-    dstItkCompType = CType::UINT;
-    break;
-  case CType::INT:
-    dstItkCompType = CType::INT;
-    break;
-  case CType::FLOAT:
-    dstItkCompType = CType::FLOAT;
-    break;
-
-  case CType::ULONG:
-  case CType::ULONGLONG:
-    dstItkCompType = CType::UINT;
-    break;
-
-  case CType::LONG:
-  case CType::LONGLONG:
-    dstItkCompType = CType::INT;
-    break;
-
-  case CType::DOUBLE:
-  case CType::LDOUBLE:
-    dstItkCompType = CType::FLOAT;
-    break;
-
-  case CType::UNKNOWNCOMPONENTTYPE:
-  {
-    spdlog::error(
-      "Unknown component type in image from file {}", m_ioInfoOnDisk.m_fileInfo.m_fileName
-    );
-    throw_debug("Unknown component type in image")
-  }
-  }
 
   const std::size_t numPixels = m_header.numPixels();
   const uint32_t numComps = m_header.numComponentsPerPixel();
@@ -357,24 +530,9 @@ Image::Image(
 
       for (std::size_t c = 0; c < m_header.numComponentsPerPixel(); ++c)
       {
-        switch (m_imageRep)
+        if (!loadBuffer(imageDataComponents[c], numPixels, srcItkCompType))
         {
-        case ImageRepresentation::Segmentation:
-        {
-          if (!loadSegBuffer(imageDataComponents[c], numPixels, srcItkCompType, dstItkCompType))
-          {
-            throw_debug("Error loading segmentation image buffer")
-          }
-          break;
-        }
-        case ImageRepresentation::Image:
-        {
-          if (!loadImageBuffer(imageDataComponents[c], numPixels, srcItkCompType, dstItkCompType))
-          {
-            throw_debug("Error loading image buffer")
-          }
-          break;
-        }
+          throw_debug("Error loading image buffer")
         }
       }
       break;
@@ -384,43 +542,18 @@ Image::Image(
       // Load a single buffer with interleaved components:
       const std::size_t N = numPixels * numComps;
 
-      switch (m_imageRep)
+      if (!loadBuffer(imageDataComponents[0], N, srcItkCompType))
       {
-      case ImageRepresentation::Segmentation:
-      {
-        if (!loadSegBuffer(imageDataComponents[0], N, srcItkCompType, dstItkCompType))
-        {
-          throw_debug("Error loading segmentation image buffer")
-        }
-        break;
-      }
-      case ImageRepresentation::Image:
-      {
-        if (!loadImageBuffer(imageDataComponents[0], N, srcItkCompType, dstItkCompType))
-        {
-          throw_debug("Error loading image buffer")
-        }
-        break;
-      }
+        throw_debug("Error loading image buffer")
       }
     }
     }
   }
   else // scalar image
   {
-    if (ImageRepresentation::Segmentation == m_imageRep)
+    if (!loadBuffer(imageDataComponents[0], numPixels, srcItkCompType))
     {
-      if (!loadSegBuffer(imageDataComponents[0], numPixels, srcItkCompType, dstItkCompType))
-      {
-        throw_debug("Error loading segmentation image buffer")
-      }
-    }
-    else
-    {
-      if (!loadImageBuffer(imageDataComponents[0], numPixels, srcItkCompType, dstItkCompType))
-      {
-        throw_debug("Error loading image buffer")
-      }
+      throw_debug("Error loading image buffer")
     }
   }
 
@@ -431,6 +564,12 @@ Image::Image(
     m_header.pixelDimensions(), m_header.spacing(), m_header.origin(), m_header.directions()
   );
 
+  if (!generateQuantileIndices())
+  {
+    spdlog::error("Error generating image component quantile indices");
+    throw_debug("Error generating image component quantile indices")
+  }
+
   if (!generateSortedBuffers())
   {
     spdlog::error("Error generating sorted image component buffers");
@@ -445,13 +584,19 @@ Image::Image(
     m_header.memoryComponentType(),
     std::move(componentStats)
   );
+
+  if (ImageRepresentation::Segmentation == m_imageRep)
+  {
+    m_dirtyBricks = DirtyBrickMap(
+      glm::uvec3{m_header.pixelDimensions()}, m_header.memoryComponentSizeInBytes()
+    );
+  }
+
+  generateMinMaxTrees();
 }
 
 bool Image::saveComponentToDisk(uint32_t component, const std::optional<fs::path>& newFileName)
 {
-  constexpr uint32_t DIM = 3;
-  constexpr bool s_isVectorImage = false;
-
   const fs::path fileName = (newFileName) ? *newFileName : m_header.fileName();
 
   if (component >= m_header.numComponentsPerPixel())
@@ -464,562 +609,345 @@ bool Image::saveComponentToDisk(uint32_t component, const std::optional<fs::path
     return false;
   }
 
-  std::array<uint32_t, DIM> dims;
-  std::array<double, DIM> origin;
-  std::array<double, DIM> spacing;
-  std::array<std::array<double, DIM>, DIM> directions;
-
-  for (uint32_t i = 0; i < DIM; ++i)
-  {
-    const int ii = static_cast<int>(i);
-    dims[i] = m_header.pixelDimensions()[ii];
-    origin[i] = static_cast<double>(m_header.origin()[ii]);
-    spacing[i] = static_cast<double>(m_header.spacing()[ii]);
-
-    directions[i] = {
-      static_cast<double>(m_header.directions()[ii].x),
-      static_cast<double>(m_header.directions()[ii].y),
-      static_cast<double>(m_header.directions()[ii].z)
-    };
-  }
-
-  switch (m_header.memoryComponentType())
-  {
-  case ComponentType::Int8:
-  {
-    auto image = makeScalarImage(dims, origin, spacing, directions, m_data_int8[component].data());
-    return writeImage<int8_t, DIM, s_isVectorImage>(image, fileName);
-  }
-  case ComponentType::UInt8:
-  {
-    auto image = makeScalarImage(dims, origin, spacing, directions, m_data_uint8[component].data());
-    return writeImage<uint8_t, DIM, s_isVectorImage>(image, fileName);
-  }
-  case ComponentType::Int16:
-  {
-    auto image = makeScalarImage(dims, origin, spacing, directions, m_data_int16[component].data());
-    return writeImage<int16_t, DIM, s_isVectorImage>(image, fileName);
-  }
-  case ComponentType::UInt16:
-  {
-    auto image = makeScalarImage(dims, origin, spacing, directions, m_data_uint16[component].data());
-    return writeImage<uint16_t, DIM, s_isVectorImage>(image, fileName);
-  }
-  case ComponentType::Int32:
-  {
-    auto image = makeScalarImage(dims, origin, spacing, directions, m_data_int32[component].data());
-    return writeImage<int32_t, DIM, s_isVectorImage>(image, fileName);
-  }
-  case ComponentType::UInt32:
-  {
-    auto image = makeScalarImage(dims, origin, spacing, directions, m_data_uint32[component].data());
-    return writeImage<uint32_t, DIM, s_isVectorImage>(image, fileName);
-  }
-  case ComponentType::Float32:
-  {
-    auto image = makeScalarImage(dims, origin, spacing, directions, m_data_float32[component].data());
-    return writeImage<float, DIM, s_isVectorImage>(image, fileName);
-  }
-  default:
-  {
-    return false;
-  }
-  }
+  // Saving does not change the data, so use the const buffer
+  const void* buffer = static_cast<const Image*>(this)->bufferAsVoid(component);
+  return writeComponentAtomically(geometrySnapshot(), buffer, fileName);
 }
 
-bool Image::generateSortedBuffers()
+std::optional<Image::ComponentSnapshot> Image::snapshotComponent(uint32_t component) const
 {
-  switch (m_header.memoryComponentType())
-  {
-  case ComponentType::Int8:
-    m_dataSorted_int8.clear();
-    break;
-  case ComponentType::UInt8:
-    m_dataSorted_uint8.clear();
-    break;
-  case ComponentType::Int16:
-    m_dataSorted_int16.clear();
-    break;
-  case ComponentType::UInt16:
-    m_dataSorted_uint16.clear();
-    break;
-  case ComponentType::Int32:
-    m_dataSorted_int32.clear();
-    break;
-  case ComponentType::UInt32:
-    m_dataSorted_uint32.clear();
-    break;
-  case ComponentType::Float32:
-    m_dataSorted_float32.clear();
-    break;
-  default:
-    return false;
-  }
+  // Minimum number of bytes copied per thread
+  static constexpr std::size_t sk_minBytesPerThread = 16 * 1024 * 1024;
 
-  switch (m_bufferType)
-  {
-  case MultiComponentBufferType::SeparateImages:
+  if (component >= m_header.numComponentsPerPixel())
   {
-    for (std::size_t c = 0; c < m_header.numComponentsPerPixel(); ++c)
-    {
-      switch (m_header.memoryComponentType())
-      {
-      case ComponentType::Int8:
-      {
-        const auto& src = m_data_int8[c];
-        auto& dst = m_dataSorted_int8;
-        dst.emplace_back(std::vector<int8_t>(src.size()));
-        std::partial_sort_copy(
-          std::begin(src), std::end(src), std::begin(dst.back()), std::end(dst.back())
-        );
-        break;
-      }
-      case ComponentType::UInt8:
-      {
-        const auto& src = m_data_uint8[c];
-        auto& dst = m_dataSorted_uint8;
-        dst.emplace_back(std::vector<uint8_t>(src.size()));
-        std::partial_sort_copy(
-          std::begin(src), std::end(src), std::begin(dst.back()), std::end(dst.back())
-        );
-        break;
-      }
-      case ComponentType::Int16:
-      {
-        const auto& src = m_data_int16[c];
-        auto& dst = m_dataSorted_int16;
-        dst.emplace_back(std::vector<int16_t>(src.size()));
-        std::partial_sort_copy(
-          std::begin(src), std::end(src), std::begin(dst.back()), std::end(dst.back())
-        );
-        break;
-      }
-      case ComponentType::UInt16:
-      {
-        const auto& src = m_data_uint16[c];
-        auto& dst = m_dataSorted_uint16;
-        dst.emplace_back(std::vector<uint16_t>(src.size()));
-        std::partial_sort_copy(
-          std::begin(src), std::end(src), std::begin(dst.back()), std::end(dst.back())
-        );
-        break;
-      }
-      case ComponentType::Int32:
-      {
-        const auto& src = m_data_int32[c];
-        auto& dst = m_dataSorted_int32;
-        dst.emplace_back(std::vector<int32_t>(src.size()));
-        std::partial_sort_copy(
-          std::begin(src), std::end(src), std::begin(dst.back()), std::end(dst.back())
-        );
-        break;
-      }
-      case ComponentType::UInt32:
-      {
-        const auto& src = m_data_uint32[c];
-        auto& dst = m_dataSorted_uint32;
-        dst.emplace_back(std::vector<uint32_t>(src.size()));
-        std::partial_sort_copy(
-          std::begin(src), std::end(src), std::begin(dst.back()), std::end(dst.back())
-        );
-        break;
-      }
-      case ComponentType::Float32:
-      {
-        const auto& src = m_data_float32[c];
-        auto& dst = m_dataSorted_float32;
-        dst.emplace_back(std::vector<float>(src.size()));
-        std::partial_sort_copy(
-          std::begin(src), std::end(src), std::begin(dst.back()), std::end(dst.back())
-        );
-        break;
-      }
-      default:
-        return false;
-      }
-    }
-    return true;
+    spdlog::error(
+      "Invalid image component {} to snapshot; image has only {} components",
+      component,
+      m_header.numComponentsPerPixel()
+    );
+    return std::nullopt;
   }
-  case MultiComponentBufferType::InterleavedImage:
+
+  const uint8_t* data = static_cast<const uint8_t*>(bufferAsVoid(component));
+  if (!data)
   {
-    const std::size_t N = m_header.numPixels();
-    for (std::size_t c = 0; c < m_header.numComponentsPerPixel(); ++c)
-    {
-      switch (m_header.memoryComponentType())
-      {
-      case ComponentType::Int8:
-      {
-        auto& dst = m_dataSorted_int8[c];
-        dst.resize(N);
-        for (std::size_t i = 0; i < N; ++i)
-        {
-          dst[i] = m_data_int8[0][(c + 1ul) * i];
-        }
-        std::sort(std::begin(dst), std::end(dst));
-        break;
-      }
-      case ComponentType::UInt8:
-      {
-        auto& dst = m_dataSorted_uint8[c];
-        dst.resize(N);
-        for (std::size_t i = 0; i < N; ++i)
-        {
-          dst[i] = m_data_uint8[0][(c + 1ul) * i];
-        }
-        std::sort(std::begin(dst), std::end(dst));
-        break;
-      }
-      case ComponentType::Int16:
-      {
-        auto& dst = m_dataSorted_int16[c];
-        dst.resize(N);
-        for (std::size_t i = 0; i < N; ++i)
-        {
-          dst[i] = m_data_int16[0][(c + 1ul) * i];
-        }
-        std::sort(std::begin(dst), std::end(dst));
-        break;
-      }
-      case ComponentType::UInt16:
-      {
-        auto& dst = m_dataSorted_uint16[c];
-        dst.resize(N);
-        for (std::size_t i = 0; i < N; ++i)
-        {
-          dst[i] = m_data_uint16[0][(c + 1ul) * i];
-        }
-        std::sort(std::begin(dst), std::end(dst));
-        break;
-      }
-      case ComponentType::Int32:
-      {
-        auto& dst = m_dataSorted_int32[c];
-        dst.resize(N);
-        for (std::size_t i = 0; i < N; ++i)
-        {
-          dst[i] = m_data_int32[0][(c + 1ul) * i];
-        }
-        std::sort(std::begin(dst), std::end(dst));
-        break;
-      }
-      case ComponentType::UInt32:
-      {
-        auto& dst = m_dataSorted_uint32[c];
-        dst.resize(N);
-        for (std::size_t i = 0; i < N; ++i)
-        {
-          dst[i] = m_data_uint32[0][(c + 1ul) * i];
-        }
-        std::sort(std::begin(dst), std::end(dst));
-        break;
-      }
-      case ComponentType::Float32:
-      {
-        auto& dst = m_dataSorted_float32[c];
-        dst.resize(N);
-        for (std::size_t i = 0; i < N; ++i)
-        {
-          dst[i] = m_data_float32[0][(c + 1ul) * i];
-        }
-        std::sort(std::begin(dst), std::end(dst));
-        break;
-      }
-      default:
-        return false;
-      }
-    }
-    return true;
-  }
+    spdlog::error("Null buffer for image component {} to snapshot", component);
+    return std::nullopt;
   }
 
-  return false;
+  ComponentSnapshot snapshot = geometrySnapshot();
+
+  const std::size_t numBytes = m_header.numPixels() * m_header.memoryComponentSizeInBytes();
+  snapshot.m_data.resize(numBytes);
+
+  parallel::forEachChunk(
+    numBytes,
+    sk_minBytesPerThread,
+    [data, &snapshot](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+    { std::copy(data + begin, data + end, snapshot.m_data.data() + begin); }
+  );
+
+  return snapshot;
 }
 
-bool Image::loadImageBuffer(
-  const void* buffer,
-  std::size_t numElements,
-  const itk::IOComponentEnum& srcComponentType,
-  const itk::IOComponentEnum& dstComponentType
-)
+bool Image::saveSnapshotToDisk(const ComponentSnapshot& snapshot, const fs::path& fileName)
 {
-  using CType = itk::ImageIOBase::IOComponentType;
+  return writeComponentAtomically(snapshot, snapshot.m_data.data(), fileName);
+}
 
-  bool didCast = false;
-  bool warnSizeConversion = false;
+Image::ComponentSnapshot Image::geometrySnapshot() const
+{
+  ComponentSnapshot snapshot;
+  snapshot.m_componentType = m_header.memoryComponentType();
 
-  switch (dstComponentType)
-  {
-  case CType::UCHAR:
+  for (uint32_t i = 0; i < 3; ++i)
   {
-    m_data_uint8.emplace_back(createBuffer<uint8_t>(buffer, numElements, srcComponentType));
-    break;
+    const int ii = static_cast<int>(i);
+    snapshot.m_dims[i] = static_cast<uint32_t>(m_header.pixelDimensions()[ii]);
+    snapshot.m_origin[i] = static_cast<double>(m_header.origin()[ii]);
+    snapshot.m_spacing[i] = static_cast<double>(m_header.spacing()[ii]);
+
+    snapshot.m_directions[i] = {
+      static_cast<double>(m_header.directions()[ii].x),
+      static_cast<double>(m_header.directions()[ii].y),
+      static_cast<double>(m_header.directions()[ii].z)
+    };
   }
-  case CType::CHAR:
+
+  return snapshot;
+}
+
+bool Image::generateSortedBuffers()
+{
+  if (!m_retainSortedBuffers)
   {
-    m_data_int8.emplace_back(createBuffer<int8_t>(buffer, numElements, srcComponentType));
-    break;
+    return true;
   }
-  case CType::USHORT:
+
+  const std::size_t numComps = m_header.numComponentsPerPixel();
+  const std::size_t numPixels = m_header.numPixels();
+  const bool interleaved = (MultiComponentBufferType::InterleavedImage == m_bufferType);
+
+  switch (m_header.memoryComponentType())
   {
-    m_data_uint16.emplace_back(createBuffer<uint16_t>(buffer, numElements, srcComponentType));
-    break;
+  case ComponentType::Int8:
+    sortComponents(m_data_int8, m_dataSorted_int8, numComps, numPixels, interleaved);
+    return true;
+  case ComponentType::UInt8:
+    sortComponents(m_data_uint8, m_dataSorted_uint8, numComps, numPixels, interleaved);
+    return true;
+  case ComponentType::Int16:
+    sortComponents(m_data_int16, m_dataSorted_int16, numComps, numPixels, interleaved);
+    return true;
+  case ComponentType::UInt16:
+    sortComponents(m_data_uint16, m_dataSorted_uint16, numComps, numPixels, interleaved);
+    return true;
+  case ComponentType::Int32:
+    sortComponents(m_data_int32, m_dataSorted_int32, numComps, numPixels, interleaved);
+    return true;
+  case ComponentType::UInt32:
+    sortComponents(m_data_uint32, m_dataSorted_uint32, numComps, numPixels, interleaved);
+    return true;
+  case ComponentType::Float32:
+    sortComponents(m_data_float32, m_dataSorted_float32, numComps, numPixels, interleaved);
+    return true;
+  default:
+    return false;
   }
-  case CType::SHORT:
+}
+
+bool Image::generateQuantileIndices()
+{
+  const std::size_t numComps = m_header.numComponentsPerPixel();
+  const std::size_t numPixels = m_header.numPixels();
+  const bool interleaved = (MultiComponentBufferType::InterleavedImage == m_bufferType);
+
+  switch (m_header.memoryComponentType())
   {
-    m_data_int16.emplace_back(createBuffer<int16_t>(buffer, numElements, srcComponentType));
+  case ComponentType::Int8:
+    indexComponents(m_data_int8, m_quantileIndices, numComps, numPixels, interleaved);
     break;
-  }
-  case CType::UINT:
-  {
-    m_data_uint32.emplace_back(createBuffer<uint32_t>(buffer, numElements, srcComponentType));
+  case ComponentType::UInt8:
+    indexComponents(m_data_uint8, m_quantileIndices, numComps, numPixels, interleaved);
     break;
-  }
-  case CType::INT:
-  {
-    m_data_int32.emplace_back(createBuffer<int32_t>(buffer, numElements, srcComponentType));
+  case ComponentType::Int16:
+    indexComponents(m_data_int16, m_quantileIndices, numComps, numPixels, interleaved);
     break;
-  }
-  case CType::FLOAT:
-  {
-    m_data_float32.emplace_back(createBuffer<float>(buffer, numElements, srcComponentType));
+  case ComponentType::UInt16:
+    indexComponents(m_data_uint16, m_quantileIndices, numComps, numPixels, interleaved);
+    break;
+  case ComponentType::Int32:
+    indexComponents(m_data_int32, m_quantileIndices, numComps, numPixels, interleaved);
+    break;
+  case ComponentType::UInt32:
+    indexComponents(m_data_uint32, m_quantileIndices, numComps, numPixels, interleaved);
+    break;
+  case ComponentType::Float32:
+    indexComponents(m_data_float32, m_quantileIndices, numComps, numPixels, interleaved);
     break;
+  default:
+    return false;
   }
 
-  case CType::ULONG:
-  case CType::ULONGLONG:
+  for (std::size_t c = 0; c < m_quantileIndices.size(); ++c)
   {
-    m_data_uint32.emplace_back(createBuffer<uint32_t>(buffer, numElements, srcComponentType));
-    m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
-    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
-    didCast = true;
-    warnSizeConversion = true;
-    break;
+    spdlog::debug(
+      "Quantile index of component {} has {} bins ({} bytes, exact: {})",
+      c,
+      m_quantileIndices[c].numBins(),
+      m_quantileIndices[c].sizeInBytes(),
+      m_quantileIndices[c].isExact()
+    );
   }
 
-  case CType::LONG:
-  case CType::LONGLONG:
+  return true;
+}
+
+void Image::generateMinMaxTrees()
+{
+  m_minMaxTrees.clear();
+
+  if (ImageRepresentation::Segmentation == m_imageRep)
   {
-    m_data_int32.emplace_back(createBuffer<int32_t>(buffer, numElements, srcComponentType));
-    m_ioInfoInMemory.m_componentInfo.m_componentType = CType::INT;
-    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
-    didCast = true;
-    warnSizeConversion = true;
-    break;
+    return;
   }
 
-  case CType::DOUBLE:
-  case CType::LDOUBLE:
+  for (uint32_t c = 0; c < m_header.numComponentsPerPixel(); ++c)
   {
-    m_data_float32.emplace_back(createBuffer<float>(buffer, numElements, srcComponentType));
-    m_ioInfoInMemory.m_componentInfo.m_componentType = CType::FLOAT;
-    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
-    didCast = true;
-    warnSizeConversion = true;
-    break;
+    m_minMaxTrees.emplace_back(*this, c);
+
+    spdlog::debug(
+      "Min-max block tree of component {} has {} blocks ({} bytes)",
+      c,
+      m_minMaxTrees.back().numBlocks(),
+      m_minMaxTrees.back().numBytes()
+    );
   }
+}
+
+bool Image::hasSortedBuffers() const
+{
+  return m_retainSortedBuffers;
+}
+
+const QuantileIndex& Image::quantileIndex(uint32_t comp) const
+{
+  return m_quantileIndices.at(comp);
+}
+
+itk::IOComponentEnum Image::setMemoryComponentType(
+  const itk::IOComponentEnum& srcComponentType, std::size_t numElements
+)
+{
+  const CType memType = memoryComponentType(m_imageRep, srcComponentType);
 
-  case CType::UNKNOWNCOMPONENTTYPE:
+  if (CType::UNKNOWNCOMPONENTTYPE == memType)
   {
     spdlog::error(
       "Unknown component type in image from file {}", m_ioInfoOnDisk.m_fileInfo.m_fileName
     );
-    return false;
-  }
+    return memType;
   }
 
-  if (didCast)
+  m_ioInfoInMemory.m_componentInfo.m_componentType = memType;
+  m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes
+    = static_cast<uint32_t>(componentSizeInBytes(memType));
+
+  if (memType == srcComponentType)
   {
-    const std::string newTypeString = itk::ImageIOBase::GetComponentTypeAsString(
-      m_ioInfoInMemory.m_componentInfo.m_componentType
-    );
+    return memType;
+  }
+
+  const char* repString = (ImageRepresentation::Segmentation == m_imageRep) ? "segmentation"
+                                                                             : "image";
+
+  const std::string srcTypeString = itk::ImageIOBase::GetComponentTypeAsString(srcComponentType);
+  const std::string newTypeString = itk::ImageIOBase::GetComponentTypeAsString(memType);
 
-    m_ioInfoInMemory.m_componentInfo.m_componentTypeString = newTypeString;
+  m_ioInfoInMemory.m_componentInfo.m_componentTypeString = newTypeString;
+  m_ioInfoInMemory.m_sizeInfo.m_imageSizeInBytes
+    = numElements * m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes;
 
-    m_ioInfoInMemory.m_sizeInfo.m_imageSizeInBytes
-      = numElements * m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes;
+  spdlog::info(
+    "Casted {} {} pixel component from type {} to {}",
+    repString,
+    m_ioInfoOnDisk.m_fileInfo.m_fileName,
+    srcTypeString,
+    newTypeString
+  );
 
-    spdlog::info(
-      "Casted image pixel component from type {} to {}",
-      m_ioInfoOnDisk.m_componentInfo.m_componentTypeString,
+  const bool srcIsFloat = isFloatingPointComponent(srcComponentType);
+  const bool memIsFloat = isFloatingPointComponent(memType);
+
+  if (srcIsFloat && !memIsFloat)
+  {
+    spdlog::warn(
+      "Floating point to integer conversion: Possible loss of precision and information when "
+      "casting {} pixel component from type {} to {}",
+      repString,
+      srcTypeString,
       newTypeString
     );
+  }
 
-    if (warnSizeConversion)
-    {
-      spdlog::warn(
-        "Size conversion: Possible loss of information when casting image pixel "
-        "component from type {} to {}",
-        m_ioInfoOnDisk.m_componentInfo.m_componentTypeString,
-        newTypeString
-      );
-    }
+  if (srcIsFloat == memIsFloat
+      && componentSizeInBytes(memType) < componentSizeInBytes(srcComponentType))
+  {
+    spdlog::warn(
+      "Size conversion: Possible loss of information when casting {} pixel component "
+      "from type {} to {}",
+      repString,
+      srcTypeString,
+      newTypeString
+    );
   }
 
-  return true;
+  if (isSignedComponent(srcComponentType) && !isSignedComponent(memType))
+  {
+    spdlog::warn(
+      "Signed to unsigned integer conversion: Possible loss of information when casting "
+      "{} pixel component from type {} to {}",
+      repString,
+      srcTypeString,
+      newTypeString
+    );
+  }
+
+  return memType;
 }
 
-bool Image::loadSegBuffer(
-  const void* buffer,
-  std::size_t numElements,
-  const itk::IOComponentEnum& srcComponentType,
-  const itk::IOComponentEnum& dstComponentType
+bool Image::loadBuffer(
+  const void* buffer, std::size_t numElements, const itk::IOComponentEnum& srcComponentType
 )
 {
-  using CType = itk::ImageIOBase::IOComponentType;
-
-  bool didCast = false;
-  bool warnFloatConversion = false;
-  bool warnSizeConversion = false;
-  bool warnSignConversion = false;
-
-  switch (dstComponentType)
+  switch (setMemoryComponentType(srcComponentType, numElements))
   {
-  // No casting is needed for the cases of unsigned integers with 8, 16, or 32 bytes:
   case CType::UCHAR:
   {
     m_data_uint8.emplace_back(createBuffer<uint8_t>(buffer, numElements, srcComponentType));
-    break;
-  }
-  case CType::USHORT:
-  {
-    m_data_uint16.emplace_back(createBuffer<uint16_t>(buffer, numElements, srcComponentType));
-    break;
-  }
-  case CType::UINT:
-  {
-    m_data_uint32.emplace_back(createBuffer<uint32_t>(buffer, numElements, srcComponentType));
-    break;
+    return true;
   }
-
-  // Signed 8-, 16-, and 32-bit integers are cast to unsigned 8-, 16-, and 32-bit integers:
   case CType::CHAR:
   {
-    m_data_uint8.emplace_back(createBuffer<uint8_t>(buffer, numElements, srcComponentType));
-    m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UCHAR;
-    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 1;
-    didCast = true;
-    warnSignConversion = true;
-    break;
+    m_data_int8.emplace_back(createBuffer<int8_t>(buffer, numElements, srcComponentType));
+    return true;
   }
-  case CType::SHORT:
+  case CType::USHORT:
   {
     m_data_uint16.emplace_back(createBuffer<uint16_t>(buffer, numElements, srcComponentType));
-    m_ioInfoInMemory.m_componentInfo.m_componentType = CType::USHORT;
-    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 2;
-    didCast = true;
-    warnSignConversion = true;
-    break;
+    return true;
   }
-  case CType::INT:
+  case CType::SHORT:
   {
-    m_data_uint32.emplace_back(createBuffer<uint32_t>(buffer, numElements, srcComponentType));
-    m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
-    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
-    didCast = true;
-    warnSignConversion = true;
-    break;
+    m_data_int16.emplace_back(createBuffer<int16_t>(buffer, numElements, srcComponentType));
+    return true;
   }
-
-  // Unsigned long (64-bit) and long long (128-bit) integers are cast to unsigned 32-bit integers:
-  case CType::ULONG:
-  case CType::ULONGLONG:
+  case CType::UINT:
   {
     m_data_uint32.emplace_back(createBuffer<uint32_t>(buffer, numElements, srcComponentType));
-    m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
-    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
-    didCast = true;
-    warnSizeConversion = true;
-    break;
+    return true;
   }
-
-  // Signed long (64-bit) and long long (128-bit) integers are cast to unsigned 32-bit integers:
-  case CType::LONG:
-  case CType::LONGLONG:
+  case CType::INT:
   {
-    m_data_uint32.emplace_back(createBuffer<uint32_t>(buffer, numElements, srcComponentType));
-    m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
-    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
-    didCast = true;
-    warnSizeConversion = true;
-    warnSignConversion = true;
-    break;
+    m_data_int32.emplace_back(createBuffer<int32_t>(buffer, numElements, srcComponentType));
+    return true;
   }
-
-  // Floating-points are cast to unsigned 32-bit integers:
   case CType::FLOAT:
-  case CType::DOUBLE:
-  case CType::LDOUBLE:
   {
-    m_data_uint32.emplace_back(createBuffer<uint32_t>(buffer, numElements, srcComponentType));
-    m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
-    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
-    didCast = true;
-    warnFloatConversion = true;
-    warnSignConversion = true;
-    break;
+    m_data_float32.emplace_back(createBuffer<float>(buffer, numElements, srcComponentType));
+    return true;
   }
-
-  case CType::UNKNOWNCOMPONENTTYPE:
+  default:
   {
-    spdlog::error(
-      "Unknown component type in image from file {}", m_ioInfoOnDisk.m_fileInfo.m_fileName
-    );
     return false;
   }
   }
+}
 
-  if (didCast)
-  {
-    const std::string newTypeString = itk::ImageIOBase::GetComponentTypeAsString(
-      m_ioInfoInMemory.m_componentInfo.m_componentType
-    );
-
-    m_ioInfoInMemory.m_componentInfo.m_componentTypeString = newTypeString;
-    m_ioInfoInMemory.m_sizeInfo.m_imageSizeInBytes
-      = numElements * m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes;
-
-    spdlog::info(
-      "Casted segmentation {} pixel component from type {} to {}",
-      m_ioInfoOnDisk.m_fileInfo.m_fileName,
-      m_ioInfoOnDisk.m_componentInfo.m_componentTypeString,
-      newTypeString
-    );
-
-    if (warnFloatConversion)
-    {
-      spdlog::warn(
-        "Floating point to integer conversion: Possible loss of precision and information when "
-        "casting "
-        "segmentation pixel component from type {} to {}",
-        m_ioInfoOnDisk.m_componentInfo.m_componentTypeString,
-        newTypeString
-      );
-    }
-
-    if (warnSizeConversion)
-    {
-      spdlog::warn(
-        "Size conversion: Possible loss of information when casting segmentation pixel component "
-        "from type "
-        "{} to {}",
-        m_ioInfoOnDisk.m_componentInfo.m_componentTypeString,
-        newTypeString
-      );
-    }
+bool Image::readComponents(itk::ImageIOBase* imageIo, uint32_t numCompsToLoad)
+{
+  const std::size_t numElements = m_ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels * numCompsToLoad;
 
-    if (warnSignConversion)
-    {
-      spdlog::warn(
-        "Signed to unsigned integer conversion: Possible loss of information when casting "
-        "segmentation pixel "
-        "component from type {} to {}",
-        m_ioInfoOnDisk.m_componentInfo.m_componentTypeString,
-        newTypeString
-      );
-    }
+  switch (setMemoryComponentType(m_ioInfoOnDisk.m_componentInfo.m_componentType, numElements))
+  {
+  case CType::UCHAR:
+    return readImageComponents(imageIo, numCompsToLoad, m_bufferType, m_data_uint8);
+  case CType::CHAR:
+    return readImageComponents(imageIo, numCompsToLoad, m_bufferType, m_data_int8);
+  case CType::USHORT:
+    return readImageComponents(imageIo, numCompsToLoad, m_bufferType, m_data_uint16);
+  case CType::SHORT:
+    return readImageComponents(imageIo, numCompsToLoad, m_bufferType, m_data_int16);
+  case CType::UINT:
+    return readImageComponents(imageIo, numCompsToLoad, m_bufferType, m_data_uint32);
+  case CType::INT:
+    return readImageComponents(imageIo, numCompsToLoad, m_bufferType, m_data_int32);
+  case CType::FLOAT:
+    return readImageComponents(imageIo, numCompsToLoad, m_bufferType, m_data_float32);
+  default:
+    return false;
   }
-
-  return true;
 }
 
 const Image::ImageRepresentation& Image::imageRep() const
@@ -1058,6 +986,26 @@ ImageSettings& Image::settings()
   return m_settings;
 }
 
+const DirtyBrickMap& Image::dirtyBricks() const
+{
+  return m_dirtyBricks;
+}
+
+DirtyBrickMap& Image::dirtyBricks()
+{
+  return m_dirtyBricks;
+}
+
+const MinMaxBlockTree* Image::minMaxTree(uint32_t component) const
+{
+  return (component < m_minMaxTrees.size()) ? &m_minMaxTrees[component] : nullptr;
+}
+
+uint64_t Image::dataVersion() const
+{
+  return m_dataVersion.m_value.load();
+}
+
 const void* Image::bufferAsVoid(uint32_t comp) const
 {
   auto F = [this](uint32_t i) -> const void*
@@ -1108,11 +1056,18 @@ const void* Image::bufferAsVoid(uint32_t comp) const
 
 void* Image::bufferAsVoid(uint32_t comp)
 {
+  // The caller may write to the buffer
+  ++m_dataVersion.m_value;
   return const_cast<void*>(const_cast<const Image*>(this)->bufferAsVoid(comp));
 }
 
 const void* Image::bufferSortedAsVoid(uint32_t comp) const
 {
+  if (!m_retainSortedBuffers)
+  {
+    return nullptr;
+  }
+
   if (m_header.numComponentsPerPixel() <= comp)
   {
     spdlog::error(
@@ -1200,6 +1155,11 @@ QuantileOfValue Image::valueToQuantile(uint32_t comp, int64_t value) const
     throw_debug("Invalid image component")
   }
 
+  if (!m_retainSortedBuffers)
+  {
+    return m_quantileIndices.at(comp).valueToQuantile(static_cast<double>(value));
+  }
+
   switch (m_header.memoryComponentType())
   {
   case ComponentType::Int8:
@@ -1258,6 +1218,16 @@ QuantileOfValue Image::valueToQuantile(uint32_t comp, double value) const
     throw_debug("Invalid image component")
   }
 
+  if (!m_retainSortedBuffers)
+  {
+    // Match the conversion of the value to the component type that is done for sorted buffers
+    const double v = isFloatingType(m_header.memoryComponentType())
+                       ? static_cast<double>(static_cast<float>(value))
+                       : std::trunc(value);
+
+    return m_quantileIndices.at(comp).valueToQuantile(v);
+  }
+
   switch (m_header.memoryComponentType())
   {
   case ComponentType::Int8:
@@ -1309,6 +1279,11 @@ double Image::quantileToValue(uint32_t comp, double quantile) const
     throw_debug("Invalid image component")
   }
 
+  if (!m_retainSortedBuffers)
+  {
+    return m_quantileIndices.at(comp).quantileToValue(quantile);
+  }
+
   switch (m_header.memoryComponentType())
   {
   case ComponentType::Int8:
@@ -1427,6 +1402,18 @@ std::ostream& Image::metaData(std::ostream& os) const
 
 void Image::updateComponentStats()
 {
-  /// @todo regenerate sorted buffers?
+  if (!generateQuantileIndices())
+  {
+    spdlog::error("Error regenerating image component quantile indices");
+    return;
+  }
+
+  if (!generateSortedBuffers())
+  {
+    spdlog::error("Error regenerating sorted image component buffers");
+    return;
+  }
+
   m_settings.updateWithNewComponentStatistics(computeImageStatistics(*this), false);
+  generateMinMaxTrees();
 }
@@ -4,15 +4,21 @@
 #include "common/Types.h"
 #include "common/filesystem.h"
 
+#include "image/DirtyBrickMap.h"
 #include "image/ImageHeader.h"
 #include "image/ImageHeaderOverrides.h"
 #include "image/ImageIoInfo.h"
 #include "image/ImageSettings.h"
 #include "image/ImageTransformations.h"
+#include "image/MinMaxBlockTree.h"
+#include "image/QuantileIndex.h"
 
 #include <glm/glm.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -45,11 +51,15 @@ public:
      * @param[in] imageRep Indicates whether this is an image or a segmentation
      * @param[in] bufferType Indicates whether multi-component images are loaded as
      * multiple buffers or as a single buffer with interleaved pixel components
+     * @param[in] retainSortedBuffers Keep a sorted copy of each image component in memory,
+     * which makes quantile queries on floating-point components exact at the cost of
+     * doubling the memory used by the image
      */
   Image(
     const fs::path& fileName,
     const ImageRepresentation& imageRep,
-    const MultiComponentBufferType& bufferType
+    const MultiComponentBufferType& bufferType,
+    bool retainSortedBuffers = false
   );
 
   /**
@@ -61,13 +71,15 @@ public:
      * multiple buffers or as a single buffer with interleaved pixel components
      * @param[in] imageDataComponents Must match the format specified in \c bufferType.
      * If the components are interleaved, then component 0 holds all buffers
+     * @param[in] retainSortedBuffers Keep a sorted copy of each image component in memory
      */
   Image(
     const ImageHeader& header,
     const std::string& displayName,
     const ImageRepresentation& imageRep,
     const MultiComponentBufferType& bufferType,
-    const std::vector<const void*>& imageDataComponents
+    const std::vector<const void*>& imageDataComponents,
+    bool retainSortedBuffers = false
   );
 
   Image(const Image&) = default;
@@ -86,8 +98,50 @@ public:
      */
   bool saveComponentToDisk(uint32_t component, const std::optional<fs::path>& newFileName);
 
+  /// @brief Copy of an image component and of the geometry needed to save it to disk.
+  /// A snapshot can be saved on a worker thread while the image continues to change.
+  struct ComponentSnapshot
+  {
+    ComponentType m_componentType = ComponentType::UInt8; //!< Component type in memory
+    std::array<uint32_t, 3> m_dims{0u, 0u, 0u};           //!< Pixel dimensions
+    std::array<double, 3> m_origin{0.0, 0.0, 0.0};        //!< Origin
+    std::array<double, 3> m_spacing{1.0, 1.0, 1.0};       //!< Pixel spacing
+    std::array<std::array<double, 3>, 3> m_directions{};  //!< Direction cosines (by axis)
+    std::vector<uint8_t> m_data;                          //!< Raw data of the component
+  };
+
+  /** @brief Take a snapshot of an image component. The data are copied in parallel.
+     * @param[in] component Component of the image to copy
+     * @return The snapshot, or std::nullopt if the component is invalid
+     */
+  std::optional<ComponentSnapshot> snapshotComponent(uint32_t component) const;
+
+  /** @brief Save an image component snapshot to disk. The snapshot is written to a temporary
+     * file in the directory of \c fileName, which is then renamed to \c fileName. This way, an
+     * existing file is not left partially overwritten if writing fails.
+     * @param[in] snapshot Snapshot of an image component
+     * @param[in] fileName File name at which to save the snapshot
+     * @return True iff the snapshot was saved successfully
+     */
+  static bool saveSnapshotToDisk(const ComponentSnapshot& snapshot, const fs::path& fileName);
+
+  /// @brief Generate sorted copies of the image components. This is done only if the image
+  /// was constructed with the option to retain sorted buffers.
   bool generateSortedBuffers();
 
+  /// @brief Generate the quantile index of each image component
+  bool generateQuantileIndices();
+
+  /// @brief Build the min-max block tree of each image component. Segmentations have no trees,
+  /// since their values change as they are edited.
+  void generateMinMaxTrees();
+
+  /// @brief Does the image hold sorted copies of its components?
+  bool hasSortedBuffers() const;
+
+  /// @brief Get the quantile index of an image component
+  const QuantileIndex& quantileIndex(uint32_t component) const;
+
   const ImageRepresentation& imageRep() const;
   const MultiComponentBufferType& bufferType() const;
 
@@ -108,6 +162,7 @@ public:
      *  @param[in] component Image component to get
      *  @note Ignores the \c MultiComponentBufferType setting, so that the
      *  component must be in the range [0, header().numComponentsPerPixel() - 1]
+     *  @note Returns nullptr unless the image retains sorted buffers (see \c hasSortedBuffers)
      */
   const void* bufferSortedAsVoid(uint32_t component) const;
 
@@ -331,6 +386,11 @@ public:
     const std::size_t c = compAndOffset->first;
     const std::size_t offset = compAndOffset->second;
 
+    ++m_dataVersion.m_value;
+    m_dirtyBricks.markVoxel(
+      static_cast<uint32_t>(i), static_cast<uint32_t>(j), static_cast<uint32_t>(k)
+    );
+
     switch (m_header.memoryComponentType())
     {
     case ComponentType::Int8:
@@ -364,6 +424,9 @@ public:
   template<typename T>
   void setAllValues(T v)
   {
+    ++m_dataVersion.m_value;
+    m_dirtyBricks.markAll();
+
     switch (m_header.memoryComponentType())
     {
     case ComponentType::Int8:
@@ -459,28 +522,46 @@ public:
   const ImageSettings& settings() const;
   ImageSettings& settings();
 
+  /// @brief Get the bricks of a segmentation whose voxels changed since its texture was updated.
+  /// Functions that write to the segmentation buffers directly must mark the voxels they change.
+  /// Images do not track dirty bricks.
+  const DirtyBrickMap& dirtyBricks() const;
+  DirtyBrickMap& dirtyBricks();
+
+  /// @brief Get the min-max block tree of an image component, which accelerates isosurface
+  /// extraction. Segmentations do not keep trees.
+  /// @return Tree, or nullptr if the image has no tree for the component
+  const MinMaxBlockTree* minMaxTree(uint32_t component) const;
+
+  /// @brief Get the version of the image data, which changes whenever the data may have changed.
+  /// Setting values or getting a non-const buffer pointer counts as a change.
+  uint64_t dataVersion() const;
+
   /// @brief Get the image meta data
   std::ostream& metaData(std::ostream& os) const;
 
   void updateComponentStats();
 
 private:
-  /// Load a buffer as an image component
-  bool loadImageBuffer(
-    const void* buffer,
-    std::size_t numElements,
-    const itk::IOComponentEnum& srcComponentType,
-    const itk::IOComponentEnum& dstComponentType
+  /// Set the component type of the image in memory, given the component type of the source
+  /// data, and log a warning if the conversion may lose information
+  /// @return Component type in memory
+  itk::IOComponentEnum setMemoryComponentType(
+    const itk::IOComponentEnum& srcComponentType, std::size_t numElements
   );
 
-  /// Load a buffer as a segmentation component
-  bool loadSegBuffer(
-    const void* buffer,
-    std::size_t numElements,
-    const itk::IOComponentEnum& srcComponentType,
-    const itk::IOComponentEnum& dstComponentType
+  /// Load a buffer as an image or segmentation component, casting it to the component type
+  /// in memory
+  bool loadBuffer(
+    const void* buffer, std::size_t numElements, const itk::IOComponentEnum& srcComponentType
   );
 
+  /// Read the components of an image file directly into buffers of the component type in memory
+  bool readComponents(itk::ImageIOBase* imageIo, uint32_t numCompsToLoad);
+
+  /// Snapshot of the image geometry, without component data
+  ComponentSnapshot geometrySnapshot() const;
+
   /// For a given image component and 3D pixel indices, return a pair consisting of:
   /// 1) component buffer to index
   /// 2) offset into that buffer
@@ -525,6 +606,13 @@ private:
   std::vector<std::vector<uint32_t>> m_dataSorted_uint32;
   std::vector<std::vector<float>> m_dataSorted_float32;
 
+  /// Keep the sorted component buffers above in memory. By default, they are not generated and
+  /// the quantile indices are used instead.
+  bool m_retainSortedBuffers;
+
+  /// Quantile index of each image component (regardless of m_bufferType)
+  std::vector<QuantileIndex> m_quantileIndices;
+
   ImageRepresentation m_imageRep;        //!< Is this an image or a segmentation?
   MultiComponentBufferType m_bufferType; //!< How are multi-component images represented?
 
@@ -535,6 +623,30 @@ private:
   ImageHeaderOverrides m_headerOverrides;
   ImageTransformations m_tx;
   ImageSettings m_settings;
+
+  DirtyBrickMap m_dirtyBricks; //!< Bricks of a segmentation changed since its texture was updated
+
+  std::vector<MinMaxBlockTree> m_minMaxTrees; //!< Min-max block tree of each component of an image
+
+  /// Version of the image data. It is atomic, since it is read by background jobs while the
+  /// image is edited on the UI thread. Copies of an image start from the version of the original.
+  struct DataVersion
+  {
+    DataVersion() = default;
+    DataVersion(const DataVersion& other)
+      : m_value(other.m_value.load())
+    {
+    }
+    DataVersion& operator=(const DataVersion& other)
+    {
+      m_value.store(other.m_value.load());
+      return *this;
+    }
+
+    std::atomic<uint64_t> m_value{0};
+  };
+
+  DataVersion m_dataVersion; //!< Incremented when the image data may have changed
 };
 
 #endif // IMAGE_H
@@ -6,9 +6,66 @@
 #include <itkCommonEnums.h>
 #include <spdlog/spdlog.h>
 
+#include <cmath>
 #include <limits>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+/**
+ * @brief Cast a component value to the destination component type, clamping it to the range of
+ * the destination type. NaN values are cast to zero for integer destination types.
+ * @param value Source component value
+ * @return Destination component value
+ */
+template<typename SrcCompType, typename DstCompType>
+DstCompType clampCast(SrcCompType value)
+{
+  using DstLimits = std::numeric_limits<DstCompType>;
+
+  if constexpr (std::is_integral_v<SrcCompType> && std::is_integral_v<DstCompType>)
+  {
+    // Integer comparisons that are safe across signedness and size:
+    if (std::cmp_less(value, DstLimits::lowest()))
+    {
+      return DstLimits::lowest();
+    }
+    if (std::cmp_greater(value, DstLimits::max()))
+    {
+      return DstLimits::max();
+    }
+    return static_cast<DstCompType>(value);
+  }
+  else if constexpr (std::is_integral_v<SrcCompType>)
+  {
+    // Integer to floating point:
+    return static_cast<DstCompType>(value);
+  }
+  else
+  {
+    // Floating point to integer or floating point:
+    if constexpr (std::is_integral_v<DstCompType>)
+    {
+      if (std::isnan(value))
+      {
+        return 0;
+      }
+    }
+
+    const auto v = static_cast<long double>(value);
+
+    if (v <= static_cast<long double>(DstLimits::lowest()))
+    {
+      return DstLimits::lowest();
+    }
+    if (v >= static_cast<long double>(DstLimits::max()))
+    {
+      return DstLimits::max();
+    }
+    return static_cast<DstCompType>(value);
+  }
+}
+
 /**
  * @brief createBuffer_dispatch
  * @param buffer
@@ -18,14 +75,6 @@
 template<typename SrcCompType, typename DstCompType>
 std::vector<DstCompType> createBuffer_dispatch(const void* buffer, std::size_t numElements)
 {
-  // Lowest and max values of destination component type, cast to source component type
-  static const SrcCompType k_lowestValue = static_cast<SrcCompType>(
-    std::numeric_limits<DstCompType>::lowest()
-  );
-  static const SrcCompType k_maximumValue = static_cast<SrcCompType>(
-    std::numeric_limits<DstCompType>::max()
-  );
-
   std::vector<DstCompType> data(numElements, 0);
 
   if (!buffer)
@@ -39,9 +88,7 @@ std::vector<DstCompType> createBuffer_dispatch(const void* buffer, std::size_t n
   // Clamp values to destination range [lowest, maximum] prior to cast:
   for (std::size_t i = 0; i < numElements; ++i)
   {
-    data[i] = static_cast<DstCompType>(
-      std::min(std::max(bufferCast[i], k_lowestValue), k_maximumValue)
-    );
+    data[i] = clampCast<SrcCompType, DstCompType>(bufferCast[i]);
   }
 
   return data;
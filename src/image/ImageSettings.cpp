@@ -1031,6 +1031,9 @@ void ImageSettings::updateWithNewComponentStatistics(
     setting.m_histogramSettings.m_intensityRange[0] = stats.m_minimum;
     setting.m_histogramSettings.m_intensityRange[1] = stats.m_maximum;
 
+    // The component values changed, so the cached histogram is stale
+    setting.m_histogramSettings.m_cache = HistogramCache{};
+
     if (0 == m_numPixels)
     {
       spdlog::warn(
@@ -1,5 +1,7 @@
 #include "image/ImageUtility.h"
+#include "image/ComponentDispatch.h"
 #include "image/ImageUtility.tpp"
+#include "image/ComponentStatistics.tpp"
 
 #include "common/MathFuncs.h"
 #include "common/filesystem.h"
@@ -55,6 +57,63 @@ int sgn(T val)
   return (T(0) < val) - (val < T(0));
 }
 
+
+/**
+ * @brief Compute the statistics of one image component from its buffer, which may be interleaved
+ * with the other components. Percentiles are provided by the image.
+ */
+template<typename T>
+ComponentStats computeComponentStatistics(const Image& image, uint32_t comp)
+{
+  const std::size_t numComps = image.header().numComponentsPerPixel();
+  const std::size_t numPixels = image.header().numPixels();
+
+  if (numComps <= comp)
+  {
+    spdlog::error("Invalid image component {} when computing statistics", comp);
+    return ComponentStats{};
+  }
+
+  const ComponentBuffer buffer = componentBuffer(image, comp);
+  const T* data = static_cast<const T*>(buffer.m_data);
+
+  if (!data || 0 == numPixels)
+  {
+    spdlog::warn("Cannot compute statistics of image component with zero elements");
+    return ComponentStats{};
+  }
+
+  return computeComponentStatistics(
+    data,
+    numPixels,
+    buffer.m_stride,
+    [&image, comp](double quantile) { return image.quantileToValue(comp, quantile); }
+  );
+}
+
+/// Compute the histogram of one image component from its buffer, which may be interleaved with
+/// the other components
+template<typename T>
+HistogramCache computeComponentHistogram(
+  const Image& image, uint32_t comp, int numBins, double rangeMin, double rangeMax
+)
+{
+  const std::size_t numComps = image.header().numComponentsPerPixel();
+
+  if (numComps <= comp)
+  {
+    spdlog::error("Invalid image component {} when computing histogram", comp);
+    return HistogramCache{};
+  }
+
+  const ComponentBuffer buffer = componentBuffer(image, comp);
+  const T* data = static_cast<const T*>(buffer.m_data);
+
+  return computeComponentHistogram(
+    data, image.header().numPixels(), buffer.m_stride, numBins, rangeMin, rangeMax
+  );
+}
+
 } // namespace
 
 std::string getFileName(const std::string& filePath, bool withExtension)
@@ -326,76 +385,72 @@ std::vector<ComponentStats> computeImageStatistics(const Image& image)
 {
   std::vector<ComponentStats> componentStats;
 
-  const std::size_t N = image.header().numPixels();
-
   for (uint32_t i = 0; i < image.header().numComponentsPerPixel(); ++i)
   {
-    const void* bufferSorted = image.bufferSortedAsVoid(i);
-
-    switch (image.header().memoryComponentType())
-    {
-    case ComponentType::Int8:
-    {
-      componentStats.emplace_back(
-        computeImageStatistics<int8_t>(std::span(static_cast<const int8_t*>(bufferSorted), N))
-      );
-      break;
-    }
-    case ComponentType::UInt8:
-    {
-      componentStats.emplace_back(
-        computeImageStatistics<uint8_t>(std::span(static_cast<const uint8_t*>(bufferSorted), N))
-      );
-      break;
-    }
-    case ComponentType::Int16:
-    {
-      componentStats.emplace_back(
-        computeImageStatistics<int16_t>(std::span(static_cast<const int16_t*>(bufferSorted), N))
-      );
-      break;
-    }
-    case ComponentType::UInt16:
-    {
-      componentStats.emplace_back(
-        computeImageStatistics<uint16_t>(std::span(static_cast<const uint16_t*>(bufferSorted), N))
-      );
-      break;
-    }
-    case ComponentType::Int32:
-    {
-      componentStats.emplace_back(
-        computeImageStatistics<int32_t>(std::span(static_cast<const int32_t*>(bufferSorted), N))
-      );
-      break;
-    }
-    case ComponentType::UInt32:
-    {
-      componentStats.emplace_back(
-        computeImageStatistics<uint32_t>(std::span(static_cast<const uint32_t*>(bufferSorted), N))
-      );
-      break;
-    }
-    case ComponentType::Float32:
-    {
-      componentStats.emplace_back(
-        computeImageStatistics<float>(std::span(static_cast<const float*>(bufferSorted), N))
-      );
-      break;
-    }
-    default:
-    {
-      spdlog::error(
-        "Invalid component type '{}'", componentTypeString(image.header().memoryComponentType())
-      );
-      return componentStats;
-    }
-    }
+    componentStats.emplace_back(computeImageStatistics(image, i));
   }
 
   return componentStats;
 }
 
+ComponentStats computeImageStatistics(const Image& image, uint32_t comp)
+{
+  switch (image.header().memoryComponentType())
+  {
+  case ComponentType::Int8:
+    return computeComponentStatistics<int8_t>(image, comp);
+  case ComponentType::UInt8:
+    return computeComponentStatistics<uint8_t>(image, comp);
+  case ComponentType::Int16:
+    return computeComponentStatistics<int16_t>(image, comp);
+  case ComponentType::UInt16:
+    return computeComponentStatistics<uint16_t>(image, comp);
+  case ComponentType::Int32:
+    return computeComponentStatistics<int32_t>(image, comp);
+  case ComponentType::UInt32:
+    return computeComponentStatistics<uint32_t>(image, comp);
+  case ComponentType::Float32:
+    return computeComponentStatistics<float>(image, comp);
+  default:
+  {
+    spdlog::error(
+      "Invalid component type '{}'", componentTypeString(image.header().memoryComponentType())
+    );
+    return ComponentStats{};
+  }
+  }
+}
+
+HistogramCache computeImageHistogram(
+  const Image& image, uint32_t comp, int numBins, double rangeMin, double rangeMax
+)
+{
+  switch (image.header().memoryComponentType())
+  {
+  case ComponentType::Int8:
+    return computeComponentHistogram<int8_t>(image, comp, numBins, rangeMin, rangeMax);
+  case ComponentType::UInt8:
+    return computeComponentHistogram<uint8_t>(image, comp, numBins, rangeMin, rangeMax);
+  case ComponentType::Int16:
+    return computeComponentHistogram<int16_t>(image, comp, numBins, rangeMin, rangeMax);
+  case ComponentType::UInt16:
+    return computeComponentHistogram<uint16_t>(image, comp, numBins, rangeMin, rangeMax);
+  case ComponentType::Int32:
+    return computeComponentHistogram<int32_t>(image, comp, numBins, rangeMin, rangeMax);
+  case ComponentType::UInt32:
+    return computeComponentHistogram<uint32_t>(image, comp, numBins, rangeMin, rangeMax);
+  case ComponentType::Float32:
+    return computeComponentHistogram<float>(image, comp, numBins, rangeMin, rangeMax);
+  default:
+  {
+    spdlog::error(
+      "Invalid component type '{}'", componentTypeString(image.header().memoryComponentType())
+    );
+    return HistogramCache{};
+  }
+  }
+}
+
 double bumpQuantile(
   const Image& image,
   uint32_t comp,
@@ -411,7 +466,9 @@ double bumpQuantile(
     return currentQuantile;
   }
 
-  const std::size_t N = image.header().numPixels();
+  // Number of values in the component (NaN values are excluded from the quantile index)
+  const std::size_t N = image.hasSortedBuffers() ? image.header().numPixels()
+                                                 : image.quantileIndex(comp).numElements();
 
   double newQuant = attemptedQuantile;
   double oldValue = currentValue;
@@ -39,8 +39,28 @@ std::pair<double, double> componentRange(const ComponentType& componentType);
 
 std::pair<glm::vec3, glm::vec3> computeWorldMinMaxCornersOfImage(const Image& image);
 
+/**
+ * @brief Compute statistics of all image components.
+ * @see computeImageStatistics(const Image&, uint32_t)
+ */
 std::vector<ComponentStats> computeImageStatistics(const Image& image);
 
+/**
+ * @brief Compute statistics of one image component. The minimum, maximum, sum, mean, and
+ * variance are computed in a parallel pass over the component buffer; the percentiles are
+ * computed from the sorted component buffer if the image retains it, otherwise from the
+ * quantile index of the component.
+ */
+ComponentStats computeImageStatistics(const Image& image, uint32_t comp);
+
+/**
+ * @brief Compute the histogram of one image component in a parallel pass over the component
+ * buffer. The histogram has \c numBins bins of equal width over [rangeMin, rangeMax].
+ */
+HistogramCache computeImageHistogram(
+  const Image& image, uint32_t comp, int numBins, double rangeMin, double rangeMax
+);
+
 double bumpQuantile(
   const Image& image,
   uint32_t comp,
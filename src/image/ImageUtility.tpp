@@ -4,7 +4,9 @@
 #include "common/Exception.hpp"
 #include "common/Types.h"
 #include "common/filesystem.h"
+#include "common/ParallelFor.h"
 #include "image/Image.h"
+#include "image/ImageCastHelper.tpp"
 
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkCastImageFilter.h>
@@ -581,40 +583,6 @@ QuantileOfValue convertValueToQuantile(const std::span<const T> dataSorted, T va
   return Q;
 }
 
-template<typename T>
-ComponentStats computeImageStatistics(const std::span<const T> dataSorted)
-{
-  ComponentStats stats;
-  stats.m_minimum = static_cast<double>(dataSorted.front());
-  stats.m_maximum = static_cast<double>(dataSorted.back());
-
-  for (std::size_t i = 0; i <= 100; ++i)
-  {
-    const double quantile = static_cast<double>(i) / 100.0;
-    const T value = convertQuantileToValue(dataSorted, quantile);
-    stats.m_quantiles[i] = static_cast<double>(value);
-  }
-
-  const std::size_t N = dataSorted.size();
-  stats.m_sum = std::accumulate(std::begin(dataSorted), std::end(dataSorted), 0.0);
-  stats.m_mean = stats.m_sum / N;
-
-  std::vector<double> diff(N);
-  std::transform(
-    std::begin(dataSorted),
-    std::end(dataSorted),
-    std::begin(diff),
-    [&stats](double x) { return x - stats.m_mean; }
-  );
-
-  const double squaredSum
-    = std::inner_product(std::begin(diff), std::end(diff), std::begin(diff), 0.0);
-  stats.m_variance = squaredSum / N;
-  stats.m_stdDeviation = std::sqrt(stats.m_variance);
-
-  return stats;
-}
-
 /*
 template<typename T>
 std::vector<ComponentStats<T>> computeImageStatistics(const Image& image)
@@ -1180,149 +1148,210 @@ vtkSmartPointer<vtkImageData> convertItkImageToVtkImageData(
   return static_cast<vtkImageData*>(conversionFilter->GetOutput());
 }
 
-template<typename ReadComponentType>
-bool loadImage(
-  const fs::path& fileName,
-  std::size_t numPixels,
-  uint32_t numComps,
+/// Maximum size of the slab of an image file that is read at once when streaming
+static constexpr std::size_t MAX_STREAMING_SLAB_SIZE_IN_BYTES = (std::size_t{64} << 20);
+
+/**
+ * @brief Read the components of an image file with source component type \c SrcCompType into
+ * buffers with destination component type \c DstCompType.
+ * @see readImageComponents
+ */
+template<typename SrcCompType, typename DstCompType>
+bool readImageComponents_dispatch(
+  itk::ImageIOBase* imageIo,
   uint32_t numCompsToLoad,
-  bool isVectorImage,
   const Image::MultiComponentBufferType bufferType,
-  std::function<bool(const void* buffer, std::size_t numElements)> loadBuffer
+  std::vector<std::vector<DstCompType>>& components
 )
 {
-  using ReadImageType = itk::Image<ReadComponentType, 3>;
+  const unsigned int numDims = imageIo->GetNumberOfDimensions();
+  const std::size_t numCompsOnDisk = imageIo->GetNumberOfComponents();
+  const std::size_t numPixels = static_cast<std::size_t>(imageIo->GetImageSizeInPixels());
 
-  if (isVectorImage)
+  if (0 == numDims || 0 == numPixels || numCompsOnDisk < numCompsToLoad)
   {
-    // Load multi-component image
-    constexpr bool pixelIsVector = true;
-    typename itk::ImageBase<3>::Pointer baseImage = readImage<ReadComponentType, 3, pixelIsVector>(
-      fileName.string()
-    );
-    if (!baseImage)
-    {
-      spdlog::error("Unable to read vector ImageBase for image {}", fileName);
-      return false;
-    }
-
-    // Split the base image into component images. Load a maximum of MAX_COMPS components
-    // for an image with interleaved component buffers.
-    std::vector<typename ReadImageType::Pointer> componentImages
-      = splitImageIntoComponents<ReadComponentType, 3>(baseImage);
+    spdlog::error("Invalid dimensions or components of image file {}", imageIo->GetFileName());
+    return false;
+  }
 
-    if (componentImages.size() < numCompsToLoad)
-    {
-      spdlog::error(
-        "Only {} image components were loaded, but {} components were expected",
-        componentImages.size(),
-        numCompsToLoad
-      );
-      return false;
-    }
+  const bool interleaved = (Image::MultiComponentBufferType::InterleavedImage == bufferType);
 
-    // If interleaving vector components, then create a single buffer
-    std::unique_ptr<ReadComponentType[]> allComponentBuffers = nullptr;
+  // Allocate the destination buffers at their final size:
+  components.clear();
 
-    if (Image::MultiComponentBufferType::InterleavedImage == bufferType)
+  if (interleaved)
+  {
+    components.emplace_back(numPixels * numCompsToLoad);
+  }
+  else
+  {
+    for (uint32_t c = 0; c < numCompsToLoad; ++c)
     {
-      allComponentBuffers = std::make_unique<ReadComponentType[]>(numPixels * numCompsToLoad);
-      if (!allComponentBuffers)
-      {
-        spdlog::error("Null buffer holding all components of image file {}", fileName);
-        return false;
-      }
+      components.emplace_back(numPixels);
     }
+  }
 
-    // Load the buffers from the component images
-    for (uint32_t i = 0; i < numCompsToLoad; ++i)
-    {
-      if (!componentImages[i])
-      {
-        spdlog::error("Null vector image component {} for image file {}", i, fileName);
-        return false;
-      }
+  // Slabs span the full extent of the image along all but the last dimension
+  const std::size_t numSlices = imageIo->GetDimensions(numDims - 1);
+  const std::size_t sliceSize = numPixels / numSlices;
+  const std::size_t sliceSizeInBytes = sliceSize * numCompsOnDisk * sizeof(SrcCompType);
 
-      const ReadComponentType* buffer = componentImages[i]->GetBufferPointer();
-      if (!buffer)
-      {
-        spdlog::error("Null buffer of vector image component {} for image file {}", i, fileName);
-        return false;
-      }
+  // Compressed files are decompressed from the start on every streamed read,
+  // so they are read in one slab
+  const std::string fileName = imageIo->GetFileName();
+  const bool isCompressed = fileName.ends_with(".gz") || fileName.ends_with(".GZ");
+  const bool stream = imageIo->CanStreamRead() && !isCompressed;
 
-      switch (bufferType)
-      {
-      case Image::MultiComponentBufferType::SeparateImages:
-      {
-        if (!loadBuffer(static_cast<const void*>(buffer), numPixels))
-        {
-          spdlog::error(
-            "Error loading separated image component buffer {} for image file {}", i, fileName
-          );
-          return false;
-        }
-        break;
-      }
-      case Image::MultiComponentBufferType::InterleavedImage:
-      {
-        // Fill the interleaved buffer
-        for (std::size_t p = 0; p < numPixels; ++p)
-        {
-          allComponentBuffers[numComps * p + i] = buffer[p];
-        }
-        break;
-      }
-      }
-    }
+  const std::size_t slicesPerSlab
+    = stream ? std::clamp(
+                 MAX_STREAMING_SLAB_SIZE_IN_BYTES / sliceSizeInBytes, std::size_t{1}, numSlices
+               )
+             : numSlices;
 
-    if (Image::MultiComponentBufferType::InterleavedImage == bufferType)
-    {
-      const std::size_t numElements = numPixels * numComps;
+  spdlog::debug(
+    "Reading image {} in slabs of {} of {} slices (streaming: {})",
+    fileName,
+    slicesPerSlab,
+    numSlices,
+    stream
+  );
 
-      if (!loadBuffer(static_cast<const void*>(allComponentBuffers.get()), numElements))
-      {
-        spdlog::error("Error loading interleaved buffer for image file {}", fileName);
-        return false;
-      }
-    }
-  }
-  else
+  std::vector<SrcCompType> slab(slicesPerSlab * sliceSize * numCompsOnDisk);
+
+  for (std::size_t firstSlice = 0; firstSlice < numSlices; firstSlice += slicesPerSlab)
   {
-    // Load scalar, single-component image
-    constexpr bool pixelIsVector = false;
+    const std::size_t numSlabSlices = std::min(slicesPerSlab, numSlices - firstSlice);
 
-    typename itk::ImageBase<3>::Pointer baseImage = readImage<ReadComponentType, 3, pixelIsVector>(
-      fileName.string()
-    );
-    if (!baseImage)
+    itk::ImageIORegion region(numDims);
+    for (unsigned int d = 0; d + 1 < numDims; ++d)
     {
-      spdlog::error("Unable to read ImageBase from file {}", fileName);
-      return false;
+      region.SetIndex(d, 0);
+      region.SetSize(d, imageIo->GetDimensions(d));
     }
+    region.SetIndex(numDims - 1, static_cast<itk::ImageIORegion::IndexValueType>(firstSlice));
+    region.SetSize(numDims - 1, numSlabSlices);
 
-    typename ReadImageType::Pointer image = downcastImageBaseToImage<ReadComponentType, 3>(baseImage
-    );
-    if (!image)
+    try
     {
-      spdlog::error("Null image for file {} following downcast from ImageBase", fileName);
-      return false;
+      imageIo->SetIORegion(region);
+      imageIo->Read(static_cast<void*>(slab.data()));
     }
-
-    const ReadComponentType* buffer = image->GetBufferPointer();
-    if (!buffer)
+    catch (const itk::ExceptionObject& e)
     {
-      spdlog::error("Null buffer of scalar image file {}", fileName);
+      spdlog::error("Exception while reading image {}: {}", fileName, e.what());
       return false;
     }
-
-    if (!loadBuffer(static_cast<const void*>(buffer), numPixels))
+    catch (...)
     {
-      spdlog::error("Error loading buffer for image file {}", fileName);
+      spdlog::error("Unknown exception while reading image {}", fileName);
       return false;
     }
+
+    // Cast the pixels of the slab into the destination buffers:
+    const std::size_t firstPixel = firstSlice * sliceSize;
+
+    parallel::forEachChunk(
+      numSlabSlices * sliceSize,
+      std::size_t{1} << 16,
+      [&](std::size_t, std::size_t begin, std::size_t end)
+      {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+          const SrcCompType* src = slab.data() + i * numCompsOnDisk;
+          const std::size_t p = firstPixel + i;
+
+          for (uint32_t c = 0; c < numCompsToLoad; ++c)
+          {
+            const DstCompType value = clampCast<SrcCompType, DstCompType>(src[c]);
+
+            if (interleaved)
+            {
+              components[0][numCompsToLoad * p + c] = value;
+            }
+            else
+            {
+              components[c][p] = value;
+            }
+          }
+        }
+      }
+    );
   }
 
   return true;
 }
 
+/**
+ * @brief Read the components of an image file directly into buffers of the component type
+ * used in memory. The file is read in its own component type: no intermediate copy of the image
+ * with a wider component type is created. If the image I/O supports streaming, the file is read
+ * in slabs of slices, so that the peak memory used is close to that of the destination buffers.
+ *
+ * @param[in] imageIo Image I/O whose image information has been read
+ * @param[in] numCompsToLoad Number of components to load, starting from the first
+ * @param[in] bufferType Load components into separate buffers or a single interleaved buffer
+ * @param[out] components Destination component buffers
+ *
+ * @return True iff the image was read
+ */
+template<typename DstCompType>
+bool readImageComponents(
+  itk::ImageIOBase* imageIo,
+  uint32_t numCompsToLoad,
+  const Image::MultiComponentBufferType bufferType,
+  std::vector<std::vector<DstCompType>>& components
+)
+{
+  using CType = itk::IOComponentEnum;
+
+  if (!imageIo)
+  {
+    spdlog::error("Null image I/O when reading image components");
+    return false;
+  }
+
+  switch (imageIo->GetComponentType())
+  {
+  case CType::UCHAR:
+    return readImageComponents_dispatch<uint8_t>(imageIo, numCompsToLoad, bufferType, components);
+  case CType::CHAR:
+    return readImageComponents_dispatch<int8_t>(imageIo, numCompsToLoad, bufferType, components);
+  case CType::USHORT:
+    return readImageComponents_dispatch<uint16_t>(imageIo, numCompsToLoad, bufferType, components);
+  case CType::SHORT:
+    return readImageComponents_dispatch<int16_t>(imageIo, numCompsToLoad, bufferType, components);
+  case CType::UINT:
+    return readImageComponents_dispatch<uint32_t>(imageIo, numCompsToLoad, bufferType, components);
+  case CType::INT:
+    return readImageComponents_dispatch<int32_t>(imageIo, numCompsToLoad, bufferType, components);
+  case CType::ULONG:
+    return readImageComponents_dispatch<unsigned long>(
+      imageIo, numCompsToLoad, bufferType, components
+    );
+  case CType::LONG:
+    return readImageComponents_dispatch<long>(imageIo, numCompsToLoad, bufferType, components);
+  case CType::ULONGLONG:
+    return readImageComponents_dispatch<unsigned long long>(
+      imageIo, numCompsToLoad, bufferType, components
+    );
+  case CType::LONGLONG:
+    return readImageComponents_dispatch<long long>(
+      imageIo, numCompsToLoad, bufferType, components
+    );
+  case CType::FLOAT:
+    return readImageComponents_dispatch<float>(imageIo, numCompsToLoad, bufferType, components);
+  case CType::DOUBLE:
+    return readImageComponents_dispatch<double>(imageIo, numCompsToLoad, bufferType, components);
+  case CType::LDOUBLE:
+    return readImageComponents_dispatch<long double>(
+      imageIo, numCompsToLoad, bufferType, components
+    );
+  default:
+  {
+    spdlog::error("Unknown component type in image file {}", imageIo->GetFileName());
+    return false;
+  }
+  }
+}
+
 #endif // IMAGE_UTILITY_TPP
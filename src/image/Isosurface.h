@@ -5,6 +5,7 @@
 
 #include <glm/vec3.hpp>
 
+#include <cstddef>
 #include <string>
 
 /**
@@ -29,6 +30,9 @@ struct SurfaceQuality
 class Isosurface
 {
 public:
+  /// Maximum number of triangles of the mesh, to which larger meshes are decimated
+  static constexpr std::size_t sk_maxMeshTriangles = 1000000;
+
   // Isosurface() = default;
   // Isosurface(const Isosurface&) = delete;
   // Isosurface(Isosurface&&) = default;
@@ -47,8 +51,9 @@ public:
   bool showIn2d = true;              //!< Show in 2D slice views
   float edgeStrength = 0.0f;         //!< Strength of edge outline, where 0.0f disables edges
 
-  MeshRecord mesh;         //!< Mesh record of the isosurface
-  bool meshInSync = false; //!< Is the mesh in sync with the isosurface value?
+  MeshRecord mesh;          //!< Mesh record of the isosurface
+  bool meshInSync = false;  //!< Is the mesh in sync with the isosurface value?
+  bool meshPending = false; //!< Is a mesh being generated? At most one generation runs at a time.
 
   glm::vec3 ambientColor() const { return this->material.ambient * this->color; }
 
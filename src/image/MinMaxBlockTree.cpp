@@ -0,0 +1,263 @@
+#include "image/MinMaxBlockTree.h"
+#include "image/ComponentDispatch.h"
+#include "image/Image.h"
+
+#include "common/ParallelFor.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+namespace
+{
+/// Minimum number of blocks whose ranges are computed by a thread
+constexpr std::size_t sk_minBlocksPerChunk = 64;
+
+constexpr float sk_lowest = std::numeric_limits<float>::lowest();
+
+constexpr MinMaxBlockTree::Range sk_emptyRange{
+  std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()
+};
+
+uint32_t numBlocksAlongAxis(uint32_t numVoxels)
+{
+  // Number of cells, rounded up to whole blocks
+  const uint32_t numCells = (numVoxels < 2) ? 0 : numVoxels - 1;
+  return (numCells + MinMaxBlockTree::sk_blockSize - 1) / MinMaxBlockTree::sk_blockSize;
+}
+
+std::size_t nodeIndex(const glm::uvec3& dims, uint32_t x, uint32_t y, uint32_t z)
+{
+  return (static_cast<std::size_t>(z) * dims.y + y) * dims.x + x;
+}
+
+void mergeRange(MinMaxBlockTree::Range& range, const MinMaxBlockTree::Range& other)
+{
+  range.m_min = std::min(range.m_min, other.m_min);
+  range.m_max = std::max(range.m_max, other.m_max);
+}
+
+/// Compute the range of each block of one image component, which may be interleaved with the
+/// other components
+template<typename T>
+void computeBlockRanges(
+  const T* data,
+  std::size_t stride,
+  const glm::uvec3& imageDims,
+  const glm::uvec3& gridDims,
+  std::vector<MinMaxBlockTree::Range>& ranges
+)
+{
+  const std::size_t B = MinMaxBlockTree::sk_blockSize;
+
+  auto computeRanges = [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+  {
+    for (std::size_t b = begin; b < end; ++b)
+    {
+      const std::size_t bx = b % gridDims.x;
+      const std::size_t by = (b / gridDims.x) % gridDims.y;
+      const std::size_t bz = b / (static_cast<std::size_t>(gridDims.x) * gridDims.y);
+
+      // Voxels at the corners of the block's cells, including the voxels of its upper faces
+      const std::size_t x1 = std::min((bx + 1) * B, static_cast<std::size_t>(imageDims.x - 1));
+      const std::size_t y1 = std::min((by + 1) * B, static_cast<std::size_t>(imageDims.y - 1));
+      const std::size_t z1 = std::min((bz + 1) * B, static_cast<std::size_t>(imageDims.z - 1));
+
+      MinMaxBlockTree::Range range = sk_emptyRange;
+
+      for (std::size_t z = bz * B; z <= z1; ++z)
+      {
+        for (std::size_t y = by * B; y <= y1; ++y)
+        {
+          const std::size_t row = (z * imageDims.y + y) * imageDims.x;
+
+          for (std::size_t x = bx * B; x <= x1; ++x)
+          {
+            float value = static_cast<float>(data[(row + x) * stride]);
+
+            if constexpr (std::is_floating_point_v<T>)
+            {
+              if (std::isnan(value))
+              {
+                value = sk_lowest;
+              }
+            }
+
+            range.m_min = std::min(range.m_min, value);
+            range.m_max = std::max(range.m_max, value);
+          }
+        }
+      }
+
+      ranges[b] = range;
+    }
+  };
+
+  parallel::forEachChunk(ranges.size(), sk_minBlocksPerChunk, computeRanges);
+}
+
+} // namespace
+
+MinMaxBlockTree::MinMaxBlockTree(const Image& image, uint32_t component)
+  : m_imageDims(glm::uvec3{image.header().pixelDimensions()})
+{
+  const uint32_t numComps = image.header().numComponentsPerPixel();
+
+  if (numComps <= component)
+  {
+    spdlog::error("Invalid image component {} when building min-max block tree", component);
+    return;
+  }
+
+  const glm::uvec3 gridDims{
+    numBlocksAlongAxis(m_imageDims.x),
+    numBlocksAlongAxis(m_imageDims.y),
+    numBlocksAlongAxis(m_imageDims.z)
+  };
+
+  if (0 == gridDims.x || 0 == gridDims.y || 0 == gridDims.z)
+  {
+    return;
+  }
+
+  Level& blocks = m_levels.emplace_back();
+  blocks.m_dims = gridDims;
+  blocks.m_ranges.resize(static_cast<std::size_t>(gridDims.x) * gridDims.y * gridDims.z);
+
+  const bool valid = visitComponentBuffer(
+    image,
+    component,
+    [&](const auto* data, std::size_t stride)
+    { computeBlockRanges(data, stride, m_imageDims, gridDims, blocks.m_ranges); }
+  );
+
+  if (!valid)
+  {
+    spdlog::error(
+      "Invalid component type '{}' when building min-max block tree",
+      componentTypeString(image.header().memoryComponentType())
+    );
+    m_levels.clear();
+    return;
+  }
+
+  // Merge 2^3 nodes of each level into the level above, until the root is reached
+  while (1 < m_levels.back().m_ranges.size())
+  {
+    const glm::uvec3 childDims = m_levels.back().m_dims;
+    const glm::uvec3 dims = (childDims + 1u) / 2u;
+
+    Level level;
+    level.m_dims = dims;
+    level.m_ranges.resize(static_cast<std::size_t>(dims.x) * dims.y * dims.z, sk_emptyRange);
+
+    const std::vector<Range>& children = m_levels.back().m_ranges;
+
+    for (uint32_t z = 0; z < childDims.z; ++z)
+    {
+      for (uint32_t y = 0; y < childDims.y; ++y)
+      {
+        for (uint32_t x = 0; x < childDims.x; ++x)
+        {
+          mergeRange(
+            level.m_ranges[nodeIndex(dims, x / 2, y / 2, z / 2)],
+            children[nodeIndex(childDims, x, y, z)]
+          );
+        }
+      }
+    }
+
+    m_levels.emplace_back(std::move(level));
+  }
+}
+
+bool MinMaxBlockTree::isEmpty() const
+{
+  return m_levels.empty();
+}
+
+const glm::uvec3& MinMaxBlockTree::imageDims() const
+{
+  return m_imageDims;
+}
+
+const glm::uvec3& MinMaxBlockTree::blockGridDims() const
+{
+  static const glm::uvec3 sk_noBlocks{0u};
+  return m_levels.empty() ? sk_noBlocks : m_levels.front().m_dims;
+}
+
+std::size_t MinMaxBlockTree::numBlocks() const
+{
+  return m_levels.empty() ? 0 : m_levels.front().m_ranges.size();
+}
+
+const MinMaxBlockTree::Range& MinMaxBlockTree::blockRange(uint32_t block) const
+{
+  return m_levels.front().m_ranges.at(block);
+}
+
+std::vector<uint32_t> MinMaxBlockTree::activeBlocks(float isoValue) const
+{
+  std::vector<uint32_t> nodes;
+
+  if (m_levels.empty() || !m_levels.back().m_ranges.front().straddles(isoValue))
+  {
+    return nodes;
+  }
+
+  // Descend from the root, keeping the nodes of each level whose range straddles the isovalue
+  nodes.push_back(0);
+  std::vector<uint32_t> children;
+
+  for (std::size_t L = m_levels.size() - 1; 0 < L; --L)
+  {
+    const Level& level = m_levels[L - 1];
+    const glm::uvec3 dims = m_levels[L].m_dims;
+
+    children.clear();
+
+    for (const uint32_t node : nodes)
+    {
+      const uint32_t x = node % dims.x;
+      const uint32_t y = (node / dims.x) % dims.y;
+      const uint32_t z = node / (dims.x * dims.y);
+
+      for (uint32_t cz = 2 * z; cz < std::min(2 * z + 2, level.m_dims.z); ++cz)
+      {
+        for (uint32_t cy = 2 * y; cy < std::min(2 * y + 2, level.m_dims.y); ++cy)
+        {
+          for (uint32_t cx = 2 * x; cx < std::min(2 * x + 2, level.m_dims.x); ++cx)
+          {
+            const std::size_t child = nodeIndex(level.m_dims, cx, cy, cz);
+
+            if (level.m_ranges[child].straddles(isoValue))
+            {
+              children.push_back(static_cast<uint32_t>(child));
+            }
+          }
+        }
+      }
+    }
+
+    nodes.swap(children);
+  }
+
+  std::sort(std::begin(nodes), std::end(nodes));
+  return nodes;
+}
+
+std::size_t MinMaxBlockTree::numBytes() const
+{
+  std::size_t numBytes = 0;
+
+  for (const Level& level : m_levels)
+  {
+    numBytes += level.m_ranges.size() * sizeof(Range);
+  }
+
+  return numBytes;
+}
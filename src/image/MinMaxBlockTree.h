@@ -0,0 +1,85 @@
+#ifndef MIN_MAX_BLOCK_TREE_H
+#define MIN_MAX_BLOCK_TREE_H
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Image;
+
+/**
+ * @brief Tree of the minimum and maximum values of blocks of an image component. It is used to
+ * find the blocks that an isosurface passes through without visiting their voxels.
+ *
+ * The cells of the image (the cubes with corners at eight neighboring voxels) are divided into
+ * blocks of 8^3 cells. The range of a block covers all voxels at the corners of its cells, so
+ * adjacent blocks share the voxels of their common face. Each level above the blocks merges the
+ * ranges of 2^3 nodes of the level below, up to a single root node.
+ *
+ * NaN values are treated as lower than all other values, which is how they are classified by
+ * marching cubes.
+ */
+class MinMaxBlockTree
+{
+public:
+  /// Side length of the blocks, in cells
+  static constexpr uint32_t sk_blockSize = 8;
+
+  /// Range of values of a node of the tree
+  struct Range
+  {
+    float m_min; //!< Minimum value
+    float m_max; //!< Maximum value
+
+    /// Does a cell in the node have corners on both sides of the isovalue, i.e. corners with
+    /// values below the isovalue and corners with values at or above it?
+    bool straddles(float isoValue) const { return m_min < isoValue && isoValue <= m_max; }
+  };
+
+  /// Construct an empty tree
+  MinMaxBlockTree() = default;
+
+  /// Build the tree of an image component. The ranges of the blocks are computed in parallel.
+  MinMaxBlockTree(const Image& image, uint32_t component);
+
+  /// Does the tree have no blocks? This is the case for images with fewer than two voxels along
+  /// an axis, which have no cells.
+  bool isEmpty() const;
+
+  /// Dimensions of the image, in voxels
+  const glm::uvec3& imageDims() const;
+
+  /// Dimensions of the grid of blocks
+  const glm::uvec3& blockGridDims() const;
+
+  /// Number of blocks
+  std::size_t numBlocks() const;
+
+  /// Range of values of a block
+  const Range& blockRange(uint32_t block) const;
+
+  /**
+   * @brief Find the blocks with a cell that has corners on both sides of an isovalue. Subtrees
+   * whose range does not straddle the isovalue are skipped.
+   * @return Indices of the blocks, in increasing order
+   */
+  std::vector<uint32_t> activeBlocks(float isoValue) const;
+
+  /// Number of bytes used by the ranges of the tree
+  std::size_t numBytes() const;
+
+private:
+  /// Level of the tree
+  struct Level
+  {
+    glm::uvec3 m_dims{0u};       //!< Dimensions of the grid of nodes
+    std::vector<Range> m_ranges; //!< Range of each node
+  };
+
+  glm::uvec3 m_imageDims{0u};  //!< Image dimensions, in voxels
+  std::vector<Level> m_levels; //!< Levels of the tree, from the blocks up to the root
+};
+
+#endif // MIN_MAX_BLOCK_TREE_H
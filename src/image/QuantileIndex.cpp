@@ -0,0 +1,225 @@
+#include "image/QuantileIndex.h"
+
+#include "common/Exception.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+
+QuantileIndex::QuantileIndex(std::vector<Bin> bins, bool isExact, bool interpolate)
+  : m_bins(std::move(bins))
+  , m_isExact(isExact)
+  , m_interpolate(interpolate)
+{
+}
+
+std::size_t QuantileIndex::numElements() const
+{
+  return m_bins.empty() ? 0 : static_cast<std::size_t>(m_bins.back().m_cumCount);
+}
+
+std::size_t QuantileIndex::numBins() const
+{
+  return m_bins.size();
+}
+
+std::size_t QuantileIndex::sizeInBytes() const
+{
+  return sizeof(QuantileIndex) + m_bins.capacity() * sizeof(Bin);
+}
+
+bool QuantileIndex::isExact() const
+{
+  return m_isExact;
+}
+
+double QuantileIndex::minimum() const
+{
+  return m_bins.empty() ? 0.0 : m_bins.front().m_min;
+}
+
+double QuantileIndex::maximum() const
+{
+  return m_bins.empty() ? 0.0 : m_bins.back().m_max;
+}
+
+const std::vector<QuantileIndex::Bin>& QuantileIndex::bins() const
+{
+  return m_bins;
+}
+
+uint64_t QuantileIndex::countBefore(std::size_t b) const
+{
+  return (0 == b) ? 0 : m_bins[b - 1].m_cumCount;
+}
+
+double QuantileIndex::valueAtRank(std::size_t rank) const
+{
+  if (m_bins.empty())
+  {
+    spdlog::error("Quantile index has zero elements");
+    throw_debug("Quantile index is empty")
+  }
+
+  // First bin whose cumulative count exceeds the rank:
+  const auto it = std::upper_bound(
+    std::begin(m_bins),
+    std::end(m_bins),
+    static_cast<uint64_t>(rank),
+    [](uint64_t r, const Bin& bin) { return r < bin.m_cumCount; }
+  );
+
+  if (std::end(m_bins) == it)
+  {
+    return m_bins.back().m_max;
+  }
+
+  const std::size_t b = static_cast<std::size_t>(std::distance(std::begin(m_bins), it));
+  const uint64_t start = countBefore(b);
+  const uint64_t count = it->m_cumCount - start;
+
+  if (it->m_min == it->m_max || count < 2)
+  {
+    return it->m_min;
+  }
+
+  // Values in the bin are modeled as evenly spaced between its min and max
+  const double t = static_cast<double>(rank - start) / static_cast<double>(count - 1);
+  return it->m_min + t * (it->m_max - it->m_min);
+}
+
+std::size_t QuantileIndex::countLess(double value) const
+{
+  // First bin whose maximum is not less than the value:
+  const auto it = std::lower_bound(
+    std::begin(m_bins),
+    std::end(m_bins),
+    value,
+    [](const Bin& bin, double v) { return bin.m_max < v; }
+  );
+
+  if (std::end(m_bins) == it)
+  {
+    return numElements();
+  }
+
+  const std::size_t b = static_cast<std::size_t>(std::distance(std::begin(m_bins), it));
+  const uint64_t start = countBefore(b);
+
+  if (value <= it->m_min)
+  {
+    return static_cast<std::size_t>(start);
+  }
+
+  // The value lies in (min, max] of a bin holding at least two distinct values
+  const uint64_t count = it->m_cumCount - start;
+  const double t = (value - it->m_min) / (it->m_max - it->m_min);
+  const auto numLess = static_cast<uint64_t>(std::ceil(t * static_cast<double>(count - 1)));
+
+  return static_cast<std::size_t>(start + std::clamp<uint64_t>(numLess, 1, count - 1));
+}
+
+std::size_t QuantileIndex::countLessOrEqual(double value) const
+{
+  // First bin whose maximum is greater than the value:
+  const auto it = std::upper_bound(
+    std::begin(m_bins),
+    std::end(m_bins),
+    value,
+    [](double v, const Bin& bin) { return v < bin.m_max; }
+  );
+
+  if (std::end(m_bins) == it)
+  {
+    return numElements();
+  }
+
+  const std::size_t b = static_cast<std::size_t>(std::distance(std::begin(m_bins), it));
+  const uint64_t start = countBefore(b);
+
+  if (value < it->m_min)
+  {
+    return static_cast<std::size_t>(start);
+  }
+
+  // The value lies in [min, max) of a bin holding at least two distinct values
+  const uint64_t count = it->m_cumCount - start;
+  const double t = (value - it->m_min) / (it->m_max - it->m_min);
+  const auto numLessOrEqual
+    = static_cast<uint64_t>(std::floor(t * static_cast<double>(count - 1))) + 1;
+
+  return static_cast<std::size_t>(start + std::clamp<uint64_t>(numLessOrEqual, 1, count - 1));
+}
+
+double QuantileIndex::quantileToValue(double quantile) const
+{
+  const std::size_t N = numElements();
+
+  if (0 == N)
+  {
+    spdlog::error("Quantile index has zero elements");
+    throw_debug("Quantile index is empty")
+  }
+
+  if (1 == N)
+  {
+    return m_bins.front().m_min;
+  }
+
+  constexpr int64_t indexMin = 0;
+  const int64_t indexMax = static_cast<int64_t>(N) - 1;
+
+  // Interpolated index corresponding to quantile
+  const double index = (1.0 - quantile) * -0.5 + quantile * (static_cast<double>(N) - 0.5);
+
+  const auto indexLeft
+    = static_cast<std::size_t>(std::max(static_cast<int64_t>(std::floor(index)), indexMin));
+
+  if (!m_interpolate)
+  {
+    return valueAtRank(indexLeft);
+  }
+
+  const auto indexRight
+    = static_cast<std::size_t>(std::min(static_cast<int64_t>(std::ceil(index)), indexMax));
+
+  const double valueLeft = valueAtRank(indexLeft);
+  const double valueRight = valueAtRank(indexRight);
+  const double t = index - static_cast<double>(indexLeft);
+
+  return (1.0 - t) * valueLeft + t * valueRight;
+}
+
+QuantileOfValue QuantileIndex::valueToQuantile(double value) const
+{
+  const std::size_t N = numElements();
+
+  if (0 == N)
+  {
+    spdlog::error("Quantile index has zero elements");
+    throw_debug("Quantile index is empty")
+  }
+
+  QuantileOfValue Q;
+
+  const std::size_t lowerIndex = countLess(value);
+
+  if (N == lowerIndex)
+  {
+    // value is greater than the largest indexed value
+    Q.foundValue = false;
+    return Q;
+  }
+
+  const std::size_t upperIndex = countLessOrEqual(value);
+
+  Q.foundValue = true;
+  Q.lowerIndex = lowerIndex;
+  Q.upperIndex = upperIndex;
+  Q.lowerQuantile = static_cast<double>(lowerIndex) / static_cast<double>(N);
+  Q.upperQuantile = static_cast<double>(upperIndex) / static_cast<double>(N);
+  Q.lowerValue = valueAtRank(lowerIndex);
+  Q.upperValue = valueAtRank(std::min(upperIndex, N - 1));
+  return Q;
+}
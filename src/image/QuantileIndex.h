@@ -0,0 +1,99 @@
+#ifndef QUANTILE_INDEX_H
+#define QUANTILE_INDEX_H
+
+#include "common/Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Compact index of the sorted order of the values of one image component. It answers
+ * rank, quantile, and value queries without holding a sorted copy of the component.
+ *
+ * The index is a list of the non-empty bins of a histogram of the component, each of which records
+ * the minimum and maximum values that fell into it along with the cumulative count of values.
+ *
+ * - For integer components, each bin holds a single value, so all queries are exact.
+ * - For floating-point components (and 32-bit integer components spanning a very wide range),
+ * bins hold values with a common key prefix. Values within a bin are modeled as evenly spaced
+ * between the bin's minimum and maximum. The error of a returned value is bounded by the width of
+ * its bin, which is relative to the magnitude of the value for floating-point components. Bins
+ * that hold a single distinct value (e.g. image background) remain exact.
+ *
+ * @see buildQuantileIndex in QuantileIndex.tpp for construction from a component buffer
+ */
+class QuantileIndex
+{
+public:
+  /// @brief Non-empty histogram bin
+  struct Bin
+  {
+    double m_min = 0.0;        //!< Minimum value in the bin
+    double m_max = 0.0;        //!< Maximum value in the bin
+    uint64_t m_cumCount = 0;   //!< Number of values in this bin and in all bins before it
+  };
+
+  QuantileIndex() = default;
+
+  /**
+   * @brief Construct from non-empty bins in increasing order of value
+   * @param[in] bins Bins, sorted by value, with inclusive cumulative counts
+   * @param[in] isExact True iff every bin holds a single distinct value
+   * @param[in] interpolate Interpolate between neighboring ranks when converting a quantile
+   * to a value. This is done for floating-point components but not for integer components.
+   */
+  QuantileIndex(std::vector<Bin> bins, bool isExact, bool interpolate);
+
+  /// @brief Number of values indexed
+  std::size_t numElements() const;
+
+  /// @brief Number of non-empty bins
+  std::size_t numBins() const;
+
+  /// @brief Memory used by the index
+  std::size_t sizeInBytes() const;
+
+  /// @brief True iff all queries are exact
+  bool isExact() const;
+
+  /// @brief Minimum indexed value (always exact)
+  double minimum() const;
+
+  /// @brief Maximum indexed value (always exact)
+  double maximum() const;
+
+  /// @brief Non-empty bins in increasing order of value
+  const std::vector<Bin>& bins() const;
+
+  /// @brief Value at a given rank (in range [0, N-1]) of the sorted component
+  double valueAtRank(std::size_t rank) const;
+
+  /// @brief Number of values strictly less than \c value
+  std::size_t countLess(double value) const;
+
+  /// @brief Number of values less than or equal to \c value
+  std::size_t countLessOrEqual(double value) const;
+
+  /**
+   * @brief Convert a quantile in [0, 1] to a component value. Matches the behavior of
+   * \c convertQuantileToValue on a sorted copy of the component.
+   */
+  double quantileToValue(double quantile) const;
+
+  /**
+   * @brief Convert a component value to its lower and upper quantiles. Matches the behavior of
+   * \c convertValueToQuantile on a sorted copy of the component.
+   */
+  QuantileOfValue valueToQuantile(double value) const;
+
+private:
+  /// Number of values in bins before bin \c b
+  uint64_t countBefore(std::size_t b) const;
+
+  std::vector<Bin> m_bins;
+  bool m_isExact = true;
+  bool m_interpolate = false;
+};
+
+#endif // QUANTILE_INDEX_H
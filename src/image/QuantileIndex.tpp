@@ -0,0 +1,296 @@
+#ifndef QUANTILE_INDEX_TPP
+#define QUANTILE_INDEX_TPP
+
+#include "common/ParallelFor.h"
+#include "image/QuantileIndex.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace quantile_index_detail
+{
+
+/// Maximum number of histogram bins for 32-bit components. With this many bins, the relative
+/// error of values in the index of a floating-point component is 2^-11 (about 0.05%).
+static constexpr int MAX_KEY_BITS = 20;
+static constexpr std::size_t MAX_NUM_KEYS = (std::size_t{1} << MAX_KEY_BITS);
+
+/// Minimum number of component values processed by a thread
+static constexpr std::size_t MIN_CHUNK_SIZE = (std::size_t{1} << 16);
+
+/// Each thread-local histogram must be amortized over this many values per bin
+static constexpr std::size_t MIN_VALUES_PER_KEY_PER_CHUNK = 4;
+
+/**
+ * @brief Map a float to an unsigned integer key that preserves the ordering of floats,
+ * keeping only the most significant \c MAX_KEY_BITS bits of the key
+ */
+inline uint32_t orderedFloatKey(float value)
+{
+  const uint32_t u = std::bit_cast<uint32_t>(value);
+  const uint32_t ordered = (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+  return ordered >> (32 - MAX_KEY_BITS);
+}
+
+/**
+ * @brief Histogram the values of a strided component buffer in parallel and compact the
+ * non-empty bins into a quantile index
+ *
+ * @tparam TrackMinMax If true, track the min and max value of each bin. If false, each bin holds
+ * the single value given by \c keyToValue.
+ * @param[in] keyOf Function mapping a value to its bin key in [0, numKeys)
+ * @param[in] keyToValue Function mapping a key to its value (used only if \c TrackMinMax is false)
+ */
+template<typename T, bool TrackMinMax, class KeyFn, class KeyToValueFn>
+QuantileIndex histogramToIndex(
+  const T* data,
+  std::size_t N,
+  std::size_t stride,
+  std::size_t numKeys,
+  KeyFn keyOf,
+  KeyToValueFn keyToValue,
+  bool interpolate
+)
+{
+  struct LocalHistogram
+  {
+    std::vector<uint64_t> counts;
+    std::vector<T> mins;
+    std::vector<T> maxs;
+  };
+
+  const std::size_t maxChunks
+    = std::max(std::size_t{1}, N / (MIN_VALUES_PER_KEY_PER_CHUNK * numKeys));
+
+  std::vector<LocalHistogram> locals(parallel::numChunks(N, MIN_CHUNK_SIZE, maxChunks));
+
+  parallel::forEachChunk(
+    N,
+    MIN_CHUNK_SIZE,
+    [&](std::size_t chunk, std::size_t begin, std::size_t end)
+    {
+      LocalHistogram& H = locals[chunk];
+      H.counts.assign(numKeys, 0);
+
+      if constexpr (TrackMinMax)
+      {
+        H.mins.assign(numKeys, std::numeric_limits<T>::max());
+        H.maxs.assign(numKeys, std::numeric_limits<T>::lowest());
+      }
+
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        const T v = data[i * stride];
+
+        if constexpr (std::is_floating_point_v<T>)
+        {
+          if (std::isnan(v))
+          {
+            continue;
+          }
+        }
+
+        const std::size_t key = keyOf(v);
+        ++H.counts[key];
+
+        if constexpr (TrackMinMax)
+        {
+          H.mins[key] = std::min(H.mins[key], v);
+          H.maxs[key] = std::max(H.maxs[key], v);
+        }
+      }
+    },
+    maxChunks
+  );
+
+  std::vector<QuantileIndex::Bin> bins;
+  uint64_t cumCount = 0;
+
+  for (std::size_t key = 0; key < numKeys; ++key)
+  {
+    uint64_t count = 0;
+    T binMin = std::numeric_limits<T>::max();
+    T binMax = std::numeric_limits<T>::lowest();
+
+    for (const LocalHistogram& H : locals)
+    {
+      count += H.counts[key];
+
+      if constexpr (TrackMinMax)
+      {
+        binMin = std::min(binMin, H.mins[key]);
+        binMax = std::max(binMax, H.maxs[key]);
+      }
+    }
+
+    if (0 == count)
+    {
+      continue;
+    }
+
+    cumCount += count;
+
+    if constexpr (TrackMinMax)
+    {
+      bins.push_back({static_cast<double>(binMin), static_cast<double>(binMax), cumCount});
+    }
+    else
+    {
+      const double value = keyToValue(key);
+      bins.push_back({value, value, cumCount});
+    }
+  }
+
+  bins.shrink_to_fit();
+
+  bool isExact = true;
+
+  if constexpr (TrackMinMax)
+  {
+    isExact = std::all_of(
+      std::begin(bins),
+      std::end(bins),
+      [](const QuantileIndex::Bin& b) { return b.m_min == b.m_max; }
+    );
+  }
+
+  return QuantileIndex(std::move(bins), isExact, interpolate);
+}
+
+/// Compute the min and max of a strided integer buffer in parallel
+template<typename T>
+std::pair<T, T> computeMinMax(const T* data, std::size_t N, std::size_t stride)
+{
+  std::vector<std::pair<T, T>> locals(
+    parallel::numChunks(N, MIN_CHUNK_SIZE),
+    {std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()}
+  );
+
+  parallel::forEachChunk(
+    N,
+    MIN_CHUNK_SIZE,
+    [&](std::size_t chunk, std::size_t begin, std::size_t end)
+    {
+      auto& [lo, hi] = locals[chunk];
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        lo = std::min(lo, data[i * stride]);
+        hi = std::max(hi, data[i * stride]);
+      }
+    }
+  );
+
+  std::pair<T, T> minMax{std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()};
+  for (const auto& [lo, hi] : locals)
+  {
+    minMax.first = std::min(minMax.first, lo);
+    minMax.second = std::max(minMax.second, hi);
+  }
+  return minMax;
+}
+
+} // namespace quantile_index_detail
+
+/**
+ * @brief Build the quantile index of one image component in a single parallel pass over its buffer
+ *
+ * @tparam T Component type
+ * @param[in] data Pointer to the first value of the component
+ * @param[in] numElements Number of values in the component
+ * @param[in] stride Distance between consecutive values of the component in the buffer
+ * (1 for separate component buffers; the number of components for interleaved buffers)
+ *
+ * @note 8- and 16-bit integer components are indexed exactly with one bin per representable value.
+ * 32-bit integer components are indexed exactly if they span at most 2^20 values; otherwise, a
+ * min/max pre-pass is needed to set the bin width. NaN values of floating-point components are
+ * excluded from the index.
+ */
+template<typename T>
+QuantileIndex buildQuantileIndex(const T* data, std::size_t numElements, std::size_t stride = 1)
+{
+  using namespace quantile_index_detail;
+
+  if (!data || 0 == numElements)
+  {
+    return QuantileIndex();
+  }
+
+  if constexpr (std::is_floating_point_v<T>)
+  {
+    static_assert(sizeof(T) == sizeof(float), "Only 32-bit floating point components are indexed");
+
+    return histogramToIndex<T, true>(
+      data,
+      numElements,
+      stride,
+      MAX_NUM_KEYS,
+      [](T v) { return static_cast<std::size_t>(orderedFloatKey(v)); },
+      [](std::size_t) { return 0.0; },
+      true
+    );
+  }
+  else if constexpr (sizeof(T) <= 2)
+  {
+    constexpr int64_t lowest = std::numeric_limits<T>::lowest();
+    constexpr std::size_t numKeys = std::size_t{1} << (8 * sizeof(T));
+
+    return histogramToIndex<T, false>(
+      data,
+      numElements,
+      stride,
+      numKeys,
+      [](T v) { return static_cast<std::size_t>(static_cast<int64_t>(v) - lowest); },
+      [](std::size_t key) { return static_cast<double>(static_cast<int64_t>(key) + lowest); },
+      false
+    );
+  }
+  else
+  {
+    const auto [minValue, maxValue] = computeMinMax(data, numElements, stride);
+    const int64_t offset = static_cast<int64_t>(minValue);
+    const auto range = static_cast<uint64_t>(static_cast<int64_t>(maxValue) - offset) + 1;
+
+    if (range <= MAX_NUM_KEYS)
+    {
+      return histogramToIndex<T, false>(
+        data,
+        numElements,
+        stride,
+        static_cast<std::size_t>(range),
+        [offset](T v) { return static_cast<std::size_t>(static_cast<int64_t>(v) - offset); },
+        [offset](std::size_t key)
+        { return static_cast<double>(static_cast<int64_t>(key) + offset); },
+        false
+      );
+    }
+
+    // Wide range: bins hold 2^shift consecutive values
+    int shift = 0;
+    while (((range - 1) >> shift) >= MAX_NUM_KEYS)
+    {
+      ++shift;
+    }
+
+    return histogramToIndex<T, true>(
+      data,
+      numElements,
+      stride,
+      static_cast<std::size_t>(((range - 1) >> shift) + 1),
+      [offset, shift](T v)
+      {
+        const auto key = static_cast<uint64_t>(static_cast<int64_t>(v) - offset) >> shift;
+        return static_cast<std::size_t>(key);
+      },
+      [](std::size_t) { return 0.0; },
+      false
+    );
+  }
+}
+
+#endif // QUANTILE_INDEX_TPP
@@ -1,4 +1,5 @@
 #include "image/SegUtil.h"
+#include "image/ComponentDispatch.h"
 #include "image/Image.h"
 
 #include "common/MathFuncs.h"
@@ -11,20 +12,99 @@
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/component_wise.hpp>
-#include <glm/gtx/hash.hpp>
 #include <glm/gtx/string_cast.hpp>
 
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
-#include <queue>
-#include <tuple>
-#include <unordered_set>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <type_traits>
 #include <vector>
 
 namespace
 {
 
+static constexpr uint32_t sk_comp = 0;
+
+// Maximum number of brush stencils kept for reuse
+static constexpr std::size_t sk_maxNumCachedStencils = 8;
+
+/// Run of voxels [m_xBegin, m_xEnd) on row (m_y, m_z)
+struct Span
+{
+  int m_y;
+  int m_z;
+  int m_xBegin;
+  int m_xEnd;
+};
+
+/**
+ * @brief Voxels covered by a brush of a given size, shape, and voxel spacing, relative to the
+ * brush center. Offsets of the voxels lie in the box [-m_extent, m_extent]. The stencil is stored
+ * both as spans of rows (for 3D brushes) and as a dense mask over its box (for 2D brushes).
+ */
+struct BrushStencil
+{
+  int m_brushSizeInVoxels = 0;
+  bool m_isRound = false;
+  std::array<float, 3> m_mmToVoxelSpacings{1.0f, 1.0f, 1.0f};
+  std::array<int, 3> m_mmToVoxelCoeffs{1, 1, 1};
+
+  glm::ivec3 m_extent{0};
+  std::vector<Span> m_spans;
+  std::vector<uint8_t> m_mask;
+
+  std::size_t boxIndex(const glm::ivec3& d) const
+  {
+    const glm::ivec3 boxSize = 2 * m_extent + 1;
+    const glm::ivec3 b = d + m_extent;
+    return (static_cast<std::size_t>(b.z) * boxSize.y + b.y) * boxSize.x + b.x;
+  }
+
+  bool isInBox(const glm::ivec3& d) const
+  {
+    return glm::all(glm::lessThanEqual(glm::abs(d), m_extent));
+  }
+
+  bool contains(const glm::ivec3& d) const
+  {
+    return isInBox(d) && 0 != m_mask[boxIndex(d)];
+  }
+};
+
+/// Buffers reused by all brush strokes, so that painting stops allocating once they have grown
+struct BrushScratch
+{
+  std::vector<BrushStencil> m_stencils; //!< Recently used stencils, most recent last
+  std::vector<Span> m_spans;            //!< Spans of voxels to paint, in image coordinates
+  std::vector<glm::ivec3> m_stack;      //!< Voxels to visit while filling a 2D brush
+
+  /// Marks of the voxels in the brush box while filling a 2D brush. A voxel was visited in the
+  /// current fill if its mark is at least m_stamp and painted if its mark is m_stamp + 1.
+  std::vector<uint32_t> m_marks;
+  uint32_t m_stamp = 0;
+
+  /// Advance the stamp, so that all marks are cleared
+  void nextStamp()
+  {
+    if (m_stamp >= std::numeric_limits<uint32_t>::max() - 2)
+    {
+      std::fill(std::begin(m_marks), std::end(m_marks), 0u);
+      m_stamp = 0;
+    }
+    m_stamp += 2;
+  }
+};
+
+BrushScratch& brushScratch()
+{
+  // Segmentations are painted on the main thread, but a scratch arena per thread keeps this safe
+  static thread_local BrushScratch s_scratch;
+  return s_scratch;
+}
+
 // Does the voxel intersect a plane?
 // The plane is given in Voxel coordinates.
 bool voxelInterectsPlane(const glm::vec4& voxelViewPlane, const glm::vec3& voxelPos)
@@ -42,191 +122,307 @@ bool isVoxelInSeg(const glm::ivec3 segDims, const glm::ivec3& voxelPos)
   );
 }
 
-std::tuple<std::unordered_set<glm::ivec3>, glm::ivec3, glm::ivec3> paintBrush2d(
-  const glm::vec4& voxelViewPlane,
-  const glm::ivec3& segDims,
-  const glm::ivec3& roundedPixelPos,
-  const std::array<float, 3>& mmToVoxelSpacings,
-  int brushSizeInVoxels,
-  bool brushIsRound
+// Is the voxel at offset d from the brush center inside the brush?
+bool isInsideBrush(
+  const glm::vec3& d, const std::array<float, 3>& mmToVoxelSpacings, float radius, bool brushIsRound
 )
 {
-  // Queue of voxels to test for intersection with the view plane
-  std::queue<glm::ivec3> voxelsToTest;
+  const std::array<float, 3>& s = mmToVoxelSpacings;
 
-  // Set of voxels that have been sent off for testing
-  std::unordered_set<glm::ivec3> voxelsProcessed;
+  if (!brushIsRound)
+  {
+    // Equation for a rectangle:
+    return std::max(std::max(std::abs(d.x / s[0]), std::abs(d.y / s[1])), std::abs(d.z / s[2]))
+           <= radius;
+  }
 
-  // Set of voxels that intersect with the view plane and that should be painted
-  std::unordered_set<glm::ivec3> voxelsToPaint;
+  // Equation for an ellipsoid:
+  return (d.x * d.x / (s[0] * s[0]) + d.y * d.y / (s[1] * s[1]) + d.z * d.z / (s[2] * s[2]))
+         <= radius * radius;
+}
 
-  // Set of voxels that do not intersect with view plane or that should not be painted
-  std::unordered_set<glm::ivec3> voxelsToIgnore;
+/// Get the stencil of a brush, computing it if it is not among the recently used stencils
+const BrushStencil& brushStencil(
+  BrushScratch& scratch,
+  int brushSizeInVoxels,
+  bool brushIsRound,
+  const std::array<float, 3>& mmToVoxelSpacings,
+  const std::array<int, 3>& mmToVoxelCoeffs
+)
+{
+  auto& stencils = scratch.m_stencils;
 
-  // Insert the first voxel as a voxel to test, if it's inside the segmentation.
-  // This voxel should intersect the view plane, since it was clicked by the mouse,
-  // but test it to make sure.
+  const auto it = std::find_if(
+    std::begin(stencils),
+    std::end(stencils),
+    [&](const BrushStencil& s)
+    {
+      return s.m_brushSizeInVoxels == brushSizeInVoxels && s.m_isRound == brushIsRound
+             && s.m_mmToVoxelSpacings == mmToVoxelSpacings
+             && s.m_mmToVoxelCoeffs == mmToVoxelCoeffs;
+    }
+  );
 
-  if (isVoxelInSeg(segDims, roundedPixelPos) && voxelInterectsPlane(voxelViewPlane, roundedPixelPos))
+  if (std::end(stencils) != it)
   {
-    voxelsToTest.push(roundedPixelPos);
-    voxelsProcessed.insert(roundedPixelPos);
+    std::rotate(it, std::next(it), std::end(stencils));
+    return stencils.back();
   }
 
-  std::array<glm::ivec3, 6> neighbors;
-
-  const float radius = static_cast<float>(brushSizeInVoxels - 1);
-
-  // Loop over all voxels in the test queue
-  while (!voxelsToTest.empty())
+  if (stencils.size() >= sk_maxNumCachedStencils)
   {
-    const glm::ivec3 q = voxelsToTest.front();
-    voxelsToTest.pop();
+    stencils.erase(std::begin(stencils));
+  }
 
-    // Check if the voxel is inside the brush
-    const glm::vec3 d = q - roundedPixelPos;
+  BrushStencil& stencil = stencils.emplace_back();
+  stencil.m_brushSizeInVoxels = brushSizeInVoxels;
+  stencil.m_isRound = brushIsRound;
+  stencil.m_mmToVoxelSpacings = mmToVoxelSpacings;
+  stencil.m_mmToVoxelCoeffs = mmToVoxelCoeffs;
 
-    if (!brushIsRound)
-    {
-      // Equation for a rectangle:
-      if (std::max(std::max(std::abs(d.x / mmToVoxelSpacings[0]), std::abs(d.y / mmToVoxelSpacings[1])), std::abs(d.z / mmToVoxelSpacings[2])) > radius)
-      {
-        voxelsToIgnore.insert(q);
-        continue;
-      }
-    }
-    else
-    {
-      if ((d.x * d.x / (mmToVoxelSpacings[0] * mmToVoxelSpacings[0]) + d.y * d.y / (mmToVoxelSpacings[1] * mmToVoxelSpacings[1]) + d.z * d.z / (mmToVoxelSpacings[2] * mmToVoxelSpacings[2])) > radius * radius)
-      {
-        voxelsToIgnore.insert(q);
-        continue;
-      }
-    }
+  // Radius of the brush, not including the central voxel
+  const int radius = std::max(brushSizeInVoxels - 1, 0);
 
-    // Mark that voxel intersects the view plane and is inside the brush:
-    voxelsToPaint.insert(q);
+  stencil.m_extent = glm::ivec3{mmToVoxelCoeffs[0], mmToVoxelCoeffs[1], mmToVoxelCoeffs[2]}
+                     * radius;
 
-    // Test its six neighbors, too:
-    neighbors.fill(q);
+  const glm::ivec3 e = stencil.m_extent;
+  const glm::ivec3 boxSize = 2 * e + 1;
+
+  stencil.m_mask.assign(
+    static_cast<std::size_t>(boxSize.x) * static_cast<std::size_t>(boxSize.y)
+      * static_cast<std::size_t>(boxSize.z),
+    0u
+  );
 
-    neighbors[0].x -= 1;
-    neighbors[1].x += 1;
-    neighbors[2].y -= 1;
-    neighbors[3].y += 1;
-    neighbors[4].z -= 1;
-    neighbors[5].z += 1;
+  std::size_t n = 0;
 
-    for (const auto& n : neighbors)
+  for (int k = -e.z; k <= e.z; ++k)
+  {
+    for (int j = -e.y; j <= e.y; ++j)
     {
-      if (0 == voxelsProcessed.count(n) && 0 == voxelsToIgnore.count(n) && 0 == voxelsToPaint.count(n) && voxelInterectsPlane(voxelViewPlane, n) && isVoxelInSeg(segDims, n))
+      int spanBegin = 0;
+      bool inSpan = false;
+
+      for (int i = -e.x; i <= e.x; ++i, ++n)
       {
-        voxelsToTest.push(n);
-        voxelsProcessed.insert(n);
+        const glm::vec3 d{static_cast<float>(i), static_cast<float>(j), static_cast<float>(k)};
+        const bool inside = isInsideBrush(
+          d, mmToVoxelSpacings, static_cast<float>(radius), brushIsRound
+        );
+
+        stencil.m_mask[n] = inside ? 1u : 0u;
+
+        if (inside && !inSpan)
+        {
+          spanBegin = i;
+          inSpan = true;
+        }
+        else if (!inside && inSpan)
+        {
+          stencil.m_spans.push_back(Span{j, k, spanBegin, i});
+          inSpan = false;
+        }
       }
-      else
+
+      if (inSpan)
       {
-        voxelsToIgnore.insert(n);
+        stencil.m_spans.push_back(Span{j, k, spanBegin, e.x + 1});
       }
     }
   }
 
-  // Create a unique set of voxels to change:
-  std::unordered_set<glm::ivec3> voxelsToChange;
+  return stencil;
+}
 
-  // Min/max corners of the set of voxels to change:
-  glm::ivec3 minVoxel{std::numeric_limits<int>::max()};
-  glm::ivec3 maxVoxel{std::numeric_limits<int>::lowest()};
+/// Collect the spans of a 3D brush centered at a voxel, clipped to the segmentation
+void collectSpans3d(
+  const BrushStencil& stencil,
+  const glm::ivec3& segDims,
+  const glm::ivec3& roundedPixelPos,
+  std::vector<Span>& spans
+)
+{
+  const glm::ivec3& c = roundedPixelPos;
 
-  for (const auto& p : voxelsToPaint)
+  for (const Span& s : stencil.m_spans)
   {
-    voxelsToChange.insert(p);
-    minVoxel = glm::min(minVoxel, p);
-    maxVoxel = glm::max(maxVoxel, p);
-  }
+    const int y = c.y + s.m_y;
+    const int z = c.z + s.m_z;
+
+    if (y < 0 || y >= segDims.y || z < 0 || z >= segDims.z)
+    {
+      continue;
+    }
+
+    const int xBegin = std::max(c.x + s.m_xBegin, 0);
+    const int xEnd = std::min(c.x + s.m_xEnd, segDims.x);
 
-  return std::make_tuple(voxelsToChange, minVoxel, maxVoxel);
+    if (xBegin < xEnd)
+    {
+      spans.push_back(Span{y, z, xBegin, xEnd});
+    }
+  }
 }
 
-std::tuple<std::unordered_set<glm::ivec3>, glm::ivec3, glm::ivec3> paintBrush3d(
+/**
+ * @brief Collect the spans of a 2D brush centered at a voxel. The brush paints the voxels inside
+ * the brush that are connected to the center voxel through voxels that intersect the view plane.
+ */
+void collectSpans2d(
+  const BrushStencil& stencil,
+  const glm::vec4& voxelViewPlane,
   const glm::ivec3& segDims,
   const glm::ivec3& roundedPixelPos,
-  const std::array<float, 3>& mmToVoxelSpacings,
-  const std::array<int, 3>& mmToVoxelCoeffs,
-  int brushSizeInVoxels,
-  bool brushIsRound
+  BrushScratch& scratch
 )
 {
-  // Set of unique voxels to change:
-  std::unordered_set<glm::ivec3> voxelToChange;
+  const glm::ivec3& c = roundedPixelPos;
+  const glm::ivec3 boxSize = 2 * stencil.m_extent + 1;
 
-  // Min/max corners of the set of voxels to change:
-  glm::ivec3 minVoxel{std::numeric_limits<int>::max()};
-  glm::ivec3 maxVoxel{std::numeric_limits<int>::lowest()};
+  const std::size_t boxVolume = static_cast<std::size_t>(boxSize.x)
+                                * static_cast<std::size_t>(boxSize.y)
+                                * static_cast<std::size_t>(boxSize.z);
+
+  if (scratch.m_marks.size() < boxVolume)
+  {
+    scratch.m_marks.resize(boxVolume, 0u);
+  }
+
+  scratch.nextStamp();
+
+  const uint32_t visited = scratch.m_stamp;
+  const uint32_t painted = scratch.m_stamp + 1;
+
+  std::vector<uint32_t>& marks = scratch.m_marks;
+  std::vector<glm::ivec3>& stack = scratch.m_stack;
+  stack.clear();
+
+  // The first voxel should intersect the view plane, since it was clicked by the mouse,
+  // but test it to make sure.
+  if (isVoxelInSeg(segDims, c) && voxelInterectsPlane(voxelViewPlane, c))
+  {
+    marks[stencil.boxIndex(glm::ivec3{0})] = visited;
+    stack.push_back(c);
+  }
 
-  const int radius_int = brushSizeInVoxels - 1;
-  const float radius_f = static_cast<float>(radius_int);
+  static const std::array<glm::ivec3, 6> sk_neighbors{
+    glm::ivec3{-1, 0, 0},
+    glm::ivec3{1, 0, 0},
+    glm::ivec3{0, -1, 0},
+    glm::ivec3{0, 1, 0},
+    glm::ivec3{0, 0, -1},
+    glm::ivec3{0, 0, 1}
+  };
+
+  // Min/max offsets of the painted voxels:
+  glm::ivec3 minOffset{std::numeric_limits<int>::max()};
+  glm::ivec3 maxOffset{std::numeric_limits<int>::lowest()};
 
-  for (int k = -mmToVoxelCoeffs[2] * radius_int; k <= mmToVoxelCoeffs[2] * radius_int; ++k)
+  while (!stack.empty())
   {
-    const int K = roundedPixelPos.z + k;
-    if (K < 0 || K >= segDims.z)
+    const glm::ivec3 q = stack.back();
+    stack.pop_back();
+
+    const glm::ivec3 d = q - c;
+
+    if (!stencil.contains(d))
+    {
       continue;
+    }
+
+    // Mark that voxel intersects the view plane and is inside the brush:
+    marks[stencil.boxIndex(d)] = painted;
+    minOffset = glm::min(minOffset, d);
+    maxOffset = glm::max(maxOffset, d);
 
-    for (int j = -mmToVoxelCoeffs[1] * radius_int; j <= mmToVoxelCoeffs[1] * radius_int; ++j)
+    // Test its six neighbors, too. Neighbors outside of the brush box cannot be painted.
+    for (const glm::ivec3& offset : sk_neighbors)
     {
-      const int J = roundedPixelPos.y + j;
-      if (J < 0 || J >= segDims.y)
-        continue;
+      const glm::ivec3 n = q + offset;
+      const glm::ivec3 dn = n - c;
 
-      for (int i = -mmToVoxelCoeffs[0] * radius_int; i <= mmToVoxelCoeffs[0] * radius_int; ++i)
+      if (stencil.isInBox(dn) && marks[stencil.boxIndex(dn)] < visited
+          && voxelInterectsPlane(voxelViewPlane, n) && isVoxelInSeg(segDims, n))
       {
-        const int I = roundedPixelPos.x + i;
-        if (I < 0 || I >= segDims.x)
-          continue;
+        marks[stencil.boxIndex(dn)] = visited;
+        stack.push_back(n);
+      }
+    }
+  }
 
-        const glm::ivec3 p{I, J, K};
-        bool changed = false;
+  // Convert rows of painted voxels to spans:
+  for (int k = minOffset.z; k <= maxOffset.z; ++k)
+  {
+    for (int j = minOffset.y; j <= maxOffset.y; ++j)
+    {
+      std::size_t n = stencil.boxIndex(glm::ivec3{minOffset.x, j, k});
+      int spanBegin = 0;
+      bool inSpan = false;
 
-        const float ii = static_cast<float>(i);
-        const float jj = static_cast<float>(j);
-        const float kk = static_cast<float>(k);
+      for (int i = minOffset.x; i <= maxOffset.x + 1; ++i, ++n)
+      {
+        const bool isPainted = (i <= maxOffset.x && painted == marks[n]);
 
-        if (!brushIsRound)
+        if (isPainted && !inSpan)
         {
-          // Square brush
-          if (std::max(std::max(std::abs(ii / mmToVoxelSpacings[0]), std::abs(jj / mmToVoxelSpacings[1])), std::abs(kk / mmToVoxelSpacings[2])) <= radius_f)
-          {
-            voxelToChange.insert(p);
-            changed = true;
-          }
+          spanBegin = i;
+          inSpan = true;
         }
-        else
+        else if (!isPainted && inSpan)
         {
-          // Round brush: additional check that voxel is inside the sphere of radius N
-          if ((ii * ii / (mmToVoxelSpacings[0] * mmToVoxelSpacings[0]) + jj * jj / (mmToVoxelSpacings[1] * mmToVoxelSpacings[1]) + kk * kk / (mmToVoxelSpacings[2] * mmToVoxelSpacings[2])) <= radius_f * radius_f)
-          {
-            voxelToChange.insert(p);
-            changed = true;
-          }
+          scratch.m_spans.push_back(Span{c.y + j, c.z + k, c.x + spanBegin, c.x + i});
+          inSpan = false;
         }
+      }
+    }
+  }
+}
+
+/// Paint spans of voxels in a segmentation buffer
+template<typename T>
+void paintSpansInBuffer(
+  T* buffer,
+  const glm::ivec3& segDims,
+  const std::vector<Span>& spans,
+  int64_t labelToPaint,
+  int64_t labelToReplace,
+  bool brushReplacesBgWithFg
+)
+{
+  const T label = static_cast<T>(labelToPaint);
+
+  auto rowStart = [&segDims](int y, int z)
+  {
+    return (static_cast<std::size_t>(z) * static_cast<std::size_t>(segDims.y)
+            + static_cast<std::size_t>(y))
+           * static_cast<std::size_t>(segDims.x);
+  };
 
-        if (changed)
+  for (const Span& s : spans)
+  {
+    T* row = buffer + rowStart(s.m_y, s.m_z);
+
+    if (brushReplacesBgWithFg)
+    {
+      for (int x = s.m_xBegin; x < s.m_xEnd; ++x)
+      {
+        if (labelToReplace == static_cast<int64_t>(row[x]))
         {
-          minVoxel = glm::min(minVoxel, p);
-          maxVoxel = glm::max(maxVoxel, p);
+          row[x] = label;
         }
       }
     }
+    else
+    {
+      std::fill(row + s.m_xBegin, row + s.m_xEnd, label);
+    }
   }
-
-  return std::make_tuple(voxelToChange, minVoxel, maxVoxel);
 }
 
-void updateSeg(
-  const std::unordered_set<glm::ivec3>& voxelsToChange,
-  const glm::ivec3& minVoxel,
-  const glm::ivec3& maxVoxel,
+/// Paint spans of voxels in a segmentation and mark their bricks as dirty
+void paintSpans(
+  const std::vector<Span>& spans,
 
   int64_t labelToPaint,
   int64_t labelToReplace,
@@ -234,87 +430,265 @@ void updateSeg(
 
   Image& seg,
 
-  const std::function<void(
-    const ComponentType& memoryComponentType,
-    const glm::uvec3& offset,
-    const glm::uvec3& size,
-    const int64_t* data
-  )>& updateSegTexture
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock
 )
 {
-  static constexpr std::size_t sk_comp = 0;
-  static const glm::ivec3 sk_voxelOne{1, 1, 1};
+  if (spans.empty())
+  {
+    return;
+  }
 
-  // Create a rectangular block of contiguous voxel value data that will be set in the texture:
-  std::vector<glm::ivec3> voxelPositions;
-  std::vector<int64_t> voxelValues;
+  // Min/max corners of the voxels to change:
+  glm::ivec3 minVoxel{std::numeric_limits<int>::max()};
+  glm::ivec3 maxVoxel{std::numeric_limits<int>::lowest()};
 
-  for (int k = minVoxel.z; k <= maxVoxel.z; ++k)
+  for (const Span& s : spans)
   {
-    for (int j = minVoxel.y; j <= maxVoxel.y; ++j)
-    {
-      for (int i = minVoxel.x; i <= maxVoxel.x; ++i)
-      {
-        const glm::ivec3 p{i, j, k};
-        voxelPositions.emplace_back(p);
-
-        if (voxelsToChange.count(p) > 0)
-        {
-          // Marked to change, so paint it:
-          if (brushReplacesBgWithFg)
-          {
-            const int64_t currentLabel = seg.value<int64_t>(sk_comp, i, j, k).value_or(0);
-
-            if (labelToReplace == currentLabel)
-            {
-              voxelValues.emplace_back(labelToPaint);
-            }
-            else
-            {
-              voxelValues.emplace_back(currentLabel);
-            }
-          }
-          else
-          {
-            voxelValues.emplace_back(labelToPaint);
-          }
-        }
-        else
-        {
-          // Not marked to change, so replace with the current label:
-          voxelValues.emplace_back(seg.value<int64_t>(sk_comp, i, j, k).value_or(0));
-        }
-      }
-    }
+    minVoxel = glm::min(minVoxel, glm::ivec3{s.m_xBegin, s.m_y, s.m_z});
+    maxVoxel = glm::max(maxVoxel, glm::ivec3{s.m_xEnd - 1, s.m_y, s.m_z});
   }
 
-  if (voxelPositions.empty())
+  const glm::ivec3 segDims{seg.header().pixelDimensions()};
+  const glm::ivec3 blockSize = maxVoxel - minVoxel + 1;
+  const ComponentType compType = seg.header().memoryComponentType();
+
+  // Save the block before getting the writable buffer, which changes the data version of the
+  // segmentation
+  if (saveSegBlock)
   {
-    return;
+    saveSegBlock(glm::uvec3{minVoxel}, glm::uvec3{blockSize});
   }
 
-  const glm::uvec3 dataOffset{minVoxel};
-  const glm::uvec3 dataSize{maxVoxel - minVoxel + sk_voxelOne};
+  void* buffer = seg.bufferAsVoid(sk_comp);
 
-  // Safety check:
-  const std::size_t N = static_cast<std::size_t>(dataSize.x) * static_cast<std::size_t>(dataSize.y)
-                        * static_cast<std::size_t>(dataSize.z);
+  auto paint = [&](auto* typedBuffer)
+  {
+    paintSpansInBuffer(
+      typedBuffer,
+      segDims,
+      spans,
+      labelToPaint,
+      labelToReplace,
+      brushReplacesBgWithFg
+    );
+  };
 
-  if (N != voxelPositions.size() || N != voxelValues.size())
+  switch (compType)
   {
-    spdlog::error("Invalid number of voxels when performing segmentation");
+  case ComponentType::UInt8:
+    paint(static_cast<uint8_t*>(buffer));
+    break;
+  case ComponentType::UInt16:
+    paint(static_cast<uint16_t*>(buffer));
+    break;
+  case ComponentType::UInt32:
+    paint(static_cast<uint32_t*>(buffer));
+    break;
+  default:
+  {
+    spdlog::error(
+      "Unable to paint segmentation with invalid component type {}", componentTypeString(compType)
+    );
     return;
   }
+  }
+
+  // Mark the rows rather than the block bounding them, which can hold many more bricks when
+  // the brush is oblique to the voxel axes
+  DirtyBrickMap& dirtyBricks = seg.dirtyBricks();
 
-  // Set values in the segmentation image:
-  for (std::size_t i = 0; i < voxelPositions.size(); ++i)
+  for (const Span& s : spans)
   {
-    seg.setValue(
-      sk_comp, voxelPositions[i].x, voxelPositions[i].y, voxelPositions[i].z, voxelValues[i]
+    dirtyBricks.markRow(
+      static_cast<uint32_t>(s.m_y),
+      static_cast<uint32_t>(s.m_z),
+      static_cast<uint32_t>(s.m_xBegin),
+      static_cast<uint32_t>(s.m_xEnd)
     );
   }
+}
+
+/// Buffers reused by all region growing fills
+struct RegionGrowScratch
+{
+  std::vector<uint64_t> m_visited; //!< Bit per voxel of the fill box: was the voxel visited?
+  std::vector<Span> m_stack;       //!< Spans whose neighboring rows are still to be scanned
+  std::vector<Span> m_spans;       //!< Spans of the region
+};
+
+RegionGrowScratch& regionGrowScratch()
+{
+  static thread_local RegionGrowScratch s_scratch;
+  return s_scratch;
+}
+
+/**
+ * @brief Grow a region from a seed voxel by scanline filling: each row of voxels of the region is
+ * found as a whole span, and only the rows that neighbor a span are scanned for more spans.
+ * A voxel is in the region if it is connected to the seed, inside of the box, its image value is
+ * in [low, high], and (if onlyReplaceLabel is true) its label is labelToReplace.
+ *
+ * @param[in] image Image component values, with a stride between voxels
+ * @param[in] seg Segmentation labels
+ * @param[in] boxMin, boxMax Box (inclusive) to which the region is restricted
+ * @param[out] scratch Buffers, whose spans are set to those of the region
+ */
+template<typename I, typename S>
+void growRegionSpans(
+  const I* image,
+  std::size_t imageStride,
+  const S* seg,
+  const glm::ivec3& dims,
+  const glm::ivec3& boxMin,
+  const glm::ivec3& boxMax,
+  const glm::ivec3& seed,
+  double low,
+  double high,
+  bool onlyReplaceLabel,
+  int64_t labelToReplace,
+  RegionGrowConnectivity connectivity,
+  RegionGrowScratch& scratch
+)
+{
+  // Neighboring rows (dy, dz) of a span, and the number of voxels (dx) by which the span is
+  // widened on each side to find its neighbors on these rows
+  struct RowOffset
+  {
+    int m_dy;
+    int m_dz;
+    int m_dx;
+  };
+
+  const int faceDx = (RegionGrowConnectivity::Neighbors6 == connectivity) ? 0 : 1;
+  const int edgeDx = (RegionGrowConnectivity::Neighbors26 == connectivity) ? 1 : 0;
+  const bool useEdgeRows = (RegionGrowConnectivity::Neighbors6 != connectivity);
+
+  const std::array<RowOffset, 8> rowOffsets{
+    {{-1, 0, faceDx},
+     {1, 0, faceDx},
+     {0, -1, faceDx},
+     {0, 1, faceDx},
+     {-1, -1, edgeDx},
+     {1, -1, edgeDx},
+     {-1, 1, edgeDx},
+     {1, 1, edgeDx}}
+  };
+
+  const std::size_t numRowOffsets = useEdgeRows ? 8 : 4;
+
+  const glm::ivec3 boxSize = boxMax - boxMin + 1;
+  const std::size_t numBoxVoxels = static_cast<std::size_t>(boxSize.x) * boxSize.y * boxSize.z;
+
+  std::vector<uint64_t>& visited = scratch.m_visited;
+  visited.assign((numBoxVoxels + 63) / 64, 0u);
+
+  std::vector<Span>& stack = scratch.m_stack;
+  std::vector<Span>& spans = scratch.m_spans;
+  stack.clear();
+  spans.clear();
+
+  const S replaceLabel = static_cast<S>(labelToReplace);
+
+  // Index of the voxel (boxMin.x, y, z) in the segmentation and in the visited bits
+  auto rowIndex = [&dims](int y, int z)
+  { return (static_cast<std::size_t>(z) * dims.y + static_cast<std::size_t>(y)) * dims.x; };
+
+  auto rowBit = [&boxMin, &boxSize](int y, int z)
+  {
+    return (static_cast<std::size_t>(z - boxMin.z) * boxSize.y
+            + static_cast<std::size_t>(y - boxMin.y))
+           * boxSize.x;
+  };
+
+  auto isVisited = [&visited](std::size_t bit)
+  { return 0 != (visited[bit >> 6] & (uint64_t{1} << (bit & 63))); };
+
+  // Is voxel x of a row unvisited and in the region?
+  auto isInRegion = [&](std::size_t row, std::size_t bitRow, int x)
+  {
+    if (isVisited(bitRow + static_cast<std::size_t>(x - boxMin.x)))
+    {
+      return false;
+    }
+
+    const std::size_t index = row + static_cast<std::size_t>(x);
+    const double value = static_cast<double>(image[index * imageStride]);
+
+    return low <= value && value <= high && (!onlyReplaceLabel || replaceLabel == seg[index]);
+  };
+
+  // Add the span of the region that contains voxel x of row (y, z), which is in the region
+  // @return One past the last voxel of the span
+  auto addSpan = [&](int x, int y, int z)
+  {
+    const std::size_t row = rowIndex(y, z);
+    const std::size_t bitRow = rowBit(y, z);
+
+    int xBegin = x;
+    int xEnd = x + 1;
+
+    while (xBegin > boxMin.x && isInRegion(row, bitRow, xBegin - 1))
+    {
+      --xBegin;
+    }
+
+    while (xEnd <= boxMax.x && isInRegion(row, bitRow, xEnd))
+    {
+      ++xEnd;
+    }
+
+    for (int i = xBegin; i < xEnd; ++i)
+    {
+      const std::size_t bit = bitRow + static_cast<std::size_t>(i - boxMin.x);
+      visited[bit >> 6] |= (uint64_t{1} << (bit & 63));
+    }
+
+    const Span span{y, z, xBegin, xEnd};
+    stack.push_back(span);
+    spans.push_back(span);
+
+    return xEnd;
+  };
+
+  if (!isInRegion(rowIndex(seed.y, seed.z), rowBit(seed.y, seed.z), seed.x))
+  {
+    return;
+  }
+
+  addSpan(seed.x, seed.y, seed.z);
+
+  while (!stack.empty())
+  {
+    const Span s = stack.back();
+    stack.pop_back();
+
+    for (std::size_t i = 0; i < numRowOffsets; ++i)
+    {
+      const RowOffset& o = rowOffsets[i];
+      const int y = s.m_y + o.m_dy;
+      const int z = s.m_z + o.m_dz;
+
+      if (y < boxMin.y || y > boxMax.y || z < boxMin.z || z > boxMax.z)
+      {
+        continue;
+      }
+
+      const std::size_t row = rowIndex(y, z);
+      const std::size_t bitRow = rowBit(y, z);
+
+      const int xBegin = std::max(s.m_xBegin - o.m_dx, boxMin.x);
+      const int xEnd = std::min(s.m_xEnd + o.m_dx, boxMax.x + 1);
 
-  updateSegTexture(seg.header().memoryComponentType(), dataOffset, dataSize, voxelValues.data());
+      for (int x = xBegin; x < xEnd; ++x)
+      {
+        if (isInRegion(row, bitRow, x))
+        {
+          // The voxel that ends the added span is not in the region, so skip past it
+          x = addSpan(x, y, z);
+        }
+      }
+    }
+  }
 }
 
 } // namespace
@@ -333,12 +707,7 @@ void paintSegmentation(
   const glm::ivec3& roundedPixelPos,
   const glm::vec4& voxelViewPlane,
 
-  const std::function<void(
-    const ComponentType& memoryComponentType,
-    const glm::uvec3& offset,
-    const glm::uvec3& size,
-    const int64_t* data
-  )>& updateSegTexture
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock
 )
 {
   // Set the brush radius (not including the central voxel): Radius = (brush width - 1) / 2
@@ -366,45 +735,31 @@ void paintSegmentation(
     }
   }
 
-  // Set of unique voxels to change:
-  std::unordered_set<glm::ivec3> voxelsToChange;
+  BrushScratch& scratch = brushScratch();
+  scratch.m_spans.clear();
 
-  // Min/max corners of the set of voxels to change
-  glm::ivec3 maxVoxel{std::numeric_limits<int>::lowest()};
-  glm::ivec3 minVoxel{std::numeric_limits<int>::max()};
+  const BrushStencil& stencil = brushStencil(
+    scratch, brushSizeInVoxels, brushIsRound, mmToVoxelSpacings, mmToVoxelCoeffs
+  );
+
+  const glm::ivec3 segDims{seg.header().pixelDimensions()};
 
   if (brushIs3d)
   {
-    std::tie(voxelsToChange, minVoxel, maxVoxel) = paintBrush3d(
-      seg.header().pixelDimensions(),
-      roundedPixelPos,
-      mmToVoxelSpacings,
-      mmToVoxelCoeffs,
-      brushSizeInVoxels,
-      brushIsRound
-    );
+    collectSpans3d(stencil, segDims, roundedPixelPos, scratch.m_spans);
   }
   else
   {
-    std::tie(voxelsToChange, minVoxel, maxVoxel) = paintBrush2d(
-      voxelViewPlane,
-      seg.header().pixelDimensions(),
-      roundedPixelPos,
-      mmToVoxelSpacings,
-      brushSizeInVoxels,
-      brushIsRound
-    );
+    collectSpans2d(stencil, voxelViewPlane, segDims, roundedPixelPos, scratch);
   }
 
-  updateSeg(
-    voxelsToChange,
-    minVoxel,
-    maxVoxel,
+  paintSpans(
+    scratch.m_spans,
     labelToPaint,
     labelToReplace,
     brushReplacesBgWithFg,
     seg,
-    updateSegTexture
+    saveSegBlock
   );
 }
 
@@ -417,12 +772,7 @@ void fillSegmentationWithPolygon(
   int64_t labelToReplace,
   bool brushReplacesBgWithFg,
 
-  const std::function<void(
-    const ComponentType& memoryComponentType,
-    const glm::uvec3& offset,
-    const glm::uvec3& size,
-    const int64_t* data
-  )>& updateSegTexture
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock
 )
 {
   static constexpr std::size_t OUTER_BOUNDARY = 0;
@@ -509,8 +859,23 @@ void fillSegmentationWithPolygon(
   const int minI = std::min(pixelAabbMinCorner.x, pixelAabbMaxCorner.x) - 1;
   const int maxI = std::max(pixelAabbMinCorner.x, pixelAabbMaxCorner.x) + 1;
 
-  // Set of unique voxels to change:
-  std::unordered_set<glm::ivec3> voxelsToChange;
+  // Spans of voxels to change, which are visited in row order:
+  BrushScratch& scratch = brushScratch();
+  std::vector<Span>& spans = scratch.m_spans;
+  spans.clear();
+
+  auto addVoxel = [&spans](int i, int j, int k)
+  {
+    if (!spans.empty() && spans.back().m_y == j && spans.back().m_z == k
+        && spans.back().m_xEnd == i)
+    {
+      ++spans.back().m_xEnd;
+    }
+    else
+    {
+      spans.push_back(Span{j, k, i, i + 1});
+    }
+  };
 
   const glm::ivec3 segDims{seg.header().pixelDimensions()};
 
@@ -536,31 +901,131 @@ void fillSegmentationWithPolygon(
 
         if (math::pnpoly(annotPlaneVertices, annotPlanePos) || (sk_fillBasedOnCorners && (math::pnpoly(annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(pixelPos + glm::vec3{0.5f, 0.5f, 0.5f})) || math::pnpoly(annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(pixelPos + glm::vec3{0.5f, 0.5f, -0.5f})) || math::pnpoly(annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(pixelPos + glm::vec3{0.5f, -0.5f, 0.5f})) || math::pnpoly(annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(pixelPos + glm::vec3{0.5f, -0.5f, -0.5f})) || math::pnpoly(annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(pixelPos + glm::vec3{-0.5f, 0.5f, 0.5f})) || math::pnpoly(annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(pixelPos + glm::vec3{-0.5f, 0.5f, -0.5f})) || math::pnpoly(annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(pixelPos + glm::vec3{-0.5f, -0.5f, 0.5f})) || math::pnpoly(annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(pixelPos + glm::vec3{-0.5f, -0.5f, -0.5f})))))
         {
-          voxelsToChange.insert(roundedPixelPos);
+          addVoxel(i, j, k);
           continue;
         }
       }
     }
   }
 
-  // Min/max corners of the set of voxels to change
-  glm::ivec3 maxVoxel{std::numeric_limits<int>::lowest()};
-  glm::ivec3 minVoxel{std::numeric_limits<int>::max()};
+  paintSpans(
+    spans,
+    labelToPaint,
+    labelToReplace,
+    brushReplacesBgWithFg,
+    seg,
+    saveSegBlock
+  );
+}
+
+std::size_t fillSegmentationByRegionGrowing(
+  Image& seg,
+  const Image& image,
+  uint32_t imageComponent,
 
-  for (const auto& p : voxelsToChange)
+  int64_t labelToPaint,
+  int64_t labelToReplace,
+  bool brushReplacesBgWithFg,
+
+  const glm::ivec3& seedVoxel,
+  double thresholdLow,
+  double thresholdHigh,
+  RegionGrowConnectivity connectivity,
+  std::optional<int> sliceAxis,
+
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock
+)
+{
+  const glm::ivec3 segDims{seg.header().pixelDimensions()};
+
+  if (glm::ivec3{image.header().pixelDimensions()} != segDims)
+  {
+    spdlog::error("Unable to grow region in segmentation with dimensions that differ from image");
+    return 0;
+  }
+
+  if (imageComponent >= image.header().numComponentsPerPixel())
+  {
+    spdlog::error("Unable to grow region from invalid image component {}", imageComponent);
+    return 0;
+  }
+
+  if (!isVoxelInSeg(segDims, seedVoxel))
+  {
+    return 0;
+  }
+
+  // A 2D region is restricted to the slice of the seed along the slice axis
+  glm::ivec3 boxMin{0};
+  glm::ivec3 boxMax = segDims - 1;
+
+  if (sliceAxis)
+  {
+    boxMin[*sliceAxis] = seedVoxel[*sliceAxis];
+    boxMax[*sliceAxis] = seedVoxel[*sliceAxis];
+  }
+
+  const ComponentBuffer imageBuffer = componentBuffer(image, imageComponent);
+
+  // Read the segmentation as const, so that its data version only changes if voxels are painted
+  const Image& constSeg = seg;
+  RegionGrowScratch& scratch = regionGrowScratch();
+  bool valid = false;
+
+  dispatchSegComponentType(
+    seg.header().memoryComponentType(),
+    [&](auto* segTypeTag)
+    {
+      using S = std::remove_pointer_t<decltype(segTypeTag)>;
+      const S* segData = static_cast<const S*>(constSeg.bufferAsVoid(sk_comp));
+
+      valid = dispatchImageComponentType(
+        image.header().memoryComponentType(),
+        [&](auto* imageTypeTag)
+        {
+          using I = std::remove_pointer_t<decltype(imageTypeTag)>;
+
+          growRegionSpans(
+            static_cast<const I*>(imageBuffer.m_data),
+            imageBuffer.m_stride,
+            segData,
+            segDims,
+            boxMin,
+            boxMax,
+            seedVoxel,
+            thresholdLow,
+            thresholdHigh,
+            brushReplacesBgWithFg,
+            labelToReplace,
+            connectivity,
+            scratch
+          );
+        }
+      );
+    }
+  );
+
+  if (!valid)
   {
-    minVoxel = glm::min(minVoxel, p);
-    maxVoxel = glm::max(maxVoxel, p);
+    spdlog::error("Unable to grow region in segmentation or image with invalid component type");
+    return 0;
   }
 
-  updateSeg(
-    voxelsToChange,
-    minVoxel,
-    maxVoxel,
+  std::size_t numVoxels = 0;
+
+  for (const Span& s : scratch.m_spans)
+  {
+    numVoxels += static_cast<std::size_t>(s.m_xEnd - s.m_xBegin);
+  }
+
+  paintSpans(
+    scratch.m_spans,
     labelToPaint,
     labelToReplace,
     brushReplacesBgWithFg,
     seg,
-    updateSegTexture
+    saveSegBlock
   );
+
+  return numVoxels;
 }
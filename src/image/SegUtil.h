@@ -1,30 +1,40 @@
 #ifndef SEG_UTILITY_H
 #define SEG_UTILITY_H
 
+#include "common/SegmentationTypes.h"
 #include "common/Types.h"
 
 #include <uuid.h>
 
 #include <glm/fwd.hpp>
 
+#include <cstddef>
 #include <functional>
+#include <optional>
 
 class Annotation;
 class Image;
 
 /**
- * @brief paintSegmentation
- * @param seg
- * @param labelToPaint
- * @param labelToReplace
- * @param brushReplacesBgWithFg
- * @param brushIsRound
- * @param brushIs3d
- * @param brushIsIsotropic
- * @param brushSizeInVoxels
- * @param roundedPixelPos
- * @param voxelViewPlane
- * @param updateSegTexture
+ * @brief Paint a segmentation with a brush centered at a voxel. The brush stencil of each size,
+ * shape, and spacing is computed once and reused. Rows of voxels inside the brush are written
+ * directly into the segmentation buffer.
+ *
+ * @param seg Segmentation, with UInt8, UInt16, or UInt32 components
+ * @param labelToPaint Label painted by the brush
+ * @param labelToReplace Label replaced by the brush, if brushReplacesBgWithFg is true
+ * @param brushReplacesBgWithFg Only replace voxels with labelToReplace
+ * @param brushIsRound Brush is round (true) or rectangular (false)
+ * @param brushIs3d Brush is 3D (true) or only paints voxels intersecting the view plane (false)
+ * @param brushIsIsotropic Brush accounts for anisotropic voxel spacing
+ * @param brushSizeInVoxels Brush size (diameter) in voxels
+ * @param roundedPixelPos Voxel at the brush center
+ * @param voxelViewPlane View plane, in Voxel coordinates
+ * @param saveSegBlock Function called with the block of voxels to paint, before they change.
+ * It may be empty.
+ *
+ * @note The bricks of painted voxels are marked as dirty in the segmentation, so that they are
+ * uploaded to its texture before the next frame is rendered.
  */
 void paintSegmentation(
   Image& seg,
@@ -41,12 +51,7 @@ void paintSegmentation(
   const glm::ivec3& roundedPixelPos,
   const glm::vec4& voxelViewPlane,
 
-  const std::function<void(
-    const ComponentType& memoryComponentType,
-    const glm::uvec3& offset,
-    const glm::uvec3& size,
-    const int64_t* data
-  )>& updateSegTexture
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock
 );
 
 void fillSegmentationWithPolygon(
@@ -57,12 +62,49 @@ void fillSegmentationWithPolygon(
   int64_t labelToReplace,
   bool brushReplacesBgWithFg,
 
-  const std::function<void(
-    const ComponentType& memoryComponentType,
-    const glm::uvec3& offset,
-    const glm::uvec3& size,
-    const int64_t* data
-  )>& updateSegTexture
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock
+);
+
+/**
+ * @brief Fill the region of a segmentation that grows from a seed voxel through the connected
+ * voxels whose image values are in a threshold range. The region is found by a scanline fill that
+ * marks visited voxels in a bitset, so each voxel is tested once.
+ *
+ * @param seg Segmentation, with UInt8, UInt16, or UInt32 components
+ * @param image Image whose values are thresholded. It must have the dimensions of seg.
+ * @param imageComponent Component of the image that is thresholded
+ * @param labelToPaint Label painted in the region
+ * @param labelToReplace Label replaced in the region, if brushReplacesBgWithFg is true
+ * @param brushReplacesBgWithFg Only grow through voxels with labelToReplace
+ * @param seedVoxel Voxel from which the region grows
+ * @param thresholdLow, thresholdHigh Range (inclusive) of the image values in the region
+ * @param connectivity Neighborhood of the voxels through which the region grows
+ * @param sliceAxis If set, then the region is restricted to the slice of the seed voxel that is
+ * perpendicular to this voxel axis (0, 1, or 2)
+ * @param saveSegBlock Function called with the block of voxels to paint, before they change.
+ * It may be empty.
+ *
+ * @return Number of voxels in the region, which is zero if the seed is not in the threshold range
+ *
+ * @note The bricks of painted voxels are marked as dirty in the segmentation, so that only they
+ * are uploaded to its texture.
+ */
+std::size_t fillSegmentationByRegionGrowing(
+  Image& seg,
+  const Image& image,
+  uint32_t imageComponent,
+
+  int64_t labelToPaint,
+  int64_t labelToReplace,
+  bool brushReplacesBgWithFg,
+
+  const glm::ivec3& seedVoxel,
+  double thresholdLow,
+  double thresholdHigh,
+  RegionGrowConnectivity connectivity,
+  std::optional<int> sliceAxis,
+
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock
 );
 
 #endif // SEG_UTILITY_H
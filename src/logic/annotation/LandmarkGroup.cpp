@@ -13,6 +13,8 @@ LandmarkGroup::LandmarkGroup()
   : m_fileName()
   , m_name()
   , m_pointMap()
+  , m_index()
+  , m_indexIsDirty(true)
   , m_inVoxelSpace(false)
   , m_layer(0)
   , m_maxLayer(0)
@@ -50,6 +52,7 @@ const std::string& LandmarkGroup::getName() const
 void LandmarkGroup::setPoints(std::map<size_t, PointRecord<LandmarkGroup::PositionType> > pointMap)
 {
   m_pointMap = std::move(pointMap);
+  m_indexIsDirty = true;
 }
 
 const std::map<size_t, PointRecord<LandmarkGroup::PositionType> >& LandmarkGroup::getPoints() const
@@ -67,9 +70,76 @@ bool LandmarkGroup::getInVoxelSpace() const
   return m_inVoxelSpace;
 }
 
-std::map<size_t, PointRecord<LandmarkGroup::PositionType> >& LandmarkGroup::getPoints()
+bool LandmarkGroup::setPointPosition(size_t index, PositionType position)
 {
-  return m_pointMap;
+  auto it = m_pointMap.find(index);
+
+  if (std::end(m_pointMap) == it)
+  {
+    return false;
+  }
+
+  it->second.setPosition(std::move(position));
+  m_indexIsDirty = true;
+  return true;
+}
+
+bool LandmarkGroup::setPointName(size_t index, std::string name)
+{
+  auto it = m_pointMap.find(index);
+
+  if (std::end(m_pointMap) == it)
+  {
+    return false;
+  }
+
+  it->second.setName(std::move(name));
+  return true;
+}
+
+bool LandmarkGroup::setPointColor(size_t index, glm::vec3 color)
+{
+  auto it = m_pointMap.find(index);
+
+  if (std::end(m_pointMap) == it)
+  {
+    return false;
+  }
+
+  it->second.setColor(std::move(color));
+  return true;
+}
+
+bool LandmarkGroup::setPointVisibility(size_t index, bool visibility)
+{
+  auto it = m_pointMap.find(index);
+
+  if (std::end(m_pointMap) == it)
+  {
+    return false;
+  }
+
+  it->second.setVisibility(visibility);
+  return true;
+}
+
+void LandmarkGroup::setPointsVisibility(bool visibility)
+{
+  for (auto& p : m_pointMap)
+  {
+    p.second.setVisibility(visibility);
+  }
+}
+
+const LandmarkIndex& LandmarkGroup::getIndex() const
+{
+  if (m_indexIsDirty)
+  {
+    m_index.build(m_pointMap);
+    m_indexIsDirty = false;
+  }
+
+  return m_index;
 }
 
 size_t LandmarkGroup::addPoint(PointRecord<PositionType> point)
@@ -84,17 +154,25 @@ size_t LandmarkGroup::addPoint(PointRecord<PositionType> point)
 
   const size_t newIndex = maxIndex + 1;
   m_pointMap.emplace(newIndex, std::move(point));
+  m_indexIsDirty = true;
   return newIndex;
 }
 
 void LandmarkGroup::addPoint(size_t index, PointRecord<PositionType> point)
 {
   m_pointMap.emplace(index, point);
+  m_indexIsDirty = true;
 }
 
 bool LandmarkGroup::removePoint(size_t index)
 {
-  return (m_pointMap.erase(index) > 0);
+  if (m_pointMap.erase(index) > 0)
+  {
+    m_indexIsDirty = true;
+    return true;
+  }
+
+  return false;
 }
 
 void LandmarkGroup::setLayer(uint32_t layer)
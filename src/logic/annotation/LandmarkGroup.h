@@ -2,6 +2,7 @@
 #define LANDMARK_GROUP_H
 
 #include "common/filesystem.h"
+#include "logic/annotation/LandmarkIndex.h"
 #include "logic/annotation/PointRecord.h"
 
 #include <glm/vec3.hpp>
@@ -34,9 +35,27 @@ public:
 
   /// Set/get the points in the landmark group.
   /// Each point is keyed by an index that specifies its order.
+  /// @note Points are changed through the setters of the group, so that the spatial index of the
+  /// points is rebuilt when they move.
   void setPoints(std::map<size_t, PointRecord<PositionType> > pointMap);
   const std::map<size_t, PointRecord<PositionType> >& getPoints() const;
-  std::map<size_t, PointRecord<PositionType> >& getPoints();
+
+  /// Set the position of the point at a given index
+  /// @return True iff the group has a point at the index
+  bool setPointPosition(size_t index, PositionType position);
+
+  /// Set the name, color, or visibility of the point at a given index
+  /// @return True iff the group has a point at the index
+  bool setPointName(size_t index, std::string name);
+  bool setPointColor(size_t index, glm::vec3 color);
+  bool setPointVisibility(size_t index, bool visibility);
+
+  /// Set the visibility of all points
+  void setPointsVisibility(bool visibility);
+
+  /// Get the spatial index of the points, which is rebuilt if the points changed since it was
+  /// last built
+  const LandmarkIndex& getIndex() const;
 
   /// Add a new point to the landmark group.
   /// The new point's index is one greater than the largest existing index in the group.
@@ -107,6 +126,10 @@ private:
   /// that specifies its order.
   std::map<size_t, PointRecord<PositionType> > m_pointMap;
 
+  /// Spatial index of the landmark points, which is rebuilt on demand after the points change
+  mutable LandmarkIndex m_index;
+  mutable bool m_indexIsDirty;
+
   /// Are the landmark points defined in Voxel (true) or Subject space?
   bool m_inVoxelSpace;
 
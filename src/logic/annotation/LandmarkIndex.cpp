@@ -0,0 +1,163 @@
+#include "logic/annotation/LandmarkIndex.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+/// Maximum number of points in a leaf node
+constexpr uint32_t sk_maxLeafSize = 16;
+
+/// Does a box intersect another box?
+bool intersects(const AABB<float>& a, const AABB<float>& b)
+{
+  return glm::all(glm::lessThanEqual(a.first, b.second))
+         && glm::all(glm::lessThanEqual(b.first, a.second));
+}
+
+/// Range of the signed distances of the points of a box to a plane
+std::pair<float, float> distanceRange(const AABB<float>& box, const glm::vec4& plane)
+{
+  const glm::vec3 normal{plane};
+  const glm::vec3 center = 0.5f * (box.first + box.second);
+  const glm::vec3 halfSize = 0.5f * (box.second - box.first);
+
+  const float centerDist = glm::dot(normal, center) + plane.w;
+  const float radius = glm::dot(glm::abs(normal), halfSize);
+
+  return {centerDist - radius, centerDist + radius};
+}
+
+} // namespace
+
+void LandmarkIndex::build(const std::map<std::size_t, PointRecord<glm::vec3> >& points)
+{
+  m_entries.clear();
+  m_nodes.clear();
+
+  m_entries.reserve(points.size());
+
+  for (const auto& [index, point] : points)
+  {
+    m_entries.push_back({point.getPosition(), index});
+  }
+
+  if (!m_entries.empty())
+  {
+    m_nodes.reserve(2 * (m_entries.size() / sk_maxLeafSize + 1));
+    buildNode(0, static_cast<uint32_t>(m_entries.size()));
+  }
+}
+
+uint32_t LandmarkIndex::buildNode(uint32_t begin, uint32_t end)
+{
+  const uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+  m_nodes.emplace_back();
+
+  AABB<float> box{m_entries[begin].m_position, m_entries[begin].m_position};
+
+  for (uint32_t i = begin + 1; i < end; ++i)
+  {
+    box.first = glm::min(box.first, m_entries[i].m_position);
+    box.second = glm::max(box.second, m_entries[i].m_position);
+  }
+
+  uint32_t left = 0;
+  uint32_t right = 0;
+
+  if (sk_maxLeafSize < end - begin)
+  {
+    // Split at the median along the longest axis of the box
+    const glm::vec3 size = box.second - box.first;
+    const int axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+    const uint32_t mid = begin + (end - begin) / 2;
+
+    std::nth_element(
+      std::begin(m_entries) + begin,
+      std::begin(m_entries) + mid,
+      std::begin(m_entries) + end,
+      [axis](const Entry& a, const Entry& b) { return a.m_position[axis] < b.m_position[axis]; }
+    );
+
+    // The children are built before the node is written, since building them grows m_nodes
+    left = buildNode(begin, mid);
+    right = buildNode(mid, end);
+  }
+
+  Node& node = m_nodes[nodeIndex];
+  node.m_box = box;
+  node.m_begin = begin;
+  node.m_end = end;
+  node.m_left = left;
+  node.m_right = right;
+
+  return nodeIndex;
+}
+
+std::vector<std::size_t> LandmarkIndex::query(
+  const glm::vec4& plane, float maxDistance, const std::optional<AABB<float> >& box
+) const
+{
+  std::vector<std::size_t> found;
+
+  if (m_nodes.empty())
+  {
+    return found;
+  }
+
+  auto isInside = [&plane, &maxDistance, &box](const glm::vec3& p)
+  {
+    if (box && (glm::any(glm::lessThan(p, box->first)) || glm::any(glm::lessThan(box->second, p))))
+    {
+      return false;
+    }
+
+    return std::abs(glm::dot(glm::vec3{plane}, p) + plane.w) < maxDistance;
+  };
+
+  std::vector<uint32_t> stack{0};
+
+  while (!stack.empty())
+  {
+    const Node& node = m_nodes[stack.back()];
+    stack.pop_back();
+
+    if (box && !intersects(node.m_box, *box))
+    {
+      continue;
+    }
+
+    const auto [minDist, maxDist] = distanceRange(node.m_box, plane);
+
+    if (maxDist <= -maxDistance || maxDistance <= minDist)
+    {
+      continue;
+    }
+
+    if (0 == node.m_left)
+    {
+      for (uint32_t i = node.m_begin; i < node.m_end; ++i)
+      {
+        if (isInside(m_entries[i].m_position))
+        {
+          found.push_back(m_entries[i].m_index);
+        }
+      }
+    }
+    else
+    {
+      stack.push_back(node.m_left);
+      stack.push_back(node.m_right);
+    }
+  }
+
+  std::sort(std::begin(found), std::end(found));
+  return found;
+}
+
+std::size_t LandmarkIndex::size() const
+{
+  return m_entries.size();
+}
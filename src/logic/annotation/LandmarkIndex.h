@@ -0,0 +1,77 @@
+#ifndef LANDMARK_INDEX_H
+#define LANDMARK_INDEX_H
+
+#include "common/AABB.h"
+#include "logic/annotation/PointRecord.h"
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief Spatial index of the points of a landmark group, in the space of the landmarks.
+ *
+ * The index is a k-d tree whose nodes hold the bounding boxes of their points, so that a query
+ * visits only the nodes that intersect a slab about a plane and an optional box. Views query the
+ * landmarks within half a slice spacing of their plane, rather than testing every landmark.
+ * The index is static: it is rebuilt when the landmarks change.
+ */
+class LandmarkIndex
+{
+public:
+  LandmarkIndex() = default;
+
+  /// Build the index of the points of a landmark group
+  void build(const std::map<std::size_t, PointRecord<glm::vec3> >& points);
+
+  /**
+   * @brief Find the points whose distance to a plane is less than a maximum distance and that
+   * are inside of a box
+   *
+   * @param[in] plane Plane (a, b, c, d) in landmark space, such that the distance of point p to
+   * the plane is |a*p.x + b*p.y + c*p.z + d|. The plane need not be normalized, so distances may
+   * be measured in another space that is an affine transformation of landmark space.
+   * @param[in] maxDistance Maximum distance of the points to the plane (exclusive)
+   * @param[in] box Optional box in landmark space. If null, then points are not tested against it.
+   *
+   * @return Indices of the points in the landmark group, in ascending order
+   */
+  std::vector<std::size_t> query(
+    const glm::vec4& plane, float maxDistance, const std::optional<AABB<float> >& box
+  ) const;
+
+  /// Number of points in the index
+  std::size_t size() const;
+
+private:
+  /// Indexed point
+  struct Entry
+  {
+    glm::vec3 m_position; //!< Position in landmark space
+    std::size_t m_index;  //!< Index of the point in its landmark group
+  };
+
+  /// Node of the tree, which holds the entries [m_begin, m_end)
+  struct Node
+  {
+    AABB<float> m_box;    //!< Bounding box of the entries of the node
+    uint32_t m_begin = 0; //!< First entry
+    uint32_t m_end = 0;   //!< One past the last entry
+    uint32_t m_left = 0;  //!< Left child (0 for leaves)
+    uint32_t m_right = 0; //!< Right child (0 for leaves)
+  };
+
+  /// Build the node of the entries [begin, end)
+  /// @return Index of the node
+  uint32_t buildNode(uint32_t begin, uint32_t end);
+
+  std::vector<Entry> m_entries; //!< Entries, ordered such that each node holds a contiguous range
+  std::vector<Node> m_nodes;    //!< Nodes, with the root first
+};
+
+#endif // LANDMARK_INDEX_H
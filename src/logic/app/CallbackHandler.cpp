@@ -2,6 +2,7 @@
 
 #include "common/DataHelper.h"
 #include "common/MathFuncs.h"
+#include "common/Profiler.h"
 #include "common/SegmentationTypes.h"
 #include "common/Types.h"
 
@@ -12,9 +13,10 @@
 #include "logic/camera/MathUtility.h"
 
 #include "logic/segmentation/GraphCuts.h"
+#include "logic/segmentation/Morphology.h"
 #include "logic/segmentation/Poisson.h"
 #include "logic/segmentation/SegHelpers.h"
-#include "logic/segmentation/SegHelpers.tpp"
+#include "logic/segmentation/SparseSeeds.h"
 
 #include "rendering/Rendering.h"
 #include "rendering/TextureSetup.h"
@@ -31,6 +33,13 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
 namespace
 {
 
@@ -41,51 +50,20 @@ static constexpr float sk_parallelThreshold_degrees = 0.1f;
 
 static constexpr float sk_imageFrontBackTranslationScaleFactor = 10.0f;
 
-} // namespace
-
-CallbackHandler::CallbackHandler(AppData& appData, GlfwWrapper& glfwWrapper, Rendering& rendering)
-  : m_appData(appData)
-  , m_glfw(glfwWrapper)
-  , m_rendering(rendering)
-{
-}
-
-bool CallbackHandler::clearSegVoxels(const uuids::uuid& segUid)
-{
-  Image* seg = m_appData.seg(segUid);
-  if (!seg)
-    return false;
-
-  seg->setAllValues(0);
-
-  const glm::uvec3 dataOffset = glm::uvec3{0};
-  const glm::uvec3 dataSize = glm::uvec3{seg->header().pixelDimensions()};
-
-  m_rendering.updateSegTexture(
-    segUid, seg->header().memoryComponentType(), dataOffset, dataSize, seg->bufferAsVoid(0)
-  );
-
-  return true;
-}
-
-std::optional<uuids::uuid> CallbackHandler::createBlankImageAndTexture(
-  const uuids::uuid& matchImageUid,
+/// Create an image with the header of another image, changed to the given component type and
+/// number of components, with zeroed voxels. The header overrides and transformation of the other
+/// image are assigned when the image is added to the app data.
+/// @return Image, or std::nullopt if the component type is invalid
+std::optional<Image> createBlankImage(
+  const ImageHeader& matchHeader,
   const ComponentType& componentType,
   uint32_t numComponents,
   const std::string& displayName,
-  bool createSegmentation
+  const Image::ImageRepresentation& representation
 )
 {
-  const Image* matchImg = m_appData.image(matchImageUid);
-
-  if (!matchImg)
-  {
-    spdlog::debug("Cannot create blank image for invalid matching image {}", matchImageUid);
-    return std::nullopt; // Invalid matching image provided
-  }
-
   // Copy the image header, changing it to have the given type and number of components:
-  ImageHeader newHeader = matchImg->header();
+  ImageHeader newHeader = matchHeader;
   newHeader.setExistsOnDisk(false);
   newHeader.setFileName("<unsaved>");
   newHeader.adjustComponents(componentType, numComponents);
@@ -147,7 +125,6 @@ std::optional<uuids::uuid> CallbackHandler::createBlankImageAndTexture(
   }
   default:
   {
-    spdlog::error("Invalid component type provided to create blank image");
     return std::nullopt;
   }
   }
@@ -155,19 +132,373 @@ std::optional<uuids::uuid> CallbackHandler::createBlankImageAndTexture(
   // Vector holding numComponents pointers to the same component buffer
   std::vector<const void*> imageComponents(numComponents, buffer);
 
-  Image image(
+  return Image(
     newHeader,
     displayName,
-    Image::ImageRepresentation::Image,
+    representation,
     Image::MultiComponentBufferType::SeparateImages,
     imageComponents
   );
+}
+
+/// Create a scalar uint8_t segmentation with the header of an image, with zeroed voxels
+Image createBlankSegImage(const ImageHeader& matchHeader, const std::string& displayName)
+{
+  std::optional<Image> seg = createBlankImage(
+    matchHeader, ComponentType::UInt8, 1, displayName, Image::ImageRepresentation::Segmentation
+  );
+
+  seg->settings().setOpacity(0.5); // Default opacity
+  return std::move(*seg);
+}
+
+/// Fraction of the solution of a potential that is done, estimated from the reduction of its
+/// residual on a log scale and from the number of iterations
+float fractionOfSolverDone(const PoissonSolverProgress& progress)
+{
+  const float iterFraction = static_cast<float>(progress.m_iteration)
+                             / static_cast<float>(std::max(progress.m_maxIterations, 1u));
+
+  if (progress.m_residual <= 0.0f || progress.m_targetResidual <= 0.0f
+      || progress.m_initialResidual <= progress.m_targetResidual)
+  {
+    return iterFraction;
+  }
+
+  const float residFraction = std::log(progress.m_initialResidual / progress.m_residual)
+                              / std::log(progress.m_initialResidual / progress.m_targetResidual);
+
+  return std::clamp(std::max(iterFraction, residFraction), 0.0f, 1.0f);
+}
+
+/**
+ * @brief Reports the progress of a seed segmentation that runs in the background to the app
+ * state, from which the UI shows it. Progress may be reported concurrently by several threads.
+ */
+class SeedSegmentationReporter
+{
+public:
+  SeedSegmentationReporter(AppState& state, GlfwWrapper& glfw, const TaskToken& token)
+    : m_state(state)
+    , m_glfw(glfw)
+    , m_token(token)
+    , m_nextStatusTime(0)
+  {
+  }
+
+  /// Set the fraction of the segmentation that is done
+  /// @return False iff the segmentation is cancelled
+  bool setProgress(float fraction)
+  {
+    m_token.setProgress(fraction);
+    return !m_token.isCancelled();
+  }
+
+  /// Set the fraction done and the status, and wake up the main thread to show them
+  /// @return False iff the segmentation is cancelled
+  bool setStatus(float fraction, const std::string& status)
+  {
+    m_token.setProgress(fraction);
+    m_state.setSeedSegmentationStatus(status);
+    m_glfw.postEmptyEvent();
+    return !m_token.isCancelled();
+  }
+
+  /// Is an update of the status due? Updates are limited to one per interval, so that solvers
+  /// with fast iterations do not flood the main thread with events. Of the threads that call
+  /// this concurrently, only one gets true.
+  bool isStatusDue()
+  {
+    using namespace std::chrono;
+
+    const int64_t now = duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    int64_t next = m_nextStatusTime;
+
+    return next <= now
+           && m_nextStatusTime.compare_exchange_strong(next, now + sk_statusInterval_msec);
+  }
+
+private:
+  static constexpr int64_t sk_statusInterval_msec = 100;
+
+  AppState& m_state;
+  GlfwWrapper& m_glfw;
+  TaskToken m_token;
+  std::atomic<int64_t> m_nextStatusTime; //!< Earliest time of the next status update (msec)
+};
+
+} // namespace
+
+CallbackHandler::CallbackHandler(AppData& appData, GlfwWrapper& glfwWrapper, Rendering& rendering)
+  : m_appData(appData)
+  , m_glfw(glfwWrapper)
+  , m_rendering(rendering)
+  , m_segEditHistory(appData.settings().segUndoMemoryBudgetInMiB() * 1024 * 1024)
+{
+}
+
+bool CallbackHandler::clearSegVoxels(const uuids::uuid& segUid)
+{
+  Image* seg = m_appData.seg(segUid);
+  if (!seg)
+    return false;
+
+  // Clearing is a separate step of the edit history. It is recorded brick by brick, since saving
+  // the whole segmentation as a block would copy it.
+  m_segEditHistory.setMemoryBudget(m_appData.settings().segUndoMemoryBudgetInMiB() * 1024 * 1024);
+
+  return m_segEditHistory.fillSeg(
+    segUid,
+    *seg,
+    0,
+    [this](const uuids::uuid& uid) { return m_appData.seg(uid); },
+    [this](const SegEditHistory::SegChanges& changes) { updateSegLabelStatistics(changes); }
+  );
+}
+
+bool CallbackHandler::applySegMorphology(const uuids::uuid& segUid, const MorphologyParams& params)
+{
+  if (m_segMorphologyFuture.valid())
+  {
+    spdlog::warn("Unable to apply morphology to segmentation {} while another one runs", segUid);
+    return false;
+  }
+
+  const Image* seg = m_appData.seg(segUid);
+  if (!seg)
+    return false;
+
+  // The operation is a separate step of the edit history
+  endSegEdit();
+
+  TaskToken token;
+  m_appData.state().setSegMorphologyTask(token);
+
+  // The operation runs on a copy, so that the segmentation can be rendered and edited meanwhile
+  SegMorphologyResult result{segUid, seg->dataVersion(), *seg, 0, {}};
+
+  m_segMorphologyFuture = m_appData.taskScheduler().submit(
+    AsyncTasks::SegMorphology,
+    [result = std::move(result), params, &glfw = m_glfw](const TaskToken& taskToken) mutable
+    {
+      PROFILE_BACKGROUND_SCOPE("Segmentation morphology");
+
+      auto saveSegBlock = [&result](const glm::uvec3& offset, const glm::uvec3& size)
+      { result.m_blocks.emplace_back(offset, size); };
+
+      auto onProgress = [&taskToken](float fraction)
+      {
+        taskToken.setProgress(fraction);
+        return !taskToken.isCancelled();
+      };
+
+      const std::optional<std::size_t> numVoxels
+        = ::applySegMorphology(*result.m_seg, params, saveSegBlock, onProgress);
+
+      if (numVoxels)
+      {
+        result.m_numVoxels = *numVoxels;
+      }
+      else
+      {
+        result.m_seg = std::nullopt;
+      }
+
+      // Wake up the main thread, which applies the result
+      glfw.postEmptyEvent();
+      return std::move(result);
+    },
+    token
+  );
+
+  return true;
+}
+
+bool CallbackHandler::applyCompletedSegMorphology()
+{
+  using namespace std::chrono_literals;
+
+  if (!m_segMorphologyFuture.valid()
+      || std::future_status::ready != m_segMorphologyFuture.wait_for(0s))
+  {
+    return false;
+  }
+
+  const std::optional<TaskToken> token = m_appData.state().segMorphologyTask();
+  const bool cancelled = token && token->isCancelled();
+
+  m_appData.state().setSegMorphologyTask(std::nullopt);
+
+  std::optional<SegMorphologyResult> result;
+
+  try
+  {
+    // A job that is cancelled before it starts is dropped, which breaks its promise
+    result = m_segMorphologyFuture.get();
+  }
+  catch (const std::exception& e)
+  {
+    if (!cancelled)
+    {
+      spdlog::error("Exception in segmentation morphology: {}", e.what());
+    }
+  }
+
+  if (cancelled)
+  {
+    spdlog::info("Segmentation morphology was cancelled");
+    return false;
+  }
+
+  if (!result || !result->m_seg)
+  {
+    spdlog::error("Segmentation morphology failed");
+    return false;
+  }
+
+  const uuids::uuid& segUid = result->m_segUid;
+  Image* seg = m_appData.seg(segUid);
+
+  if (!seg)
+  {
+    spdlog::warn("Segmentation {} was removed during the morphological operation", segUid);
+    return false;
+  }
+
+  if (seg->dataVersion() != result->m_dataVersion)
+  {
+    spdlog::warn(
+      "Segmentation {} was edited during the morphological operation, so its result is dropped",
+      segUid
+    );
+    return false;
+  }
+
+  if (0 == result->m_numVoxels)
+  {
+    spdlog::info("Morphological operation changed no voxels of segmentation {}", segUid);
+    return false;
+  }
+
+  PROFILE_SCOPE("Apply segmentation morphology");
+
+  const glm::uvec3 dims = seg->header().pixelDimensions();
+  const std::size_t compSize = seg->header().memoryComponentSizeInBytes();
+  const std::size_t rowBytes = compSize * dims.x;
+
+  // Read the result as const, so that only the segmentation is versioned
+  const Image& resultSeg = *result->m_seg;
+  const auto* src = static_cast<const uint8_t*>(resultSeg.bufferAsVoid(0));
+
+  endSegEdit();
+
+  uint8_t* dst = static_cast<uint8_t*>(seg->bufferAsVoid(0));
+
+  for (const auto& [offset, size] : result->m_blocks)
+  {
+    m_segEditHistory.saveBlock(segUid, *seg, offset, size);
+
+    // Only the range of each row that differs is copied and marked as dirty
+    for (uint32_t z = offset.z; z < offset.z + size.z; ++z)
+    {
+      for (uint32_t y = offset.y; y < offset.y + size.y; ++y)
+      {
+        const std::size_t rowStart
+          = (static_cast<std::size_t>(z) * dims.y + y) * rowBytes + compSize * offset.x;
+        const uint8_t* srcRow = src + rowStart;
+        uint8_t* dstRow = dst + rowStart;
+
+        auto voxelsEqual = [&](uint32_t x)
+        {
+          const uint8_t* srcVoxel = srcRow + compSize * x;
+          return std::equal(srcVoxel, srcVoxel + compSize, dstRow + compSize * x);
+        };
+
+        uint32_t xBegin = 0;
+        uint32_t xEnd = size.x;
+
+        while (xBegin < xEnd && voxelsEqual(xBegin))
+        {
+          ++xBegin;
+        }
+
+        while (xBegin < xEnd && voxelsEqual(xEnd - 1))
+        {
+          --xEnd;
+        }
+
+        if (xBegin == xEnd)
+        {
+          continue;
+        }
+
+        std::copy(srcRow + compSize * xBegin, srcRow + compSize * xEnd, dstRow + compSize * xBegin);
+        seg->dirtyBricks().markRow(y, z, offset.x + xBegin, offset.x + xEnd);
+      }
+    }
+  }
+
+  endSegEdit();
+
+  spdlog::info(
+    "Morphological operation changed {} voxels of segmentation {}", result->m_numVoxels, segUid
+  );
+  return true;
+}
+
+std::optional<uuids::uuid> CallbackHandler::createBlankImageAndTexture(
+  const uuids::uuid& matchImageUid,
+  const ComponentType& componentType,
+  uint32_t numComponents,
+  const std::string& displayName,
+  bool createSegmentation
+)
+{
+  const Image* matchImg = m_appData.image(matchImageUid);
+
+  if (!matchImg)
+  {
+    spdlog::debug("Cannot create blank image for invalid matching image {}", matchImageUid);
+    return std::nullopt; // Invalid matching image provided
+  }
+
+  std::optional<Image> image = createBlankImage(
+    matchImg->header(),
+    componentType,
+    numComponents,
+    displayName,
+    Image::ImageRepresentation::Image
+  );
+
+  if (!image)
+  {
+    spdlog::error("Invalid component type provided to create blank image");
+    return std::nullopt;
+  }
+
+  return addImageAndTexture(matchImageUid, std::move(*image), createSegmentation);
+}
+
+std::optional<uuids::uuid> CallbackHandler::addImageAndTexture(
+  const uuids::uuid& matchImageUid, Image image, bool createSegmentation
+)
+{
+  const Image* matchImg = m_appData.image(matchImageUid);
+
+  if (!matchImg)
+  {
+    spdlog::debug("Cannot add image for invalid matching image {}", matchImageUid);
+    return std::nullopt; // Invalid matching image provided
+  }
 
   image.setHeaderOverrides(matchImg->getHeaderOverrides());
 
   // Assign the matching image's affine_T_subject transformation to the new image:
   image.transformations().set_affine_T_subject(matchImg->transformations().get_affine_T_subject());
 
+  const std::string segDisplayName = std::string("Untitled segmentation for image '")
+                                     + image.settings().displayName() + "'";
+
   const uuids::uuid imageUid = m_appData.addImage(std::move(image));
 
   spdlog::trace("Creating texture for image {}", imageUid);
@@ -186,15 +517,16 @@ std::optional<uuids::uuid> CallbackHandler::createBlankImageAndTexture(
   // Synchronize transformation with matching image
   syncManualImageTransformation(matchImageUid, imageUid);
 
-  spdlog::info("Created blank image {} matching header of image {}", imageUid, matchImageUid);
-  spdlog::debug("Header:\n{}", image.header());
-  spdlog::debug("Transformation:\n{}", image.transformations());
+  spdlog::info("Added image {} matching header of image {}", imageUid, matchImageUid);
 
-  if (createSegmentation)
+  if (const Image* addedImage = m_appData.image(imageUid))
   {
-    const std::string segDisplayName = std::string("Untitled segmentation for image '")
-                                       + image.settings().displayName() + "'";
+    spdlog::debug("Header:\n{}", addedImage->header());
+    spdlog::debug("Transformation:\n{}", addedImage->transformations());
+  }
 
+  if (createSegmentation)
+  {
     createBlankSegWithColorTableAndTextures(imageUid, segDisplayName);
   }
 
@@ -219,26 +551,8 @@ std::optional<uuids::uuid> CallbackHandler::createBlankSeg(
     return std::nullopt; // Invalid image provided
   }
 
-  // Copy the image header, changing it to scalar with uint8_t components
-  ImageHeader newHeader = matchImg->header();
-  newHeader.setExistsOnDisk(false);
-  newHeader.setFileName("<unsaved>");
-  newHeader.adjustComponents(ComponentType::UInt8, 1);
-
-  // Create zeroed-out data buffer for component 0 of segmentation and vector pointing to the buffer
-  const std::vector<uint8_t> buffer(newHeader.numPixels(), 0u);
-  const std::vector<const void*> imageData{static_cast<const void*>(buffer.data())};
-
-  Image seg(
-    newHeader,
-    displayName,
-    Image::ImageRepresentation::Segmentation,
-    Image::MultiComponentBufferType::SeparateImages,
-    imageData
-  );
-
+  Image seg = createBlankSegImage(matchImg->header(), displayName);
   seg.setHeaderOverrides(matchImg->getHeaderOverrides());
-  seg.settings().setOpacity(0.5); // Default opacity
 
   spdlog::info("Created segmentation matching header of image {}", matchImageUid);
   spdlog::debug("Header:\n{}", seg.header());
@@ -270,16 +584,34 @@ std::optional<uuids::uuid> CallbackHandler::createBlankSegWithColorTableAndTextu
     return std::nullopt;
   }
 
-  auto segUid = createBlankSeg(matchImageUid, displayName);
+  return addSegWithColorTableAndTextures(
+    matchImageUid, createBlankSegImage(matchImage->header(), displayName)
+  );
+}
+
+std::optional<uuids::uuid> CallbackHandler::addSegWithColorTableAndTextures(
+  const uuids::uuid& matchImageUid, Image newSeg
+)
+{
+  const Image* matchImage = m_appData.image(matchImageUid);
+  if (!matchImage)
+  {
+    spdlog::error("Cannot add segmentation for invalid image {}", matchImageUid);
+    return std::nullopt;
+  }
+
+  newSeg.setHeaderOverrides(matchImage->getHeaderOverrides());
+
+  const std::string displayName = newSeg.settings().displayName();
+
+  auto segUid = m_appData.addSeg(std::move(newSeg));
   if (!segUid)
   {
-    spdlog::error("Error creating blank segmentation for image {}", matchImageUid);
+    spdlog::error("Error adding segmentation for image {}", matchImageUid);
     return std::nullopt;
   }
 
-  spdlog::debug(
-    "Created blank segmentation {} ('{}') for image {}", matchImageUid, displayName, matchImageUid
-  );
+  spdlog::debug("Added segmentation {} ('{}') for image {}", *segUid, displayName, matchImageUid);
 
   Image* seg = m_appData.seg(*segUid);
   if (!seg)
@@ -354,6 +686,12 @@ bool CallbackHandler::executeGraphCutsSegmentation(
   const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const SeedSegmentationType& segType
 )
 {
+  if (m_seedSegFuture.valid())
+  {
+    spdlog::warn("Cannot start graph cuts segmentation while another seed segmentation runs");
+    return false;
+  }
+
   // Inputs to algorithm:
   const Image* image = m_appData.image(imageUid);
   const Image* seedSeg = m_appData.seg(seedSegUid);
@@ -391,143 +729,230 @@ bool CallbackHandler::executeGraphCutsSegmentation(
                                                  + " for image '" + image->settings().displayName()
                                                  + "'";
 
-  const auto resultSegUid = createBlankSegWithColorTableAndTextures(imageUid, resultSegDisplayName);
+  spdlog::info("Starting graph cuts segmentation on image {} with seeds {}", imageUid, seedSegUid);
 
-  if (!resultSegUid)
-  {
-    spdlog::error("Unable to create blank segmentation for graph cuts");
-    return false;
-  }
+  const uint32_t imComp = image->settings().activeComponent();
+
+  const VoxelDistances voxelDists = computeVoxelDistances(image->header().spacing(), true);
 
-  Image* resultSeg = m_appData.seg(*resultSegUid);
+  GraphCutsEdgeWeight edgeWeight;
+  edgeWeight.m_amplitude = m_appData.settings().graphCutsWeightsAmplitude();
+  edgeWeight.m_sigma = m_appData.settings().graphCutsWeightsSigma();
+  edgeWeight.m_low = image->settings().componentStatistics(imComp).m_quantiles[1];
+  edgeWeight.m_high = image->settings().componentStatistics(imComp).m_quantiles[99];
 
-  if (!resultSeg)
+  // The seeds are extracted now, since they may be edited or removed while the segmentation runs
+  std::optional<SparseSeeds> seeds = SparseSeeds::fromSegmentation(*seedSeg);
+
+  if (!seeds)
   {
-    spdlog::error("Null result segmentation {} for graph cuts", *resultSegUid);
+    spdlog::error("Unable to extract seeds from segmentation {}", seedSegUid);
     return false;
   }
 
-  spdlog::info(
-    "Executing graph cuts segmentation on image {} with seeds {}; "
-    "resulting segmentation: {}",
-    imageUid,
-    seedSegUid,
-    *resultSegUid
-  );
-
-  const uint32_t imComp = image->settings().activeComponent();
-
-  const VoxelDistances voxelDists = computeVoxelDistances(image->header().spacing(), true);
-
-  const double imLow = image->settings().componentStatistics(imComp).m_quantiles[1];
-  const double imHigh = image->settings().componentStatistics(imComp).m_quantiles[99];
+  // The settings are read now, since they may change while the segmentation runs.
+  // The image is only read, and is never removed.
+  auto job = [imageUid,
+              image,
+              seeds = std::move(*seeds),
+              header = image->header(),
+              resultSegDisplayName,
+              segType,
+              imComp,
+              voxelDists,
+              edgeWeight,
+              hoodType = m_appData.settings().graphCutsNeighborhood(),
+              fgLabel = static_cast<LabelType>(m_appData.settings().foregroundLabel()),
+              numThreads = m_appData.settings().graphCutsNumThreads(),
+              blockSize = m_appData.settings().graphCutsBlockSize(),
+              cropToSeeds = m_appData.settings().seedSegmentationCropToSeeds(),
+              cropPadding = m_appData.settings().seedSegmentationCropPadding(),
+              &state = m_appData.state(),
+              &glfw = m_glfw](const TaskToken& token)
+  {
+    SeedSegmentationResult result{imageUid, std::nullopt, std::nullopt};
+    SeedSegmentationReporter reporter(state, glfw, token);
+
+    // The result is written to a segmentation that is not yet in the app data
+    Image resultSeg = createBlankSegImage(header, resultSegDisplayName);
+
+    auto onPhase = [&reporter](GraphCutsPhase phase)
+    {
+      switch (phase)
+      {
+      case GraphCutsPhase::FillingGraph:
+        return reporter.setStatus(0.0f, "Graph cuts: building graph");
+      case GraphCutsPhase::ComputingMaxFlow:
+        return reporter.setStatus(0.2f, "Graph cuts: computing max flow");
+      case GraphCutsPhase::WritingResult:
+        return reporter.setStatus(0.9f, "Graph cuts: writing result");
+      }
+      return true;
+    };
 
-  auto weight = [this, &imLow, &imHigh](double diff) -> double
-  {
-    const double amplitude = m_appData.settings().graphCutsWeightsAmplitude();
-    const double sigma = m_appData.settings().graphCutsWeightsSigma();
-    const double diffNorm = (diff - imLow) / (imHigh - imLow);
+    auto weight = [&edgeWeight](double diff) -> double
+    {
+      const double diffNorm = (diff - edgeWeight.m_low) / (edgeWeight.m_high - edgeWeight.m_low);
+      const double z = diffNorm / edgeWeight.m_sigma;
+      return edgeWeight.m_amplitude * std::exp(-0.5 * z * z);
+    };
 
-    return amplitude * std::exp(-0.5 * std::pow(diffNorm / sigma, 2.0));
-  };
+    // The graph only spans the region of interest around the seeds. Voxels outside of it are
+    // background.
+    const glm::ivec3 dims{header.pixelDimensions()};
+    const SparseSeeds::Box roi = cropToSeeds ? seeds.regionOfInterest(cropPadding)
+                                             : SparseSeeds::Box{glm::ivec3{0}, dims};
+    const SparseSeeds roiSeeds = seeds.crop(roi);
+
+    spdlog::debug(
+      "Graph cuts region of interest has offset {} and size {} ({} of {} voxels)",
+      glm::to_string(roi.m_offset),
+      glm::to_string(roi.m_size),
+      roi.numVoxels(),
+      header.numPixels()
+    );
 
-  auto getImageWeight =
-    [&weight, &image, &imComp](int x, int y, int z, int dx, int dy, int dz) -> double
-  {
-    const auto a = image->value<double>(imComp, x, y, z);
-    const auto b = image->value<double>(imComp, x + dx, y + dy, z + dz);
+    const std::optional<std::vector<float> > roiImage = copyComponentBox(*image, imComp, roi);
 
-    if (a && b)
+    if (!roiImage)
     {
-      return weight((*a) - (*b));
+      spdlog::error("Unable to copy region of interest of image {}", imageUid);
+      return result;
     }
-    else
+
+    auto getImageWeight = [&weight, &roiImage, &roi](int x, int y, int z, int dx, int dy, int dz)
     {
-      return 0.0;
-    } // weight for very different image values
-  };
+      const glm::ivec3 a{x, y, z};
+      const glm::ivec3 b = a + glm::ivec3{dx, dy, dz};
 
-  auto getImageWeight1D = [&weight, &image, &imComp](int index1, int index2) -> double
-  {
-    const auto a = image->value<double>(imComp, index1);
-    const auto b = image->value<double>(imComp, index2);
+      if (glm::any(glm::lessThan(b, glm::ivec3{0})) || glm::any(glm::lessThanEqual(roi.m_size, b)))
+      {
+        return 0.0; // weight for very different image values
+      }
 
-    if (a && b)
+      auto index = [&roi](const glm::ivec3& v)
+      { return (static_cast<std::size_t>(v.z) * roi.m_size.y + v.y) * roi.m_size.x + v.x; };
+
+      return weight((*roiImage)[index(a)] - (*roiImage)[index(b)]);
+    };
+
+    auto getImageWeight1D = [&weight, &roiImage](int index1, int index2) -> double
+    { return weight((*roiImage)[index1] - (*roiImage)[index2]); };
+
+    bool success = false;
+
+    switch (segType)
     {
-      return weight((*a) - (*b));
-    }
-    else
+    case SeedSegmentationType::Binary:
     {
-      return 0.0;
-    } // weight for very different image values
-  };
+      // Foreground seeds are 1 and all other seeds are 2
+      static constexpr LabelType sk_fgSeed = 1;
 
-  auto getSeedValue = [&seedSeg](int x, int y, int z) -> LabelType
-  { return seedSeg->value<int64_t>(0, x, y, z).value_or(0); };
+      std::vector<uint8_t> roiSeedBuffer(roi.numVoxels(), 0u);
+      std::vector<uint8_t> roiResult(roi.numVoxels(), 0u);
 
-  auto setResultSegValue = [&resultSeg](int x, int y, int z, LabelType value)
-  { resultSeg->setValue(0, x, y, z, value); };
+      roiSeeds.rasterize(
+        roiSeedBuffer.data(),
+        [&fgLabel](LabelType label) { return static_cast<uint8_t>(fgLabel == label ? 1u : 2u); }
+      );
 
-  bool success = false;
+      // Fill the graph directly from the region of interest buffers:
+      success = graphCutsBinarySegmentation(
+        hoodType,
+        edgeWeight.m_amplitude,
+        sk_fgSeed,
+        voxelDists,
+        edgeWeight,
+        roi.m_size,
+        roiImage->data(),
+        roiSeedBuffer.data(),
+        roiResult.data(),
+        numThreads,
+        blockSize,
+        onPhase
+      );
 
-  switch (segType)
-  {
-  case SeedSegmentationType::Binary:
-  {
-    success = graphCutsBinarySegmentation(
-      m_appData.settings().graphCutsNeighborhood(),
-      m_appData.settings().graphCutsWeightsAmplitude(),
-      static_cast<LabelType>(m_appData.settings().foregroundLabel()),
-      static_cast<LabelType>(m_appData.settings().backgroundLabel()),
-      glm::ivec3{image->header().pixelDimensions()},
-      voxelDists,
-      getImageWeight,
-      getSeedValue,
-      setResultSegValue
-    );
-    break;
-  }
-  case SeedSegmentationType::MultiLabel:
-  {
-    success = graphCutsMultiLabelSegmentation(
-      m_appData.settings().graphCutsNeighborhood(),
-      m_appData.settings().graphCutsWeightsAmplitude(),
-      glm::ivec3{image->header().pixelDimensions()},
-      voxelDists,
-      getImageWeight,
-      getImageWeight1D,
-      getSeedValue,
-      setResultSegValue
-    );
-    break;
-  }
-  }
+      if (success)
+      {
+        pasteBox(
+          roiResult.data(),
+          roi,
+          dims,
+          static_cast<uint8_t*>(resultSeg.bufferAsVoid(0)),
+          [&fgLabel](uint8_t value) { return static_cast<uint8_t>(0u < value ? fgLabel : 0); }
+        );
+      }
+      break;
+    }
+    case SeedSegmentationType::MultiLabel:
+    {
+      // The labels are written to a buffer of the region of interest, which is then pasted into
+      // the result at once, rather than voxel by voxel through the image
+      std::vector<uint8_t> roiResult(roi.numVoxels(), 0u);
 
-  if (!success)
-  {
-    spdlog::error("Failure during execution of graph cuts segmentation");
-    return false;
-  }
+      auto setResultSegValue = [&roiResult, &roi](int x, int y, int z, LabelType value)
+      {
+        const std::size_t index
+          = (static_cast<std::size_t>(z) * roi.m_size.y + y) * roi.m_size.x + x;
+        roiResult[index] = static_cast<uint8_t>(value);
+      };
+
+      success = graphCutsMultiLabelSegmentation(
+        hoodType,
+        edgeWeight.m_amplitude,
+        voxelDists,
+        getImageWeight,
+        getImageWeight1D,
+        roiSeeds,
+        setResultSegValue,
+        onPhase
+      );
 
-  spdlog::debug("Start updating segmentation texture");
+      if (success)
+      {
+        pasteBox(
+          roiResult.data(),
+          roi,
+          dims,
+          static_cast<uint8_t*>(resultSeg.bufferAsVoid(0)),
+          [](uint8_t value) { return value; }
+        );
+      }
+      break;
+    }
+    }
 
-  m_rendering.updateSegTexture(
-    *resultSegUid,
-    resultSeg->header().memoryComponentType(),
-    glm::uvec3{0},
-    resultSeg->header().pixelDimensions(),
-    resultSeg->bufferAsVoid(0)
-  );
+    if (!success)
+    {
+      if (!token.isCancelled())
+      {
+        spdlog::error("Failure during execution of graph cuts segmentation");
+      }
+      return result;
+    }
 
-  spdlog::debug("Done updating segmentation texture");
+    resultSeg.updateComponentStats();
 
-  return true;
+    // The texture of the segmentation is created from its finished voxels
+    resultSeg.dirtyBricks().clear();
+
+    result.m_seg = std::move(resultSeg);
+    return result;
+  };
+
+  return startSeedSegmentation(AsyncTasks::GraphCutsSegmentation, std::move(job));
 }
 
 bool CallbackHandler::executePoissonSegmentation(
   const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const SeedSegmentationType& segType
 )
 {
+  if (m_seedSegFuture.valid())
+  {
+    spdlog::warn("Cannot start Poisson segmentation while another seed segmentation runs");
+    return false;
+  }
+
   // Algorithm inputs:
   const Image* image = m_appData.image(imageUid);
   const Image* seedSeg = m_appData.seg(seedSegUid);
@@ -544,228 +969,324 @@ bool CallbackHandler::executePoissonSegmentation(
     return false;
   }
 
-  if (image->header().pixelDimensions() != seedSeg->header().pixelDimensions())
-  {
-    spdlog::error(
-      "Dimensions of image {} ({}) and seed segmentation {} ({}) do not match",
-      imageUid,
-      glm::to_string(image->header().pixelDimensions()),
-      seedSegUid,
-      glm::to_string(seedSeg->header().pixelDimensions())
-    );
-    return false;
-  }
+  if (image->header().pixelDimensions() != seedSeg->header().pixelDimensions())
+  {
+    spdlog::error(
+      "Dimensions of image {} ({}) and seed segmentation {} ({}) do not match",
+      imageUid,
+      glm::to_string(image->header().pixelDimensions()),
+      seedSegUid,
+      glm::to_string(seedSeg->header().pixelDimensions())
+    );
+    return false;
+  }
+
+  const size_t numSegsForImage = m_appData.imageToSegUids(imageUid).size();
+
+  const std::string resultSegDisplayName = ((SeedSegmentationType::Binary == segType)
+                                              ? std::string("Binary Poisson segmentation ")
+                                              : std::string("Multi-label Poisson segmentation "))
+                                           + std::to_string(numSegsForImage + 1) + " for image '"
+                                           + image->settings().displayName() + "'";
+
+  const std::string potDisplayName = std::string("Potential maps for '")
+                                     + image->settings().displayName() + "'";
+
+  spdlog::info("Starting Poisson segmentation on image {} with seeds {}", imageUid, seedSegUid);
+
+  // The seeds are extracted now, since they may be edited or removed while the segmentation runs
+  std::optional<SparseSeeds> seeds = SparseSeeds::fromSegmentation(*seedSeg);
+
+  if (!seeds)
+  {
+    spdlog::error("Unable to extract seeds from segmentation {}", seedSegUid);
+    return false;
+  }
+
+  // The image is only read, and is never removed
+  auto job = [imageUid,
+              image,
+              seeds = std::move(*seeds),
+              header = image->header(),
+              imComp = image->settings().activeComponent(),
+              resultSegDisplayName,
+              potDisplayName,
+              cropToSeeds = m_appData.settings().seedSegmentationCropToSeeds(),
+              cropPadding = m_appData.settings().seedSegmentationCropPadding(),
+              &state = m_appData.state(),
+              &glfw = m_glfw](const TaskToken& token)
+  {
+    SeedSegmentationResult result{imageUid, std::nullopt, std::nullopt};
+    SeedSegmentationReporter reporter(state, glfw, token);
+
+    if (!reporter.setStatus(0.0f, "Poisson: computing edge weights"))
+    {
+      return result;
+    }
+
+    // The potentials are only solved in the region of interest around the seeds. They are zero
+    // outside of it.
+    const glm::ivec3 imageDims{header.pixelDimensions()};
+    const SparseSeeds::Box roi = cropToSeeds ? seeds.regionOfInterest(cropPadding)
+                                             : SparseSeeds::Box{glm::ivec3{0}, imageDims};
+    const SparseSeeds roiSeeds = seeds.crop(roi);
+    const glm::ivec3 dims = roi.m_size;
+
+    spdlog::debug(
+      "Poisson region of interest has offset {} and size {} ({} of {} voxels)",
+      glm::to_string(roi.m_offset),
+      glm::to_string(roi.m_size),
+      roi.numVoxels(),
+      header.numPixels()
+    );
+
+    const std::optional<std::vector<float> > roiImage = copyComponentBox(*image, imComp, roi);
+
+    if (!roiImage)
+    {
+      spdlog::error("Unable to copy region of interest of image {}", imageUid);
+      return result;
+    }
+
+    const float* imageBuffer = roiImage->data();
+
+    // Seeds of the region of interest, with labels converted to uint8_t
+    std::vector<uint8_t> seedSegVector(roi.numVoxels(), 0u);
+
+    roiSeeds.rasterize(
+      seedSegVector.data(), [](LabelType label) { return static_cast<uint8_t>(label); }
+    );
+
+    const uint8_t* seedSegBuffer = seedSegVector.data();
+
+    static constexpr bool sk_includeBackgroundLabel = true;
+    const LabelIndexMaps labelMaps = roiSeeds.labelIndexMaps(sk_includeBackgroundLabel);
+
+    // The number of components for the output potential image equals the number of
+    // labels in the seed segmentation, including label zero. Component 0 of the
+    // image holds the potential for all labels. Component i >= 1 of the image holds the
+    // potential of label index i.
+    const uint32_t numComps = labelMaps.labelToIndex.size();
+
+    // The results are written to images that are not yet in the app data
+    std::optional<Image> potImage = createBlankImage(
+      header, ComponentType::Float32, numComps, potDisplayName, Image::ImageRepresentation::Image
+    );
+
+    if (!potImage)
+    {
+      spdlog::error("Unable to create blank potential image matching image {}", imageUid);
+      return result;
+    }
+
+    Image resultSeg = createBlankSegImage(header, resultSegDisplayName);
+
+    spdlog::debug("Generated blank potential image with {} components", numComps);
+
+    const VoxelDistances voxelDists = computeVoxelDistances(header.spacing(), true);
+
+    const float beta = computeBeta(imageBuffer, dims);
+    spdlog::debug("Poisson beta = {}", beta);
+
+    // Image contrast does not yet modulate the edge weights, which only depend on voxel spacing
+    static constexpr float sk_contrast = 0.0f;
+
+    const PoissonEdgeWeights weights
+      = computeEdgeWeights(imageBuffer, dims, voxelDists, sk_contrast, beta);
+
+    // Component 0 of the potential is initialized by all labels and component i by label i.
+    // All components are solved concurrently, in buffers of the region of interest.
+    std::vector<std::vector<float> > roiPotentials(numComps, std::vector<float>(roi.numVoxels()));
+    std::vector<float*> potBuffers(numComps);
+
+    for (uint32_t i = 0; i < numComps; ++i)
+    {
+      potBuffers[i] = roiPotentials[i].data();
+      const LabelType label = (0 == i) ? 0u : labelMaps.indexToLabel.at(i);
+      initializePotential(seedSegBuffer, potBuffers[i], dims, label);
+    }
+
+    if (!reporter.setStatus(0.0f, "Poisson: solving potentials"))
+    {
+      return result;
+    }
+
+    // Fraction of the solution of each potential that is done
+    std::vector<std::atomic<float> > fractionsDone(numComps);
+
+    auto onProgress = [&reporter, &fractionsDone](const PoissonSolverProgress& progress)
+    {
+      fractionsDone[progress.m_potential] = fractionOfSolverDone(progress);
 
-  const uint32_t imComp = image->settings().activeComponent();
-  const uint32_t sk_seedComp = 0;
+      float fractionDone = 0.0f;
+
+      for (const auto& f : fractionsDone)
+      {
+        fractionDone += f / static_cast<float>(fractionsDone.size());
+      }
 
-  const glm::ivec3 dims{seedSeg->header().pixelDimensions()};
+      if (reporter.isStatusDue())
+      {
+        std::ostringstream status;
+        status << "Poisson: potential " << progress.m_potential + 1 << " of "
+               << fractionsDone.size() << ", iteration " << progress.m_iteration
+               << ", residual " << std::setprecision(3) << progress.m_residual;
 
-  // Buffer will either point to data of the image (if the image has float components)
-  // or to data of a vector with float components:
-  const float* imageBuffer = nullptr;
-  std::vector<float> imageVector;
+        return reporter.setStatus(fractionDone, status.str());
+      }
 
-  if (ComponentType::Float32 == image->header().memoryComponentType())
-  {
-    imageBuffer = static_cast<const float*>(image->bufferAsVoid(imComp));
-  }
-  else
-  {
-    imageVector.resize(image->header().numPixels(), 0.0f);
-    for (std::size_t i = 0; i < image->header().numPixels(); ++i)
+      return reporter.setProgress(fractionDone);
+    };
+
+    if (!solvePotentials(seedSegBuffer, weights, potBuffers, PoissonSolverSettings{}, onProgress))
     {
-      imageVector[i] = image->value<float>(imComp, i).value_or(0.0f);
+      return result;
     }
-    imageBuffer = imageVector.data();
-  }
 
-  // Buffer will either point to data of the seed segmentation, with all components converted to uint8_t
-  // and labels compressed to be in a contiguous range.
-  static constexpr bool sk_ignoreBackgroundLabel = false;
+    if (!reporter.setStatus(1.0f, "Poisson: computing result segmentation"))
+    {
+      return result;
+    }
 
-  std::vector<uint8_t> seedSegVector(seedSeg->header().numPixels(), 0u);
+    const std::vector<const float*> labelPotBuffers(
+      std::next(std::begin(potBuffers)), std::end(potBuffers)
+    );
 
-  for (std::size_t i = 0; i < seedSeg->header().numPixels(); ++i)
-  {
-    seedSegVector[i] = seedSeg->value<uint8_t>(sk_seedComp, i).value_or(0u);
-  }
+    std::vector<uint8_t> roiResult(roi.numVoxels(), 0u);
+    computeResultSeg(labelPotBuffers, roiResult.data(), dims);
 
-  const uint8_t* seedSegBuffer = seedSegVector.data();
+    auto identity = [](auto value) { return value; };
 
-  const LabelIndexMaps labelMaps
-    = createLabelIndexMaps(dims, seedSegBuffer, sk_ignoreBackgroundLabel);
+    pasteBox(
+      roiResult.data(), roi, imageDims, static_cast<uint8_t*>(resultSeg.bufferAsVoid(0)), identity
+    );
 
-  const size_t numSegsForImage = m_appData.imageToSegUids(imageUid).size();
+    for (uint32_t i = 0; i < numComps; ++i)
+    {
+      pasteBox(
+        roiPotentials[i].data(),
+        roi,
+        imageDims,
+        static_cast<float*>(potImage->bufferAsVoid(i)),
+        identity
+      );
+    }
 
-  const std::string resultSegDisplayName = ((SeedSegmentationType::Binary == segType)
-                                              ? std::string("Binary Poisson segmentation ")
-                                              : std::string("Multi-label Poisson segmentation "))
-                                           + std::to_string(numSegsForImage + 1) + " for image '"
-                                           + image->settings().displayName() + "'";
+    potImage->updateComponentStats();
+    resultSeg.updateComponentStats();
 
-  //    spdlog::trace( "resultSegDisplayName = {}", resultSegDisplayName );
+    spdlog::debug("Potential image stats: {}", potImage->settings());
+    spdlog::debug("Resulting segmentation image stats: {}", resultSeg.settings());
 
-  const auto resultSegUid = createBlankSegWithColorTableAndTextures(imageUid, resultSegDisplayName);
+    // The textures of the images are created from their finished voxels
+    resultSeg.dirtyBricks().clear();
 
-  if (!resultSegUid)
-  {
-    spdlog::error("Unable to create blank segmentation matching image {}", imageUid);
-    return false;
-  }
+    result.m_seg = std::move(resultSeg);
+    result.m_potential = std::move(*potImage);
+    return result;
+  };
 
-  const std::string potDisplayName = std::string("Potential maps for '")
-                                     + image->settings().displayName() + "'";
+  return startSeedSegmentation(AsyncTasks::PoissonSegmentation, std::move(job));
+}
 
-  // The number of components for the output potential image equals the number of
-  // labels in the seed segmentation, including label zero. Component 0 of the
-  // image holds the potential for all labels. Component i >= 1 of the image holds the
-  // potential of label index i.
-  const uint32_t numLabels = labelMaps.labelToIndex.size() - 1;
-  const uint32_t numComps = labelMaps.labelToIndex.size();
+bool CallbackHandler::startSeedSegmentation(
+  AsyncTasks taskType, std::function<SeedSegmentationResult(const TaskToken&)> job
+)
+{
+  TaskToken token;
+  m_appData.state().setSeedSegmentationTask(token);
+  m_appData.state().setSeedSegmentationStatus("Starting segmentation");
 
-  // Create potential image with float components
-  const auto potImageUid = createBlankImageAndTexture(
-    imageUid, ComponentType::Float32, numComps, potDisplayName, numComps
+  m_seedSegFuture = m_appData.taskScheduler().submit(
+    taskType,
+    [job = std::move(job), &glfw = m_glfw](const TaskToken& taskToken)
+    {
+      PROFILE_BACKGROUND_SCOPE("Seed segmentation");
+      SeedSegmentationResult result = job(taskToken);
+
+      // Wake up the main thread, which adds the result
+      glfw.postEmptyEvent();
+      return result;
+    },
+    token
   );
 
-  if (!potImageUid)
+  return true;
+}
+
+std::optional<uuids::uuid> CallbackHandler::addCompletedSeedSegmentation()
+{
+  using namespace std::chrono_literals;
+
+  if (!m_seedSegFuture.valid() || std::future_status::ready != m_seedSegFuture.wait_for(0s))
   {
-    spdlog::error("Unable to create blank potential image matching image {}", imageUid);
-    return false;
+    return std::nullopt;
   }
 
-  spdlog::debug("Generated blank potential image {} with {} components", *potImageUid, numComps);
+  const std::optional<TaskToken> token = m_appData.state().seedSegmentationTask();
+  const bool cancelled = token && token->isCancelled();
 
-  // Algorithm outputs:
-  Image* resultSeg = m_appData.seg(*resultSegUid);
-  Image* potImage = m_appData.image(*potImageUid);
+  m_appData.state().setSeedSegmentationTask(std::nullopt);
+  m_appData.state().setSeedSegmentationStatus("");
 
-  if (!resultSeg)
+  std::optional<SeedSegmentationResult> result;
+
+  try
   {
-    spdlog::error("Null result segmentation {} for Poisson", *resultSegUid);
-    return false;
+    // A job that is cancelled before it starts is dropped, which breaks its promise
+    result = m_seedSegFuture.get();
   }
-
-  if (!potImage)
+  catch (const std::exception& e)
   {
-    spdlog::error("Null potential image {} for Poisson", *potImageUid);
-    return false;
+    if (!cancelled)
+    {
+      spdlog::error("Exception in seed segmentation: {}", e.what());
+    }
   }
 
-  if (image->header().pixelDimensions() != resultSeg->header().pixelDimensions())
+  if (cancelled)
   {
-    spdlog::error(
-      "Dimensions of image {} ({}) and result segmentation {} ({}) do not match",
-      imageUid,
-      glm::to_string(image->header().pixelDimensions()),
-      *resultSegUid,
-      glm::to_string(resultSeg->header().pixelDimensions())
-    );
-    return false;
+    spdlog::info("Seed segmentation was cancelled");
+    return std::nullopt;
   }
 
-  if (image->header().pixelDimensions() != potImage->header().pixelDimensions())
+  if (!result || !result->m_seg)
   {
-    spdlog::error(
-      "Dimensions of image {} ({}) and potential image {} ({}) do not match",
-      imageUid,
-      glm::to_string(image->header().pixelDimensions()),
-      *potImageUid,
-      glm::to_string(potImage->header().pixelDimensions())
-    );
-    return false;
+    spdlog::error("Seed segmentation failed");
+    return std::nullopt;
   }
 
-  spdlog::info(
-    "Executing Poisson segmentation on image {} with seeds {}; "
-    "resulting segmentation: {}; resulting potential: {}",
-    imageUid,
-    seedSegUid,
-    *resultSegUid,
-    *potImageUid
-  );
-
-  const VoxelDistances voxelDists = computeVoxelDistances(image->header().spacing(), true);
-
-  const float beta = computeBeta(imageBuffer, dims);
-  spdlog::debug("Poisson beta = {}", beta);
-
-  const uint32_t numIts = 10000;
-  const float rjac = 0.6f;
-
-  //    switch ( segType )
-  //    {
-  //    case SeedSegmentationType::Binary:
-  //    {
-  //        // First potential component is for all labels:
-  //        float* potBuffer = static_cast<float*>( potImage->bufferAsVoid(0) );
-  //        uint8_t* resultSegBuffer = static_cast<uint8_t*>( resultSeg->bufferAsVoid(0) );
-
-  //        initializePotential( seedSegBuffer, potBuffer, dims, 0u );
-  //        sor( seedSegBuffer, imageBuffer, potBuffer, dims, voxelDists, rjac, numIts, beta );
-  //        computeResultSeg( potBuffer, resultSegBuffer, dims );
-  //        break;
-  //    }
-  //    case SeedSegmentationType::MultiLabel:
-  //    {
-  //        break;
-  //    }
-  //    }
-
-  float* potBuffer = static_cast<float*>(potImage->bufferAsVoid(0));
-  uint8_t* resultSegBuffer = static_cast<uint8_t*>(resultSeg->bufferAsVoid(0));
+  const uuids::uuid imageUid = result->m_imageUid;
 
-  // 0th component of potential initialized by all labels:
-  initializePotential(seedSegBuffer, potBuffer, dims, 0u);
-  sor(seedSegBuffer, imageBuffer, potBuffer, dims, voxelDists, rjac, numIts, beta);
+  // Each result image is added with its texture created from the finished voxels
+  const auto resultSegUid = addSegWithColorTableAndTextures(imageUid, std::move(*result->m_seg));
 
-  std::vector<const float*> potBuffers(numLabels);
-
-  // Loop over all label indices:
-  for (uint8_t i = 1; i <= numLabels; ++i)
+  if (!resultSegUid)
   {
-    // ith component of potential initialized by label i:
-    potBuffer = static_cast<float*>(potImage->bufferAsVoid(i));
-    potBuffers[i - 1] = potBuffer;
-
-    initializePotential(seedSegBuffer, potBuffer, dims, labelMaps.indexToLabel.at(i));
-    sor(seedSegBuffer, imageBuffer, potBuffer, dims, voxelDists, rjac, numIts, beta);
+    spdlog::error("Unable to add result segmentation for image {}", imageUid);
+    return std::nullopt;
   }
 
-  computeResultSeg(potBuffers, resultSegBuffer, dims);
+  spdlog::info("Added result segmentation {} for image {}", *resultSegUid, imageUid);
 
-  potImage->updateComponentStats();
-  resultSeg->updateComponentStats();
+  if (result->m_potential)
+  {
+    static constexpr bool sk_createSegForPotential = true;
 
-  spdlog::debug("Potential image stats: {}", potImage->settings());
-  spdlog::debug("Resulting segmentation image stats: {}", resultSeg->settings());
+    const auto potImageUid
+      = addImageAndTexture(imageUid, std::move(*result->m_potential), sk_createSegForPotential);
 
-  spdlog::debug("Start updating potential image textures");
-  for (uint32_t i = 0; i < numComps; ++i)
-  {
-    m_rendering.updateImageTexture(
-      *potImageUid,
-      i,
-      potImage->header().memoryComponentType(),
-      glm::uvec3{0},
-      potImage->header().pixelDimensions(),
-      potImage->bufferAsVoid(i)
-    );
+    if (!potImageUid)
+    {
+      spdlog::error("Unable to add potential image for image {}", imageUid);
+    }
+    else
+    {
+      spdlog::info("Added potential image {} for image {}", *potImageUid, imageUid);
+    }
   }
-  spdlog::debug("Done updating potential image textures");
-
-  spdlog::debug("Start updating segmentation texture");
-  m_rendering.updateSegTexture(
-    *resultSegUid,
-    resultSeg->header().memoryComponentType(),
-    glm::uvec3{0},
-    resultSeg->header().pixelDimensions(),
-    resultSeg->bufferAsVoid(0)
-  );
-  spdlog::debug("Done updating segmentation texture");
 
-  return true;
+  return imageUid;
 }
 
 void CallbackHandler::recenterViews(
@@ -963,16 +1484,8 @@ void CallbackHandler::doSegment(const ViewHit& hit, bool swapFgAndBg)
     // View plane equation:
     const glm::vec4 voxelViewPlane = math::makePlane(voxelViewPlaneNormal, pixelPos3);
 
-    auto updateSegTexture = [this, &segUid](
-                              const ComponentType& memoryComponentType,
-                              const glm::uvec3& dataOffset,
-                              const glm::uvec3& dataSize,
-                              const LabelType* data
-                            )
-    {
-      m_rendering
-        .updateSegTextureWithInt64Data(segUid, memoryComponentType, dataOffset, dataSize, data);
-    };
+    auto saveSegBlock = [this, &segUid, seg](const glm::uvec3& offset, const glm::uvec3& size)
+    { m_segEditHistory.saveBlock(segUid, *seg, offset, size); };
 
     paintSegmentation(
       *seg,
@@ -985,9 +1498,119 @@ void CallbackHandler::doSegment(const ViewHit& hit, bool swapFgAndBg)
       brushSize,
       roundedPixelPos,
       voxelViewPlane,
-      updateSegTexture
+      saveSegBlock
+    );
+  }
+}
+
+void CallbackHandler::doRegionGrowing(const ViewHit& hit, bool swapFgAndBg)
+{
+  if (!hit.view)
+    return;
+
+  const auto activeImageUid = m_appData.activeImageUid();
+  if (!activeImageUid)
+    return;
+
+  if (!checkAndSetActiveView(hit.viewUid))
+    return;
+
+  const auto& visibleImages = hit.view->visibleImages();
+  if (0 == std::count(std::begin(visibleImages), std::end(visibleImages), *activeImageUid))
+  {
+    return; // The active image is not visible
+  }
+
+  const auto activeSegUid = m_appData.imageToActiveSegUid(*activeImageUid);
+  if (!activeSegUid)
+    return;
+
+  const Image* image = m_appData.image(*activeImageUid);
+  Image* seg = m_appData.seg(*activeSegUid);
+  if (!image || !seg)
+    return;
+
+  const AppSettings& settings = m_appData.settings();
+
+  const glm::mat4& pixel_T_worldDef = seg->transformations().pixel_T_worldDef();
+  const glm::vec4 pixelPos = pixel_T_worldDef * hit.worldPos_offsetApplied;
+  const glm::ivec3 seedVoxel{glm::round(glm::vec3{pixelPos / pixelPos.w})};
+
+  const uint32_t comp = image->settings().activeComponent();
+  std::pair<double, double> thresholds;
+
+  switch (settings.regionGrowThreshold())
+  {
+  case RegionGrowThreshold::WindowLevel:
+  {
+    thresholds = image->settings().windowValuesLowHigh(comp);
+    break;
+  }
+  case RegionGrowThreshold::SeedValue:
+  {
+    const auto seedValue = image->value<double>(comp, seedVoxel.x, seedVoxel.y, seedVoxel.z);
+    if (!seedValue)
+      return; // The seed is outside the image
+
+    const double tolerance = settings.regionGrowSeedTolerance();
+    thresholds = {*seedValue - tolerance, *seedValue + tolerance};
+    break;
+  }
+  }
+
+  // A 2D region grows in the voxel slice most aligned with the view plane
+  std::optional<int> sliceAxis;
+
+  if (!settings.regionGrow3d())
+  {
+    const glm::vec3 voxelViewPlaneNormal = glm::abs(
+      glm::inverseTranspose(glm::mat3(pixel_T_worldDef)) * hit.worldFrontAxis
     );
+
+    sliceAxis = (voxelViewPlaneNormal.x >= voxelViewPlaneNormal.y)
+                  ? (voxelViewPlaneNormal.x >= voxelViewPlaneNormal.z ? 0 : 2)
+                  : (voxelViewPlaneNormal.y >= voxelViewPlaneNormal.z ? 1 : 2);
   }
+
+  const LabelType labelToPaint = static_cast<LabelType>(
+    swapFgAndBg ? settings.backgroundLabel() : settings.foregroundLabel()
+  );
+
+  const LabelType labelToReplace = static_cast<LabelType>(
+    swapFgAndBg ? settings.foregroundLabel() : settings.backgroundLabel()
+  );
+
+  auto saveSegBlock = [this, &activeSegUid, seg](const glm::uvec3& offset, const glm::uvec3& size)
+  { m_segEditHistory.saveBlock(*activeSegUid, *seg, offset, size); };
+
+  PROFILE_SCOPE("Region growing");
+
+  // Filling the region is a separate step of the edit history
+  endSegEdit();
+
+  const std::size_t numVoxels = fillSegmentationByRegionGrowing(
+    *seg,
+    *image,
+    comp,
+    labelToPaint,
+    labelToReplace,
+    settings.replaceBackgroundWithForeground(),
+    seedVoxel,
+    thresholds.first,
+    thresholds.second,
+    settings.regionGrowConnectivity(),
+    sliceAxis,
+    saveSegBlock
+  );
+
+  endSegEdit();
+
+  spdlog::debug(
+    "Grew region of {} voxels with label {} in segmentation {}",
+    numVoxels,
+    labelToPaint,
+    *activeSegUid
+  );
 }
 
 void CallbackHandler::paintActiveSegmentationWithAnnotation()
@@ -1046,19 +1669,11 @@ void CallbackHandler::paintActiveSegmentationWithAnnotation()
     return;
   }
 
-  auto updateSegTexture = [this, &activeSegUid](
-                            const ComponentType& memoryComponentType,
-                            const glm::uvec3& dataOffset,
-                            const glm::uvec3& dataSize,
-                            const LabelType* data
-                          )
-  {
-    if (!activeSegUid)
-      return;
+  auto saveSegBlock = [this, &activeSegUid, seg](const glm::uvec3& offset, const glm::uvec3& size)
+  { m_segEditHistory.saveBlock(*activeSegUid, *seg, offset, size); };
 
-    m_rendering
-      .updateSegTextureWithInt64Data(*activeSegUid, memoryComponentType, dataOffset, dataSize, data);
-  };
+  // Filling the polygon is a separate step of the edit history
+  endSegEdit();
 
   fillSegmentationWithPolygon(
     *seg,
@@ -1066,10 +1681,128 @@ void CallbackHandler::paintActiveSegmentationWithAnnotation()
     static_cast<LabelType>(m_appData.settings().foregroundLabel()),
     static_cast<LabelType>(m_appData.settings().backgroundLabel()),
     m_appData.settings().replaceBackgroundWithForeground(),
-    updateSegTexture
+    saveSegBlock
+  );
+
+  endSegEdit();
+}
+
+void CallbackHandler::endSegEdit()
+{
+  if (!m_segEditHistory.isEditOpen())
+    return;
+
+  m_segEditHistory.setMemoryBudget(m_appData.settings().segUndoMemoryBudgetInMiB() * 1024 * 1024);
+  m_segEditHistory.endEdit(
+    [this](const uuids::uuid& segUid) { return m_appData.seg(segUid); },
+    [this](const SegEditHistory::SegChanges& changes) { updateSegLabelStatistics(changes); }
   );
 }
 
+bool CallbackHandler::undoSegEdit()
+{
+  return undoOrRedoSegEdit(true);
+}
+
+bool CallbackHandler::redoSegEdit()
+{
+  return undoOrRedoSegEdit(false);
+}
+
+bool CallbackHandler::undoOrRedoSegEdit(bool undo)
+{
+  endSegEdit();
+
+  auto getSeg = [this](const uuids::uuid& segUid) { return m_appData.seg(segUid); };
+
+  auto onChanges = [this](const SegEditHistory::SegChanges& changes)
+  { updateSegLabelStatistics(changes); };
+
+  return undo ? m_segEditHistory.undo(getSeg, onChanges) : m_segEditHistory.redo(getSeg, onChanges);
+}
+
+void CallbackHandler::removeSegFromEditHistory(const uuids::uuid& segUid)
+{
+  m_segEditHistory.removeSeg(segUid);
+  m_segLabelStats.erase(segUid);
+}
+
+const LabelStatistics* CallbackHandler::segLabelStatistics(
+  const uuids::uuid& imageUid, const uuids::uuid& segUid
+)
+{
+  // Read the segmentation as const, so that its data version does not change
+  const Image* seg = m_appData.seg(segUid);
+  if (!seg)
+    return nullptr;
+
+  const Image* image = m_appData.image(imageUid);
+  const uint32_t comp = image ? image->settings().activeComponent() : 0;
+
+  auto it = m_segLabelStats.find(segUid);
+
+  const bool isCurrent = std::end(m_segLabelStats) != it && imageUid == it->second.m_imageUid
+                         && comp == it->second.m_component
+                         && seg->dataVersion() == it->second.m_stats.dataVersion();
+
+  if (!isCurrent)
+  {
+    // The segmentation changes during an open edit, after which the statistics are updated
+    if (std::end(m_segLabelStats) != it && m_segEditHistory.isEditOpen())
+    {
+      return &(it->second.m_stats);
+    }
+
+    std::optional<LabelStatistics> stats = LabelStatistics::compute(*seg, image, comp);
+    if (!stats)
+    {
+      m_segLabelStats.erase(segUid);
+      return nullptr;
+    }
+
+    stats->setDataVersion(seg->dataVersion());
+
+    it = m_segLabelStats
+           .insert_or_assign(segUid, SegLabelStatistics{imageUid, comp, std::move(*stats)})
+           .first;
+  }
+
+  LabelStatistics& stats = it->second.m_stats;
+
+  if (stats.hasInexactBoundingBoxes() && !m_segEditHistory.isEditOpen())
+  {
+    stats.refreshBoundingBoxes(*seg);
+  }
+
+  return &stats;
+}
+
+void CallbackHandler::updateSegLabelStatistics(const SegEditHistory::SegChanges& changes)
+{
+  auto it = m_segLabelStats.find(changes.m_segUid);
+  if (std::end(m_segLabelStats) == it)
+    return;
+
+  LabelStatistics& stats = it->second.m_stats;
+
+  if (!changes.m_isComplete || changes.m_dataVersionBefore != stats.dataVersion())
+  {
+    // The statistics are recomputed when next requested
+    return;
+  }
+
+  const Image* image = stats.hasIntensity() ? m_appData.image(it->second.m_imageUid) : nullptr;
+
+  // The statistics are recomputed when next requested if their image no longer matches
+  if (!stats.moveVoxels(changes.m_voxels, image, it->second.m_component))
+  {
+    m_segLabelStats.erase(it);
+    return;
+  }
+
+  stats.setDataVersion(changes.m_dataVersionAfter);
+}
+
 void CallbackHandler::doWindowLevel(
   const ViewHit& startHit, const ViewHit& prevHit, const ViewHit& currHit, bool fineAdjustment
 )
@@ -2148,57 +2881,26 @@ void CallbackHandler::moveCrosshairsToSegLabelCentroid(
   const uuids::uuid& imageUid, std::size_t labelIndex
 )
 {
-  static constexpr uint32_t sk_comp0 = 0;
-
   const auto activeSegUid = m_appData.imageToActiveSegUid(imageUid);
   if (!activeSegUid)
     return;
 
-  Image* seg = m_appData.seg(*activeSegUid);
+  const Image* seg = m_appData.seg(*activeSegUid);
   if (!seg)
     return;
 
-  const void* data = seg->bufferAsVoid(sk_comp0);
-  const glm::ivec3 dims{seg->header().pixelDimensions()};
-  const LabelType label = static_cast<LabelType>(labelIndex);
-
-  std::optional<glm::vec3> pixelCentroid = std::nullopt;
-
-  switch (seg->header().memoryComponentType())
-  {
-  case ComponentType::Int8:
-    pixelCentroid = computePixelCentroid<int8_t>(data, dims, label);
-    break;
-  case ComponentType::UInt8:
-    pixelCentroid = computePixelCentroid<uint8_t>(data, dims, label);
-    break;
-  case ComponentType::Int16:
-    pixelCentroid = computePixelCentroid<int16_t>(data, dims, label);
-    break;
-  case ComponentType::UInt16:
-    pixelCentroid = computePixelCentroid<uint16_t>(data, dims, label);
-    break;
-  case ComponentType::Int32:
-    pixelCentroid = computePixelCentroid<int32_t>(data, dims, label);
-    break;
-  case ComponentType::UInt32:
-    pixelCentroid = computePixelCentroid<uint32_t>(data, dims, label);
-    break;
-  case ComponentType::Float32:
-    pixelCentroid = computePixelCentroid<float>(data, dims, label);
-    break;
-  default:
-    pixelCentroid = std::nullopt;
-    break;
-  }
+  const LabelStatistics* stats = segLabelStatistics(imageUid, *activeSegUid);
+  if (!stats)
+    return;
 
-  if (!pixelCentroid)
-  {
+  // If no voxels have this label, then do not move the crosshairs
+  const LabelStatistics::Stats* labelStats = stats->label(static_cast<LabelType>(labelIndex));
+  if (!labelStats)
     return;
-  }
 
+  const glm::vec3 pixelCentroid{labelStats->centroid()};
   const glm::vec4 worldCentroid = seg->transformations().worldDef_T_pixel()
-                                  * glm::vec4{*pixelCentroid, 1.0f};
+                                  * glm::vec4{pixelCentroid, 1.0f};
   glm::vec3 worldPos{worldCentroid / worldCentroid.w};
 
   worldPos = data::snapWorldPointToImageVoxels(m_appData, worldPos);
@@ -2,12 +2,21 @@
 #define CALLBACK_HANDLER_H
 
 #include "common/SegmentationTypes.h"
+#include "common/TaskScheduler.h"
 #include "common/Types.h"
+#include "image/Image.h"
 #include "logic/interaction/ViewHit.h"
+#include "logic/segmentation/LabelStatistics.h"
+#include "logic/segmentation/SegEditHistory.h"
 
 #include <glm/fwd.hpp>
+#include <functional>
+#include <future>
 #include <optional>
+#include <unordered_map>
+#include <utility>
 #include <uuid.h>
+#include <vector>
 
 class AppData;
 class GlfwWrapper;
@@ -30,6 +39,23 @@ public:
      */
   bool clearSegVoxels(const uuids::uuid& segUid);
 
+  /**
+   * @brief Start a morphological operation on a segmentation in the background. It runs on a copy
+   * of the segmentation, so the segmentation may be shown while it runs. Only one operation runs
+   * at a time. Its progress and cancellation token are in the app state, and its result is
+   * applied by \c applyCompletedSegMorphology.
+   *
+   * @return True iff the operation started
+   */
+  bool applySegMorphology(const uuids::uuid& segUid, const MorphologyParams& params);
+
+  /// If the segmentation morphology that runs in the background has finished, then write its
+  /// changed voxels to the segmentation, as a separate step of the edit history. The result is
+  /// dropped if the segmentation was edited while the operation ran.
+  /// This must be called from the main thread.
+  /// @return True iff voxels of a segmentation changed
+  bool applyCompletedSegMorphology();
+
   /// Create a blank multi-component image with the same header as the given image
   std::optional<uuids::uuid> createBlankImageAndTexture(
     const uuids::uuid& matchImageUid,
@@ -50,6 +76,14 @@ public:
     const uuids::uuid& matchImageUid, const std::string& displayName
   );
 
+  /**
+   * @brief Start a seed segmentation of an image in the background. The seeds are copied when it
+   * starts, so they may be edited while it runs. Only one seed segmentation runs at a time.
+   * Its progress and cancellation token are in the app state, and its result is added by
+   * \c addCompletedSeedSegmentation.
+   *
+   * @return True iff the segmentation started
+   */
   bool executeGraphCutsSegmentation(
     const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const SeedSegmentationType& segType
   );
@@ -58,6 +92,12 @@ public:
     const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const SeedSegmentationType& segType
   );
 
+  /// If the seed segmentation that runs in the background has finished, then add its result
+  /// segmentation (and potential image), creating their textures from the finished voxels.
+  /// This must be called from the main thread.
+  /// @return UID of the segmented image, if a result was added
+  std::optional<uuids::uuid> addCompletedSeedSegmentation();
+
   /**
      * @brief Move the crosshairs
      * @param windowLastPos
@@ -80,12 +120,44 @@ public:
      */
   void doSegment(const ViewHit& hit, bool swapFgAndBg);
 
+  /**
+   * @brief Fill the active segmentation of the active image with the region that grows from the
+   * voxel that is hit, through the voxels whose values in the active image component are in the
+   * threshold range of the region growing settings. The fill is one step of the edit history.
+   *
+   * @param hit Hit of the seed voxel
+   * @param swapFgAndBg Fill with the background label instead of the foreground label
+   */
+  void doRegionGrowing(const ViewHit& hit, bool swapFgAndBg);
+
   /**
      * @brief Paint the active segmentation of the active image with the
      * filled active annotation polygon. Do all of this in the annotation plane.
      */
   void paintActiveSegmentationWithAnnotation();
 
+  /// End the segmentation edit in progress (e.g. the brush stroke made while the mouse is held),
+  /// so that it becomes one step of the undo history
+  void endSegEdit();
+
+  /// Undo/redo the last segmentation edit
+  /// @return True iff an edit was undone/redone
+  bool undoSegEdit();
+  bool redoSegEdit();
+
+  /// Remove all edits of a segmentation from the undo history, along with its label statistics
+  void removeSegFromEditHistory(const uuids::uuid& segUid);
+
+  /**
+   * @brief Get the statistics of the labels of a segmentation, with the intensities of the active
+   * component of an image. The statistics are computed in one pass when first requested or when
+   * the segmentation was changed other than by edits of the undo history, which update them
+   * incrementally. While an edit is open, the statistics from before the edit are returned.
+   *
+   * @return Statistics, or null if the segmentation does not exist or has an invalid type
+   */
+  const LabelStatistics* segLabelStatistics(const uuids::uuid& imageUid, const uuids::uuid& segUid);
+
   /**
      * @brief Adjust image window/level
      * @param windowLastPos
@@ -299,6 +371,65 @@ private:
   GlfwWrapper& m_glfw;
   Rendering& m_rendering;
 
+  SegEditHistory m_segEditHistory; //!< Undo/redo history of segmentation edits
+
+  /// Label statistics of a segmentation, with the image component whose intensities they hold
+  struct SegLabelStatistics
+  {
+    uuids::uuid m_imageUid;
+    uint32_t m_component;
+    LabelStatistics m_stats;
+  };
+
+  /// Label statistics of segmentations, keyed by segmentation UID
+  std::unordered_map<uuids::uuid, SegLabelStatistics> m_segLabelStats;
+
+  /// Update the label statistics of a segmentation with the voxels changed by an edit
+  void updateSegLabelStatistics(const SegEditHistory::SegChanges& changes);
+
+  /// Result of a seed segmentation that ran in the background. The images are not yet in the
+  /// app data.
+  struct SeedSegmentationResult
+  {
+    uuids::uuid m_imageUid;           //!< Segmented image
+    std::optional<Image> m_seg;       //!< Result segmentation, unless it failed or was cancelled
+    std::optional<Image> m_potential; //!< Potential image of Poisson segmentation
+  };
+
+  std::future<SeedSegmentationResult> m_seedSegFuture; //!< Running seed segmentation
+
+  /// Result of a segmentation morphology that ran in the background on a copy of a segmentation
+  struct SegMorphologyResult
+  {
+    uuids::uuid m_segUid;       //!< Segmentation to which the operation was applied
+    uint64_t m_dataVersion;     //!< Data version of the segmentation when it was copied
+    std::optional<Image> m_seg; //!< Changed copy, unless the operation failed or was cancelled
+    std::size_t m_numVoxels;    //!< Number of changed voxels
+
+    /// Blocks of voxels (offset and size) that may have changed in the copy
+    std::vector<std::pair<glm::uvec3, glm::uvec3> > m_blocks;
+  };
+
+  std::future<SegMorphologyResult> m_segMorphologyFuture; //!< Running segmentation morphology
+
+  /// Submit a seed segmentation job, unless one is running
+  bool startSeedSegmentation(
+    AsyncTasks taskType, std::function<SeedSegmentationResult(const TaskToken&)> job
+  );
+
+  /// Add a segmentation with a label color table and textures, assigned to its matching image
+  std::optional<uuids::uuid> addSegWithColorTableAndTextures(
+    const uuids::uuid& matchImageUid, Image seg
+  );
+
+  /// Add an image with textures, whose header matches the given image
+  std::optional<uuids::uuid> addImageAndTexture(
+    const uuids::uuid& matchImageUid, Image image, bool createSegmentation
+  );
+
+  /// Undo (true) or redo (false) the last segmentation edit
+  bool undoOrRedoSegEdit(bool undo);
+
   /**
      * @brief This function is intended to run prior to cursor callbacks that require an active view.
      * If there is an active view and the active is NOT equal to the given view UID, then return false.
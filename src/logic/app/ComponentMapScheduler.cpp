@@ -0,0 +1,352 @@
+#include "logic/app/ComponentMapScheduler.h"
+
+#include "common/Profiler.h"
+#include "common/UuidUtility.h"
+#include "image/ComponentFloatView.h"
+#include "image/ImageUtility.h"
+#include "image/ImageUtility.tpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <exception>
+#include <string>
+
+namespace
+{
+
+// To conserve GPU memory, the map is downsampled by a factor of 0.5 relative to the
+// original image size. Also, the map is stored with uint8_t components.
+/// @todo make configurable
+static constexpr float sk_downsamplingFactor = 0.5f;
+
+// The isosurface threshold for separating foreground and background is set at the
+// 50th quantile image value. This seems to do a pretty good job for CT, T1, and T2 images.
+/// @todo Eventually, we should do a proper foreground/background segmentation.
+static constexpr uint32_t sk_thresholdQuantile = 50; // 50th percentile
+
+// Neighborhood radius of the noise estimate
+static constexpr uint32_t sk_noiseEstimateRadius = 1;
+
+} // namespace
+
+ComponentMapScheduler::ComponentMapScheduler(
+  TaskScheduler& scheduler, std::function<void()> onTaskDone
+)
+  : m_scheduler(scheduler)
+  , m_onTaskDone(std::move(onTaskDone))
+  , m_generation(0)
+{
+}
+
+ComponentMapScheduler::~ComponentMapScheduler()
+{
+  cancel();
+
+  // With the queue empty, the scheduler task returns after its running job, which stops early.
+  // If the scheduler dropped the task, then its promise is broken, which is ready.
+  std::future<void> runner;
+
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    runner = std::move(m_runner);
+  }
+
+  if (runner.valid())
+  {
+    runner.wait();
+  }
+}
+
+std::vector<uuids::uuid> ComponentMapScheduler::schedule(
+  const uuids::uuid& imageUid, const Image& image
+)
+{
+  std::vector<uuids::uuid> taskUids;
+
+  // If the image has multiple, interleaved components, then do not compute the distance map
+  // for the components, since we have not yet written functions to perform distance map
+  // calculations on images with interleaved components.
+  if (image.header().interleavedComponents())
+  {
+    spdlog::info(
+      "Image {} has multiple, interleaved components, "
+      "so the distance and noise estimate maps will not be computed",
+      imageUid
+    );
+    return taskUids;
+  }
+  else if (!image.settings().useDistanceMapForRaycasting())
+  {
+    spdlog::info("Image {} has disabled using the distance map for raycasting", imageUid);
+    return taskUids;
+  }
+
+  const uint64_t generation = m_generation;
+  const std::string imageName = image.settings().displayName();
+
+  std::lock_guard<std::mutex> lock(m_queueMutex);
+
+  for (uint32_t comp = 0; comp < image.header().numComponentsPerPixel(); ++comp)
+  {
+    // Read the foreground thresholds now, since image settings are not accessed by the worker
+    const auto& stats = image.settings().componentStatistics(comp);
+    const float minThreshold = static_cast<float>(stats.m_quantiles[sk_thresholdQuantile]);
+    const float maxThreshold = static_cast<float>(stats.m_maximum);
+
+    const uuids::uuid taskUid = generateRandomUuid();
+
+    std::packaged_task<AsyncTaskDetails()> task(
+      [=, this, &image]()
+      {
+        return computeComponentMaps(
+          taskUid, imageUid, image, imageName, comp, minThreshold, maxThreshold, generation
+        );
+      }
+    );
+
+    m_futures.emplace(taskUid, task.get_future());
+    m_queue.emplace_back(std::move(task));
+    taskUids.push_back(taskUid);
+
+    spdlog::debug(
+      "Scheduled task {} to compute maps of component {} of image {}", taskUid, comp, imageUid
+    );
+  }
+
+  // A scheduler task runs the jobs, unless one is already queued or running
+  if (!m_runnerActive && !m_queue.empty())
+  {
+    m_runnerActive = true;
+    m_runner = m_scheduler.submit(
+      AsyncTasks::ComponentMapsComputation, [this](const TaskToken&) { runQueuedJobs(); }
+    );
+  }
+
+  return taskUids;
+}
+
+void ComponentMapScheduler::cancel()
+{
+  ++m_generation;
+
+  {
+    // Dropping the jobs that have not started breaks the promises of their futures
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_queue.clear();
+    m_futures.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(m_completedMutex);
+  m_completed.clear();
+}
+
+std::vector<ComponentMapScheduler::ComponentMaps> ComponentMapScheduler::takeCompletedMaps()
+{
+  {
+    // Release the futures of finished jobs and report the ones that failed
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+
+    for (auto it = std::begin(m_futures); it != std::end(m_futures);)
+    {
+      if (std::future_status::ready != it->second.wait_for(std::chrono::seconds(0)))
+      {
+        ++it;
+        continue;
+      }
+
+      try
+      {
+        const AsyncTaskDetails details = it->second.get();
+        if (!details.success)
+        {
+          spdlog::warn("Task {} did not complete: {}", details.taskUid, details.description);
+        }
+      }
+      catch (const std::exception& e)
+      {
+        spdlog::error("Exception in task {}: {}", it->first, e.what());
+      }
+
+      it = m_futures.erase(it);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_completedMutex);
+  std::vector<ComponentMaps> maps;
+  maps.swap(m_completed);
+  return maps;
+}
+
+AsyncTaskDetails ComponentMapScheduler::computeComponentMaps(
+  const uuids::uuid& taskUid,
+  const uuids::uuid& imageUid,
+  const Image& image,
+  const std::string& imageName,
+  uint32_t comp,
+  float minThreshold,
+  float maxThreshold,
+  uint64_t generation
+)
+{
+  PROFILE_BACKGROUND_SCOPE("Compute component maps");
+
+  // Create float ITK images from which the distance maps and noise estimates are computed
+  using ItkImageCompType = float;
+
+  // To save GPU memory, use uint8_t components for the distance map image
+  using DistanceMapCompType = uint8_t;
+
+  using ImageType = itk::Image<ItkImageCompType, 3>;
+  using NoiseImageType = itk::Image<ItkImageCompType, 3>;
+  using DistanceMapImageType = itk::Image<DistanceMapCompType, 3>;
+
+  AsyncTaskDetails retval;
+  retval.task = AsyncTasks::ComponentMapsComputation;
+  retval.description = "Compute noise estimate and distance map of component "
+                       + std::to_string(comp);
+  retval.taskUid = taskUid;
+  retval.imageUid = imageUid;
+  retval.imageComponent = comp;
+  retval.success = false;
+
+  auto done = [this, &retval]()
+  {
+    if (m_onTaskDone)
+    {
+      m_onTaskDone();
+    }
+    return retval;
+  };
+
+  if (isCancelled(generation))
+  {
+    return done();
+  }
+
+  ComponentMaps maps;
+  maps.m_imageUid = imageUid;
+  maps.m_component = comp;
+
+  // Both maps are computed from the float view of the component, which aliases the image buffer
+  // if the component is already float. The view is released when the job finishes.
+  std::optional<ComponentFloatView> compView = createComponentFloatView(image, comp);
+
+  if (!compView)
+  {
+    spdlog::error("Unable to view component {} of image {} as float", comp, imageUid);
+    return done();
+  }
+
+  const ImageType::Pointer compImage = compView->m_itkImage;
+
+  if (isCancelled(generation))
+  {
+    return done();
+  }
+
+  const NoiseImageType::Pointer noiseEstimateItkImage
+    = computeNoiseEstimate<ItkImageCompType>(compImage, sk_noiseEstimateRadius);
+
+  if (noiseEstimateItkImage)
+  {
+    const std::string displayName = std::string("Noise estimate for component ")
+                                    + std::to_string(comp) + " of '" + imageName + "'";
+
+    maps.m_noiseEstimate
+      = createImageFromItkImage<ItkImageCompType>(noiseEstimateItkImage, displayName);
+    maps.m_noiseEstimateRadius = sk_noiseEstimateRadius;
+
+    spdlog::debug(
+      "Created noise estimate map with radius {} for component {} of image {}",
+      sk_noiseEstimateRadius,
+      comp,
+      imageUid
+    );
+  }
+  else
+  {
+    spdlog::error("Unable to create noise estimate for component {} of image {}", comp, imageUid);
+  }
+
+  if (isCancelled(generation))
+  {
+    return done();
+  }
+
+  // Compute foreground distance map for image component:
+  const DistanceMapImageType::Pointer distMapItkImage
+    = computeEuclideanDistanceMap<ItkImageCompType, DistanceMapCompType>(
+      compImage, comp, minThreshold, maxThreshold, sk_downsamplingFactor
+    );
+
+  if (distMapItkImage)
+  {
+    const std::string displayName = std::string("Distance map for component ")
+                                    + std::to_string(comp) + " of '" + imageName + "'";
+
+    maps.m_distanceMap = createImageFromItkImage<DistanceMapCompType>(distMapItkImage, displayName);
+    maps.m_distanceMapBoundaryValue = static_cast<double>(minThreshold);
+
+    const glm::uvec3 distMapSize = maps.m_distanceMap->header().pixelDimensions();
+
+    spdlog::debug(
+      "Created distance map (with dimensions {}x{}x{} voxels) to foreground region [{}, {}] "
+      "of component {} of image {}",
+      distMapSize.x,
+      distMapSize.y,
+      distMapSize.z,
+      minThreshold,
+      maxThreshold,
+      comp,
+      imageUid
+    );
+  }
+  else
+  {
+    spdlog::error("Unable to create distance map for component {} of image {}", comp, imageUid);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_completedMutex);
+
+    // Check again under the lock, so that maps are never kept after cancel() returns
+    if (isCancelled(generation))
+    {
+      return done();
+    }
+
+    m_completed.emplace_back(std::move(maps));
+  }
+
+  retval.success = true;
+  return done();
+}
+
+void ComponentMapScheduler::runQueuedJobs()
+{
+  while (true)
+  {
+    std::packaged_task<AsyncTaskDetails()> task;
+
+    {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+
+      if (m_queue.empty())
+      {
+        m_runnerActive = false;
+        return;
+      }
+
+      task = std::move(m_queue.front());
+      m_queue.pop_front();
+    }
+
+    task();
+  }
+}
+
+bool ComponentMapScheduler::isCancelled(uint64_t generation) const
+{
+  return (generation != m_generation);
+}
@@ -0,0 +1,120 @@
+#ifndef COMPONENT_MAP_SCHEDULER_H
+#define COMPONENT_MAP_SCHEDULER_H
+
+#include "common/AsyncTasks.h"
+#include "common/TaskScheduler.h"
+#include "image/Image.h"
+
+#include <uuid.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Computes the noise estimate and foreground distance map of image components as
+ * cancellable background jobs.
+ *
+ * One job is scheduled per image component. Jobs run one at a time, in the order that they are
+ * scheduled, in a background task of the task scheduler, since the ITK filters that compute the
+ * maps are already multi-threaded.
+ * Both maps of a component are computed from one float view of the component.
+ *
+ * Maps of finished jobs are kept by the scheduler until they are taken on the render thread and
+ * added to AppData. Until the distance map of a component is added, the component is raycast
+ * without a distance map.
+ */
+class ComponentMapScheduler
+{
+public:
+  /// Noise estimate and foreground distance map computed for one component of an image
+  struct ComponentMaps
+  {
+    uuids::uuid m_imageUid;
+    uint32_t m_component = 0;
+    std::optional<Image> m_noiseEstimate;    //!< Noise estimate image
+    uint32_t m_noiseEstimateRadius = 0;      //!< Neighborhood radius of the noise estimate
+    std::optional<Image> m_distanceMap;      //!< Distance map to the image foreground
+    double m_distanceMapBoundaryValue = 0.0; //!< Image value defining the foreground boundary
+  };
+
+  /**
+   * @param[in] scheduler Scheduler that runs the jobs, which must outlive this object
+   * @param[in] onTaskDone Function called from a scheduler worker after each job finishes
+   */
+  explicit ComponentMapScheduler(
+    TaskScheduler& scheduler, std::function<void()> onTaskDone = nullptr
+  );
+
+  /// Cancels all jobs and waits for the running job to stop
+  ~ComponentMapScheduler();
+
+  ComponentMapScheduler(const ComponentMapScheduler&) = delete;
+  ComponentMapScheduler& operator=(const ComponentMapScheduler&) = delete;
+
+  /**
+   * @brief Schedule computation of the maps of each component of an image
+   * @param[in] imageUid Image UID
+   * @param[in] image Image. It must remain valid until its jobs finish or are cancelled.
+   * @return UIDs of the scheduled tasks
+   */
+  std::vector<uuids::uuid> schedule(const uuids::uuid& imageUid, const Image& image);
+
+  /// Cancel all jobs. Jobs that have not started are dropped; a running job stops before its next
+  /// stage and its maps are discarded.
+  void cancel();
+
+  /// Take the maps computed by all jobs that finished since the last call
+  std::vector<ComponentMaps> takeCompletedMaps();
+
+private:
+  /// Compute the maps of one image component
+  /// @return Task details, with success set to false if the job failed or was cancelled
+  AsyncTaskDetails computeComponentMaps(
+    const uuids::uuid& taskUid,
+    const uuids::uuid& imageUid,
+    const Image& image,
+    const std::string& imageName,
+    uint32_t comp,
+    float minThreshold,
+    float maxThreshold,
+    uint64_t generation
+  );
+
+  /// Scheduler task that runs the queued jobs in order, until the queue is empty
+  void runQueuedJobs();
+
+  /// Has the generation of jobs been cancelled?
+  bool isCancelled(uint64_t generation) const;
+
+  TaskScheduler& m_scheduler;
+  std::function<void()> m_onTaskDone;
+
+  std::mutex m_queueMutex; //!< Guards the queue, futures, and the scheduler task
+
+  /// Future of the scheduler task that runs the queued jobs. Only one such task runs at a time.
+  std::future<void> m_runner;
+  bool m_runnerActive = false; //!< Is the scheduler task queued or running?
+
+  /// Jobs that have not started, in scheduled order
+  std::deque<std::packaged_task<AsyncTaskDetails()> > m_queue;
+
+  /// Futures of the jobs, keyed by task UID
+  std::unordered_map<uuids::uuid, std::future<AsyncTaskDetails> > m_futures;
+
+  /// Incremented when jobs are cancelled. Each job records the generation in which it was
+  /// scheduled and is cancelled once the generation changes.
+  std::atomic<uint64_t> m_generation;
+
+  std::mutex m_completedMutex;            //!< Guards the completed maps
+  std::vector<ComponentMaps> m_completed; //!< Maps of finished jobs that have not been taken
+};
+
+#endif // COMPONENT_MAP_SCHEDULER_H
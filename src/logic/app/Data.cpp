@@ -79,6 +79,7 @@ AppData::AppData()
   ,
 
   m_imagesBeingSegmented()
+  , m_taskScheduler()
 {
   spdlog::debug("Start loading image color maps");
   loadImageColorMaps();
@@ -636,8 +637,10 @@ bool AppData::removeSeg(const uuids::uuid& segUid)
   auto segMapIt = m_segs.find(segUid);
   if (std::end(m_segs) != segMapIt)
   {
-    // Remove the segmentation
+    // Remove the segmentation and its label meshes
     m_segs.erase(segMapIt);
+    setLabelMeshCpuRecords(segUid, LabelMeshCpuRecords());
+    setLabelMeshGpuRecords(segUid, {});
   }
   else
   {
@@ -1012,6 +1015,75 @@ bool AppData::updateIsosurfaceMeshGpuRecord(
   return false;
 }
 
+void AppData::setLabelMeshCpuRecords(const uuids::uuid& segUid, LabelMeshCpuRecords cpuRecords)
+{
+  std::lock_guard<std::mutex> lock(m_segLabelMeshesMutex);
+
+  if (cpuRecords.empty())
+  {
+    m_segLabelMeshes.erase(segUid);
+  }
+  else
+  {
+    m_segLabelMeshes[segUid] = std::move(cpuRecords);
+  }
+}
+
+LabelMeshCpuRecords AppData::labelMeshCpuRecords(const uuids::uuid& segUid) const
+{
+  std::lock_guard<std::mutex> lock(m_segLabelMeshesMutex);
+
+  auto it = m_segLabelMeshes.find(segUid);
+  if (std::end(m_segLabelMeshes) == it)
+    return LabelMeshCpuRecords();
+
+  return it->second;
+}
+
+std::shared_ptr<const MeshCpuRecord> AppData::labelMeshCpuRecord(
+  const uuids::uuid& segUid, LabelType label
+) const
+{
+  std::lock_guard<std::mutex> lock(m_segLabelMeshesMutex);
+
+  auto it = m_segLabelMeshes.find(segUid);
+  if (std::end(m_segLabelMeshes) == it)
+    return nullptr;
+
+  auto recordIt = it->second.find(label);
+  if (std::end(it->second) == recordIt)
+    return nullptr;
+
+  return recordIt->second;
+}
+
+void AppData::setLabelMeshGpuRecords(
+  const uuids::uuid& segUid, std::map<LabelType, std::unique_ptr<MeshGpuRecord> > gpuRecords
+)
+{
+  if (gpuRecords.empty())
+  {
+    m_segLabelMeshGpuRecords.erase(segUid);
+  }
+  else
+  {
+    m_segLabelMeshGpuRecords[segUid] = std::move(gpuRecords);
+  }
+}
+
+MeshGpuRecord* AppData::labelMeshGpuRecord(const uuids::uuid& segUid, LabelType label)
+{
+  auto it = m_segLabelMeshGpuRecords.find(segUid);
+  if (std::end(m_segLabelMeshGpuRecords) == it)
+    return nullptr;
+
+  auto recordIt = it->second.find(label);
+  if (std::end(it->second) == recordIt)
+    return nullptr;
+
+  return recordIt->second.get();
+}
+
 const ImageColorMap* AppData::imageColorMap(const uuids::uuid& colorMapUid) const
 {
   auto it = m_imageColorMaps.find(colorMapUid);
@@ -1942,3 +2014,8 @@ WindowData& AppData::windowData()
 {
   return m_windowData;
 }
+
+TaskScheduler& AppData::taskScheduler()
+{
+  return m_taskScheduler;
+}
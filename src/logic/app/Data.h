@@ -2,6 +2,7 @@
 #define APP_DATA_H
 
 #include "common/ParcellationLabelTable.h"
+#include "common/TaskScheduler.h"
 #include "common/UuidRange.h"
 
 #include "image/Image.h"
@@ -14,6 +15,8 @@
 #include "logic/app/State.h"
 #include "logic/serialization/ProjectSerialization.h"
 
+#include "mesh/MeshLoading.h"
+
 #include "rendering/RenderData.h"
 #include "windowing/WindowData.h"
 
@@ -60,6 +63,9 @@ public:
   const WindowData& windowData() const;
   WindowData& windowData();
 
+  /// Scheduler of the long-running tasks of the application
+  TaskScheduler& taskScheduler();
+
   /// @todo Put into AppState
   void setProject(serialize::EntropyProject project);
   const serialize::EntropyProject& project() const;
@@ -214,6 +220,36 @@ public:
     std::unique_ptr<MeshGpuRecord> gpuRecord
   );
 
+  /**
+   * @brief Set the CPU records of the label meshes of a segmentation, replacing its previous
+   * records. Empty records remove the meshes of the segmentation. This may be called from any
+   * thread.
+   */
+  void setLabelMeshCpuRecords(const uuids::uuid& segUid, LabelMeshCpuRecords cpuRecords);
+
+  /// Get the CPU records of the label meshes of a segmentation, which are empty if it has none.
+  /// The records are shared with the application, so they stay valid after newer meshes replace
+  /// them.
+  LabelMeshCpuRecords labelMeshCpuRecords(const uuids::uuid& segUid) const;
+
+  /// Get the CPU record of the mesh of a label of a segmentation, or nullptr if it has none
+  std::shared_ptr<const MeshCpuRecord> labelMeshCpuRecord(
+    const uuids::uuid& segUid, LabelType label
+  ) const;
+
+  /**
+   * @brief Set the GPU records of the label meshes of a segmentation, replacing its previous
+   * records. Empty records remove the GPU meshes of the segmentation. This must be called on the
+   * render thread.
+   */
+  void setLabelMeshGpuRecords(
+    const uuids::uuid& segUid, std::map<LabelType, std::unique_ptr<MeshGpuRecord> > gpuRecords
+  );
+
+  /// Get the GPU record of the mesh of a label of a segmentation, or nullptr if it has none. This
+  /// must be called on the render thread.
+  MeshGpuRecord* labelMeshGpuRecord(const uuids::uuid& segUid, LabelType label);
+
   const ImageColorMap* imageColorMap(const uuids::uuid& mapUid) const;
   ImageColorMap* imageColorMap(const uuids::uuid& mapUid);
 
@@ -414,6 +450,16 @@ private:
   std::unordered_map<uuids::uuid, Image> m_segs; //!< Segmentations, also stored as images
   std::vector<uuids::uuid> m_segUidsOrdered;     //!< Segmentation UIDs in order
 
+  /// Meshes of the labels of segmentations whose label tables show meshes, keyed by segmentation
+  /// UID. They are set by mesh generation tasks.
+  std::unordered_map<uuids::uuid, LabelMeshCpuRecords> m_segLabelMeshes;
+  mutable std::mutex m_segLabelMeshesMutex; //!< Guards the label meshes
+
+  /// GPU records of the label meshes, keyed by segmentation UID. They are only used on the render
+  /// thread.
+  std::unordered_map<uuids::uuid, std::map<LabelType, std::unique_ptr<MeshGpuRecord> > >
+    m_segLabelMeshGpuRecords;
+
   std::unordered_map<uuids::uuid, Image> m_defs; //!< Deformation fields, also stored as images
   std::vector<uuids::uuid> m_defUidsOrdered;     //!< Deformation field UIDs in order
 
@@ -466,6 +512,10 @@ private:
   /// Is an image being segmented (in addition to the active image)?
   /// @todo Move to AppState
   std::unordered_set<uuids::uuid> m_imagesBeingSegmented;
+
+  /// Scheduler of the long-running tasks. It is the last member, so that its workers are joined
+  /// before the data that tasks use is destroyed.
+  TaskScheduler m_taskScheduler;
 };
 
 #endif // APP_DATA_H
@@ -0,0 +1,169 @@
+#include "logic/app/ImageSaveScheduler.h"
+
+#include "common/UuidUtility.h"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <exception>
+#include <string>
+
+ImageSaveScheduler::ImageSaveScheduler(TaskScheduler& scheduler, std::function<void()> onTaskDone)
+  : m_scheduler(scheduler)
+  , m_onTaskDone(std::move(onTaskDone))
+{
+}
+
+ImageSaveScheduler::~ImageSaveScheduler()
+{
+  // Saves are not cancelled, since they hold the user's data: the scheduler task returns once all
+  // scheduled saves have finished
+  std::future<void> runner;
+  bool saved = false;
+
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    runner = std::move(m_runner);
+    saved = m_jobs.empty();
+  }
+
+  if (saved)
+  {
+    return;
+  }
+
+  spdlog::info("Waiting for scheduled image saves to finish");
+
+  if (runner.valid())
+  {
+    runner.wait();
+  }
+
+  // If the scheduler shut down before running the task, then the saves are written here
+  runQueuedJobs();
+}
+
+std::optional<uuids::uuid> ImageSaveScheduler::schedule(
+  const uuids::uuid& imageUid, const Image& image, uint32_t component, const fs::path& fileName
+)
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  std::optional<Image::ComponentSnapshot> snapshot = image.snapshotComponent(component);
+  if (!snapshot)
+  {
+    spdlog::error(
+      "Unable to take snapshot of component {} of image {} to save", component, imageUid
+    );
+    return std::nullopt;
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+
+  spdlog::debug(
+    "Took snapshot of component {} of image {} in {} ms",
+    component,
+    imageUid,
+    std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+  );
+
+  Job job;
+  job.m_details.task = AsyncTasks::ImageComponentSave;
+  job.m_details.description = "Save component " + std::to_string(component) + " of image to "
+                              + fileName.string();
+  job.m_details.taskUid = generateRandomUuid();
+  job.m_details.imageUid = imageUid;
+  job.m_details.imageComponent = component;
+  job.m_details.success = false;
+  job.m_fileName = fileName;
+  job.m_snapshot = std::move(*snapshot);
+
+  const uuids::uuid taskUid = job.m_details.taskUid;
+
+  std::lock_guard<std::mutex> lock(m_queueMutex);
+  m_jobs.emplace_back(std::move(job));
+
+  // A scheduler task runs the saves, unless one is already queued or running
+  if (!m_runnerActive)
+  {
+    m_runnerActive = true;
+    m_runner = m_scheduler.submit(
+      AsyncTasks::ImageComponentSave, [this](const TaskToken&) { runQueuedJobs(); }
+    );
+  }
+
+  spdlog::debug("Scheduled task {} to save image {} to {}", taskUid, imageUid, fileName);
+  return taskUid;
+}
+
+std::vector<AsyncTaskDetails> ImageSaveScheduler::pendingSaves() const
+{
+  std::lock_guard<std::mutex> lock(m_queueMutex);
+
+  std::vector<AsyncTaskDetails> details;
+  details.reserve(m_jobs.size());
+
+  for (const Job& job : m_jobs)
+  {
+    details.push_back(job.m_details);
+  }
+
+  return details;
+}
+
+std::vector<ImageSaveScheduler::SaveResult> ImageSaveScheduler::takeCompletedSaves()
+{
+  std::lock_guard<std::mutex> lock(m_queueMutex);
+  std::vector<SaveResult> results;
+  results.swap(m_completed);
+  return results;
+}
+
+void ImageSaveScheduler::runQueuedJobs()
+{
+  while (true)
+  {
+    const Job* job = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+
+      if (m_jobs.empty())
+      {
+        m_runnerActive = false;
+        return;
+      }
+
+      // The job stays at the front of the queue while it runs. Other threads only append jobs,
+      // which does not invalidate references to the front.
+      job = &m_jobs.front();
+    }
+
+    bool success = false;
+
+    try
+    {
+      success = Image::saveSnapshotToDisk(job->m_snapshot, job->m_fileName);
+    }
+    catch (const std::exception& e)
+    {
+      spdlog::error("Exception in task {}: {}", job->m_details.taskUid, e.what());
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+
+      SaveResult& result = m_completed.emplace_back();
+      result.m_details = job->m_details;
+      result.m_details.success = success;
+      result.m_fileName = job->m_fileName;
+
+      m_jobs.pop_front();
+    }
+
+    if (m_onTaskDone)
+    {
+      m_onTaskDone();
+    }
+  }
+}
@@ -0,0 +1,98 @@
+#ifndef IMAGE_SAVE_SCHEDULER_H
+#define IMAGE_SAVE_SCHEDULER_H
+
+#include "common/AsyncTasks.h"
+#include "common/TaskScheduler.h"
+#include "common/filesystem.h"
+#include "image/Image.h"
+
+#include <uuid.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief Saves image components (e.g. segmentations) to disk as background jobs.
+ *
+ * When a save is scheduled, a snapshot of the component is taken on the calling thread, so the
+ * image can keep changing (e.g. be painted) while it is saved. Snapshots are written one at a time,
+ * in the order that they are scheduled, in a background task of the task scheduler. Each file is
+ * written to a temporary file that is then renamed, so an existing file is never left partially
+ * overwritten.
+ *
+ * Results of finished saves are kept by the scheduler until they are taken on the render thread.
+ */
+class ImageSaveScheduler
+{
+public:
+  /// Result of a save
+  struct SaveResult
+  {
+    AsyncTaskDetails m_details; //!< Task details, with success set to true iff the file was saved
+    fs::path m_fileName;        //!< File name of the save
+  };
+
+  /**
+   * @param[in] scheduler Scheduler that runs the saves, which must outlive this object
+   * @param[in] onTaskDone Function called after each save finishes, usually from a scheduler worker
+   */
+  explicit ImageSaveScheduler(TaskScheduler& scheduler, std::function<void()> onTaskDone = nullptr);
+
+  /// Finishes all scheduled saves. Saves that the scheduler dropped when it shut down are written
+  /// on the calling thread.
+  ~ImageSaveScheduler();
+
+  ImageSaveScheduler(const ImageSaveScheduler&) = delete;
+  ImageSaveScheduler& operator=(const ImageSaveScheduler&) = delete;
+
+  /**
+   * @brief Schedule saving an image component to disk
+   * @param[in] imageUid Image UID
+   * @param[in] image Image. A snapshot of its component is taken before this function returns.
+   * @param[in] component Component to save
+   * @param[in] fileName File name at which to save the component
+   * @return UID of the scheduled task, or std::nullopt if the component could not be copied
+   */
+  std::optional<uuids::uuid> schedule(
+    const uuids::uuid& imageUid, const Image& image, uint32_t component, const fs::path& fileName
+  );
+
+  /// Details of the saves that are scheduled or running, in the order that they run
+  std::vector<AsyncTaskDetails> pendingSaves() const;
+
+  /// Take the results of all saves that finished since the last call
+  std::vector<SaveResult> takeCompletedSaves();
+
+private:
+  /// Save that has not finished
+  struct Job
+  {
+    AsyncTaskDetails m_details;
+    fs::path m_fileName;
+    Image::ComponentSnapshot m_snapshot;
+  };
+
+  /// Scheduler task that runs the scheduled saves in order, until none are left
+  void runQueuedJobs();
+
+  TaskScheduler& m_scheduler;
+  std::function<void()> m_onTaskDone;
+
+  mutable std::mutex m_queueMutex; //!< Guards the jobs, completed saves, and the scheduler task
+
+  /// Future of the scheduler task that runs the saves. Only one such task runs at a time.
+  std::future<void> m_runner;
+  bool m_runnerActive = false; //!< Is the scheduler task queued or running?
+
+  /// Jobs that have not finished, in scheduled order. The front job may be running.
+  std::deque<Job> m_jobs;
+
+  std::vector<SaveResult> m_completed; //!< Results of finished saves that have not been taken
+};
+
+#endif // IMAGE_SAVE_SCHEDULER_H
@@ -0,0 +1,295 @@
+#include "logic/app/ProjectPreloader.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+ProjectPreloader::ProjectPreloader(
+  TaskScheduler& scheduler,
+  std::size_t numThreads,
+  bool retainSortedImageBuffers,
+  ProgressCallback onProgress
+)
+  : m_scheduler(scheduler)
+  , m_maxNumThreads(0 == numThreads ? scheduler.numWorkers() : numThreads)
+  , m_retainSortedImageBuffers(retainSortedImageBuffers)
+  , m_onProgress(std::move(onProgress))
+  , m_nextDecoding(0)
+  , m_numFilesDecoded(0)
+{
+}
+
+ProjectPreloader::~ProjectPreloader()
+{
+  cancel();
+
+  // Each task returns after the file that it is decoding. Tasks that the scheduler dropped have
+  // broken promises, which are ready.
+  for (auto& task : m_tasks)
+  {
+    task.wait();
+  }
+}
+
+void ProjectPreloader::preload(const serialize::EntropyProject& project)
+{
+  const bool retainSorted = m_retainSortedImageBuffers;
+
+  auto queueImage = [this, retainSorted](const serialize::Image& serializedImage)
+  {
+    const fs::path imageFileName = serializedImage.m_imageFileName;
+
+    enqueue<Image>(
+      m_images,
+      imageFileName,
+      [imageFileName, retainSorted]() { return decodeImage(imageFileName, retainSorted); }
+    );
+
+    for (const auto& serializedSeg : serializedImage.m_segmentations)
+    {
+      const fs::path segFileName = serializedSeg.m_segFileName;
+
+      // The same segmentation file may be shared by several images, but it is loaded only once
+      if (0 == m_segs.count(segFileName))
+      {
+        enqueue<Image>(
+          m_segs, segFileName, [segFileName]() { return decodeSegmentation(segFileName); }
+        );
+      }
+    }
+
+    if (serializedImage.m_deformationFileName)
+    {
+      const fs::path defFileName = *serializedImage.m_deformationFileName;
+
+      if (0 == m_defs.count(defFileName))
+      {
+        enqueue<Image>(
+          m_defs, defFileName, [defFileName]() { return decodeDeformationField(defFileName); }
+        );
+      }
+    }
+
+    if (serializedImage.m_annotationsFileName)
+    {
+      const fs::path annotFileName = *serializedImage.m_annotationsFileName;
+
+      enqueue<std::optional<Annotations> >(
+        m_annotations,
+        annotFileName,
+        [annotFileName]() -> std::optional<Annotations>
+        {
+          Annotations annots;
+          if (serialize::openAnnotationsFromJsonFile(annots, annotFileName))
+          {
+            return annots;
+          }
+          return std::nullopt;
+        }
+      );
+    }
+
+    for (const auto& lm : serializedImage.m_landmarkGroups)
+    {
+      const fs::path csvFileName = lm.m_csvFileName;
+
+      enqueue<std::optional<Landmarks> >(
+        m_landmarks,
+        csvFileName,
+        [csvFileName]() -> std::optional<Landmarks>
+        {
+          Landmarks landmarks;
+          if (serialize::openLandmarkGroupCsvFile(landmarks, csvFileName))
+          {
+            return landmarks;
+          }
+          return std::nullopt;
+        }
+      );
+    }
+  };
+
+  std::size_t numFiles = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+
+    queueImage(project.m_referenceImage);
+
+    for (const auto& additionalImage : project.m_additionalImages)
+    {
+      queueImage(additionalImage);
+    }
+
+    numFiles = m_decodings.size();
+    m_numFiles = numFiles;
+  }
+
+  const std::size_t numTasks = std::clamp(numFiles, std::size_t{1}, m_maxNumThreads);
+
+  spdlog::info("Decoding {} project files with {} scheduler tasks", numFiles, numTasks);
+
+  for (std::size_t i = 0; i < numTasks; ++i)
+  {
+    m_tasks.emplace_back(m_scheduler.submit(
+      TaskPriority::Background, [this](const TaskToken& token) { decodeFiles(token); }, m_token
+    ));
+  }
+}
+
+void ProjectPreloader::cancel()
+{
+  // Files that have not been started are not decoded by the tasks, but they are still decoded
+  // on the calling thread if they are taken
+  m_token.cancel();
+}
+
+std::optional<Image> ProjectPreloader::takeImage(const fs::path& fileName)
+{
+  return take(m_images, fileName);
+}
+
+std::optional<Image> ProjectPreloader::takeSegmentation(const fs::path& fileName)
+{
+  return take(m_segs, fileName);
+}
+
+std::optional<Image> ProjectPreloader::takeDeformationField(const fs::path& fileName)
+{
+  return take(m_defs, fileName);
+}
+
+std::optional<std::optional<ProjectPreloader::Landmarks> > ProjectPreloader::takeLandmarks(
+  const fs::path& fileName
+)
+{
+  return take(m_landmarks, fileName);
+}
+
+std::optional<std::optional<ProjectPreloader::Annotations> > ProjectPreloader::takeAnnotations(
+  const fs::path& fileName
+)
+{
+  return take(m_annotations, fileName);
+}
+
+template<class T>
+void ProjectPreloader::enqueue(
+  FutureMap<T>& futures, const fs::path& fileName, std::function<T()> decode
+)
+{
+  // The caller holds the queue mutex
+  auto onDecoded = [this, fileName]()
+  {
+    Progress progress;
+    progress.m_numFilesDecoded = ++m_numFilesDecoded;
+    progress.m_numFiles = m_numFiles;
+    progress.m_lastFileName = fileName;
+
+    spdlog::debug(
+      "Decoded project file {} ({} of {})",
+      fileName,
+      progress.m_numFilesDecoded,
+      progress.m_numFiles
+    );
+
+    if (m_onProgress)
+    {
+      m_onProgress(progress);
+    }
+  };
+
+  auto task = std::make_shared<std::packaged_task<T()> >(
+    [decode = std::move(decode), onDecoded]()
+    {
+      T result = decode();
+      onDecoded();
+      return result;
+    }
+  );
+
+  Queued<T>& queued = futures.emplace(fileName, Queued<T>())->second;
+  queued.m_future = task->get_future();
+  queued.m_index = m_decodings.size();
+
+  m_decodings.emplace_back().m_run = [task]() { (*task)(); };
+}
+
+template<class T>
+std::optional<T> ProjectPreloader::take(FutureMap<T>& futures, const fs::path& fileName)
+{
+  Queued<T> queued;
+
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+
+    const auto it = futures.find(fileName);
+    if (std::end(futures) == it)
+    {
+      return std::nullopt;
+    }
+
+    queued = std::move(it->second);
+    futures.erase(it);
+  }
+
+  // Decode the file now if no task has started it, rather than wait for a task to reach it
+  runDecoding(queued.m_index);
+
+  // Re-throws any exception thrown while decoding:
+  return queued.m_future.get();
+}
+
+void ProjectPreloader::runDecoding(std::size_t index)
+{
+  Decoding& decoding = m_decodings[index];
+
+  if (!decoding.m_started.exchange(true))
+  {
+    decoding.m_run();
+  }
+}
+
+void ProjectPreloader::decodeFiles(const TaskToken& token)
+{
+  while (!token.isCancelled())
+  {
+    const std::size_t index = m_nextDecoding++;
+
+    if (m_decodings.size() <= index)
+    {
+      return;
+    }
+
+    runDecoding(index);
+  }
+}
+
+Image ProjectPreloader::decodeImage(const fs::path& fileName, bool retainSortedImageBuffers)
+{
+  return Image(
+    fileName,
+    Image::ImageRepresentation::Image,
+    Image::MultiComponentBufferType::SeparateImages,
+    retainSortedImageBuffers
+  );
+}
+
+Image ProjectPreloader::decodeSegmentation(const fs::path& fileName)
+{
+  // Creating an image as a segmentation will convert the pixel components to the most
+  // suitable unsigned integer type
+  return Image(
+    fileName,
+    Image::ImageRepresentation::Segmentation,
+    Image::MultiComponentBufferType::SeparateImages
+  );
+}
+
+Image ProjectPreloader::decodeDeformationField(const fs::path& fileName)
+{
+  // Components of a deformation field image are loaded as interleaved images
+  return Image(
+    fileName, Image::ImageRepresentation::Image, Image::MultiComponentBufferType::InterleavedImage
+  );
+}
@@ -0,0 +1,165 @@
+#ifndef PROJECT_PRELOADER_H
+#define PROJECT_PRELOADER_H
+
+#include "common/TaskScheduler.h"
+#include "common/filesystem.h"
+#include "image/Image.h"
+#include "logic/annotation/Annotation.h"
+#include "logic/annotation/PointRecord.h"
+#include "logic/serialization/ProjectSerialization.h"
+
+#include <glm/vec3.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Decodes the files of a project (images, segmentations, deformation fields, landmarks, and
+ * annotations) concurrently as background tasks of the task scheduler.
+ *
+ * Decoding a file does not touch AppData. The thread that adds the project to AppData takes each
+ * decoded file from the preloader in project order, blocking until that file is decoded, so that
+ * the order in which images, segmentations, and other data are added to AppData is the same as if
+ * the files were loaded serially. (In particular, the reference image remains at index 0.)
+ *
+ * A bounded number of scheduler tasks decode the files in project order. Taking a file whose
+ * decoding has not started decodes it on the calling thread, so the loader never waits on tasks
+ * that are queued behind it in the scheduler.
+ */
+class ProjectPreloader
+{
+public:
+  using Landmarks = std::map<std::size_t, PointRecord<glm::vec3> >;
+  using Annotations = std::vector<Annotation>;
+
+  /// Progress of decoding, reported after each file is decoded
+  struct Progress
+  {
+    std::size_t m_numFilesDecoded = 0; //!< Number of files decoded so far
+    std::size_t m_numFiles = 0;        //!< Total number of files queued for decoding
+    fs::path m_lastFileName;           //!< File that was most recently decoded
+  };
+
+  using ProgressCallback = std::function<void(const Progress&)>;
+
+  /**
+   * @brief Construct a preloader
+   * @param[in] scheduler Scheduler that runs the decoding tasks, which must outlive the preloader
+   * @param[in] numThreads Maximum number of files decoded concurrently (0 means one per worker of
+   * the scheduler)
+   * @param[in] retainSortedImageBuffers Keep sorted copies of decoded image components
+   * @param[in] onProgress Function called from a worker thread after each file is decoded
+   */
+  ProjectPreloader(
+    TaskScheduler& scheduler,
+    std::size_t numThreads,
+    bool retainSortedImageBuffers,
+    ProgressCallback onProgress = nullptr
+  );
+
+  /// Cancels decoding of files that have not been started and waits for the decoding tasks
+  ~ProjectPreloader();
+
+  ProjectPreloader(const ProjectPreloader&) = delete;
+  ProjectPreloader& operator=(const ProjectPreloader&) = delete;
+
+  /// Queue all files of a project for decoding, in project order, and submit the decoding tasks.
+  /// This must be called at most once.
+  void preload(const serialize::EntropyProject& project);
+
+  /// Cancel decoding of all files that have not yet been started
+  void cancel();
+
+  /**
+   * @brief Take a decoded file from the preloader, blocking until it is decoded. If decoding of
+   * the file has not started, then it is decoded on the calling thread.
+   * @return The decoded file, or std::nullopt if the file was not queued for decoding (or was
+   * already taken). Exceptions thrown while decoding the file are re-thrown to the caller.
+   */
+  std::optional<Image> takeImage(const fs::path& fileName);
+  std::optional<Image> takeSegmentation(const fs::path& fileName);
+  std::optional<Image> takeDeformationField(const fs::path& fileName);
+
+  /// @return Decoded landmarks or annotations, or std::nullopt if the file was not queued.
+  /// The inner std::nullopt indicates that the file could not be opened.
+  std::optional<std::optional<Landmarks> > takeLandmarks(const fs::path& fileName);
+  std::optional<std::optional<Annotations> > takeAnnotations(const fs::path& fileName);
+
+  /// Decode an image from disk
+  static Image decodeImage(const fs::path& fileName, bool retainSortedImageBuffers);
+
+  /// Decode a segmentation image from disk
+  static Image decodeSegmentation(const fs::path& fileName);
+
+  /// Decode a deformation field image from disk
+  static Image decodeDeformationField(const fs::path& fileName);
+
+private:
+  /// Decoding of one file
+  struct Decoding
+  {
+    std::function<void()> m_run;        //!< Decodes the file and sets its future
+    std::atomic<bool> m_started{false}; //!< Set by the thread that runs the decoding
+  };
+
+  /// Queued file of one type: its future and the index of its decoding
+  template<class T>
+  struct Queued
+  {
+    std::future<T> m_future;
+    std::size_t m_index = 0;
+  };
+
+  /// Queued files of one type, keyed by file name. A file name that is queued more than once
+  /// (e.g. the same image listed twice in the project) has one entry per occurrence.
+  template<class T>
+  using FutureMap = std::multimap<fs::path, Queued<T> >;
+
+  /// Queue decoding of a file, in project order
+  template<class T>
+  void enqueue(FutureMap<T>& futures, const fs::path& fileName, std::function<T()> decode);
+
+  /// Take the first file queued under a file name and wait for its result
+  template<class T>
+  std::optional<T> take(FutureMap<T>& futures, const fs::path& fileName);
+
+  /// Run a decoding, unless another thread has started it
+  void runDecoding(std::size_t index);
+
+  /// Scheduler task that decodes the files that have not been started, in project order
+  void decodeFiles(const TaskToken& token);
+
+  TaskScheduler& m_scheduler;
+  const std::size_t m_maxNumThreads;
+  const bool m_retainSortedImageBuffers;
+  ProgressCallback m_onProgress;
+
+  std::mutex m_queueMutex; //!< Guards the maps of queued files
+
+  /// Decodings in project order. The deque is not changed after preload() returns.
+  std::deque<Decoding> m_decodings;
+  std::atomic<std::size_t> m_nextDecoding; //!< Index of the next decoding to start
+
+  TaskToken m_token;                       //!< Token of the decoding tasks
+  std::vector<std::future<void> > m_tasks; //!< Futures of the decoding tasks
+
+  std::atomic<std::size_t> m_numFilesDecoded;
+  std::size_t m_numFiles = 0;
+
+  FutureMap<Image> m_images;
+  FutureMap<Image> m_segs;
+  FutureMap<Image> m_defs;
+  FutureMap<std::optional<Landmarks> > m_landmarks;
+  FutureMap<std::optional<Annotations> > m_annotations;
+};
+
+#endif // PROJECT_PRELOADER_H
@@ -19,15 +19,28 @@ AppSettings::AppSettings()
   , m_crosshairsMoveWithBrush(false)
   , m_brushSizeInVoxels(1)
   , m_brushSizeInMm(1.0f)
+  , m_segUndoMemoryBudgetInMiB(256)
   ,
 
   m_graphCutsWeightsAmplitude(1.0)
   , m_graphCutsWeightsSigma(0.01)
   , m_graphCutsNeighborhood(GraphNeighborhoodType::Neighbors6)
+  , m_graphCutsNumThreads(0)
+  , m_graphCutsBlockSize(0)
+  , m_seedSegmentationCropToSeeds(true)
+  , m_seedSegmentationCropPadding(16)
+  ,
+
+  m_regionGrowThreshold(RegionGrowThreshold::WindowLevel)
+  , m_regionGrowSeedTolerance(10.0)
+  , m_regionGrowConnectivity(RegionGrowConnectivity::Neighbors6)
+  , m_regionGrow3d(true)
   ,
 
   m_crosshairsMoveWhileAnnotating(false)
   , m_lockAnatomicalCoordinateAxesWithReferenceImage(false)
+  , m_retainSortedImageBuffers(false)
+  , m_numProjectLoadingThreads(0)
 {
 }
 
@@ -161,6 +174,15 @@ void AppSettings::setBrushSizeInMm(float size)
   m_brushSizeInMm = size;
 }
 
+std::size_t AppSettings::segUndoMemoryBudgetInMiB() const
+{
+  return m_segUndoMemoryBudgetInMiB;
+}
+void AppSettings::setSegUndoMemoryBudgetInMiB(std::size_t budget)
+{
+  m_segUndoMemoryBudgetInMiB = budget;
+}
+
 double AppSettings::graphCutsWeightsAmplitude() const
 {
   return m_graphCutsWeightsAmplitude;
@@ -188,6 +210,78 @@ void AppSettings::setGraphCutsNeighborhood(const GraphNeighborhoodType& hood)
   m_graphCutsNeighborhood = hood;
 }
 
+std::size_t AppSettings::graphCutsNumThreads() const
+{
+  return m_graphCutsNumThreads;
+}
+void AppSettings::setGraphCutsNumThreads(std::size_t numThreads)
+{
+  m_graphCutsNumThreads = numThreads;
+}
+
+int AppSettings::graphCutsBlockSize() const
+{
+  return m_graphCutsBlockSize;
+}
+void AppSettings::setGraphCutsBlockSize(int blockSize)
+{
+  m_graphCutsBlockSize = blockSize;
+}
+
+bool AppSettings::seedSegmentationCropToSeeds() const
+{
+  return m_seedSegmentationCropToSeeds;
+}
+void AppSettings::setSeedSegmentationCropToSeeds(bool crop)
+{
+  m_seedSegmentationCropToSeeds = crop;
+}
+
+int AppSettings::seedSegmentationCropPadding() const
+{
+  return m_seedSegmentationCropPadding;
+}
+void AppSettings::setSeedSegmentationCropPadding(int padding)
+{
+  m_seedSegmentationCropPadding = padding;
+}
+
+RegionGrowThreshold AppSettings::regionGrowThreshold() const
+{
+  return m_regionGrowThreshold;
+}
+void AppSettings::setRegionGrowThreshold(const RegionGrowThreshold& threshold)
+{
+  m_regionGrowThreshold = threshold;
+}
+
+double AppSettings::regionGrowSeedTolerance() const
+{
+  return m_regionGrowSeedTolerance;
+}
+void AppSettings::setRegionGrowSeedTolerance(double tolerance)
+{
+  m_regionGrowSeedTolerance = std::max(tolerance, 0.0);
+}
+
+RegionGrowConnectivity AppSettings::regionGrowConnectivity() const
+{
+  return m_regionGrowConnectivity;
+}
+void AppSettings::setRegionGrowConnectivity(const RegionGrowConnectivity& connectivity)
+{
+  m_regionGrowConnectivity = connectivity;
+}
+
+bool AppSettings::regionGrow3d() const
+{
+  return m_regionGrow3d;
+}
+void AppSettings::setRegionGrow3d(bool set)
+{
+  m_regionGrow3d = set;
+}
+
 bool AppSettings::crosshairsMoveWhileAnnotating() const
 {
   return m_crosshairsMoveWhileAnnotating;
@@ -205,3 +299,21 @@ void AppSettings::setLockAnatomicalCoordinateAxesWithReferenceImage(bool lock)
 {
   m_lockAnatomicalCoordinateAxesWithReferenceImage = lock;
 }
+
+bool AppSettings::retainSortedImageBuffers() const
+{
+  return m_retainSortedImageBuffers;
+}
+void AppSettings::setRetainSortedImageBuffers(bool retain)
+{
+  m_retainSortedImageBuffers = retain;
+}
+
+std::size_t AppSettings::numProjectLoadingThreads() const
+{
+  return m_numProjectLoadingThreads;
+}
+void AppSettings::setNumProjectLoadingThreads(std::size_t numThreads)
+{
+  m_numProjectLoadingThreads = numThreads;
+}
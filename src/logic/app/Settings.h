@@ -7,6 +7,7 @@
 
 #include <glm/vec3.hpp>
 
+#include <cstddef>
 #include <optional>
 
 /**
@@ -60,6 +61,9 @@ public:
   float brushSizeInMm() const;
   void setBrushSizeInMm(float size);
 
+  std::size_t segUndoMemoryBudgetInMiB() const;
+  void setSegUndoMemoryBudgetInMiB(std::size_t budget);
+
   double graphCutsWeightsAmplitude() const;
   void setGraphCutsWeightsAmplitude(double amplitude);
 
@@ -69,12 +73,42 @@ public:
   GraphNeighborhoodType graphCutsNeighborhood() const;
   void setGraphCutsNeighborhood(const GraphNeighborhoodType&);
 
+  std::size_t graphCutsNumThreads() const;
+  void setGraphCutsNumThreads(std::size_t numThreads);
+
+  int graphCutsBlockSize() const;
+  void setGraphCutsBlockSize(int blockSize);
+
+  bool seedSegmentationCropToSeeds() const;
+  void setSeedSegmentationCropToSeeds(bool crop);
+
+  int seedSegmentationCropPadding() const;
+  void setSeedSegmentationCropPadding(int padding);
+
+  RegionGrowThreshold regionGrowThreshold() const;
+  void setRegionGrowThreshold(const RegionGrowThreshold& threshold);
+
+  double regionGrowSeedTolerance() const;
+  void setRegionGrowSeedTolerance(double tolerance);
+
+  RegionGrowConnectivity regionGrowConnectivity() const;
+  void setRegionGrowConnectivity(const RegionGrowConnectivity& connectivity);
+
+  bool regionGrow3d() const;
+  void setRegionGrow3d(bool set);
+
   bool crosshairsMoveWhileAnnotating() const;
   void setCrosshairsMoveWhileAnnotating(bool set);
 
   bool lockAnatomicalCoordinateAxesWithReferenceImage() const;
   void setLockAnatomicalCoordinateAxesWithReferenceImage(bool lock);
 
+  bool retainSortedImageBuffers() const;
+  void setRetainSortedImageBuffers(bool retain);
+
+  std::size_t numProjectLoadingThreads() const;
+  void setNumProjectLoadingThreads(std::size_t numThreads);
+
 private:
   bool m_synchronizeZoom; //!< Synchronize zoom between views
   bool m_overlays;        //!< Render UI and vector overlays
@@ -91,6 +125,9 @@ private:
   bool m_crosshairsMoveWithBrush;         //!< Crosshairs move with the brush
   uint32_t m_brushSizeInVoxels;           //!< Brush size (diameter) in voxels
   float m_brushSizeInMm;                  //!< Brush size (diameter) in millimeters
+
+  /// Maximum memory (in MiB) used by the undo/redo history of segmentation edits
+  std::size_t m_segUndoMemoryBudgetInMiB;
   /* End segmentation drawing variables */
 
   /* Begin Graph Cuts weights variables */
@@ -98,8 +135,26 @@ private:
   double
     m_graphCutsWeightsSigma; //!< Standard deviation in exponential, assuming image normalized as [1%, 99%] -> [0, 1]
   GraphNeighborhoodType m_graphCutsNeighborhood; //!< Neighboorhood used for constructing graph
+
+  /// Number of threads used for Graph Cuts (0 means one per hardware thread; 1 means serial)
+  std::size_t m_graphCutsNumThreads;
+
+  /// Side length in voxels of the blocks of the multi-threaded max-flow solver (0 means automatic)
+  int m_graphCutsBlockSize;
   /* End Graph Cuts weights variables */
 
+  /// Seed segmentations (Graph Cuts and Poisson) only solve the bounding box of the seeds,
+  /// padded by m_seedSegmentationCropPadding voxels on all sides
+  bool m_seedSegmentationCropToSeeds;
+  int m_seedSegmentationCropPadding;
+
+  /* Begin region growing variables */
+  RegionGrowThreshold m_regionGrowThreshold;       //!< Intensity range of the region
+  double m_regionGrowSeedTolerance;                //!< Tolerance about the seed value
+  RegionGrowConnectivity m_regionGrowConnectivity; //!< Neighborhood of the voxels of the region
+  bool m_regionGrow3d; //!< Grow in 3D (true) or only in the view slice (false)
+  /* End region growing variables */
+
   /// Crosshairs move to the position of every new point added to an annotation
   bool m_crosshairsMoveWhileAnnotating;
 
@@ -107,6 +162,14 @@ private:
   /// and crosshairs rotate, too? When this option is true, the rotation of the
   /// coordinate axes are locked with the reference image.
   bool m_lockAnatomicalCoordinateAxesWithReferenceImage;
+
+  /// Keep a sorted copy of each image component in memory when loading images. This makes
+  /// quantile queries on floating-point images exact, but it doubles the memory used by images.
+  bool m_retainSortedImageBuffers;
+
+  /// Maximum number of worker threads that decode project files concurrently
+  /// (0 means one per hardware thread)
+  std::size_t m_numProjectLoadingThreads;
 };
 
 #endif // APP_SETTINGS_H
@@ -11,6 +11,9 @@ AppState::AppState()
   , m_worldRotationCenter(std::nullopt)
   , m_copiedAnnotation(std::nullopt)
   , m_quitApp(false)
+  , m_loadingStatus()
+  , m_seedSegTask(std::nullopt)
+  , m_seedSegStatus()
 //m_ipcHandler()
 {
 }
@@ -111,6 +114,54 @@ bool AppState::quitApp() const
   return m_quitApp;
 }
 
+void AppState::setLoadingStatus(const std::string& status)
+{
+  std::lock_guard<std::mutex> lock(m_loadingStatusMutex);
+  m_loadingStatus = status;
+}
+
+std::string AppState::loadingStatus() const
+{
+  std::lock_guard<std::mutex> lock(m_loadingStatusMutex);
+  return m_loadingStatus;
+}
+
+void AppState::setSeedSegmentationTask(const std::optional<TaskToken>& token)
+{
+  std::lock_guard<std::mutex> lock(m_seedSegMutex);
+  m_seedSegTask = token;
+}
+
+std::optional<TaskToken> AppState::seedSegmentationTask() const
+{
+  std::lock_guard<std::mutex> lock(m_seedSegMutex);
+  return m_seedSegTask;
+}
+
+void AppState::setSeedSegmentationStatus(const std::string& status)
+{
+  std::lock_guard<std::mutex> lock(m_seedSegMutex);
+  m_seedSegStatus = status;
+}
+
+std::string AppState::seedSegmentationStatus() const
+{
+  std::lock_guard<std::mutex> lock(m_seedSegMutex);
+  return m_seedSegStatus;
+}
+
+void AppState::setSegMorphologyTask(const std::optional<TaskToken>& token)
+{
+  std::lock_guard<std::mutex> lock(m_segMorphologyMutex);
+  m_segMorphologyTask = token;
+}
+
+std::optional<TaskToken> AppState::segMorphologyTask() const
+{
+  std::lock_guard<std::mutex> lock(m_segMorphologyMutex);
+  return m_segMorphologyTask;
+}
+
 /*
 void AppState::broadcastCrosshairsPosition()
 {
@@ -2,6 +2,7 @@
 #define APP_STATE_H
 
 #include "common/CoordinateFrame.h"
+#include "common/TaskScheduler.h"
 #include "common/Types.h"
 
 #include "logic/annotation/Annotation.h"
@@ -12,7 +13,9 @@
 #include <uuid.h>
 
 #include <atomic>
+#include <mutex>
 #include <optional>
+#include <string>
 
 /**
  * @brief Collection of application state that changes through its execution.
@@ -54,6 +57,24 @@ public:
   void setQuitApp(bool quit);
   bool quitApp() const;
 
+  /// Set/get the status of project loading, which is shown while images load.
+  /// These functions may be called from any thread.
+  void setLoadingStatus(const std::string& status);
+  std::string loadingStatus() const;
+
+  /// Set/get the token of the seed segmentation that runs in the background, which is
+  /// std::nullopt while none runs, and the status of its progress.
+  /// These functions may be called from any thread.
+  void setSeedSegmentationTask(const std::optional<TaskToken>& token);
+  std::optional<TaskToken> seedSegmentationTask() const;
+  void setSeedSegmentationStatus(const std::string& status);
+  std::string seedSegmentationStatus() const;
+
+  /// Set/get the token of the segmentation morphology that runs in the background, which is
+  /// std::nullopt while none runs. These functions may be called from any thread.
+  void setSegMorphologyTask(const std::optional<TaskToken>& token);
+  std::optional<TaskToken> segMorphologyTask() const;
+
 private:
   // void broadcastCrosshairsPosition();
   // IPCHandler m_ipcHandler;
@@ -70,6 +91,16 @@ private:
   std::optional<Annotation> m_copiedAnnotation; //!< Annotation copied to the clipboard
 
   std::atomic<bool> m_quitApp; //!< Flag to quit the application
+
+  mutable std::mutex m_loadingStatusMutex; //!< Guards the loading status
+  std::string m_loadingStatus;             //!< Status of project loading
+
+  mutable std::mutex m_seedSegMutex;      //!< Guards the seed segmentation token and status
+  std::optional<TaskToken> m_seedSegTask; //!< Token of the running seed segmentation
+  std::string m_seedSegStatus;            //!< Status of the running seed segmentation
+
+  mutable std::mutex m_segMorphologyMutex;      //!< Guards the segmentation morphology token
+  std::optional<TaskToken> m_segMorphologyTask; //!< Token of the running segmentation morphology
 };
 
 #endif // APP_STATE_H
@@ -1,13 +1,23 @@
 #include "logic/segmentation/GraphCuts.h"
 #include "logic/segmentation/GridCutsWrappers.h"
-#include "logic/segmentation/SegHelpers.h"
+#include "logic/segmentation/SparseSeeds.h"
+
+#include "common/ParallelFor.h"
+#include "image/ComponentDispatch.h"
+#include "image/Image.h"
 
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -16,8 +26,654 @@ namespace
 
 static const int32_t NUM_THREADS = static_cast<int32_t>(std::thread::hardware_concurrency());
 
+// Type used for the graph cuts to represent:
+// -capacities of edges between nodes and terminals
+// -capacities of edges between nodes and their neighbors
+// -total flow
+using CapType = float;
+
+/// Offset from a voxel to one of its neighbors and the distance between them
+struct NeighborOffset
+{
+  int dx;
+  int dy;
+  int dz;
+  float dist;
+};
+
+/// Offsets to the face neighbors in the positive x, y, and z directions. Edge capacities are
+/// symmetric, so each edge is computed once, from the voxel to its "forward" neighbor.
+std::array<NeighborOffset, 3> forwardFaceNeighbors(const VoxelDistances& d)
+{
+  return {{{1, 0, 0, d.distX}, {0, 1, 0, d.distY}, {0, 0, 1, d.distZ}}};
+}
+
+/// Offsets to the 13 "forward" neighbors of the 26-neighborhood: one of each pair of opposite
+/// face, edge, and vertex neighbors
+std::array<NeighborOffset, 13> forwardNeighbors26(const VoxelDistances& d)
+{
+  return {{
+    {1, 0, 0, d.distX},
+    {0, 1, 0, d.distY},
+    {0, 0, 1, d.distZ},
+    {1, 1, 0, d.distXY},
+    {-1, 1, 0, d.distXY},
+    {1, 0, 1, d.distXZ},
+    {-1, 0, 1, d.distXZ},
+    {0, 1, 1, d.distYZ},
+    {0, -1, 1, d.distYZ},
+    {1, 1, 1, d.distXYZ},
+    {-1, 1, 1, d.distXYZ},
+    {1, -1, 1, d.distXYZ},
+    {1, 1, -1, d.distXYZ},
+  }};
+}
+
+/**
+ * @brief Capacity of the edge between neighboring voxels: the Gaussian weight of the difference
+ * of their image values, divided by the distance between them. The weight is evaluated in single
+ * precision, the precision of the capacities.
+ */
+class EdgeCapacity
+{
+public:
+  EdgeCapacity(const GraphCutsEdgeWeight& weight, float dist)
+    : m_amplitudeOverDist(static_cast<float>(weight.m_amplitude / dist))
+    , m_low(static_cast<float>(weight.m_low))
+    , m_invScale(static_cast<float>(1.0 / ((weight.m_high - weight.m_low) * weight.m_sigma)))
+  {
+  }
+
+  CapType operator()(double diff) const
+  {
+    const float t = (static_cast<float>(diff) - m_low) * m_invScale;
+    return m_amplitudeOverDist * std::exp(-0.5f * t * t);
+  }
+
+private:
+  float m_amplitudeOverDist;
+  float m_low;
+  float m_invScale;
+};
+
+std::size_t voxelIndex(const glm::ivec3& dims, int x, int y, int z)
+{
+  return (static_cast<std::size_t>(z) * dims.y + y) * dims.x + x;
+}
+
+/**
+ * @brief Compute the capacities of the edges between n consecutive voxels of a row and their
+ * neighbors. This loop has no branches, so that the compiler can vectorize it.
+ *
+ * @param[in] a Image values of the voxels of the row
+ * @param[in] b Image values of the neighbors of the voxels
+ * @param[in] stride Distance between consecutive voxel values in the image buffer
+ */
+template<typename T>
+void computeRowCapacities(
+  const T* a, const T* b, std::size_t stride, int n, const EdgeCapacity& capacity, CapType* out
+)
+{
+  for (int i = 0; i < n; ++i)
+  {
+    out[i] = capacity(static_cast<double>(a[i * stride]) - static_cast<double>(b[i * stride]));
+  }
+}
+
+/// Capacities of the edges from each voxel to its source and sink terminals
+struct TerminalCapacities
+{
+  std::vector<CapType> m_source;
+  std::vector<CapType> m_sink;
+};
+
+template<typename S>
+void fillTerminalCapacities(
+  const S* seeds,
+  LabelType fgSeedValue,
+  CapType terminalCapacity,
+  std::size_t begin,
+  std::size_t end,
+  TerminalCapacities& caps
+)
+{
+  for (std::size_t i = begin; i < end; ++i)
+  {
+    const LabelType seed = static_cast<LabelType>(seeds[i]);
+    caps.m_source[i] = (seed > 0 && seed != fgSeedValue) ? terminalCapacity : 0;
+    caps.m_sink[i] = (seed == fgSeedValue) ? terminalCapacity : 0;
+  }
+}
+
+/// Capacities of the edges from each voxel to its face neighbors in the negative ("l") and
+/// positive ("g") directions, in the order expected by GridCut's set_caps function
+struct FaceNeighborCapacities
+{
+  std::array<std::vector<CapType>, 3> m_backward; //!< lee, ele, eel
+  std::array<std::vector<CapType>, 3> m_forward;  //!< gee, ege, eeg
+};
+
+/// Fill the face neighbor capacities of the voxels in slices [zBegin, zEnd). Each capacity
+/// array element is written by exactly one slab, so slabs can be filled concurrently.
+template<typename T>
+void fillFaceNeighborCapacities(
+  const T* data,
+  std::size_t stride,
+  const glm::ivec3& dims,
+  const VoxelDistances& voxelDistances,
+  const GraphCutsEdgeWeight& edgeWeight,
+  int zBegin,
+  int zEnd,
+  FaceNeighborCapacities& caps
+)
+{
+  const auto offsets = forwardFaceNeighbors(voxelDistances);
+
+  for (std::size_t a = 0; a < offsets.size(); ++a)
+  {
+    const NeighborOffset& o = offsets[a];
+    const EdgeCapacity capacity(edgeWeight, o.dist);
+    const std::size_t delta = voxelIndex(dims, o.dx, o.dy, o.dz);
+    const int n = dims.x - o.dx;
+
+    CapType* forward = caps.m_forward[a].data();
+    CapType* backward = caps.m_backward[a].data();
+
+    for (int z = zBegin; z < zEnd && z + o.dz < dims.z; ++z)
+    {
+      for (int y = 0; y + o.dy < dims.y; ++y)
+      {
+        const std::size_t i = voxelIndex(dims, 0, y, z);
+
+        computeRowCapacities(
+          data + i * stride, data + (i + delta) * stride, stride, n, capacity, forward + i
+        );
+
+        // The edge from the neighbor back to the voxel has the same capacity:
+        std::copy_n(forward + i, n, backward + i + delta);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Set the capacities of the edges from the voxels in slices [zBegin, zEnd) to their 26
+ * neighbors. Only edges leaving the slab's own nodes are set, so slabs can be filled concurrently.
+ * The capacity of an edge and its reverse edge are both computed from the difference (u - v),
+ * where v is the "forward" neighbor of u, so the two capacities are identical.
+ */
+template<typename T, class Grid>
+void fillNeighbor26Capacities(
+  Grid& grid,
+  const T* data,
+  std::size_t stride,
+  const glm::ivec3& dims,
+  const VoxelDistances& voxelDistances,
+  const GraphCutsEdgeWeight& edgeWeight,
+  int zBegin,
+  int zEnd
+)
+{
+  std::vector<CapType> row(static_cast<std::size_t>(dims.x));
+
+  // Set the capacities of the edges from the voxels of row (y, z) to their neighbors at offset
+  // d = (dx, dy, dz). Capacities are computed from the difference of the image values at offsets
+  // (a * d) and (b * d) from the voxels.
+  auto setRow = [&](int y, int z, int dx, int dy, int dz, int a, int b, const EdgeCapacity& cap)
+  {
+    const int x0 = std::max(0, -dx);
+    const int n = dims.x - std::abs(dx);
+
+    const std::size_t ia = voxelIndex(dims, x0 + a * dx, y + a * dy, z + a * dz);
+    const std::size_t ib = voxelIndex(dims, x0 + b * dx, y + b * dy, z + b * dz);
+
+    computeRowCapacities(data + ia * stride, data + ib * stride, stride, n, cap, row.data());
+
+    for (int k = 0; k < n; ++k)
+    {
+      grid.set_neighbor_cap(grid.node_id(x0 + k, y, z), dx, dy, dz, row[k]);
+    }
+  };
+
+  for (const NeighborOffset& o : forwardNeighbors26(voxelDistances))
+  {
+    const EdgeCapacity capacity(edgeWeight, o.dist);
+
+    for (int z = zBegin; z < zEnd; ++z)
+    {
+      for (int y = 0; y < dims.y; ++y)
+      {
+        // Edge to the forward neighbor u + o, with capacity from (u - (u + o)):
+        if (0 <= z + o.dz && z + o.dz < dims.z && 0 <= y + o.dy && y + o.dy < dims.y)
+        {
+          setRow(y, z, o.dx, o.dy, o.dz, 0, 1, capacity);
+        }
+
+        // Edge to the backward neighbor u - o, with capacity from ((u - o) - u):
+        if (0 <= z - o.dz && z - o.dz < dims.z && 0 <= y - o.dy && y - o.dy < dims.y)
+        {
+          setRow(y, z, -o.dx, -o.dy, -o.dz, 1, 0, capacity);
+        }
+      }
+    }
+  }
+}
+
+template<typename R, class Grid>
+void readSegmentation(
+  const Grid& grid, const glm::ivec3& dims, LabelType fgSeedValue, int zBegin, int zEnd, R* result
+)
+{
+  const R fgLabel = static_cast<R>(fgSeedValue);
+  std::size_t i = voxelIndex(dims, 0, 0, zBegin);
+
+  for (int z = zBegin; z < zEnd; ++z)
+  {
+    for (int y = 0; y < dims.y; ++y)
+    {
+      for (int x = 0; x < dims.x; ++x)
+      {
+        result[i++] = grid.get_segment(grid.node_id(x, y, z)) ? fgLabel : R{0};
+      }
+    }
+  }
+}
+
+/**
+ * @brief Call a function with the buffer of a segmentation, cast to its component type
+ * @return False iff the component type is not a segmentation component type
+ */
+template<class SegType, class Fn>
+bool visitSegBuffer(SegType& seg, Fn&& fn)
+{
+  // Cast the buffer to T*, or to const T* if the segmentation is const
+  auto cast = [&seg](auto* typeTag)
+  {
+    using T = std::remove_pointer_t<decltype(typeTag)>;
+    using PtrType = std::conditional_t<std::is_const_v<SegType>, const T*, T*>;
+    return static_cast<PtrType>(seg.bufferAsVoid(0));
+  };
+
+  switch (seg.header().memoryComponentType())
+  {
+  case ComponentType::UInt8:
+    fn(cast(static_cast<uint8_t*>(nullptr)));
+    return true;
+  case ComponentType::UInt16:
+    fn(cast(static_cast<uint16_t*>(nullptr)));
+    return true;
+  case ComponentType::UInt32:
+    fn(cast(static_cast<uint32_t*>(nullptr)));
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Binary graph cuts segmentation of buffers with the given dimensions. The buffers are
+ * accessed through visitors: \c visitSeeds(fn) calls fn(const S* seeds), \c visitImage(fn) calls
+ * fn(const T* data, std::size_t stride), and \c visitResult(fn) calls fn(R* result). Each visitor
+ * returns false iff the type of its buffer is not supported.
+ */
+template<class VisitSeeds, class VisitImage, class VisitResult>
+bool binarySegmentation(
+  const GraphNeighborhoodType& hoodType,
+  double terminalCapacity,
+  const LabelType& fgSeedValue,
+  const VoxelDistances& voxelDistances,
+  const GraphCutsEdgeWeight& edgeWeight,
+  const glm::ivec3& dims,
+  VisitSeeds&& visitSeeds,
+  VisitImage&& visitImage,
+  VisitResult&& visitResult,
+  std::size_t numThreads,
+  int blockSize,
+  const GraphCutsPhaseCallback& onPhase
+)
+{
+  using namespace std::chrono;
+
+  // Minimum number of voxels filled by a thread
+  constexpr std::size_t sk_minChunkSize = (std::size_t{1} << 16);
+
+  const std::size_t N = static_cast<std::size_t>(dims.x) * dims.y * dims.z;
+
+  if (0 == numThreads)
+  {
+    numThreads = parallel::numThreads();
+  }
+
+  // Run a function over slabs of slices [zBegin, zEnd) concurrently, using up to numThreads
+  auto forEachSlab = [&dims, &numThreads](auto&& fn)
+  {
+    parallel::forEachSlab(
+      dims.z,
+      static_cast<std::size_t>(dims.x) * dims.y,
+      sk_minChunkSize,
+      [&fn](std::size_t, int zBegin, int zEnd) { fn(zBegin, zEnd); },
+      numThreads
+    );
+  };
+
+  bool stopped = false;
+
+  // Enter a phase of the segmentation
+  // @return False iff the segmentation is stopped
+  auto enterPhase = [&onPhase, &stopped](GraphCutsPhase phase)
+  {
+    stopped = stopped || (onPhase && !onPhase(phase));
+    return !stopped;
+  };
+
+  if (!enterPhase(GraphCutsPhase::FillingGraph))
+  {
+    spdlog::info("Graph cuts segmentation was stopped");
+    return false;
+  }
+
+  spdlog::trace("Start filling grid capacities");
+  auto start = high_resolution_clock::now();
+
+  TerminalCapacities terminalCaps;
+  terminalCaps.m_source.resize(N);
+  terminalCaps.m_sink.resize(N);
+
+  const bool validSeeds = visitSeeds(
+    [&](const auto* seeds)
+    {
+      parallel::forEachChunk(
+        N,
+        sk_minChunkSize,
+        [&](std::size_t, std::size_t begin, std::size_t end)
+        {
+          fillTerminalCapacities(
+            seeds, fgSeedValue, static_cast<CapType>(terminalCapacity), begin, end, terminalCaps
+          );
+        },
+        numThreads
+      );
+    }
+  );
+
+  if (!validSeeds)
+  {
+    spdlog::error("Invalid component type of seeds for graph cuts");
+    return false;
+  }
+
+  // Solve the graph and write the result segmentation
+  // @return False iff the result segmentation has an invalid component type
+  auto solve = [&](auto& grid)
+  {
+    if (!enterPhase(GraphCutsPhase::ComputingMaxFlow))
+    {
+      return true;
+    }
+
+    spdlog::trace("Start computing max flow");
+    const auto solveStart = high_resolution_clock::now();
+    grid.compute_maxflow();
+    const auto solveStop = high_resolution_clock::now();
+
+    spdlog::trace(
+      "Graph cuts execution time: {} msec",
+      duration_cast<milliseconds>(solveStop - solveStart).count()
+    );
+
+    if (!enterPhase(GraphCutsPhase::WritingResult))
+    {
+      return true;
+    }
+
+    return visitResult(
+      [&](auto* result)
+      {
+        forEachSlab([&](int zBegin, int zEnd)
+                    { readSegmentation(grid, dims, fgSeedValue, zBegin, zEnd, result); });
+      }
+    );
+  };
+
+  bool validImage = false;
+  bool success = false;
+
+  switch (hoodType)
+  {
+  case GraphNeighborhoodType::Neighbors6:
+  {
+    FaceNeighborCapacities neighborCaps;
+
+    for (std::size_t a = 0; a < 3; ++a)
+    {
+      neighborCaps.m_backward[a].assign(N, 0);
+      neighborCaps.m_forward[a].assign(N, 0);
+    }
+
+    validImage = visitImage(
+      [&](const auto* data, std::size_t stride)
+      {
+        forEachSlab(
+          [&](int zBegin, int zEnd)
+          {
+            fillFaceNeighborCapacities(
+              data, stride, dims, voxelDistances, edgeWeight, zBegin, zEnd, neighborCaps
+            );
+          }
+        );
+      }
+    );
+
+    if (!validImage)
+    {
+      break;
+    }
+
+    auto setCaps = [&](auto& grid)
+    {
+      grid.set_caps(
+        terminalCaps.m_source.data(),
+        terminalCaps.m_sink.data(),
+        neighborCaps.m_backward[0].data(),
+        neighborCaps.m_forward[0].data(),
+        neighborCaps.m_backward[1].data(),
+        neighborCaps.m_forward[1].data(),
+        neighborCaps.m_backward[2].data(),
+        neighborCaps.m_forward[2].data()
+      );
+
+      spdlog::trace(
+        "Grid fill time: {} msec",
+        duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+      );
+    };
+
+    if (1 < numThreads)
+    {
+      const int numSolverThreads = static_cast<int>(numThreads);
+
+      if (blockSize <= 0)
+      {
+        blockSize = std::max(32, std::min(dims.x, std::min(dims.y, dims.z)) / numSolverThreads);
+      }
+
+      spdlog::info("Number of threads: {}; block size: {}", numSolverThreads, blockSize);
+
+      GridGraph_3D_6C_MT<CapType, CapType, CapType> grid(
+        dims.x, dims.y, dims.z, numSolverThreads, blockSize
+      );
+      setCaps(grid);
+      success = solve(grid);
+    }
+    else
+    {
+      GridGraph_3D_6C<CapType, CapType, CapType> grid(dims.x, dims.y, dims.z);
+      setCaps(grid);
+      success = solve(grid);
+    }
+    break;
+  }
+  case GraphNeighborhoodType::Neighbors26:
+  {
+    // GridCut has no multi-threaded solver for 26-neighborhoods, but the grid is filled in parallel
+    GridGraph_3D_26C<CapType, CapType, CapType> grid(dims.x, dims.y, dims.z);
+
+    // Setting terminal capacities modifies state shared by all nodes, so this is serial
+    std::size_t i = 0;
+
+    for (int z = 0; z < dims.z; ++z)
+    {
+      for (int y = 0; y < dims.y; ++y)
+      {
+        for (int x = 0; x < dims.x; ++x, ++i)
+        {
+          grid.set_terminal_cap(
+            grid.node_id(x, y, z), terminalCaps.m_source[i], terminalCaps.m_sink[i]
+          );
+        }
+      }
+    }
+
+    validImage = visitImage(
+      [&](const auto* data, std::size_t stride)
+      {
+        forEachSlab(
+          [&](int zBegin, int zEnd)
+          {
+            fillNeighbor26Capacities(
+              grid, data, stride, dims, voxelDistances, edgeWeight, zBegin, zEnd
+            );
+          }
+        );
+      }
+    );
+
+    if (!validImage)
+    {
+      break;
+    }
+
+    spdlog::trace(
+      "Grid fill time: {} msec",
+      duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+    );
+
+    success = solve(grid);
+    break;
+  }
+  }
+
+  if (!validImage)
+  {
+    spdlog::error("Invalid image component type for graph cuts segmentation");
+    return false;
+  }
+
+  if (stopped)
+  {
+    spdlog::info("Graph cuts segmentation was stopped");
+    return false;
+  }
+
+  if (!success)
+  {
+    spdlog::error("Invalid component type of result for graph cuts");
+    return false;
+  }
+
+  return true;
+}
+
 } // namespace
 
+bool graphCutsBinarySegmentation(
+  const GraphNeighborhoodType& hoodType,
+  double terminalCapacity,
+  const LabelType& fgSeedValue,
+  const VoxelDistances& voxelDistances,
+  const GraphCutsEdgeWeight& edgeWeight,
+  const Image& image,
+  uint32_t imageComponent,
+  const Image& seedSeg,
+  Image& resultSeg,
+  std::size_t numThreads,
+  int blockSize,
+  const GraphCutsPhaseCallback& onPhase
+)
+{
+  if (seedSeg.header().pixelDimensions() != image.header().pixelDimensions() ||
+      resultSeg.header().pixelDimensions() != image.header().pixelDimensions())
+  {
+    spdlog::error("Dimensions of image and segmentations for graph cuts do not match");
+    return false;
+  }
+
+  if (imageComponent >= image.header().numComponentsPerPixel())
+  {
+    spdlog::error("Invalid image component {} for graph cuts segmentation", imageComponent);
+    return false;
+  }
+
+  return binarySegmentation(
+    hoodType,
+    terminalCapacity,
+    fgSeedValue,
+    voxelDistances,
+    edgeWeight,
+    glm::ivec3{image.header().pixelDimensions()},
+    [&seedSeg](auto&& fn) { return visitSegBuffer(seedSeg, fn); },
+    [&image, &imageComponent](auto&& fn)
+    { return visitComponentBuffer(image, imageComponent, fn); },
+    [&resultSeg](auto&& fn) { return visitSegBuffer(resultSeg, fn); },
+    numThreads,
+    blockSize,
+    onPhase
+  );
+}
+
+bool graphCutsBinarySegmentation(
+  const GraphNeighborhoodType& hoodType,
+  double terminalCapacity,
+  const LabelType& fgSeedValue,
+  const VoxelDistances& voxelDistances,
+  const GraphCutsEdgeWeight& edgeWeight,
+  const glm::ivec3& dims,
+  const float* image,
+  const uint8_t* seeds,
+  uint8_t* result,
+  std::size_t numThreads,
+  int blockSize,
+  const GraphCutsPhaseCallback& onPhase
+)
+{
+  return binarySegmentation(
+    hoodType,
+    terminalCapacity,
+    fgSeedValue,
+    voxelDistances,
+    edgeWeight,
+    dims,
+    [seeds](auto&& fn)
+    {
+      fn(seeds);
+      return true;
+    },
+    [image](auto&& fn)
+    {
+      fn(image, std::size_t{1});
+      return true;
+    },
+    [result](auto&& fn)
+    {
+      fn(result);
+      return true;
+    },
+    numThreads,
+    blockSize,
+    onPhase
+  );
+}
+
 bool graphCutsBinarySegmentation(
   const GraphNeighborhoodType& hoodType,
   double terminalCapacity,
@@ -140,7 +796,7 @@ bool graphCutsBinarySegmentation(
       cap_eeg.get()
     );
   }
-  else if (GraphNeighborhoodType::Neighbors26 == hoodType)
+  else
   {
     // Set symmetric capacities for edges from X to X + dX and from X + dX to X
     auto setNeighCaps =
@@ -280,48 +936,56 @@ bool graphCutsBinarySegmentation(
 bool graphCutsMultiLabelSegmentation(
   const GraphNeighborhoodType& hoodType,
   double terminalCapacity,
-  const glm::ivec3& dims,
   const VoxelDistances& voxelDistances,
   std::function<double(int x, int y, int z, int dx, int dy, int dz)> /*getImageWeight*/,
   std::function<double(int index1, int index2)> getImageWeight1D,
-  std::function<LabelType(int x, int y, int z)> getSeedValue,
-  std::function<void(int x, int y, int z, LabelType value)> setResultSegValue
+  const SparseSeeds& seeds,
+  std::function<void(int x, int y, int z, LabelType value)> setResultSegValue,
+  const GraphCutsPhaseCallback& onPhase
 )
 {
   using namespace std::chrono;
 
+  if (onPhase && !onPhase(GraphCutsPhase::FillingGraph))
+  {
+    spdlog::info("Graph cuts segmentation was stopped");
+    return false;
+  }
+
   // Type used for the alpha expansion algorithm to represent:
   // -data and smoothness costs
   // -resulting energy
   using T = float;
 
-  static constexpr bool sk_ignoreBackgroundLabel = true;
-  const LabelIndexMaps labelMaps = createLabelIndexMaps(dims, getSeedValue, sk_ignoreBackgroundLabel);
+  const glm::ivec3& dims = seeds.dims();
+
+  // The labels are those of the seeds, so no voxels are scanned to find them
+  static constexpr bool sk_includeBackgroundLabel = false;
+  const LabelIndexMaps labelMaps = seeds.labelIndexMaps(sk_includeBackgroundLabel);
   const std::size_t numLabels = labelMaps.labelToIndex.size();
 
   spdlog::debug("Start creating expansion");
 
-  std::vector<T> dataCosts(dims.x * dims.y * dims.z * numLabels, 0);
-
   auto getIndex = [&dims](int x, int y, int z) -> std::size_t
-  { return z * (dims.x * dims.y) + y * dims.x + x; };
+  { return (static_cast<std::size_t>(z) * dims.y + y) * dims.x + x; };
 
-  for (int z = 0; z < dims.z; ++z)
+  // Every label costs the terminal capacity, except the label of a seed voxel, which costs zero
+  std::vector<T> dataCosts(
+    static_cast<std::size_t>(dims.x) * dims.y * dims.z * numLabels,
+    static_cast<T>(terminalCapacity)
+  );
+
+  for (const auto& [label, runs] : seeds.runs())
   {
-    for (int y = 0; y < dims.y; ++y)
-    {
-      for (int x = 0; x < dims.x; ++x)
-      {
-        const LabelType seedLabel = getSeedValue(x, y, z);
+    const std::size_t labelIndex = labelMaps.labelToIndex.at(label);
 
-        for (std::size_t labelIndex = 0; labelIndex < numLabels; ++labelIndex)
-        {
-          const LabelType label = labelMaps.indexToLabel.at(labelIndex);
+    for (const SparseSeeds::Run& run : runs)
+    {
+      const std::size_t start = getIndex(run.m_x, run.m_y, run.m_z);
 
-          dataCosts[getIndex(x, y, z) * numLabels + labelIndex] = (seedLabel == label)
-                                                                    ? 0.0f
-                                                                    : terminalCapacity;
-        }
+      for (int i = 0; i < run.m_length; ++i)
+      {
+        dataCosts[(start + i) * numLabels + labelIndex] = 0.0f;
       }
     }
   }
@@ -469,6 +1133,12 @@ bool graphCutsMultiLabelSegmentation(
 
   spdlog::debug("Done creating expansion");
 
+  if (onPhase && !onPhase(GraphCutsPhase::ComputingMaxFlow))
+  {
+    spdlog::info("Graph cuts segmentation was stopped");
+    return false;
+  }
+
   spdlog::debug("Start computing expansion");
   auto start = high_resolution_clock::now();
   {
@@ -480,6 +1150,12 @@ bool graphCutsMultiLabelSegmentation(
   spdlog::debug("Done computing expansion");
   spdlog::debug("Graph cuts (with alpha expansion) execution time: {} msec", duration.count());
 
+  if (onPhase && !onPhase(GraphCutsPhase::WritingResult))
+  {
+    spdlog::info("Graph cuts segmentation was stopped");
+    return false;
+  }
+
   spdlog::debug("Start reading back segmentation results");
   LabelType* labeling = expansion->get_labeling();
 
@@ -6,8 +6,107 @@
 #include <glm/fwd.hpp>
 #include <uuid.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 
+class Image;
+class SparseSeeds;
+
+/**
+ * @brief Parameters of the Gaussian weight of the edge between two neighboring voxels with
+ * image values a and b: amplitude * exp(-0.5 * (((a - b) - low) / ((high - low) * sigma))^2)
+ */
+struct GraphCutsEdgeWeight
+{
+  double m_amplitude = 1.0; //!< Multiplier in front of exponential
+  double m_sigma = 1.0;     //!< Standard deviation in exponential
+  double m_low = 0.0;       //!< Image value mapped to 0 (typically the 1st percentile)
+  double m_high = 1.0;      //!< Image value mapped to 1 (typically the 99th percentile)
+};
+
+/// Phases of a graph cuts segmentation, in order
+enum class GraphCutsPhase
+{
+  FillingGraph,     //!< Filling the capacities of the edges of the graph
+  ComputingMaxFlow, //!< Computing the max flow (or the alpha expansion) of the graph
+  WritingResult     //!< Writing the result segmentation
+};
+
+/// Function called as a graph cuts segmentation enters each phase. The segmentation stops if it
+/// returns false. A phase that has started is not interrupted.
+using GraphCutsPhaseCallback = std::function<bool(GraphCutsPhase phase)>;
+
+/**
+ * @brief Binary graph cuts segmentation of an image component, seeded by a segmentation.
+ *
+ * The terminal and neighbor edge capacities are filled directly from the raw component buffers of
+ * the image and seed segmentation, and the result is written directly to the buffer of the result
+ * segmentation. Edge weights are computed for whole rows of voxels at a time.
+ *
+ * @param[in] hoodType Neighborhood of voxels connected by edges
+ * @param[in] terminalCapacity Capacity of edges between seed voxels and the terminals
+ * @param[in] fgSeedValue Foreground seed label. All other non-zero seeds are background.
+ * @param[in] voxelDistances Distances between neighboring voxels
+ * @param[in] edgeWeight Parameters of the edge weights
+ * @param[in] image Image
+ * @param[in] imageComponent Component of the image to segment
+ * @param[in] seedSeg Seed segmentation, with the same dimensions as the image
+ * @param[out] resultSeg Result segmentation, with the same dimensions as the image
+ * @param[in] numThreads Number of threads used to fill the graph and compute the max flow
+ * (0 means one per hardware thread). With one thread, the serial max-flow solver is used.
+ * Only 6-neighborhood graphs have a multi-threaded max-flow solver.
+ * @param[in] blockSize Side length (in voxels) of the blocks into which the multi-threaded solver
+ * divides the grid (0 means automatic)
+ * @param[in] onPhase Optional function called as the segmentation enters each phase
+ *
+ * @return True iff the segmentation succeeded and was not stopped by \c onPhase
+ */
+bool graphCutsBinarySegmentation(
+  const GraphNeighborhoodType& hoodType,
+  double terminalCapacity,
+  const LabelType& fgSeedValue,
+  const VoxelDistances& voxelDistances,
+  const GraphCutsEdgeWeight& edgeWeight,
+  const Image& image,
+  uint32_t imageComponent,
+  const Image& seedSeg,
+  Image& resultSeg,
+  std::size_t numThreads,
+  int blockSize,
+  const GraphCutsPhaseCallback& onPhase = nullptr
+);
+
+/**
+ * @brief Binary graph cuts segmentation of dense buffers, e.g. of a region of interest that was
+ * cropped from an image
+ *
+ * @param[in] dims Dimensions of the buffers
+ * @param[in] image Image values
+ * @param[in] seeds Seed labels
+ * @param[out] result Result segmentation: \c fgSeedValue for foreground and 0 for background
+ *
+ * @see The function above for the other parameters
+ */
+bool graphCutsBinarySegmentation(
+  const GraphNeighborhoodType& hoodType,
+  double terminalCapacity,
+  const LabelType& fgSeedValue,
+  const VoxelDistances& voxelDistances,
+  const GraphCutsEdgeWeight& edgeWeight,
+  const glm::ivec3& dims,
+  const float* image,
+  const uint8_t* seeds,
+  uint8_t* result,
+  std::size_t numThreads,
+  int blockSize,
+  const GraphCutsPhaseCallback& onPhase = nullptr
+);
+
+/**
+ * @brief Binary graph cuts segmentation with image weights, seeds, and results accessed through
+ * callbacks. This is the generic (and much slower) version of the function above.
+ */
 bool graphCutsBinarySegmentation(
   const GraphNeighborhoodType& hoodType,
   double terminalCapacity,
@@ -20,15 +119,25 @@ bool graphCutsBinarySegmentation(
   std::function<void(int x, int y, int z, LabelType value)> setResultSegValue
 );
 
+/**
+ * @brief Multi-label graph cuts segmentation by alpha expansion, with image weights and results
+ * accessed through callbacks. The segmentation has the dimensions of the seeds, whose labels are
+ * the labels of the result.
+ *
+ * @param[in] seeds Sparse seeds. Unseeded voxels cost the terminal capacity for all labels.
+ * @param[in] onPhase Optional function called as the segmentation enters each phase
+ *
+ * @return True iff the segmentation succeeded and was not stopped by \c onPhase
+ */
 bool graphCutsMultiLabelSegmentation(
   const GraphNeighborhoodType& hoodType,
   double terminalCapacity,
-  const glm::ivec3& dims,
   const VoxelDistances& voxelDistances,
   std::function<double(int x, int y, int z, int dx, int dy, int dz)> getImageWeight,
   std::function<double(int index1, int index2)> getImageWeight1D,
-  std::function<LabelType(int x, int y, int z)> getSeedValue,
-  std::function<void(int x, int y, int z, LabelType value)> setResultSegValue
+  const SparseSeeds& seeds,
+  std::function<void(int x, int y, int z, LabelType value)> setResultSegValue,
+  const GraphCutsPhaseCallback& onPhase = nullptr
 );
 
 #endif // GRAPHCUTS_H
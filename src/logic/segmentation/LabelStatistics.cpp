@@ -0,0 +1,473 @@
+#include "logic/segmentation/LabelStatistics.h"
+
+#include "common/ParallelFor.h"
+#include "image/ComponentDispatch.h"
+#include "image/Image.h"
+
+#include <glm/glm.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+/// Minimum number of voxels scanned by a thread
+constexpr std::size_t sk_minVoxelsPerChunk = std::size_t{1} << 18;
+
+constexpr uint32_t sk_segComp = 0;
+
+using LabelMap = std::map<LabelType, LabelStatistics::Stats>;
+
+/// Add the voxels [xBegin, xEnd) of row (y, z) to the statistics of a label
+void addRun(LabelStatistics::Stats& s, int xBegin, int xEnd, int y, int z)
+{
+  const glm::ivec3 first{xBegin, y, z};
+  const glm::ivec3 last{xEnd - 1, y, z};
+
+  if (0 == s.m_numVoxels)
+  {
+    s.m_boxMin = first;
+    s.m_boxMax = last;
+  }
+  else
+  {
+    s.m_boxMin = glm::min(s.m_boxMin, first);
+    s.m_boxMax = glm::max(s.m_boxMax, last);
+  }
+
+  // The x coordinates of the run sum to n * (xBegin + xEnd - 1) / 2
+  const int64_t n = xEnd - xBegin;
+  s.m_coordSum += glm::i64vec3{n * (xBegin + xEnd - 1) / 2, n * y, n * z};
+  s.m_numVoxels += static_cast<std::size_t>(n);
+}
+
+/// Merge the statistics of a label into other statistics of the label
+void merge(LabelStatistics::Stats& a, const LabelStatistics::Stats& b)
+{
+  if (0 == a.m_numVoxels)
+  {
+    a = b;
+    return;
+  }
+
+  a.m_numVoxels += b.m_numVoxels;
+  a.m_coordSum += b.m_coordSum;
+  a.m_boxMin = glm::min(a.m_boxMin, b.m_boxMin);
+  a.m_boxMax = glm::max(a.m_boxMax, b.m_boxMax);
+  a.m_intensitySum.merge(b.m_intensitySum);
+  a.m_intensitySumSq.merge(b.m_intensitySumSq);
+}
+
+/// Accumulate the statistics of the labels of slices [zBegin, zEnd) of a segmentation, with
+/// intensities of an image buffer, if it is not null. Rows are scanned in runs of equal labels.
+template<typename S, typename I>
+void accumulateSlices(
+  const S* seg,
+  const I* image,
+  std::size_t imageStride,
+  const glm::ivec3& dims,
+  int zBegin,
+  int zEnd,
+  LabelMap& labels
+)
+{
+  for (int z = zBegin; z < zEnd; ++z)
+  {
+    for (int y = 0; y < dims.y; ++y)
+    {
+      const std::size_t rowStart = (static_cast<std::size_t>(z) * dims.y + y) * dims.x;
+      const S* row = seg + rowStart;
+
+      for (int x = 0; x < dims.x;)
+      {
+        const S value = row[x];
+
+        if (0 == value)
+        {
+          ++x;
+          continue;
+        }
+
+        const int start = x;
+
+        while (x < dims.x && value == row[x])
+        {
+          ++x;
+        }
+
+        LabelStatistics::Stats& s = labels[static_cast<LabelType>(value)];
+        addRun(s, start, x, y, z);
+
+        if (image)
+        {
+          for (int i = start; i < x; ++i)
+          {
+            const double v = static_cast<double>(image[(rowStart + i) * imageStride]);
+            s.m_intensitySum.add(v);
+            s.m_intensitySumSq.add(v * v);
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+void LabelStatistics::CompensatedSum::add(double value)
+{
+  const double sum = m_sum + value;
+
+  // Recover the low-order bits of the smaller addend that were lost in the rounded sum
+  if (std::abs(m_sum) >= std::abs(value))
+  {
+    m_compensation += (m_sum - sum) + value;
+  }
+  else
+  {
+    m_compensation += (value - sum) + m_sum;
+  }
+
+  m_sum = sum;
+}
+
+void LabelStatistics::CompensatedSum::merge(const CompensatedSum& other)
+{
+  add(other.m_sum);
+  m_compensation += other.m_compensation;
+}
+
+double LabelStatistics::CompensatedSum::value() const
+{
+  return m_sum + m_compensation;
+}
+
+glm::dvec3 LabelStatistics::Stats::centroid() const
+{
+  return (0 < m_numVoxels) ? glm::dvec3{m_coordSum} / static_cast<double>(m_numVoxels)
+                           : glm::dvec3{0.0};
+}
+
+double LabelStatistics::Stats::meanIntensity() const
+{
+  return (0 < m_numVoxels) ? m_intensitySum.value() / static_cast<double>(m_numVoxels) : 0.0;
+}
+
+double LabelStatistics::Stats::stdDevIntensity() const
+{
+  if (0 == m_numVoxels)
+  {
+    return 0.0;
+  }
+
+  const double mean = meanIntensity();
+  const double variance
+    = m_intensitySumSq.value() / static_cast<double>(m_numVoxels) - mean * mean;
+  return std::sqrt(std::max(variance, 0.0));
+}
+
+LabelStatistics::LabelStatistics(const glm::ivec3& dims, double voxelVolume, bool hasIntensity)
+  : m_dims(dims)
+  , m_voxelVolume(voxelVolume)
+  , m_hasIntensity(hasIntensity)
+{
+}
+
+std::optional<LabelStatistics> LabelStatistics::compute(
+  const Image& seg, const Image* image, uint32_t component
+)
+{
+  const glm::ivec3 dims{seg.header().pixelDimensions()};
+  const glm::vec3 spacing = seg.header().spacing();
+
+  const bool useImage = image && glm::ivec3{image->header().pixelDimensions()} == dims
+                        && component < image->header().numComponentsPerPixel();
+
+  const double voxelVolume = static_cast<double>(spacing.x) * spacing.y * spacing.z;
+  LabelStatistics stats(dims, voxelVolume, useImage);
+
+  const ComponentBuffer imageBuffer = useImage ? componentBuffer(*image, component)
+                                               : ComponentBuffer{};
+  const std::size_t imageStride = imageBuffer.m_stride;
+
+  // Slabs of slices are scanned concurrently into their own statistics, which are then merged
+  const std::size_t numSlices = static_cast<std::size_t>(dims.z);
+  const std::size_t sliceSize = std::max(std::size_t{1}, static_cast<std::size_t>(dims.x) * dims.y);
+  const std::size_t minSlices = std::max(std::size_t{1}, sk_minVoxelsPerChunk / sliceSize);
+
+  std::vector<LabelMap> slabLabels(parallel::numChunks(numSlices, minSlices));
+
+  auto scan = [&](const auto* segData, const auto* imageData)
+  {
+    parallel::forEachChunk(
+      numSlices,
+      minSlices,
+      [&](std::size_t chunk, std::size_t zBegin, std::size_t zEnd)
+      {
+        accumulateSlices(
+          segData,
+          imageData,
+          imageStride,
+          dims,
+          static_cast<int>(zBegin),
+          static_cast<int>(zEnd),
+          slabLabels[chunk]
+        );
+      }
+    );
+  };
+
+  const bool valid = dispatchSegComponentType(
+    seg.header().memoryComponentType(),
+    [&](auto* segTypeTag)
+    {
+      using S = std::remove_pointer_t<decltype(segTypeTag)>;
+      const S* segData = static_cast<const S*>(seg.bufferAsVoid(sk_segComp));
+
+      bool scannedImage = false;
+
+      if (useImage)
+      {
+        scannedImage = dispatchImageComponentType(
+          image->header().memoryComponentType(),
+          [&](auto* imageTypeTag)
+          {
+            using I = std::remove_pointer_t<decltype(imageTypeTag)>;
+            scan(segData, static_cast<const I*>(imageBuffer.m_data));
+          }
+        );
+      }
+
+      if (!scannedImage)
+      {
+        stats.m_hasIntensity = false;
+        scan(segData, static_cast<const float*>(nullptr));
+      }
+    }
+  );
+
+  if (!valid)
+  {
+    spdlog::error(
+      "Unable to compute label statistics of segmentation with invalid component type {}",
+      componentTypeString(seg.header().memoryComponentType())
+    );
+    return std::nullopt;
+  }
+
+  for (const LabelMap& labels : slabLabels)
+  {
+    for (const auto& [label, s] : labels)
+    {
+      merge(stats.m_labels[label], s);
+    }
+  }
+
+  spdlog::debug("Computed statistics of {} segmentation labels", stats.m_labels.size());
+  return stats;
+}
+
+const std::map<LabelType, LabelStatistics::Stats>& LabelStatistics::labels() const
+{
+  return m_labels;
+}
+
+const LabelStatistics::Stats* LabelStatistics::label(LabelType label) const
+{
+  const auto it = m_labels.find(label);
+  return (std::end(m_labels) != it) ? &it->second : nullptr;
+}
+
+bool LabelStatistics::hasIntensity() const
+{
+  return m_hasIntensity;
+}
+
+double LabelStatistics::voxelVolume() const
+{
+  return m_voxelVolume;
+}
+
+uint64_t LabelStatistics::dataVersion() const
+{
+  return m_dataVersion;
+}
+
+void LabelStatistics::setDataVersion(uint64_t version)
+{
+  m_dataVersion = version;
+}
+
+bool LabelStatistics::moveVoxels(
+  const std::vector<SegEditHistory::VoxelChange>& changes, const Image* image, uint32_t component
+)
+{
+  if (!m_hasIntensity)
+  {
+    for (const SegEditHistory::VoxelChange& v : changes)
+    {
+      moveVoxel(v.m_index, v.m_before, v.m_after, 0.0);
+    }
+
+    return true;
+  }
+
+  if (!image || glm::ivec3{image->header().pixelDimensions()} != m_dims
+      || component >= image->header().numComponentsPerPixel())
+  {
+    return false;
+  }
+
+  // Intensities are read from the typed component buffer, with one dispatch for all voxels
+  const ComponentBuffer buffer = componentBuffer(*image, component);
+
+  return dispatchImageComponentType(
+    image->header().memoryComponentType(),
+    [this, &changes, &buffer](auto* typeTag)
+    {
+      using I = std::remove_pointer_t<decltype(typeTag)>;
+      const I* data = static_cast<const I*>(buffer.m_data);
+
+      for (const SegEditHistory::VoxelChange& v : changes)
+      {
+        const double intensity = static_cast<double>(data[v.m_index * buffer.m_stride]);
+        moveVoxel(v.m_index, v.m_before, v.m_after, intensity);
+      }
+    }
+  );
+}
+
+void LabelStatistics::moveVoxel(
+  std::size_t index, LabelType before, LabelType after, double intensity
+)
+{
+  if (before == after)
+  {
+    return;
+  }
+
+  const std::size_t sliceSize = static_cast<std::size_t>(m_dims.x) * m_dims.y;
+  const glm::ivec3 voxel{
+    static_cast<int>(index % m_dims.x),
+    static_cast<int>((index / m_dims.x) % m_dims.y),
+    static_cast<int>(index / sliceSize)
+  };
+
+  if (0 != before)
+  {
+    if (auto it = m_labels.find(before); std::end(m_labels) != it)
+    {
+      Stats& s = it->second;
+
+      if (1 == s.m_numVoxels)
+      {
+        if (!s.m_boxIsExact)
+        {
+          --m_numInexactBoxes;
+        }
+
+        m_labels.erase(it);
+      }
+      else
+      {
+        --s.m_numVoxels;
+        s.m_coordSum -= glm::i64vec3{voxel};
+
+        if (m_hasIntensity)
+        {
+          s.m_intensitySum.add(-intensity);
+          s.m_intensitySumSq.add(-intensity * intensity);
+        }
+
+        // Removing a voxel from the boundary of the box may shrink the box
+        const bool onBoundary = glm::any(glm::equal(voxel, s.m_boxMin))
+                                || glm::any(glm::equal(voxel, s.m_boxMax));
+
+        if (s.m_boxIsExact && onBoundary)
+        {
+          s.m_boxIsExact = false;
+          ++m_numInexactBoxes;
+        }
+      }
+    }
+  }
+
+  if (0 != after)
+  {
+    Stats& s = m_labels[after];
+    addRun(s, voxel.x, voxel.x + 1, voxel.y, voxel.z);
+
+    if (m_hasIntensity)
+    {
+      s.m_intensitySum.add(intensity);
+      s.m_intensitySumSq.add(intensity * intensity);
+    }
+  }
+}
+
+bool LabelStatistics::hasInexactBoundingBoxes() const
+{
+  return (0 < m_numInexactBoxes);
+}
+
+void LabelStatistics::refreshBoundingBoxes(const Image& seg)
+{
+  if (0 == m_numInexactBoxes)
+  {
+    return;
+  }
+
+  if (glm::ivec3{seg.header().pixelDimensions()} != m_dims)
+  {
+    spdlog::error("Unable to refresh label bounding boxes of segmentation with other dimensions");
+    return;
+  }
+
+  dispatchSegComponentType(
+    seg.header().memoryComponentType(),
+    [this, &seg](auto* typeTag)
+    {
+      using S = std::remove_pointer_t<decltype(typeTag)>;
+      const S* data = static_cast<const S*>(seg.bufferAsVoid(sk_segComp));
+
+      for (auto& [label, s] : m_labels)
+      {
+        if (s.m_boxIsExact)
+        {
+          continue;
+        }
+
+        glm::ivec3 boxMin{std::numeric_limits<int>::max()};
+        glm::ivec3 boxMax{std::numeric_limits<int>::lowest()};
+
+        for (int z = s.m_boxMin.z; z <= s.m_boxMax.z; ++z)
+        {
+          for (int y = s.m_boxMin.y; y <= s.m_boxMax.y; ++y)
+          {
+            const S* row = data + (static_cast<std::size_t>(z) * m_dims.y + y) * m_dims.x;
+
+            for (int x = s.m_boxMin.x; x <= s.m_boxMax.x; ++x)
+            {
+              if (label == static_cast<LabelType>(row[x]))
+              {
+                boxMin = glm::min(boxMin, glm::ivec3{x, y, z});
+                boxMax = glm::max(boxMax, glm::ivec3{x, y, z});
+              }
+            }
+          }
+        }
+
+        s.m_boxMin = boxMin;
+        s.m_boxMax = boxMax;
+        s.m_boxIsExact = true;
+      }
+    }
+  );
+
+  m_numInexactBoxes = 0;
+}
@@ -0,0 +1,133 @@
+#ifndef LABEL_STATISTICS_H
+#define LABEL_STATISTICS_H
+
+#include "common/SegmentationTypes.h"
+#include "logic/segmentation/SegEditHistory.h"
+
+#include <glm/fwd.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+class Image;
+
+/**
+ * @brief Statistics of the labels of a segmentation: voxel counts, volumes, centroids, bounding
+ * boxes, and moments of the intensity of an image component within each label.
+ *
+ * The statistics are computed in one parallel pass over the segmentation. They are then updated
+ * from the voxels that change in each edit, so that listing the labels, reporting their volumes,
+ * and finding their centroids does not scan the segmentation. The background (0) label is not
+ * counted.
+ *
+ * Removing voxels from the boundary of the bounding box of a label can shrink the box. The box is
+ * then marked as inexact and is recomputed by \c refreshBoundingBoxes within its prior extent.
+ *
+ * Coordinates are summed as integers and intensities as compensated sums, so that statistics
+ * updated by many edits match those computed from scratch.
+ */
+class LabelStatistics
+{
+public:
+  /// Sum of floating-point values that compensates for the rounding errors of its additions
+  /// (Neumaier summation)
+  class CompensatedSum
+  {
+  public:
+    void add(double value);
+    void merge(const CompensatedSum& other);
+    double value() const;
+
+  private:
+    double m_sum = 0.0;          //!< Rounded sum
+    double m_compensation = 0.0; //!< Sum of the rounding errors of m_sum
+  };
+
+  /// Statistics of one label
+  struct Stats
+  {
+    std::size_t m_numVoxels = 0;     //!< Number of voxels
+    glm::i64vec3 m_coordSum{0};      //!< Sum of the voxel coordinates
+    glm::ivec3 m_boxMin{0};          //!< Minimum corner of the bounding box, in voxels
+    glm::ivec3 m_boxMax{0};          //!< Maximum corner of the bounding box (inclusive)
+    bool m_boxIsExact = true;        //!< False if the box may be larger than the label
+    CompensatedSum m_intensitySum;   //!< Sum of the image intensities
+    CompensatedSum m_intensitySumSq; //!< Sum of the squared image intensities
+
+    /// Centroid, in voxel coordinates
+    glm::dvec3 centroid() const;
+
+    double meanIntensity() const;
+    double stdDevIntensity() const;
+  };
+
+  /**
+   * @brief Compute the statistics of a segmentation
+   *
+   * @param[in] seg Segmentation, with UInt8, UInt16, or UInt32 components
+   * @param[in] image Image whose intensities are accumulated. It is ignored if null or if its
+   * dimensions differ from those of the segmentation.
+   * @param[in] component Image component whose intensities are accumulated
+   *
+   * @return Statistics, or none if the segmentation has an invalid component type
+   */
+  static std::optional<LabelStatistics> compute(
+    const Image& seg, const Image* image, uint32_t component
+  );
+
+  /// Statistics of all non-zero labels with at least one voxel, ordered by label
+  const std::map<LabelType, Stats>& labels() const;
+
+  /// Statistics of a label, or null if it has no voxels
+  const Stats* label(LabelType label) const;
+
+  /// Were image intensities accumulated?
+  bool hasIntensity() const;
+
+  /// Volume of a voxel, in physical units (mm^3)
+  double voxelVolume() const;
+
+  /// Data version of the segmentation that the statistics describe
+  uint64_t dataVersion() const;
+  void setDataVersion(uint64_t version);
+
+  /**
+   * @brief Move changed voxels from their labels before the change to their labels after it
+   *
+   * @param[in] changes Changed voxels
+   * @param[in] image Image whose intensities were accumulated, which is ignored if there are none
+   * @param[in] component Image component whose intensities were accumulated
+   *
+   * @return False iff intensities were accumulated and the image is null or has other dimensions,
+   * in which case the statistics are unchanged
+   */
+  bool moveVoxels(
+    const std::vector<SegEditHistory::VoxelChange>& changes, const Image* image, uint32_t component
+  );
+
+  /// Does a label have an inexact bounding box?
+  bool hasInexactBoundingBoxes() const;
+
+  /// Recompute the inexact bounding boxes by scanning the segmentation within them
+  void refreshBoundingBoxes(const Image& seg);
+
+private:
+  LabelStatistics(const glm::ivec3& dims, double voxelVolume, bool hasIntensity);
+
+  /// Move a voxel from one label to another. The intensity is ignored if there is no image.
+  void moveVoxel(std::size_t index, LabelType before, LabelType after, double intensity);
+
+  std::map<LabelType, Stats> m_labels;
+
+  glm::ivec3 m_dims{0};              //!< Segmentation dimensions
+  double m_voxelVolume = 0.0;        //!< Voxel volume (mm^3)
+  bool m_hasIntensity = false;       //!< Were image intensities accumulated?
+  uint64_t m_dataVersion = 0;        //!< Segmentation data version
+  std::size_t m_numInexactBoxes = 0; //!< Number of labels with inexact bounding boxes
+};
+
+#endif // LABEL_STATISTICS_H
@@ -0,0 +1,1130 @@
+#include "logic/segmentation/Morphology.h"
+
+#include "common/ParallelFor.h"
+#include "image/ComponentDispatch.h"
+#include "image/Image.h"
+#include "logic/segmentation/LabelStatistics.h"
+
+#include <glm/glm.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+/// Minimum number of voxels processed by a thread
+constexpr std::size_t sk_minVoxelsPerChunk = std::size_t{1} << 16;
+
+constexpr uint32_t sk_segComp = 0;
+
+/// Squared distance of the voxels of a line that has no sites
+constexpr float sk_infDistance = std::numeric_limits<float>::max();
+
+/// Binary mask of the voxels of a box, packed as 64 voxels per word along x. The bits of the
+/// last word of each row that are past the end of the row are always zero.
+struct BitMask
+{
+  explicit BitMask(const glm::ivec3& dims)
+    : m_dims(dims)
+    , m_wordsPerRow((dims.x + 63) / 64)
+    , m_lastWordMask(
+        (0 == dims.x % 64) ? ~uint64_t{0} : ((uint64_t{1} << (dims.x % 64)) - 1)
+      )
+    , m_words(static_cast<std::size_t>(m_wordsPerRow) * dims.y * dims.z, 0u)
+  {
+  }
+
+  uint64_t* row(int y, int z)
+  {
+    return m_words.data() + (static_cast<std::size_t>(z) * m_dims.y + y) * m_wordsPerRow;
+  }
+
+  const uint64_t* row(int y, int z) const
+  {
+    return m_words.data() + (static_cast<std::size_t>(z) * m_dims.y + y) * m_wordsPerRow;
+  }
+
+  std::size_t sliceSize() const
+  {
+    return static_cast<std::size_t>(m_dims.x) * m_dims.y;
+  }
+
+  glm::ivec3 m_dims;
+  int m_wordsPerRow;
+  uint64_t m_lastWordMask; //!< Bits of the last word of a row that are inside of the row
+  std::vector<uint64_t> m_words;
+};
+
+bool testBit(const uint64_t* row, int x)
+{
+  return 0 != ((row[x >> 6] >> (x & 63)) & uint64_t{1});
+}
+
+void setBit(uint64_t* row, int x)
+{
+  row[x >> 6] |= (uint64_t{1} << (x & 63));
+}
+
+/// Shift the bits of a row, such that bit i of dst is bit (i + k) of src, or zero if that bit
+/// is outside of the row
+void shiftRow(const uint64_t* src, uint64_t* dst, int numWords, int k)
+{
+  const int q = std::abs(k) / 64;
+  const int b = std::abs(k) % 64;
+
+  for (int w = 0; w < numWords; ++w)
+  {
+    uint64_t v = 0;
+
+    if (k >= 0)
+    {
+      const int s = w + q;
+      if (s < numWords)
+        v = src[s] >> b;
+      if (b > 0 && s + 1 < numWords)
+        v |= src[s + 1] << (64 - b);
+    }
+    else
+    {
+      const int s = w - q;
+      if (s >= 0)
+        v = src[s] << b;
+      if (b > 0 && s >= 1)
+        v |= src[s - 1] >> (64 - b);
+    }
+
+    dst[w] = v;
+  }
+}
+
+/// Invert the mask
+void complement(BitMask& mask)
+{
+  parallel::forEachSlab(
+    mask.m_dims.z,
+    mask.sliceSize(),
+    sk_minVoxelsPerChunk,
+    [&mask](std::size_t, int zBegin, int zEnd)
+    {
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < mask.m_dims.y; ++y)
+        {
+          uint64_t* row = mask.row(y, z);
+
+          for (int w = 0; w < mask.m_wordsPerRow; ++w)
+          {
+            row[w] = ~row[w];
+          }
+
+          row[mask.m_wordsPerRow - 1] &= mask.m_lastWordMask;
+        }
+      }
+    }
+  );
+}
+
+/**
+ * @brief OR each bit of a row with the following bits (if direction is 1) or the preceding bits
+ * (if direction is -1) in a window. Each doubling step ORs every bit with the bit at the current
+ * window size, so that the window takes O(log windowSize) steps.
+ *
+ * @param[in] row Bits of the row
+ * @param[out] out Bits of the dilated row
+ * @param[in] tmp Scratch buffer of the size of the row
+ * @param[in] lastWordMask Bits of the last word of the row that are inside of the row
+ */
+void dilateRowInDirection(
+  const uint64_t* row,
+  uint64_t* out,
+  uint64_t* tmp,
+  int numWords,
+  uint64_t lastWordMask,
+  int windowSize,
+  int direction
+)
+{
+  auto orShifted = [&](int k)
+  {
+    shiftRow(out, tmp, numWords, k);
+
+    for (int w = 0; w < numWords; ++w)
+    {
+      out[w] |= tmp[w];
+    }
+
+    out[numWords - 1] &= lastWordMask;
+  };
+
+  std::copy_n(row, numWords, out);
+
+  // Bit i of out becomes the OR of the len bits of the row that start at bit i
+  int len = 1;
+
+  while (2 * len <= windowSize)
+  {
+    orShifted(direction * len);
+    len *= 2;
+  }
+
+  // Two overlapping windows cover the window of each bit
+  orShifted(direction * (windowSize - len));
+}
+
+/**
+ * @brief OR each element of a sequence with its neighbors within a radius. The elements are
+ * blocks of words at a stride. Each doubling step ORs every element with the element at the
+ * current window size, so that windows of 2 * radius + 1 elements take O(log radius) steps.
+ *
+ * @param[in,out] data First word of the first element
+ * @param[in] tmp Scratch buffer
+ */
+void dilateSequence(
+  uint64_t* data, std::size_t stride, int n, int numWords, int radius, std::vector<uint64_t>& tmp
+)
+{
+  const int windowSize = 2 * radius + 1;
+  const int m = n + 2 * radius;
+  const std::size_t w = static_cast<std::size_t>(numWords);
+
+  // Element i of tmp is element (i - radius) of the sequence, with zeros before and after it
+  tmp.assign(static_cast<std::size_t>(m) * w, 0u);
+
+  for (int e = 0; e < n; ++e)
+  {
+    std::copy_n(data + e * stride, w, tmp.data() + (e + radius) * w);
+  }
+
+  // Element i of tmp becomes the OR of its elements [i, i + len)
+  int len = 1;
+
+  while (2 * len <= windowSize)
+  {
+    for (int e = 0; e + len < m; ++e)
+    {
+      uint64_t* a = tmp.data() + e * w;
+      const uint64_t* b = tmp.data() + (e + len) * w;
+
+      for (std::size_t i = 0; i < w; ++i)
+      {
+        a[i] |= b[i];
+      }
+    }
+
+    len *= 2;
+  }
+
+  // Two overlapping windows of tmp cover the window of each element
+  const int rest = windowSize - len;
+
+  for (int e = 0; e < n; ++e)
+  {
+    const uint64_t* a = tmp.data() + e * w;
+    const uint64_t* b = tmp.data() + (e + rest) * w;
+    uint64_t* out = data + e * stride;
+
+    for (std::size_t i = 0; i < w; ++i)
+    {
+      out[i] = a[i] | b[i];
+    }
+  }
+}
+
+/// Dilate a mask with a box of a radius in voxels, by separable passes along x, y, and z
+void dilateBox(BitMask& mask, const glm::ivec3& radius)
+{
+  const glm::ivec3& dims = mask.m_dims;
+  const int numWords = mask.m_wordsPerRow;
+
+  if (radius.x > 0)
+  {
+    // The row is dilated forward and backward by windows of the radius plus one bit
+    parallel::forEachSlab(
+      dims.z,
+      mask.sliceSize(),
+      sk_minVoxelsPerChunk,
+      [&](std::size_t, int zBegin, int zEnd)
+      {
+        std::vector<uint64_t> forward(static_cast<std::size_t>(numWords));
+        std::vector<uint64_t> backward(static_cast<std::size_t>(numWords));
+        std::vector<uint64_t> tmp(static_cast<std::size_t>(numWords));
+
+        for (int z = zBegin; z < zEnd; ++z)
+        {
+          for (int y = 0; y < dims.y; ++y)
+          {
+            uint64_t* row = mask.row(y, z);
+
+            if (std::all_of(row, row + numWords, [](uint64_t w) { return 0 == w; }))
+            {
+              continue;
+            }
+
+            dilateRowInDirection(
+              row, forward.data(), tmp.data(), numWords, mask.m_lastWordMask, radius.x + 1, 1
+            );
+            dilateRowInDirection(
+              row, backward.data(), tmp.data(), numWords, mask.m_lastWordMask, radius.x + 1, -1
+            );
+
+            for (int w = 0; w < numWords; ++w)
+            {
+              row[w] = forward[w] | backward[w];
+            }
+          }
+        }
+      }
+    );
+  }
+
+  if (radius.y > 0)
+  {
+    parallel::forEachSlab(
+      dims.z,
+      mask.sliceSize(),
+      sk_minVoxelsPerChunk,
+      [&](std::size_t, int zBegin, int zEnd)
+      {
+        std::vector<uint64_t> tmp;
+
+        for (int z = zBegin; z < zEnd; ++z)
+        {
+          dilateSequence(mask.row(0, z), numWords, dims.y, numWords, radius.y, tmp);
+        }
+      }
+    );
+  }
+
+  if (radius.z > 0)
+  {
+    const std::size_t sliceWords = static_cast<std::size_t>(numWords) * dims.y;
+
+    parallel::forEachSlab(
+      dims.y,
+      static_cast<std::size_t>(dims.x) * dims.z,
+      sk_minVoxelsPerChunk,
+      [&](std::size_t, int yBegin, int yEnd)
+      {
+        std::vector<uint64_t> tmp;
+
+        for (int y = yBegin; y < yEnd; ++y)
+        {
+          dilateSequence(mask.row(y, 0), sliceWords, dims.z, numWords, radius.z, tmp);
+        }
+      }
+    );
+  }
+}
+
+/// Erode a mask with a box of a radius in voxels. Voxels outside of the mask box are set.
+void erodeBox(BitMask& mask, const glm::ivec3& radius)
+{
+  complement(mask);
+  dilateBox(mask, radius);
+  complement(mask);
+}
+
+/**
+ * @brief Compute the squared distances from the voxels of a line to the nearest site, given the
+ * squared distances of the line samples to their sites (Felzenszwalb and Huttenlocher's lower
+ * envelope of parabolas). Samples with infinite distance are not sites.
+ *
+ * @param[in] f Squared distances of the samples
+ * @param[out] d Squared distances of the voxels
+ * @param[in] n Number of voxels
+ * @param[in] spacing Voxel spacing along the line
+ * @param v, z Scratch buffers of n and n + 1 elements
+ */
+void distanceTransform1d(const float* f, float* d, int n, double spacing, int* v, double* z)
+{
+  auto position = [spacing](int q) { return q * spacing; };
+
+  int k = -1; // Index of the rightmost parabola of the envelope
+
+  for (int q = 0; q < n; ++q)
+  {
+    if (f[q] >= sk_infDistance)
+    {
+      continue;
+    }
+
+    const double fq = f[q] + position(q) * position(q);
+    double s = -std::numeric_limits<double>::infinity();
+
+    while (k >= 0)
+    {
+      const int p = v[k];
+      const double fp = f[p] + position(p) * position(p);
+
+      // Intersection of the parabolas of q and p
+      s = (fq - fp) / (2.0 * (position(q) - position(p)));
+
+      if (s > z[k])
+      {
+        break;
+      }
+
+      --k;
+    }
+
+    if (k < 0)
+    {
+      s = -std::numeric_limits<double>::infinity();
+    }
+
+    ++k;
+    v[k] = q;
+    z[k] = s;
+  }
+
+  if (k < 0)
+  {
+    std::fill(d, d + n, sk_infDistance);
+    return;
+  }
+
+  z[k + 1] = std::numeric_limits<double>::infinity();
+
+  int j = 0;
+
+  for (int q = 0; q < n; ++q)
+  {
+    while (z[j + 1] < position(q))
+    {
+      ++j;
+    }
+
+    const double dq = position(q) - position(v[j]);
+    d[q] = static_cast<float>(dq * dq + f[v[j]]);
+  }
+}
+
+/// Compute the squared Euclidean distances (mm^2) from each voxel of the box of a mask to the
+/// nearest set voxel, by passes along x, y, and z. Distances greater than a maximum are set to
+/// infinity, since they cannot become smaller in later passes.
+std::vector<float> squaredDistanceMap(
+  const BitMask& sites, const glm::vec3& spacing, float maxSquaredDistance
+)
+{
+  const glm::ivec3& dims = sites.m_dims;
+  const std::size_t rowSize = static_cast<std::size_t>(dims.x);
+  const std::size_t sliceSize = sites.sliceSize();
+
+  std::vector<float> dist(sliceSize * dims.z);
+
+  auto clamp = [maxSquaredDistance](double d)
+  { return (d <= maxSquaredDistance) ? static_cast<float>(d) : sk_infDistance; };
+
+  // Along x, the distance to the nearest site of the row is found by a forward and a backward scan
+  parallel::forEachSlab(
+    dims.z,
+    sliceSize,
+    sk_minVoxelsPerChunk,
+    [&](std::size_t, int zBegin, int zEnd)
+    {
+      const double sx = spacing.x;
+
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < dims.y; ++y)
+        {
+          const uint64_t* row = sites.row(y, z);
+          float* d = dist.data() + z * sliceSize + y * rowSize;
+
+          if (std::all_of(row, row + sites.m_wordsPerRow, [](uint64_t w) { return 0 == w; }))
+          {
+            std::fill(d, d + dims.x, sk_infDistance);
+            continue;
+          }
+
+          int site = -1;
+
+          for (int x = 0; x < dims.x; ++x)
+          {
+            if (testBit(row, x))
+            {
+              site = x;
+            }
+
+            const double dx = (x - site) * sx;
+            d[x] = (site < 0) ? sk_infDistance : clamp(dx * dx);
+          }
+
+          site = -1;
+
+          for (int x = dims.x - 1; x >= 0; --x)
+          {
+            if (testBit(row, x))
+            {
+              site = x;
+            }
+
+            if (site >= 0)
+            {
+              const double dx = (site - x) * sx;
+              d[x] = std::min(d[x], clamp(dx * dx));
+            }
+          }
+        }
+      }
+    }
+  );
+
+  // Along y and z, blocks of adjacent columns are gathered together, so that each row of the
+  // block is read from one cache line. Columns without finite distances are left unchanged.
+  constexpr int sk_blockSize = 16;
+
+  auto transformColumns = [&](int numColumns, int n, double s, float* start, std::size_t stride)
+  {
+    const std::size_t blockSize = static_cast<std::size_t>(sk_blockSize);
+
+    std::vector<float> block(blockSize * n);
+    std::vector<float> f(static_cast<std::size_t>(n));
+    std::vector<float> d(static_cast<std::size_t>(n));
+    std::vector<int> v(static_cast<std::size_t>(n));
+    std::vector<double> z(static_cast<std::size_t>(n) + 1);
+
+    for (int c0 = 0; c0 < numColumns; c0 += sk_blockSize)
+    {
+      const int width = std::min(sk_blockSize, numColumns - c0);
+
+      for (int i = 0; i < n; ++i)
+      {
+        const float* src = start + i * stride + c0;
+        std::copy(src, src + width, block.data() + i * blockSize);
+      }
+
+      bool changed = false;
+
+      for (int c = 0; c < width; ++c)
+      {
+        bool hasSite = false;
+
+        for (int i = 0; i < n; ++i)
+        {
+          f[i] = block[i * blockSize + c];
+          hasSite |= (f[i] < sk_infDistance);
+        }
+
+        if (!hasSite)
+        {
+          continue;
+        }
+
+        distanceTransform1d(f.data(), d.data(), n, s, v.data(), z.data());
+
+        for (int i = 0; i < n; ++i)
+        {
+          block[i * blockSize + c] = clamp(d[i]);
+        }
+
+        changed = true;
+      }
+
+      if (!changed)
+      {
+        continue;
+      }
+
+      for (int i = 0; i < n; ++i)
+      {
+        const float* src = block.data() + i * blockSize;
+        std::copy(src, src + width, start + i * stride + c0);
+      }
+    }
+  };
+
+  if (dims.y > 1)
+  {
+    parallel::forEachSlab(
+      dims.z,
+      sliceSize,
+      sk_minVoxelsPerChunk,
+      [&](std::size_t, int zBegin, int zEnd)
+      {
+        for (int z = zBegin; z < zEnd; ++z)
+        {
+          transformColumns(dims.x, dims.y, spacing.y, dist.data() + z * sliceSize, rowSize);
+        }
+      }
+    );
+  }
+
+  if (dims.z > 1)
+  {
+    parallel::forEachSlab(
+      dims.y,
+      rowSize * dims.z,
+      sk_minVoxelsPerChunk,
+      [&](std::size_t, int yBegin, int yEnd)
+      {
+        for (int y = yBegin; y < yEnd; ++y)
+        {
+          transformColumns(dims.x, dims.z, spacing.z, dist.data() + y * rowSize, sliceSize);
+        }
+      }
+    );
+  }
+
+  return dist;
+}
+
+/// Set the voxels of a mask whose squared distance is at most a threshold (if inside is true)
+/// or greater than it (if inside is false)
+void thresholdDistances(BitMask& mask, const std::vector<float>& dist, float threshold, bool inside)
+{
+  const glm::ivec3& dims = mask.m_dims;
+  const std::size_t sliceSize = mask.sliceSize();
+
+  parallel::forEachSlab(
+    dims.z,
+    sliceSize,
+    sk_minVoxelsPerChunk,
+    [&](std::size_t, int zBegin, int zEnd)
+    {
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < dims.y; ++y)
+        {
+          uint64_t* row = mask.row(y, z);
+          const float* d = dist.data() + z * sliceSize + static_cast<std::size_t>(y) * dims.x;
+
+          std::fill(row, row + mask.m_wordsPerRow, 0u);
+
+          for (int x = 0; x < dims.x; ++x)
+          {
+            if ((d[x] <= threshold) == inside)
+            {
+              setBit(row, x);
+            }
+          }
+        }
+      }
+    }
+  );
+}
+
+/// Squared radius (mm^2) of a ball, with a tolerance for voxels whose centers are on its boundary
+float squaredBallRadius(double radius)
+{
+  return static_cast<float>(radius * radius * (1.0 + 1.0e-6));
+}
+
+/// Dilate a mask with a ball of a radius (mm)
+void dilateBall(BitMask& mask, const glm::vec3& spacing, double radius)
+{
+  const float threshold = squaredBallRadius(radius);
+  const std::vector<float> dist = squaredDistanceMap(mask, spacing, threshold);
+  thresholdDistances(mask, dist, threshold, true);
+}
+
+/// Erode a mask with a ball of a radius (mm). Voxels outside of the mask box are set.
+void erodeBall(BitMask& mask, const glm::vec3& spacing, double radius)
+{
+  // Voxels farther than the radius from all unset voxels stay set
+  complement(mask);
+  const float threshold = squaredBallRadius(radius);
+  const std::vector<float> dist = squaredDistanceMap(mask, spacing, threshold);
+  thresholdDistances(mask, dist, threshold, false);
+}
+
+/// Set the unset voxels of a mask that are not connected by faces to the boundary of its box
+void fillHoles(BitMask& mask)
+{
+  struct Span
+  {
+    int m_y;
+    int m_z;
+    int m_xBegin;
+    int m_xEnd;
+  };
+
+  const glm::ivec3& dims = mask.m_dims;
+
+  BitMask exterior(dims);
+  std::vector<Span> stack;
+
+  auto isOpen = [&](const uint64_t* maskRow, const uint64_t* extRow, int x)
+  { return !testBit(maskRow, x) && !testBit(extRow, x); };
+
+  // Add the span of exterior voxels that contains the open voxel x of row (y, z)
+  // @return One past the last voxel of the span
+  auto addSpan = [&](int x, int y, int z)
+  {
+    const uint64_t* maskRow = mask.row(y, z);
+    uint64_t* extRow = exterior.row(y, z);
+
+    int xBegin = x;
+    int xEnd = x + 1;
+
+    while (xBegin > 0 && isOpen(maskRow, extRow, xBegin - 1))
+    {
+      --xBegin;
+    }
+
+    while (xEnd < dims.x && isOpen(maskRow, extRow, xEnd))
+    {
+      ++xEnd;
+    }
+
+    for (int i = xBegin; i < xEnd; ++i)
+    {
+      setBit(extRow, i);
+    }
+
+    stack.push_back({y, z, xBegin, xEnd});
+    return xEnd;
+  };
+
+  // Scan the voxels [xBegin, xEnd) of row (y, z) for open voxels
+  auto scanRow = [&](int y, int z, int xBegin, int xEnd)
+  {
+    const uint64_t* maskRow = mask.row(y, z);
+    const uint64_t* extRow = exterior.row(y, z);
+
+    for (int x = xBegin; x < xEnd; ++x)
+    {
+      if (isOpen(maskRow, extRow, x))
+      {
+        x = addSpan(x, y, z);
+      }
+    }
+  };
+
+  auto fillStack = [&]()
+  {
+    static constexpr std::array<std::pair<int, int>, 4> sk_rowOffsets{
+      {{-1, 0}, {1, 0}, {0, -1}, {0, 1}}
+    };
+
+    while (!stack.empty())
+    {
+      const Span s = stack.back();
+      stack.pop_back();
+
+      for (const auto& [dy, dz] : sk_rowOffsets)
+      {
+        const int y = s.m_y + dy;
+        const int z = s.m_z + dz;
+
+        if (0 <= y && y < dims.y && 0 <= z && z < dims.z)
+        {
+          scanRow(y, z, s.m_xBegin, s.m_xEnd);
+        }
+      }
+    }
+  };
+
+  // The exterior grows from the open voxels on the faces of the box
+  for (int z = 0; z < dims.z; ++z)
+  {
+    for (int y = 0; y < dims.y; ++y)
+    {
+      if (0 == y || dims.y - 1 == y || 0 == z || dims.z - 1 == z)
+      {
+        scanRow(y, z, 0, dims.x);
+      }
+      else
+      {
+        scanRow(y, z, 0, 1);
+        scanRow(y, z, dims.x - 1, dims.x);
+      }
+
+      fillStack();
+    }
+  }
+
+  // Set all voxels that are not exterior
+  for (std::size_t i = 0; i < mask.m_words.size(); ++i)
+  {
+    mask.m_words[i] |= ~exterior.m_words[i];
+  }
+
+  for (int z = 0; z < dims.z; ++z)
+  {
+    for (int y = 0; y < dims.y; ++y)
+    {
+      mask.row(y, z)[mask.m_wordsPerRow - 1] &= mask.m_lastWordMask;
+    }
+  }
+}
+
+/// Apply a morphological operation to a mask
+void applyOperation(
+  BitMask& mask, const MorphologyParams& params, const glm::vec3& spacing, const glm::ivec3& radius
+)
+{
+  const bool ball = (MorphologyElement::Ball == params.element);
+
+  auto dilate = [&]()
+  {
+    if (ball)
+      dilateBall(mask, spacing, params.radius);
+    else
+      dilateBox(mask, radius);
+  };
+
+  auto erode = [&]()
+  {
+    if (ball)
+      erodeBall(mask, spacing, params.radius);
+    else
+      erodeBox(mask, radius);
+  };
+
+  switch (params.operation)
+  {
+  case MorphologyOperation::Dilate:
+  {
+    dilate();
+    break;
+  }
+  case MorphologyOperation::Erode:
+  {
+    erode();
+    break;
+  }
+  case MorphologyOperation::Open:
+  {
+    erode();
+    dilate();
+    break;
+  }
+  case MorphologyOperation::Close:
+  {
+    dilate();
+    erode();
+    break;
+  }
+  case MorphologyOperation::FillHoles:
+  {
+    fillHoles(mask);
+    break;
+  }
+  }
+}
+
+/**
+ * @brief Apply a morphological operation to one label of a segmentation, within a box
+ * @param onDone Function called when the operation is done, before the segmentation is written.
+ * It returns false to cancel the operation.
+ * @return Number of voxels that changed, or none if the operation was cancelled
+ */
+template<typename S>
+std::optional<std::size_t> applyToLabel(
+  Image& seg,
+  LabelType label,
+  const glm::ivec3& boxMin,
+  const glm::ivec3& boxMax,
+  const MorphologyParams& params,
+  const glm::ivec3& voxelRadius,
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock,
+  const std::function<bool(void)>& onDone
+)
+{
+  const glm::ivec3 segDims{seg.header().pixelDimensions()};
+  const glm::vec3 spacing = seg.header().spacing();
+  const glm::ivec3 boxSize = boxMax - boxMin + 1;
+  const S segLabel = static_cast<S>(label);
+
+  // Index of the first voxel of row (y, z) of the box in the segmentation
+  auto segRow = [&](int y, int z)
+  {
+    const std::size_t segY = static_cast<std::size_t>(boxMin.y + y);
+    const std::size_t segZ = static_cast<std::size_t>(boxMin.z + z);
+    return (segZ * segDims.y + segY) * segDims.x + static_cast<std::size_t>(boxMin.x);
+  };
+
+  // Read the segmentation as const, so that its data version only changes if voxels change
+  const Image& constSeg = seg;
+  const S* segData = static_cast<const S*>(constSeg.bufferAsVoid(sk_segComp));
+
+  BitMask mask(boxSize);
+
+  parallel::forEachSlab(
+    boxSize.z,
+    mask.sliceSize(),
+    sk_minVoxelsPerChunk,
+    [&](std::size_t, int zBegin, int zEnd)
+    {
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < boxSize.y; ++y)
+        {
+          const S* in = segData + segRow(y, z);
+          uint64_t* row = mask.row(y, z);
+
+          for (int x = 0; x < boxSize.x; ++x)
+          {
+            if (segLabel == in[x])
+            {
+              setBit(row, x);
+            }
+          }
+        }
+      }
+    }
+  );
+
+  BitMask result = mask;
+  applyOperation(result, params, spacing, voxelRadius);
+
+  if (!onDone())
+  {
+    return std::nullopt;
+  }
+
+  // Voxels added to the label must be background, and voxels removed from it become background
+  auto changes = [&segLabel](bool before, bool after, S value)
+  { return (after && !before && 0 == value) || (!after && before && segLabel == value); };
+
+  // Range [first, last + 1) of the changed voxels of each row of the box, which is found before
+  // the segmentation is written, so that unchanged segmentations are not saved or versioned
+  std::vector<std::pair<int, int> > rowChanges(
+    static_cast<std::size_t>(boxSize.y) * boxSize.z, {0, 0}
+  );
+  std::vector<std::size_t> slabCounts(static_cast<std::size_t>(boxSize.z), 0);
+
+  parallel::forEachSlab(
+    boxSize.z,
+    mask.sliceSize(),
+    sk_minVoxelsPerChunk,
+    [&](std::size_t, int zBegin, int zEnd)
+    {
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < boxSize.y; ++y)
+        {
+          const uint64_t* before = mask.row(y, z);
+          const uint64_t* after = result.row(y, z);
+
+          if (std::equal(before, before + mask.m_wordsPerRow, after))
+          {
+            continue;
+          }
+
+          const S* in = segData + segRow(y, z);
+          std::pair<int, int>& range = rowChanges[static_cast<std::size_t>(z) * boxSize.y + y];
+          range = {boxSize.x, 0};
+
+          for (int x = 0; x < boxSize.x; ++x)
+          {
+            if (changes(testBit(before, x), testBit(after, x), in[x]))
+            {
+              range.first = std::min(range.first, x);
+              range.second = x + 1;
+              ++slabCounts[z];
+            }
+          }
+        }
+      }
+    }
+  );
+
+  std::size_t numChanged = 0;
+
+  for (std::size_t count : slabCounts)
+  {
+    numChanged += count;
+  }
+
+  if (0 == numChanged)
+  {
+    return 0;
+  }
+
+  if (saveSegBlock)
+  {
+    saveSegBlock(glm::uvec3{boxMin}, glm::uvec3{boxSize});
+  }
+
+  S* outData = static_cast<S*>(seg.bufferAsVoid(sk_segComp));
+
+  parallel::forEachSlab(
+    boxSize.z,
+    mask.sliceSize(),
+    sk_minVoxelsPerChunk,
+    [&](std::size_t, int zBegin, int zEnd)
+    {
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < boxSize.y; ++y)
+        {
+          const auto [xBegin, xEnd] = rowChanges[static_cast<std::size_t>(z) * boxSize.y + y];
+          const uint64_t* before = mask.row(y, z);
+          const uint64_t* after = result.row(y, z);
+          S* out = outData + segRow(y, z);
+
+          for (int x = xBegin; x < xEnd; ++x)
+          {
+            const bool isAfter = testBit(after, x);
+
+            if (changes(testBit(before, x), isAfter, out[x]))
+            {
+              out[x] = isAfter ? segLabel : S{0};
+            }
+          }
+        }
+      }
+    }
+  );
+
+  DirtyBrickMap& dirtyBricks = seg.dirtyBricks();
+
+  for (int z = 0; z < boxSize.z; ++z)
+  {
+    for (int y = 0; y < boxSize.y; ++y)
+    {
+      const auto [xBegin, xEnd] = rowChanges[static_cast<std::size_t>(z) * boxSize.y + y];
+
+      if (xBegin < xEnd)
+      {
+        dirtyBricks.markRow(
+          static_cast<uint32_t>(boxMin.y + y),
+          static_cast<uint32_t>(boxMin.z + z),
+          static_cast<uint32_t>(boxMin.x + xBegin),
+          static_cast<uint32_t>(boxMin.x + xEnd)
+        );
+      }
+    }
+  }
+
+  return numChanged;
+}
+
+} // namespace
+
+std::optional<std::size_t> applySegMorphology(
+  Image& seg,
+  const MorphologyParams& params,
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock,
+  const std::function<bool(float fraction)>& onProgress
+)
+{
+  if (params.label && *params.label <= 0)
+  {
+    spdlog::error("Unable to apply morphology to the background label");
+    return std::nullopt;
+  }
+
+  // The labels and their bounding boxes are found in one pass over the segmentation
+  const auto stats = LabelStatistics::compute(seg, nullptr, 0);
+  if (!stats)
+  {
+    spdlog::error(
+      "Unable to apply morphology to segmentation with invalid component type {}",
+      componentTypeString(seg.header().memoryComponentType())
+    );
+    return std::nullopt;
+  }
+
+  const glm::ivec3 segDims{seg.header().pixelDimensions()};
+  const glm::vec3 spacing = seg.header().spacing();
+
+  // Radius of the structuring element along each axis, in voxels. A ball spans the voxels
+  // within its radius, and a box spans the voxels whose centers are within its radius.
+  glm::ivec3 voxelRadius{0};
+
+  for (int i = 0; i < 3; ++i)
+  {
+    static constexpr double sk_eps = 1.0e-6;
+    const double r = std::max(params.radius, 0.0) / static_cast<double>(spacing[i]);
+
+    voxelRadius[i] = static_cast<int>(
+      (MorphologyElement::Ball == params.element) ? std::ceil(r - sk_eps) : std::floor(r + sk_eps)
+    );
+    voxelRadius[i] = std::min(voxelRadius[i], segDims[i]);
+  }
+
+  const bool isFillHoles = (MorphologyOperation::FillHoles == params.operation);
+
+  if (!isFillHoles && glm::all(glm::equal(voxelRadius, glm::ivec3{0})))
+  {
+    return 0; // The element only spans its center voxel
+  }
+
+  // Padding of the bounding box of a label, such that the box holds the result of the operation
+  // and the voxels past its boundary are not in the result
+  const bool grows = (MorphologyOperation::Dilate == params.operation
+                      || MorphologyOperation::Close == params.operation);
+  const glm::ivec3 padding = grows ? voxelRadius + 1 : glm::ivec3{1};
+
+  struct LabelBox
+  {
+    LabelType m_label;
+    glm::ivec3 m_min;
+    glm::ivec3 m_max;
+    std::size_t m_numVoxels;
+  };
+
+  std::vector<LabelBox> labelBoxes;
+  std::size_t numBoxVoxels = 0;
+
+  for (const auto& [label, labelStats] : stats->labels())
+  {
+    if (params.label && label != *params.label)
+    {
+      continue;
+    }
+
+    const glm::ivec3 boxMin = glm::max(labelStats.m_boxMin - padding, glm::ivec3{0});
+    const glm::ivec3 boxMax = glm::min(labelStats.m_boxMax + padding, segDims - 1);
+    const glm::ivec3 boxSize = boxMax - boxMin + 1;
+    const std::size_t boxVoxels = static_cast<std::size_t>(boxSize.x) * boxSize.y * boxSize.z;
+
+    labelBoxes.push_back({label, boxMin, boxMax, boxVoxels});
+    numBoxVoxels += boxVoxels;
+  }
+
+  // Progress is the fraction of the voxels of the label boxes that are done
+  auto setProgress = [&onProgress, numBoxVoxels](std::size_t numDoneVoxels)
+  {
+    return !onProgress
+           || onProgress(static_cast<float>(numDoneVoxels) / static_cast<float>(numBoxVoxels));
+  };
+
+  std::size_t numChanged = 0;
+  std::size_t numDoneVoxels = 0;
+
+  for (const LabelBox& box : labelBoxes)
+  {
+    if (!setProgress(numDoneVoxels))
+    {
+      return std::nullopt;
+    }
+
+    // Writing the segmentation is a small part of the work on a label
+    const std::size_t numOperationVoxels = numDoneVoxels + box.m_numVoxels * 9 / 10;
+    auto onDone = [&setProgress, numOperationVoxels]() { return setProgress(numOperationVoxels); };
+
+    std::optional<std::size_t> numLabelChanged;
+
+    dispatchSegComponentType(
+      seg.header().memoryComponentType(),
+      [&](auto* typeTag)
+      {
+        using S = std::remove_pointer_t<decltype(typeTag)>;
+        numLabelChanged = applyToLabel<S>(
+          seg, box.m_label, box.m_min, box.m_max, params, voxelRadius, saveSegBlock, onDone
+        );
+      }
+    );
+
+    if (!numLabelChanged)
+    {
+      return std::nullopt;
+    }
+
+    numChanged += *numLabelChanged;
+    numDoneVoxels += box.m_numVoxels;
+  }
+
+  return numChanged;
+}
@@ -0,0 +1,54 @@
+#ifndef SEG_MORPHOLOGY_H
+#define SEG_MORPHOLOGY_H
+
+#include "common/SegmentationTypes.h"
+
+#include <glm/fwd.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+
+class Image;
+
+/**
+ * @brief Apply a morphological operation (dilation, erosion, opening, closing, or hole filling)
+ * to a label of a segmentation or to each of its non-zero labels in turn.
+ *
+ * The binary mask of a label is built over the bounding box of the label, padded by the radius
+ * of the structuring element, and packed as bits along x.
+ * - Box elements are applied by separable passes along x, y, and z that OR each word of the mask
+ *   with its shifted neighbors. Windows are doubled in size at each step, so a pass costs
+ *   O(log radius) word operations per word.
+ * - Ball elements are applied by thresholding the exact Euclidean distance transform of the mask,
+ *   in physical units, whose cost does not depend on the radius.
+ *
+ * All passes run concurrently over slabs of the mask. Voxels outside of the segmentation are
+ * treated as part of the label when eroding, so labels do not erode from the image boundary.
+ *
+ * Voxels added to a label only replace background (0) voxels, so labels do not overwrite each
+ * other. Voxels removed from a label become background. When all labels are processed, lower
+ * labels are processed first and so take precedence in voxels claimed by several labels.
+ *
+ * @param seg Segmentation, with UInt8, UInt16, or UInt32 components
+ * @param params Operation, structuring element, radius, and label
+ * @param saveSegBlock Function called with each block of voxels to change, before they change.
+ * It may be empty.
+ * @param onProgress Function called with the fraction of the operation that is done, before each
+ * label is processed and before its voxels are written. It returns false to cancel the operation.
+ * It may be empty.
+ *
+ * @return Number of voxels that changed, or none if the segmentation has an invalid component
+ * type, the label is background, or the operation was cancelled. When it is cancelled, the labels
+ * that were already written stay changed.
+ *
+ * @note The bricks of changed voxels are marked as dirty in the segmentation.
+ */
+std::optional<std::size_t> applySegMorphology(
+  Image& seg,
+  const MorphologyParams& params,
+  const std::function<void(const glm::uvec3& offset, const glm::uvec3& size)>& saveSegBlock,
+  const std::function<bool(float fraction)>& onProgress = nullptr
+);
+
+#endif // SEG_MORPHOLOGY_H
@@ -1,43 +1,709 @@
 #include "logic/segmentation/Poisson.h"
 
+#include "common/ParallelFor.h"
+
 #include <glm/glm.hpp>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
-#include <limits>
+#include <numeric>
+#include <optional>
 
 namespace
 {
 
-// Normalize image to rage [0.0, 1.0].
-//void normalize( const float* image, float* imageNorm, std::size_t N )
-//{
-//    float maxVal = std::numeric_limits<float>::lowest();
-//    float minVal = std::numeric_limits<float>::max();
-
-//    for ( std::size_t i = 0; i < N; ++i )
-//    {
-//        const float val = image[i];
-
-//        if ( val > maxVal )
-//        {
-//            maxVal = val;
-//        }
-
-//        if ( val < minVal )
-//        {
-//            minVal = val;
-//        }
-//    }
-
-//    for ( std::size_t i = 0; i < N; ++i )
-//    {
-//        imageNorm[i] = ( image[i] - minVal ) / ( maxVal - minVal );
-//    }
-//}
+// Minimum number of voxels processed by a thread
+static constexpr std::size_t sk_minChunkSize = (std::size_t{1} << 15);
+
+// Levels of the multigrid hierarchy are coarsened until they have at most this many nodes
+static constexpr std::size_t sk_maxCoarsestLevelSize = 512;
+static constexpr std::size_t sk_maxNumLevels = 16;
+
+// Number of Gauss-Seidel sweeps before and after each coarse-level correction
+static constexpr uint32_t sk_numPreSmoothingSweeps = 2;
+static constexpr uint32_t sk_numPostSmoothingSweeps = 2;
+
+// The coarsest level is relaxed until its residual drops by this factor
+static constexpr uint32_t sk_maxCoarsestLevelSweeps = 200;
+static constexpr float sk_coarsestLevelTolerance = 1.0e-3f;
+
+/// Outcome of the solver of a potential
+enum class SolverStatus
+{
+  Converged,     //!< The residual fell below its target
+  Stalled,       //!< The residual stopped decreasing above its target
+  MaxIterations, //!< The maximum number of cycles or iterations was reached above the target
+  Stopped        //!< The solver was stopped by the progress callback
+};
+
+/// Result of the solver of a potential
+struct SolverResult
+{
+  SolverStatus m_status;    //!< Status
+  uint32_t m_numIterations; //!< Number of multigrid cycles or SOR iterations run
+  float m_targetResidual;   //!< Residual below which the solver converges
+};
+
+/**
+ * @brief Linear system on one level of the multigrid hierarchy: for each free node n,
+ * diag[n] * u[n] - sum_m w(n, m) * u[m] = b[n], where m ranges over the face neighbors of n.
+ * Fixed nodes hold their values.
+ *
+ * The finest level is the Poisson system itself, with nodes fixed at the seeds and b = 0.
+ * Each coarser level is the Galerkin projection (P^T A P) of the level above it, where P
+ * interpolates piecewise-constant values from the coarse nodes to their 2x2x2 blocks of free
+ * fine nodes. The projection keeps the coarse systems symmetric and diagonally dominant,
+ * so V-cycles converge regardless of how the seeds are placed.
+ */
+struct GridLevel
+{
+  glm::ivec3 m_dims{0};
+  std::size_t m_numNodes = 0;
+
+  std::array<const float*, 3> m_forward{nullptr, nullptr, nullptr}; //!< Forward edge weights
+  const float* m_diag = nullptr;                                    //!< Diagonal of the system
+  const uint8_t* m_fixed = nullptr;                                 //!< Non-zero at fixed nodes
+
+  // Storage of the level. The finest level references the edge weights and seeds.
+  std::array<std::vector<float>, 3> m_forwardStorage;
+  std::vector<float> m_diagStorage;
+  std::vector<uint8_t> m_fixedStorage;
+};
+
+/// Number of nodes of each slice of a grid
+std::size_t numNodesPerSlice(const glm::ivec3& dims)
+{
+  return static_cast<std::size_t>(dims.x) * static_cast<std::size_t>(dims.y);
+}
+
+std::size_t numSlabs(const glm::ivec3& dims, std::size_t numThreads)
+{
+  return parallel::numSlabs(dims.z, numNodesPerSlice(dims), sk_minChunkSize, numThreads);
+}
+
+/// Run fn(zBegin, zEnd) concurrently over slabs of the slices of a grid and return the maximum
+/// of its results
+template<class Fn>
+float maxOverSlabs(const glm::ivec3& dims, std::size_t numThreads, Fn&& fn)
+{
+  std::vector<float> maxima(numSlabs(dims, numThreads), 0.0f);
+
+  parallel::forEachSlab(
+    dims.z,
+    numNodesPerSlice(dims),
+    sk_minChunkSize,
+    [&fn, &maxima](std::size_t slab, int zBegin, int zEnd) { maxima[slab] = fn(zBegin, zEnd); },
+    numThreads
+  );
+
+  return *std::max_element(std::begin(maxima), std::end(maxima));
+}
+
+/// Residual b[n] - (A u)[n] at node n = (x, y, z)
+inline float residual(
+  const GridLevel& L, const float* u, const float* b, int x, int y, int z, std::size_t n
+)
+{
+  const std::size_t yDelta = static_cast<std::size_t>(L.m_dims.x);
+  const std::size_t zDelta = yDelta * static_cast<std::size_t>(L.m_dims.y);
+
+  float r = (b ? b[n] : 0.0f) - L.m_diag[n] * u[n];
+
+  if (x > 0)
+  {
+    r += L.m_forward[0][n - 1] * u[n - 1];
+  }
+  if (x < L.m_dims.x - 1)
+  {
+    r += L.m_forward[0][n] * u[n + 1];
+  }
+  if (y > 0)
+  {
+    r += L.m_forward[1][n - yDelta] * u[n - yDelta];
+  }
+  if (y < L.m_dims.y - 1)
+  {
+    r += L.m_forward[1][n] * u[n + yDelta];
+  }
+  if (z > 0)
+  {
+    r += L.m_forward[2][n - zDelta] * u[n - zDelta];
+  }
+  if (z < L.m_dims.z - 1)
+  {
+    r += L.m_forward[2][n] * u[n + zDelta];
+  }
+
+  return r;
+}
+
+/**
+ * @brief Over-relaxed Gauss-Seidel update of the free nodes of one color (parity of x + y + z).
+ * Nodes only neighbor nodes of the other color, so slabs of slices are updated concurrently.
+ * @return Maximum absolute scaled residual of the nodes before their update
+ */
+float relax(
+  const GridLevel& L, float* u, const float* b, int color, float omega, std::size_t numThreads
+)
+{
+  return maxOverSlabs(
+    L.m_dims,
+    numThreads,
+    [&](int zBegin, int zEnd)
+    {
+      float maxResid = 0.0f;
+
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < L.m_dims.y; ++y)
+        {
+          const int x0 = (color + y + z) & 1;
+          std::size_t n = (static_cast<std::size_t>(z) * L.m_dims.y + y) * L.m_dims.x + x0;
+
+          for (int x = x0; x < L.m_dims.x; x += 2, n += 2)
+          {
+            if (0 != L.m_fixed[n] || L.m_diag[n] <= 0.0f)
+            {
+              continue;
+            }
+
+            const float r = residual(L, u, b, x, y, z, n);
+            const float delta = r / L.m_diag[n];
+            u[n] += omega * delta;
+            maxResid = std::max(maxResid, std::fabs(delta));
+          }
+        }
+      }
+
+      return maxResid;
+    }
+  );
+}
+
+/**
+ * @brief Maximum absolute scaled residual r[n] / diag[n] of the free nodes. This is the change
+ * of the node value by a Jacobi update, so unlike the residual itself, it does not shrink with
+ * the weights of the node's edges.
+ */
+float residualNorm(const GridLevel& L, const float* u, const float* b, std::size_t numThreads)
+{
+  return maxOverSlabs(
+    L.m_dims,
+    numThreads,
+    [&](int zBegin, int zEnd)
+    {
+      float maxResid = 0.0f;
+      std::size_t n = static_cast<std::size_t>(zBegin) * L.m_dims.x * L.m_dims.y;
+
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < L.m_dims.y; ++y)
+        {
+          for (int x = 0; x < L.m_dims.x; ++x, ++n)
+          {
+            if (0 == L.m_fixed[n] && L.m_diag[n] > 0.0f)
+            {
+              const float r = residual(L, u, b, x, y, z, n);
+              maxResid = std::max(maxResid, std::fabs(r / L.m_diag[n]));
+            }
+          }
+        }
+      }
+
+      return maxResid;
+    }
+  );
+}
+
+/// Index of the coarse node whose block contains fine node (x, y, z)
+inline std::size_t parentIndex(const glm::ivec3& coarseDims, int x, int y, int z)
+{
+  return (static_cast<std::size_t>(z / 2) * coarseDims.y + static_cast<std::size_t>(y / 2))
+           * coarseDims.x
+         + static_cast<std::size_t>(x / 2);
+}
+
+/// Visit the fine nodes (x, y, z, n) in the blocks of coarse slices [zBegin, zEnd)
+template<class Fn>
+void forEachFineNodeOfSlab(const glm::ivec3& fineDims, int zBegin, int zEnd, Fn&& fn)
+{
+  for (int z = 2 * zBegin; z < std::min(2 * zEnd, fineDims.z); ++z)
+  {
+    std::size_t n = static_cast<std::size_t>(z) * fineDims.x * fineDims.y;
+
+    for (int y = 0; y < fineDims.y; ++y)
+    {
+      for (int x = 0; x < fineDims.x; ++x, ++n)
+      {
+        fn(x, y, z, n);
+      }
+    }
+  }
+}
+
+/// Compute the Galerkin projection of a level onto the next coarser level
+GridLevel coarsen(const GridLevel& F, std::size_t numThreads)
+{
+  GridLevel C;
+  C.m_dims = (F.m_dims + 1) / 2;
+  C.m_numNodes = static_cast<std::size_t>(C.m_dims.x) * C.m_dims.y * C.m_dims.z;
+
+  for (int a = 0; a < 3; ++a)
+  {
+    C.m_forwardStorage[a].assign(C.m_numNodes, 0.0f);
+    C.m_forward[a] = C.m_forwardStorage[a].data();
+  }
+
+  C.m_diagStorage.assign(C.m_numNodes, 0.0f);
+  C.m_diag = C.m_diagStorage.data();
+
+  C.m_fixedStorage.assign(C.m_numNodes, 1u);
+  C.m_fixed = C.m_fixedStorage.data();
+
+  const std::array<std::size_t, 3> deltas{
+    1, static_cast<std::size_t>(F.m_dims.x), static_cast<std::size_t>(F.m_dims.x) * F.m_dims.y
+  };
+
+  // Each thread writes the coarse nodes of its own slab
+  parallel::forEachSlab(
+    C.m_dims.z,
+    numNodesPerSlice(C.m_dims),
+    sk_minChunkSize,
+    [&](std::size_t, int zBegin, int zEnd)
+    {
+      forEachFineNodeOfSlab(
+        F.m_dims,
+        zBegin,
+        zEnd,
+        [&](int x, int y, int z, std::size_t n)
+        {
+          if (0 != F.m_fixed[n])
+          {
+            return;
+          }
+
+          const std::size_t c = parentIndex(C.m_dims, x, y, z);
+          const glm::ivec3 p{x, y, z};
+
+          // Edges between free nodes of the same block cancel in the projection
+          float diag = F.m_diag[n];
+
+          for (int a = 0; a < 3; ++a)
+          {
+            if (p[a] < F.m_dims[a] - 1 && 0 == F.m_fixed[n + deltas[a]])
+            {
+              const float w = F.m_forward[a][n];
+
+              if (0 == p[a] % 2)
+              {
+                diag -= w; // Forward neighbor is in the same block
+              }
+              else
+              {
+                C.m_forwardStorage[a][c] += w;
+              }
+            }
+
+            if (p[a] > 0 && 1 == p[a] % 2 && 0 == F.m_fixed[n - deltas[a]])
+            {
+              diag -= F.m_forward[a][n - deltas[a]]; // Backward neighbor is in the same block
+            }
+          }
+
+          C.m_diagStorage[c] += std::max(diag, 0.0f);
+          C.m_fixedStorage[c] = 0u;
+        }
+      );
+    },
+    numThreads
+  );
+
+  return C;
+}
+
+/// Build the multigrid hierarchy, whose finest level is the Poisson system. Without multigrid,
+/// the hierarchy only has the finest level.
+std::vector<GridLevel> buildLevels(
+  const uint8_t* seeds, const PoissonEdgeWeights& weights, bool multigrid, std::size_t numThreads
+)
+{
+  std::vector<GridLevel> levels;
+  levels.reserve(sk_maxNumLevels);
+
+  GridLevel& F = levels.emplace_back();
+  F.m_dims = weights.m_dims;
+  F.m_numNodes = static_cast<std::size_t>(F.m_dims.x) * F.m_dims.y * F.m_dims.z;
+  F.m_fixed = seeds;
+
+  for (int a = 0; a < 3; ++a)
+  {
+    F.m_forward[a] = weights.m_forward[a].data();
+  }
+
+  // The diagonal of the finest level sums the weights of all edges, including edges to seeds
+  const std::array<std::size_t, 3> deltas{
+    1, static_cast<std::size_t>(F.m_dims.x), static_cast<std::size_t>(F.m_dims.x) * F.m_dims.y
+  };
+
+  F.m_diagStorage.assign(F.m_numNodes, 0.0f);
+  F.m_diag = F.m_diagStorage.data();
+
+  parallel::forEachSlab(
+    F.m_dims.z,
+    numNodesPerSlice(F.m_dims),
+    sk_minChunkSize,
+    [&](std::size_t, int zBegin, int zEnd)
+    {
+      std::size_t n = static_cast<std::size_t>(zBegin) * F.m_dims.x * F.m_dims.y;
+
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < F.m_dims.y; ++y)
+        {
+          for (int x = 0; x < F.m_dims.x; ++x, ++n)
+          {
+            const glm::ivec3 p{x, y, z};
+            float diag = 0.0f;
+
+            for (int a = 0; a < 3; ++a)
+            {
+              diag += F.m_forward[a][n];
+              diag += (p[a] > 0) ? F.m_forward[a][n - deltas[a]] : 0.0f;
+            }
+
+            F.m_diagStorage[n] = diag;
+          }
+        }
+      }
+    },
+    numThreads
+  );
+
+  while (multigrid && levels.size() < sk_maxNumLevels
+         && levels.back().m_numNodes > sk_maxCoarsestLevelSize)
+  {
+    levels.emplace_back(coarsen(levels.back(), numThreads));
+  }
+
+  return levels;
+}
+
+/// Restrict the residual of a level to the right-hand side of the next coarser level
+void restrictResidual(
+  const GridLevel& F,
+  const float* u,
+  const float* b,
+  const GridLevel& C,
+  float* coarseB,
+  std::size_t numThreads
+)
+{
+  parallel::forEachSlab(
+    C.m_dims.z,
+    numNodesPerSlice(C.m_dims),
+    sk_minChunkSize,
+    [&](std::size_t, int zBegin, int zEnd)
+    {
+      const std::size_t sliceSize = static_cast<std::size_t>(C.m_dims.x) * C.m_dims.y;
+      std::fill(coarseB + zBegin * sliceSize, coarseB + zEnd * sliceSize, 0.0f);
+
+      forEachFineNodeOfSlab(
+        F.m_dims,
+        zBegin,
+        zEnd,
+        [&](int x, int y, int z, std::size_t n)
+        {
+          if (0 == F.m_fixed[n])
+          {
+            coarseB[parentIndex(C.m_dims, x, y, z)] += residual(F, u, b, x, y, z, n);
+          }
+        }
+      );
+    },
+    numThreads
+  );
+}
+
+/**
+ * @brief Compute the step length that minimizes the energy of the error of a level after the
+ * correction computed on the next coarser level is added to it. Piecewise-constant interpolation
+ * under-corrects smooth errors, so this step is typically greater than one.
+ *
+ * Since the coarse system is the Galerkin projection of the fine system, the step
+ * (r^T P e) / (e^T P^T A P e) = (b_c^T e) / (e^T A_c e) is computed on the coarse level alone.
+ */
+float correctionStep(const GridLevel& C, const float* e, const float* b, std::size_t numThreads)
+{
+  std::vector<double> be(numSlabs(C.m_dims, numThreads), 0.0);
+  std::vector<double> eAe(be.size(), 0.0);
+
+  parallel::forEachSlab(
+    C.m_dims.z,
+    numNodesPerSlice(C.m_dims),
+    sk_minChunkSize,
+    [&](std::size_t slab, int zBegin, int zEnd)
+    {
+      std::size_t n = static_cast<std::size_t>(zBegin) * C.m_dims.x * C.m_dims.y;
+
+      for (int z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < C.m_dims.y; ++y)
+        {
+          for (int x = 0; x < C.m_dims.x; ++x, ++n)
+          {
+            if (0 == C.m_fixed[n])
+            {
+              // (A e)[n] = b[n] - r[n]
+              be[slab] += static_cast<double>(b[n]) * e[n];
+              eAe[slab] += static_cast<double>(e[n]) * (b[n] - residual(C, e, b, x, y, z, n));
+            }
+          }
+        }
+      }
+
+    },
+    numThreads
+  );
+
+  const double numerator = std::accumulate(std::begin(be), std::end(be), 0.0);
+  const double denominator = std::accumulate(std::begin(eAe), std::end(eAe), 0.0);
+  return (denominator > 0.0 && numerator > 0.0) ? static_cast<float>(numerator / denominator)
+                                                : 1.0f;
+}
+
+/// Add the scaled correction computed on the next coarser level to the free nodes of a level
+void prolongCorrection(
+  const GridLevel& C,
+  const float* coarseU,
+  float step,
+  const GridLevel& F,
+  float* u,
+  std::size_t numThreads
+)
+{
+  parallel::forEachSlab(
+    C.m_dims.z,
+    numNodesPerSlice(C.m_dims),
+    sk_minChunkSize,
+    [&](std::size_t, int zBegin, int zEnd)
+    {
+      forEachFineNodeOfSlab(
+        F.m_dims,
+        zBegin,
+        zEnd,
+        [&](int x, int y, int z, std::size_t n)
+        {
+          if (0 == F.m_fixed[n])
+          {
+            u[n] += step * coarseU[parentIndex(C.m_dims, x, y, z)];
+          }
+        }
+      );
+    },
+    numThreads
+  );
+}
+
+/// Solve level l of the hierarchy with one V-cycle
+void vCycle(
+  const std::vector<GridLevel>& levels,
+  const std::vector<float*>& u,
+  const std::vector<float*>& b,
+  std::size_t l,
+  std::size_t numThreads
+)
+{
+  const GridLevel& L = levels[l];
+
+  if (l + 1 == levels.size())
+  {
+    float initialResid = 0.0f;
+
+    for (uint32_t sweep = 0; sweep < sk_maxCoarsestLevelSweeps; ++sweep)
+    {
+      const float resid = std::max(
+        relax(L, u[l], b[l], 0, 1.0f, numThreads), relax(L, u[l], b[l], 1, 1.0f, numThreads)
+      );
+
+      if (0 == sweep)
+      {
+        initialResid = resid;
+      }
+      else if (resid <= sk_coarsestLevelTolerance * initialResid)
+      {
+        break;
+      }
+    }
+    return;
+  }
+
+  for (uint32_t sweep = 0; sweep < sk_numPreSmoothingSweeps; ++sweep)
+  {
+    relax(L, u[l], b[l], 0, 1.0f, numThreads);
+    relax(L, u[l], b[l], 1, 1.0f, numThreads);
+  }
+
+  const GridLevel& C = levels[l + 1];
+  restrictResidual(L, u[l], b[l], C, b[l + 1], numThreads);
+  std::fill(u[l + 1], u[l + 1] + C.m_numNodes, 0.0f);
+
+  vCycle(levels, u, b, l + 1, numThreads);
+
+  const float step = correctionStep(C, u[l + 1], b[l + 1], numThreads);
+  prolongCorrection(C, u[l + 1], step, L, u[l], numThreads);
+
+  // Sweep the colors in reverse order, so that the cycle is symmetric
+  for (uint32_t sweep = 0; sweep < sk_numPostSmoothingSweeps; ++sweep)
+  {
+    relax(L, u[l], b[l], 1, 1.0f, numThreads);
+    relax(L, u[l], b[l], 0, 1.0f, numThreads);
+  }
+}
+
+/// Solve a potential with multigrid V-cycles
+/// @return Status and number of cycles
+SolverResult solveMultigrid(
+  const std::vector<GridLevel>& levels,
+  float* potential,
+  std::size_t potentialIndex,
+  const PoissonSolverSettings& settings,
+  const PoissonProgressCallback& onProgress,
+  std::size_t numThreads
+)
+{
+  // Corrections and right-hand sides of the coarse levels:
+  std::vector<std::vector<float> > coarseU(levels.size());
+  std::vector<std::vector<float> > coarseB(levels.size());
+
+  std::vector<float*> u(levels.size(), potential);
+  std::vector<float*> b(levels.size(), nullptr);
+
+  for (std::size_t l = 1; l < levels.size(); ++l)
+  {
+    coarseU[l].resize(levels[l].m_numNodes, 0.0f);
+    coarseB[l].resize(levels[l].m_numNodes, 0.0f);
+    u[l] = coarseU[l].data();
+    b[l] = coarseB[l].data();
+  }
+
+  const float initialResid = residualNorm(levels.front(), potential, nullptr, numThreads);
+  float prevResid = initialResid;
+
+  PoissonSolverProgress progress;
+  progress.m_potential = potentialIndex;
+  progress.m_maxIterations = settings.m_maxMultigridCycles;
+  progress.m_initialResidual = initialResid;
+  progress.m_targetResidual = settings.m_relativeTolerance * initialResid;
+
+  for (uint32_t cycle = 1; cycle <= settings.m_maxMultigridCycles; ++cycle)
+  {
+    vCycle(levels, u, b, 0, numThreads);
+
+    const float resid = residualNorm(levels.front(), potential, nullptr, numThreads);
+    spdlog::trace("Cycle {}, residual = {}", cycle, resid);
+
+    if (resid <= progress.m_targetResidual)
+    {
+      return {SolverStatus::Converged, cycle, progress.m_targetResidual};
+    }
+
+    // Every cycle reduces the residual until it reaches the round-off error, so a cycle that
+    // does not reduce it above the target means that the cycles no longer converge
+    if (resid >= prevResid)
+    {
+      return {SolverStatus::Stalled, cycle, progress.m_targetResidual};
+    }
+
+    progress.m_iteration = cycle;
+    progress.m_residual = resid;
+
+    if (onProgress && !onProgress(progress))
+    {
+      return {SolverStatus::Stopped, cycle, progress.m_targetResidual};
+    }
+
+    prevResid = resid;
+  }
+
+  return {SolverStatus::MaxIterations, settings.m_maxMultigridCycles, progress.m_targetResidual};
+}
+
+/**
+ * @brief Solve a potential with red-black successive over-relaxation
+ *
+ * @param targetResidual Residual below which the solver converges. If not set, it is the
+ * relative tolerance of the settings times the residual of the first iteration.
+ * @return Status and number of iterations
+ *
+ * @cite This code is a 3D extension of the algorithm from "Numerical Recipes in C":
+ * "Successive over-relaxation solution of equation (19.5.25) with Chebyshev acceleration"
+ * 'rjac' is input as the spectral radius of the Jacobi iteration, or an estimate of it.
+ */
+SolverResult solveSor(
+  const GridLevel& L,
+  float* potential,
+  std::size_t potentialIndex,
+  const PoissonSolverSettings& settings,
+  const PoissonProgressCallback& onProgress,
+  std::size_t numThreads,
+  std::optional<float> targetResidual = std::nullopt
+)
+{
+  const float rjac = settings.m_rjac;
+  float omega = 1.0f;
+
+  PoissonSolverProgress progress;
+  progress.m_potential = potentialIndex;
+  progress.m_maxIterations = settings.m_maxSorIterations;
+
+  for (uint32_t iter = 0; iter < settings.m_maxSorIterations; ++iter)
+  {
+    float maxResid = 0.0f;
+
+    // Split updates into even and odd stencil passes:
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      maxResid = std::max(maxResid, relax(L, potential, nullptr, pass, omega, numThreads));
+
+      omega = (0 == iter && 0 == pass) ? 1.0f / (1.0f - 0.5f * rjac * rjac)
+                                       : 1.0f / (1.0f - 0.25f * rjac * rjac * omega);
+    }
+
+    if (0 == iter % 100)
+    {
+      spdlog::trace("Iteration {}, residual = {}", iter, maxResid);
+    }
+
+    if (0 == iter)
+    {
+      progress.m_initialResidual = maxResid;
+      progress.m_targetResidual = targetResidual ? *targetResidual
+                                                 : settings.m_relativeTolerance * maxResid;
+    }
+
+    if (maxResid <= progress.m_targetResidual)
+    {
+      return {SolverStatus::Converged, iter + 1, progress.m_targetResidual};
+    }
+
+    progress.m_iteration = iter + 1;
+    progress.m_residual = maxResid;
+
+    if (onProgress && !onProgress(progress))
+    {
+      return {SolverStatus::Stopped, iter + 1, progress.m_targetResidual};
+    }
+  }
+
+  return {SolverStatus::MaxIterations, settings.m_maxSorIterations, progress.m_targetResidual};
+}
 
 } // namespace
 
+
 void initializePotential(
   const uint8_t* seeds, float* potential, const glm::ivec3& dims, LabelType label
 )
@@ -149,141 +815,188 @@ void computeResultSeg(
   }
 }
 
-void sor(
-  const uint8_t* seeds,
-  const float* /*image*/,
-  float* potential,
+PoissonEdgeWeights computeEdgeWeights(
+  const float* image,
   const glm::ivec3& dims,
   const VoxelDistances& distances,
-  float rjac,
-  uint32_t maxits,
-  float /*beta*/
+  float contrast,
+  float beta
 )
 {
-  const std::size_t N = dims.x * dims.y * dims.z;
-
-  std::vector<float> imageNorm(N, 0.0f);
-
-  //    normalize( image, imageNorm.data(), N );
-
-  const float BETA = 1.0f; //computeBeta( imageNorm.data(), dims );
-
-  int n = 0;
-  int isw, jsw, ksw;
+  const std::size_t N = static_cast<std::size_t>(dims.x) * dims.y * dims.z;
 
-  float omega = 1.0f;
-  float val, pot, grad, weight;
-
-  float resid = 0.0f;
-  float total = 0.0f;
-
-  const int zDelta = dims.x * dims.y;
-  const int yDelta = dims.x;
-  const int xDelta = 1;
+  PoissonEdgeWeights weights;
+  weights.m_dims = dims;
 
-  for (uint32_t iter = 0; iter < maxits; ++iter)
+  for (auto& w : weights.m_forward)
   {
-    float absResid = 0.0f;
+    w.assign(N, 0.0f);
+  }
 
-    // Split updates into even and odd stencil passes:
-    ksw = 0;
+  const float scale = (beta > 0.0f) ? contrast / beta : 0.0f;
+  const std::array<float, 3> dists{distances.distX, distances.distY, distances.distZ};
+  const std::array<std::size_t, 3> deltas{
+    1, static_cast<std::size_t>(dims.x), static_cast<std::size_t>(dims.x) * dims.y
+  };
 
-    for (int pass = 0; pass < 2; ++pass)
+  parallel::forEachSlab(
+    dims.z,
+    numNodesPerSlice(dims),
+    sk_minChunkSize,
+    [&](std::size_t, int zBegin, int zEnd)
     {
-      jsw = ksw;
+      std::size_t n = static_cast<std::size_t>(zBegin) * deltas[2];
 
-      for (int k = 0; k < dims.z; ++k)
+      for (int z = zBegin; z < zEnd; ++z)
       {
-        isw = jsw;
-
-        for (int j = 0; j < dims.y; ++j)
+        for (int y = 0; y < dims.y; ++y)
         {
-          for (int i = isw; i < dims.x; i += 2)
+          for (int x = 0; x < dims.x; ++x, ++n)
           {
-            n = k * zDelta + j * yDelta + i;
+            const glm::ivec3 p{x, y, z};
 
-            if (0 != seeds[n])
+            for (int a = 0; a < 3; ++a)
             {
-              // Do not update nodes on boundary
-              continue;
+              if (p[a] < dims[a] - 1)
+              {
+                const float grad = scale * (image[n] - image[n + deltas[a]]);
+                weights.m_forward[a][n] = std::exp(-0.5f * grad * grad) / dists[a];
+              }
             }
+          }
+        }
+      }
+    }
+  );
 
-            val = imageNorm[n];
-            pot = potential[n];
+  return weights;
+}
 
-            resid = 0.0f;
-            total = 0.0f;
+bool solvePotentials(
+  const uint8_t* seeds,
+  const PoissonEdgeWeights& weights,
+  const std::vector<float*>& potentials,
+  const PoissonSolverSettings& settings,
+  const PoissonProgressCallback& onProgress
+)
+{
+  using namespace std::chrono;
 
-            if (k < dims.z - 1)
-            {
-              grad = 0.0f * (val - imageNorm[n + zDelta]) / BETA;
-              weight = std::exp(-0.5f * grad * grad) / distances.distZ;
-              resid += weight * potential[n + zDelta];
-              total -= weight;
-            }
+  const std::size_t numThreads = (0 == settings.m_numThreads) ? parallel::numThreads()
+                                                              : settings.m_numThreads;
 
-            if (k > 0)
-            {
-              grad = 0.0f * (val - imageNorm[n - zDelta]) / BETA;
-              weight = std::exp(-0.5f * grad * grad) / distances.distZ;
-              resid += weight * potential[n - zDelta];
-              total -= weight;
-            }
+  const auto start = steady_clock::now();
 
-            if (j < dims.y - 1)
-            {
-              grad = 0.0f * (val - imageNorm[n + yDelta]) / BETA;
-              weight = std::exp(-0.5f * grad * grad) / distances.distY;
-              resid += weight * potential[n + yDelta];
-              total -= weight;
-            }
+  // The hierarchy only depends on the weights and seeds, so it is shared by all potentials
+  const std::vector<GridLevel> levels
+    = buildLevels(seeds, weights, settings.m_useMultigrid, numThreads);
 
-            if (j > 0)
-            {
-              grad = 0.0f * (val - imageNorm[n - yDelta]) / BETA;
-              weight = std::exp(-0.5f * grad * grad) / distances.distY;
-              resid += weight * potential[n - yDelta];
-              total -= weight;
-            }
+  // Once the solver of one potential is stopped, the solvers of all potentials stop
+  std::atomic<bool> stopped(false);
 
-            if (i < dims.x - 1)
-            {
-              grad = 0.0f * (val - imageNorm[n + xDelta]) / BETA;
-              weight = std::exp(-0.5f * grad * grad) / distances.distX;
-              resid += weight * potential[n + xDelta];
-              total -= weight;
-            }
+  PoissonProgressCallback reportProgress = nullptr;
 
-            if (i > 0)
-            {
-              grad = 0.0f * (val - imageNorm[n - xDelta]) / BETA;
-              weight = std::exp(-0.5f * grad * grad) / distances.distX;
-              resid += weight * potential[n - xDelta];
-              total -= weight;
-            }
+  if (onProgress)
+  {
+    reportProgress = [&onProgress, &stopped](const PoissonSolverProgress& progress)
+    {
+      if (stopped || !onProgress(progress))
+      {
+        stopped = true;
+      }
+      return !stopped;
+    };
+  }
+
+  // Potentials are solved concurrently, with the threads divided among them
+  const std::size_t numConcurrent = parallel::numChunks(potentials.size(), 1, numThreads);
+  const std::size_t threadsPerPotential = std::max(std::size_t{1}, numThreads / numConcurrent);
+
+  parallel::forEachChunk(
+    potentials.size(),
+    1,
+    [&](std::size_t, std::size_t begin, std::size_t end)
+    {
+      for (std::size_t i = begin; i < end && !stopped; ++i)
+      {
+        std::optional<float> sorTargetResidual;
+
+        if (1 < levels.size())
+        {
+          const SolverResult result = solveMultigrid(
+            levels, potentials[i], i, settings, reportProgress, threadsPerPotential
+          );
 
-            resid += total * pot;
-            potential[n] -= omega * resid / total;
-            absResid += std::fabs(resid);
+          if (SolverStatus::Converged == result.m_status)
+          {
+            spdlog::debug(
+              "Solved potential {} with {} multigrid cycles", i, result.m_numIterations
+            );
+            continue;
           }
 
-          isw = 1 - isw;
+          if (SolverStatus::Stopped == result.m_status)
+          {
+            continue;
+          }
+
+          spdlog::warn(
+            "Multigrid solver of potential {} did not converge after {} cycles ({}). "
+            "Falling back to SOR.",
+            i,
+            result.m_numIterations,
+            (SolverStatus::Stalled == result.m_status) ? "residual stalled" : "maximum cycles"
+          );
+
+          // SOR continues from the multigrid potential, towards the target of the multigrid
+          // solver, which is relative to the residual of the initial potential
+          sorTargetResidual = result.m_targetResidual;
         }
 
-        jsw = 1 - jsw;
+        const SolverResult result = solveSor(
+          levels.front(),
+          potentials[i],
+          i,
+          settings,
+          reportProgress,
+          threadsPerPotential,
+          sorTargetResidual
+        );
+
+        if (SolverStatus::Converged == result.m_status)
+        {
+          spdlog::debug("Solved potential {} with {} SOR iterations", i, result.m_numIterations);
+        }
+        else if (SolverStatus::MaxIterations == result.m_status)
+        {
+          spdlog::warn(
+            "SOR solver of potential {} did not converge after {} iterations",
+            i,
+            result.m_numIterations
+          );
+        }
       }
+    },
+    numThreads
+  );
 
-      ksw = 1 - ksw;
+  if (stopped)
+  {
+    spdlog::info(
+      "Stopped solving potentials after {} msec",
+      duration_cast<milliseconds>(steady_clock::now() - start).count()
+    );
+    return false;
+  }
 
-      omega = (0 == iter && 0 == pass) ? 1.0f / (1.0f - 0.5f * rjac * rjac)
-                                       : 1.0f / (1.0f - 0.25f * rjac * rjac * omega);
-    }
+  spdlog::info(
+    "Solved {} potentials on {} grid levels in {} msec",
+    potentials.size(),
+    levels.size(),
+    duration_cast<milliseconds>(steady_clock::now() - start).count()
+  );
 
-    if (0 == iter % 100)
-    {
-      spdlog::trace("Iteration {}, residual = {}", iter, absResid);
-    }
-  }
+  return true;
 }
 
 float computeBeta(const float* image, const glm::ivec3& dims)
@@ -339,9 +1052,3 @@ float computeBeta(const float* image, const glm::ivec3& dims)
 
   return grad / static_cast<float>(dims.x * dims.y * dims.z);
 }
-
-//input initial approximation to  potential (double format)
-//output potential (double format)
-//potential boundary values in (int16_t format)
-//maximum number of SOR iterations
-//(optional): input conductivity image in (double format)
@@ -4,13 +4,65 @@
 #include "common/SegmentationTypes.h"
 
 #include <glm/fwd.hpp>
+#include <glm/vec3.hpp>
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 class Image;
 
+/**
+ * @brief Weights of the edges between each voxel and its 6 face neighbors. The weights only
+ * depend on the image, so they are computed once and shared by the potentials of all labels.
+ */
+struct PoissonEdgeWeights
+{
+  glm::ivec3 m_dims{0}; //!< Image dimensions
+
+  /// For each axis a, weight of the edge between voxel n and its forward neighbor along a.
+  /// The weight is zero for voxels on the last slice along a.
+  std::array<std::vector<float>, 3> m_forward;
+};
+
+/// Settings of the solver for the potentials of Poisson segmentation
+struct PoissonSolverSettings
+{
+  /// Use geometric multigrid V-cycles (true) or successive over-relaxation (false)
+  bool m_useMultigrid = true;
+
+  uint32_t m_maxMultigridCycles = 100; //!< Maximum number of multigrid V-cycles
+  uint32_t m_maxSorIterations = 10000; //!< Maximum number of SOR iterations
+
+  /// Spectral radius of the Jacobi iteration (or an estimate of it), used by SOR
+  float m_rjac = 0.6f;
+
+  /// The solver stops once the maximum absolute residual, scaled by the diagonal of the system,
+  /// falls below this fraction of its initial value. If multigrid cycles stop reducing the
+  /// residual or reach their maximum number before then, the potential is finished with SOR.
+  float m_relativeTolerance = 1.0e-5f;
+
+  /// Number of threads (0 means one per hardware thread)
+  std::size_t m_numThreads = 0;
+};
+
+/// Progress of the solver of one potential
+struct PoissonSolverProgress
+{
+  std::size_t m_potential = 0;    //!< Index of the potential
+  uint32_t m_iteration = 0;       //!< Number of multigrid cycles or SOR iterations done
+  uint32_t m_maxIterations = 0;   //!< Maximum number of multigrid cycles or SOR iterations
+  float m_residual = 0.0f;        //!< Maximum absolute scaled residual
+  float m_initialResidual = 0.0f; //!< Residual of the initial potential
+  float m_targetResidual = 0.0f;  //!< Residual below which the solver converges
+};
+
+/// Function called by the solvers after each multigrid cycle or SOR iteration. It is called
+/// concurrently by the solvers of different potentials. The solvers stop if it returns false.
+using PoissonProgressCallback = std::function<bool(const PoissonSolverProgress& progress)>;
+
 void initializePotential(
   const uint8_t* seeds, float* potential, const glm::ivec3& dims, LabelType label
 );
@@ -24,21 +76,44 @@ void computeBinaryResultSeg(
 );
 
 /**
- * @cite This code is a 3D extension of the algorithm from "Numerical Recipes in C":
- * "Successive over-relaxation solution of equation (19.5.25) with Chebyshev acceleration"
- * 'rjac' is input as the spectral radius of the Jacobi iteration, or an estimate of it.
+ * @brief Compute the edge weights of the graph on which potentials are solved. The weight of
+ * the edge between neighbors n and m is exp(-0.5 * (contrast * (I[n] - I[m]) / beta)^2) / d,
+ * where d is the distance between the voxels.
+ *
+ * @param[in] image Image values
+ * @param[in] dims Image dimensions
+ * @param[in] distances Distances between neighboring voxels
+ * @param[in] contrast Multiplier of image differences (0 makes the weights independent of image)
+ * @param[in] beta Normalization of image differences (see \c computeBeta)
  */
-void sor(
-  const uint8_t* seeds,
+PoissonEdgeWeights computeEdgeWeights(
   const float* image,
-  float* potential,
   const glm::ivec3& dims,
   const VoxelDistances& distances,
-  float rjac,
-  uint32_t maxits,
+  float contrast,
   float beta
 );
 
+/**
+ * @brief Solve for the potentials of several labels, concurrently. Each potential is the
+ * solution of the weighted Laplace equation, with Dirichlet boundary conditions at seed voxels.
+ *
+ * @param[in] seeds Seed segmentation. Voxels with non-zero seeds hold their potential fixed.
+ * @param[in] weights Edge weights
+ * @param[in,out] potentials Potentials, each initialized by \c initializePotential
+ * @param[in] settings Solver settings
+ * @param[in] onProgress Optional function called with the progress of the solvers
+ *
+ * @return False iff the solvers were stopped by \c onProgress before converging
+ */
+bool solvePotentials(
+  const uint8_t* seeds,
+  const PoissonEdgeWeights& weights,
+  const std::vector<float*>& potentials,
+  const PoissonSolverSettings& settings,
+  const PoissonProgressCallback& onProgress = nullptr
+);
+
 // Compute a decent value for the 'beta' parameter used in SOR.
 float computeBeta(const float* image, const glm::ivec3& dims);
 
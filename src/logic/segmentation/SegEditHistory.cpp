@@ -0,0 +1,620 @@
+#include "logic/segmentation/SegEditHistory.h"
+
+#include "image/ComponentDispatch.h"
+#include "image/Image.h"
+
+#include <glm/glm.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace
+{
+
+static constexpr uint32_t sk_comp = 0;
+
+glm::ivec3 numBricks(const glm::ivec3& dims)
+{
+  return (dims + SegEditHistory::sk_brickSize - 1) / SegEditHistory::sk_brickSize;
+}
+
+/// Voxel offset of a brick
+glm::ivec3 brickOffset(const glm::ivec3& dims, uint32_t brick)
+{
+  const glm::ivec3 n = numBricks(dims);
+  const int i = static_cast<int>(brick);
+  return SegEditHistory::sk_brickSize * glm::ivec3{i % n.x, (i / n.x) % n.y, i / (n.x * n.y)};
+}
+
+/// Size of a brick, which is smaller than the full brick size at the image boundary
+glm::ivec3 brickSize(const glm::ivec3& dims, const glm::ivec3& offset)
+{
+  return glm::min(glm::ivec3{SegEditHistory::sk_brickSize}, dims - offset);
+}
+
+std::size_t numVoxels(const glm::ivec3& size)
+{
+  return static_cast<std::size_t>(size.x) * static_cast<std::size_t>(size.y)
+         * static_cast<std::size_t>(size.z);
+}
+
+std::size_t rowStart(const glm::ivec3& dims, int y, int z)
+{
+  return (static_cast<std::size_t>(z) * static_cast<std::size_t>(dims.y)
+          + static_cast<std::size_t>(y))
+         * static_cast<std::size_t>(dims.x);
+}
+
+/// Copy the voxels of a block of the buffer into contiguous values
+template<typename T>
+void copyBlock(
+  const T* buffer, const glm::ivec3& dims, const glm::ivec3& offset, const glm::ivec3& size, T* out
+)
+{
+  for (int z = offset.z; z < offset.z + size.z; ++z)
+  {
+    for (int y = offset.y; y < offset.y + size.y; ++y)
+    {
+      out = std::copy_n(buffer + rowStart(dims, y, z) + offset.x, size.x, out);
+    }
+  }
+}
+
+/// Write contiguous values into the voxels of a block of the buffer
+template<typename T>
+void writeBlock(
+  T* buffer, const glm::ivec3& dims, const glm::ivec3& offset, const glm::ivec3& size, const T* in
+)
+{
+  for (int z = offset.z; z < offset.z + size.z; ++z)
+  {
+    for (int y = offset.y; y < offset.y + size.y; ++y)
+    {
+      std::copy_n(in, size.x, buffer + rowStart(dims, y, z) + offset.x);
+      in += size.x;
+    }
+  }
+}
+
+/// Append the voxels of a brick whose values differ before and after a change. Once there are
+/// too many changed voxels, they are dropped and the changes are marked as incomplete.
+template<typename T>
+void appendVoxelChanges(
+  const glm::ivec3& dims,
+  const glm::ivec3& offset,
+  const glm::ivec3& size,
+  const T* before,
+  const T* after,
+  SegEditHistory::SegChanges& changes
+)
+{
+  if (!changes.m_isComplete)
+  {
+    return;
+  }
+
+  for (int z = 0; z < size.z; ++z)
+  {
+    for (int y = 0; y < size.y; ++y)
+    {
+      const std::size_t row = rowStart(dims, offset.y + y, offset.z + z) + offset.x;
+
+      for (int x = 0; x < size.x; ++x, ++before, ++after)
+      {
+        if (*before != *after)
+        {
+          changes.m_voxels.push_back(
+            {row + x, static_cast<uint32_t>(*before), static_cast<uint32_t>(*after)}
+          );
+        }
+      }
+    }
+  }
+
+  if (SegEditHistory::sk_maxVoxelChanges < changes.m_voxels.size())
+  {
+    changes.m_voxels = {};
+    changes.m_isComplete = false;
+  }
+}
+
+template<typename T, typename Run>
+void encodeRuns(const T* values, std::size_t n, std::vector<Run>& runs)
+{
+  runs.clear();
+
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const uint32_t value = static_cast<uint32_t>(values[i]);
+
+    if (!runs.empty() && runs.back().m_value == value)
+    {
+      ++runs.back().m_length;
+    }
+    else
+    {
+      runs.push_back(Run{1u, value});
+    }
+  }
+
+  runs.shrink_to_fit();
+}
+
+template<typename T, typename Run>
+void decodeRuns(const std::vector<Run>& runs, T* values)
+{
+  for (const Run& run : runs)
+  {
+    values = std::fill_n(values, run.m_length, static_cast<T>(run.m_value));
+  }
+}
+
+} // namespace
+
+SegEditHistory::SegEditHistory(std::size_t memoryBudget)
+  : m_memoryBudget(memoryBudget)
+  , m_memoryUsage(0)
+{
+}
+
+void SegEditHistory::setMemoryBudget(std::size_t memoryBudget)
+{
+  m_memoryBudget = memoryBudget;
+  enforceMemoryBudget();
+}
+
+std::size_t SegEditHistory::memoryBudget() const
+{
+  return m_memoryBudget;
+}
+
+std::size_t SegEditHistory::memoryUsage() const
+{
+  return m_memoryUsage;
+}
+
+void SegEditHistory::saveBlock(
+  const uuids::uuid& segUid, const Image& seg, const glm::uvec3& offset, const glm::uvec3& size
+)
+{
+  const glm::ivec3 dims{seg.header().pixelDimensions()};
+  const ComponentType compType = seg.header().memoryComponentType();
+
+  if (glm::any(glm::equal(size, glm::uvec3{0})))
+  {
+    return;
+  }
+
+  SavedBricks& saved = m_openEdit[segUid];
+
+  if (saved.m_bricks.empty())
+  {
+    saved.m_dims = dims;
+    saved.m_compType = compType;
+    saved.m_dataVersion = seg.dataVersion();
+  }
+
+  const glm::ivec3 n = numBricks(dims);
+  const glm::ivec3 first = glm::ivec3{offset} / sk_brickSize;
+  const glm::ivec3 last = glm::min(glm::ivec3{offset + size - 1u} / sk_brickSize, n - 1);
+
+  const bool valid = dispatchSegComponentType(
+    compType,
+    [&](auto* typeTag)
+    {
+      using T = std::remove_pointer_t<decltype(typeTag)>;
+      const T* buffer = static_cast<const T*>(seg.bufferAsVoid(sk_comp));
+
+      for (int k = first.z; k <= last.z; ++k)
+      {
+        for (int j = first.y; j <= last.y; ++j)
+        {
+          for (int i = first.x; i <= last.x; ++i)
+          {
+            const uint32_t brick = static_cast<uint32_t>((k * n.y + j) * n.x + i);
+            auto [it, inserted] = saved.m_bricks.try_emplace(brick);
+
+            if (!inserted)
+            {
+              continue; // The brick was saved earlier in this edit
+            }
+
+            const glm::ivec3 bOffset = sk_brickSize * glm::ivec3{i, j, k};
+            const glm::ivec3 bSize = brickSize(dims, bOffset);
+
+            it->second.resize(numVoxels(bSize) * sizeof(T));
+            copyBlock(buffer, dims, bOffset, bSize, reinterpret_cast<T*>(it->second.data()));
+          }
+        }
+      }
+    }
+  );
+
+  if (!valid)
+  {
+    spdlog::error(
+      "Unable to save segmentation {} with invalid component type {} to the edit history",
+      segUid,
+      componentTypeString(compType)
+    );
+    m_openEdit.erase(segUid);
+  }
+}
+
+bool SegEditHistory::isEditOpen() const
+{
+  return !m_openEdit.empty();
+}
+
+void SegEditHistory::endEdit(const GetSegFunc& getSeg, const ChangesFunc& onChanges)
+{
+  if (m_openEdit.empty())
+  {
+    return;
+  }
+
+  Edit edit;
+
+  for (const auto& [segUid, saved] : m_openEdit)
+  {
+    const Image* seg = getSeg(segUid);
+
+    if (!seg || glm::ivec3{seg->header().pixelDimensions()} != saved.m_dims
+        || seg->header().memoryComponentType() != saved.m_compType)
+    {
+      continue; // The segmentation was removed during the edit
+    }
+
+    SegDelta delta;
+    delta.m_segUid = segUid;
+    delta.m_dims = saved.m_dims;
+    delta.m_compType = saved.m_compType;
+
+    SegChanges changes;
+    changes.m_segUid = segUid;
+    changes.m_dataVersionBefore = saved.m_dataVersion;
+    changes.m_dataVersionAfter = seg->dataVersion();
+
+    dispatchSegComponentType(
+      saved.m_compType,
+      [&](auto* typeTag)
+      {
+        using T = std::remove_pointer_t<decltype(typeTag)>;
+        const T* buffer = static_cast<const T*>(seg->bufferAsVoid(sk_comp));
+
+        std::vector<T> after(numVoxels(glm::ivec3{sk_brickSize}));
+
+        for (const auto& [brick, beforeBytes] : saved.m_bricks)
+        {
+          const glm::ivec3 bOffset = brickOffset(saved.m_dims, brick);
+          const glm::ivec3 bSize = brickSize(saved.m_dims, bOffset);
+          const std::size_t n = numVoxels(bSize);
+
+          const T* before = reinterpret_cast<const T*>(beforeBytes.data());
+          copyBlock(buffer, saved.m_dims, bOffset, bSize, after.data());
+
+          if (std::equal(before, before + n, after.data()))
+          {
+            continue; // No voxel of the brick changed
+          }
+
+          if (onChanges)
+          {
+            appendVoxelChanges(
+              saved.m_dims, bOffset, bSize, before, after.data(), changes
+            );
+          }
+
+          BrickDelta& b = delta.m_bricks.emplace_back();
+          b.m_brick = brick;
+          encodeRuns(before, n, b.m_before);
+          encodeRuns(after.data(), n, b.m_after);
+
+          delta.m_numBytes += sizeof(BrickDelta)
+                              + sizeof(Run) * (b.m_before.size() + b.m_after.size());
+        }
+      }
+    );
+
+    if (!delta.m_bricks.empty())
+    {
+      edit.m_numBytes += delta.m_numBytes;
+      edit.m_segs.emplace_back(std::move(delta));
+
+      if (onChanges)
+      {
+        onChanges(changes);
+      }
+    }
+  }
+
+  m_openEdit.clear();
+
+  if (!edit.m_segs.empty())
+  {
+    pushEdit(std::move(edit));
+  }
+}
+
+bool SegEditHistory::fillSeg(
+  const uuids::uuid& segUid,
+  Image& seg,
+  uint32_t value,
+  const GetSegFunc& getSeg,
+  const ChangesFunc& onChanges
+)
+{
+  endEdit(getSeg, onChanges);
+
+  SegDelta delta;
+  delta.m_segUid = segUid;
+  delta.m_dims = glm::ivec3{seg.header().pixelDimensions()};
+  delta.m_compType = seg.header().memoryComponentType();
+
+  SegChanges changes;
+  changes.m_segUid = segUid;
+  changes.m_dataVersionBefore = seg.dataVersion();
+
+  const glm::ivec3 n = numBricks(delta.m_dims);
+  const uint32_t totalBricks = static_cast<uint32_t>(numVoxels(n));
+
+  DirtyBrickMap& dirtyBricks = seg.dirtyBricks();
+
+  const bool valid = dispatchSegComponentType(
+    delta.m_compType,
+    [&](auto* typeTag)
+    {
+      using T = std::remove_pointer_t<decltype(typeTag)>;
+      T* buffer = static_cast<T*>(seg.bufferAsVoid(sk_comp));
+
+      const T fillValue = static_cast<T>(value);
+      std::vector<T> before(numVoxels(glm::ivec3{sk_brickSize}));
+      const std::vector<T> after(before.size(), fillValue);
+
+      for (uint32_t brick = 0; brick < totalBricks; ++brick)
+      {
+        const glm::ivec3 bOffset = brickOffset(delta.m_dims, brick);
+        const glm::ivec3 bSize = brickSize(delta.m_dims, bOffset);
+        const std::size_t count = numVoxels(bSize);
+
+        copyBlock(buffer, delta.m_dims, bOffset, bSize, before.data());
+
+        if (std::all_of(
+              before.data(), before.data() + count, [fillValue](T v) { return v == fillValue; }
+            ))
+        {
+          continue; // The brick is already filled
+        }
+
+        if (onChanges)
+        {
+          appendVoxelChanges(delta.m_dims, bOffset, bSize, before.data(), after.data(), changes);
+        }
+
+        BrickDelta& b = delta.m_bricks.emplace_back();
+        b.m_brick = brick;
+        encodeRuns(before.data(), count, b.m_before);
+        b.m_after = {Run{static_cast<uint32_t>(count), static_cast<uint32_t>(fillValue)}};
+
+        delta.m_numBytes += sizeof(BrickDelta)
+                            + sizeof(Run) * (b.m_before.size() + b.m_after.size());
+
+        writeBlock(buffer, delta.m_dims, bOffset, bSize, after.data());
+        dirtyBricks.markBlock(glm::uvec3{bOffset}, glm::uvec3{bSize});
+      }
+    }
+  );
+
+  if (!valid)
+  {
+    spdlog::error(
+      "Unable to fill segmentation {} with invalid component type {}",
+      segUid,
+      componentTypeString(delta.m_compType)
+    );
+    return false;
+  }
+
+  if (delta.m_bricks.empty())
+  {
+    return true; // No voxel changed
+  }
+
+  if (onChanges)
+  {
+    changes.m_dataVersionAfter = seg.dataVersion();
+    onChanges(changes);
+  }
+
+  Edit edit;
+  edit.m_numBytes = delta.m_numBytes;
+  edit.m_segs.emplace_back(std::move(delta));
+  pushEdit(std::move(edit));
+
+  return true;
+}
+
+void SegEditHistory::pushEdit(Edit&& edit)
+{
+  for (const Edit& redo : m_redoSteps)
+  {
+    m_memoryUsage -= redo.m_numBytes;
+  }
+  m_redoSteps.clear();
+
+  spdlog::trace(
+    "Added segmentation edit with {} bytes to the history ({} of {} bytes used)",
+    edit.m_numBytes,
+    m_memoryUsage + edit.m_numBytes,
+    m_memoryBudget
+  );
+
+  m_memoryUsage += edit.m_numBytes;
+  m_undoSteps.emplace_back(std::move(edit));
+
+  enforceMemoryBudget();
+}
+
+bool SegEditHistory::canUndo() const
+{
+  return !m_undoSteps.empty() || isEditOpen();
+}
+
+bool SegEditHistory::canRedo() const
+{
+  return !m_redoSteps.empty();
+}
+
+bool SegEditHistory::undo(const GetSegFunc& getSeg, const ChangesFunc& onChanges)
+{
+  endEdit(getSeg, onChanges);
+
+  if (m_undoSteps.empty())
+  {
+    return false;
+  }
+
+  apply(m_undoSteps.back(), true, getSeg, onChanges);
+
+  m_redoSteps.emplace_back(std::move(m_undoSteps.back()));
+  m_undoSteps.pop_back();
+  return true;
+}
+
+bool SegEditHistory::redo(const GetSegFunc& getSeg, const ChangesFunc& onChanges)
+{
+  // Ending an edit that changed voxels clears the redo steps
+  endEdit(getSeg, onChanges);
+
+  if (m_redoSteps.empty())
+  {
+    return false;
+  }
+
+  apply(m_redoSteps.back(), false, getSeg, onChanges);
+
+  m_undoSteps.emplace_back(std::move(m_redoSteps.back()));
+  m_redoSteps.pop_back();
+  return true;
+}
+
+void SegEditHistory::removeSeg(const uuids::uuid& segUid)
+{
+  m_openEdit.erase(segUid);
+
+  auto removeFromSteps = [this, &segUid](auto& steps)
+  {
+    for (Edit& edit : steps)
+    {
+      for (auto it = std::begin(edit.m_segs); it != std::end(edit.m_segs);)
+      {
+        if (segUid == it->m_segUid)
+        {
+          edit.m_numBytes -= it->m_numBytes;
+          m_memoryUsage -= it->m_numBytes;
+          it = edit.m_segs.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+    // Drop edits that only changed the segmentation
+    steps.erase(
+      std::remove_if(
+        std::begin(steps), std::end(steps), [](const Edit& edit) { return edit.m_segs.empty(); }
+      ),
+      std::end(steps)
+    );
+  };
+
+  removeFromSteps(m_undoSteps);
+  removeFromSteps(m_redoSteps);
+}
+
+void SegEditHistory::clear()
+{
+  m_openEdit.clear();
+  m_undoSteps.clear();
+  m_redoSteps.clear();
+  m_memoryUsage = 0;
+}
+
+void SegEditHistory::apply(
+  const Edit& edit, bool useValuesBefore, const GetSegFunc& getSeg, const ChangesFunc& onChanges
+) const
+{
+  for (const SegDelta& delta : edit.m_segs)
+  {
+    Image* seg = getSeg(delta.m_segUid);
+
+    if (!seg || glm::ivec3{seg->header().pixelDimensions()} != delta.m_dims
+        || seg->header().memoryComponentType() != delta.m_compType)
+    {
+      spdlog::warn("Segmentation {} of the edit no longer exists", delta.m_segUid);
+      continue;
+    }
+
+    DirtyBrickMap& dirtyBricks = seg->dirtyBricks();
+
+    SegChanges changes;
+    changes.m_segUid = delta.m_segUid;
+    changes.m_dataVersionBefore = seg->dataVersion();
+
+    dispatchSegComponentType(
+      delta.m_compType,
+      [&](auto* typeTag)
+      {
+        using T = std::remove_pointer_t<decltype(typeTag)>;
+        T* buffer = static_cast<T*>(seg->bufferAsVoid(sk_comp));
+
+        std::vector<T> values(numVoxels(glm::ivec3{sk_brickSize}));
+        std::vector<T> priorValues(onChanges ? values.size() : 0);
+
+        for (const BrickDelta& b : delta.m_bricks)
+        {
+          const glm::ivec3 bOffset = brickOffset(delta.m_dims, b.m_brick);
+          const glm::ivec3 bSize = brickSize(delta.m_dims, bOffset);
+
+          decodeRuns(useValuesBefore ? b.m_before : b.m_after, values.data());
+
+          if (onChanges)
+          {
+            decodeRuns(useValuesBefore ? b.m_after : b.m_before, priorValues.data());
+            appendVoxelChanges(
+              delta.m_dims, bOffset, bSize, priorValues.data(), values.data(), changes
+            );
+          }
+
+          writeBlock(buffer, delta.m_dims, bOffset, bSize, values.data());
+          dirtyBricks.markBlock(glm::uvec3{bOffset}, glm::uvec3{bSize});
+        }
+      }
+    );
+
+    if (onChanges)
+    {
+      changes.m_dataVersionAfter = seg->dataVersion();
+      onChanges(changes);
+    }
+  }
+}
+
+void SegEditHistory::enforceMemoryBudget()
+{
+  while (m_memoryUsage > m_memoryBudget && !m_undoSteps.empty())
+  {
+    m_memoryUsage -= m_undoSteps.front().m_numBytes;
+    m_undoSteps.pop_front();
+  }
+
+  while (m_memoryUsage > m_memoryBudget && !m_redoSteps.empty())
+  {
+    m_memoryUsage -= m_redoSteps.front().m_numBytes;
+    m_redoSteps.erase(std::begin(m_redoSteps));
+  }
+}
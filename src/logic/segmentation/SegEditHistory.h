@@ -0,0 +1,199 @@
+#ifndef SEG_EDIT_HISTORY_H
+#define SEG_EDIT_HISTORY_H
+
+#include "common/Types.h"
+
+#include <glm/vec3.hpp>
+
+#include <uuid.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class Image;
+
+/**
+ * @brief Undo/redo history of segmentation edits.
+ *
+ * Segmentations are divided into bricks of 16^3 voxels. Before voxels of a segmentation change,
+ * the bricks containing them are saved. When the edit ends (e.g. when the mouse is released after
+ * a brush stroke), only the bricks whose voxels changed are kept, as run-length encoded label
+ * values before and after the edit. All changes made between the first save and the end of the
+ * edit form a single step of the history, even if they span several segmentations.
+ *
+ * The memory used by the history is capped by a budget: once it is exceeded, the oldest edits
+ * are dropped. Undo and redo restore the changed bricks in the segmentation and mark only those
+ * bricks as dirty, so that they alone are uploaded to the segmentation texture.
+ *
+ * Ending, undoing, and redoing an edit can report the voxels that changed in each segmentation,
+ * so that data derived from the segmentations can be updated without scanning them.
+ */
+class SegEditHistory
+{
+public:
+  /// Function that returns the segmentation with a UID, or nullptr if it does not exist
+  using GetSegFunc = std::function<Image*(const uuids::uuid& segUid)>;
+
+  /// Voxel whose label changed
+  struct VoxelChange
+  {
+    std::size_t m_index; //!< Index of the voxel in the segmentation buffer
+    uint32_t m_before;   //!< Label before the change
+    uint32_t m_after;    //!< Label after the change
+  };
+
+  /// Maximum number of changed voxels reported per segmentation. Larger changes are reported
+  /// as incomplete, since data derived from the segmentation is then faster to recompute.
+  static constexpr std::size_t sk_maxVoxelChanges = std::size_t{1} << 20;
+
+  /// Voxels of a segmentation that changed when an edit ended, was undone, or was redone
+  struct SegChanges
+  {
+    uuids::uuid m_segUid;
+    uint64_t m_dataVersionBefore = 0; //!< Data version of the segmentation before the change
+    uint64_t m_dataVersionAfter = 0;  //!< Data version of the segmentation after the change
+    bool m_isComplete = true;          //!< False if too many voxels changed to be listed
+    std::vector<VoxelChange> m_voxels; //!< Changed voxels, if the changes are complete
+  };
+
+  /// Function called with the changed voxels of each segmentation. It may be empty.
+  using ChangesFunc = std::function<void(const SegChanges& changes)>;
+
+  /// Side length of the bricks, in voxels
+  static constexpr int sk_brickSize = 16;
+
+  /// @param[in] memoryBudget Maximum number of bytes used by the history
+  explicit SegEditHistory(std::size_t memoryBudget);
+
+  void setMemoryBudget(std::size_t memoryBudget);
+  std::size_t memoryBudget() const;
+
+  /// Number of bytes used by the undo and redo steps
+  std::size_t memoryUsage() const;
+
+  /**
+   * @brief Save a block of voxels of a segmentation before they are changed. This starts an
+   * edit if none is open. Bricks that were already saved during the open edit are not saved again.
+   *
+   * @param[in] segUid Segmentation UID
+   * @param[in] seg Segmentation, with UInt8, UInt16, or UInt32 components
+   * @param[in] offset Offset of the block, in voxels
+   * @param[in] size Size of the block, in voxels
+   */
+  void saveBlock(
+    const uuids::uuid& segUid, const Image& seg, const glm::uvec3& offset, const glm::uvec3& size
+  );
+
+  /**
+   * @brief Fill a segmentation with a single value, as a separate step of the history. This ends
+   * the open edit first. The segmentation is not saved as a block: the bricks are encoded one at a
+   * time, and the value after the fill is recorded as a single run per changed brick.
+   *
+   * @param[in] segUid Segmentation UID
+   * @param[in,out] seg Segmentation, with UInt8, UInt16, or UInt32 components
+   * @param[in] value Fill value
+   * @param[in] getSeg Function that returns segmentations, used to end the open edit
+   * @param[in] onChanges Optional function called with the changed voxels
+   *
+   * @return True iff the segmentation has a valid component type
+   */
+  bool fillSeg(
+    const uuids::uuid& segUid,
+    Image& seg,
+    uint32_t value,
+    const GetSegFunc& getSeg,
+    const ChangesFunc& onChanges = nullptr
+  );
+
+  /// Is an edit open?
+  bool isEditOpen() const;
+
+  /// End the open edit and push its changes onto the undo steps. This clears the redo steps,
+  /// unless no voxel changed during the edit.
+  void endEdit(const GetSegFunc& getSeg, const ChangesFunc& onChanges = nullptr);
+
+  bool canUndo() const;
+  bool canRedo() const;
+
+  /// Undo the last edit, ending the open edit first
+  /// @return True iff an edit was undone
+  bool undo(const GetSegFunc& getSeg, const ChangesFunc& onChanges = nullptr);
+
+  /// Redo the last undone edit, ending the open edit first
+  /// @return True iff an edit was redone
+  bool redo(const GetSegFunc& getSeg, const ChangesFunc& onChanges = nullptr);
+
+  /// Remove all changes to a segmentation from the history
+  void removeSeg(const uuids::uuid& segUid);
+
+  /// Remove all edits
+  void clear();
+
+private:
+  /// Run of equal label values
+  struct Run
+  {
+    uint32_t m_length;
+    uint32_t m_value;
+  };
+
+  /// Label values of a brick before and after an edit
+  struct BrickDelta
+  {
+    uint32_t m_brick;
+    std::vector<Run> m_before;
+    std::vector<Run> m_after;
+  };
+
+  /// Changed bricks of one segmentation
+  struct SegDelta
+  {
+    uuids::uuid m_segUid;
+    glm::ivec3 m_dims{0};
+    ComponentType m_compType = ComponentType::UInt8;
+    std::vector<BrickDelta> m_bricks;
+    std::size_t m_numBytes = 0;
+  };
+
+  /// Step of the history
+  struct Edit
+  {
+    std::vector<SegDelta> m_segs;
+    std::size_t m_numBytes = 0;
+  };
+
+  /// Bricks of a segmentation saved during the open edit, keyed by brick index
+  struct SavedBricks
+  {
+    glm::ivec3 m_dims{0};
+    ComponentType m_compType = ComponentType::UInt8;
+    uint64_t m_dataVersion = 0; //!< Data version of the segmentation when its first brick was saved
+    std::unordered_map<uint32_t, std::vector<uint8_t> > m_bricks;
+  };
+
+  /// Write the values of an edit (before or after it) to the segmentations
+  void apply(
+    const Edit& edit, bool useValuesBefore, const GetSegFunc& getSeg, const ChangesFunc& onChanges
+  ) const;
+
+  /// Push an edit onto the undo steps, clearing the redo steps
+  void pushEdit(Edit&& edit);
+
+  /// Drop the oldest undo steps (then the farthest redo steps) until the budget is met
+  void enforceMemoryBudget();
+
+  std::size_t m_memoryBudget; //!< Maximum number of bytes used by the history
+  std::size_t m_memoryUsage;  //!< Number of bytes used by the history
+
+  /// Bricks saved during the open edit, keyed by segmentation UID
+  std::unordered_map<uuids::uuid, SavedBricks> m_openEdit;
+
+  std::deque<Edit> m_undoSteps;  //!< Edits that can be undone, oldest first
+  std::vector<Edit> m_redoSteps; //!< Edits that can be redone, next one last
+};
+
+#endif // SEG_EDIT_HISTORY_H
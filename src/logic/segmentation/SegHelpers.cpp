@@ -2,6 +2,8 @@
 
 #include <glm/glm.hpp>
 
+#include <optional>
+
 LabelIndexMaps createLabelIndexMaps(
   const glm::ivec3& dims,
   std::function<LabelType(int x, int y, int z)> getSeedValue,
@@ -12,6 +14,9 @@ LabelIndexMaps createLabelIndexMaps(
 
   std::size_t labelIndex = 0;
 
+  // Labels come in runs, so the maps are only searched when the label changes
+  std::optional<LabelType> priorLabel;
+
   for (int z = 0; z < dims.z; ++z)
   {
     for (int y = 0; y < dims.y; ++y)
@@ -20,6 +25,13 @@ LabelIndexMaps createLabelIndexMaps(
       {
         const LabelType label = getSeedValue(x, y, z);
 
+        if (priorLabel && label == *priorLabel)
+        {
+          continue;
+        }
+
+        priorLabel = label;
+
         // Ignore the background (0) label if ignoreBackgroundZeroLabel is true
         if (0 < label || (0 == label && !ignoreBackgroundZeroLabel))
         {
@@ -51,6 +51,9 @@ LabelIndexMaps createLabelIndexMaps(
 
   std::size_t labelIndex = 0;
 
+  // Labels come in runs, so the maps are only searched when the label changes
+  std::optional<LabelType> priorLabel;
+
   for (int z = 0; z < dims.z; ++z)
   {
     for (int y = 0; y < dims.y; ++y)
@@ -59,6 +62,13 @@ LabelIndexMaps createLabelIndexMaps(
       {
         const LabelType label = buffer[z * dims.x * dims.y + y * dims.x + x];
 
+        if (priorLabel && label == *priorLabel)
+        {
+          continue;
+        }
+
+        priorLabel = label;
+
         // Ignore the background (0) label
         if (0 < label || (0 == label && !ignoreBackgroundZeroLabel))
         {
@@ -0,0 +1,341 @@
+#include "logic/segmentation/SparseSeeds.h"
+
+#include "common/ParallelFor.h"
+#include "image/ComponentDispatch.h"
+#include "image/Image.h"
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+/// Minimum number of voxels scanned or copied by a thread
+constexpr std::size_t sk_minVoxelsPerChunk = std::size_t{1} << 18;
+
+using RunMap = std::map<LabelType, std::vector<SparseSeeds::Run> >;
+
+/// Number of slices per chunk, such that a chunk has at least the minimum number of voxels
+std::size_t minSlicesPerChunk(const glm::ivec3& dims)
+{
+  const std::size_t sliceSize = std::max(std::size_t{1}, static_cast<std::size_t>(dims.x) * dims.y);
+  return std::max(std::size_t{1}, sk_minVoxelsPerChunk / sliceSize);
+}
+
+/// Append the runs of non-zero voxels of slices [zBegin, zEnd) of a segmentation buffer
+template<typename T>
+void extractRuns(const T* seg, const glm::ivec3& dims, int zBegin, int zEnd, RunMap& runs)
+{
+  for (int z = zBegin; z < zEnd; ++z)
+  {
+    for (int y = 0; y < dims.y; ++y)
+    {
+      const T* row = seg + (static_cast<std::size_t>(z) * dims.y + y) * dims.x;
+
+      for (int x = 0; x < dims.x;)
+      {
+        const T value = row[x];
+
+        if (0 == value)
+        {
+          ++x;
+          continue;
+        }
+
+        const int start = x;
+
+        while (x < dims.x && value == row[x])
+        {
+          ++x;
+        }
+
+        runs[static_cast<LabelType>(value)].push_back({start, y, z, x - start});
+      }
+    }
+  }
+}
+
+/// Copy rows of a box of an image component to a float buffer
+template<typename T>
+void copyBox(
+  const T* data,
+  std::size_t stride,
+  const glm::ivec3& dims,
+  const SparseSeeds::Box& box,
+  float* out
+)
+{
+  parallel::forEachChunk(
+    static_cast<std::size_t>(box.m_size.z),
+    minSlicesPerChunk(box.m_size),
+    [&](std::size_t /*chunk*/, std::size_t zBegin, std::size_t zEnd)
+    {
+      for (std::size_t z = zBegin; z < zEnd; ++z)
+      {
+        for (int y = 0; y < box.m_size.y; ++y)
+        {
+          const std::size_t in
+            = ((box.m_offset.z + z) * dims.y + box.m_offset.y + y) * dims.x + box.m_offset.x;
+          float* row = out + (z * box.m_size.y + y) * box.m_size.x;
+
+          for (int x = 0; x < box.m_size.x; ++x)
+          {
+            row[x] = static_cast<float>(data[(in + x) * stride]);
+          }
+        }
+      }
+    }
+  );
+}
+
+} // namespace
+
+SparseSeeds::SparseSeeds(const glm::ivec3& dims)
+  : m_dims(dims)
+{
+}
+
+std::optional<SparseSeeds> SparseSeeds::fromSegmentation(const Image& seg)
+{
+  const glm::ivec3 dims{seg.header().pixelDimensions()};
+  const void* buffer = seg.bufferAsVoid(0);
+
+  // Slabs are scanned concurrently into their own runs, which are then appended in slab order
+  // so that the runs of each label remain sorted
+  const std::size_t numSlices = static_cast<std::size_t>(dims.z);
+  std::vector<RunMap> slabRuns(parallel::numChunks(numSlices, minSlicesPerChunk(dims)));
+
+  auto scan = [&dims, &numSlices, &slabRuns](const auto* data)
+  {
+    parallel::forEachChunk(
+      numSlices,
+      minSlicesPerChunk(dims),
+      [&](std::size_t chunk, std::size_t zBegin, std::size_t zEnd)
+      {
+        extractRuns(
+          data, dims, static_cast<int>(zBegin), static_cast<int>(zEnd), slabRuns[chunk]
+        );
+      }
+    );
+  };
+
+  switch (seg.header().memoryComponentType())
+  {
+  case ComponentType::UInt8:
+    scan(static_cast<const uint8_t*>(buffer));
+    break;
+  case ComponentType::UInt16:
+    scan(static_cast<const uint16_t*>(buffer));
+    break;
+  case ComponentType::UInt32:
+    scan(static_cast<const uint32_t*>(buffer));
+    break;
+  default:
+  {
+    spdlog::error(
+      "Invalid component type '{}' of segmentation from which to extract seeds",
+      componentTypeString(seg.header().memoryComponentType())
+    );
+    return std::nullopt;
+  }
+  }
+
+  SparseSeeds seeds(dims);
+
+  for (RunMap& runs : slabRuns)
+  {
+    for (auto& [label, labelRuns] : runs)
+    {
+      std::vector<Run>& allRuns = seeds.m_runs[label];
+      allRuns.insert(std::end(allRuns), std::begin(labelRuns), std::end(labelRuns));
+    }
+  }
+
+  spdlog::debug(
+    "Extracted {} seed voxels with {} labels into {} bytes",
+    seeds.numSeedVoxels(),
+    seeds.m_runs.size(),
+    seeds.numBytes()
+  );
+
+  return seeds;
+}
+
+const glm::ivec3& SparseSeeds::dims() const
+{
+  return m_dims;
+}
+
+const std::map<LabelType, std::vector<SparseSeeds::Run> >& SparseSeeds::runs() const
+{
+  return m_runs;
+}
+
+void SparseSeeds::addRun(LabelType label, const Run& run)
+{
+  if (0 < run.m_length)
+  {
+    m_runs[label].push_back(run);
+  }
+}
+
+std::size_t SparseSeeds::numSeedVoxels() const
+{
+  std::size_t count = 0;
+
+  for (const auto& [label, runs] : m_runs)
+  {
+    for (const Run& run : runs)
+    {
+      count += static_cast<std::size_t>(run.m_length);
+    }
+  }
+
+  return count;
+}
+
+std::size_t SparseSeeds::numBytes() const
+{
+  std::size_t count = 0;
+
+  for (const auto& [label, runs] : m_runs)
+  {
+    count += runs.capacity() * sizeof(Run);
+  }
+
+  return count;
+}
+
+std::optional<SparseSeeds::Box> SparseSeeds::boundingBox() const
+{
+  glm::ivec3 minCorner{m_dims};
+  glm::ivec3 maxCorner{-1};
+
+  for (const auto& [label, runs] : m_runs)
+  {
+    for (const Run& run : runs)
+    {
+      minCorner = glm::min(minCorner, glm::ivec3{run.m_x, run.m_y, run.m_z});
+      maxCorner = glm::max(maxCorner, glm::ivec3{run.m_x + run.m_length - 1, run.m_y, run.m_z});
+    }
+  }
+
+  if (glm::any(glm::lessThan(maxCorner, minCorner)))
+  {
+    return std::nullopt;
+  }
+
+  return Box{minCorner, maxCorner - minCorner + 1};
+}
+
+SparseSeeds::Box SparseSeeds::regionOfInterest(int padding) const
+{
+  const std::optional<Box> bbox = boundingBox();
+
+  if (!bbox)
+  {
+    return Box{glm::ivec3{0}, m_dims};
+  }
+
+  const glm::ivec3 pad{std::max(padding, 0)};
+  const glm::ivec3 minCorner = glm::max(bbox->m_offset - pad, glm::ivec3{0});
+  const glm::ivec3 maxCorner = glm::min(bbox->m_offset + bbox->m_size + pad, m_dims);
+
+  return Box{minCorner, maxCorner - minCorner};
+}
+
+SparseSeeds SparseSeeds::crop(const Box& box) const
+{
+  SparseSeeds cropped(box.m_size);
+
+  const glm::ivec3 boxEnd = box.m_offset + box.m_size;
+
+  for (const auto& [label, runs] : m_runs)
+  {
+    for (const Run& run : runs)
+    {
+      if (run.m_y < box.m_offset.y || boxEnd.y <= run.m_y || run.m_z < box.m_offset.z
+          || boxEnd.z <= run.m_z)
+      {
+        continue;
+      }
+
+      const int xBegin = std::max(run.m_x, box.m_offset.x);
+      const int xEnd = std::min(run.m_x + run.m_length, boxEnd.x);
+
+      cropped.addRun(
+        label,
+        {xBegin - box.m_offset.x,
+         run.m_y - box.m_offset.y,
+         run.m_z - box.m_offset.z,
+         xEnd - xBegin}
+      );
+    }
+  }
+
+  return cropped;
+}
+
+LabelIndexMaps SparseSeeds::labelIndexMaps(bool includeBackground) const
+{
+  LabelIndexMaps labelMaps;
+  std::size_t labelIndex = 0;
+
+  auto addLabel = [&labelMaps, &labelIndex](LabelType label)
+  {
+    if (labelMaps.labelToIndex.emplace(label, labelIndex).second)
+    {
+      labelMaps.indexToLabel.emplace(labelIndex++, label);
+    }
+  };
+
+  if (includeBackground)
+  {
+    addLabel(0);
+  }
+
+  for (const auto& [label, runs] : m_runs)
+  {
+    if (!runs.empty())
+    {
+      addLabel(label);
+    }
+  }
+
+  return labelMaps;
+}
+
+std::optional<std::vector<float> > copyComponentBox(
+  const Image& image, uint32_t component, const SparseSeeds::Box& box
+)
+{
+  const ImageHeader& header = image.header();
+  const uint32_t numComps = header.numComponentsPerPixel();
+
+  if (numComps <= component)
+  {
+    spdlog::error(
+      "Invalid image component {} to copy; image has only {} components", component, numComps
+    );
+    return std::nullopt;
+  }
+
+  const glm::ivec3 dims{header.pixelDimensions()};
+
+  std::vector<float> out(box.numVoxels());
+
+  const bool valid = visitComponentBuffer(
+    image,
+    component,
+    [&](const auto* data, std::size_t stride) { copyBox(data, stride, dims, box, out.data()); }
+  );
+
+  if (!valid)
+  {
+    spdlog::error(
+      "Invalid component type '{}' of image to copy",
+      componentTypeString(header.memoryComponentType())
+    );
+    return std::nullopt;
+  }
+
+  return out;
+}
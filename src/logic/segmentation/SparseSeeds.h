@@ -0,0 +1,160 @@
+#ifndef SPARSE_SEEDS_H
+#define SPARSE_SEEDS_H
+
+#include "common/SegmentationTypes.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+class Image;
+
+/**
+ * @brief Seeds of a segmentation, stored sparsely as runs of voxels along x per label.
+ *
+ * Seeds are usually a small fraction of the voxels of an image, so the seeds of the seed-based
+ * segmentation algorithms are extracted once into this structure rather than copied densely.
+ * The bounding box of the seeds defines the region of interest to which the algorithms are
+ * cropped. The runs of each label are sorted by (z, y, x) and do not overlap.
+ */
+class SparseSeeds
+{
+public:
+  /// Run of consecutive seed voxels along x
+  struct Run
+  {
+    int m_x = 0;      //!< First voxel of the run
+    int m_y = 0;      //!< Row of the run
+    int m_z = 0;      //!< Slice of the run
+    int m_length = 0; //!< Number of voxels of the run
+  };
+
+  /// Axis-aligned box of voxels
+  struct Box
+  {
+    glm::ivec3 m_offset{0}; //!< First voxel of the box
+    glm::ivec3 m_size{0};   //!< Number of voxels of the box along each axis
+
+    std::size_t numVoxels() const
+    {
+      return static_cast<std::size_t>(m_size.x) * m_size.y * m_size.z;
+    }
+  };
+
+  explicit SparseSeeds(const glm::ivec3& dims = glm::ivec3{0});
+
+  /**
+   * @brief Extract the non-zero voxels of a segmentation. Slabs of slices are scanned
+   * concurrently.
+   * @return Seeds, or std::nullopt if the segmentation component type is invalid
+   */
+  static std::optional<SparseSeeds> fromSegmentation(const Image& seg);
+
+  /// Dimensions of the image of the seeds
+  const glm::ivec3& dims() const;
+
+  /// Runs of each label
+  const std::map<LabelType, std::vector<Run> >& runs() const;
+
+  /// Add a run of a label. Runs of a label must be added in (z, y, x) order.
+  void addRun(LabelType label, const Run& run);
+
+  /// Number of seed voxels of all labels
+  std::size_t numSeedVoxels() const;
+
+  /// Number of bytes of the runs
+  std::size_t numBytes() const;
+
+  /// Bounding box of the seeds of all labels, or std::nullopt if there are no seeds
+  std::optional<Box> boundingBox() const;
+
+  /**
+   * @brief Region of interest of a segmentation seeded by these seeds: the bounding box of the
+   * seeds, padded on all sides and clamped to the image. Without seeds, it is the whole image.
+   */
+  Box regionOfInterest(int padding) const;
+
+  /// Seeds in a box of the image, with coordinates relative to the box
+  SparseSeeds crop(const Box& box) const;
+
+  /**
+   * @brief Maps between the seed labels and consecutive indices, in ascending label order
+   * @param[in] includeBackground If true, then the background (0) label is mapped to index 0
+   */
+  LabelIndexMaps labelIndexMaps(bool includeBackground) const;
+
+  /**
+   * @brief Write the seeds to a dense buffer with the dimensions of the seeds. Only seed voxels
+   * are written; the buffer must be initialized by the caller.
+   * @param[out] buffer Buffer
+   * @param[in] mapLabel Function T(LabelType label) that maps a label to its buffer value
+   */
+  template<typename T, class LabelMap>
+  void rasterize(T* buffer, LabelMap&& mapLabel) const
+  {
+    for (const auto& [label, runs] : m_runs)
+    {
+      const T value = mapLabel(label);
+
+      for (const Run& run : runs)
+      {
+        T* row = buffer + (static_cast<std::size_t>(run.m_z) * m_dims.y + run.m_y) * m_dims.x;
+        std::fill(row + run.m_x, row + run.m_x + run.m_length, value);
+      }
+    }
+  }
+
+private:
+  glm::ivec3 m_dims;
+  std::map<LabelType, std::vector<Run> > m_runs;
+};
+
+/**
+ * @brief Copy a box of an image component to a float buffer. Rows are copied concurrently.
+ * @return Buffer, or std::nullopt if the component or its type is invalid
+ */
+std::optional<std::vector<float> > copyComponentBox(
+  const Image& image, uint32_t component, const SparseSeeds::Box& box
+);
+
+/**
+ * @brief Copy a buffer of the voxels of a box into a buffer of the whole image
+ * @param[in] boxBuffer Buffer of the box
+ * @param[in] box Box
+ * @param[in] dims Image dimensions
+ * @param[out] buffer Buffer of the image. Voxels outside of the box are not written.
+ * @param[in] mapValue Function U(T value) that maps a box value to its image value
+ */
+template<typename T, typename U, class ValueMap>
+void pasteBox(
+  const T* boxBuffer,
+  const SparseSeeds::Box& box,
+  const glm::ivec3& dims,
+  U* buffer,
+  ValueMap&& mapValue
+)
+{
+  for (int z = 0; z < box.m_size.z; ++z)
+  {
+    for (int y = 0; y < box.m_size.y; ++y)
+    {
+      const T* in = boxBuffer + (static_cast<std::size_t>(z) * box.m_size.y + y) * box.m_size.x;
+      U* out = buffer
+               + (static_cast<std::size_t>(box.m_offset.z + z) * dims.y + box.m_offset.y + y)
+                   * dims.x
+               + box.m_offset.x;
+
+      for (int x = 0; x < box.m_size.x; ++x)
+      {
+        out[x] = mapValue(in[x]);
+      }
+    }
+  }
+}
+
+#endif // SPARSE_SEEDS_H
@@ -0,0 +1,620 @@
+#include "mesh/MarchingCubes.h"
+
+#include "common/ParallelFor.h"
+
+#include "image/ComponentDispatch.h"
+#include "image/Image.h"
+#include "image/MinMaxBlockTree.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace
+{
+/// Minimum number of blocks processed by a thread
+constexpr std::size_t sk_minBlocksPerChunk = 4;
+
+/// Maximum number of triangles in a cell: the loops of a cell cross at most 12 edges
+constexpr int sk_maxTriangles = 10;
+
+/// Marks edges of the local edge table that have no vertex yet
+constexpr int32_t sk_noVertex = std::numeric_limits<int32_t>::min();
+
+/// Corners of the twelve edges of a cell. Corner c is at offset (c & 1, (c >> 1) & 1, (c >> 2) & 1)
+/// from the origin of the cell, and edge e is parallel to axis e / 4.
+constexpr std::array<std::array<int, 2>, 12> sk_edgeCorners{
+  {{{0, 1}},
+   {{2, 3}},
+   {{4, 5}},
+   {{6, 7}},
+   {{0, 2}},
+   {{1, 3}},
+   {{4, 6}},
+   {{5, 7}},
+   {{0, 4}},
+   {{1, 5}},
+   {{2, 6}},
+   {{3, 7}}}
+};
+
+/// Corners of the six faces of a cell, in counter-clockwise order when viewed from outside
+constexpr std::array<std::array<int, 4>, 6> sk_faceCorners{
+  {{{0, 4, 6, 2}}, {{1, 3, 7, 5}}, {{0, 1, 5, 4}}, {{2, 6, 7, 3}}, {{0, 2, 3, 1}}, {{4, 5, 7, 6}}}
+};
+
+/// Triangles of a cell for one configuration of its corners
+struct CellCase
+{
+  std::array<int8_t, 3 * sk_maxTriangles> m_edges{}; //!< Edges of the triangle corners
+  int m_numTriangles = 0;
+};
+
+glm::uvec3 cornerOffset(int corner)
+{
+  return glm::uvec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+}
+
+int edgeBetween(int c0, int c1)
+{
+  for (int e = 0; e < 12; ++e)
+  {
+    if (std::minmax(c0, c1) == std::minmax(sk_edgeCorners[e][0], sk_edgeCorners[e][1]))
+    {
+      return e;
+    }
+  }
+
+  return -1;
+}
+
+/// Do two edges lie on a common face of the cell?
+bool edgesShareFace(int e0, int e1)
+{
+  for (const auto& face : sk_faceCorners)
+  {
+    auto onFace = [&face](int corner)
+    { return std::end(face) != std::find(std::begin(face), std::end(face), corner); };
+
+    if (onFace(sk_edgeCorners[e0][0]) && onFace(sk_edgeCorners[e0][1])
+        && onFace(sk_edgeCorners[e1][0]) && onFace(sk_edgeCorners[e1][1]))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Triangulate a loop of edges without diagonals between edges on a common face.
+ *
+ * Such a diagonal would lie on the face, where the adjacent cell can create it too, making the
+ * mesh non-manifold. The triangulation is found by dynamic programming over the sub-polygons of
+ * the loop, falling back to a fan if none exists.
+ *
+ * @return Triangles, as indices into the loop in increasing order
+ */
+std::vector<std::array<int, 3> > triangulateLoop(const std::array<int, 12>& loop, int n)
+{
+  auto isValid = [&loop, n](int i, int j)
+  { return (j == i + 1) || (0 == i && j == n - 1) || !edgesShareFace(loop[i], loop[j]); };
+
+  // Apex of a valid triangulation of the sub-polygon of loop vertices [i, j], or -1 if none
+  std::array<std::array<int, 12>, 12> apex;
+
+  for (auto& row : apex)
+  {
+    row.fill(-1);
+  }
+
+  for (int length = 2; length < n; ++length)
+  {
+    for (int i = 0; i + length < n; ++i)
+    {
+      const int j = i + length;
+
+      for (int k = i + 1; k < j && apex[i][j] < 0; ++k)
+      {
+        const bool leftOk = (k == i + 1) || (isValid(i, k) && 0 <= apex[i][k]);
+        const bool rightOk = (j == k + 1) || (isValid(k, j) && 0 <= apex[k][j]);
+
+        if (leftOk && rightOk)
+        {
+          apex[i][j] = k;
+        }
+      }
+    }
+  }
+
+  std::vector<std::array<int, 3> > triangles;
+
+  if (apex[0][n - 1] < 0)
+  {
+    for (int i = 1; i + 1 < n; ++i)
+    {
+      triangles.push_back({0, i, i + 1});
+    }
+    return triangles;
+  }
+
+  std::vector<std::pair<int, int> > polygons{{0, n - 1}};
+
+  while (!polygons.empty())
+  {
+    const auto [i, j] = polygons.back();
+    polygons.pop_back();
+
+    const int k = apex[i][j];
+    triangles.push_back({i, k, j});
+
+    if (i + 1 < k)
+    {
+      polygons.emplace_back(i, k);
+    }
+    if (k + 1 < j)
+    {
+      polygons.emplace_back(k, j);
+    }
+  }
+
+  return triangles;
+}
+
+/**
+ * @brief Build the triangles of the 256 configurations of inside and outside cell corners.
+ *
+ * On each face of the cell, segments join the edges at which the face boundary enters the inside
+ * to the edges at which it next leaves. On ambiguous faces, whose two inside corners are diagonal,
+ * this separates the inside corners. The choice depends only on the face, so both cells sharing
+ * it agree. The segments link into closed loops, which are triangulated. Triangles wind
+ * counter-clockwise around the normal that points from the inside to the outside.
+ */
+std::array<CellCase, 256> buildCellCases()
+{
+  std::array<CellCase, 256> cases{};
+
+  for (int config = 0; config < 256; ++config)
+  {
+    auto inside = [config](int corner) { return 0 != (config & (1 << corner)); };
+
+    // The next edge of the loop through each crossed edge
+    std::array<int, 12> next;
+    next.fill(-1);
+
+    for (const auto& face : sk_faceCorners)
+    {
+      std::array<int, 4> crossedEdges;
+      std::array<bool, 4> entersInside;
+      int numCrossed = 0;
+
+      for (int i = 0; i < 4; ++i)
+      {
+        const int c0 = face[i];
+        const int c1 = face[(i + 1) % 4];
+
+        if (inside(c0) != inside(c1))
+        {
+          crossedEdges[numCrossed] = edgeBetween(c0, c1);
+          entersInside[numCrossed] = inside(c1);
+          ++numCrossed;
+        }
+      }
+
+      for (int i = 0; i < numCrossed; ++i)
+      {
+        if (entersInside[i])
+        {
+          next[crossedEdges[i]] = crossedEdges[(i + 1) % numCrossed];
+        }
+      }
+    }
+
+    CellCase& cellCase = cases[config];
+    std::array<bool, 12> visited{};
+
+    for (int e = 0; e < 12; ++e)
+    {
+      if (next[e] < 0 || visited[e])
+      {
+        continue;
+      }
+
+      std::array<int, 12> loop;
+      int loopSize = 0;
+
+      for (int f = e; !visited[f]; f = next[f])
+      {
+        visited[f] = true;
+        loop[loopSize++] = f;
+      }
+
+      for (const auto& triangle : triangulateLoop(loop, loopSize))
+      {
+        int8_t* edges = &cellCase.m_edges[3 * cellCase.m_numTriangles++];
+        edges[0] = static_cast<int8_t>(loop[triangle[0]]);
+        edges[1] = static_cast<int8_t>(loop[triangle[1]]);
+        edges[2] = static_cast<int8_t>(loop[triangle[2]]);
+      }
+    }
+  }
+
+  return cases;
+}
+
+/// Mesh of the blocks processed by one thread
+struct ChunkMesh
+{
+  std::vector<glm::vec3> m_positions; //!< Positions of the vertices owned by the blocks
+  std::vector<glm::vec3> m_normals;   //!< Normals of the vertices owned by the blocks
+
+  /// Key and index of the owned vertices on the lower faces of each block, which preceding
+  /// blocks may share. They are sorted by key within each block.
+  std::vector<std::pair<uint64_t, int32_t> > m_faceVertices;
+
+  /// Keys of vertices on the upper faces of the blocks, which following blocks own
+  std::vector<uint64_t> m_sharedKeys;
+
+  /// Vertices of the triangle corners: the index of an owned vertex if non-negative,
+  /// otherwise (-1 - i) for the vertex with key \c m_sharedKeys[i]
+  std::vector<int32_t> m_corners;
+};
+
+/// Range of the face vertices of a block in its chunk
+struct BlockFaceVertices
+{
+  std::size_t m_chunk = 0;
+  std::size_t m_begin = 0;
+  std::size_t m_end = 0;
+};
+
+template<typename T>
+std::optional<IsosurfaceMesh> extractIsosurfaceFromBuffer(
+  const T* data,
+  std::size_t stride,
+  const MinMaxBlockTree& tree,
+  float isoValue,
+  const glm::mat4& subject_T_pixel
+)
+{
+  static const std::array<CellCase, 256> sk_cellCases = buildCellCases();
+
+  // Each side of a block has one more voxel than cells
+  constexpr uint32_t B = MinMaxBlockTree::sk_blockSize;
+  constexpr uint32_t V = B + 1;
+
+  const glm::uvec3 dims = tree.imageDims();
+  const glm::uvec3 grid = tree.blockGridDims();
+  const std::array<std::size_t, 3> axisStrides{
+    1, dims.x, static_cast<std::size_t>(dims.x) * dims.y
+  };
+
+  IsosurfaceMesh mesh;
+
+  const std::vector<uint32_t> blocks = tree.activeBlocks(isoValue);
+  mesh.m_numActiveBlocks = blocks.size();
+
+  if (blocks.empty())
+  {
+    return mesh;
+  }
+
+  const glm::mat3 normal_T_pixel = glm::inverseTranspose(glm::mat3{subject_T_pixel});
+
+  // Keep the triangles counter-clockwise in Subject space if it is mirrored
+  const bool flipWinding = (glm::determinant(glm::mat3{subject_T_pixel}) < 0.0f);
+
+  auto voxelIndex = [&dims](const glm::uvec3& v)
+  { return (static_cast<std::size_t>(v.z) * dims.y + v.y) * dims.x + v.x; };
+
+  auto value = [data, stride](std::size_t i) { return static_cast<float>(data[i * stride]); };
+
+  // Gradient of the image, in Pixel space, using one-sided differences at the boundary
+  auto gradient = [&](const glm::uvec3& v)
+  {
+    const std::size_t i = voxelIndex(v);
+    glm::vec3 g{0.0f};
+
+    for (int a = 0; a < 3; ++a)
+    {
+      const std::size_t lo = (0 < v[a]) ? i - axisStrides[a] : i;
+      const std::size_t hi = (v[a] + 1 < dims[a]) ? i + axisStrides[a] : i;
+
+      if (lo != hi)
+      {
+        g[a] = (value(hi) - value(lo)) / static_cast<float>((hi - lo) / axisStrides[a]);
+      }
+    }
+
+    return g;
+  };
+
+  std::vector<ChunkMesh> chunks(parallel::numChunks(blocks.size(), sk_minBlocksPerChunk));
+  std::vector<BlockFaceVertices> blockFaces(blocks.size());
+
+  auto marchBlocks = [&](std::size_t chunk, std::size_t begin, std::size_t end)
+  {
+    ChunkMesh& out = chunks[chunk];
+
+    // Vertex of each edge of the block, indexed by the edge's first voxel and axis
+    std::vector<int32_t> edgeVertices(3 * V * V * V);
+
+    for (std::size_t a = begin; a < end; ++a)
+    {
+      const uint32_t block = blocks[a];
+      const glm::uvec3 b{block % grid.x, (block / grid.x) % grid.y, block / (grid.x * grid.y)};
+
+      // The block has cells [c0, c1)
+      const glm::uvec3 c0 = b * B;
+      const glm::uvec3 c1 = glm::min(c0 + B, dims - 1u);
+
+      std::fill(std::begin(edgeVertices), std::end(edgeVertices), sk_noVertex);
+      const std::size_t faceBegin = out.m_faceVertices.size();
+
+      auto vertex = [&](const glm::uvec3& cell, int edge) -> int32_t
+      {
+        const int axis = edge / 4;
+        const glm::uvec3 v0 = cell + cornerOffset(sk_edgeCorners[edge][0]);
+        const glm::uvec3 l = v0 - c0;
+
+        int32_t& edgeVertex = edgeVertices[3 * ((l.z * V + l.y) * V + l.x) + axis];
+
+        if (sk_noVertex != edgeVertex)
+        {
+          return edgeVertex;
+        }
+
+        const std::size_t i0 = voxelIndex(v0);
+        const uint64_t key = 3 * static_cast<uint64_t>(i0) + axis;
+
+        // Vertices on the upper faces of the block are owned by the following blocks
+        for (int k = 0; k < 3; ++k)
+        {
+          if (B == l[k] && b[k] + 1 < grid[k])
+          {
+            edgeVertex = -1 - static_cast<int32_t>(out.m_sharedKeys.size());
+            out.m_sharedKeys.push_back(key);
+            return edgeVertex;
+          }
+        }
+
+        const float f0 = value(i0);
+        const float f1 = value(i0 + axisStrides[axis]);
+
+        // The crossing is at the middle of edges with a NaN value
+        float t = (isoValue - f0) / (f1 - f0);
+        if (!(0.0f <= t && t <= 1.0f))
+        {
+          t = 0.5f;
+        }
+
+        glm::uvec3 v1 = v0;
+        ++v1[axis];
+
+        glm::vec3 p{v0};
+        p[axis] += t;
+
+        // Normals point down the gradient, towards lower values
+        glm::vec3 n = normal_T_pixel * -glm::mix(gradient(v0), gradient(v1), t);
+        const float length = glm::length(n);
+        n = (0.0f < length && std::isfinite(length)) ? n / length : glm::vec3{0.0f};
+
+        out.m_positions.emplace_back(subject_T_pixel * glm::vec4{p, 1.0f});
+        out.m_normals.emplace_back(n);
+        edgeVertex = static_cast<int32_t>(out.m_positions.size() - 1);
+
+        if ((0 == l.x && 0 < b.x) || (0 == l.y && 0 < b.y) || (0 == l.z && 0 < b.z))
+        {
+          out.m_faceVertices.emplace_back(key, edgeVertex);
+        }
+
+        return edgeVertex;
+      };
+
+      for (uint32_t z = c0.z; z < c1.z; ++z)
+      {
+        for (uint32_t y = c0.y; y < c1.y; ++y)
+        {
+          for (uint32_t x = c0.x; x < c1.x; ++x)
+          {
+            const glm::uvec3 cell{x, y, z};
+            const std::size_t i = voxelIndex(cell);
+
+            int config = 0;
+
+            for (int c = 0; c < 8; ++c)
+            {
+              const std::size_t corner = i + (c & 1) * axisStrides[0]
+                                         + ((c >> 1) & 1) * axisStrides[1]
+                                         + ((c >> 2) & 1) * axisStrides[2];
+
+              if (value(corner) >= isoValue)
+              {
+                config |= (1 << c);
+              }
+            }
+
+            const CellCase& cellCase = sk_cellCases[config];
+
+            for (int t = 0; t < cellCase.m_numTriangles; ++t)
+            {
+              const int32_t v0 = vertex(cell, cellCase.m_edges[3 * t + 0]);
+              const int32_t v1 = vertex(cell, cellCase.m_edges[3 * t + 1]);
+              const int32_t v2 = vertex(cell, cellCase.m_edges[3 * t + 2]);
+
+              out.m_corners.push_back(v0);
+              out.m_corners.push_back(flipWinding ? v2 : v1);
+              out.m_corners.push_back(flipWinding ? v1 : v2);
+            }
+          }
+        }
+      }
+
+      std::sort(std::begin(out.m_faceVertices) + faceBegin, std::end(out.m_faceVertices));
+      blockFaces[a] = BlockFaceVertices{chunk, faceBegin, out.m_faceVertices.size()};
+    }
+  };
+
+  parallel::forEachChunk(blocks.size(), sk_minBlocksPerChunk, marchBlocks);
+
+  // Offsets of the vertices and triangle corners of each chunk in the mesh
+  std::vector<std::size_t> vertexOffsets(chunks.size() + 1, 0);
+  std::vector<std::size_t> cornerOffsets(chunks.size() + 1, 0);
+
+  for (std::size_t c = 0; c < chunks.size(); ++c)
+  {
+    vertexOffsets[c + 1] = vertexOffsets[c] + chunks[c].m_positions.size();
+    cornerOffsets[c + 1] = cornerOffsets[c] + chunks[c].m_corners.size();
+  }
+
+  if (std::numeric_limits<uint32_t>::max() < vertexOffsets.back())
+  {
+    spdlog::error("Isosurface has too many vertices ({})", vertexOffsets.back());
+    return std::nullopt;
+  }
+
+  mesh.m_positions.resize(vertexOffsets.back());
+  mesh.m_normals.resize(vertexOffsets.back());
+  mesh.m_indices.resize(cornerOffsets.back());
+
+  // Index in the mesh of the vertex with a key, which is owned by an active block
+  auto findOwnedVertex = [&](uint64_t key) -> std::optional<uint32_t>
+  {
+    const std::size_t i = key / 3;
+    const std::size_t sliceSize = static_cast<std::size_t>(dims.x) * dims.y;
+    const glm::uvec3 v(i % dims.x, (i / dims.x) % dims.y, i / sliceSize);
+    const glm::uvec3 b = glm::min(v / B, grid - 1u);
+    const uint32_t block = (b.z * grid.y + b.y) * grid.x + b.x;
+
+    const auto blockIt = std::lower_bound(std::begin(blocks), std::end(blocks), block);
+    if (std::end(blocks) == blockIt || block != *blockIt)
+    {
+      return std::nullopt;
+    }
+
+    const BlockFaceVertices& faces = blockFaces[blockIt - std::begin(blocks)];
+    const auto& faceVertices = chunks[faces.m_chunk].m_faceVertices;
+
+    const auto begin = std::begin(faceVertices) + faces.m_begin;
+    const auto end = std::begin(faceVertices) + faces.m_end;
+    const auto it = std::lower_bound(begin, end, std::make_pair(key, int32_t{0}));
+
+    if (end == it || key != it->first)
+    {
+      return std::nullopt;
+    }
+
+    return static_cast<uint32_t>(vertexOffsets[faces.m_chunk] + it->second);
+  };
+
+  std::vector<char> chunkResolved(chunks.size(), 1);
+
+  auto assembleChunks = [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+  {
+    for (std::size_t c = begin; c < end; ++c)
+    {
+      const ChunkMesh& chunk = chunks[c];
+
+      std::copy(
+        std::begin(chunk.m_positions),
+        std::end(chunk.m_positions),
+        std::begin(mesh.m_positions) + vertexOffsets[c]
+      );
+
+      std::copy(
+        std::begin(chunk.m_normals),
+        std::end(chunk.m_normals),
+        std::begin(mesh.m_normals) + vertexOffsets[c]
+      );
+
+      std::vector<uint32_t> sharedVertices(chunk.m_sharedKeys.size());
+
+      for (std::size_t k = 0; k < chunk.m_sharedKeys.size(); ++k)
+      {
+        const std::optional<uint32_t> vertex = findOwnedVertex(chunk.m_sharedKeys[k]);
+
+        if (!vertex)
+        {
+          chunkResolved[c] = 0;
+          return;
+        }
+
+        sharedVertices[k] = *vertex;
+      }
+
+      for (std::size_t k = 0; k < chunk.m_corners.size(); ++k)
+      {
+        const int32_t v = chunk.m_corners[k];
+
+        mesh.m_indices[cornerOffsets[c] + k] = (0 <= v)
+                                                 ? static_cast<uint32_t>(vertexOffsets[c] + v)
+                                                 : sharedVertices[-1 - v];
+      }
+    }
+  };
+
+  parallel::forEachChunk(chunks.size(), 1, assembleChunks);
+
+  if (std::find(std::begin(chunkResolved), std::end(chunkResolved), 0) != std::end(chunkResolved))
+  {
+    spdlog::error("Isosurface vertices shared by blocks could not be matched");
+    return std::nullopt;
+  }
+
+  return mesh;
+}
+
+} // namespace
+
+std::optional<IsosurfaceMesh> extractIsosurface(
+  const Image& image, uint32_t component, double isoValue
+)
+{
+  const uint32_t numComps = image.header().numComponentsPerPixel();
+
+  if (numComps <= component)
+  {
+    spdlog::error("Invalid image component {} when extracting isosurface", component);
+    return std::nullopt;
+  }
+
+  // Segmentations do not keep trees, since their values change
+  const MinMaxBlockTree* tree = image.minMaxTree(component);
+  MinMaxBlockTree segTree;
+
+  if (!tree)
+  {
+    segTree = MinMaxBlockTree(image, component);
+    tree = &segTree;
+  }
+
+  const float value = static_cast<float>(isoValue);
+  const glm::mat4& subject_T_pixel = image.transformations().subject_T_pixel();
+
+  std::optional<IsosurfaceMesh> mesh;
+
+  const bool valid = visitComponentBuffer(
+    image,
+    component,
+    [&](const auto* data, std::size_t stride)
+    { mesh = extractIsosurfaceFromBuffer(data, stride, *tree, value, subject_T_pixel); }
+  );
+
+  if (!valid)
+  {
+    spdlog::error(
+      "Invalid component type '{}' when extracting isosurface",
+      componentTypeString(image.header().memoryComponentType())
+    );
+    return std::nullopt;
+  }
+
+  return mesh;
+}
@@ -0,0 +1,45 @@
+#ifndef MARCHING_CUBES_H
+#define MARCHING_CUBES_H
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+class Image;
+
+/**
+ * @brief Indexed triangle mesh of an isosurface, in the Subject space of its image
+ */
+struct IsosurfaceMesh
+{
+  std::vector<glm::vec3> m_positions; //!< Vertex positions
+  std::vector<glm::vec3> m_normals;   //!< Vertex normals, which point towards lower image values
+  std::vector<uint32_t> m_indices;    //!< Vertex indices, three per triangle
+
+  std::size_t m_numActiveBlocks = 0; //!< Number of blocks of the image visited by marching cubes
+};
+
+/**
+ * @brief Extract an isosurface of an image component using marching cubes.
+ *
+ * Only the blocks of the component's min-max block tree that the isosurface passes through are
+ * visited, and they are processed in parallel. Triangles share the vertices on common cell edges,
+ * including across blocks. Faces of cells with ambiguous corner configurations are resolved the
+ * same way in both cells that share them, so the mesh has no cracks. Normals are interpolated from
+ * the image gradient at the voxels.
+ *
+ * @param[in] image Image
+ * @param[in] component Image component
+ * @param[in] isoValue Isovalue, in image intensity units. Voxels with values at or above the
+ * isovalue are inside of the surface.
+ *
+ * @return Mesh, or std::nullopt if the surface could not be extracted
+ */
+std::optional<IsosurfaceMesh> extractIsosurface(
+  const Image& image, uint32_t component, double isoValue
+);
+
+#endif // MARCHING_CUBES_H
@@ -0,0 +1,684 @@
+#include "mesh/MeshDecimation.h"
+
+#include "common/ParallelFor.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+namespace
+{
+/// Minimum number of vertices, edges, or collapses processed by a thread
+constexpr std::size_t sk_minElementsPerChunk = 4096;
+
+/// Weight of the quadrics of boundary edges, relative to the quadrics of triangles
+constexpr double sk_boundaryWeight = 100.0;
+
+/// Minimum cosine of the angle between the normals of a triangle before and after a collapse
+constexpr double sk_minNormalCosine = 0.2;
+
+/// At most this fraction (one over the value) of the edges are candidates in a round
+constexpr std::size_t sk_candidateFraction = 4;
+
+/// Maximum number of passes of selection of the collapses of a round
+constexpr std::size_t sk_maxSelectionPasses = 8;
+
+/// Marks removed triangles
+constexpr uint32_t sk_removed = std::numeric_limits<uint32_t>::max();
+
+/// Validation status of a candidate collapse
+constexpr uint8_t sk_unknown = 0;
+constexpr uint8_t sk_valid = 1;
+constexpr uint8_t sk_invalid = 2;
+
+using Triangle = std::array<uint32_t, 3>;
+
+/// Symmetric 4x4 quadric matrix of squared distances to planes, stored as its upper triangle
+struct Quadric
+{
+  std::array<double, 10> m_q{}; //!< Rows of the upper triangle: [0 1 2 3], [4 5 6], [7 8], [9]
+
+  /// Add the quadric of the plane dot(n, x) + d = 0, with unit normal n, times a weight
+  void addPlane(const glm::dvec3& n, double d, double weight)
+  {
+    const std::array<double, 4> p{n.x, n.y, n.z, d};
+    std::size_t k = 0;
+
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      for (std::size_t j = i; j < 4; ++j)
+      {
+        m_q[k++] += weight * p[i] * p[j];
+      }
+    }
+  }
+
+  Quadric& operator+=(const Quadric& other)
+  {
+    for (std::size_t k = 0; k < m_q.size(); ++k)
+    {
+      m_q[k] += other.m_q[k];
+    }
+    return *this;
+  }
+
+  /// Weighted sum of squared distances from a point to the planes
+  double error(const glm::dvec3& v) const
+  {
+    const auto& q = m_q;
+    return q[0] * v.x * v.x + q[4] * v.y * v.y + q[7] * v.z * v.z + q[9]
+           + 2.0 * (q[1] * v.x * v.y + q[2] * v.x * v.z + q[5] * v.y * v.z)
+           + 2.0 * (q[3] * v.x + q[6] * v.y + q[8] * v.z);
+  }
+
+  /// Point of minimum error, or none if the planes do not constrain it to a single point
+  std::optional<glm::dvec3> minimizer() const
+  {
+    const auto& q = m_q;
+    const glm::dmat3 A(q[0], q[1], q[2], q[1], q[4], q[5], q[2], q[5], q[7]);
+    const double scale = q[0] + q[4] + q[7];
+    const double det = glm::determinant(A);
+
+    if (scale <= 0.0 || std::abs(det) <= 1.0e-9 * scale * scale * scale)
+    {
+      return std::nullopt;
+    }
+
+    return glm::inverse(A) * glm::dvec3(-q[3], -q[6], -q[8]);
+  }
+};
+
+/// Candidate edge collapse, which moves vertex m_v0 to m_position and removes vertex m_v1
+struct Collapse
+{
+  float m_cost;         //!< Quadric error of the collapse
+  uint32_t m_v0;        //!< Kept vertex
+  uint32_t m_v1;        //!< Removed vertex
+  glm::vec3 m_position; //!< Position of the kept vertex after the collapse
+};
+
+/// Triangles incident to each vertex, in compressed rows
+struct VertexTriangles
+{
+  VertexTriangles(std::size_t numVertices, const std::vector<Triangle>& triangles)
+    : m_offsets(numVertices + 1, 0)
+    , m_triangles(3 * triangles.size())
+  {
+    for (const Triangle& tri : triangles)
+    {
+      for (uint32_t v : tri)
+      {
+        ++m_offsets[v + 1];
+      }
+    }
+
+    for (std::size_t v = 0; v < numVertices; ++v)
+    {
+      m_offsets[v + 1] += m_offsets[v];
+    }
+
+    std::vector<std::size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+
+    for (std::size_t t = 0; t < triangles.size(); ++t)
+    {
+      for (uint32_t v : triangles[t])
+      {
+        m_triangles[next[v]++] = static_cast<uint32_t>(t);
+      }
+    }
+  }
+
+  const uint32_t* begin(uint32_t v) const { return m_triangles.data() + m_offsets[v]; }
+  const uint32_t* end(uint32_t v) const { return m_triangles.data() + m_offsets[v + 1]; }
+
+  std::vector<std::size_t> m_offsets; //!< Offset of the first triangle of each vertex
+  std::vector<uint32_t> m_triangles;  //!< Triangle indices
+};
+
+/// Sorted neighbors of a vertex, with one entry per triangle that joins the vertex to a neighbor,
+/// so that the number of repeats of a neighbor is the number of triangles of their edge
+void gatherRing(
+  uint32_t v,
+  const VertexTriangles& vertexTris,
+  const std::vector<Triangle>& triangles,
+  std::vector<uint32_t>& ring
+)
+{
+  ring.clear();
+
+  for (const uint32_t* t = vertexTris.begin(v); t != vertexTris.end(v); ++t)
+  {
+    for (uint32_t u : triangles[*t])
+    {
+      if (u != v)
+      {
+        ring.push_back(u);
+      }
+    }
+  }
+
+  std::sort(ring.begin(), ring.end());
+}
+
+/// Number of triangles of the edge from the vertex of a ring to a neighbor
+std::size_t edgeTriangleCount(const std::vector<uint32_t>& ring, uint32_t neighbor)
+{
+  const auto range = std::equal_range(ring.begin(), ring.end(), neighbor);
+  return static_cast<std::size_t>(range.second - range.first);
+}
+
+glm::dvec3 triangleCross(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2)
+{
+  return glm::cross(p1 - p0, p2 - p0);
+}
+
+/// Quadric of each vertex, from the planes of its triangles and boundary edges
+std::vector<Quadric> computeQuadrics(
+  const std::vector<glm::dvec3>& positions,
+  const std::vector<Triangle>& triangles,
+  const VertexTriangles& vertexTris
+)
+{
+  std::vector<Quadric> quadrics(positions.size());
+
+  parallel::forEachChunk(
+    positions.size(),
+    sk_minElementsPerChunk,
+    [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+    {
+      std::vector<uint32_t> ring;
+
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        const uint32_t v = static_cast<uint32_t>(i);
+        gatherRing(v, vertexTris, triangles, ring);
+
+        for (const uint32_t* t = vertexTris.begin(v); t != vertexTris.end(v); ++t)
+        {
+          const Triangle& tri = triangles[*t];
+          const glm::dvec3 cross
+            = triangleCross(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+          const double length = glm::length(cross);
+
+          if (0.0 == length)
+          {
+            continue;
+          }
+
+          const glm::dvec3 n = cross / length;
+          const glm::dvec3& p = positions[v];
+          quadrics[v].addPlane(n, -glm::dot(n, p), 0.5 * length);
+
+          // Constrain the vertex to planes that are perpendicular to the triangle through its
+          // boundary edges, so that boundaries are kept
+          for (uint32_t u : tri)
+          {
+            if (u == v || 1 != edgeTriangleCount(ring, u))
+            {
+              continue;
+            }
+
+            const glm::dvec3 edge = positions[u] - p;
+            const glm::dvec3 m = glm::cross(edge, n);
+            const double mLength = glm::length(m);
+
+            if (mLength > 0.0)
+            {
+              quadrics[v].addPlane(
+                m / mLength, -glm::dot(m / mLength, p), sk_boundaryWeight * glm::dot(edge, edge)
+              );
+            }
+          }
+        }
+      }
+    }
+  );
+
+  return quadrics;
+}
+
+/// Collapse of an edge to the point of least error: the minimizer of the quadric, if it is near
+/// the edge, or else the best of the endpoints and midpoint
+Collapse makeCollapse(
+  uint32_t v0,
+  uint32_t v1,
+  const std::vector<glm::dvec3>& positions,
+  const std::vector<Quadric>& quadrics
+)
+{
+  Quadric q = quadrics[v0];
+  q += quadrics[v1];
+
+  const glm::dvec3& p0 = positions[v0];
+  const glm::dvec3& p1 = positions[v1];
+  const glm::dvec3 mid = 0.5 * (p0 + p1);
+
+  glm::dvec3 best = mid;
+  double bestError = q.error(mid);
+
+  if (const auto v = q.minimizer(); v && glm::distance(*v, mid) <= glm::distance(p0, p1))
+  {
+    best = *v;
+    bestError = q.error(*v);
+  }
+  else
+  {
+    for (const glm::dvec3& p : {p0, p1})
+    {
+      if (const double e = q.error(p); e < bestError)
+      {
+        best = p;
+        bestError = e;
+      }
+    }
+  }
+
+  return Collapse{static_cast<float>(std::max(bestError, 0.0)), v0, v1, glm::vec3(best)};
+}
+
+/// Whether a collapse keeps the mesh manifold, keeps boundaries, and flips no triangles
+bool isCollapseValid(
+  const Collapse& collapse,
+  const std::vector<glm::dvec3>& positions,
+  const std::vector<Triangle>& triangles,
+  const VertexTriangles& vertexTris,
+  const std::vector<uint8_t>& boundary,
+  std::vector<uint32_t>& ring0,
+  std::vector<uint32_t>& ring1
+)
+{
+  const uint32_t v0 = collapse.m_v0;
+  const uint32_t v1 = collapse.m_v1;
+
+  gatherRing(v0, vertexTris, triangles, ring0);
+  gatherRing(v1, vertexTris, triangles, ring1);
+
+  // Interior edges that join two boundary vertices would pinch the surface
+  const std::size_t numEdgeTriangles = edgeTriangleCount(ring0, v1);
+
+  if (boundary[v0] && boundary[v1] && 1 != numEdgeTriangles)
+  {
+    return false;
+  }
+
+  // Link condition: the only common neighbors of the vertices are opposite to their edge
+  ring0.erase(std::unique(ring0.begin(), ring0.end()), ring0.end());
+  ring1.erase(std::unique(ring1.begin(), ring1.end()), ring1.end());
+
+  std::size_t numCommon = 0;
+  auto it0 = ring0.begin();
+  auto it1 = ring1.begin();
+
+  while (it0 != ring0.end() && it1 != ring1.end())
+  {
+    if (*it0 < *it1)
+    {
+      ++it0;
+    }
+    else if (*it1 < *it0)
+    {
+      ++it1;
+    }
+    else
+    {
+      ++numCommon;
+      ++it0;
+      ++it1;
+    }
+  }
+
+  if (numCommon != numEdgeTriangles)
+  {
+    return false;
+  }
+
+  // Collapsing a tetrahedron would leave two coincident triangles
+  if (ring0.size() + ring1.size() - numCommon < 5)
+  {
+    return false;
+  }
+
+  const glm::dvec3 position(collapse.m_position);
+
+  for (uint32_t v : {v0, v1})
+  {
+    for (const uint32_t* t = vertexTris.begin(v); t != vertexTris.end(v); ++t)
+    {
+      const Triangle& tri = triangles[*t];
+
+      if (std::find(tri.begin(), tri.end(), v0 == v ? v1 : v0) != tri.end())
+      {
+        continue; // Removed by the collapse
+      }
+
+      std::array<glm::dvec3, 3> p;
+      for (std::size_t k = 0; k < 3; ++k)
+      {
+        p[k] = (tri[k] == v) ? position : positions[tri[k]];
+      }
+
+      const glm::dvec3 oldCross
+        = triangleCross(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+      const glm::dvec3 newCross = triangleCross(p[0], p[1], p[2]);
+      const double oldLength = glm::length(oldCross);
+      const double newLength = glm::length(newCross);
+
+      if (0.0 == newLength)
+      {
+        return false;
+      }
+
+      if (oldLength > 0.0
+          && glm::dot(oldCross, newCross) < sk_minNormalCosine * oldLength * newLength)
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/// Candidate collapses of all edges, and whether each vertex is on a boundary or non-manifold edge
+std::vector<Collapse> computeCollapses(
+  const std::vector<glm::dvec3>& positions,
+  const std::vector<Quadric>& quadrics,
+  const std::vector<Triangle>& triangles,
+  const VertexTriangles& vertexTris,
+  std::vector<uint8_t>& boundary
+)
+{
+  const std::size_t numChunks = parallel::numChunks(positions.size(), sk_minElementsPerChunk);
+  std::vector<std::vector<Collapse> > chunkCollapses(numChunks);
+
+  parallel::forEachChunk(
+    positions.size(),
+    sk_minElementsPerChunk,
+    [&](std::size_t chunk, std::size_t begin, std::size_t end)
+    {
+      std::vector<uint32_t> ring;
+      std::vector<Collapse>& collapses = chunkCollapses[chunk];
+
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        const uint32_t v = static_cast<uint32_t>(i);
+        gatherRing(v, vertexTris, triangles, ring);
+        boundary[v] = 0;
+
+        for (std::size_t k = 0; k < ring.size();)
+        {
+          const uint32_t u = ring[k];
+          std::size_t count = 0;
+
+          for (; k < ring.size() && ring[k] == u; ++k)
+          {
+            ++count;
+          }
+
+          if (2 != count)
+          {
+            boundary[v] = 1;
+          }
+
+          // Each edge is visited from its lower vertex. Non-manifold edges are not collapsed.
+          if (u > v && count <= 2)
+          {
+            collapses.push_back(makeCollapse(v, u, positions, quadrics));
+          }
+        }
+      }
+    }
+  );
+
+  std::size_t numCollapses = 0;
+  for (const auto& collapses : chunkCollapses)
+  {
+    numCollapses += collapses.size();
+  }
+
+  std::vector<Collapse> collapses;
+  collapses.reserve(numCollapses);
+
+  for (const auto& chunk : chunkCollapses)
+  {
+    collapses.insert(collapses.end(), chunk.begin(), chunk.end());
+  }
+
+  return collapses;
+}
+
+} // namespace
+
+IsosurfaceMesh decimateMesh(const IsosurfaceMesh& mesh, std::size_t targetTriangles)
+{
+  const std::size_t numVertices = mesh.m_positions.size();
+
+  std::vector<glm::dvec3> positions(mesh.m_positions.begin(), mesh.m_positions.end());
+  std::vector<glm::vec3> normals = mesh.m_normals;
+  normals.resize(numVertices, glm::vec3{0.0f});
+
+  std::vector<Triangle> triangles(mesh.m_indices.size() / 3);
+
+  for (std::size_t t = 0; t < triangles.size(); ++t)
+  {
+    triangles[t] = {mesh.m_indices[3 * t], mesh.m_indices[3 * t + 1], mesh.m_indices[3 * t + 2]};
+  }
+
+  std::vector<Quadric> quadrics;
+  std::vector<uint8_t> boundary(numVertices, 0);
+  std::vector<uint8_t> locked(numVertices, 0);
+  bool allCandidates = false;
+
+  while (triangles.size() > targetTriangles)
+  {
+    const VertexTriangles vertexTris(numVertices, triangles);
+
+    if (quadrics.empty())
+    {
+      quadrics = computeQuadrics(positions, triangles, vertexTris);
+    }
+
+    std::vector<Collapse> collapses
+      = computeCollapses(positions, quadrics, triangles, vertexTris, boundary);
+
+    if (collapses.empty())
+    {
+      break;
+    }
+
+    // Each collapse of an interior edge removes two triangles. Only the cheapest edges are
+    // candidates, so that collapses approximately follow the order of their costs.
+    const std::size_t numNeeded = (triangles.size() - targetTriangles + 1) / 2;
+    std::size_t numCandidates = collapses.size();
+
+    if (!allCandidates)
+    {
+      numCandidates = std::clamp(
+        std::min(4 * numNeeded, collapses.size() / sk_candidateFraction),
+        std::size_t{1},
+        collapses.size()
+      );
+    }
+
+    auto byCost = [](const Collapse& a, const Collapse& b) { return a.m_cost < b.m_cost; };
+    std::nth_element(
+      collapses.begin(), collapses.begin() + (numCandidates - 1), collapses.end(), byCost
+    );
+    collapses.resize(numCandidates);
+    std::sort(collapses.begin(), collapses.end(), byCost);
+
+    // Select the cheapest collapses whose neighborhoods are disjoint, then validate the selected
+    // collapses concurrently. Collapses only change the triangles of their vertices, so valid
+    // collapses stay valid and can be applied concurrently. Selection is repeated without the
+    // invalid collapses, which would otherwise block their neighborhoods, until none are found.
+    std::vector<uint8_t> status(collapses.size(), sk_unknown);
+    std::vector<std::size_t> selected;
+    bool foundInvalid = true;
+
+    for (std::size_t pass = 0; foundInvalid && pass < sk_maxSelectionPasses; ++pass)
+    {
+      std::fill(locked.begin(), locked.end(), 0);
+      selected.clear();
+
+      for (std::size_t i = 0; i < collapses.size() && selected.size() < numNeeded; ++i)
+      {
+        const Collapse& collapse = collapses[i];
+
+        if (sk_invalid == status[i] || locked[collapse.m_v0] || locked[collapse.m_v1])
+        {
+          continue;
+        }
+
+        selected.push_back(i);
+
+        for (uint32_t v : {collapse.m_v0, collapse.m_v1})
+        {
+          for (const uint32_t* t = vertexTris.begin(v); t != vertexTris.end(v); ++t)
+          {
+            for (uint32_t u : triangles[*t])
+            {
+              locked[u] = 1;
+            }
+          }
+        }
+      }
+
+      parallel::forEachChunk(
+        selected.size(),
+        sk_minElementsPerChunk,
+        [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+        {
+          std::vector<uint32_t> ring0;
+          std::vector<uint32_t> ring1;
+
+          for (std::size_t k = begin; k < end; ++k)
+          {
+            const std::size_t i = selected[k];
+
+            if (sk_unknown == status[i])
+            {
+              const bool valid = isCollapseValid(
+                collapses[i], positions, triangles, vertexTris, boundary, ring0, ring1
+              );
+              status[i] = valid ? sk_valid : sk_invalid;
+            }
+          }
+        }
+      );
+
+      foundInvalid = std::any_of(
+        selected.begin(),
+        selected.end(),
+        [&status](std::size_t i) { return sk_invalid == status[i]; }
+      );
+    }
+
+    selected.erase(
+      std::remove_if(
+        selected.begin(),
+        selected.end(),
+        [&status](std::size_t i) { return sk_valid != status[i]; }
+      ),
+      selected.end()
+    );
+
+    if (selected.empty())
+    {
+      if (allCandidates)
+      {
+        break; // No edge can be collapsed
+      }
+
+      allCandidates = true;
+      continue;
+    }
+
+    allCandidates = false;
+
+    parallel::forEachChunk(
+      selected.size(),
+      sk_minElementsPerChunk,
+      [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+      {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+          const Collapse& collapse = collapses[selected[i]];
+          const uint32_t v0 = collapse.m_v0;
+          const uint32_t v1 = collapse.m_v1;
+
+          positions[v0] = glm::dvec3(collapse.m_position);
+          quadrics[v0] += quadrics[v1];
+
+          if (const glm::vec3 n = normals[v0] + normals[v1]; glm::length(n) > 0.0f)
+          {
+            normals[v0] = glm::normalize(n);
+          }
+
+          for (const uint32_t* t = vertexTris.begin(v1); t != vertexTris.end(v1); ++t)
+          {
+            Triangle& tri = triangles[*t];
+
+            if (std::find(tri.begin(), tri.end(), v0) != tri.end())
+            {
+              tri[0] = sk_removed;
+            }
+            else
+            {
+              std::replace(tri.begin(), tri.end(), v1, v0);
+            }
+          }
+        }
+      }
+    );
+
+    triangles.erase(
+      std::remove_if(
+        triangles.begin(),
+        triangles.end(),
+        [](const Triangle& tri) { return sk_removed == tri[0]; }
+      ),
+      triangles.end()
+    );
+  }
+
+  // Keep the used vertices, in their original order
+  std::vector<uint32_t> newIndices(numVertices, sk_removed);
+
+  for (const Triangle& tri : triangles)
+  {
+    for (uint32_t v : tri)
+    {
+      newIndices[v] = 0;
+    }
+  }
+
+  IsosurfaceMesh decimated;
+  decimated.m_numActiveBlocks = mesh.m_numActiveBlocks;
+
+  for (std::size_t v = 0; v < numVertices; ++v)
+  {
+    if (sk_removed != newIndices[v])
+    {
+      newIndices[v] = static_cast<uint32_t>(decimated.m_positions.size());
+      decimated.m_positions.emplace_back(positions[v]);
+      decimated.m_normals.push_back(normals[v]);
+    }
+  }
+
+  decimated.m_indices.reserve(3 * triangles.size());
+
+  for (const Triangle& tri : triangles)
+  {
+    for (uint32_t v : tri)
+    {
+      decimated.m_indices.push_back(newIndices[v]);
+    }
+  }
+
+  return decimated;
+}
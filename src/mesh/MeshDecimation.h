@@ -0,0 +1,28 @@
+#ifndef MESH_DECIMATION_H
+#define MESH_DECIMATION_H
+
+#include "mesh/MarchingCubes.h"
+
+#include <cstddef>
+
+/**
+ * @brief Simplify a triangle mesh by collapsing edges in order of their quadric error, until it
+ * has at most a target number of triangles.
+ *
+ * Each vertex accumulates the quadrics of the planes of its triangles, weighted by area, and of
+ * planes through the boundary edges that are perpendicular to their triangles. Edges collapse to
+ * the position that minimizes the sum of the quadrics of their vertices. Collapses proceed in
+ * rounds: in each round, the costs of all edges are computed in parallel, and the cheapest edges
+ * whose neighborhoods do not overlap are collapsed in parallel. Collapses that would flip a
+ * triangle, make the mesh non-manifold, or pinch a boundary are skipped.
+ *
+ * @param[in] mesh Mesh, whose triangles are consistently oriented
+ * @param[in] targetTriangles Maximum number of triangles of the simplified mesh. Fewer collapses
+ * may be possible, in which case the mesh has more triangles.
+ *
+ * @return Simplified mesh, without unused vertices. The normal of each collapsed vertex is the
+ * normalized sum of the normals of the two vertices.
+ */
+IsosurfaceMesh decimateMesh(const IsosurfaceMesh& mesh, std::size_t targetTriangles);
+
+#endif // MESH_DECIMATION_H
@@ -1,158 +1,219 @@
 #include "mesh/MeshLoading.h"
+#include "mesh/MarchingCubes.h"
 #include "mesh/MeshCpuRecord.h"
+#include "mesh/MeshDecimation.h"
+#include "mesh/SurfaceNets.h"
 #include "mesh/vtkdetails/MeshGeneration.hpp"
 
-#include "common/MathFuncs.h"
+#include "common/ParcellationLabelTable.h"
+#include "common/TaskScheduler.h"
 #include "common/UuidUtility.h"
 
 #include "image/Image.h"
-#include "image/ImageHeader.h"
-#include "image/ImageUtility.tpp"
 
-#include "rendering/utility/CreateGLObjects.h"
-
-#include <glm/glm.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-#include <vnl/vnl_matrix_fixed.h>
-
-#include <vtkImageData.h>
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkSmartPointer.h>
 
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
-#include <limits>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <optional>
 #include <utility>
+#include <vector>
 
 namespace
 {
 
+/// Calls a function when it goes out of scope. Mesh generation tasks queue themselves for the
+/// render thread with it, so that their results are collected however the tasks end.
+class ScopeGuard
+{
+public:
+  explicit ScopeGuard(std::function<void()> onExit)
+    : m_onExit(std::move(onExit))
+  {
+  }
+
+  ~ScopeGuard()
+  {
+    if (m_onExit)
+    {
+      m_onExit();
+    }
+  }
+
+  ScopeGuard(const ScopeGuard&) = delete;
+  ScopeGuard& operator=(const ScopeGuard&) = delete;
+
+private:
+  std::function<void()> m_onExit; //!< Function called on exit
+};
+
+/// Create a CPU mesh record from an indexed triangle mesh
+std::unique_ptr<MeshCpuRecord> makeMeshCpuRecord(const IsosurfaceMesh& mesh, MeshInfo meshInfo)
+{
+  const vtkIdType numVertices = static_cast<vtkIdType>(mesh.m_positions.size());
+  const vtkIdType numTriangles = static_cast<vtkIdType>(mesh.m_indices.size() / 3);
+
+  vtkNew<vtkFloatArray> positions;
+  positions->SetNumberOfComponents(3);
+  positions->SetNumberOfTuples(numVertices);
+  std::memcpy(positions->GetPointer(0), mesh.m_positions.data(), 3 * numVertices * sizeof(float));
+
+  vtkNew<vtkFloatArray> normals;
+  normals->SetName("Normals");
+  normals->SetNumberOfComponents(3);
+  normals->SetNumberOfTuples(numVertices);
+  std::memcpy(normals->GetPointer(0), mesh.m_normals.data(), 3 * numVertices * sizeof(float));
+
+  vtkNew<vtkIdTypeArray> offsets;
+  offsets->SetNumberOfValues(numTriangles + 1);
+
+  for (vtkIdType i = 0; i <= numTriangles; ++i)
+  {
+    offsets->SetValue(i, 3 * i);
+  }
+
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(3 * numTriangles);
+
+  for (vtkIdType i = 0; i < 3 * numTriangles; ++i)
+  {
+    connectivity->SetValue(i, static_cast<vtkIdType>(mesh.m_indices[i]));
+  }
+
+  vtkNew<vtkPoints> points;
+  points->SetData(positions);
+
+  vtkNew<vtkCellArray> triangles;
+  triangles->SetData(offsets, connectivity);
+
+  vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+  polyData->SetPoints(points);
+  polyData->SetPolys(triangles);
+  polyData->GetPointData()->SetNormals(normals);
+
+  return std::make_unique<MeshCpuRecord>(polyData, std::move(meshInfo));
+}
+
 std::unique_ptr<MeshCpuRecord> _generateIsosurfaceMeshCpuRecord(
-  vtkImageData* imageData, const ImageHeader& imageHeader, double isoValue
+  const Image& image, uint32_t component, double isoValue, std::size_t maxTriangles
 )
 {
   // Note: triangle strips offer no speed advantage over indexed triangles on modern hardware
   static const MeshPrimitiveType sk_primitiveType = MeshPrimitiveType::Triangles;
 
-  if (!imageData)
+  const MeshInfo info(MeshSource::IsoSurface, sk_primitiveType, isoValue);
+
+  try
   {
-    spdlog::error("Error generating iso-surface mesh: Image data is null.");
-    return nullptr;
-  }
+    std::optional<IsosurfaceMesh> mesh = extractIsosurface(image, component, isoValue);
 
-  const vnl_matrix_fixed<double, 3, 3> imageDirections = math::convert::toVnlMatrixFixed(
-    glm::dmat3{imageHeader.directions()}
-  );
+    if (!mesh)
+    {
+      spdlog::error("Error generating iso-surface mesh: marching cubes failed.");
+      return nullptr;
+    }
 
-  vtkSmartPointer<vtkPolyData> polyData = nullptr;
+    if (mesh->m_indices.size() / 3 > maxTriangles)
+    {
+      spdlog::debug(
+        "Decimating iso-surface mesh from {} to {} triangles",
+        mesh->m_indices.size() / 3,
+        maxTriangles
+      );
+      mesh = decimateMesh(*mesh, maxTriangles);
+    }
 
-  try
-  {
-    polyData
-      = ::vtkdetails::generateIsoSurfaceMesh(imageData, imageDirections, isoValue, sk_primitiveType);
+    return makeMeshCpuRecord(*mesh, info);
   }
   catch (const std::exception& e)
   {
     spdlog::error("Error generating iso-surface mesh: {}", e.what());
-    return nullptr;
   }
   catch (...)
   {
     spdlog::error("Error generating iso-surface mesh");
-    return nullptr;
   }
 
-  if (!polyData)
-  {
-    spdlog::error("Error generating iso-surface mesh: vtkPolyData is null.");
-    return nullptr;
-  }
-
-  return std::make_unique<
-    MeshCpuRecord>(polyData, MeshInfo(MeshSource::IsoSurface, sk_primitiveType, isoValue));
+  return nullptr;
 }
 
-/*
-std::unique_ptr<MeshCpuRecord> generateLabelMesh(
-    vtkImageData* imageData,
-    const ImageHeader& imageHeader,
-    uint32_t labelIndex )
+std::optional<LabelMeshCpuRecords> _generateLabelMeshCpuRecords(
+  const Image& seg, const std::vector<LabelType>& labels, int smoothingIterations
+)
 {
-    // Note: triangle strips offer no speed advantage over indexed triangles on modern hardware
-    static const MeshPrimitiveType sk_primitiveType = MeshPrimitiveType::Triangles;
-
-    // Parcellation image must have exactly one scalar component
-    if ( 1 != imageHeader.numComponentsPerPixel() ||
-        PixelType::Scalar != imageHeader.pixelType() )
-    {
-        spdlog::error( "Error computing mesh at label index {}: "
-                      "Pixel type must be single-component scalar.", labelIndex );
-        return nullptr;
-    }
+  static const MeshPrimitiveType sk_primitiveType = MeshPrimitiveType::Triangles;
 
-    // Parcellation pixels are indices that must be of unsigned integer type
-    if ( ! isUnsignedIntegerType( imageHeader.memoryComponentType() ) )
-    {
-        spdlog::error( "Error computing mesh at label index {}: "
-                      "Parcellation component type must be unsigned integral.", labelIndex );
-        return nullptr;
-    }
+  std::optional<std::map<LabelType, IsosurfaceMesh> > meshes;
 
-    if ( ! imageData )
-    {
-        spdlog::error( "Parcellation image data is null" );
-        return nullptr;
-    }
+  try
+  {
+    meshes = extractLabelSurfaces(seg, labels, smoothingIterations);
+  }
+  catch (const std::exception& e)
+  {
+    spdlog::error("Error generating label meshes: {}", e.what());
+    return std::nullopt;
+  }
+  catch (...)
+  {
+    spdlog::error("Error generating label meshes");
+    return std::nullopt;
+  }
 
-    const vnl_matrix_fixed< double, 3, 3 > imageDirections =
-        math::convert::toVnlMatrixFixed( glm::dmat3{ imageHeader.directions() } );
+  if (!meshes)
+  {
+    spdlog::error("Error generating label meshes: surface nets failed.");
+    return std::nullopt;
+  }
 
-    try
-    {
-        auto polyData = ::vtkdetails::generateLabelMesh(
-            imageData, imageDirections, labelIndex, sk_primitiveType );
+  LabelMeshCpuRecords records;
 
-        if ( ! polyData )
-        {
-            spdlog::error( "Error computing mesh at label index {} ", labelIndex );
-            return nullptr;
-        }
+  for (const auto& [label, mesh] : *meshes)
+  {
+    const MeshInfo info(MeshSource::Label, sk_primitiveType, static_cast<uint32_t>(label));
+    records.emplace(label, makeMeshCpuRecord(mesh, info));
+  }
 
-        return std::make_unique<MeshCpuRecord>(
-            polyData, MeshInfo( MeshSource::Label, sk_primitiveType, labelIndex ) );
-    }
-    catch ( const std::exception& e )
-    {
-        spdlog::error( "Error generating label mesh at index {}: {}", labelIndex, e.what() );
-        return nullptr;
-    }
-    catch ( ... )
-    {
-        spdlog::error( "Error generating label mesh at index {}", labelIndex);
-        return nullptr;
-    }
+  return records;
 }
-*/
 
 } // namespace
 
 std::future<AsyncTaskDetails> generateIsosurfaceMeshCpuRecord(
+  TaskScheduler& scheduler,
   const Image& image,
   const uuids::uuid& imageUid,
   uint32_t component,
   double isoValue,
   const uuids::uuid& isosurfaceUid,
+  std::size_t maxTriangles,
   std::function<bool(const uuids::uuid& isosurfaceUid, std::unique_ptr<MeshCpuRecord>)>
     meshCpuRecordUpdater,
   std::function<void()> addTaskToIsosurfaceGpuMeshGenerationQueue
 )
 {
-  // Lambda to generate the CPU mesh record using VTK's marching cubes.
+  // Images are never removed, so the image outlives the task. It is captured by pointer, since
+  // capturing the reference by value would copy the whole image for each regeneration.
+  const Image* imagePtr = &image;
+
+  // Lambda to generate the CPU mesh record using marching cubes and decimation.
   // Need to capture by value, since the function is executed asynchronously.
   auto generateMesh =
-    [=](const std::function<void(bool success, std::unique_ptr<MeshCpuRecord>)>& onGenerateDone)
+    [=](
+      const TaskToken& token,
+      const std::function<void(bool success, std::unique_ptr<MeshCpuRecord>)>& onGenerateDone
+    )
   {
     spdlog::info(
       "Start generating mesh for isosurface {} at value {} of image {}",
@@ -169,19 +230,14 @@ std::future<AsyncTaskDetails> generateIsosurfaceMeshCpuRecord(
     retval.objectUid = isosurfaceUid;
     retval.success = false;
 
-    // Cast image component to float prior to mesh generation
-    using ImageCompType = float;
-    const auto itkImage = createItkImageFromImageComponent<ImageCompType>(image, component);
-    const auto vtkImageData = convertItkImageToVtkImageData<ImageCompType>(itkImage);
-
-    if (!vtkImageData)
+    if (token.isCancelled())
     {
-      spdlog::error("Image {} has null vtkImageData when generating isosurface", imageUid);
-      onGenerateDone(false, nullptr);
       return retval;
     }
 
-    auto cpuRecord = _generateIsosurfaceMeshCpuRecord(vtkImageData.Get(), image.header(), isoValue);
+    const auto start = std::chrono::steady_clock::now();
+
+    auto cpuRecord = _generateIsosurfaceMeshCpuRecord(*imagePtr, component, isoValue, maxTriangles);
 
     if (!cpuRecord)
     {
@@ -190,8 +246,14 @@ std::future<AsyncTaskDetails> generateIsosurfaceMeshCpuRecord(
       return retval;
     }
 
+    const auto end = std::chrono::steady_clock::now();
+
     spdlog::info(
-      "Done generating mesh for isosurface {} at value {} of image", isosurfaceUid, isoValue, imageUid
+      "Done generating mesh for isosurface {} at value {} of image {} in {} ms",
+      isosurfaceUid,
+      isoValue,
+      imageUid,
+      std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
     );
 
     onGenerateDone(true, std::move(cpuRecord));
@@ -209,20 +271,129 @@ std::future<AsyncTaskDetails> generateIsosurfaceMeshCpuRecord(
       return false;
     }
 
-    if (meshCpuRecordUpdater(isosurfaceUid, std::move(cpuMeshRecord)))
+    if (!meshCpuRecordUpdater(isosurfaceUid, std::move(cpuMeshRecord)))
     {
-      spdlog::debug("Updated mesh CPU record for isosurface {}", isosurfaceUid);
-      addTaskToIsosurfaceGpuMeshGenerationQueue();
-      return true;
+      spdlog::error("Error updating mesh CPU record for isosurface {}", isosurfaceUid);
+      return false;
     }
-    else
+
+    spdlog::debug("Updated mesh CPU record for isosurface {}", isosurfaceUid);
+    return true;
+  };
+
+  // The task is queued on every exit path, including cancellation and failure, so that the
+  // render thread always collects its result and the isosurface does not stay pending
+  return scheduler.submit(
+    AsyncTasks::IsosurfaceMeshGeneration,
+    [generateMesh, generateDone, addTaskToIsosurfaceGpuMeshGenerationQueue](const TaskToken& token)
     {
-      spdlog::error("Error updating mesh CPU record for isosurface {}", isosurfaceUid);
+      const ScopeGuard queueTask(addTaskToIsosurfaceGpuMeshGenerationQueue);
+      return generateMesh(token, generateDone);
+    }
+  );
+}
+
+std::future<AsyncTaskDetails> generateLabelMeshCpuRecords(
+  TaskScheduler& scheduler,
+  const Image& seg,
+  const uuids::uuid& segUid,
+  const ParcellationLabelTable& labelTable,
+  int smoothingIterations,
+  std::function<bool(const uuids::uuid& segUid, LabelMeshCpuRecords)> meshCpuRecordsUpdater,
+  std::function<void()> addTaskToLabelMeshQueue
+)
+{
+  // Labels whose meshes are shown. Label values index the label table.
+  std::vector<LabelType> labels;
+
+  for (std::size_t i = 1; i < labelTable.numLabels(); ++i)
+  {
+    if (labelTable.getShowMesh(i))
+    {
+      labels.push_back(static_cast<LabelType>(i));
+    }
+  }
+
+  // Segmentations change as they are edited and may be removed while the task runs, so the task
+  // meshes a copy of the segmentation
+  auto segCopy = std::make_shared<const Image>(seg);
+
+  auto generateMeshes =
+    [=](
+      const TaskToken& token,
+      const std::function<void(bool success, LabelMeshCpuRecords)>& onGenerateDone
+    )
+  {
+    spdlog::info("Start generating meshes of {} labels of segmentation {}", labels.size(), segUid);
+
+    AsyncTaskDetails retval;
+    retval.task = AsyncTasks::LabelMeshGeneration;
+    retval.description = std::string("Generate meshes of segmentation labels");
+    retval.imageUid = segUid;
+    retval.imageComponent = 0;
+    retval.success = false;
+
+    if (token.isCancelled())
+    {
+      return retval;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::optional<LabelMeshCpuRecords> cpuRecords
+      = _generateLabelMeshCpuRecords(*segCopy, labels, smoothingIterations);
+
+    if (!cpuRecords)
+    {
+      spdlog::error("Error generating label CPU mesh records for segmentation {}", segUid);
+      onGenerateDone(false, LabelMeshCpuRecords());
+      return retval;
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    spdlog::info(
+      "Done generating meshes of {} labels of segmentation {} in {} ms",
+      cpuRecords->size(),
+      segUid,
+      std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+    );
+
+    onGenerateDone(true, std::move(*cpuRecords));
+
+    retval.success = true;
+    return retval;
+  };
+
+  // Called when mesh generation is done
+  auto generateDone = [=](bool success, LabelMeshCpuRecords cpuMeshRecords)
+  {
+    if (!success)
+    {
+      spdlog::error("CPU mesh records for segmentation labels were not generated successfully");
       return false;
     }
+
+    if (!meshCpuRecordsUpdater(segUid, std::move(cpuMeshRecords)))
+    {
+      spdlog::error("Error updating label mesh CPU records for segmentation {}", segUid);
+      return false;
+    }
+
+    spdlog::debug("Updated label mesh CPU records for segmentation {}", segUid);
+    return true;
   };
 
-  return std::async(std::launch::async, generateMesh, generateDone);
+  // The task is queued on every exit path, including cancellation and failure, so that the
+  // render thread always collects its result and the segmentation does not stay pending
+  return scheduler.submit(
+    AsyncTasks::LabelMeshGeneration,
+    [generateMeshes, generateDone, addTaskToLabelMeshQueue](const TaskToken& token)
+    {
+      const ScopeGuard queueTask(addTaskToLabelMeshQueue);
+      return generateMeshes(token, generateDone);
+    }
+  );
 }
 
 bool writeMeshToFile(const MeshCpuRecord& record, const std::string& fileName)
@@ -2,26 +2,76 @@
 #define MESH_LOADER_H
 
 #include "common/AsyncTasks.h"
+#include "common/SegmentationTypes.h"
 #include "mesh/MeshCpuRecord.h"
 
+#include <cstddef>
 #include <functional>
 #include <future>
+#include <map>
 #include <memory>
 #include <string>
 
 class Image;
+class ParcellationLabelTable;
+class TaskScheduler;
 
+/// CPU mesh records of the labels of a segmentation, keyed by label. The records are shared, so
+/// that readers keep them alive while newer meshes replace them.
+using LabelMeshCpuRecords = std::map<LabelType, std::shared_ptr<const MeshCpuRecord> >;
+
+/**
+ * @brief Generate the mesh of an isosurface of an image component on the task scheduler. The
+ * marching cubes mesh is decimated by quadric edge collapses to the maximum number of triangles.
+ *
+ * @param scheduler Task scheduler
+ * @param image Image
+ * @param imageUid Image UID
+ * @param component Image component
+ * @param isoValue Isovalue, in image intensity units
+ * @param isosurfaceUid Isosurface UID
+ * @param maxTriangles Maximum number of triangles of the mesh
+ * @param meshCpuRecordUpdater Function that stores the record of the mesh
+ * @param addTaskToIsosurfaceGpuMeshGenerationQueue Function that queues the creation of the GPU
+ * record. It is called once the task runs, however the task ends.
+ */
 std::future<AsyncTaskDetails> generateIsosurfaceMeshCpuRecord(
+  TaskScheduler& scheduler,
   const Image& image,
   const uuids::uuid& imageUid,
   uint32_t component,
   double isoValue,
   const uuids::uuid& isosurfaceUid,
+  std::size_t maxTriangles,
   std::function<bool(const uuids::uuid& isosurfaceUid, std::unique_ptr<MeshCpuRecord>)>
     meshCpuRecordUpdater,
   std::function<void()> addTaskToIsosurfaceGpuMeshGenerationQueue
 );
 
+/**
+ * @brief Generate the meshes of the labels of a segmentation whose meshes are shown in the label
+ * table, in one pass of multi-label surface nets on the task scheduler. Adjacent labels share the
+ * vertices of their common boundary.
+ *
+ * @param scheduler Task scheduler
+ * @param seg Segmentation, which is copied so that it can change while the task runs
+ * @param segUid Segmentation UID
+ * @param labelTable Label table of the segmentation, whose \c getShowMesh flags select the labels
+ * @param smoothingIterations Number of iterations of smoothing of the mesh vertices
+ * @param meshCpuRecordsUpdater Function that stores the records of the labels with meshes
+ * @param addTaskToLabelMeshQueue Function that queues the finished task, whose result is
+ * collected on the render thread. It is called once the task runs, however the task ends.
+ */
+std::future<AsyncTaskDetails> generateLabelMeshCpuRecords(
+  TaskScheduler& scheduler,
+  const Image& seg,
+  const uuids::uuid& segUid,
+  const ParcellationLabelTable& labelTable,
+  int smoothingIterations,
+  std::function<bool(const uuids::uuid& segUid, LabelMeshCpuRecords)> meshCpuRecordsUpdater,
+  std::function<void()> addTaskToLabelMeshQueue
+);
+
 /// @todo Put this function here
 //std::map< int64_t, double >
 //generateImageHistogramAtLabelValues(
@@ -0,0 +1,625 @@
+#include "mesh/SurfaceNets.h"
+
+#include "common/ParallelFor.h"
+
+#include "image/Image.h"
+
+#include <glm/glm.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace
+{
+/// Minimum number of slices processed by a thread
+constexpr std::size_t sk_minSlicesPerChunk = 4;
+
+/// Marks cells without a vertex
+constexpr int32_t sk_noVertex = -1;
+
+/// Corners of the twelve edges of a cell. Corner c is at offset (c & 1, (c >> 1) & 1, (c >> 2) & 1)
+/// from the origin of the cell.
+constexpr std::array<std::array<int, 2>, 12> sk_edgeCorners{
+  {{{0, 1}},
+   {{2, 3}},
+   {{4, 5}},
+   {{6, 7}},
+   {{0, 2}},
+   {{1, 3}},
+   {{4, 6}},
+   {{5, 7}},
+   {{0, 4}},
+   {{1, 5}},
+   {{2, 6}},
+   {{3, 7}}}
+};
+
+glm::vec3 cornerOffset(int corner)
+{
+  return glm::vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+}
+
+/// Vertices of the cells of one slice. Cell (x, y, z) has the voxels [x - 1, x] x [y - 1, y] x
+/// [z - 1, z] as corners, so that cells also span the boundary of the segmentation.
+struct SliceVertices
+{
+  std::vector<uint32_t> m_cells;      //!< Indices (y * width + x) of the cells, in increasing order
+  std::vector<glm::vec3> m_positions; //!< Vertex positions, in Pixel space
+  uint32_t m_firstVertex = 0;         //!< Index in the mesh of the first vertex of the slice
+};
+
+/// Dense map from the cells of one slice to the indices of their vertices in the mesh
+struct SliceVertexMap
+{
+  explicit SliceVertexMap(std::size_t numCells)
+    : m_vertices(numCells, sk_noVertex)
+  {
+  }
+
+  /// Map the cells of a slice, which may be null, replacing the cells mapped before
+  void assign(const SliceVertices* slice)
+  {
+    if (m_slice)
+    {
+      for (uint32_t cell : m_slice->m_cells)
+      {
+        m_vertices[cell] = sk_noVertex;
+      }
+    }
+
+    m_slice = slice;
+
+    if (m_slice)
+    {
+      for (std::size_t i = 0; i < m_slice->m_cells.size(); ++i)
+      {
+        m_vertices[m_slice->m_cells[i]] = static_cast<int32_t>(m_slice->m_firstVertex + i);
+      }
+    }
+  }
+
+  const SliceVertices* m_slice = nullptr;
+  std::vector<int32_t> m_vertices;
+};
+
+/// Quad dual to the face shared by two voxels with different labels
+struct Quad
+{
+  /// Vertices of the four cells around the face, counter-clockwise around the axis that points
+  /// from the first voxel to the second
+  std::array<uint32_t, 4> m_vertices;
+
+  std::array<uint32_t, 2> m_labels; //!< Labels of the first and second voxels
+};
+
+template<typename S>
+std::optional<std::map<LabelType, IsosurfaceMesh> > extractLabelSurfacesFromBuffer(
+  const S* data,
+  const glm::ivec3& dims,
+  const std::vector<LabelType>& labels,
+  int smoothingIterations,
+  const glm::mat4& subject_T_pixel
+)
+{
+  std::map<LabelType, IsosurfaceMesh> meshes;
+
+  // Labels to mesh, which are non-zero values of the segmentation, and the index of each
+  std::vector<LabelType> meshedLabels;
+
+  for (LabelType label : labels)
+  {
+    if (0 < label && label <= static_cast<LabelType>(std::numeric_limits<S>::max()))
+    {
+      meshedLabels.push_back(label);
+    }
+  }
+
+  std::sort(std::begin(meshedLabels), std::end(meshedLabels));
+  meshedLabels.erase(
+    std::unique(std::begin(meshedLabels), std::end(meshedLabels)), std::end(meshedLabels)
+  );
+
+  if (meshedLabels.empty())
+  {
+    return meshes;
+  }
+
+  std::vector<int32_t> labelIndices(static_cast<std::size_t>(meshedLabels.back()) + 1, -1);
+
+  for (std::size_t i = 0; i < meshedLabels.size(); ++i)
+  {
+    labelIndices[static_cast<std::size_t>(meshedLabels[i])] = static_cast<int32_t>(i);
+  }
+
+  auto isMeshed = [&labelIndices](uint32_t label)
+  { return label < labelIndices.size() && 0 <= labelIndices[label]; };
+
+  const std::size_t voxelSliceSize = static_cast<std::size_t>(dims.x) * dims.y;
+
+  // Row of voxels, or null if it is outside of the segmentation
+  auto voxelRow = [&](int y, int z) -> const S*
+  {
+    if (y < 0 || dims.y <= y || z < 0 || dims.z <= z)
+    {
+      return nullptr;
+    }
+    return data + z * voxelSliceSize + static_cast<std::size_t>(y) * dims.x;
+  };
+
+  // Label of a voxel of a row, which is background outside of the segmentation
+  auto label = [&dims](const S* row, int x) -> uint32_t
+  { return (row && 0 <= x && x < dims.x) ? static_cast<uint32_t>(row[x]) : 0u; };
+
+  const glm::ivec3 cellDims = dims + 1;
+  const std::size_t cellSliceSize = static_cast<std::size_t>(cellDims.x) * cellDims.y;
+  const std::size_t numSlices = static_cast<std::size_t>(cellDims.z);
+
+  // Create the vertices of the cells that have a boundary of a meshed label
+  std::vector<SliceVertices> slices(numSlices);
+
+  auto createVertices = [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+  {
+    for (std::size_t s = begin; s < end; ++s)
+    {
+      SliceVertices& slice = slices[s];
+      const int z = static_cast<int>(s) - 1;
+
+      for (int cy = 0; cy < cellDims.y; ++cy)
+      {
+        const int y = cy - 1;
+
+        // Rows of the corners of the cells, indexed by (dy + 2 * dz)
+        const std::array<const S*, 4> rows{
+          voxelRow(y, z), voxelRow(y + 1, z), voxelRow(y, z + 1), voxelRow(y + 1, z + 1)
+        };
+
+        if (std::all_of(std::begin(rows), std::end(rows), [](const S* r) { return !r; }))
+        {
+          continue;
+        }
+
+        // Labels of the corners at the lower x of the cell, which are the upper corners of the
+        // previous cell
+        std::array<uint32_t, 4> lowerLabels{0u, 0u, 0u, 0u};
+        std::array<uint32_t, 8> corners;
+
+        for (int cx = 0; cx < cellDims.x; ++cx)
+        {
+          for (int j = 0; j < 4; ++j)
+          {
+            corners[2 * j] = lowerLabels[j];
+            corners[2 * j + 1] = label(rows[j], cx);
+            lowerLabels[j] = corners[2 * j + 1];
+          }
+
+          const bool uniform = std::all_of(
+            std::begin(corners),
+            std::end(corners),
+            [&corners](uint32_t l) { return l == corners[0]; }
+          );
+
+          if (uniform || std::none_of(std::begin(corners), std::end(corners), isMeshed))
+          {
+            continue;
+          }
+
+          glm::vec3 sum{0.0f};
+          int numEdges = 0;
+
+          for (const auto& edge : sk_edgeCorners)
+          {
+            if (corners[edge[0]] != corners[edge[1]])
+            {
+              sum += 0.5f * (cornerOffset(edge[0]) + cornerOffset(edge[1]));
+              ++numEdges;
+            }
+          }
+
+          slice.m_cells.push_back(static_cast<uint32_t>(cy * cellDims.x + cx));
+          slice.m_positions.push_back(glm::vec3(cx - 1, y, z) + sum / static_cast<float>(numEdges));
+        }
+      }
+    }
+  };
+
+  parallel::forEachChunk(numSlices, sk_minSlicesPerChunk, createVertices);
+
+  std::size_t numVertices = 0;
+
+  for (SliceVertices& slice : slices)
+  {
+    if (static_cast<std::size_t>(std::numeric_limits<int32_t>::max()) - slice.m_cells.size()
+        < numVertices)
+    {
+      spdlog::error("Label surfaces have too many vertices");
+      return std::nullopt;
+    }
+
+    slice.m_firstVertex = static_cast<uint32_t>(numVertices);
+    numVertices += slice.m_cells.size();
+  }
+
+  if (0 == numVertices)
+  {
+    return meshes;
+  }
+
+  std::vector<glm::vec3> positions(numVertices);
+
+  parallel::forEachChunk(
+    numSlices,
+    sk_minSlicesPerChunk,
+    [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+    {
+      for (std::size_t s = begin; s < end; ++s)
+      {
+        SliceVertices& slice = slices[s];
+
+        std::copy(
+          std::begin(slice.m_positions),
+          std::end(slice.m_positions),
+          std::begin(positions) + slice.m_firstVertex
+        );
+
+        slice.m_positions = std::vector<glm::vec3>();
+      }
+    }
+  );
+
+  auto sliceOrNull = [&](int s) -> const SliceVertices*
+  { return (0 <= s && s < cellDims.z) ? &slices[static_cast<std::size_t>(s)] : nullptr; };
+
+  // Create the quads of the faces between voxels with different labels. The faces at the lower
+  // side of voxel (x, y, z) are between cell slices z and z + 1.
+  std::vector<std::vector<Quad> > chunkQuads(parallel::numChunks(numSlices, sk_minSlicesPerChunk));
+
+  auto createQuads = [&](std::size_t chunk, std::size_t begin, std::size_t end)
+  {
+    std::vector<Quad>& quads = chunkQuads[chunk];
+
+    SliceVertexMap below(cellSliceSize);
+    SliceVertexMap above(cellSliceSize);
+
+    for (std::size_t s = begin; s < end; ++s)
+    {
+      const int cz = static_cast<int>(s);
+
+      if (s == begin)
+      {
+        below.assign(sliceOrNull(cz - 1));
+      }
+      else
+      {
+        std::swap(below, above);
+      }
+
+      above.assign(sliceOrNull(cz));
+
+      // The cells around a face between voxels with different labels have vertices, since one of
+      // the labels is meshed
+      auto vertex = [&](const glm::ivec3& cell)
+      {
+        const SliceVertexMap& map = (cell.z == cz) ? above : below;
+        return static_cast<uint32_t>(map.m_vertices[cell.y * cellDims.x + cell.x]);
+      };
+
+      const int z = cz - 1;
+
+      for (int y = -1; y < dims.y; ++y)
+      {
+        const S* row = voxelRow(y, z);
+        const S* rowY = voxelRow(y + 1, z);
+        const S* rowZ = voxelRow(y, z + 1);
+
+        if (!row && !rowY && !rowZ)
+        {
+          continue;
+        }
+
+        for (int x = -1; x < dims.x; ++x)
+        {
+          const uint32_t l = label(row, x);
+          const std::array<uint32_t, 3> neighbors{
+            label(row, x + 1), label(rowY, x), label(rowZ, x)
+          };
+
+          for (int a = 0; a < 3; ++a)
+          {
+            const uint32_t n = neighbors[a];
+
+            if (l == n || !(isMeshed(l) || isMeshed(n)))
+            {
+              continue;
+            }
+
+            // The cells (u, w), (u + 1, w), (u + 1, w + 1), (u, w + 1) around the face are
+            // counter-clockwise around axis a, since u x w = a
+            const int u = (a + 1) % 3;
+            const int w = (a + 2) % 3;
+
+            const glm::ivec3 c11{x + 1, y + 1, cz};
+            glm::ivec3 c10 = c11;
+            glm::ivec3 c01 = c11;
+            --c10[w];
+            --c01[u];
+            glm::ivec3 c00 = c10;
+            --c00[u];
+
+            quads.push_back({{vertex(c00), vertex(c10), vertex(c11), vertex(c01)}, {l, n}});
+          }
+        }
+      }
+    }
+  };
+
+  parallel::forEachChunk(numSlices, sk_minSlicesPerChunk, createQuads);
+
+  // Smooth the vertices, keeping each one within its cell
+  if (0 < smoothingIterations)
+  {
+    std::vector<glm::vec3> smoothed(numVertices);
+
+    auto smoothSlices = [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+    {
+      SliceVertexMap below(cellSliceSize);
+      SliceVertexMap current(cellSliceSize);
+      SliceVertexMap above(cellSliceSize);
+
+      for (std::size_t s = begin; s < end; ++s)
+      {
+        const int cz = static_cast<int>(s);
+
+        if (s == begin)
+        {
+          below.assign(sliceOrNull(cz - 1));
+          current.assign(sliceOrNull(cz));
+        }
+        else
+        {
+          std::swap(below, current);
+          std::swap(current, above);
+        }
+
+        above.assign(sliceOrNull(cz + 1));
+
+        const SliceVertices& slice = slices[s];
+
+        for (std::size_t i = 0; i < slice.m_cells.size(); ++i)
+        {
+          const uint32_t cell = slice.m_cells[i];
+          const int cx = static_cast<int>(cell % cellDims.x);
+          const int cy = static_cast<int>(cell / cellDims.x);
+          const uint32_t v = slice.m_firstVertex + static_cast<uint32_t>(i);
+
+          const std::array<int32_t, 6> neighbors{
+            (0 < cx) ? current.m_vertices[cell - 1] : sk_noVertex,
+            (cx + 1 < cellDims.x) ? current.m_vertices[cell + 1] : sk_noVertex,
+            (0 < cy) ? current.m_vertices[cell - cellDims.x] : sk_noVertex,
+            (cy + 1 < cellDims.y) ? current.m_vertices[cell + cellDims.x] : sk_noVertex,
+            below.m_vertices[cell],
+            above.m_vertices[cell]
+          };
+
+          glm::vec3 sum{0.0f};
+          int numNeighbors = 0;
+
+          for (int32_t n : neighbors)
+          {
+            if (sk_noVertex != n)
+            {
+              sum += positions[static_cast<std::size_t>(n)];
+              ++numNeighbors;
+            }
+          }
+
+          if (0 == numNeighbors)
+          {
+            smoothed[v] = positions[v];
+            continue;
+          }
+
+          const glm::vec3 cellMin(cx - 1, cy - 1, cz - 1);
+          smoothed[v] = glm::clamp(sum / static_cast<float>(numNeighbors), cellMin, cellMin + 1.0f);
+        }
+      }
+    };
+
+    for (int i = 0; i < smoothingIterations; ++i)
+    {
+      parallel::forEachChunk(numSlices, sk_minSlicesPerChunk, smoothSlices);
+      std::swap(positions, smoothed);
+    }
+  }
+
+  // Gather the quad sides of each label, as the quad index times two plus the side
+  std::vector<Quad> quads;
+
+  for (std::vector<Quad>& q : chunkQuads)
+  {
+    quads.insert(std::end(quads), std::begin(q), std::end(q));
+    q = std::vector<Quad>();
+  }
+
+  if (static_cast<std::size_t>(std::numeric_limits<uint32_t>::max() / 2) < quads.size())
+  {
+    spdlog::error("Label surfaces have too many faces ({})", quads.size());
+    return std::nullopt;
+  }
+
+  std::vector<std::size_t> labelSidesBegin(meshedLabels.size() + 1, 0);
+
+  for (const Quad& quad : quads)
+  {
+    for (uint32_t l : quad.m_labels)
+    {
+      if (isMeshed(l))
+      {
+        ++labelSidesBegin[static_cast<std::size_t>(labelIndices[l]) + 1];
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < meshedLabels.size(); ++i)
+  {
+    labelSidesBegin[i + 1] += labelSidesBegin[i];
+  }
+
+  std::vector<uint32_t> labelSides(labelSidesBegin.back());
+  std::vector<std::size_t> labelSidesEnd(labelSidesBegin.begin(), labelSidesBegin.end() - 1);
+
+  for (std::size_t q = 0; q < quads.size(); ++q)
+  {
+    for (uint32_t side = 0; side < 2; ++side)
+    {
+      const uint32_t l = quads[q].m_labels[side];
+
+      if (isMeshed(l))
+      {
+        labelSides[labelSidesEnd[static_cast<std::size_t>(labelIndices[l])]++]
+          = 2 * static_cast<uint32_t>(q) + side;
+      }
+    }
+  }
+
+  // Build the mesh of each label from its quads
+  const glm::mat3 subjectLinear{subject_T_pixel};
+
+  // Keep the triangles counter-clockwise in Subject space if it is mirrored
+  const bool flipWinding = (glm::determinant(subjectLinear) < 0.0f);
+
+  std::vector<IsosurfaceMesh> labelMeshes(meshedLabels.size());
+
+  auto buildMeshes = [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end)
+  {
+    // Index of each vertex in the mesh of the label
+    std::vector<int32_t> localVertices(numVertices, sk_noVertex);
+
+    for (std::size_t i = begin; i < end; ++i)
+    {
+      IsosurfaceMesh& mesh = labelMeshes[i];
+      std::vector<uint32_t> globalVertices;
+
+      auto localVertex = [&](uint32_t v)
+      {
+        if (sk_noVertex == localVertices[v])
+        {
+          localVertices[v] = static_cast<int32_t>(globalVertices.size());
+          globalVertices.push_back(v);
+        }
+        return static_cast<uint32_t>(localVertices[v]);
+      };
+
+      for (std::size_t k = labelSidesBegin[i]; k < labelSidesBegin[i + 1]; ++k)
+      {
+        const Quad& quad = quads[labelSides[k] / 2];
+        const bool isSecondVoxel = (1 == labelSides[k] % 2);
+
+        // Quads face out of the first voxel, so they are reversed for the second voxel
+        std::array<uint32_t, 4> v = quad.m_vertices;
+
+        if (isSecondVoxel)
+        {
+          std::swap(v[1], v[3]);
+        }
+
+        // Split the quad along its shorter diagonal, which is the same for both labels
+        const float d02 = glm::distance(positions[v[0]], positions[v[2]]);
+        const float d13 = glm::distance(positions[v[1]], positions[v[3]]);
+
+        const std::array<std::array<int, 3>, 2> triangles
+          = (d02 <= d13) ? std::array<std::array<int, 3>, 2>{{{0, 1, 2}, {0, 2, 3}}}
+                         : std::array<std::array<int, 3>, 2>{{{0, 1, 3}, {1, 2, 3}}};
+
+        for (const auto& t : triangles)
+        {
+          mesh.m_indices.push_back(localVertex(v[t[0]]));
+          mesh.m_indices.push_back(localVertex(v[flipWinding ? t[2] : t[1]]));
+          mesh.m_indices.push_back(localVertex(v[flipWinding ? t[1] : t[2]]));
+        }
+      }
+
+      mesh.m_positions.reserve(globalVertices.size());
+
+      for (uint32_t v : globalVertices)
+      {
+        mesh.m_positions.emplace_back(subject_T_pixel * glm::vec4{positions[v], 1.0f});
+        localVertices[v] = sk_noVertex;
+      }
+
+      // Area-weighted vertex normals, which point out of the label
+      mesh.m_normals.assign(globalVertices.size(), glm::vec3{0.0f});
+
+      for (std::size_t t = 0; t < mesh.m_indices.size(); t += 3)
+      {
+        const glm::vec3& p0 = mesh.m_positions[mesh.m_indices[t]];
+        const glm::vec3& p1 = mesh.m_positions[mesh.m_indices[t + 1]];
+        const glm::vec3& p2 = mesh.m_positions[mesh.m_indices[t + 2]];
+        const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+
+        for (int c = 0; c < 3; ++c)
+        {
+          mesh.m_normals[mesh.m_indices[t + c]] += n;
+        }
+      }
+
+      for (glm::vec3& n : mesh.m_normals)
+      {
+        const float length = glm::length(n);
+        n = (0.0f < length && std::isfinite(length)) ? n / length : glm::vec3{0.0f};
+      }
+    }
+  };
+
+  parallel::forEachChunk(meshedLabels.size(), 1, buildMeshes);
+
+  for (std::size_t i = 0; i < meshedLabels.size(); ++i)
+  {
+    if (!labelMeshes[i].m_indices.empty())
+    {
+      meshes.emplace(meshedLabels[i], std::move(labelMeshes[i]));
+    }
+  }
+
+  return meshes;
+}
+
+} // namespace
+
+std::optional<std::map<LabelType, IsosurfaceMesh> > extractLabelSurfaces(
+  const Image& seg, const std::vector<LabelType>& labels, int smoothingIterations
+)
+{
+  const glm::ivec3 dims{seg.header().pixelDimensions()};
+  const void* buffer = seg.bufferAsVoid(0);
+  const glm::mat4& subject_T_pixel = seg.transformations().subject_T_pixel();
+
+  switch (seg.header().memoryComponentType())
+  {
+  case ComponentType::UInt8:
+    return extractLabelSurfacesFromBuffer(
+      static_cast<const uint8_t*>(buffer), dims, labels, smoothingIterations, subject_T_pixel
+    );
+  case ComponentType::UInt16:
+    return extractLabelSurfacesFromBuffer(
+      static_cast<const uint16_t*>(buffer), dims, labels, smoothingIterations, subject_T_pixel
+    );
+  case ComponentType::UInt32:
+    return extractLabelSurfacesFromBuffer(
+      static_cast<const uint32_t*>(buffer), dims, labels, smoothingIterations, subject_T_pixel
+    );
+  default:
+  {
+    spdlog::error(
+      "Invalid component type '{}' when extracting label surfaces",
+      componentTypeString(seg.header().memoryComponentType())
+    );
+    return std::nullopt;
+  }
+  }
+}
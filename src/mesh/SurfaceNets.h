@@ -0,0 +1,40 @@
+#ifndef SURFACE_NETS_H
+#define SURFACE_NETS_H
+
+#include "common/SegmentationTypes.h"
+#include "mesh/MarchingCubes.h"
+
+#include <map>
+#include <optional>
+#include <vector>
+
+class Image;
+
+/**
+ * @brief Extract the boundary surfaces of labels of a segmentation using multi-label surface nets.
+ *
+ * The surfaces of all labels are extracted in one sweep over the segmentation, which is processed
+ * in parallel over slices. Each cell of 2x2x2 voxels whose voxels have different labels, at least
+ * one of which is meshed, gets one vertex at the mean of the midpoints of its edges that join
+ * different labels. Each pair of adjacent voxels with different labels gets a quad that joins the
+ * vertices of the four cells around their shared face. The quad belongs to the meshes of both
+ * labels, with opposite orientations, so the surfaces of adjacent labels share their vertices and
+ * meet without gaps. Voxels outside of the segmentation are background, so surfaces are closed.
+ *
+ * Smoothing moves each vertex to the mean of the vertices of its face-adjacent cells, while
+ * keeping it within its cell. Vertices are smoothed once for all labels, so shared vertices move
+ * together.
+ *
+ * @param[in] seg Segmentation, with UInt8, UInt16, or UInt32 components
+ * @param[in] labels Labels to mesh. The background (0) label is never meshed.
+ * @param[in] smoothingIterations Number of smoothing iterations
+ *
+ * @return Mesh of each label with a non-empty boundary, in the Subject space of the segmentation,
+ * with normals that point out of the label; or std::nullopt if the segmentation has an invalid
+ * component type or the surfaces have too many vertices
+ */
+std::optional<std::map<LabelType, IsosurfaceMesh> > extractLabelSurfaces(
+  const Image& seg, const std::vector<LabelType>& labels, int smoothingIterations
+);
+
+#endif // SURFACE_NETS_H
@@ -1,9 +1,11 @@
 #include "rendering/Rendering.h"
 
 #include "common/Exception.hpp"
+#include "common/Profiler.h"
 #include "common/Types.h"
 #include "common/UuidUtility.h"
 
+#include "image/Image.h"
 #include "image/ImageColorMap.h"
 #include "image/SurfaceUtility.h"
 
@@ -331,6 +333,11 @@ void Rendering::initTextures()
   m_isAppDoneLoadingImages = true;
 }
 
+void Rendering::updateDistanceMapTextures()
+{
+  m_appData.renderData().m_distanceMapTextures = createDistanceMapTextures(m_appData);
+}
+
 bool Rendering::createLabelColorTableTexture(const uuids::uuid& labelTableUid)
 {
   // static const glm::vec4 sk_border{ 0.0f, 0.0f, 0.0f, 0.0f };
@@ -451,100 +458,83 @@ bool Rendering::createImageTexture( const uuids::uuid& imageUid )
 }
 */
 
-void Rendering::updateSegTexture(
-  const uuids::uuid& segUid,
-  const ComponentType& compType,
-  const glm::uvec3& startOffsetVoxel,
-  const glm::uvec3& sizeInVoxels,
-  const void* data
-)
+void Rendering::uploadDirtySegTextures()
 {
+  PROFILE_SCOPE("Upload seg textures");
+
   // Load seg data into first mipmap level
   static constexpr GLint sk_mipmapLevel = 0;
+  static constexpr uint32_t sk_comp = 0;
 
-  auto it = m_appData.renderData().m_segTextures.find(segUid);
-  if (std::end(m_appData.renderData().m_segTextures) == it)
-  {
-    spdlog::error("Cannot update segmentation {}: texture not found.", segUid);
-    return;
-  }
+  m_segUploadStats = SegUploadStats();
 
-  GLTexture& T = it->second;
+  for (const auto& segUid : m_appData.segUidsOrdered())
+  {
+    Image* seg = m_appData.seg(segUid);
+    if (!seg || 0 == seg->dirtyBricks().numDirtyBricks())
+    {
+      continue;
+    }
 
-  const auto* seg = m_appData.seg(segUid);
+    const DirtyBrickMap::UploadPlan plan = seg->dirtyBricks().takeUploadPlan();
 
-  if (!seg)
-  {
-    spdlog::warn("Segmentation {} is invalid", segUid);
-    return;
-  }
+    auto it = m_appData.renderData().m_segTextures.find(segUid);
+    if (std::end(m_appData.renderData().m_segTextures) == it)
+    {
+      spdlog::error("Cannot update segmentation {}: texture not found.", segUid);
+      continue;
+    }
 
-  T.setSubData(
-    sk_mipmapLevel,
-    startOffsetVoxel,
-    sizeInVoxels,
-    GLTexture::getBufferPixelRedFormat(compType),
-    GLTexture::getBufferPixelDataType(compType),
-    data
-  );
-}
+    GLTexture& T = it->second;
 
-void Rendering::updateSegTextureWithInt64Data(
-  const uuids::uuid& segUid,
-  const ComponentType& compType,
-  const glm::uvec3& startOffsetVoxel,
-  const glm::uvec3& sizeInVoxels,
-  const int64_t* data
-)
-{
-  if (!data)
-  {
-    spdlog::error("Null segmentation texture data pointer");
-    return;
-  }
+    const ComponentType compType = seg->header().memoryComponentType();
+    const glm::uvec3 dims{seg->header().pixelDimensions()};
+    const std::size_t bytesPerVoxel = seg->header().memoryComponentSizeInBytes();
 
-  if (!isValidSegmentationComponentType(compType))
-  {
-    spdlog::error(
-      "Unable to update segmentation texture using buffer with invalid "
-      "component type {}",
-      componentTypeString(compType)
-    );
-    return;
-  }
+    // Read the buffer as const, so that uploading does not change the segmentation data version
+    const uint8_t* buffer
+      = static_cast<const uint8_t*>(static_cast<const Image*>(seg)->bufferAsVoid(sk_comp));
 
-  const size_t N = static_cast<size_t>(sizeInVoxels.x) * static_cast<size_t>(sizeInVoxels.y)
-                   * static_cast<size_t>(sizeInVoxels.z);
+    // The boxes are read in place from the segmentation buffer, whose rows have dims.x voxels
+    // and whose slices have dims.y rows
+    GLTexture::PixelStoreSettings unpackSettings;
+    unpackSettings.m_alignment = 1;
+    unpackSettings.m_rowLength = static_cast<GLint>(dims.x);
+    unpackSettings.m_imageHeight = static_cast<GLint>(dims.y);
 
-  switch (compType)
-  {
-  case ComponentType::UInt8:
-  {
-    const std::vector<uint8_t> castData(data, data + N);
+    for (const DirtyBrickMap::Box& box : plan.m_boxes)
+    {
+      const std::size_t row = static_cast<std::size_t>(box.m_offset.z) * dims.y + box.m_offset.y;
+      const std::size_t offset = row * dims.x + box.m_offset.x;
+
+      T.setSubData(
+        sk_mipmapLevel,
+        box.m_offset,
+        box.m_size,
+        GLTexture::getBufferPixelRedFormat(compType),
+        GLTexture::getBufferPixelDataType(compType),
+        buffer + offset * bytesPerVoxel,
+        unpackSettings
+      );
+    }
 
-    return updateSegTexture(
-      segUid, compType, startOffsetVoxel, sizeInVoxels, static_cast<const void*>(castData.data())
-    );
+    m_segUploadStats.add(plan);
   }
-  case ComponentType::UInt16:
-  {
-    const std::vector<uint16_t> castData(data, data + N);
 
-    return updateSegTexture(
-      segUid, compType, startOffsetVoxel, sizeInVoxels, static_cast<const void*>(castData.data())
-    );
-  }
-  case ComponentType::UInt32:
+  if (m_segUploadStats.m_numMaps > 0)
   {
-    const std::vector<uint32_t> castData(data, data + N);
-
-    return updateSegTexture(
-      segUid, compType, startOffsetVoxel, sizeInVoxels, static_cast<const void*>(castData.data())
+    spdlog::trace(
+      "Uploaded {} bytes of {} segmentation textures in {} boxes",
+      m_segUploadStats.m_numBytes,
+      m_segUploadStats.m_numMaps,
+      m_segUploadStats.m_numBoxes
     );
   }
-  default:
-    return;
-  }
+}
+
+const Rendering::SegUploadStats& Rendering::segUploadStats() const
+{
+  return m_segUploadStats;
 }
 
 /// @todo Need to fix this to handle multicomponent images like
@@ -834,6 +824,9 @@ void Rendering::updateLabelColorTableTexture(size_t tableIndex)
 
 void Rendering::render()
 {
+  // Upload the segmentation voxels that changed since the prior frame
+  uploadDirtySegTextures();
+
   // Set up OpenGL state, because it changes after NanoVG calls in the render of the prior frame
   setupOpenGlState();
 
@@ -865,6 +858,8 @@ void Rendering::updateImageUniforms(uuid_range_t imageUids)
 
 void Rendering::updateImageUniforms(const uuids::uuid& imageUid)
 {
+  PROFILE_SCOPE("Update image uniforms");
+
   auto it = m_appData.renderData().m_uniforms.find(imageUid);
 
   if (std::end(m_appData.renderData().m_uniforms) == it)
@@ -1191,28 +1186,8 @@ std::list<std::reference_wrapper<GLTexture> > Rendering::bindImageTextures(const
       textures.push_back(imgTex);
     }
 
-    static bool alreadyShowedWarning = false;
-
-    if (useDistMap)
-    {
-      const auto& distMaps = m_appData.distanceMaps(*imageUid, activeComp);
-
-      if (distMaps.empty())
-      {
-        if (!alreadyShowedWarning)
-        {
-          spdlog::warn("No distance map for component {} of image {}", activeComp, *imageUid);
-          alreadyShowedWarning = true;
-
-          // Disable use of distance map for this image:
-          if (Image* image2 = (imageUid ? m_appData.image(*imageUid) : nullptr))
-          {
-            image2->settings().setUseDistanceMapForRaycasting(false);
-          }
-        }
-      }
-    }
-
+    // Distance maps are computed in the background. Until the map of the active component
+    // is ready, the blank distance map is bound, so raycasting proceeds without skipping space.
     bool foundMap = false;
 
     if (useDistMap)
@@ -2100,6 +2075,8 @@ void Rendering::renderAllAnnotations(
 
 void Rendering::renderImageData()
 {
+  PROFILE_SCOPE("Render images");
+
   if (!m_isAppDoneLoadingImages)
   {
     // Don't render images if the app is still loading them
@@ -2176,6 +2153,8 @@ void Rendering::renderOverlays()
 
 void Rendering::renderVectorOverlays()
 {
+  PROFILE_SCOPE("Render vector overlays");
+
   if (!m_nvg)
     return;
 
@@ -2185,7 +2164,7 @@ void Rendering::renderVectorOverlays()
   if (!m_isAppDoneLoadingImages)
   {
     startNvgFrame(m_nvg, windowVP);
-    drawLoadingOverlay(m_nvg, windowVP);
+    drawLoadingOverlay(m_nvg, windowVP, m_appData.state().loadingStatus());
     endNvgFrame(m_nvg);
     return;
 
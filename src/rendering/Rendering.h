@@ -4,6 +4,8 @@
 #include "common/Types.h"
 #include "common/UuidRange.h"
 
+#include "image/DirtyBrickMap.h"
+
 #include "logic/camera/CameraTypes.h"
 #include "logic/records/MeshRecord.h"
 
@@ -39,6 +41,9 @@ struct NVGcontext;
 class Rendering
 {
 public:
+  /// Counters of the segmentation texture uploads of a frame
+  using SegUploadStats = DirtyBrickMap::UploadStats;
+
   Rendering(AppData&);
   ~Rendering();
 
@@ -48,6 +53,9 @@ public:
   /// Create image and segmentation textures
   void initTextures();
 
+  /// Recreate the distance map textures after distance maps have been added to the images
+  void updateDistanceMapTextures();
+
   /// Render the scene
   void render();
 
@@ -68,29 +76,14 @@ public:
   void updateLabelColorTableTexture(size_t tableIndex);
 
   /**
-     * @brief Updates the texture representation of a segmentation
-     * @param segUid
-     * @param compType
-     * @param startOffsetVoxel
-     * @param sizeInVoxels
-     * @param data
+     * @brief Upload the dirty bricks of all segmentations to their textures and clear them.
+     * The dirty bricks of each segmentation are coalesced into boxes, which are read in place
+     * from the segmentation buffer. This is called once per frame, before rendering.
      */
-  void updateSegTexture(
-    const uuids::uuid& segUid,
-    const ComponentType& compType,
-    const glm::uvec3& startOffsetVoxel,
-    const glm::uvec3& sizeInVoxels,
-    const void* data
-  );
+  void uploadDirtySegTextures();
 
-  /// @todo Is this function needed?
-  void updateSegTextureWithInt64Data(
-    const uuids::uuid& segUid,
-    const ComponentType& compType,
-    const glm::uvec3& startOffsetVoxel,
-    const glm::uvec3& sizeInVoxels,
-    const int64_t* data
-  );
+  /// Counters of the segmentation texture uploads of the last frame
+  const SegUploadStats& segUploadStats() const;
 
   void updateImageTexture(
     const uuids::uuid& imageUid,
@@ -181,6 +174,8 @@ private:
 
   AppData& m_appData;
 
+  SegUploadStats m_segUploadStats; //!< Counters of the segmentation uploads of the last frame
+
   // NanoVG context for vector graphics (owned by this class)
   NVGcontext* m_nvg;
 
@@ -307,7 +307,8 @@ std::unordered_map<uuids::uuid, std::unordered_map<uint32_t, GLTexture> > create
 
       if (maps.empty())
       {
-        spdlog::warn("No distance map for component {} of image {}", comp, imageUid);
+        // The map may not have been computed yet
+        spdlog::debug("No distance map for component {} of image {}", comp, imageUid);
         continue;
       }
 
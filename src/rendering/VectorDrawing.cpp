@@ -1,5 +1,6 @@
 #include "rendering/VectorDrawing.h"
 
+#include "common/AABB.h"
 #include "common/DataHelper.h"
 #include "common/DirectionMaps.h"
 #include "common/Viewport.h"
@@ -46,6 +47,63 @@ static const std::string ROBOTO_LIGHT("robotoLight");
 
 static constexpr float sk_outlineStrokeWidth = 2.0f;
 
+/**
+ * @brief Compute the box in landmark space that encloses the part of a view's slab that is
+ * visible in the view. The slab extends a distance on both sides of the view plane.
+ * @return Box, or std::nullopt if the view has a perspective projection, whose visible region
+ * is not bounded by the slab
+ */
+std::optional<AABB<float> > landmarkViewBox(
+  const Viewport& windowVP,
+  const FrameBounds& miewportViewBounds,
+  const View& view,
+  const glm::vec4& worldViewPlane,
+  float slabDistance,
+  const glm::mat4& landmark_T_world
+)
+{
+  if (!view.camera().isOrthographic())
+  {
+    return std::nullopt;
+  }
+
+  const glm::vec3 worldViewNormal{worldViewPlane};
+  const auto& b = miewportViewBounds.bounds;
+
+  const std::array<glm::vec2, 4> miewportCorners{
+    {{b.xoffset, b.yoffset},
+     {b.xoffset + b.width, b.yoffset},
+     {b.xoffset, b.yoffset + b.height},
+     {b.xoffset + b.width, b.yoffset + b.height}}
+  };
+
+  std::optional<AABB<float> > box;
+
+  for (const glm::vec2& miewportCorner : miewportCorners)
+  {
+    // Project the corner from the near clip plane onto the view plane
+    const glm::vec3 worldNearPos = camera::world_T_miewport(
+      windowVP, view.camera(), view.viewClip_T_windowClip(), miewportCorner
+    );
+
+    const glm::vec3 worldPlanePos = worldNearPos
+                                    - math::signedDistancePointToPlane(worldNearPos, worldViewPlane)
+                                        * worldViewNormal;
+
+    for (const float side : {-1.0f, 1.0f})
+    {
+      const glm::vec3 worldPos = worldPlanePos + side * slabDistance * worldViewNormal;
+      const glm::vec4 lmPos = landmark_T_world * glm::vec4{worldPos, 1.0f};
+      const glm::vec3 lmPos3{lmPos / lmPos.w};
+
+      box = box ? AABB<float>{glm::min(box->first, lmPos3), glm::max(box->second, lmPos3)}
+                : AABB<float>{lmPos3, lmPos3};
+    }
+  }
+
+  return box;
+}
+
 } // namespace
 
 void startNvgFrame(NVGcontext* nvg, const Viewport& windowVP)
@@ -76,7 +134,7 @@ void endNvgFrame(NVGcontext* nvg)
   nvgEndFrame(nvg);
 }
 
-void drawLoadingOverlay(NVGcontext* nvg, const Viewport& windowVP)
+void drawLoadingOverlay(NVGcontext* nvg, const Viewport& windowVP, const std::string& status)
 {
   /// @todo Progress indicators: https://github.com/ocornut/imgui/issues/1901
 
@@ -99,6 +157,12 @@ void drawLoadingOverlay(NVGcontext* nvg, const Viewport& windowVP)
   nvgFillColor(nvg, s_greyTextColor);
   nvgText(nvg, 0.5f * windowVP.width(), 0.5f * windowVP.height(), sk_loadingText.c_str(), nullptr);
 
+  if (!status.empty())
+  {
+    nvgFontSize(nvg, 24.0f);
+    nvgText(nvg, 0.5f * windowVP.width(), 0.6f * windowVP.height(), status.c_str(), nullptr);
+  }
+
   const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
     std::chrono::system_clock::now().time_since_epoch()
   );
@@ -587,10 +651,29 @@ void drawLandmarks(
       const float pixelsMaxLmSize
         = glm::clamp(lmGroup->getRadiusFactor() * minDim, sk_minSize, sk_maxSize);
 
-      for (const auto& p : lmGroup->getPoints())
+      // Maximum distance beyond which the landmark is not rendered. Landmarks must be within a
+      // distance of half the image slice spacing along the direction of the view.
+      const float maxDist = 0.5f * sliceSpacing;
+
+      // The view plane in landmark space measures distances in World space, so that only the
+      // landmarks within the slab of the view are queried from the spatial index
+      const glm::vec4 landmarkViewPlane = glm::transpose(world_T_landmark) * worldViewPlane;
+
+      const std::optional<AABB<float> > landmarkBox = landmarkViewBox(
+        appData.windowData().viewport(),
+        miewportViewBounds,
+        view,
+        worldViewPlane,
+        maxDist,
+        glm::inverse(world_T_landmark)
+      );
+
+      const auto& points = lmGroup->getPoints();
+
+      for (const std::size_t index :
+           lmGroup->getIndex().query(landmarkViewPlane, maxDist, landmarkBox))
       {
-        const std::size_t index = p.first;
-        const PointRecord<glm::vec3>& point = p.second;
+        const PointRecord<glm::vec3>& point = points.at(index);
 
         if (!point.getVisibility())
           continue;
@@ -599,15 +682,10 @@ void drawLandmarks(
         const glm::vec4 worldLmPos = world_T_landmark * glm::vec4{point.getPosition(), 1.0f};
         const glm::vec3 worldLmPos3 = glm::vec3{worldLmPos / worldLmPos.w};
 
-        // Landmark must be within a distance of half the image slice spacing along the
-        // direction of the view to be rendered in the view
         const float distLmToPlane = std::abs(
           math::signedDistancePointToPlane(worldLmPos3, worldViewPlane)
         );
 
-        // Maximum distance beyond which the landmark is not rendered:
-        const float maxDist = 0.5f * sliceSpacing;
-
         if (distLmToPlane >= maxDist)
         {
           continue;
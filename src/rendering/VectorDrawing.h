@@ -10,6 +10,7 @@
 
 #include <array>
 #include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -26,7 +27,8 @@ void startNvgFrame(NVGcontext* nvg, const Viewport& windowVP);
 
 void endNvgFrame(NVGcontext* nvg);
 
-void drawLoadingOverlay(NVGcontext* nvg, const Viewport& windowVP);
+/// Draw the loading animation, with an optional status line (e.g. the file being loaded)
+void drawLoadingOverlay(NVGcontext* nvg, const Viewport& windowVP, const std::string& status);
 
 void drawWindowOutline(NVGcontext* nvg, const Viewport& windowVP);
 
@@ -633,7 +633,8 @@ void GLTexture::setSubData(
   const glm::uvec3& size,
   const BufferPixelFormat& format,
   const BufferPixelDataType& type,
-  const GLvoid* data
+  const GLvoid* data,
+  const std::optional<PixelStoreSettings>& unpackSettings
 )
 {
   if (Target::Texture2DMultisample == m_target || Target::TextureRectangle == m_target || Target::Texture2DMultisampleArray == m_target || Target::TextureCubeMap == m_target || Target::TextureBuffer == m_target)
@@ -650,10 +651,14 @@ void GLTexture::setSubData(
 
   std::optional<PixelStoreSettings> oldUnpackSettings = std::nullopt;
 
-  if (m_pixelUnpackSettings)
+  const std::optional<PixelStoreSettings>& newUnpackSettings = (unpackSettings)
+                                                                 ? unpackSettings
+                                                                 : m_pixelUnpackSettings;
+
+  if (newUnpackSettings)
   {
     oldUnpackSettings = getPixelUnpackSettings();
-    applyPixelUnpackSettings(*m_pixelUnpackSettings);
+    applyPixelUnpackSettings(*newUnpackSettings);
   }
 
   switch (m_target)
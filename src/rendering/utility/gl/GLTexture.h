@@ -158,6 +158,8 @@ public:
 
   /**
      * @brief Writes the user's pixel data to some part of the given mipmap of the bound texture object.
+     * @param unpackSettings Pixel unpack settings of the data, which override the settings of the
+     * texture (e.g. to read a sub-box of a larger buffer in place)
      **/
   void setSubData(
     GLint level,
@@ -165,7 +167,8 @@ public:
     const glm::uvec3& size,
     const tex::BufferPixelFormat& format,
     const tex::BufferPixelDataType& type,
-    const GLvoid* data
+    const GLvoid* data,
+    const std::optional<PixelStoreSettings>& unpackSettings = std::nullopt
   );
 
   void setCubeMapFaceData(
@@ -7,6 +7,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 /**
  * @brief Data for the user interface
@@ -30,11 +31,15 @@ struct GuiData
   bool m_showOpacityBlenderWindow = false; //!< Show opacity blender window
   bool m_showImGuiDemoWindow = false;      //!< Show ImGui demo window
   bool m_showImPlotDemoWindow = false;     //!< Show ImPlot demo window
+  bool m_showProfilerWindow = false;       //!< Show profiler window
 
   /// Flag to show dialog confirming closing of the application window.
   /// This is set the false until the user requests to close the window.
   bool m_showConfirmCloseAppPopup = false;
 
+  /// UIDs of the segmentations with saves that are scheduled or running in the background
+  std::unordered_set<uuids::uuid> m_savingSegUids;
+
   /// Map of imageUid to boolean of whether its image color map window is shown.
   /// (The color map window is shown as a popup from the Image Properties window)
   std::unordered_map<uuids::uuid, bool> m_showImageColormapWindow;
@@ -3,11 +3,11 @@
 #include "ui/Helpers.h"
 #include "ui/ImGuiCustomControls.h"
 #include "ui/Widgets.h"
-#include "ui/Widgets.tpp"
 
 // data::roundPointToNearestImageVoxelCenter
 // data::getAnnotationSubjectPlaneName
 #include "common/DataHelper.h"
+#include "common/SegmentationTypes.h"
 
 #include "image/Image.h"
 #include "image/ImageColorMap.h"
@@ -19,6 +19,8 @@
 #include "logic/app/Data.h"
 #include "logic/states/AnnotationStateMachine.h"
 
+#include "mesh/MeshLoading.h"
+
 #include <IconFontCppHeaders/IconsForkAwesome.h>
 
 #include <imgui/imgui.h>
@@ -71,6 +73,38 @@ static const ImGuiColorEditFlags sk_colorEditFlags = ImGuiColorEditFlags_NoInput
                                                      | ImGuiColorEditFlags_Uint8
                                                      | ImGuiColorEditFlags_InputRGB;
 
+/**
+ * @brief Save label meshes to VTK files, one file per label. The label is appended to the stem of
+ * the file name, so that "meshes.vtk" is saved as "meshes_1.vtk", "meshes_2.vtk", and so on.
+ */
+void saveLabelMeshes(const LabelMeshCpuRecords& labelMeshes, const fs::path& fileName)
+{
+  if (labelMeshes.empty())
+  {
+    spdlog::warn("There are no label meshes to save. Show the meshes of labels to generate them.");
+    return;
+  }
+
+  const std::string extension = fileName.has_extension() ? fileName.extension().string() : ".vtk";
+
+  for (const auto& [label, record] : labelMeshes)
+  {
+    fs::path labelFileName = fileName;
+    labelFileName.replace_filename(
+      fileName.stem().string() + "_" + std::to_string(label) + extension
+    );
+
+    if (writeMeshToFile(*record, labelFileName.string()))
+    {
+      spdlog::info("Saved mesh of label {} to file {}", label, labelFileName.string());
+    }
+    else
+    {
+      spdlog::error("Error saving mesh of label {} to file {}", label, labelFileName.string());
+    }
+  }
+}
+
 std::pair<ImVec4, ImVec4> computeHeaderBgAndTextColors(const glm::vec3& color)
 {
   glm::vec3 darkerBorderColorHsv = glm::hsvColor(color);
@@ -1925,61 +1959,12 @@ void renderImageHeader(
 
   if (ImGui::TreeNode("Histogram"))
   {
-    if (image->header().numPixels() > std::numeric_limits<int32_t>::max())
-    {
-      spdlog::warn(
-        "Number of pixels in image ({}) exceeds maximum supported by image histogram",
-        image->header().numPixels()
-      );
-    }
-
-    const uint32_t comp = imgSettings.activeComponent();
-    const void* buffer = image->bufferSortedAsVoid(comp);
-    const int bufferSize = static_cast<int>(image->header().numPixels());
-    const std::string& format = appData.guiData().m_imageValuePrecisionFormat;
-
-    switch (image->header().memoryComponentType())
-    {
-    case ComponentType::Int8:
-    {
-      drawImageHistogram(static_cast<const int8_t*>(buffer), bufferSize, imgSettings, format);
-      break;
-    }
-    case ComponentType::UInt8:
-    {
-      drawImageHistogram(static_cast<const uint8_t*>(buffer), bufferSize, imgSettings, format);
-      break;
-    }
-    case ComponentType::Int16:
-    {
-      drawImageHistogram(static_cast<const int16_t*>(buffer), bufferSize, imgSettings, format);
-      break;
-    }
-    case ComponentType::UInt16:
-    {
-      drawImageHistogram(static_cast<const uint16_t*>(buffer), bufferSize, imgSettings, format);
-      break;
-    }
-    case ComponentType::Int32:
-    {
-      drawImageHistogram(static_cast<const int32_t*>(buffer), bufferSize, imgSettings, format);
-      break;
-    }
-    case ComponentType::UInt32:
-    {
-      drawImageHistogram(static_cast<const uint32_t*>(buffer), bufferSize, imgSettings, format);
-      break;
-    }
-    case ComponentType::Float32:
-    {
-      drawImageHistogram(static_cast<const float*>(buffer), bufferSize, imgSettings, format);
-      break;
-    }
-    default:
-    {
-      break;
-    }
-    }
+    drawImageHistogram(
+      *image,
+      imgSettings.activeComponent(),
+      imgSettings,
+      appData.guiData().m_imageValuePrecisionFormat
+    );
 
     ImGui::TreePop();
   }
@@ -1999,11 +1984,16 @@ void renderSegmentationHeader(
   const std::function<ParcellationLabelTable*(size_t tableIndex)>& getLabelTable,
   const std::function<void(size_t tableIndex)>& updateLabelColorTableTexture,
   const std::function<void(size_t labelIndex)>& moveCrosshairsToSegLabelCentroid,
+  const std::function<const LabelStatistics*(const uuids::uuid& segUid)>& getSegLabelStatistics,
   const std::function<std::optional<uuids::uuid>(
     const uuids::uuid& matchingImageUid, const std::string& segDisplayName
   )>& createBlankSeg,
   const std::function<bool(const uuids::uuid& segUid)>& clearSeg,
   const std::function<bool(const uuids::uuid& segUid)>& removeSeg,
+  const std::function<bool(const uuids::uuid& segUid, const fs::path& fileName)>& saveSeg,
+  const std::function<bool(const uuids::uuid& segUid, const MorphologyParams& params)>&
+    applySegMorphology,
+  const std::function<bool(const uuids::uuid& segUid)>& generateLabelMeshes,
   const AllViewsRecenterType& recenterAllViews
 )
 {
@@ -2014,6 +2004,8 @@ void renderSegmentationHeader(
                                                 + std::string(" Remove");
   static const std::string sk_SaveSegString = std::string(ICON_FK_FLOPPY_O)
                                               + std::string(" Save...");
+  static const std::string sk_saveLabelMeshesString = std::string(ICON_FK_FLOPPY_O)
+                                                      + std::string(" Save meshes...");
 
   if (!image)
   {
@@ -2227,14 +2219,18 @@ void renderSegmentationHeader(
     ImGui::SetTooltip("Save the segmentation to an image file on disk");
   }
 
-  if (selectedFile)
+  if (appData.guiData().m_savingSegUids.count(*activeSegUid) > 0)
   {
-    static constexpr uint32_t sk_compToSave = 0;
+    ImGui::SameLine();
+    ImGui::TextDisabled("Saving...");
+  }
 
-    if (activeSeg->saveComponentToDisk(sk_compToSave, *selectedFile))
+  if (selectedFile)
+  {
+    // The segmentation is saved in the background. Its file name is set once the save finishes.
+    if (saveSeg(*activeSegUid, *selectedFile))
     {
-      spdlog::info("Saved segmentation image to file {}", *selectedFile);
-      activeSeg->header().setFileName(*selectedFile);
+      spdlog::info("Saving segmentation image to file {} in the background", *selectedFile);
     }
     else
     {
@@ -2304,6 +2300,40 @@ void renderSegmentationHeader(
       segSettings.labelTableIndex(),
       getLabelTable(segSettings.labelTableIndex()),
       updateLabelColorTableTexture,
+      moveCrosshairsToSegLabelCentroid,
+      [&generateLabelMeshes, &activeSegUid]() { generateLabelMeshes(*activeSegUid); }
+    );
+
+    // Save label meshes:
+    static const char* sk_meshDialogTitle("Select Label Mesh File");
+    static const std::vector<std::string> sk_meshDialogFilters{".vtk"};
+
+    const auto selectedMeshFile = ImGui::renderFileButtonDialogAndWindow(
+      sk_saveLabelMeshesString.c_str(), sk_meshDialogTitle, sk_meshDialogFilters
+    );
+
+    if (ImGui::IsItemHovered())
+    {
+      ImGui::SetTooltip("Save the shown label meshes to files on disk, one file per label");
+    }
+
+    if (selectedMeshFile)
+    {
+      saveLabelMeshes(appData.labelMeshCpuRecords(*activeSegUid), *selectedMeshFile);
+    }
+
+    ImGui::Spacing();
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::TreePop();
+  }
+
+  if (ImGui::TreeNode("Label Statistics"))
+  {
+    renderSegLabelStatisticsChildWindow(
+      getSegLabelStatistics(*activeSegUid),
+      getLabelTable(segSettings.labelTableIndex()),
       moveCrosshairsToSegLabelCentroid
     );
 
@@ -2314,6 +2344,134 @@ void renderSegmentationHeader(
     ImGui::TreePop();
   }
 
+  if (ImGui::TreeNode("Morphology"))
+  {
+    static const std::vector<std::pair<MorphologyOperation, const char*>> sk_operations{
+      {MorphologyOperation::Dilate, "Dilate"},
+      {MorphologyOperation::Erode, "Erode"},
+      {MorphologyOperation::Open, "Open"},
+      {MorphologyOperation::Close, "Close"},
+      {MorphologyOperation::FillHoles, "Fill holes"}
+    };
+
+    // The parameters are kept between frames and are shared by all segmentations
+    static MorphologyParams params;
+    static bool allLabels = false;
+    static int label = -1;
+
+    if (label < 0)
+    {
+      label = static_cast<int>(appData.settings().foregroundLabel());
+    }
+
+    const char* operationName = "";
+
+    for (const auto& [operation, name] : sk_operations)
+    {
+      if (operation == params.operation)
+      {
+        operationName = name;
+      }
+    }
+
+    if (ImGui::BeginCombo("Operation", operationName))
+    {
+      for (const auto& [operation, name] : sk_operations)
+      {
+        const bool isSelected = (operation == params.operation);
+
+        if (ImGui::Selectable(name, isSelected))
+        {
+          params.operation = operation;
+        }
+
+        if (isSelected)
+        {
+          ImGui::SetItemDefaultFocus();
+        }
+      }
+      ImGui::EndCombo();
+    }
+    ImGui::SameLine();
+    helpMarker(
+      "Opening erodes and then dilates, removing thin parts of labels. Closing dilates and then "
+      "erodes, filling narrow gaps. Hole filling adds the voxels that are enclosed by a label."
+    );
+
+    if (MorphologyOperation::FillHoles != params.operation)
+    {
+      if (ImGui::RadioButton("Ball##morphElement", MorphologyElement::Ball == params.element))
+      {
+        params.element = MorphologyElement::Ball;
+      }
+
+      ImGui::SameLine();
+      if (ImGui::RadioButton("Box##morphElement", MorphologyElement::Box == params.element))
+      {
+        params.element = MorphologyElement::Box;
+      }
+      ImGui::SameLine();
+      helpMarker("Shape of the structuring element in physical space");
+
+      if (ImGui::InputDouble("Radius (mm)", &params.radius, 0.5, 5.0, "%.2f"))
+      {
+        params.radius = std::max(params.radius, 0.0);
+      }
+      ImGui::SameLine();
+      helpMarker("Radius of the structuring element");
+    }
+
+    ImGui::Checkbox("All labels", &allLabels);
+    ImGui::SameLine();
+    helpMarker(
+      "Apply the operation to each label in turn. Voxels are only added to a label where "
+      "the segmentation is background."
+    );
+
+    if (!allLabels)
+    {
+      if (ImGui::InputInt("Label", &label))
+      {
+        label = std::max(label, 1);
+      }
+    }
+
+    // While an operation runs in the background, its progress and a button that cancels it
+    // replace the button that applies an operation
+    if (const auto morphologyTask = appData.state().segMorphologyTask())
+    {
+      ImGui::ProgressBar(morphologyTask->progress(), ImVec2(-FLT_MIN, 0.0f));
+
+      if (ImGui::Button("Cancel##morphology"))
+      {
+        morphologyTask->cancel();
+      }
+      if (ImGui::IsItemHovered())
+      {
+        ImGui::SetTooltip("Cancel the morphological operation");
+      }
+    }
+    else
+    {
+      if (ImGui::Button("Apply"))
+      {
+        params.label = allLabels ? std::nullopt
+                                 : std::optional<LabelType>(static_cast<LabelType>(label));
+        applySegMorphology(*activeSegUid, params);
+      }
+      if (ImGui::IsItemHovered())
+      {
+        ImGui::SetTooltip("Apply the morphological operation to this segmentation");
+      }
+    }
+
+    ImGui::Spacing();
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::TreePop();
+  }
+
   if (ImGui::TreeNode("Header Information"))
   {
     renderImageHeaderInformation(appData, imageUid, *activeSeg, updateImageUniforms, recenterAllViews);
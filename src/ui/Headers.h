@@ -2,6 +2,7 @@
 #define UI_HEADERS_H
 
 #include "common/PublicTypes.h"
+#include "common/filesystem.h"
 
 #include <functional>
 #include <glm/fwd.hpp>
@@ -15,6 +16,8 @@ class ImageColorMap;
 class ImageHeader;
 class ImageSettings;
 class ImageTransformations;
+class LabelStatistics;
+struct MorphologyParams;
 class ParcellationLabelTable;
 
 /**
@@ -87,9 +90,13 @@ void renderImageHeader(
  * @param updateImageUniforms
  * @param getLabelTable
  * @param updateLabelColorTableTexture
+ * @param getSegLabelStatistics Get the label statistics of a segmentation of the image
  * @param createBlankSeg
  * @param clearSeg
  * @param removeSeg
+ * @param saveSeg Schedule saving a segmentation to a file in the background
+ * @param applySegMorphology Start a morphological operation on a segmentation in the background
+ * @param generateLabelMeshes Start generating the label meshes of a segmentation in the background
  */
 void renderSegmentationHeader(
   AppData& appData,
@@ -101,11 +108,16 @@ void renderSegmentationHeader(
   const std::function<ParcellationLabelTable*(size_t tableIndex)>& getLabelTable,
   const std::function<void(size_t tableIndex)>& updateLabelColorTableTexture,
   const std::function<void(size_t labelIndex)>& moveCrosshairsToSegLabelCentroid,
+  const std::function<const LabelStatistics*(const uuids::uuid& segUid)>& getSegLabelStatistics,
   const std::function<std::optional<uuids::uuid>(
     const uuids::uuid& matchingImageUid, const std::string& segDisplayName
   )>& createBlankSeg,
   const std::function<bool(const uuids::uuid& segUid)>& clearSeg,
   const std::function<bool(const uuids::uuid& segUid)>& removeSeg,
+  const std::function<bool(const uuids::uuid& segUid, const fs::path& fileName)>& saveSeg,
+  const std::function<bool(const uuids::uuid& segUid, const MorphologyParams& params)>&
+    applySegMorphology,
+  const std::function<bool(const uuids::uuid& segUid)>& generateLabelMeshes,
   const AllViewsRecenterType& recenterAllViews
 );
 
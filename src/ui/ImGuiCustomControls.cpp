@@ -12,6 +12,8 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/color_space.hpp>
 
+#include <map>
+
 namespace
 {
 
@@ -204,10 +206,14 @@ std::optional<std::string> renderFileButtonDialogAndWindow(
   const char* buttonText, const char* dialogTitle, const std::vector<std::string> dialogFilters
 )
 {
-  static ImGui::FileBrowser saveDialog(
-    ImGuiFileBrowserFlags_EnterNewFilename | ImGuiFileBrowserFlags_CloseOnEsc
-    | ImGuiFileBrowserFlags_CreateNewDir
-  );
+  static const ImGuiFileBrowserFlags sk_flags = ImGuiFileBrowserFlags_EnterNewFilename
+                                                | ImGuiFileBrowserFlags_CloseOnEsc
+                                                | ImGuiFileBrowserFlags_CreateNewDir;
+
+  // Each dialog title has its own dialog, so that the selection of one button is not returned
+  // to another button
+  static std::map<std::string, ImGui::FileBrowser> saveDialogs;
+  ImGui::FileBrowser& saveDialog = saveDialogs.try_emplace(dialogTitle, sk_flags).first->second;
 
   saveDialog.SetTitle(dialogTitle);
   saveDialog.SetTypeFilters(dialogFilters);
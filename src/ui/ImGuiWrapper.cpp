@@ -13,6 +13,9 @@
 #include "logic/states/AnnotationStateHelpers.h"
 #include "logic/states/AnnotationStateMachine.h"
 
+#include "common/UuidUtility.h"
+#include "mesh/MeshLoading.h"
+
 #include "rendering/utility/CreateGLObjects.h"
 
 #include <IconFontCppHeaders/IconsForkAwesome.h>
@@ -40,6 +43,9 @@ namespace
 static const glm::quat sk_identityRotation{1.0f, 0.0f, 0.0f, 0.0f};
 static const glm::vec3 sk_zeroVec{0.0f, 0.0f, 0.0f};
 
+/// Number of iterations of smoothing of the vertices of label meshes
+static constexpr int sk_labelMeshSmoothingIterations = 4;
+
 ImFont* loadFont(
   const std::string& fontPath,
   const ImFontConfig& fontConfig,
@@ -156,6 +162,7 @@ void ImGuiWrapper::setCallbacks(
   )> createBlankSeg,
   std::function<bool(const uuids::uuid& segUid)> clearSeg,
   std::function<bool(const uuids::uuid& segUid)> removeSeg,
+  std::function<bool(const uuids::uuid& segUid, const fs::path& fileName)> saveSeg,
   std::function<
     bool(const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const SeedSegmentationType&)>
     executeGraphCutsSeg,
@@ -190,6 +197,7 @@ void ImGuiWrapper::setCallbacks(
   m_createBlankSeg = createBlankSeg;
   m_clearSeg = clearSeg;
   m_removeSeg = removeSeg;
+  m_saveSeg = saveSeg;
   m_executeGraphCutsSeg = executeGraphCutsSeg;
   m_executePoissonSeg = executePoissonSeg;
   m_setLockManualImageTransformation = setLockManualImageTransformation;
@@ -254,17 +262,14 @@ void ImGuiWrapper::generateIsosurfaceMeshGpuRecords()
     m_futures.erase(it);
 
     if ( AsyncTasks::IsosurfaceMeshGeneration != value.task ||
-            false == value.success ||
             ! value.imageUid || ! value.imageComponent || ! value.objectUid )
     {
       spdlog::error("Failed task {}", taskUid);
       continue;
     }
 
-    spdlog::info("Task {}: Start generating GPU mesh for isosurface {} ", taskUid, *value.objectUid);
-
     // Get the isosurface associated with this task
-    const Isosurface* surface
+    Isosurface* surface
       = m_appData.isosurface(*value.imageUid, *value.imageComponent, *value.objectUid);
 
     if (!surface)
@@ -275,6 +280,20 @@ void ImGuiWrapper::generateIsosurfaceMeshGpuRecords()
       continue;
     }
 
+    // The next mesh of the surface can now be generated
+    surface->meshPending = false;
+
+    if (!value.success)
+    {
+      spdlog::error("Failed task {}", taskUid);
+
+      // Do not retry generating the mesh until the isovalue changes
+      surface->meshInSync = true;
+      continue;
+    }
+
+    spdlog::info("Task {}: Start generating GPU mesh for isosurface {} ", taskUid, *value.objectUid);
+
     const MeshCpuRecord* cpuMeshRecord = surface->mesh.cpuData();
 
     if (!cpuMeshRecord)
@@ -285,6 +304,9 @@ void ImGuiWrapper::generateIsosurfaceMeshGpuRecords()
       continue;
     }
 
+    // The isovalue may have changed while the mesh was generated
+    surface->meshInSync = (cpuMeshRecord->meshInfo().isoValue() == surface->value);
+
     std::unique_ptr<MeshGpuRecord> gpuMeshRecord = gpuhelper::createMeshGpuRecordFromVtkPolyData(
       cpuMeshRecord->polyData(),
       cpuMeshRecord->meshInfo().primitiveType(),
@@ -301,27 +323,238 @@ void ImGuiWrapper::generateIsosurfaceMeshGpuRecords()
       continue;
     }
 
-    spdlog::info("Task {}: Done generating GPU mesh for isosurface {} ", taskUid, *value.objectUid);
-
     const bool updated = m_appData.updateIsosurfaceMeshGpuRecord(
       *value.imageUid, *value.imageComponent, *value.objectUid, std::move(gpuMeshRecord)
     );
 
-    if (updated)
+    if (!updated)
     {
-      spdlog::info(
-        "Updated GPU record for isosurface mesh {} of image {}", *value.objectUid, *value.imageUid
+      spdlog::error(
+        "Could not update GPU record for isosurface mesh {} of image {}",
+        *value.objectUid,
+        *value.imageUid
       );
+      continue;
+    }
+
+    spdlog::info("Task {}: Done generating GPU mesh for isosurface {} ", taskUid, *value.objectUid);
+  }
+}
+
+void ImGuiWrapper::addTaskToLabelMeshQueue(const uuids::uuid& taskUid)
+{
+  std::lock_guard<std::mutex> lock(m_labelMeshTaskQueueMutex);
+
+  m_labelMeshTaskQueue.push(taskUid);
+
+  // Post an empty event to notify render thread
+  if (m_postEmptyGlfwEvent)
+  {
+    m_postEmptyGlfwEvent();
+  }
+}
+
+bool ImGuiWrapper::generateLabelMeshes(const uuids::uuid& segUid)
+{
+  const Image* seg = m_appData.seg(segUid);
+  if (!seg)
+  {
+    return false;
+  }
+
+  // Tasks of a segmentation run one at a time, so that an older task never replaces the meshes
+  // of a newer one
+  if (m_segsWithPendingLabelMeshes.count(segUid) > 0)
+  {
+    m_segsWithStaleLabelMeshes.insert(segUid);
+    return true;
+  }
+
+  const auto tableUid = m_appData.labelTableUid(seg->settings().labelTableIndex());
+  const ParcellationLabelTable* table = tableUid ? m_appData.labelTable(*tableUid) : nullptr;
+
+  if (!table)
+  {
+    spdlog::error("Null label table for segmentation {}", segUid);
+    return false;
+  }
+
+  auto meshCpuRecordsUpdater = [this](const uuids::uuid& _segUid, LabelMeshCpuRecords records)
+  {
+    m_appData.setLabelMeshCpuRecords(_segUid, std::move(records));
+    return true;
+  };
+
+  const uuids::uuid taskUid = generateRandomUuid();
+  m_segsWithPendingLabelMeshes.insert(segUid);
+  m_labelMeshSegDataVersions[segUid] = seg->dataVersion();
+
+  storeFuture(
+    taskUid,
+    generateLabelMeshCpuRecords(
+      m_appData.taskScheduler(),
+      *seg,
+      segUid,
+      *table,
+      sk_labelMeshSmoothingIterations,
+      meshCpuRecordsUpdater,
+      std::bind(&ImGuiWrapper::addTaskToLabelMeshQueue, this, taskUid)
+    )
+  );
+
+  return true;
+}
+
+void ImGuiWrapper::collectLabelMeshes()
+{
+  std::vector<uuids::uuid> taskUids;
+
+  {
+    std::lock_guard<std::mutex> lock(m_labelMeshTaskQueueMutex);
+
+    while (!m_labelMeshTaskQueue.empty())
+    {
+      taskUids.push_back(m_labelMeshTaskQueue.front());
+      m_labelMeshTaskQueue.pop();
+    }
+  }
+
+  for (const uuids::uuid& taskUid : taskUids)
+  {
+    std::optional<AsyncTaskDetails> value;
+
+    {
+      std::lock_guard<std::mutex> lock(m_futuresMutex);
+
+      auto it = m_futures.find(taskUid);
+
+      if (std::end(m_futures) == it)
+      {
+        spdlog::error("Invalid task {}", taskUid);
+        continue;
+      }
+
+      // The task is done, since tasks only get on this queue when they end
+      try
+      {
+        value = it->second.get();
+      }
+      catch (const std::exception& e)
+      {
+        spdlog::error("Task {} failed: {}", taskUid, e.what());
+      }
+
+      m_futures.erase(it);
+    }
+
+    if (!value || AsyncTasks::LabelMeshGeneration != value->task || !value->imageUid)
+    {
+      spdlog::error("Failed task {}", taskUid);
+      continue;
+    }
+
+    const uuids::uuid segUid = *value->imageUid;
+    m_segsWithPendingLabelMeshes.erase(segUid);
+
+    if (!m_appData.seg(segUid))
+    {
+      // The segmentation was removed while its meshes were generated
+      m_appData.setLabelMeshCpuRecords(segUid, LabelMeshCpuRecords());
+      m_segsWithStaleLabelMeshes.erase(segUid);
+      m_labelMeshSegDataVersions.erase(segUid);
+      continue;
+    }
+
+    if (value->success)
+    {
+      uploadLabelMeshes(segUid);
     }
     else
+    {
+      spdlog::error("Failed to generate label meshes of segmentation {}", segUid);
+    }
+
+    if (m_segsWithStaleLabelMeshes.erase(segUid) > 0)
+    {
+      generateLabelMeshes(segUid);
+    }
+  }
+
+  // Meshes of segmentations that were edited since their meshes were generated are generated
+  // again. Segmentations with pending meshes are checked once their tasks are collected.
+  auto it = std::begin(m_labelMeshSegDataVersions);
+
+  while (std::end(m_labelMeshSegDataVersions) != it)
+  {
+    const uuids::uuid segUid = it->first;
+    const Image* seg = m_appData.seg(segUid);
+
+    if (!seg)
+    {
+      it = m_labelMeshSegDataVersions.erase(it);
+      continue;
+    }
+
+    const bool stale = (seg->dataVersion() != it->second);
+    ++it;
+
+    if (stale && 0 == m_segsWithPendingLabelMeshes.count(segUid) && showsLabelMeshes(segUid))
+    {
+      generateLabelMeshes(segUid);
+    }
+  }
+}
+
+void ImGuiWrapper::uploadLabelMeshes(const uuids::uuid& segUid)
+{
+  std::map<LabelType, std::unique_ptr<MeshGpuRecord> > gpuRecords;
+
+  for (const auto& [label, cpuRecord] : m_appData.labelMeshCpuRecords(segUid))
+  {
+    auto gpuRecord = gpuhelper::createMeshGpuRecordFromVtkPolyData(
+      cpuRecord->polyData(), cpuRecord->meshInfo().primitiveType(), BufferUsagePattern::StaticDraw
+    );
+
+    if (!gpuRecord)
     {
       spdlog::error(
-        "Could not update GPU record for isosurface mesh {} of image {}",
-        *value.objectUid,
-        *value.imageUid
+        "Error generating GPU mesh record for label {} of segmentation {}", label, segUid
       );
+      continue;
+    }
+
+    gpuRecords.emplace(label, std::move(gpuRecord));
+  }
+
+  // The GPU records left from the previous meshes are destroyed here, on the render thread
+  m_appData.setLabelMeshGpuRecords(segUid, std::move(gpuRecords));
+}
+
+bool ImGuiWrapper::showsLabelMeshes(const uuids::uuid& segUid) const
+{
+  const Image* seg = m_appData.seg(segUid);
+  if (!seg)
+  {
+    return false;
+  }
+
+  const auto tableUid = m_appData.labelTableUid(seg->settings().labelTableIndex());
+  const ParcellationLabelTable* table = tableUid ? m_appData.labelTable(*tableUid) : nullptr;
+
+  if (!table)
+  {
+    return false;
+  }
+
+  for (std::size_t i = 1; i < table->numLabels(); ++i)
+  {
+    if (table->getShowMesh(i))
+    {
+      return true;
     }
   }
+
+  return false;
 }
 
 /*
@@ -579,6 +812,7 @@ void ImGuiWrapper::render()
   using namespace std::placeholders;
 
   generateIsosurfaceMeshGpuRecords();
+  collectLabelMeshes();
 
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
@@ -875,9 +1109,15 @@ void ImGuiWrapper::render()
         m_updateImageUniforms,
         m_updateLabelColorTableTexture,
         m_moveCrosshairsToSegLabelCentroid,
+        [this](const uuids::uuid& imageUid, const uuids::uuid& segUid)
+        { return m_callbackHandler.segLabelStatistics(imageUid, segUid); },
         m_createBlankSeg,
         m_clearSeg,
         m_removeSeg,
+        m_saveSeg,
+        [this](const uuids::uuid& segUid, const MorphologyParams& params)
+        { return m_callbackHandler.applySegMorphology(segUid, params); },
+        [this](const uuids::uuid& segUid) { return generateLabelMeshes(segUid); },
         m_recenterAllViews
       );
     }
@@ -902,6 +1142,11 @@ void ImGuiWrapper::render()
       renderOpacityBlenderWindow(m_appData, m_updateImageUniforms);
     }
 
+    if (m_appData.guiData().m_showProfilerWindow)
+    {
+      renderProfilerWindow(m_appData);
+    }
+
     renderModeToolbar(
       m_appData,
       getMouseMode,
@@ -927,7 +1172,6 @@ void ImGuiWrapper::render()
       getImageHasActiveSeg,
       setImageHasActiveSeg,
       m_readjustViewport,
-      m_updateImageUniforms,
       m_executeGraphCutsSeg,
       m_executePoissonSeg
     );
@@ -2,17 +2,20 @@
 #define IMGUI_WRAPPER_H
 
 #include "common/AsyncTasks.h"
+#include "common/filesystem.h"
 #include "common/PublicTypes.h"
 #include "common/SegmentationTypes.h"
 
 #include <glm/fwd.hpp>
 #include <uuid.h>
 
+#include <cstdint>
 #include <functional>
 #include <future>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 class AppData;
@@ -60,6 +63,7 @@ public:
     )> createBlankSeg,
     std::function<bool(const uuids::uuid& segUid)> clearSeg,
     std::function<bool(const uuids::uuid& segUid)> removeSeg,
+    std::function<bool(const uuids::uuid& segUid, const fs::path& fileName)> saveSeg,
     std::function<bool(
       const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const SeedSegmentationType& segType
     )> executeGraphCutsSeg,
@@ -110,6 +114,7 @@ private:
     m_createBlankSeg = nullptr;
   std::function<bool(const uuids::uuid& segUid)> m_clearSeg = nullptr;
   std::function<bool(const uuids::uuid& segUid)> m_removeSeg = nullptr;
+  std::function<bool(const uuids::uuid& segUid, const fs::path& fileName)> m_saveSeg = nullptr;
   std::function<
     bool(const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const SeedSegmentationType&)>
     m_executeGraphCutsSeg = nullptr;
@@ -146,9 +151,48 @@ private:
   /// Generate GPU mesh records for isosurfaces in \c m_isosurfaceTaskQueueForGpuMeshGeneration
   void generateIsosurfaceMeshGpuRecords();
 
+  /// Queue of UIDs of finished label mesh generation tasks, whose results are collected on the
+  /// render thread
+  std::queue<uuids::uuid> m_labelMeshTaskQueue;
+
+  /// Mutex protecting \c m_labelMeshTaskQueue
+  std::mutex m_labelMeshTaskQueueMutex;
+
+  /// Segmentations whose label meshes are being generated. The set is only used on the render
+  /// thread.
+  std::unordered_set<uuids::uuid> m_segsWithPendingLabelMeshes;
+
+  /// Segmentations whose label tables changed which meshes are shown while their label meshes
+  /// were generated, so that they are generated again when the pending task is done
+  std::unordered_set<uuids::uuid> m_segsWithStaleLabelMeshes;
+
+  /// Data versions of the segmentations from which their label meshes were last generated, so
+  /// that the meshes are generated again after the segmentations are edited
+  std::unordered_map<uuids::uuid, uint64_t> m_labelMeshSegDataVersions;
+
+  /// Update \c m_labelMeshTaskQueue with a new task UID. This is called once the label meshes
+  /// are generated.
+  void addTaskToLabelMeshQueue(const uuids::uuid& taskUid);
+
+  /// Generate the meshes of the labels of a segmentation whose meshes are shown in its label
+  /// table, in the background. If meshes of the segmentation are being generated, then the
+  /// meshes are generated again once they are done.
+  /// @return True iff generation of the meshes started or is deferred
+  bool generateLabelMeshes(const uuids::uuid& segUid);
+
+  /// Collect the results of the tasks in \c m_labelMeshTaskQueue, and generate the label meshes
+  /// of segmentations that were edited since their meshes were generated
+  void collectLabelMeshes();
+
+  /// Create the GPU records of the label meshes of a segmentation from its CPU records
+  void uploadLabelMeshes(const uuids::uuid& segUid);
+
+  /// Does the label table of a segmentation show the mesh of any label?
+  bool showsLabelMeshes(const uuids::uuid& segUid) const;
+
   /**
-     * @brief Store futures from UI tasks in \c m_futures map. Futures need to be stored so that their
-     * destructors are not called. Calling the destructor of a future causes us to wait on the it.
+     * @brief Store futures from UI tasks in \c m_futures map. Futures need to be stored so that the
+     * results of the tasks can be retrieved once the tasks are done.
      *
      * @param taskUid UID of the task
      * @param future The future
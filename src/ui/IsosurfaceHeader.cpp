@@ -159,6 +159,76 @@ bool compareWithSortSpecs(
   return (a.m_surface->value > b.m_surface->value);
 }
 
+/**
+ * @brief Start generating the mesh of an isosurface at its current value. Only one mesh of a
+ * surface is generated at a time: the surface is marked pending until the render thread collects
+ * the result, after which a new mesh is generated if the value changed in the meantime.
+ */
+void generateSurfaceMesh(
+  AppData& appData,
+  const Image& image,
+  const uuids::uuid& imageUid,
+  uint32_t component,
+  const uuids::uuid& isosurfaceUid,
+  Isosurface& surface,
+  std::function<void(const uuids::uuid& taskUid, std::future<AsyncTaskDetails> future)> storeFuture,
+  std::function<void(const uuids::uuid& taskUid)> addTaskToIsosurfaceGpuMeshGenerationQueue
+)
+{
+  // Function to update the mesh record in AppData after the mesh is generated.
+  // The UIDs are captured by value, since the function is called asynchronously.
+  auto meshCpuRecordUpdater =
+    [&appData,
+     imageUid,
+     component](const uuids::uuid& _isosurfaceUid, std::unique_ptr<MeshCpuRecord> meshCpuRecord)
+    -> bool
+  {
+    if (appData.updateIsosurfaceMeshCpuRecord(
+          imageUid, component, _isosurfaceUid, std::move(meshCpuRecord)
+        ))
+    {
+      spdlog::debug(
+        "Updated isosurface {} for image {} (component {}) with new mesh record",
+        _isosurfaceUid,
+        imageUid,
+        component
+      );
+      return true;
+    }
+
+    spdlog::error(
+      "Error updating isosurface {} for image {} (component {}) with new mesh record",
+      _isosurfaceUid,
+      imageUid,
+      component
+    );
+
+    return false;
+  };
+
+  surface.meshPending = true;
+
+  // Generate a new UID for the mesh generation task
+  uuids::uuid taskUid = generateRandomUuid();
+
+  // Store the future, so that the render thread can get the task result when the mesh is done.
+  // Note: Bind the task ID to addTaskToIsosurfaceGpuMeshGenerationQueue
+  storeFuture(
+    taskUid,
+    generateIsosurfaceMeshCpuRecord(
+      appData.taskScheduler(),
+      image,
+      imageUid,
+      component,
+      surface.value,
+      isosurfaceUid,
+      Isosurface::sk_maxMeshTriangles,
+      meshCpuRecordUpdater,
+      std::bind(addTaskToIsosurfaceGpuMeshGenerationQueue, taskUid)
+    )
+  );
+}
+
 std::optional<uuids::uuid> addNewSurface(
   AppData& appData,
   const Image* image,
@@ -185,6 +255,8 @@ std::optional<uuids::uuid> addNewSurface(
   surface.opacity = 1.0f;
   surface.meshInSync = false;
 
+  const double value = surface.value;
+
   if (const auto isosurfaceUid = appData.addIsosurface(imageUid, component, std::move(surface)))
   {
     spdlog::debug(
@@ -192,57 +264,22 @@ std::optional<uuids::uuid> addNewSurface(
       *isosurfaceUid,
       imageUid,
       component,
-      surface.value
+      value
     );
 
-    // Function to update the mesh record in AppData after the mesh is generated
-    auto meshCpuRecordUpdater =
-      [&appData,
-       &imageUid,
-       component](const uuids::uuid& _isosurfaceUid, std::unique_ptr<MeshCpuRecord> meshCpuRecord)
-      -> bool
+    if (Isosurface* addedSurface = appData.isosurface(imageUid, component, *isosurfaceUid))
     {
-      if (appData.updateIsosurfaceMeshCpuRecord(
-            imageUid, component, _isosurfaceUid, std::move(meshCpuRecord)
-          ))
-      {
-        spdlog::debug(
-          "Updated isosurface {} for image {} (component {}) with new mesh record",
-          _isosurfaceUid,
-          imageUid,
-          component
-        );
-        return true;
-      }
-
-      spdlog::error(
-        "Error updating isosurface {} for image {} (component {}) with new mesh record",
-        _isosurfaceUid,
-        imageUid,
-        component
-      );
-
-      return false;
-    };
-
-    // Generate a new UID for the mesh generation task
-    uuids::uuid taskUid = generateRandomUuid();
-
-    // Need to store the future so that its destructor is not called.
-    // Calling the destructor will cause us to wait on the future.
-    // Note: Bind the task ID to addTaskToIsosurfaceGpuMeshGenerationQueue
-    storeFuture(
-      taskUid,
-      generateIsosurfaceMeshCpuRecord(
+      generateSurfaceMesh(
+        appData,
         *image,
         imageUid,
         component,
-        surface.value,
         *isosurfaceUid,
-        meshCpuRecordUpdater,
-        std::bind(addTaskToIsosurfaceGpuMeshGenerationQueue, taskUid)
-      )
-    );
+        *addedSurface,
+        storeFuture,
+        addTaskToIsosurfaceGpuMeshGenerationQueue
+      );
+    }
 
     return isosurfaceUid;
   }
@@ -453,6 +490,21 @@ void renderIsosurfacesHeader(
 
     tableItems.push_back(IsosurfaceTableItem(uid, surface));
 
+    // Regenerate the mesh of a surface whose value changed once its previous mesh is collected
+    if (!surface->meshInSync && !surface->meshPending)
+    {
+      generateSurfaceMesh(
+        appData,
+        *image,
+        imageUid,
+        componentToAdjust,
+        uid,
+        *surface,
+        storeFuture,
+        addTaskToIsosurfaceGpuMeshGenerationQueue
+      );
+    }
+
     // The selected UID is valid if there is a surface with this UID
     validSelectedUid = validSelectedUid | (selectedSurfaceUid && *selectedSurfaceUid == uid);
   }
@@ -592,6 +644,7 @@ void renderIsosurfacesHeader(
           if (stats.m_minimum <= value && value <= stats.m_maximum)
           {
             item.m_surface->value = value;
+            item.m_surface->meshInSync = false;
           }
 
           // To avoid triggering a sort while holding the button;
@@ -686,7 +739,8 @@ void renderIsosurfacesHeader(
             appData.guiData().m_imageValuePrecisionFormat.c_str()
           ))
       {
-        // updateImageUniforms();
+        // The mesh is regenerated while the slider is dragged
+        surface->meshInSync = false;
       }
       ImGui::SameLine();
       helpMarker("Surface iso-value");
@@ -164,6 +164,14 @@ void renderConfirmCloseAppPopup(AppData& appData)
   if (ImGui::BeginPopupModal("Quit?", nullptr, ImGuiWindowFlags_Modal | ImGuiWindowFlags_NoDecoration))
   {
     ImGui::Text("Do you want to quit?");
+
+    if (const std::size_t numSaving = appData.guiData().m_savingSegUids.size(); numSaving > 0)
+    {
+      ImGui::Text(
+        "%zu segmentation(s) are being saved. Quitting waits for the saves to finish.", numSaving
+      );
+    }
+
     ImGui::Separator();
 
     ImGui::SetNextItemWidth(-1.0f);
@@ -688,7 +688,6 @@ void renderSegToolbar(
   const std::function<bool(size_t imageIndex)>& getImageHasActiveSeg,
   const std::function<void(size_t imageIndex, bool set)>& setImageHasActiveSeg,
   const std::function<void(void)>& readjustViewport,
-  const std::function<void(const uuids::uuid& imageUid)>& updateImageUniforms,
   const std::function<
     bool(const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const SeedSegmentationType&)>&
     executeGraphCutsSeg,
@@ -701,7 +700,8 @@ void renderSegToolbar(
   // in Annotation mode (when the Fill button is also visible),
   // or when the Annotations Window is visible
 
-  const bool inSegmentationMode = (MouseMode::Segment == appData.state().mouseMode());
+  const bool inSegmentationMode = (MouseMode::Segment == appData.state().mouseMode()
+                                   || MouseMode::RegionGrow == appData.state().mouseMode());
   const bool inAnnotationMode
     = (state::isInStateWhereToolbarVisible() && state::showToolbarFillButton());
 
@@ -1234,6 +1234,18 @@ void renderSegToolbar(
         ImGui::SameLine();
         helpMarker("Crosshairs movement is linked with brush movement");
 
+        int undoBudget = static_cast<int>(appData.settings().segUndoMemoryBudgetInMiB());
+        if (ImGui::InputInt("Undo memory (MiB)", &undoBudget))
+        {
+          undoBudget = std::max(undoBudget, 0);
+          appData.settings().setSegUndoMemoryBudgetInMiB(static_cast<std::size_t>(undoBudget));
+        }
+        ImGui::SameLine();
+        helpMarker(
+          "Maximum memory used to undo segmentation edits (Ctrl+Z) and redo them (Ctrl+Shift+Z). "
+          "The oldest edits are forgotten first."
+        );
+
         ImGui::Spacing();
         ImGui::Spacing();
 
@@ -1284,6 +1296,139 @@ void renderSegToolbar(
         ImGui::SameLine();
         helpMarker("Set 3D neighborhood type for graph construction");
 
+        int numThreads = static_cast<int>(appData.settings().graphCutsNumThreads());
+        if (ImGui::InputInt("Threads", &numThreads))
+        {
+          numThreads = std::max(numThreads, 0);
+          appData.settings().setGraphCutsNumThreads(static_cast<std::size_t>(numThreads));
+        }
+        ImGui::SameLine();
+        helpMarker("Number of threads used to segment (0: one per processor core; 1: serial)");
+
+        int blockSize = appData.settings().graphCutsBlockSize();
+        if (ImGui::InputInt("Block size", &blockSize))
+        {
+          appData.settings().setGraphCutsBlockSize(std::max(blockSize, 0));
+        }
+        ImGui::SameLine();
+        helpMarker(
+          "Side length (in voxels) of the blocks processed by the multi-threaded solver "
+          "for the 6-neighborhood (0: automatic)"
+        );
+
+        ImGui::Spacing();
+        ImGui::Spacing();
+
+        ImGui::Text("Seed segmentation region:");
+
+        ImGui::Separator();
+        ImGui::Spacing();
+
+        bool cropToSeeds = appData.settings().seedSegmentationCropToSeeds();
+        if (ImGui::Checkbox("Crop to seeds", &cropToSeeds))
+        {
+          appData.settings().setSeedSegmentationCropToSeeds(cropToSeeds);
+        }
+        ImGui::SameLine();
+        helpMarker(
+          "Segment only the bounding box of the seeds, padded on all sides. "
+          "Voxels outside of it are background."
+        );
+
+        int cropPadding = appData.settings().seedSegmentationCropPadding();
+        if (ImGui::InputInt("Crop padding", &cropPadding))
+        {
+          appData.settings().setSeedSegmentationCropPadding(std::max(cropPadding, 0));
+        }
+        ImGui::SameLine();
+        helpMarker("Padding (in voxels) of the bounding box of the seeds");
+
+        ImGui::Spacing();
+        ImGui::Spacing();
+
+        ImGui::Text("Region growing:");
+
+        ImGui::Separator();
+        ImGui::Spacing();
+
+        RegionGrowThreshold growThreshold = appData.settings().regionGrowThreshold();
+
+        if (ImGui::RadioButton("Window", RegionGrowThreshold::WindowLevel == growThreshold))
+        {
+          growThreshold = RegionGrowThreshold::WindowLevel;
+          appData.settings().setRegionGrowThreshold(growThreshold);
+        }
+
+        ImGui::SameLine();
+        if (ImGui::RadioButton("Seed value", RegionGrowThreshold::SeedValue == growThreshold))
+        {
+          growThreshold = RegionGrowThreshold::SeedValue;
+          appData.settings().setRegionGrowThreshold(growThreshold);
+        }
+        ImGui::SameLine();
+        helpMarker(
+          "Grow through voxels with values either in the image window or within a tolerance of "
+          "the value of the seed voxel"
+        );
+
+        if (RegionGrowThreshold::SeedValue == growThreshold)
+        {
+          double tolerance = appData.settings().regionGrowSeedTolerance();
+          if (ImGui::InputDouble("Tolerance", &tolerance, 1.0, 10.0, "%.3f"))
+          {
+            appData.settings().setRegionGrowSeedTolerance(tolerance);
+          }
+          ImGui::SameLine();
+          helpMarker("Tolerance (in image intensity units) about the value of the seed voxel");
+        }
+
+        RegionGrowConnectivity growHood = appData.settings().regionGrowConnectivity();
+
+        ImGui::Text("Connectivity: ");
+        ImGui::SameLine();
+        if (ImGui::RadioButton("6##growHood", RegionGrowConnectivity::Neighbors6 == growHood))
+        {
+          growHood = RegionGrowConnectivity::Neighbors6;
+          appData.settings().setRegionGrowConnectivity(growHood);
+        }
+
+        ImGui::SameLine();
+        if (ImGui::RadioButton("18##growHood", RegionGrowConnectivity::Neighbors18 == growHood))
+        {
+          growHood = RegionGrowConnectivity::Neighbors18;
+          appData.settings().setRegionGrowConnectivity(growHood);
+        }
+
+        ImGui::SameLine();
+        if (ImGui::RadioButton("26##growHood", RegionGrowConnectivity::Neighbors26 == growHood))
+        {
+          growHood = RegionGrowConnectivity::Neighbors26;
+          appData.settings().setRegionGrowConnectivity(growHood);
+        }
+        ImGui::SameLine();
+        helpMarker("Neighborhood of the voxels through which the region grows");
+
+        bool grow3d = appData.settings().regionGrow3d();
+
+        if (ImGui::RadioButton("2D##growDim", !grow3d))
+        {
+          grow3d = false;
+          appData.settings().setRegionGrow3d(grow3d);
+        }
+
+        ImGui::SameLine();
+        if (ImGui::RadioButton("3D##growDim", grow3d))
+        {
+          grow3d = true;
+          appData.settings().setRegionGrow3d(grow3d);
+        }
+        ImGui::SameLine();
+        helpMarker(
+          "Grow either in the voxel slice of the view (2D) or in the volume (3D). "
+          "With 'Replace background with foreground', the region only grows through the "
+          "background label."
+        );
+
         ImGui::EndPopup();
       }
 
@@ -1333,58 +1478,77 @@ void renderSegToolbar(
         ImGui::SetTooltip("%s", "Synchronize drawing of segmentations on multiple images");
       }
 
-      if (isHoriz)
-        ImGui::SameLine();
-      if (ImGui::Button(ICON_FK_CUBE, buttonSize))
+      // While a seed segmentation runs in the background, a button that cancels it replaces
+      // the buttons that execute seed segmentations
+      if (const auto seedSegTask = appData.state().seedSegmentationTask())
       {
-        const auto imageUid = appData.activeImageUid();
-        const auto seedSegUid = appData.imageToActiveSegUid(*imageUid);
-
-        if (imageUid && seedSegUid)
+        if (isHoriz)
+          ImGui::SameLine();
+        if (ImGui::Button(ICON_FK_TIMES, buttonSize))
         {
-          executeGraphCutsSeg(*imageUid, *seedSegUid, SeedSegmentationType::Binary);
-          updateImageUniforms(*imageUid);
+          seedSegTask->cancel();
+        }
+        if (ImGui::IsItemHovered())
+        {
+          ImGui::SetTooltip(
+            "%s (%d%% done)\nCancel segmentation",
+            appData.state().seedSegmentationStatus().c_str(),
+            static_cast<int>(100.0f * seedSegTask->progress())
+          );
         }
       }
-      if (ImGui::IsItemHovered())
+      else
       {
-        ImGui::SetTooltip("%s", "Execute binary Graph Cuts segmentation");
-      }
+        if (isHoriz)
+          ImGui::SameLine();
+        if (ImGui::Button(ICON_FK_CUBE, buttonSize))
+        {
+          const auto imageUid = appData.activeImageUid();
+          const auto seedSegUid = imageUid ? appData.imageToActiveSegUid(*imageUid) : std::nullopt;
 
-      if (isHoriz)
-        ImGui::SameLine();
-      if (ImGui::Button(ICON_FK_CUBES, buttonSize))
-      {
-        const auto imageUid = appData.activeImageUid();
-        const auto seedSegUid = appData.imageToActiveSegUid(*imageUid);
+          if (imageUid && seedSegUid)
+          {
+            executeGraphCutsSeg(*imageUid, *seedSegUid, SeedSegmentationType::Binary);
+          }
+        }
+        if (ImGui::IsItemHovered())
+        {
+          ImGui::SetTooltip("%s", "Execute binary Graph Cuts segmentation");
+        }
 
-        if (imageUid && seedSegUid)
+        if (isHoriz)
+          ImGui::SameLine();
+        if (ImGui::Button(ICON_FK_CUBES, buttonSize))
         {
-          executeGraphCutsSeg(*imageUid, *seedSegUid, SeedSegmentationType::MultiLabel);
-          updateImageUniforms(*imageUid);
+          const auto imageUid = appData.activeImageUid();
+          const auto seedSegUid = imageUid ? appData.imageToActiveSegUid(*imageUid) : std::nullopt;
+
+          if (imageUid && seedSegUid)
+          {
+            executeGraphCutsSeg(*imageUid, *seedSegUid, SeedSegmentationType::MultiLabel);
+          }
+        }
+        if (ImGui::IsItemHovered())
+        {
+          ImGui::SetTooltip("%s", "Execute multi-label Graph Cuts segmentation");
         }
-      }
-      if (ImGui::IsItemHovered())
-      {
-        ImGui::SetTooltip("%s", "Execute multi-label Graph Cuts segmentation");
-      }
 
-      if (isHoriz)
-        ImGui::SameLine();
-      if (ImGui::Button(ICON_FK_PLUG, buttonSize))
-      {
-        if (const auto imageUid = appData.activeImageUid())
+        if (isHoriz)
+          ImGui::SameLine();
+        if (ImGui::Button(ICON_FK_PLUG, buttonSize))
         {
-          if (const auto seedSegUid = appData.imageToActiveSegUid(*imageUid))
+          if (const auto imageUid = appData.activeImageUid())
           {
-            executePoissonSeg(*imageUid, *seedSegUid, SeedSegmentationType::Binary);
-            updateImageUniforms(*imageUid);
+            if (const auto seedSegUid = appData.imageToActiveSegUid(*imageUid))
+            {
+              executePoissonSeg(*imageUid, *seedSegUid, SeedSegmentationType::Binary);
+            }
           }
         }
-      }
-      if (ImGui::IsItemHovered())
-      {
-        ImGui::SetTooltip("%s", "Execute multi-label Poisson segmentation");
+        if (ImGui::IsItemHovered())
+        {
+          ImGui::SetTooltip("%s", "Execute multi-label Poisson segmentation");
+        }
       }
     }
 
@@ -4,10 +4,14 @@
 
 #include "common/MathFuncs.h"
 
+#include "image/Image.h"
 #include "image/ImageColorMap.h"
+#include "image/ImageSettings.h"
 #include "image/ImageTransformations.h"
+#include "image/ImageUtility.h"
 
 #include "logic/app/Data.h"
+#include "logic/segmentation/LabelStatistics.h"
 
 #include <imgui/imgui.h>
 #include <imgui/imgui_internal.h>
@@ -22,10 +26,16 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/color_space.hpp>
 
+#include <implot.h>
+
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 #include <string>
+#include <vector>
 
 void renderActiveImageSelectionCombo(
   size_t numImages,
@@ -82,7 +92,8 @@ void renderSegLabelsChildWindow(
   std::size_t tableIndex,
   ParcellationLabelTable* labelTable,
   const std::function<void(std::size_t tableIndex)>& updateLabelColorTableTexture,
-  const std::function<void(std::size_t labelIndex)>& moveCrosshairsToSegLabelCentroid
+  const std::function<void(std::size_t labelIndex)>& moveCrosshairsToSegLabelCentroid,
+  const std::function<void(void)>& updateLabelMeshes
 )
 {
   static const std::string sk_showAll = std::string(ICON_FK_EYE) + " Show all";
@@ -168,6 +179,27 @@ void renderSegLabelsChildWindow(
       updateLabelColorTableTexture(tableIndex);
     }
 
+    // The background label has no mesh
+    ImGui::SameLine();
+    if (0 == i)
+    {
+      ImGui::Dummy(ImVec2(ImGui::GetFrameHeight(), ImGui::GetFrameHeight()));
+    }
+    else
+    {
+      bool labelShowMesh = labelTable->getShowMesh(i);
+
+      if (ImGui::Checkbox("##labelMesh", &labelShowMesh))
+      {
+        labelTable->setShowMesh(i, labelShowMesh);
+        updateLabelMeshes();
+      }
+      if (ImGui::IsItemHovered())
+      {
+        ImGui::SetTooltip("Show the mesh of the label in 3D views");
+      }
+    }
+
     ImGui::SameLine();
     if (ImGui::ColorEdit4(labelIndexBuffer, glm::value_ptr(labelColor), sk_colorEditFlags))
     {
@@ -217,6 +249,101 @@ void renderSegLabelsChildWindow(
   ImGui::EndChild();
 }
 
+void renderSegLabelStatisticsChildWindow(
+  const LabelStatistics* stats,
+  const ParcellationLabelTable* labelTable,
+  const std::function<void(std::size_t labelIndex)>& moveCrosshairsToSegLabelCentroid
+)
+{
+  static const ImGuiTableFlags sk_tableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg
+                                               | ImGuiTableFlags_ScrollY
+                                               | ImGuiTableFlags_SizingFixedFit;
+
+  if (!stats)
+  {
+    ImGui::Text("Statistics are not available for this segmentation");
+    return;
+  }
+
+  if (stats->labels().empty())
+  {
+    ImGui::Text("The segmentation has no labeled voxels");
+    return;
+  }
+
+  const int numColumns = stats->hasIntensity() ? 7 : 6;
+
+  if (!ImGui::BeginTable("##labelStatistics", numColumns, sk_tableFlags, ImVec2(0.0f, 250.0f)))
+  {
+    return;
+  }
+
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, 25.0f);
+  ImGui::TableSetupColumn("Label", ImGuiTableColumnFlags_WidthFixed, 150.0f);
+  ImGui::TableSetupColumn("Voxels", ImGuiTableColumnFlags_WidthFixed, 75.0f);
+  ImGui::TableSetupColumn("Volume (mm^3)", ImGuiTableColumnFlags_WidthFixed, 100.0f);
+  ImGui::TableSetupColumn("Centroid (voxel)", ImGuiTableColumnFlags_WidthFixed, 150.0f);
+  ImGui::TableSetupColumn("Box size (voxels)", ImGuiTableColumnFlags_WidthFixed, 125.0f);
+
+  if (stats->hasIntensity())
+  {
+    ImGui::TableSetupColumn("Intensity (mean, SD)", ImGuiTableColumnFlags_WidthFixed, 150.0f);
+  }
+
+  ImGui::TableHeadersRow();
+
+  for (const auto& [label, s] : stats->labels())
+  {
+    const std::size_t labelIndex = static_cast<std::size_t>(label);
+
+    ImGui::PushID(static_cast<int>(label)); /*** PushID label ***/
+    ImGui::TableNextRow();
+
+    ImGui::TableNextColumn();
+    if (ImGui::SmallButton(ICON_FK_HAND_O_UP))
+    {
+      moveCrosshairsToSegLabelCentroid(labelIndex);
+    }
+    if (ImGui::IsItemHovered())
+    {
+      ImGui::SetTooltip("Move crosshairs to segmentation label centroid");
+    }
+
+    ImGui::TableNextColumn();
+    if (labelTable && labelIndex < labelTable->numLabels())
+    {
+      ImGui::Text("%03zu %s", labelIndex, labelTable->getName(labelIndex).c_str());
+    }
+    else
+    {
+      ImGui::Text("%03zu", labelIndex);
+    }
+
+    const glm::dvec3 centroid = s.centroid();
+    const glm::ivec3 boxSize = s.m_boxMax - s.m_boxMin + 1;
+
+    ImGui::TableNextColumn();
+    ImGui::Text("%zu", s.m_numVoxels);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", static_cast<double>(s.m_numVoxels) * stats->voxelVolume());
+    ImGui::TableNextColumn();
+    ImGui::Text("(%.1f, %.1f, %.1f)", centroid.x, centroid.y, centroid.z);
+    ImGui::TableNextColumn();
+    ImGui::Text("%d x %d x %d", boxSize.x, boxSize.y, boxSize.z);
+
+    if (stats->hasIntensity())
+    {
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f, %.3f", s.meanIntensity(), s.stdDevIntensity());
+    }
+
+    ImGui::PopID(); /*** PopID label ***/
+  }
+
+  ImGui::EndTable();
+}
+
 void renderPaletteWindow(
   const char* name,
   bool* showPaletteWindow,
@@ -371,7 +498,7 @@ void renderLandmarkChildWindow(
 
   const char* coordFormat = appData.guiData().m_coordsPrecisionFormat.c_str();
 
-  std::map<size_t, PointRecord<glm::vec3> >& points = activeLmGroup->getPoints();
+  const std::map<size_t, PointRecord<glm::vec3> >& points = activeLmGroup->getPoints();
 
   const bool childVisible = ImGui::BeginChild(
     "", ImVec2(375, 300), true, ImGuiWindowFlags_MenuBar | ImGuiWindowFlags_HorizontalScrollbar
@@ -421,18 +548,12 @@ void renderLandmarkChildWindow(
 
     if (ImGui::MenuItem(sk_showAll.c_str()))
     {
-      for (auto& p : points)
-      {
-        p.second.setVisibility(true);
-      }
+      activeLmGroup->setPointsVisibility(true);
     }
 
     if (ImGui::MenuItem(sk_hideAll.c_str()))
     {
-      for (auto& p : points)
-      {
-        p.second.setVisibility(false);
-      }
+      activeLmGroup->setPointsVisibility(false);
     }
 
     ImGui::EndMenuBar();
@@ -440,10 +561,10 @@ void renderLandmarkChildWindow(
 
   char pointIndexBuffer[8];
 
-  for (auto& p : points)
+  for (const auto& p : points)
   {
     const size_t pointIndex = p.first;
-    auto& point = p.second;
+    const auto& point = p.second;
 
     snprintf(pointIndexBuffer, 8, "%03zu", pointIndex);
 
@@ -456,7 +577,7 @@ void renderLandmarkChildWindow(
 
     if (ImGui::Checkbox(pointIndexBuffer, &pointVisible))
     {
-      point.setVisibility(pointVisible);
+      activeLmGroup->setPointVisibility(pointIndex, pointVisible);
     }
 
     if (!activeLmGroup->getColorOverride())
@@ -464,7 +585,7 @@ void renderLandmarkChildWindow(
       ImGui::SameLine();
       if (ImGui::ColorEdit3("", glm::value_ptr(pointColor), sk_colorEditFlags))
       {
-        point.setColor(pointColor);
+        activeLmGroup->setPointColor(pointIndex, pointColor);
       }
     }
 
@@ -499,7 +620,7 @@ void renderLandmarkChildWindow(
 
       const glm::vec4 lmPos = landmark_T_world * glm::vec4{worldCrosshairsPos, 1.0f};
 
-      point.setPosition(glm::vec3{lmPos / lmPos.w});
+      activeLmGroup->setPointPosition(pointIndex, glm::vec3{lmPos / lmPos.w});
     }
     if (ImGui::IsItemHovered())
     {
@@ -532,7 +653,7 @@ void renderLandmarkChildWindow(
       ImGui::PushItemWidth(100.0f);
       if (ImGui::InputText("##pointName", &pointName))
       {
-        point.setName(pointName);
+        activeLmGroup->setPointName(pointIndex, pointName);
       }
       ImGui::PopItemWidth();
       if (ImGui::IsItemHovered())
@@ -547,7 +668,7 @@ void renderLandmarkChildWindow(
     ImGui::PushItemWidth(200.0f);
     if (ImGui::InputFloat3("##pointPos", glm::value_ptr(pointPos), coordFormat, 0))
     {
-      point.setPosition(pointPos);
+      activeLmGroup->setPointPosition(pointIndex, pointPos);
     }
 
     if (ImGui::IsItemHovered())
@@ -579,3 +700,252 @@ void renderLandmarkChildWindow(
 
   ImGui::EndChild();
 }
+
+void drawImageHistogram(
+  const Image& image,
+  uint32_t comp,
+  ImageSettings& settings,
+  const std::string& imagePrecisionFormat
+)
+{
+  // Maximum number of bins, which bounds the memory used to bin the values
+  static constexpr int sk_maxNumBins = 65536;
+
+  HistogramSettings& histoSettings = settings.histogramSettings(comp);
+
+  std::string plotTitle;
+
+  if (histoSettings.m_isCumulative)
+  {
+    plotTitle = "Cumulative Histogram";
+    if (histoSettings.m_isDensity)
+    {
+      plotTitle += " Density";
+    }
+  }
+  else
+  {
+    plotTitle = "Histogram";
+    if (histoSettings.m_isDensity)
+    {
+      plotTitle += " Density";
+    }
+  }
+
+  std::string countAxisLabel;
+  if (histoSettings.m_isLogScale)
+  {
+    countAxisLabel = (histoSettings.m_isDensity) ? "log(Probability)" : "log(Count)";
+  }
+  else
+  {
+    countAxisLabel = (histoSettings.m_isDensity) ? "Probability" : "Count";
+  }
+
+  const double intensityAxisMin = (histoSettings.m_useCustomIntensityRange)
+                                    ? histoSettings.m_intensityRange[0]
+                                    : settings.componentStatistics(comp).m_minimum;
+
+  const double intensityAxisMax = (histoSettings.m_useCustomIntensityRange)
+                                    ? histoSettings.m_intensityRange[1]
+                                    : settings.componentStatistics(comp).m_maximum;
+
+  const double intensityAxisRange = intensityAxisMax - intensityAxisMin;
+
+  histoSettings.m_numBins = std::clamp(histoSettings.m_numBins, 1, sk_maxNumBins);
+
+  // Bin the component values only if the bins, range, or values changed
+  HistogramCache& cache = histoSettings.m_cache;
+
+  if (!cache.matches(histoSettings.m_numBins, intensityAxisMin, intensityAxisMax))
+  {
+    cache = computeImageHistogram(
+      image, comp, histoSettings.m_numBins, intensityAxisMin, intensityAxisMax
+    );
+  }
+
+  // Bar heights: counts or densities, which may be cumulative. Cumulative counts include the
+  // values below the intensity range, and densities are relative to all values (as in ImPlot).
+  std::vector<double> barHeights = cache.m_binCounts;
+  const double binWidth = intensityAxisRange / static_cast<double>(histoSettings.m_numBins);
+
+  if (histoSettings.m_isCumulative && !barHeights.empty())
+  {
+    barHeights[0] += static_cast<double>(cache.m_numBelowRange);
+    std::partial_sum(std::begin(barHeights), std::end(barHeights), std::begin(barHeights));
+  }
+
+  if (histoSettings.m_isDensity && cache.m_numValues > 0)
+  {
+    const double numValues = static_cast<double>(cache.m_numValues);
+    const double scale = (histoSettings.m_isCumulative || binWidth <= 0.0)
+                           ? 1.0 / numValues
+                           : 1.0 / (numValues * binWidth);
+
+    for (double& h : barHeights)
+    {
+      h *= scale;
+    }
+  }
+
+  const int numBars = static_cast<int>(std::min(barHeights.size(), cache.m_binCenters.size()));
+
+  if (ImPlot::BeginPlot(plotTitle.c_str()))
+  {
+    if (histoSettings.m_isHorizontal)
+    {
+      ImPlot::SetupAxes(
+        countAxisLabel.c_str(), "Intensity", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit
+      );
+      if (histoSettings.m_isLogScale)
+      {
+        ImPlot::SetupAxisScale(ImAxis_X1, ImPlotScale_Log10);
+      }
+    }
+    else
+    {
+      ImPlot::SetupAxes(
+        "Intensity", countAxisLabel.c_str(), ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit
+      );
+      if (histoSettings.m_isLogScale)
+      {
+        ImPlot::SetupAxisScale(ImAxis_Y1, ImPlotScale_Log10);
+      }
+    }
+
+    ImPlot::SetNextFillStyle(IMPLOT_AUTO_COL, 0.5f);
+
+    if (histoSettings.m_isHorizontal)
+    {
+      ImPlot::PlotBars(
+        "##PlotHistogram",
+        barHeights.data(),
+        cache.m_binCenters.data(),
+        numBars,
+        binWidth,
+        ImPlotBarsFlags_Horizontal
+      );
+    }
+    else
+    {
+      ImPlot::PlotBars(
+        "##PlotHistogram", cache.m_binCenters.data(), barHeights.data(), numBars, binWidth
+      );
+    }
+
+    const auto windowLowHigh = settings.windowValuesLowHigh();
+    const ImPlotInfLinesFlags infLineFlags = (histoSettings.m_isHorizontal)
+                                               ? ImPlotInfLinesFlags_Horizontal
+                                               : 0;
+
+    ImPlot::PushColormap(ImPlotColormap_Deep);
+
+    if (intensityAxisMin <= windowLowHigh.first)
+    {
+      ImPlot::PlotInfLines("##WindowInfLine1", &windowLowHigh.first, 1, infLineFlags);
+    }
+
+    if (windowLowHigh.second <= intensityAxisMax)
+    {
+      ImPlot::PlotInfLines("##WindowInfLine2", &windowLowHigh.second, 1, infLineFlags);
+    }
+
+    ImPlot::PopColormap();
+    ImPlot::EndPlot();
+  }
+
+  const int maxNumBins = static_cast<int>(
+    std::min(image.header().numPixels(), static_cast<std::size_t>(sk_maxNumBins))
+  );
+
+  ImGui::DragInt("Bin count", &(histoSettings.m_numBins), 1, 1, std::max(maxNumBins, 1));
+
+  float binWidthToEdit = static_cast<float>(binWidth);
+
+  const float binWidthSpeed = isIntegerType(settings.componentType())
+                                ? 1.0f
+                                : (intensityAxisRange / 1000.0f);
+
+  if (ImGui::DragFloat(
+        "Bin width",
+        &binWidthToEdit,
+        binWidthSpeed,
+        0.0f,
+        intensityAxisRange,
+        imagePrecisionFormat.c_str()
+      ))
+  {
+    if (binWidthToEdit > 0.0f)
+    {
+      histoSettings.m_numBins = std::clamp(
+        static_cast<int>(std::ceil(intensityAxisRange / binWidthToEdit)), 1, sk_maxNumBins
+      );
+    }
+  }
+
+  ImGui::Checkbox("Cumulative", &histoSettings.m_isCumulative);
+  ImGui::SameLine();
+  ImGui::Checkbox("Density", &histoSettings.m_isDensity);
+  ImGui::SameLine();
+  ImGui::Checkbox("Horizontal", &histoSettings.m_isHorizontal);
+  ImGui::SameLine();
+  ImGui::Checkbox("Log scale", &histoSettings.m_isLogScale);
+  ImGui::Checkbox("Set intensity range", &histoSettings.m_useCustomIntensityRange);
+
+  if (histoSettings.m_useCustomIntensityRange)
+  {
+    if (isFloatingType(settings.componentType()))
+    {
+      const float rangeMin = static_cast<float>(settings.componentStatistics(comp).m_minimum);
+      const float rangeMax = static_cast<float>(settings.componentStatistics(comp).m_maximum);
+
+      const std::string minValuesFormatString = std::string("Min: ") + imagePrecisionFormat;
+      const std::string maxValuesFormatString = std::string("Max: ") + imagePrecisionFormat;
+
+      float rangeLow = histoSettings.m_intensityRange[0];
+      float rangeHigh = histoSettings.m_intensityRange[1];
+      const float floatSpeed = (rangeHigh - rangeLow) / 1000.0f;
+
+      if (ImGui::DragFloatRange2(
+            "Range",
+            &rangeLow,
+            &rangeHigh,
+            floatSpeed,
+            rangeMin,
+            rangeMax,
+            minValuesFormatString.c_str(),
+            maxValuesFormatString.c_str(),
+            ImGuiSliderFlags_AlwaysClamp
+          ))
+      {
+        histoSettings.m_intensityRange[0] = static_cast<double>(rangeLow);
+        histoSettings.m_intensityRange[1] = static_cast<double>(rangeHigh);
+      }
+    }
+    else
+    {
+      const int rangeMin = static_cast<int>(settings.componentStatistics(comp).m_minimum);
+      const int rangeMax = static_cast<int>(settings.componentStatistics(comp).m_maximum);
+      const float speed = 1.0f;
+
+      int rangeLow = static_cast<int>(histoSettings.m_intensityRange[0]);
+      int rangeHigh = static_cast<int>(histoSettings.m_intensityRange[1]);
+
+      if (ImGui::DragIntRange2(
+            "Intensity range",
+            &rangeLow,
+            &rangeHigh,
+            speed,
+            rangeMin,
+            rangeMax,
+            "Min: %d",
+            "Max: %d",
+            ImGuiSliderFlags_AlwaysClamp
+          ))
+      {
+        histoSettings.m_intensityRange[0] = static_cast<double>(rangeLow);
+        histoSettings.m_intensityRange[1] = static_cast<double>(rangeHigh);
+      }
+    }
+  }
+}
@@ -3,14 +3,19 @@
 
 #include "common/PublicTypes.h"
 
+#include <cstdint>
 #include <functional>
 #include <glm/fwd.hpp>
+#include <string>
 #include <utility>
 #include <uuid.h>
 
 class AppData;
+class Image;
 class ImageColorMap;
+class ImageSettings;
 class ImageTransformations;
+class LabelStatistics;
 class LandmarkGroup;
 class ParcellationLabelTable;
 
@@ -27,11 +32,25 @@ void renderActiveImageSelectionCombo(
  * @param[in] tableIndex Index of the label table
  * @param[in,out] labelTable Pointer to the label table
  * @param[in] updateLabelColorTableTexture Function to update the label table texture
+ * @param[in] updateLabelMeshes Function to regenerate the label meshes after their flags change
  */
 void renderSegLabelsChildWindow(
   size_t tableIndex,
   ParcellationLabelTable* labelTable,
   const std::function<void(size_t tableIndex)>& updateLabelColorTableTexture,
+  const std::function<void(size_t labelIndex)>& moveCrosshairsToSegLabelCentroid,
+  const std::function<void(void)>& updateLabelMeshes
+);
+
+/**
+ * @brief Render child window that shows the statistics of the labels present in a segmentation
+ * @param[in] stats Label statistics of the segmentation
+ * @param[in] labelTable Label table of the segmentation, which names the labels
+ * @param[in] moveCrosshairsToSegLabelCentroid Function to move the crosshairs to a label centroid
+ */
+void renderSegLabelStatisticsChildWindow(
+  const LabelStatistics* stats,
+  const ParcellationLabelTable* labelTable,
   const std::function<void(size_t labelIndex)>& moveCrosshairsToSegLabelCentroid
 );
 
@@ -78,4 +97,20 @@ void renderPaletteWindow(
 
 void renderColorMapWindow();
 
+/**
+ * @brief Draw the histogram of an image component and the controls of its settings.
+ * The bin counts are cached in the histogram settings of the component and are recomputed
+ * only when the number of bins or the intensity range changes.
+ * @param[in] image Image
+ * @param[in] comp Image component
+ * @param[in,out] settings Settings of the image
+ * @param[in] imagePrecisionFormat Format string of image values
+ */
+void drawImageHistogram(
+  const Image& image,
+  uint32_t comp,
+  ImageSettings& settings,
+  const std::string& imagePrecisionFormat
+);
+
 #endif // UI_WIDGETS_H
@@ -7,6 +7,7 @@
 #include "ui/imgui/imGuIZMO.quat/imGuIZMOquat.h"
 
 #include "common/DirectionMaps.h"
+#include "common/Profiler.h"
 
 #include "image/Image.h"
 
@@ -975,11 +976,18 @@ void renderSegmentationPropertiesWindow(
   const std::function<void(size_t labelColorTableIndex)>& updateLabelColorTableTexture,
   const std::function<void(const uuids::uuid& imageUid, size_t labelIndex)>&
     moveCrosshairsToSegLabelCentroid,
+  const std::function<
+    const LabelStatistics*(const uuids::uuid& imageUid, const uuids::uuid& segUid)>&
+    getSegLabelStatistics,
   const std::function<std::optional<uuids::uuid>(
     const uuids::uuid& matchingImageUid, const std::string& segDisplayName
   )>& createBlankSeg,
   const std::function<bool(const uuids::uuid& segUid)>& clearSeg,
   const std::function<bool(const uuids::uuid& segUid)>& removeSeg,
+  const std::function<bool(const uuids::uuid& segUid, const fs::path& fileName)>& saveSeg,
+  const std::function<bool(const uuids::uuid& segUid, const MorphologyParams& params)>&
+    applySegMorphology,
+  const std::function<bool(const uuids::uuid& segUid)>& generateLabelMeshes,
   const AllViewsRecenterType& recenterAllViews
 )
 {
@@ -1013,9 +1021,14 @@ void renderSegmentationPropertiesWindow(
           updateLabelColorTableTexture,
           [&imageUid, moveCrosshairsToSegLabelCentroid](size_t labelIndex)
           { moveCrosshairsToSegLabelCentroid(imageUid, labelIndex); },
+          [&imageUid, getSegLabelStatistics](const uuids::uuid& segUid)
+          { return getSegLabelStatistics(imageUid, segUid); },
           createBlankSeg,
           clearSeg,
           removeSeg,
+          saveSeg,
+          applySegMorphology,
+          generateLabelMeshes,
           recenterAllViews
         );
       }
@@ -1659,6 +1672,7 @@ void renderSettingsWindow(
         ImGui::Separator();
         ImGui::Checkbox("Show ImGui demo window", &(appData.guiData().m_showImGuiDemoWindow));
         ImGui::Checkbox("Show ImPlot demo window", &(appData.guiData().m_showImPlotDemoWindow));
+        ImGui::Checkbox("Show profiler window", &(appData.guiData().m_showProfilerWindow));
 
         ImGui::EndTabItem();
       }
@@ -3145,3 +3159,114 @@ void renderOpacityBlenderWindow(
 
   ImGui::End();
 }
+
+void renderProfilerWindow(AppData& appData)
+{
+  static const ImGuiTableFlags sk_tableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg
+                                               | ImGuiTableFlags_SizingFixedFit;
+
+  static std::string s_traceFileName = "entropy_trace.json";
+
+  if (!appData.guiData().m_showProfilerWindow)
+    return;
+
+  const bool showWindow = ImGui::Begin(
+    "Profiler",
+    &(appData.guiData().m_showProfilerWindow),
+    ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_AlwaysAutoResize
+  );
+
+  if (!showWindow)
+  {
+    ImGui::End();
+    return;
+  }
+
+  Profiler& profiler = Profiler::instance();
+
+  bool enabled = profiler.isEnabled();
+
+  if (ImGui::Checkbox("Enable profiler", &enabled))
+  {
+    profiler.setEnabled(enabled);
+  }
+  ImGui::SameLine();
+  helpMarker("While the profiler is enabled, frames are rendered continuously");
+
+  ImGui::SameLine();
+  if (ImGui::Button("Clear"))
+  {
+    profiler.clearStats();
+  }
+
+  ImGui::Text(
+    "CPU time per frame (ms) over the last %zu frames in which each stage ran",
+    Profiler::sk_numFrames
+  );
+
+  if (ImGui::BeginTable("Profiler Stages", 6, sk_tableFlags))
+  {
+    ImGui::TableSetupColumn("Stage", ImGuiTableColumnFlags_WidthFixed, 200.0f);
+    ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_WidthFixed, 50.0f);
+    ImGui::TableSetupColumn("Last", ImGuiTableColumnFlags_WidthFixed, 75.0f);
+    ImGui::TableSetupColumn("Min", ImGuiTableColumnFlags_WidthFixed, 75.0f);
+    ImGui::TableSetupColumn("Avg", ImGuiTableColumnFlags_WidthFixed, 75.0f);
+    ImGui::TableSetupColumn("P99", ImGuiTableColumnFlags_WidthFixed, 75.0f);
+    ImGui::TableHeadersRow();
+
+    for (const Profiler::StageStats& s : profiler.stats())
+    {
+      ImGui::TableNextRow();
+
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(s.m_name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%zu", s.m_numCalls);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", s.m_lastMs);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", s.m_minMs);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", s.m_avgMs);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", s.m_p99Ms);
+    }
+
+    ImGui::EndTable();
+  }
+
+  ImGui::Separator();
+
+  if (profiler.isTracing())
+  {
+    if (ImGui::Button("Stop trace"))
+    {
+      profiler.stopTrace();
+    }
+  }
+  else if (enabled)
+  {
+    if (ImGui::Button("Start trace"))
+    {
+      profiler.startTrace();
+    }
+  }
+
+  if (profiler.isTracing() || enabled)
+  {
+    ImGui::SameLine();
+  }
+  ImGui::Text("%zu trace events", profiler.numTraceEvents());
+
+  ImGui::InputText("##traceFileName", &s_traceFileName);
+  ImGui::SameLine();
+
+  if (ImGui::Button("Save trace"))
+  {
+    profiler.writeTrace(s_traceFileName);
+  }
+  ImGui::SameLine();
+  helpMarker("Save the trace as a Chrome trace (JSON) file, viewable in Perfetto");
+
+  ImGui::End();
+}
@@ -2,6 +2,7 @@
 #define UI_WINDOWS_H
 
 #include "common/AsyncTasks.h"
+#include "common/filesystem.h"
 #include "common/PublicTypes.h"
 #include "common/Types.h"
 
@@ -21,6 +22,8 @@
 
 class AppData;
 class ImageColorMap;
+class LabelStatistics;
+struct MorphologyParams;
 class ParcellationLabelTable;
 
 /**
@@ -154,9 +157,13 @@ void renderImagePropertiesWindow(
  * @param getLabelTable
  * @param updateImageUniforms
  * @param updateLabelColorTableTexture
+ * @param getSegLabelStatistics Get the label statistics of a segmentation of an image
  * @param createBlankSeg
  * @param clearSeg
  * @param removeSeg
+ * @param saveSeg Schedule saving a segmentation to a file in the background
+ * @param applySegMorphology Start a morphological operation on a segmentation in the background
+ * @param generateLabelMeshes Start generating the label meshes of a segmentation in the background
  */
 void renderSegmentationPropertiesWindow(
   AppData& appData,
@@ -165,11 +172,18 @@ void renderSegmentationPropertiesWindow(
   const std::function<void(size_t labelColorTableIndex)>& updateLabelColorTableTexture,
   const std::function<void(const uuids::uuid& imageUid, size_t labelIndex)>&
     moveCrosshairsToSegLabelCentroid,
+  const std::function<
+    const LabelStatistics*(const uuids::uuid& imageUid, const uuids::uuid& segUid)>&
+    getSegLabelStatistics,
   const std::function<std::optional<uuids::uuid>(
     const uuids::uuid& matchingImageUid, const std::string& segDisplayName
   )>& createBlankSeg,
   const std::function<bool(const uuids::uuid& segUid)>& clearSeg,
   const std::function<bool(const uuids::uuid& segUid)>& removeSeg,
+  const std::function<bool(const uuids::uuid& segUid, const fs::path& fileName)>& saveSeg,
+  const std::function<bool(const uuids::uuid& segUid, const MorphologyParams& params)>&
+    applySegMorphology,
+  const std::function<bool(const uuids::uuid& segUid)>& generateLabelMeshes,
   const AllViewsRecenterType& recenterAllViews
 );
 
@@ -274,4 +288,11 @@ void renderOpacityBlenderWindow(
   AppData& appData, const std::function<void(const uuids::uuid& imageUid)>& updateImageUniforms
 );
 
+/**
+ * @brief Render the window of the profiler, which shows the CPU times of the stages of the
+ * application per frame and records traces
+ * @param appData
+ */
+void renderProfilerWindow(AppData& appData);
+
 #endif // UI_WINDOWS_H
@@ -243,6 +243,11 @@ void cursorPosCallback(GLFWwindow* window, double mindowCursorPosX, double mindo
 
     break;
   }
+  case MouseMode::RegionGrow:
+  {
+    // The region grows once, when the mouse button is pressed
+    break;
+  }
   case MouseMode::Annotate:
   {
     if (!currHit_invalidOutsideView)
@@ -499,6 +504,12 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
     return;
   }
 
+  // A segmentation brush stroke ends when the mouse is released, wherever the cursor is
+  if (GLFW_RELEASE == action)
+  {
+    app->callbackHandler().endSegEdit();
+  }
+
   const ImGuiIO& io = ImGui::GetIO();
   if (io.WantCaptureMouse)
     return; // ImGui has captured event
@@ -529,6 +540,13 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
   case GLFW_PRESS:
   {
     send_event(state::MousePressEvent(*hit_invalidOutsideView, s_mouseButtonState, s_modifierState));
+
+    if (MouseMode::RegionGrow == app->appData().state().mouseMode()
+        && (s_mouseButtonState.left || s_mouseButtonState.right))
+    {
+      const bool swapFgAndBg = (s_mouseButtonState.right);
+      app->callbackHandler().doRegionGrowing(*hit_invalidOutsideView, swapFgAndBg);
+    }
     break;
   }
   case GLFW_RELEASE:
@@ -581,6 +599,7 @@ void scrollCallback(GLFWwindow* window, double scrollOffsetX, double scrollOffse
   {
   case MouseMode::Pointer:
   case MouseMode::Segment:
+  case MouseMode::RegionGrow:
   case MouseMode::CameraTranslate:
   case MouseMode::CameraRotate:
   case MouseMode::ImageRotate:
@@ -663,6 +682,9 @@ void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int
   case GLFW_KEY_B:
     H.setMouseMode(MouseMode::Segment);
     break;
+  case GLFW_KEY_G:
+    H.setMouseMode(MouseMode::RegionGrow);
+    break;
   case GLFW_KEY_L:
     H.setMouseMode(MouseMode::WindowLevel);
     break;
@@ -673,11 +695,31 @@ void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int
   case GLFW_KEY_T:
     H.setMouseMode(MouseMode::ImageTranslate);
     break;
-    //    case GLFW_KEY_Y: H.setMouseMode( MouseMode::ImageScale ); break;
 
   case GLFW_KEY_Z:
-    H.setMouseMode(MouseMode::CameraZoom);
+  {
+    if (s_modifierState.control && s_modifierState.shift)
+    {
+      H.redoSegEdit();
+    }
+    else if (s_modifierState.control)
+    {
+      H.undoSegEdit();
+    }
+    else
+    {
+      H.setMouseMode(MouseMode::CameraZoom);
+    }
     break;
+  }
+  case GLFW_KEY_Y:
+  {
+    if (s_modifierState.control)
+    {
+      H.redoSegEdit();
+    }
+    break;
+  }
   case GLFW_KEY_X:
     H.setMouseMode(MouseMode::CameraTranslate);
     break;
@@ -2,6 +2,7 @@
 
 #include "EntropyApp.h"
 #include "common/Exception.hpp"
+#include "common/Profiler.h"
 #include "windowing/GlfwCallbacks.h"
 
 #include <spdlog/spdlog.h>
@@ -253,12 +254,23 @@ void GlfwWrapper::renderLoop(
       exit(EXIT_FAILURE);
     }
 
-    processInput();
-    renderOnce();
+    {
+      PROFILE_SCOPE("Frame");
+
+      processInput();
+      renderOnce();
+
+      PROFILE_SCOPE("Swap buffers");
+      glfwSwapBuffers(m_window);
+    }
 
-    glfwSwapBuffers(m_window);
+    Profiler::instance().endFrame();
 
-    switch (m_eventProcessingMode)
+    // Render continuously while profiling, so that the profiler measures frames back to back
+    const EventProcessingMode mode
+      = Profiler::instance().isEnabled() ? EventProcessingMode::Poll : m_eventProcessingMode;
+
+    switch (mode)
     {
     case EventProcessingMode::Poll:
     {
@@ -283,7 +295,12 @@ void GlfwWrapper::renderLoop(
 
 void GlfwWrapper::renderOnce()
 {
-  m_renderScene();
+  {
+    PROFILE_SCOPE("Render scene");
+    m_renderScene();
+  }
+
+  PROFILE_SCOPE("Render GUI");
   m_renderGui();
 }
 
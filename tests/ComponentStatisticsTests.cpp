@@ -0,0 +1,365 @@
+#include "Testing.h"
+
+#include "image/ComponentStatistics.tpp"
+#include "image/QuantileIndex.h"
+#include "image/QuantileIndex.tpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/// More values than fit in one chunk, so that chunks are binned concurrently
+constexpr std::size_t sk_numValues = 3 * component_stats_detail::MIN_CHUNK_SIZE + 12345;
+
+/// Histogram counted one value and one bin at a time. Bin b holds the values in
+/// [rangeMin + b * width, rangeMin + (b + 1) * width), and the last bin also holds rangeMax.
+struct BruteForceHistogram
+{
+  std::vector<double> m_binCounts;
+  uint64_t m_numValues = 0;
+  uint64_t m_numBelowRange = 0;
+};
+
+template<typename T>
+BruteForceHistogram bruteForceHistogram(
+  const std::vector<T>& values, std::size_t stride, int numBins, double rangeMin, double rangeMax
+)
+{
+  BruteForceHistogram hist;
+  hist.m_binCounts.assign(static_cast<std::size_t>(numBins), 0.0);
+
+  const double width = (rangeMax - rangeMin) / numBins;
+
+  for (std::size_t n = 0; n < values.size() / stride; ++n)
+  {
+    const double v = static_cast<double>(values[n * stride]);
+
+    if (std::isnan(v))
+    {
+      continue;
+    }
+
+    ++hist.m_numValues;
+    hist.m_numBelowRange += (v < rangeMin) ? 1 : 0;
+
+    for (int b = 0; b < numBins; ++b)
+    {
+      const double lo = rangeMin + b * width;
+      const double hi = rangeMin + (b + 1) * width;
+      const bool isLast = (numBins - 1 == b);
+
+      // An empty range has all of its values in the first bin
+      const bool inBin = (0.0 == width) ? (0 == b && v == rangeMin)
+                                        : (lo <= v && (v < hi || (isLast && v == rangeMax)));
+
+      if (inBin)
+      {
+        ++hist.m_binCounts[static_cast<std::size_t>(b)];
+        break;
+      }
+    }
+  }
+
+  return hist;
+}
+
+/// Check the histogram of a buffer against the brute-force count
+template<typename T>
+void checkHistogram(
+  const std::vector<T>& values, std::size_t stride, int numBins, double rangeMin, double rangeMax
+)
+{
+  const HistogramCache hist = computeComponentHistogram(
+    values.data(), values.size() / stride, stride, numBins, rangeMin, rangeMax
+  );
+
+  const BruteForceHistogram expected
+    = bruteForceHistogram(values, stride, numBins, rangeMin, rangeMax);
+
+  CHECK(hist.matches(numBins, rangeMin, rangeMax));
+  REQUIRE(hist.m_binCounts.size() == expected.m_binCounts.size());
+  REQUIRE(hist.m_binCenters.size() == expected.m_binCounts.size());
+
+  std::size_t numWrongBins = 0;
+
+  for (std::size_t b = 0; b < expected.m_binCounts.size(); ++b)
+  {
+    numWrongBins += (hist.m_binCounts[b] == expected.m_binCounts[b]) ? 0 : 1;
+  }
+
+  CHECK_EQ(numWrongBins, std::size_t{0});
+  CHECK_EQ(hist.m_numValues, expected.m_numValues);
+  CHECK_EQ(hist.m_numBelowRange, expected.m_numBelowRange);
+
+  const double width = (rangeMax - rangeMin) / numBins;
+  CHECK_NEAR(hist.m_binCenters.front(), rangeMin + 0.5 * width, 1.0e-9);
+  CHECK_NEAR(hist.m_binCenters.back(), rangeMax - 0.5 * width, 1.0e-9);
+}
+
+/// Statistics computed serially, in one pass for the extrema and the mean and another pass for
+/// the variance, accumulated in long double. NaN values are excluded.
+template<typename T>
+ComponentStats serialStatistics(const std::vector<T>& values, std::size_t stride)
+{
+  std::vector<double> valid;
+
+  for (std::size_t n = 0; n < values.size() / stride; ++n)
+  {
+    const double v = static_cast<double>(values[n * stride]);
+
+    if (!std::isnan(v))
+    {
+      valid.push_back(v);
+    }
+  }
+
+  ComponentStats stats;
+
+  if (valid.empty())
+  {
+    return stats;
+  }
+
+  long double sum = 0.0L;
+
+  for (const double v : valid)
+  {
+    sum += v;
+  }
+
+  const long double mean = sum / static_cast<long double>(valid.size());
+  long double sumSquaredDiffs = 0.0L;
+
+  for (const double v : valid)
+  {
+    sumSquaredDiffs += (v - mean) * (v - mean);
+  }
+
+  stats.m_minimum = *std::min_element(std::begin(valid), std::end(valid));
+  stats.m_maximum = *std::max_element(std::begin(valid), std::end(valid));
+  stats.m_sum = static_cast<double>(sum);
+  stats.m_mean = static_cast<double>(mean);
+  stats.m_variance = static_cast<double>(sumSquaredDiffs / static_cast<long double>(valid.size()));
+  stats.m_stdDeviation = std::sqrt(stats.m_variance);
+
+  // Percentiles of the sorted values, at the ranks used by the quantile index
+  std::sort(std::begin(valid), std::end(valid));
+  const double N = static_cast<double>(valid.size());
+
+  for (std::size_t i = 0; i <= 100; ++i)
+  {
+    const double q = static_cast<double>(i) / 100.0;
+    const double index = (1.0 - q) * -0.5 + q * (N - 0.5);
+    const auto rank = static_cast<std::size_t>(std::max(std::floor(index), 0.0));
+    stats.m_quantiles[i] = valid[rank];
+  }
+
+  return stats;
+}
+
+/// Check the statistics of a buffer, which are computed in concurrent chunks whose moments are
+/// merged, against the serial statistics. Percentiles are given by a quantile index of the buffer.
+template<typename T>
+void checkStatistics(const std::vector<T>& values, std::size_t stride, bool exactQuantiles)
+{
+  const std::size_t numElements = values.size() / stride;
+  const QuantileIndex index = buildQuantileIndex(values.data(), numElements, stride);
+
+  const ComponentStats stats = computeComponentStatistics(
+    values.data(),
+    numElements,
+    stride,
+    [&index](double quantile) { return index.quantileToValue(quantile); }
+  );
+
+  const ComponentStats expected = serialStatistics(values, stride);
+
+  // Relative tolerance of the merged moments
+  const double scale = std::max(1.0, std::abs(expected.m_mean));
+  const double tol = 1.0e-12 * scale;
+
+  CHECK_EQ(stats.m_minimum, expected.m_minimum);
+  CHECK_EQ(stats.m_maximum, expected.m_maximum);
+  CHECK_NEAR(stats.m_mean, expected.m_mean, tol);
+  CHECK_NEAR(stats.m_sum, expected.m_sum, tol * static_cast<double>(numElements));
+  CHECK_NEAR(stats.m_variance, expected.m_variance, 1.0e-9 * std::max(1.0, expected.m_variance));
+  CHECK_NEAR(
+    stats.m_stdDeviation, expected.m_stdDeviation, 1.0e-9 * std::max(1.0, expected.m_stdDeviation)
+  );
+
+  std::size_t numWrongQuantiles = 0;
+
+  for (std::size_t i = 0; i <= 100; ++i)
+  {
+    // An approximate index is only checked to bracket the extrema
+    const bool correct = exactQuantiles
+                           ? (stats.m_quantiles[i] == expected.m_quantiles[i])
+                           : (expected.m_minimum <= stats.m_quantiles[i]
+                              && stats.m_quantiles[i] <= expected.m_maximum);
+
+    numWrongQuantiles += correct ? 0 : 1;
+  }
+
+  CHECK_EQ(numWrongQuantiles, std::size_t{0});
+}
+
+} // namespace
+
+ENTROPY_TEST(componentStatisticsOfIntegersMatchSerial)
+{
+  // Each chunk has a different mean, so that merging chunks moves the mean and adds to the
+  // sum of squared deviations
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<int> noise(-500, 500);
+
+  std::vector<int16_t> values(sk_numValues);
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    const auto chunk = static_cast<int>(i / component_stats_detail::MIN_CHUNK_SIZE);
+    values[i] = static_cast<int16_t>(8000 * chunk - 12000 + noise(rng));
+  }
+
+  checkStatistics(values, 1, true);
+
+  // Every third value, as in an interleaved buffer of three components
+  checkStatistics(values, 3, true);
+
+  std::vector<uint8_t> bytes(sk_numValues);
+  for (std::size_t i = 0; i < bytes.size(); ++i)
+  {
+    bytes[i] = static_cast<uint8_t>((i * 37) % 256);
+  }
+
+  checkStatistics(bytes, 1, true);
+}
+
+ENTROPY_TEST(componentStatisticsOfFloatsMatchSerial)
+{
+  // Values with a large offset relative to their spread, whose variance is lost to cancellation
+  // unless the moments are merged stably
+  std::mt19937 rng(6);
+  std::normal_distribution<float> noise(0.0f, 2.0f);
+
+  std::vector<float> values(sk_numValues);
+  for (float& v : values)
+  {
+    v = 10000.0f + noise(rng);
+  }
+
+  for (std::size_t i = 0; i < values.size(); i += 997)
+  {
+    values[i] = std::numeric_limits<float>::quiet_NaN();
+  }
+
+  // A first chunk of only NaNs, whose moments are empty
+  std::fill_n(
+    std::begin(values),
+    component_stats_detail::MIN_CHUNK_SIZE,
+    std::numeric_limits<float>::quiet_NaN()
+  );
+
+  checkStatistics(values, 1, false);
+  checkStatistics(values, 2, false);
+}
+
+ENTROPY_TEST(componentStatisticsOfEmptyBuffers)
+{
+  auto quantileToValue = [](double) { return 0.0; };
+
+  const std::vector<float> nans(1000, std::numeric_limits<float>::quiet_NaN());
+  const ComponentStats nanStats
+    = computeComponentStatistics(nans.data(), nans.size(), 1, quantileToValue);
+
+  CHECK_EQ(nanStats.m_minimum, 0.0);
+  CHECK_EQ(nanStats.m_maximum, 0.0);
+  CHECK_EQ(nanStats.m_sum, 0.0);
+  CHECK_EQ(nanStats.m_variance, 0.0);
+
+  const ComponentStats emptyStats
+    = computeComponentStatistics(static_cast<const float*>(nullptr), 0, 1, quantileToValue);
+
+  CHECK_EQ(emptyStats.m_mean, 0.0);
+  CHECK_EQ(emptyStats.m_stdDeviation, 0.0);
+}
+
+ENTROPY_TEST(componentHistogramOfFloatsMatchesBruteForce)
+{
+  // Multiples of 1/8 fall exactly on the edges of bins of width 1/2, and NaNs are not counted
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> eighths(-100, 100);
+
+  std::vector<float> values(sk_numValues);
+  for (float& v : values)
+  {
+    v = static_cast<float>(eighths(rng)) / 8.0f;
+  }
+
+  for (std::size_t i = 0; i < values.size(); i += 1001)
+  {
+    values[i] = std::numeric_limits<float>::quiet_NaN();
+  }
+
+  checkHistogram(values, 1, 32, -8.0, 8.0);
+
+  // Every other value, as in an interleaved buffer of two components
+  checkHistogram(values, 2, 32, -8.0, 8.0);
+
+  // Range that covers all values, so that the extremes are in the edge bins
+  checkHistogram(values, 1, 25, -12.5, 12.5);
+}
+
+ENTROPY_TEST(componentHistogramOfIntegersMatchesBruteForce)
+{
+  std::mt19937 rng(4);
+
+  std::vector<uint16_t> values(sk_numValues);
+  std::uniform_int_distribution<int> dist(0, 2000);
+
+  for (uint16_t& v : values)
+  {
+    v = static_cast<uint16_t>(dist(rng));
+  }
+
+  // Bins of width 100, whose edges are values of the buffer
+  checkHistogram(values, 1, 10, 100.0, 1100.0);
+
+  // Bins of one value each, including the extremes of the type
+  std::vector<uint8_t> bytes(sk_numValues);
+  for (std::size_t i = 0; i < bytes.size(); ++i)
+  {
+    bytes[i] = static_cast<uint8_t>((i * 37) % 256);
+  }
+
+  checkHistogram(bytes, 1, 256, 0.0, 256.0);
+  checkHistogram(bytes, 1, 255, 0.0, 255.0);
+
+  std::vector<int16_t> signedValues(sk_numValues);
+  for (std::size_t i = 0; i < signedValues.size(); ++i)
+  {
+    signedValues[i] = static_cast<int16_t>(static_cast<int>(i % 4001) - 2000);
+  }
+
+  checkHistogram(signedValues, 1, 40, -1000.0, 1000.0);
+}
+
+ENTROPY_TEST(componentHistogramOfEmptyRange)
+{
+  // All values equal to the range are in the first bin, and all others are outliers
+  std::vector<int32_t> values(sk_numValues);
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    values[i] = static_cast<int32_t>(i % 5);
+  }
+
+  checkHistogram(values, 1, 8, 2.0, 2.0);
+
+  // A buffer of one repeated value
+  const std::vector<float> constant(1000, 7.0f);
+  checkHistogram(constant, 1, 16, 7.0, 7.0);
+}
@@ -0,0 +1,240 @@
+#include "Testing.h"
+
+#include "image/DirtyBrickMap.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace
+{
+
+constexpr uint32_t sk_brick = DirtyBrickMap::sk_brickSize;
+
+std::size_t numVoxels(const glm::uvec3& size)
+{
+  return static_cast<std::size_t>(size.x) * size.y * size.z;
+}
+
+/// Number of boxes of a plan that cover each voxel of the image
+std::vector<int> coverage(const glm::uvec3& dims, const DirtyBrickMap::UploadPlan& plan)
+{
+  std::vector<int> count(numVoxels(dims), 0);
+
+  for (const DirtyBrickMap::Box& box : plan.m_boxes)
+  {
+    for (uint32_t z = box.m_offset.z; z < box.m_offset.z + box.m_size.z; ++z)
+    {
+      for (uint32_t y = box.m_offset.y; y < box.m_offset.y + box.m_size.y; ++y)
+      {
+        for (uint32_t x = box.m_offset.x; x < box.m_offset.x + box.m_size.x; ++x)
+        {
+          ++count[(static_cast<std::size_t>(z) * dims.y + y) * dims.x + x];
+        }
+      }
+    }
+  }
+
+  return count;
+}
+
+} // namespace
+
+ENTROPY_TEST(dirtyBrickMapCoalescesBlocksIntoOneBox)
+{
+  DirtyBrickMap map(glm::uvec3{64}, 2);
+  REQUIRE(map.isTracking());
+
+  map.markBlock(glm::uvec3{16}, glm::uvec3{32});
+  map.markVoxel(20, 20, 20); // Already dirty
+  CHECK_EQ(map.numDirtyBricks(), std::size_t{8});
+
+  const DirtyBrickMap::UploadPlan plan = map.takeUploadPlan();
+  REQUIRE(1 == plan.m_boxes.size());
+  CHECK(plan.m_boxes[0].m_offset == glm::uvec3{16});
+  CHECK(plan.m_boxes[0].m_size == glm::uvec3{32});
+  CHECK_EQ(plan.m_numDirtyBricks, std::size_t{8});
+  CHECK_EQ(plan.m_numBytes, std::size_t{32 * 32 * 32 * 2});
+
+  // Taking the plan clears the map
+  CHECK_EQ(map.numDirtyBricks(), std::size_t{0});
+  CHECK(map.takeUploadPlan().m_boxes.empty());
+}
+
+ENTROPY_TEST(dirtyBrickMapSplitsNonRectangularRegions)
+{
+  DirtyBrickMap map(glm::uvec3{64}, 1);
+
+  // L-shaped region of three bricks, and a row of three bricks in another slab
+  map.markVoxel(0, 0, 0);
+  map.markVoxel(16, 0, 0);
+  map.markVoxel(0, 16, 0);
+  map.markRow(5, 40, 20, 63);
+
+  const DirtyBrickMap::UploadPlan plan = map.takeUploadPlan();
+  CHECK_EQ(plan.m_numDirtyBricks, std::size_t{6});
+  REQUIRE(3 == plan.m_boxes.size());
+
+  // Boxes grow along x first
+  CHECK(plan.m_boxes[0].m_offset == glm::uvec3(0, 0, 0));
+  CHECK(plan.m_boxes[0].m_size == glm::uvec3(32, 16, 16));
+  CHECK(plan.m_boxes[1].m_offset == glm::uvec3(0, 16, 0));
+  CHECK(plan.m_boxes[1].m_size == glm::uvec3(16, 16, 16));
+  CHECK(plan.m_boxes[2].m_offset == glm::uvec3(16, 0, 32));
+  CHECK(plan.m_boxes[2].m_size == glm::uvec3(48, 16, 16));
+  CHECK_EQ(plan.m_numBytes, std::size_t{6 * 16 * 16 * 16});
+}
+
+ENTROPY_TEST(dirtyBrickMapClipsBoxesToTheImage)
+{
+  // The last bricks along each axis are partial: 8, 3, and 4 voxels wide
+  const glm::uvec3 dims{40, 35, 20};
+  DirtyBrickMap map(dims, 4);
+
+  map.markVoxel(39, 34, 19);
+
+  DirtyBrickMap::UploadPlan plan = map.takeUploadPlan();
+  REQUIRE(1 == plan.m_boxes.size());
+  CHECK(plan.m_boxes[0].m_offset == glm::uvec3(32, 32, 16));
+  CHECK(plan.m_boxes[0].m_size == glm::uvec3(8, 3, 4));
+  CHECK_EQ(plan.m_numBytes, std::size_t{8 * 3 * 4 * 4});
+
+  // Blocks that extend past the image are clamped to it
+  map.markBlock(glm::uvec3(20, 0, 0), glm::uvec3(100, 10, 10));
+  map.markBlock(glm::uvec3(50, 0, 0), glm::uvec3(10, 10, 10));
+
+  plan = map.takeUploadPlan();
+  CHECK_EQ(plan.m_numDirtyBricks, std::size_t{2});
+  REQUIRE(1 == plan.m_boxes.size());
+  CHECK(plan.m_boxes[0].m_offset == glm::uvec3(16, 0, 0));
+  CHECK(plan.m_boxes[0].m_size == glm::uvec3(24, 16, 16));
+  CHECK_EQ(plan.m_numBytes, std::size_t{24 * 16 * 16 * 4});
+}
+
+ENTROPY_TEST(dirtyBrickMapUploadsWholeImageWhenHalfIsDirty)
+{
+  // 4 x 4 x 4 bricks, the last of which along z are partial
+  const glm::uvec3 dims{64, 64, 60};
+  const std::size_t numBricks = 64;
+
+  DirtyBrickMap map(dims, 1);
+
+  // One brick short of half: the bricks of the first two slabs, less one
+  map.markBlock(glm::uvec3{0}, glm::uvec3(64, 64, 16));
+  map.markBlock(glm::uvec3(0, 0, 16), glm::uvec3(64, 48, 16));
+  map.markBlock(glm::uvec3(0, 48, 16), glm::uvec3(48, 16, 16));
+  CHECK_EQ(map.numDirtyBricks(), numBricks / 2 - 1);
+
+  DirtyBrickMap::UploadPlan plan = map.takeUploadPlan();
+  CHECK(1 < plan.m_boxes.size());
+  CHECK_EQ(plan.m_numBytes, std::size_t{31 * 16 * 16 * 16});
+
+  // Half of the bricks
+  map.markBlock(glm::uvec3{0}, glm::uvec3(64, 64, 32));
+  CHECK_EQ(map.numDirtyBricks(), numBricks / 2);
+
+  plan = map.takeUploadPlan();
+  REQUIRE(1 == plan.m_boxes.size());
+  CHECK(plan.m_boxes[0].m_offset == glm::uvec3{0});
+  CHECK(plan.m_boxes[0].m_size == dims);
+  CHECK_EQ(plan.m_numDirtyBricks, numBricks / 2);
+  CHECK_EQ(plan.m_numBytes, numVoxels(dims));
+  CHECK_EQ(map.numDirtyBricks(), std::size_t{0});
+
+  map.markAll();
+  plan = map.takeUploadPlan();
+  REQUIRE(1 == plan.m_boxes.size());
+  CHECK_EQ(plan.m_numDirtyBricks, numBricks);
+}
+
+ENTROPY_TEST(dirtyBrickMapBoxesCoverExactlyTheDirtyBricks)
+{
+  const glm::uvec3 dims{70, 60, 40};
+  const glm::uvec3 gridDims = (dims + sk_brick - 1u) / sk_brick;
+  const std::size_t numBricks = numVoxels(gridDims);
+
+  for (uint32_t seed = 1; seed <= 20; ++seed)
+  {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> dx(0, dims.x - 1);
+    std::uniform_int_distribution<uint32_t> dy(0, dims.y - 1);
+    std::uniform_int_distribution<uint32_t> dz(0, dims.z - 1);
+
+    DirtyBrickMap map(dims, 2);
+    std::set<std::size_t> dirty;
+
+    auto brickIndex = [&gridDims](const glm::uvec3& b)
+    { return (static_cast<std::size_t>(b.z) * gridDims.y + b.y) * gridDims.x + b.x; };
+
+    // Mark voxels of fewer than half of the bricks
+    while (dirty.size() < numBricks / 3)
+    {
+      const glm::uvec3 v{dx(rng), dy(rng), dz(rng)};
+      map.markVoxel(v.x, v.y, v.z);
+      dirty.insert(brickIndex(v / sk_brick));
+    }
+
+    CHECK_EQ(map.numDirtyBricks(), dirty.size());
+
+    const DirtyBrickMap::UploadPlan plan = map.takeUploadPlan();
+    const std::vector<int> count = coverage(dims, plan);
+
+    std::size_t numCovered = 0;
+    std::size_t numWrong = 0;
+
+    for (uint32_t z = 0; z < dims.z; ++z)
+    {
+      for (uint32_t y = 0; y < dims.y; ++y)
+      {
+        for (uint32_t x = 0; x < dims.x; ++x)
+        {
+          const int expected = dirty.count(brickIndex(glm::uvec3(x, y, z) / sk_brick)) ? 1 : 0;
+          const int actual = count[(static_cast<std::size_t>(z) * dims.y + y) * dims.x + x];
+
+          numCovered += static_cast<std::size_t>(actual);
+          numWrong += (expected != actual) ? 1 : 0;
+        }
+      }
+    }
+
+    // Each voxel of a dirty brick is in exactly one box, and no other voxel is in a box
+    CHECK_EQ(numWrong, std::size_t{0});
+    CHECK_EQ(plan.m_numBytes, 2 * numCovered);
+  }
+}
+
+ENTROPY_TEST(dirtyBrickMapCountsUploadStats)
+{
+  DirtyBrickMap a(glm::uvec3{64}, 1);
+  DirtyBrickMap b(glm::uvec3{64}, 4);
+  DirtyBrickMap c(glm::uvec3{64}, 1);
+
+  a.markVoxel(0, 0, 0);
+  a.markVoxel(63, 63, 63);
+  b.markBlock(glm::uvec3{0}, glm::uvec3(64, 64, 32));
+
+  DirtyBrickMap::UploadStats stats;
+  stats.add(a.takeUploadPlan());
+  stats.add(b.takeUploadPlan());
+  stats.add(c.takeUploadPlan()); // No dirty bricks
+
+  CHECK_EQ(stats.m_numMaps, std::size_t{2});
+  CHECK_EQ(stats.m_numBoxes, std::size_t{3});
+  CHECK_EQ(stats.m_numBytes, std::size_t{2 * 16 * 16 * 16 + 64 * 64 * 64 * 4});
+}
+
+ENTROPY_TEST(dirtyBrickMapWithoutImageTracksNothing)
+{
+  DirtyBrickMap map;
+  CHECK(!map.isTracking());
+
+  map.markVoxel(0, 0, 0);
+  map.markRow(0, 0, 0, 10);
+  map.markBlock(glm::uvec3{0}, glm::uvec3{10});
+
+  CHECK_EQ(map.numDirtyBricks(), std::size_t{0});
+  CHECK(map.takeUploadPlan().m_boxes.empty());
+}
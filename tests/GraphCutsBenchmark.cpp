@@ -0,0 +1,272 @@
+#include "Testing.h"
+
+#include "logic/segmentation/GraphCuts.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/// Side length (in voxels) of the synthetic volume
+constexpr int sk_size = 128;
+
+constexpr LabelType sk_fgSeed = 1;
+constexpr LabelType sk_bgSeed = 2;
+constexpr double sk_terminalCapacity = 1.0e3;
+
+const VoxelDistances sk_voxelDistances{
+  1.0f, 1.0f, 1.0f, std::sqrt(2.0f), std::sqrt(2.0f), std::sqrt(2.0f), std::sqrt(3.0f)
+};
+
+/// Noisy bright sphere on a dark background, with foreground seeds in a cube at its center and
+/// background seeds on the faces of the volume
+struct SyntheticVolume
+{
+  glm::ivec3 m_dims;
+  std::vector<float> m_image;
+  std::vector<uint8_t> m_seeds;
+
+  std::size_t index(int x, int y, int z) const
+  {
+    return (static_cast<std::size_t>(z) * m_dims.y + y) * m_dims.x + x;
+  }
+};
+
+SyntheticVolume makeSyntheticVolume(int size)
+{
+  SyntheticVolume volume;
+  volume.m_dims = glm::ivec3{size, size, size};
+
+  const std::size_t N = static_cast<std::size_t>(size) * size * size;
+  volume.m_image.resize(N);
+  volume.m_seeds.resize(N, 0);
+
+  std::mt19937 rng(17);
+  std::normal_distribution<float> noise(0.0f, 20.0f);
+
+  const float center = 0.5f * static_cast<float>(size - 1);
+  const float radius = 0.3f * static_cast<float>(size);
+  const int seedHalfWidth = size / 16;
+
+  for (int z = 0; z < size; ++z)
+  {
+    for (int y = 0; y < size; ++y)
+    {
+      for (int x = 0; x < size; ++x)
+      {
+        const float dx = static_cast<float>(x) - center;
+        const float dy = static_cast<float>(y) - center;
+        const float dz = static_cast<float>(z) - center;
+        const bool inSphere = (dx * dx + dy * dy + dz * dz < radius * radius);
+
+        const std::size_t i = volume.index(x, y, z);
+        volume.m_image[i] = (inSphere ? 200.0f : 50.0f) + noise(rng);
+
+        if (std::abs(dx) < seedHalfWidth && std::abs(dy) < seedHalfWidth &&
+            std::abs(dz) < seedHalfWidth)
+        {
+          volume.m_seeds[i] = static_cast<uint8_t>(sk_fgSeed);
+        }
+        else if (0 == x || 0 == y || 0 == z || size - 1 == x || size - 1 == y || size - 1 == z)
+        {
+          volume.m_seeds[i] = static_cast<uint8_t>(sk_bgSeed);
+        }
+      }
+    }
+  }
+
+  return volume;
+}
+
+double millisecondsBetween(Clock::time_point start, Clock::time_point stop)
+{
+  return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+/// Times of the phases of a segmentation, in milliseconds
+struct PhaseTimes
+{
+  double m_fill = 0.0;    //!< Filling the graph capacities
+  double m_maxFlow = 0.0; //!< Computing the max flow
+  double m_total = 0.0;   //!< Whole segmentation, including writing the result
+};
+
+/// Segment the volume using the buffer-based fill
+PhaseTimes segmentWithBuffers(
+  const SyntheticVolume& volume,
+  GraphNeighborhoodType hoodType,
+  const GraphCutsEdgeWeight& edgeWeight,
+  std::size_t numThreads,
+  std::vector<uint8_t>& result
+)
+{
+  std::vector<Clock::time_point> phaseStarts;
+
+  auto onPhase = [&phaseStarts](GraphCutsPhase)
+  {
+    phaseStarts.push_back(Clock::now());
+    return true;
+  };
+
+  const auto start = Clock::now();
+
+  const bool ok = graphCutsBinarySegmentation(
+    hoodType,
+    sk_terminalCapacity,
+    sk_fgSeed,
+    sk_voxelDistances,
+    edgeWeight,
+    volume.m_dims,
+    volume.m_image.data(),
+    volume.m_seeds.data(),
+    result.data(),
+    numThreads,
+    0,
+    onPhase
+  );
+
+  const auto stop = Clock::now();
+
+  REQUIRE(ok);
+  REQUIRE(3 == phaseStarts.size());
+
+  PhaseTimes times;
+  times.m_fill = millisecondsBetween(phaseStarts[0], phaseStarts[1]);
+  times.m_maxFlow = millisecondsBetween(phaseStarts[1], phaseStarts[2]);
+  times.m_total = millisecondsBetween(start, stop);
+  return times;
+}
+
+/// Segment the volume using the callback-based fill, which has no phase callback. The fill and
+/// max flow are timed together, up to the first result value written.
+PhaseTimes segmentWithCallbacks(
+  const SyntheticVolume& volume,
+  GraphNeighborhoodType hoodType,
+  const GraphCutsEdgeWeight& edgeWeight,
+  std::vector<uint8_t>& result
+)
+{
+  const double invScale = 1.0 / ((edgeWeight.m_high - edgeWeight.m_low) * edgeWeight.m_sigma);
+
+  // Same Gaussian weight of the difference (u - v) as the buffer-based fill
+  auto getImageWeight = [&](int x, int y, int z, int dx, int dy, int dz)
+  {
+    const double diff = static_cast<double>(volume.m_image[volume.index(x, y, z)]) -
+                        static_cast<double>(volume.m_image[volume.index(x + dx, y + dy, z + dz)]);
+    const double t = (diff - edgeWeight.m_low) * invScale;
+    return edgeWeight.m_amplitude * std::exp(-0.5 * t * t);
+  };
+
+  auto getSeedValue = [&volume](int x, int y, int z)
+  { return static_cast<LabelType>(volume.m_seeds[volume.index(x, y, z)]); };
+
+  Clock::time_point firstWrite;
+  bool written = false;
+
+  auto setResultSegValue = [&](int x, int y, int z, LabelType value)
+  {
+    if (!written)
+    {
+      firstWrite = Clock::now();
+      written = true;
+    }
+
+    result[volume.index(x, y, z)] = static_cast<uint8_t>(value);
+  };
+
+  const auto start = Clock::now();
+
+  const bool ok = graphCutsBinarySegmentation(
+    hoodType,
+    sk_terminalCapacity,
+    sk_fgSeed,
+    sk_bgSeed,
+    volume.m_dims,
+    sk_voxelDistances,
+    getImageWeight,
+    getSeedValue,
+    setResultSegValue
+  );
+
+  const auto stop = Clock::now();
+
+  REQUIRE(ok);
+  REQUIRE(written);
+
+  PhaseTimes times;
+  times.m_fill = millisecondsBetween(start, firstWrite);
+  times.m_total = millisecondsBetween(start, stop);
+  return times;
+}
+
+double fractionOfEqualLabels(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+{
+  std::size_t numEqual = 0;
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    numEqual += (a[i] == b[i]) ? 1 : 0;
+  }
+  return static_cast<double>(numEqual) / static_cast<double>(a.size());
+}
+
+void benchmarkFills(GraphNeighborhoodType hoodType, const char* hoodName)
+{
+  const SyntheticVolume volume = makeSyntheticVolume(sk_size);
+
+  GraphCutsEdgeWeight edgeWeight;
+  edgeWeight.m_amplitude = 1.0;
+  edgeWeight.m_sigma = 0.1;
+  edgeWeight.m_low = 0.0;
+  edgeWeight.m_high = 255.0;
+
+  std::vector<uint8_t> bufferResult(volume.m_image.size(), 0);
+  std::vector<uint8_t> callbackResult(volume.m_image.size(), 0);
+
+  // Both paths use the serial max-flow solver with one thread, so they solve the same graph with
+  // the same solver and differ only in how the capacities are filled
+  const PhaseTimes buffer = segmentWithBuffers(volume, hoodType, edgeWeight, 1, bufferResult);
+  const PhaseTimes callback = segmentWithCallbacks(volume, hoodType, edgeWeight, callbackResult);
+
+  // The callback fill is estimated as its fill and max flow time less the buffer max flow time
+  const double callbackFill = callback.m_fill - buffer.m_maxFlow;
+
+  std::printf(
+    "  %s, %d^3 voxels:\n"
+    "    buffer fill:   %8.1f ms (max flow %8.1f ms, total %8.1f ms)\n"
+    "    callback fill: %8.1f ms (estimated; total %8.1f ms)\n"
+    "    fill speedup:  %8.1fx\n",
+    hoodName,
+    sk_size,
+    buffer.m_fill,
+    buffer.m_maxFlow,
+    buffer.m_total,
+    callbackFill,
+    callback.m_total,
+    callbackFill / buffer.m_fill
+  );
+
+  // The paths evaluate the weights in single and double precision, so a few voxels with nearly
+  // equal cuts may be labeled differently
+  CHECK(0.999 <= fractionOfEqualLabels(bufferResult, callbackResult));
+}
+
+} // namespace
+
+ENTROPY_TEST(graphCutsFillsOfNeighbors6)
+{
+  benchmarkFills(GraphNeighborhoodType::Neighbors6, "6-neighborhood");
+}
+
+ENTROPY_TEST(graphCutsFillsOfNeighbors26)
+{
+  benchmarkFills(GraphNeighborhoodType::Neighbors26, "26-neighborhood");
+}
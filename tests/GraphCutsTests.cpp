@@ -0,0 +1,152 @@
+#include "Testing.h"
+
+#include "logic/segmentation/GraphCuts.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr LabelType sk_fgSeed = 1;
+constexpr LabelType sk_bgSeed = 2;
+
+/// Noisy bright ellipsoid on a dark background, with foreground seeds at its center and background
+/// seeds on the faces of the volume
+struct SeededVolume
+{
+  glm::ivec3 m_dims;
+  std::vector<float> m_image;
+  std::vector<uint8_t> m_seeds;
+};
+
+SeededVolume makeSeededVolume(const glm::ivec3& dims)
+{
+  SeededVolume volume;
+  volume.m_dims = dims;
+
+  const std::size_t N = static_cast<std::size_t>(dims.x) * dims.y * dims.z;
+  volume.m_image.resize(N);
+  volume.m_seeds.resize(N, 0);
+
+  std::mt19937 rng(23);
+  std::normal_distribution<float> noise(0.0f, 25.0f);
+
+  std::size_t i = 0;
+  for (int z = 0; z < dims.z; ++z)
+  {
+    for (int y = 0; y < dims.y; ++y)
+    {
+      for (int x = 0; x < dims.x; ++x, ++i)
+      {
+        // Coordinates relative to the center, scaled to [-1, 1]
+        const float u = 2.0f * static_cast<float>(x) / static_cast<float>(dims.x - 1) - 1.0f;
+        const float v = 2.0f * static_cast<float>(y) / static_cast<float>(dims.y - 1) - 1.0f;
+        const float w = 2.0f * static_cast<float>(z) / static_cast<float>(dims.z - 1) - 1.0f;
+
+        const bool inside = (u * u / 0.5f + v * v / 0.3f + w * w / 0.4f < 1.0f);
+        volume.m_image[i] = (inside ? 180.0f : 60.0f) + noise(rng);
+
+        if (std::abs(u) < 0.1f && std::abs(v) < 0.1f && std::abs(w) < 0.1f)
+        {
+          volume.m_seeds[i] = static_cast<uint8_t>(sk_fgSeed);
+        }
+        else if (0 == x || 0 == y || 0 == z || dims.x - 1 == x || dims.y - 1 == y ||
+                 dims.z - 1 == z)
+        {
+          volume.m_seeds[i] = static_cast<uint8_t>(sk_bgSeed);
+        }
+      }
+    }
+  }
+
+  return volume;
+}
+
+std::vector<uint8_t> segment(
+  const SeededVolume& volume, GraphNeighborhoodType hoodType, std::size_t numThreads, int blockSize
+)
+{
+  GraphCutsEdgeWeight edgeWeight;
+  edgeWeight.m_sigma = 0.1;
+  edgeWeight.m_low = 0.0;
+  edgeWeight.m_high = 255.0;
+
+  const VoxelDistances voxelDistances{
+    1.0f, 1.0f, 1.0f, std::sqrt(2.0f), std::sqrt(2.0f), std::sqrt(2.0f), std::sqrt(3.0f)
+  };
+
+  std::vector<uint8_t> result(volume.m_image.size(), 0);
+
+  const bool ok = graphCutsBinarySegmentation(
+    hoodType,
+    1.0e3,
+    sk_fgSeed,
+    voxelDistances,
+    edgeWeight,
+    volume.m_dims,
+    volume.m_image.data(),
+    volume.m_seeds.data(),
+    result.data(),
+    numThreads,
+    blockSize
+  );
+
+  REQUIRE(ok);
+  return result;
+}
+
+std::size_t countLabel(const std::vector<uint8_t>& seg, LabelType label)
+{
+  std::size_t count = 0;
+  for (uint8_t value : seg)
+  {
+    count += (static_cast<LabelType>(value) == label) ? 1 : 0;
+  }
+  return count;
+}
+
+/// The multi-threaded fill (and, for the 6-neighborhood, the multi-threaded solver with small
+/// blocks) must label exactly the same voxels as a single thread
+void checkThreadCountsAgree(GraphNeighborhoodType hoodType)
+{
+  // Dimensions that are not multiples of the block size, so that there are partial blocks
+  const SeededVolume volume = makeSeededVolume(glm::ivec3{45, 38, 41});
+
+  const std::vector<uint8_t> serial = segment(volume, hoodType, 1, 0);
+
+  // The foreground is neither empty nor everything
+  const std::size_t numFg = countLabel(serial, sk_fgSeed);
+  CHECK(0 < numFg);
+  CHECK(numFg < serial.size() / 2);
+
+  for (const std::size_t numThreads : {2, 4, 7})
+  {
+    const std::vector<uint8_t> parallel = segment(volume, hoodType, numThreads, 8);
+    REQUIRE(parallel.size() == serial.size());
+
+    std::size_t numDifferent = 0;
+    for (std::size_t i = 0; i < serial.size(); ++i)
+    {
+      numDifferent += (serial[i] != parallel[i]) ? 1 : 0;
+    }
+
+    CHECK_EQ(numDifferent, std::size_t{0});
+  }
+}
+
+} // namespace
+
+ENTROPY_TEST(graphCutsThreadCountsAgreeForNeighbors6)
+{
+  checkThreadCountsAgree(GraphNeighborhoodType::Neighbors6);
+}
+
+ENTROPY_TEST(graphCutsThreadCountsAgreeForNeighbors26)
+{
+  checkThreadCountsAgree(GraphNeighborhoodType::Neighbors26);
+}
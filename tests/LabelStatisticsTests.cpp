@@ -0,0 +1,237 @@
+#include "Testing.h"
+#include "TestImages.h"
+
+#include "logic/segmentation/LabelStatistics.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const glm::ivec3 sk_dims{20, 17, 13};
+
+std::size_t numVoxels()
+{
+  return static_cast<std::size_t>(sk_dims.x) * sk_dims.y * sk_dims.z;
+}
+
+std::size_t voxelIndex(int x, int y, int z)
+{
+  return (static_cast<std::size_t>(z) * sk_dims.y + y) * sk_dims.x + x;
+}
+
+void fillBox(
+  std::vector<uint16_t>& labels, const glm::ivec3& lo, const glm::ivec3& hi, uint16_t value
+)
+{
+  for (int z = lo.z; z < hi.z; ++z)
+  {
+    for (int y = lo.y; y < hi.y; ++y)
+    {
+      for (int x = lo.x; x < hi.x; ++x)
+      {
+        labels[voxelIndex(x, y, z)] = value;
+      }
+    }
+  }
+}
+
+/// Voxels that differ between two segmentations
+std::vector<SegEditHistory::VoxelChange> changedVoxels(
+  const std::vector<uint16_t>& before, const std::vector<uint16_t>& after
+)
+{
+  std::vector<SegEditHistory::VoxelChange> changes;
+
+  for (std::size_t i = 0; i < before.size(); ++i)
+  {
+    if (before[i] != after[i])
+    {
+      changes.push_back({i, before[i], after[i]});
+    }
+  }
+
+  return changes;
+}
+
+/// Check that statistics updated by edits match statistics computed from scratch
+void checkMatches(const LabelStatistics& updated, const LabelStatistics& computed)
+{
+  REQUIRE(updated.labels().size() == computed.labels().size());
+  CHECK_EQ(updated.hasIntensity(), computed.hasIntensity());
+
+  for (const auto& [label, c] : computed.labels())
+  {
+    const LabelStatistics::Stats* u = updated.label(label);
+    REQUIRE(u);
+
+    CHECK_EQ(u->m_numVoxels, c.m_numVoxels);
+    CHECK(u->m_coordSum == c.m_coordSum);
+    CHECK(u->m_boxMin == c.m_boxMin);
+    CHECK(u->m_boxMax == c.m_boxMax);
+
+    // Compensated sums of the same values agree to within a few rounding errors
+    const double sum = c.m_intensitySum.value();
+    const double sumSq = c.m_intensitySumSq.value();
+    CHECK_NEAR(u->m_intensitySum.value(), sum, 1.0e-12 * std::abs(sum));
+    CHECK_NEAR(u->m_intensitySumSq.value(), sumSq, 1.0e-12 * sumSq);
+    CHECK_NEAR(u->meanIntensity(), c.meanIntensity(), 1.0e-9);
+    CHECK_NEAR(u->stdDevIntensity(), c.stdDevIntensity(), 1.0e-6);
+  }
+}
+
+/// Paint, erase, and clear a segmentation, updating its statistics from the changed voxels, and
+/// check them against statistics computed from scratch after each edit
+template<typename T>
+void checkEditsMatchCompute(const std::vector<T>& intensities, bool useImage)
+{
+  const Image image = testing::makeTestImage(
+    sk_dims, testing::componentTypeOf<T>(), intensities.data(), Image::ImageRepresentation::Image
+  );
+
+  const Image* statsImage = useImage ? &image : nullptr;
+
+  std::vector<uint16_t> labels(numVoxels(), 0);
+  fillBox(labels, {2, 2, 2}, {9, 12, 8}, 1);
+  fillBox(labels, {9, 3, 1}, {18, 15, 11}, 2);
+  fillBox(labels, {0, 0, 10}, {20, 17, 13}, 3);
+
+  std::optional<LabelStatistics> stats
+    = LabelStatistics::compute(testing::makeTestSeg(sk_dims, labels), statsImage, 0);
+  REQUIRE(stats);
+  CHECK_EQ(stats->hasIntensity(), useImage);
+
+  auto edit = [&](const std::vector<uint16_t>& after)
+  {
+    const Image seg = testing::makeTestSeg(sk_dims, after);
+
+    CHECK(stats->moveVoxels(changedVoxels(labels, after), statsImage, 0));
+    stats->refreshBoundingBoxes(seg);
+    labels = after;
+
+    const std::optional<LabelStatistics> computed = LabelStatistics::compute(seg, statsImage, 0);
+    REQUIRE(computed);
+    checkMatches(*stats, *computed);
+  };
+
+  std::vector<uint16_t> after = labels;
+
+  // Paint a new label over parts of the others
+  fillBox(after, {5, 5, 4}, {14, 9, 12}, 4);
+  edit(after);
+
+  // Erase the boundary of a label, which shrinks its bounding box
+  fillBox(after, {2, 2, 2}, {9, 4, 8}, 0);
+  fillBox(after, {2, 2, 2}, {3, 12, 8}, 0);
+  edit(after);
+
+  // Clear a label
+  for (uint16_t& label : after)
+  {
+    label = (2 == label) ? 0 : label;
+  }
+  edit(after);
+
+  // Many small strokes of random labels, including the background
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<int> labelDist(0, 5);
+
+  for (int stroke = 0; stroke < 300; ++stroke)
+  {
+    const glm::ivec3 lo{
+      std::uniform_int_distribution<int>(0, sk_dims.x - 1)(rng),
+      std::uniform_int_distribution<int>(0, sk_dims.y - 1)(rng),
+      std::uniform_int_distribution<int>(0, sk_dims.z - 1)(rng)
+    };
+
+    const glm::ivec3 hi = glm::min(lo + glm::ivec3{3, 2, 2}, sk_dims);
+    fillBox(after, lo, hi, static_cast<uint16_t>(labelDist(rng)));
+
+    if (0 == stroke % 50)
+    {
+      edit(after);
+    }
+    else
+    {
+      CHECK(stats->moveVoxels(changedVoxels(labels, after), statsImage, 0));
+      labels = after;
+    }
+  }
+
+  edit(after);
+
+  // Clear the segmentation
+  edit(std::vector<uint16_t>(numVoxels(), 0));
+  CHECK(stats->labels().empty());
+}
+
+} // namespace
+
+ENTROPY_TEST(labelStatisticsEditsMatchComputeWithFloatIntensities)
+{
+  // Large intensities with small variations lose low-order bits in uncompensated sums
+  std::mt19937 rng(5);
+  std::normal_distribution<float> noise(10000.0f, 3.0f);
+
+  std::vector<float> intensities(numVoxels());
+  for (float& v : intensities)
+  {
+    v = noise(rng);
+  }
+
+  checkEditsMatchCompute(intensities, true);
+}
+
+ENTROPY_TEST(labelStatisticsEditsMatchComputeWithIntegerIntensities)
+{
+  std::vector<uint16_t> intensities(numVoxels());
+  for (std::size_t i = 0; i < intensities.size(); ++i)
+  {
+    intensities[i] = static_cast<uint16_t>((i * 7919) % 65536);
+  }
+
+  checkEditsMatchCompute(intensities, true);
+}
+
+ENTROPY_TEST(labelStatisticsEditsMatchComputeWithoutImage)
+{
+  checkEditsMatchCompute(std::vector<uint8_t>(numVoxels(), 1), false);
+}
+
+ENTROPY_TEST(labelStatisticsRejectsMismatchedImages)
+{
+  const std::vector<float> intensities(numVoxels(), 1.0f);
+  const Image image = testing::makeTestImage(
+    sk_dims, ComponentType::Float32, intensities.data(), Image::ImageRepresentation::Image
+  );
+
+  std::vector<uint16_t> labels(numVoxels(), 0);
+  fillBox(labels, {1, 1, 1}, {4, 4, 4}, 1);
+
+  std::optional<LabelStatistics> stats
+    = LabelStatistics::compute(testing::makeTestSeg(sk_dims, labels), &image, 0);
+  REQUIRE(stats);
+
+  const glm::ivec3 otherDims{4, 4, 4};
+  const std::vector<float> otherIntensities(64, 1.0f);
+  const Image other = testing::makeTestImage(
+    otherDims, ComponentType::Float32, otherIntensities.data(), Image::ImageRepresentation::Image
+  );
+
+  const std::vector<SegEditHistory::VoxelChange> changes{{voxelIndex(1, 1, 1), 1, 0}};
+
+  // The statistics are unchanged if their image is missing or has other dimensions
+  CHECK(!stats->moveVoxels(changes, nullptr, 0));
+  CHECK(!stats->moveVoxels(changes, &other, 0));
+  CHECK(!stats->moveVoxels(changes, &image, 1));
+  CHECK_EQ(stats->label(1)->m_numVoxels, std::size_t{27});
+
+  CHECK(stats->moveVoxels(changes, &image, 0));
+  CHECK_EQ(stats->label(1)->m_numVoxels, std::size_t{26});
+}
@@ -0,0 +1,210 @@
+#include "Testing.h"
+
+#include "logic/annotation/LandmarkGroup.h"
+#include "logic/annotation/LandmarkIndex.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using PointMap = std::map<std::size_t, PointRecord<glm::vec3> >;
+
+/// Points scattered in a box, with clusters of coincident and coplanar points, keyed by
+/// non-contiguous indices
+PointMap makePoints(std::size_t numPoints, std::mt19937& rng)
+{
+  std::uniform_real_distribution<float> coord(-50.0f, 50.0f);
+  PointMap points;
+
+  for (std::size_t i = 0; i < numPoints; ++i)
+  {
+    glm::vec3 p{coord(rng), coord(rng), coord(rng)};
+
+    if (0 == i % 10)
+    {
+      p.z = 5.0f; // on the plane z = 5
+    }
+    else if (0 == i % 13)
+    {
+      p = glm::vec3{1.0f, 2.0f, 3.0f}; // coincident
+    }
+
+    points.emplace(3 * i + 1, PointRecord<glm::vec3>{p});
+  }
+
+  return points;
+}
+
+/// Indices of the points within a slab about a plane and inside an optional box, in ascending
+/// order, found by testing every point
+std::vector<std::size_t> bruteForceQuery(
+  const PointMap& points,
+  const glm::vec4& plane,
+  float maxDistance,
+  const std::optional<AABB<float> >& box
+)
+{
+  std::vector<std::size_t> found;
+
+  for (const auto& [index, point] : points)
+  {
+    const glm::vec3& p = point.getPosition();
+
+    if (box
+        && (p.x < box->first.x || p.y < box->first.y || p.z < box->first.z
+            || box->second.x < p.x || box->second.y < p.y || box->second.z < p.z))
+    {
+      continue;
+    }
+
+    if (std::abs(plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w) < maxDistance)
+    {
+      found.push_back(index);
+    }
+  }
+
+  return found;
+}
+
+/// Random plane, which is not normalized
+glm::vec4 randomPlane(std::mt19937& rng)
+{
+  std::uniform_real_distribution<float> component(-2.0f, 2.0f);
+  std::uniform_real_distribution<float> offset(-40.0f, 40.0f);
+  return glm::vec4{component(rng), component(rng), component(rng), offset(rng)};
+}
+
+/// Check random queries of an index against brute-force queries
+void checkQueries(const LandmarkIndex& index, const PointMap& points, std::mt19937& rng)
+{
+  CHECK_EQ(index.size(), points.size());
+
+  std::uniform_real_distribution<float> distance(0.1f, 10.0f);
+  std::uniform_real_distribution<float> coord(-60.0f, 60.0f);
+
+  std::size_t numWrong = 0;
+  std::size_t numFound = 0;
+
+  for (int q = 0; q < 300; ++q)
+  {
+    const glm::vec4 plane = randomPlane(rng);
+    const float maxDistance = distance(rng);
+
+    std::optional<AABB<float> > box;
+
+    if (0 == q % 2)
+    {
+      const glm::vec3 a{coord(rng), coord(rng), coord(rng)};
+      const glm::vec3 b{coord(rng), coord(rng), coord(rng)};
+      box = AABB<float>{glm::min(a, b), glm::max(a, b)};
+    }
+
+    const std::vector<std::size_t> expected = bruteForceQuery(points, plane, maxDistance, box);
+    numWrong += (index.query(plane, maxDistance, box) == expected) ? 0 : 1;
+    numFound += expected.size();
+  }
+
+  CHECK_EQ(numWrong, std::size_t{0});
+
+  // The queries are not trivially empty
+  CHECK(0 < numFound);
+}
+
+} // namespace
+
+ENTROPY_TEST(landmarkIndexQueriesMatchBruteForce)
+{
+  std::mt19937 rng(17);
+
+  for (std::size_t numPoints : {0, 1, 16, 17, 500, 3000})
+  {
+    const PointMap points = makePoints(numPoints, rng);
+
+    LandmarkIndex index;
+    index.build(points);
+
+    if (0 == numPoints)
+    {
+      CHECK(index.query(glm::vec4{0.0f, 0.0f, 1.0f, 0.0f}, 1.0f, std::nullopt).empty());
+      continue;
+    }
+
+    checkQueries(index, points, rng);
+  }
+}
+
+ENTROPY_TEST(landmarkIndexQueriesAxisAlignedSlabs)
+{
+  // Views of axis-aligned planes query slabs of half a slice about the plane
+  std::mt19937 rng(19);
+  const PointMap points = makePoints(2000, rng);
+
+  LandmarkIndex index;
+  index.build(points);
+
+  std::size_t numWrong = 0;
+
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    for (float position = -50.0f; position <= 50.0f; position += 2.5f)
+    {
+      glm::vec4 plane{0.0f};
+      plane[axis] = 1.0f;
+      plane.w = -position;
+
+      const std::vector<std::size_t> expected = bruteForceQuery(points, plane, 0.5f, std::nullopt);
+      numWrong += (index.query(plane, 0.5f, std::nullopt) == expected) ? 0 : 1;
+    }
+  }
+
+  CHECK_EQ(numWrong, std::size_t{0});
+
+  // All of the points on the plane z = 5 are found
+  const auto onPlane = index.query(glm::vec4{0.0f, 0.0f, 1.0f, -5.0f}, 1.0e-3f, std::nullopt);
+  CHECK(200 <= onPlane.size());
+}
+
+ENTROPY_TEST(landmarkGroupIndexFollowsPointChanges)
+{
+  std::mt19937 rng(23);
+
+  LandmarkGroup group;
+  group.setPoints(makePoints(400, rng));
+  checkQueries(group.getIndex(), group.getPoints(), rng);
+
+  // Moving, adding, and removing points rebuilds the index
+  std::uniform_real_distribution<float> coord(-50.0f, 50.0f);
+
+  for (const std::size_t index : {1, 31, 301})
+  {
+    CHECK(group.setPointPosition(index, glm::vec3{coord(rng), coord(rng), coord(rng)}));
+  }
+
+  CHECK(!group.setPointPosition(2, glm::vec3{0.0f}));
+  checkQueries(group.getIndex(), group.getPoints(), rng);
+
+  group.addPoint(PointRecord<glm::vec3>{glm::vec3{0.0f, 0.0f, 5.0f}});
+  CHECK(group.removePoint(4));
+  checkQueries(group.getIndex(), group.getPoints(), rng);
+
+  // Other attributes of the points are set through the group too
+  CHECK(group.setPointName(1, "apex"));
+  CHECK(group.setPointColor(1, glm::vec3{0.0f, 1.0f, 0.0f}));
+  CHECK(group.setPointVisibility(1, false));
+  CHECK(!group.setPointVisibility(2, false));
+  CHECK_EQ(group.getPoints().at(1).getName(), std::string("apex"));
+  CHECK(!group.getPoints().at(1).getVisibility());
+
+  group.setPointsVisibility(true);
+  CHECK(group.getPoints().at(1).getVisibility());
+  checkQueries(group.getIndex(), group.getPoints(), rng);
+}
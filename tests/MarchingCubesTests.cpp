@@ -0,0 +1,411 @@
+#include "Testing.h"
+#include "TestImages.h"
+
+#include "image/MinMaxBlockTree.h"
+#include "mesh/MarchingCubes.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+/// Float image whose voxel values are given by a function of the voxel coordinates
+Image makeFieldImage(const glm::ivec3& dims, const std::function<float(const glm::vec3&)>& field)
+{
+  std::vector<float> values;
+  values.reserve(static_cast<std::size_t>(dims.x) * dims.y * dims.z);
+
+  for (int z = 0; z < dims.z; ++z)
+  {
+    for (int y = 0; y < dims.y; ++y)
+    {
+      for (int x = 0; x < dims.x; ++x)
+      {
+        values.push_back(field(glm::vec3(x, y, z)));
+      }
+    }
+  }
+
+  return testing::makeTestImage(
+    dims, ComponentType::Float32, values.data(), Image::ImageRepresentation::Image
+  );
+}
+
+/// Image of values in {0, 1} with a border of zeros, so that surfaces at isovalue 0.5 are closed
+Image makeBinaryImage(const glm::ivec3& dims, const std::vector<glm::ivec3>& insideVoxels)
+{
+  std::vector<float> values(static_cast<std::size_t>(dims.x) * dims.y * dims.z, 0.0f);
+
+  for (const glm::ivec3& v : insideVoxels)
+  {
+    values[(static_cast<std::size_t>(v.z) * dims.y + v.y) * dims.x + v.x] = 1.0f;
+  }
+
+  return testing::makeTestImage(
+    dims, ComponentType::Float32, values.data(), Image::ImageRepresentation::Image
+  );
+}
+
+std::size_t numTriangles(const IsosurfaceMesh& mesh)
+{
+  return mesh.m_indices.size() / 3;
+}
+
+/**
+ * @brief Check that a mesh is closed and consistently oriented: each edge is in exactly two
+ * triangles, which use it in opposite directions, so that the mesh has no cracks.
+ * @return Euler characteristic of the mesh
+ */
+long checkClosed(const IsosurfaceMesh& mesh)
+{
+  REQUIRE(0 == mesh.m_indices.size() % 3);
+  CHECK_EQ(mesh.m_normals.size(), mesh.m_positions.size());
+
+  std::set<std::pair<uint32_t, uint32_t> > edges;
+  std::size_t numRepeated = 0;
+  std::size_t numDegenerate = 0;
+
+  for (std::size_t t = 0; t < mesh.m_indices.size(); t += 3)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      const uint32_t a = mesh.m_indices[t + c];
+      const uint32_t b = mesh.m_indices[t + (c + 1) % 3];
+
+      REQUIRE(a < mesh.m_positions.size());
+      numDegenerate += (a == b) ? 1 : 0;
+      numRepeated += edges.emplace(a, b).second ? 0 : 1;
+    }
+  }
+
+  std::size_t numUnmatched = 0;
+
+  for (const auto& [a, b] : edges)
+  {
+    numUnmatched += edges.count({b, a}) ? 0 : 1;
+  }
+
+  // A directed edge in two triangles means that the edge is in three or more triangles or that
+  // the orientations of its triangles disagree. An unmatched edge is on a crack.
+  CHECK_EQ(numDegenerate, std::size_t{0});
+  CHECK_EQ(numRepeated, std::size_t{0});
+  CHECK_EQ(numUnmatched, std::size_t{0});
+
+  const auto numVertices = static_cast<long>(mesh.m_positions.size());
+  const auto numEdges = static_cast<long>(edges.size() / 2);
+  const auto numFaces = static_cast<long>(numTriangles(mesh));
+  return numVertices - numEdges + numFaces;
+}
+
+double surfaceArea(const IsosurfaceMesh& mesh)
+{
+  double area = 0.0;
+
+  for (std::size_t t = 0; t < mesh.m_indices.size(); t += 3)
+  {
+    const glm::dvec3 p0{mesh.m_positions[mesh.m_indices[t]]};
+    const glm::dvec3 p1{mesh.m_positions[mesh.m_indices[t + 1]]};
+    const glm::dvec3 p2{mesh.m_positions[mesh.m_indices[t + 2]]};
+    area += 0.5 * glm::length(glm::cross(p1 - p0, p2 - p0));
+  }
+
+  return area;
+}
+
+/// Signed volume enclosed by a closed mesh, which is positive if its triangles face out
+double enclosedVolume(const IsosurfaceMesh& mesh)
+{
+  double volume = 0.0;
+
+  for (std::size_t t = 0; t < mesh.m_indices.size(); t += 3)
+  {
+    const glm::dvec3 p0{mesh.m_positions[mesh.m_indices[t]]};
+    const glm::dvec3 p1{mesh.m_positions[mesh.m_indices[t + 1]]};
+    const glm::dvec3 p2{mesh.m_positions[mesh.m_indices[t + 2]]};
+    volume += glm::dot(p0, glm::cross(p1, p2)) / 6.0;
+  }
+
+  return volume;
+}
+
+/// Range of the voxels at the corners of the cells of a block, computed by visiting them
+MinMaxBlockTree::Range bruteForceBlockRange(
+  const std::vector<float>& values, const glm::ivec3& dims, const glm::ivec3& block
+)
+{
+  const int B = static_cast<int>(MinMaxBlockTree::sk_blockSize);
+  const glm::ivec3 lo = block * B;
+  const glm::ivec3 hi = glm::min((block + 1) * B, dims - 1);
+
+  MinMaxBlockTree::Range range{values.at(0), values.at(0)};
+  bool first = true;
+
+  for (int z = lo.z; z <= hi.z; ++z)
+  {
+    for (int y = lo.y; y <= hi.y; ++y)
+    {
+      for (int x = lo.x; x <= hi.x; ++x)
+      {
+        const float v = values[(static_cast<std::size_t>(z) * dims.y + y) * dims.x + x];
+        range.m_min = first ? v : std::min(range.m_min, v);
+        range.m_max = first ? v : std::max(range.m_max, v);
+        first = false;
+      }
+    }
+  }
+
+  return range;
+}
+
+} // namespace
+
+ENTROPY_TEST(marchingCubesSphereIsClosedWithAnalyticArea)
+{
+  // Values are positive inside of a sphere whose center is off the voxel grid
+  const glm::vec3 center{15.5f, 15.3f, 15.7f};
+  const float radius = 10.0f;
+
+  const Image image = makeFieldImage(
+    {32, 32, 32}, [&](const glm::vec3& p) { return radius - glm::length(p - center); }
+  );
+
+  const std::optional<IsosurfaceMesh> mesh = extractIsosurface(image, 0, 0.0);
+  REQUIRE(mesh);
+  REQUIRE(0 < numTriangles(*mesh));
+
+  // A sphere has Euler characteristic 2
+  CHECK_EQ(checkClosed(*mesh), 2L);
+
+  // The polygonal surface is inscribed in the sphere, so its area and volume are slightly low
+  const double pi = glm::pi<double>();
+  const double area = 4.0 * pi * radius * radius;
+  const double volume = 4.0 / 3.0 * pi * radius * radius * radius;
+
+  CHECK_NEAR(surfaceArea(*mesh), area, 0.02 * area);
+  CHECK_NEAR(enclosedVolume(*mesh), volume, 0.02 * volume);
+
+  // Vertices are on the sphere, up to the error of linear interpolation along cell edges
+  float maxDistance = 0.0f;
+  for (const glm::vec3& p : mesh->m_positions)
+  {
+    maxDistance = std::max(maxDistance, std::abs(glm::length(p - center) - radius));
+  }
+  CHECK(maxDistance < 0.05f);
+
+  // Normals point out of the sphere, towards lower values
+  std::size_t numInwardNormals = 0;
+  for (std::size_t v = 0; v < mesh->m_positions.size(); ++v)
+  {
+    const glm::vec3 radial = mesh->m_positions[v] - center;
+    numInwardNormals += (glm::dot(mesh->m_normals[v], radial) > 0.0f) ? 0 : 1;
+  }
+  CHECK_EQ(numInwardNormals, std::size_t{0});
+}
+
+ENTROPY_TEST(marchingCubesTorusIsClosedWithAnalyticArea)
+{
+  const glm::vec3 center{15.6f, 15.2f, 7.9f};
+  const float majorRadius = 9.0f;
+  const float minorRadius = 3.5f;
+
+  const Image image = makeFieldImage(
+    {32, 32, 16},
+    [&](const glm::vec3& p)
+    {
+      const glm::vec3 d = p - center;
+      const float ring = std::sqrt(d.x * d.x + d.y * d.y) - majorRadius;
+      return minorRadius - std::sqrt(ring * ring + d.z * d.z);
+    }
+  );
+
+  const std::optional<IsosurfaceMesh> mesh = extractIsosurface(image, 0, 0.0);
+  REQUIRE(mesh);
+
+  // A torus has Euler characteristic 0
+  CHECK_EQ(checkClosed(*mesh), 0L);
+
+  const double pi = glm::pi<double>();
+  const double area = 4.0 * pi * pi * majorRadius * minorRadius;
+  const double volume = 2.0 * pi * pi * majorRadius * minorRadius * minorRadius;
+
+  CHECK_NEAR(surfaceArea(*mesh), area, 0.03 * area);
+  CHECK_NEAR(enclosedVolume(*mesh), volume, 0.03 * volume);
+}
+
+ENTROPY_TEST(marchingCubesAmbiguousConfigurationsHaveNoCracks)
+{
+  const glm::ivec3 dims{6, 6, 6};
+
+  // Voxels on the diagonal of a face shared by two cells, and voxels on the diagonal of a cell,
+  // each of which makes the faces or interior of the cells ambiguous
+  const std::vector<std::vector<glm::ivec3> > configurations{
+    {{2, 2, 2}, {3, 3, 2}},
+    {{2, 2, 2}, {3, 3, 3}},
+    {{2, 2, 2}, {3, 3, 2}, {2, 3, 3}, {3, 2, 3}},
+    {{2, 3, 2}, {3, 2, 2}, {2, 2, 3}, {3, 3, 3}, {1, 1, 1}}
+  };
+
+  for (const auto& insideVoxels : configurations)
+  {
+    const std::optional<IsosurfaceMesh> mesh
+      = extractIsosurface(makeBinaryImage(dims, insideVoxels), 0, 0.5);
+
+    REQUIRE(mesh);
+    REQUIRE(0 < numTriangles(*mesh));
+    checkClosed(*mesh);
+    CHECK(0.0 < enclosedVolume(*mesh));
+  }
+
+  // Random binary fields have ambiguous faces throughout, including on the faces between blocks
+  // of the min-max tree, where the cells are meshed by different threads
+  const glm::ivec3 randomDims{20, 19, 18};
+  std::mt19937 generator(1234);
+  std::bernoulli_distribution inside(0.4);
+
+  for (int trial = 0; trial < 4; ++trial)
+  {
+    std::vector<glm::ivec3> insideVoxels;
+
+    for (int z = 1; z < randomDims.z - 1; ++z)
+    {
+      for (int y = 1; y < randomDims.y - 1; ++y)
+      {
+        for (int x = 1; x < randomDims.x - 1; ++x)
+        {
+          if (inside(generator))
+          {
+            insideVoxels.emplace_back(x, y, z);
+          }
+        }
+      }
+    }
+
+    const std::optional<IsosurfaceMesh> mesh
+      = extractIsosurface(makeBinaryImage(randomDims, insideVoxels), 0, 0.5);
+
+    REQUIRE(mesh);
+    REQUIRE(0 < numTriangles(*mesh));
+    checkClosed(*mesh);
+  }
+}
+
+ENTROPY_TEST(minMaxBlockTreeSkipsBlocksOutsideOfIsovalue)
+{
+  // Blobs in a few blocks of an image whose dimensions are not multiples of the block size
+  const glm::ivec3 dims{41, 30, 19};
+  const std::vector<glm::vec3> blobs{
+    {5.0f, 6.0f, 4.0f}, {30.0f, 22.5f, 12.0f}, {20.0f, 4.0f, 15.0f}
+  };
+
+  auto field = [&blobs](const glm::vec3& p)
+  {
+    float value = 0.0f;
+    for (const glm::vec3& b : blobs)
+    {
+      const glm::vec3 d = p - b;
+      value += std::exp(-glm::dot(d, d) / 8.0f);
+    }
+    return value;
+  };
+
+  std::vector<float> values;
+  for (int z = 0; z < dims.z; ++z)
+  {
+    for (int y = 0; y < dims.y; ++y)
+    {
+      for (int x = 0; x < dims.x; ++x)
+      {
+        values.push_back(field(glm::vec3(x, y, z)));
+      }
+    }
+  }
+
+  const Image image = testing::makeTestImage(
+    dims, ComponentType::Float32, values.data(), Image::ImageRepresentation::Image
+  );
+
+  const MinMaxBlockTree tree(image, 0);
+  const glm::ivec3 gridDims{tree.blockGridDims()};
+
+  REQUIRE(!tree.isEmpty());
+  CHECK(gridDims == glm::ivec3(5, 4, 3));
+  REQUIRE(static_cast<std::size_t>(gridDims.x * gridDims.y * gridDims.z) == tree.numBlocks());
+
+  for (float isoValue : {0.05f, 0.3f, 0.9f, 2.0f})
+  {
+    // Blocks whose range straddles the isovalue, found by visiting all of their voxels
+    std::vector<uint32_t> expected;
+    std::size_t numWrongRanges = 0;
+
+    for (uint32_t b = 0; b < tree.numBlocks(); ++b)
+    {
+      const glm::ivec3 block{
+        static_cast<int>(b) % gridDims.x,
+        (static_cast<int>(b) / gridDims.x) % gridDims.y,
+        static_cast<int>(b) / (gridDims.x * gridDims.y)
+      };
+
+      const MinMaxBlockTree::Range range = bruteForceBlockRange(values, dims, block);
+      const MinMaxBlockTree::Range& treeRange = tree.blockRange(b);
+
+      numWrongRanges += (range.m_min == treeRange.m_min && range.m_max == treeRange.m_max) ? 0 : 1;
+
+      if (range.straddles(isoValue))
+      {
+        expected.push_back(b);
+      }
+    }
+
+    CHECK_EQ(numWrongRanges, std::size_t{0});
+
+    const std::vector<uint32_t> active = tree.activeBlocks(isoValue);
+    CHECK(active == expected);
+
+    // The blobs cover few blocks, so most are skipped
+    CHECK(active.size() < tree.numBlocks() / 2);
+
+    const std::optional<IsosurfaceMesh> mesh = extractIsosurface(image, 0, isoValue);
+    REQUIRE(mesh);
+    CHECK_EQ(mesh->m_numActiveBlocks, active.size());
+    CHECK_EQ(mesh->m_positions.empty(), active.empty());
+
+    // All vertices are in the cells of the active blocks
+    const float B = static_cast<float>(MinMaxBlockTree::sk_blockSize);
+    std::size_t numOutside = 0;
+
+    for (const glm::vec3& p : mesh->m_positions)
+    {
+      bool inActiveBlock = false;
+
+      for (uint32_t b : active)
+      {
+        const glm::vec3 lo = B * glm::vec3(
+          static_cast<float>(b % gridDims.x),
+          static_cast<float>((b / gridDims.x) % gridDims.y),
+          static_cast<float>(b / (gridDims.x * gridDims.y))
+        );
+
+        inActiveBlock |= glm::all(glm::lessThanEqual(lo, p))
+                         && glm::all(glm::lessThanEqual(p, lo + B));
+      }
+
+      numOutside += inActiveBlock ? 0 : 1;
+    }
+
+    CHECK_EQ(numOutside, std::size_t{0});
+  }
+
+  // Isovalues above all values have no active blocks
+  CHECK(tree.activeBlocks(3.5f).empty());
+}
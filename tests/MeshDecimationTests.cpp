@@ -0,0 +1,305 @@
+#include "Testing.h"
+
+#include "mesh/MeshDecimation.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+/// Sphere of unit radius, made by subdividing the faces of an icosahedron. It has 20 * 4^n
+/// triangles after n subdivisions.
+IsosurfaceMesh makeIcosphere(int numSubdivisions)
+{
+  const float t = 0.5f * (1.0f + std::sqrt(5.0f));
+
+  IsosurfaceMesh mesh;
+  mesh.m_positions = {
+    {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+    {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}
+  };
+  mesh.m_indices = {
+    0, 11, 5,  0, 5, 1,  0, 1, 7,   0, 7,  10, 0, 10, 11,
+    1, 5,  9,  5, 11, 4, 11, 10, 2, 10, 7, 6,  7, 1,  8,
+    3, 9,  4,  3, 4, 2,  3, 2, 6,   3, 6,  8,  3, 8,  9,
+    4, 9,  5,  2, 4, 11, 6, 2, 10,  8, 6,  7,  9, 8,  1
+  };
+
+  for (glm::vec3& p : mesh.m_positions)
+  {
+    p = glm::normalize(p);
+  }
+
+  for (int i = 0; i < numSubdivisions; ++i)
+  {
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> midpoints;
+
+    auto midpoint = [&mesh, &midpoints](uint32_t a, uint32_t b)
+    {
+      const auto key = std::make_pair(std::min(a, b), std::max(a, b));
+      const auto it = midpoints.find(key);
+
+      if (std::end(midpoints) != it)
+      {
+        return it->second;
+      }
+
+      const auto m = static_cast<uint32_t>(mesh.m_positions.size());
+      mesh.m_positions.push_back(glm::normalize(mesh.m_positions[a] + mesh.m_positions[b]));
+      midpoints.emplace(key, m);
+      return m;
+    };
+
+    std::vector<uint32_t> indices;
+
+    for (std::size_t f = 0; f < mesh.m_indices.size(); f += 3)
+    {
+      const uint32_t a = mesh.m_indices[f];
+      const uint32_t b = mesh.m_indices[f + 1];
+      const uint32_t c = mesh.m_indices[f + 2];
+      const uint32_t ab = midpoint(a, b);
+      const uint32_t bc = midpoint(b, c);
+      const uint32_t ca = midpoint(c, a);
+
+      indices.insert(std::end(indices), {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+    }
+
+    mesh.m_indices = std::move(indices);
+  }
+
+  // The normals of a sphere are its positions
+  mesh.m_normals = mesh.m_positions;
+  return mesh;
+}
+
+/// Square of n x n cells in the z = 0 plane, with a bump in its middle, so that it has a boundary
+IsosurfaceMesh makeBumpyPatch(int n)
+{
+  IsosurfaceMesh mesh;
+
+  for (int y = 0; y <= n; ++y)
+  {
+    for (int x = 0; x <= n; ++x)
+    {
+      const glm::vec2 p = glm::vec2(static_cast<float>(x), static_cast<float>(y)) / float(n);
+      const glm::vec2 d = p - 0.5f;
+      mesh.m_positions.emplace_back(p.x, p.y, 0.2f * std::exp(-20.0f * glm::dot(d, d)));
+      mesh.m_normals.emplace_back(0.0f, 0.0f, 1.0f);
+    }
+  }
+
+  for (int y = 0; y < n; ++y)
+  {
+    for (int x = 0; x < n; ++x)
+    {
+      const auto v = static_cast<uint32_t>(y * (n + 1) + x);
+      const auto w = static_cast<uint32_t>(n + 1);
+      mesh.m_indices.insert(std::end(mesh.m_indices), {v, v + 1, v + w + 1, v, v + w + 1, v + w});
+    }
+  }
+
+  return mesh;
+}
+
+std::size_t numTriangles(const IsosurfaceMesh& mesh)
+{
+  return mesh.m_indices.size() / 3;
+}
+
+/// Directed edges of a mesh, which must each be in one triangle
+std::set<std::pair<uint32_t, uint32_t> > directedEdges(const IsosurfaceMesh& mesh)
+{
+  std::set<std::pair<uint32_t, uint32_t> > edges;
+  std::size_t numRepeated = 0;
+  std::size_t numDegenerate = 0;
+
+  for (std::size_t t = 0; t < mesh.m_indices.size(); t += 3)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      const uint32_t a = mesh.m_indices[t + c];
+      const uint32_t b = mesh.m_indices[t + (c + 1) % 3];
+
+      numDegenerate += (a == b) ? 1 : 0;
+      numRepeated += edges.emplace(a, b).second ? 0 : 1;
+    }
+  }
+
+  // Repeated directed edges are on more than two triangles or on triangles with flipped
+  // orientations
+  CHECK_EQ(numDegenerate, std::size_t{0});
+  CHECK_EQ(numRepeated, std::size_t{0});
+  return edges;
+}
+
+/// Check that the vertices of a mesh are all used and that its vertex arrays match
+void checkVertices(const IsosurfaceMesh& mesh)
+{
+  REQUIRE(0 == mesh.m_indices.size() % 3);
+  REQUIRE(mesh.m_normals.size() == mesh.m_positions.size());
+
+  std::vector<bool> used(mesh.m_positions.size(), false);
+
+  for (uint32_t v : mesh.m_indices)
+  {
+    REQUIRE(v < mesh.m_positions.size());
+    used[v] = true;
+  }
+
+  std::size_t numUnused = 0;
+
+  for (bool u : used)
+  {
+    numUnused += u ? 0 : 1;
+  }
+
+  CHECK_EQ(numUnused, std::size_t{0});
+}
+
+/// Check that a mesh is a closed, consistently oriented surface of genus zero
+void checkClosed(const IsosurfaceMesh& mesh)
+{
+  checkVertices(mesh);
+
+  const std::set<std::pair<uint32_t, uint32_t> > edges = directedEdges(mesh);
+  std::size_t numUnmatched = 0;
+
+  for (const auto& [a, b] : edges)
+  {
+    numUnmatched += edges.count({b, a}) ? 0 : 1;
+  }
+
+  CHECK_EQ(numUnmatched, std::size_t{0});
+
+  const auto numVertices = static_cast<long>(mesh.m_positions.size());
+  const auto numEdges = static_cast<long>(edges.size() / 2);
+  const auto numFaces = static_cast<long>(numTriangles(mesh));
+  CHECK_EQ(numVertices - numEdges + numFaces, 2L);
+}
+
+/// Signed volume enclosed by a closed mesh, which is positive if its triangles face out
+double enclosedVolume(const IsosurfaceMesh& mesh)
+{
+  double volume = 0.0;
+
+  for (std::size_t t = 0; t < mesh.m_indices.size(); t += 3)
+  {
+    const glm::dvec3 p0{mesh.m_positions[mesh.m_indices[t]]};
+    const glm::dvec3 p1{mesh.m_positions[mesh.m_indices[t + 1]]};
+    const glm::dvec3 p2{mesh.m_positions[mesh.m_indices[t + 2]]};
+    volume += glm::dot(p0, glm::cross(p1, p2)) / 6.0;
+  }
+
+  return volume;
+}
+
+} // namespace
+
+ENTROPY_TEST(meshDecimationMeetsTriangleTargets)
+{
+  const IsosurfaceMesh sphere = makeIcosphere(5);
+  REQUIRE(20480 == numTriangles(sphere));
+
+  for (std::size_t target : {10000, 2000, 300})
+  {
+    const IsosurfaceMesh decimated = decimateMesh(sphere, target);
+
+    // Collapses remove two triangles each and stop at the target, but few enough may be skipped
+    // that the target is not far off
+    CHECK(numTriangles(decimated) <= target);
+    CHECK(9 * target / 10 <= numTriangles(decimated));
+    checkVertices(decimated);
+  }
+
+  // Meshes that meet the target are unchanged
+  const IsosurfaceMesh unchanged = decimateMesh(sphere, numTriangles(sphere));
+  CHECK(unchanged.m_indices == sphere.m_indices);
+  CHECK(unchanged.m_positions == sphere.m_positions);
+}
+
+ENTROPY_TEST(meshDecimationKeepsClosedMeshesManifold)
+{
+  const IsosurfaceMesh sphere = makeIcosphere(5);
+  checkClosed(sphere);
+
+  for (std::size_t target : {5000, 500, 60})
+  {
+    checkClosed(decimateMesh(sphere, target));
+  }
+}
+
+ENTROPY_TEST(meshDecimationPreservesVolume)
+{
+  const IsosurfaceMesh sphere = makeIcosphere(6);
+  const double volume = enclosedVolume(sphere);
+
+  // The volume of the tessellated sphere is close to that of the unit sphere
+  CHECK_NEAR(volume, 4.0 / 3.0 * glm::pi<double>(), 0.01);
+
+  const IsosurfaceMesh fine = decimateMesh(sphere, 20000);
+  CHECK_NEAR(enclosedVolume(fine), volume, 1.0e-3 * volume);
+
+  // Vertices stay close to the sphere
+  float maxDistance = 0.0f;
+  for (const glm::vec3& p : fine.m_positions)
+  {
+    maxDistance = std::max(maxDistance, std::abs(glm::length(p) - 1.0f));
+  }
+  CHECK(maxDistance < 0.01f);
+
+  const IsosurfaceMesh coarse = decimateMesh(sphere, 1000);
+  CHECK_NEAR(enclosedVolume(coarse), volume, 0.02 * volume);
+}
+
+ENTROPY_TEST(meshDecimationKeepsBoundaries)
+{
+  const int n = 40;
+  const IsosurfaceMesh patch = makeBumpyPatch(n);
+  const IsosurfaceMesh decimated = decimateMesh(patch, 400);
+
+  CHECK(numTriangles(decimated) <= 400);
+  checkVertices(decimated);
+
+  // Each edge is on one or two triangles, with opposite orientations
+  const std::set<std::pair<uint32_t, uint32_t> > edges = directedEdges(decimated);
+
+  // Boundary vertices stay on the sides of the square, and its corners are kept. Positions that
+  // minimize quadrics are only exact up to rounding.
+  const float tolerance = 1.0e-4f;
+  std::size_t numOffBoundary = 0;
+  std::set<std::pair<int, int> > corners;
+
+  for (const auto& [a, b] : edges)
+  {
+    if (edges.count({b, a}))
+    {
+      continue;
+    }
+
+    for (uint32_t v : {a, b})
+    {
+      const glm::vec3& p = decimated.m_positions[v];
+      const glm::vec2 xy{p.x, p.y};
+      const glm::vec2 d = glm::min(glm::abs(xy), glm::abs(xy - 1.0f));
+
+      numOffBoundary += (d.x < tolerance || d.y < tolerance) ? 0 : 1;
+
+      if (d.x < tolerance && d.y < tolerance)
+      {
+        corners.emplace(static_cast<int>(std::round(p.x)), static_cast<int>(std::round(p.y)));
+      }
+    }
+  }
+
+  CHECK_EQ(numOffBoundary, std::size_t{0});
+  CHECK_EQ(corners.size(), std::size_t{4});
+}
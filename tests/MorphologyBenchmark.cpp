@@ -0,0 +1,167 @@
+#include "Testing.h"
+#include "TestImages.h"
+
+#include "logic/segmentation/Morphology.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/// Side length (in voxels) of the synthetic segmentation
+constexpr int sk_size = 512;
+
+/// Slices along z on which the result is checked against a brute-force dilation
+constexpr int sk_checkSlices[] = {sk_size / 2, sk_size / 2 + 61, sk_size / 2 + 150};
+
+std::size_t voxelIndex(int x, int y, int z)
+{
+  return (static_cast<std::size_t>(z) * sk_size + y) * sk_size + x;
+}
+
+/// Bumpy sphere of label 1, with blocks of label 2 that cut into it
+std::vector<uint8_t> makeLabels()
+{
+  std::vector<uint8_t> labels(static_cast<std::size_t>(sk_size) * sk_size * sk_size, 0);
+
+  const float center = 0.5f * static_cast<float>(sk_size - 1);
+  const float radius = 0.3f * static_cast<float>(sk_size);
+
+  for (int z = 0; z < sk_size; ++z)
+  {
+    for (int y = 0; y < sk_size; ++y)
+    {
+      for (int x = 0; x < sk_size; ++x)
+      {
+        const glm::vec3 p{static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)};
+        const glm::vec3 d = p - center;
+        const float bumps = 8.0f * std::sin(p.x / 11.0f) * std::cos(p.y / 13.0f)
+                            + 5.0f * std::sin(p.z / 7.0f);
+
+        uint8_t& label = labels[voxelIndex(x, y, z)];
+
+        if (glm::length(d) < radius + bumps)
+        {
+          label = 1;
+        }
+
+        if (0 == (x / 64 + y / 64 + z / 64) % 5 && 0 == (x / 32) % 2)
+        {
+          label = 2;
+        }
+      }
+    }
+  }
+
+  return labels;
+}
+
+/// Brute-force dilation of label 1 at a voxel: it becomes 1 if it is background and a voxel of
+/// label 1 is within the structuring element
+uint8_t bruteForceDilation(
+  const std::vector<uint8_t>& labels, int x, int y, int z, MorphologyElement element, int radius
+)
+{
+  const uint8_t value = labels[voxelIndex(x, y, z)];
+
+  if (0 != value)
+  {
+    return value;
+  }
+
+  for (int dz = -radius; dz <= radius; ++dz)
+  {
+    for (int dy = -radius; dy <= radius; ++dy)
+    {
+      for (int dx = -radius; dx <= radius; ++dx)
+      {
+        const glm::ivec3 p{x + dx, y + dy, z + dz};
+
+        if (glm::any(glm::lessThan(p, glm::ivec3{0}))
+            || glm::any(glm::greaterThanEqual(p, glm::ivec3{sk_size})))
+        {
+          continue;
+        }
+
+        if (MorphologyElement::Ball == element && dx * dx + dy * dy + dz * dz > radius * radius)
+        {
+          continue;
+        }
+
+        if (1 == labels[voxelIndex(p.x, p.y, p.z)])
+        {
+          return 1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+void benchmarkDilation(MorphologyElement element, int radius, const char* elementName)
+{
+  const std::vector<uint8_t> labels = makeLabels();
+  Image seg = testing::makeTestSeg(glm::ivec3{sk_size}, labels);
+
+  MorphologyParams params;
+  params.operation = MorphologyOperation::Dilate;
+  params.element = element;
+  params.radius = static_cast<double>(radius);
+  params.label = 1;
+
+  const auto start = Clock::now();
+  const std::optional<std::size_t> numChanged = applySegMorphology(seg, params, nullptr);
+  const auto stop = Clock::now();
+
+  REQUIRE(numChanged);
+
+  std::printf(
+    "  %s dilation of radius %d, %d^3 voxels: %8.1f ms (%zu voxels changed)\n",
+    elementName,
+    radius,
+    sk_size,
+    std::chrono::duration<double, std::milli>(stop - start).count(),
+    *numChanged
+  );
+
+  const uint8_t* result = static_cast<const uint8_t*>(std::as_const(seg).bufferAsVoid(0));
+  std::size_t numWrong = 0;
+
+  for (int z : sk_checkSlices)
+  {
+    for (int y = 0; y < sk_size; ++y)
+    {
+      for (int x = 0; x < sk_size; ++x)
+      {
+        const uint8_t expected = bruteForceDilation(labels, x, y, z, element, radius);
+        numWrong += (expected != result[voxelIndex(x, y, z)]) ? 1 : 0;
+      }
+    }
+  }
+
+  CHECK(0 < *numChanged);
+  CHECK_EQ(numWrong, std::size_t{0});
+}
+
+} // namespace
+
+ENTROPY_TEST(morphologyDilationWithBall)
+{
+  benchmarkDilation(MorphologyElement::Ball, 3, "Ball");
+}
+
+ENTROPY_TEST(morphologyDilationWithBox)
+{
+  benchmarkDilation(MorphologyElement::Box, 3, "Box");
+}
@@ -0,0 +1,337 @@
+#include "Testing.h"
+#include "TestImages.h"
+
+#include "logic/segmentation/Morphology.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+/// Dimensions that are not multiples of 64, so that the rows of the masks end in partial words
+const glm::ivec3 sk_dims{70, 29, 23};
+
+std::size_t voxelIndex(int x, int y, int z)
+{
+  return (static_cast<std::size_t>(z) * sk_dims.y + y) * sk_dims.x + x;
+}
+
+bool isInside(int x, int y, int z)
+{
+  return 0 <= x && x < sk_dims.x && 0 <= y && y < sk_dims.y && 0 <= z && z < sk_dims.z;
+}
+
+/// Balls and scattered voxels of label 1, some of which touch the image boundary, and blocks of
+/// label 2 that are next to them
+template<typename S>
+std::vector<S> makeLabels(unsigned int seed)
+{
+  std::vector<S> labels(static_cast<std::size_t>(sk_dims.x) * sk_dims.y * sk_dims.z, 0);
+
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> dx(0, sk_dims.x - 1);
+  std::uniform_int_distribution<int> dy(0, sk_dims.y - 1);
+  std::uniform_int_distribution<int> dz(0, sk_dims.z - 1);
+  std::uniform_int_distribution<int> radius(1, 6);
+
+  for (int i = 0; i < 8; ++i)
+  {
+    const glm::ivec3 c{dx(rng), dy(rng), dz(rng)};
+    const int r = radius(rng);
+
+    for (int z = 0; z < sk_dims.z; ++z)
+    {
+      for (int y = 0; y < sk_dims.y; ++y)
+      {
+        for (int x = 0; x < sk_dims.x; ++x)
+        {
+          const glm::ivec3 d = glm::ivec3{x, y, z} - c;
+          if (glm::dot(d, d) <= r * r)
+          {
+            labels[voxelIndex(x, y, z)] = 1;
+          }
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < 60; ++i)
+  {
+    labels[voxelIndex(dx(rng), dy(rng), dz(rng))] = 1;
+  }
+
+  for (int i = 0; i < 4; ++i)
+  {
+    const glm::ivec3 c{dx(rng), dy(rng), dz(rng)};
+
+    for (int z = c.z; z < std::min(c.z + 5, sk_dims.z); ++z)
+    {
+      for (int y = c.y; y < std::min(c.y + 5, sk_dims.y); ++y)
+      {
+        for (int x = c.x; x < std::min(c.x + 5, sk_dims.x); ++x)
+        {
+          labels[voxelIndex(x, y, z)] = 2;
+        }
+      }
+    }
+  }
+
+  return labels;
+}
+
+/// Offsets of the voxels of a structuring element with unit spacing
+std::vector<glm::ivec3> elementOffsets(MorphologyElement element, double radius)
+{
+  const int r = static_cast<int>(std::ceil(radius));
+  const int boxRadius = static_cast<int>(std::floor(radius));
+  std::vector<glm::ivec3> offsets;
+
+  for (int z = -r; z <= r; ++z)
+  {
+    for (int y = -r; y <= r; ++y)
+    {
+      for (int x = -r; x <= r; ++x)
+      {
+        const glm::ivec3 d{x, y, z};
+        const bool inBall = (glm::dot(d, d) <= radius * radius);
+        const bool inBox = glm::all(glm::lessThan(glm::abs(d), glm::ivec3{boxRadius + 1}));
+
+        if ((MorphologyElement::Ball == element) ? inBall : inBox)
+        {
+          offsets.push_back(d);
+        }
+      }
+    }
+  }
+
+  return offsets;
+}
+
+/// Brute-force dilation (or erosion) of a binary mask. Voxels outside of the image are not in the
+/// mask when dilating and are in it when eroding.
+std::vector<bool> bruteForce(
+  const std::vector<bool>& mask, const std::vector<glm::ivec3>& offsets, bool dilate
+)
+{
+  std::vector<bool> result(mask.size(), false);
+
+  for (int z = 0; z < sk_dims.z; ++z)
+  {
+    for (int y = 0; y < sk_dims.y; ++y)
+    {
+      for (int x = 0; x < sk_dims.x; ++x)
+      {
+        bool value = !dilate;
+
+        for (const glm::ivec3& d : offsets)
+        {
+          const glm::ivec3 p = glm::ivec3{x, y, z} + d;
+          const bool set = isInside(p.x, p.y, p.z) ? mask[voxelIndex(p.x, p.y, p.z)] : !dilate;
+
+          if (set == dilate)
+          {
+            value = dilate;
+            break;
+          }
+        }
+
+        result[voxelIndex(x, y, z)] = value;
+      }
+    }
+  }
+
+  return result;
+}
+
+/// Apply an operation to label 1 and check it against the brute-force operation on its mask
+template<typename S>
+void checkAgainstBruteForce(
+  MorphologyOperation operation, MorphologyElement element, double radius, unsigned int seed
+)
+{
+  const std::vector<S> labels = makeLabels<S>(seed);
+  Image seg = testing::makeTestSeg(sk_dims, labels);
+
+  MorphologyParams params;
+  params.operation = operation;
+  params.element = element;
+  params.radius = radius;
+  params.label = 1;
+
+  const std::optional<std::size_t> numChanged = applySegMorphology(seg, params, nullptr);
+  REQUIRE(numChanged);
+
+  std::vector<bool> mask(labels.size());
+  for (std::size_t i = 0; i < labels.size(); ++i)
+  {
+    mask[i] = (1 == labels[i]);
+  }
+
+  const std::vector<glm::ivec3> offsets = elementOffsets(element, radius);
+
+  switch (operation)
+  {
+  case MorphologyOperation::Dilate:
+    mask = bruteForce(mask, offsets, true);
+    break;
+  case MorphologyOperation::Erode:
+    mask = bruteForce(mask, offsets, false);
+    break;
+  case MorphologyOperation::Open:
+    mask = bruteForce(bruteForce(mask, offsets, false), offsets, true);
+    break;
+  case MorphologyOperation::Close:
+    mask = bruteForce(bruteForce(mask, offsets, true), offsets, false);
+    break;
+  case MorphologyOperation::FillHoles:
+    break;
+  }
+
+  // Voxels are only added to the label where it was background
+  const std::vector<S> result = testing::imageValues<S>(seg);
+  std::size_t numExpectedChanged = 0;
+  std::size_t numWrong = 0;
+
+  for (std::size_t i = 0; i < labels.size(); ++i)
+  {
+    S expected = labels[i];
+
+    if (mask[i] && 0 == labels[i])
+    {
+      expected = 1;
+    }
+    else if (!mask[i] && 1 == labels[i])
+    {
+      expected = 0;
+    }
+
+    numExpectedChanged += (expected != labels[i]) ? 1 : 0;
+    numWrong += (expected != result[i]) ? 1 : 0;
+  }
+
+  CHECK(0 < numExpectedChanged);
+  CHECK_EQ(numWrong, std::size_t{0});
+  CHECK_EQ(*numChanged, numExpectedChanged);
+}
+
+} // namespace
+
+ENTROPY_TEST(morphologyDilatesLikeBruteForce)
+{
+  checkAgainstBruteForce<uint8_t>(MorphologyOperation::Dilate, MorphologyElement::Ball, 2.5, 1);
+  checkAgainstBruteForce<uint16_t>(MorphologyOperation::Dilate, MorphologyElement::Ball, 4.0, 2);
+  checkAgainstBruteForce<uint32_t>(MorphologyOperation::Dilate, MorphologyElement::Box, 2.0, 3);
+  checkAgainstBruteForce<uint16_t>(MorphologyOperation::Dilate, MorphologyElement::Box, 5.0, 4);
+}
+
+ENTROPY_TEST(morphologyErodesLikeBruteForce)
+{
+  checkAgainstBruteForce<uint8_t>(MorphologyOperation::Erode, MorphologyElement::Ball, 1.5, 5);
+  checkAgainstBruteForce<uint16_t>(MorphologyOperation::Erode, MorphologyElement::Box, 1.0, 6);
+}
+
+ENTROPY_TEST(morphologyOpensAndClosesLikeBruteForce)
+{
+  checkAgainstBruteForce<uint16_t>(MorphologyOperation::Open, MorphologyElement::Ball, 2.0, 7);
+  checkAgainstBruteForce<uint16_t>(MorphologyOperation::Close, MorphologyElement::Ball, 3.0, 8);
+  checkAgainstBruteForce<uint8_t>(MorphologyOperation::Close, MorphologyElement::Box, 2.0, 9);
+}
+
+ENTROPY_TEST(morphologyReportsProgressAndSavesChangedBlocks)
+{
+  const std::vector<uint16_t> labels = makeLabels<uint16_t>(10);
+  Image seg = testing::makeTestSeg(sk_dims, labels);
+
+  MorphologyParams params;
+  params.operation = MorphologyOperation::Dilate;
+  params.element = MorphologyElement::Ball;
+  params.radius = 2.0;
+
+  std::vector<std::pair<glm::uvec3, glm::uvec3> > blocks;
+  auto saveSegBlock = [&blocks](const glm::uvec3& offset, const glm::uvec3& size)
+  { blocks.emplace_back(offset, size); };
+
+  std::vector<float> fractions;
+  auto onProgress = [&fractions](float fraction)
+  {
+    fractions.push_back(fraction);
+    return true;
+  };
+
+  // All labels: each is reported before it is processed and before it is written
+  REQUIRE(applySegMorphology(seg, params, saveSegBlock, onProgress));
+  REQUIRE(4 == fractions.size());
+  CHECK_EQ(fractions.front(), 0.0f);
+
+  for (std::size_t i = 1; i < fractions.size(); ++i)
+  {
+    CHECK(fractions[i - 1] <= fractions[i]);
+    CHECK(fractions[i] < 1.0f);
+  }
+
+  // Each changed voxel is in a saved block
+  const std::vector<uint16_t> result = testing::imageValues<uint16_t>(seg);
+  std::size_t numUnsaved = 0;
+
+  for (int z = 0; z < sk_dims.z; ++z)
+  {
+    for (int y = 0; y < sk_dims.y; ++y)
+    {
+      for (int x = 0; x < sk_dims.x; ++x)
+      {
+        if (labels[voxelIndex(x, y, z)] == result[voxelIndex(x, y, z)])
+        {
+          continue;
+        }
+
+        bool saved = false;
+        for (const auto& [offset, size] : blocks)
+        {
+          const glm::uvec3 p{glm::ivec3{x, y, z}};
+          saved = saved
+                  || (glm::all(glm::greaterThanEqual(p, offset))
+                      && glm::all(glm::lessThan(p, offset + size)));
+        }
+
+        numUnsaved += saved ? 0 : 1;
+      }
+    }
+  }
+
+  CHECK(!blocks.empty());
+  CHECK_EQ(numUnsaved, std::size_t{0});
+}
+
+ENTROPY_TEST(morphologyCancelsBeforeWriting)
+{
+  const std::vector<uint16_t> labels = makeLabels<uint16_t>(11);
+
+  MorphologyParams params;
+  params.operation = MorphologyOperation::Close;
+  params.element = MorphologyElement::Box;
+  params.radius = 3.0;
+
+  // Cancelled before any label is processed, or after the operation on the first label and
+  // before it is written
+  for (int numCalls : {1, 2})
+  {
+    Image seg = testing::makeTestSeg(sk_dims, labels);
+    const uint64_t version = seg.dataVersion();
+
+    int calls = 0;
+    auto onProgress = [&calls, numCalls](float) { return ++calls < numCalls; };
+
+    CHECK(!applySegMorphology(seg, params, nullptr, onProgress));
+    CHECK_EQ(calls, numCalls);
+    CHECK(testing::imageValues<uint16_t>(seg) == labels);
+    CHECK_EQ(seg.dataVersion(), version);
+  }
+}
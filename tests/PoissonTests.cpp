@@ -0,0 +1,202 @@
+#include "Testing.h"
+
+#include "logic/segmentation/Poisson.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const glm::ivec3 sk_dims{24, 20, 17};
+
+constexpr LabelType sk_fgSeed = 1;
+constexpr LabelType sk_bgSeed = 2;
+
+/// Noisy bright ball on a dark background, with foreground seeds at its center and background
+/// seeds on two faces of the volume
+struct SeededVolume
+{
+  std::vector<float> m_image;
+  std::vector<uint8_t> m_seeds;
+};
+
+SeededVolume makeSeededVolume()
+{
+  const std::size_t N = static_cast<std::size_t>(sk_dims.x) * sk_dims.y * sk_dims.z;
+
+  SeededVolume volume;
+  volume.m_image.resize(N);
+  volume.m_seeds.resize(N, 0);
+
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.0f, 20.0f);
+
+  const glm::vec3 center = 0.5f * glm::vec3(sk_dims - 1);
+
+  std::size_t i = 0;
+  for (int z = 0; z < sk_dims.z; ++z)
+  {
+    for (int y = 0; y < sk_dims.y; ++y)
+    {
+      for (int x = 0; x < sk_dims.x; ++x, ++i)
+      {
+        const float r = glm::length(glm::vec3(x, y, z) - center);
+        volume.m_image[i] = ((r < 6.0f) ? 180.0f : 60.0f) + noise(rng);
+
+        if (r < 1.5f)
+        {
+          volume.m_seeds[i] = static_cast<uint8_t>(sk_fgSeed);
+        }
+        else if (0 == x || 0 == z)
+        {
+          volume.m_seeds[i] = static_cast<uint8_t>(sk_bgSeed);
+        }
+      }
+    }
+  }
+
+  return volume;
+}
+
+/// Solve the potentials of the foreground and background seeds
+std::vector<std::vector<float> > solve(
+  const SeededVolume& volume, const PoissonSolverSettings& settings
+)
+{
+  const VoxelDistances distances{
+    1.0f, 1.0f, 1.0f, std::sqrt(2.0f), std::sqrt(2.0f), std::sqrt(2.0f), std::sqrt(3.0f)
+  };
+
+  const float beta = computeBeta(volume.m_image.data(), sk_dims);
+  const PoissonEdgeWeights weights
+    = computeEdgeWeights(volume.m_image.data(), sk_dims, distances, 1.0f, beta);
+
+  std::vector<std::vector<float> > potentials;
+  std::vector<float*> potentialPtrs;
+
+  for (LabelType label : {sk_fgSeed, sk_bgSeed})
+  {
+    std::vector<float>& potential = potentials.emplace_back(volume.m_image.size(), 0.0f);
+    initializePotential(volume.m_seeds.data(), potential.data(), sk_dims, label);
+  }
+
+  for (auto& potential : potentials)
+  {
+    potentialPtrs.push_back(potential.data());
+  }
+
+  REQUIRE(solvePotentials(volume.m_seeds.data(), weights, potentialPtrs, settings));
+  return potentials;
+}
+
+float maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+  float maxDiff = 0.0f;
+
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    maxDiff = std::max(maxDiff, std::abs(a[i] - b[i]));
+  }
+
+  return maxDiff;
+}
+
+/// Potentials range from 1 at the seeds of other labels to 2 at the seeds of their label
+constexpr float sk_potentialTolerance = 1.0e-3f;
+
+} // namespace
+
+ENTROPY_TEST(poissonMultigridMatchesSor)
+{
+  const SeededVolume volume = makeSeededVolume();
+
+  PoissonSolverSettings sorSettings;
+  sorSettings.m_useMultigrid = false;
+  sorSettings.m_relativeTolerance = 1.0e-6f;
+  sorSettings.m_maxSorIterations = 20000;
+
+  PoissonSolverSettings multigridSettings = sorSettings;
+  multigridSettings.m_useMultigrid = true;
+
+  const auto sorPotentials = solve(volume, sorSettings);
+  const auto multigridPotentials = solve(volume, multigridSettings);
+
+  for (std::size_t p = 0; p < sorPotentials.size(); ++p)
+  {
+    CHECK(maxDifference(sorPotentials[p], multigridPotentials[p]) < sk_potentialTolerance);
+  }
+
+  // The potentials stay between the values of the seeds, and seeds keep their values
+  std::size_t numOutOfRange = 0;
+  std::size_t numChangedSeeds = 0;
+
+  for (std::size_t i = 0; i < volume.m_seeds.size(); ++i)
+  {
+    const float fg = multigridPotentials[0][i];
+    numOutOfRange += (1.0f - sk_potentialTolerance <= fg && fg <= 2.0f + sk_potentialTolerance)
+                       ? 0
+                       : 1;
+
+    if (sk_fgSeed == volume.m_seeds[i])
+    {
+      numChangedSeeds += (2.0f == fg) ? 0 : 1;
+    }
+    else if (sk_bgSeed == volume.m_seeds[i])
+    {
+      numChangedSeeds += (1.0f == fg) ? 0 : 1;
+    }
+  }
+
+  CHECK_EQ(numOutOfRange, std::size_t{0});
+  CHECK_EQ(numChangedSeeds, std::size_t{0});
+
+  // Both solvers segment the voxels the same way, except where the potentials nearly tie
+  std::vector<uint8_t> sorSeg(volume.m_seeds.size());
+  std::vector<uint8_t> multigridSeg(volume.m_seeds.size());
+
+  computeBinaryResultSeg(
+    {sorPotentials[0].data(), sorPotentials[1].data()}, sorSeg.data(), sk_dims
+  );
+  computeBinaryResultSeg(
+    {multigridPotentials[0].data(), multigridPotentials[1].data()}, multigridSeg.data(), sk_dims
+  );
+
+  std::size_t numDifferent = 0;
+
+  for (std::size_t i = 0; i < sorSeg.size(); ++i)
+  {
+    const float margin = std::abs(sorPotentials[0][i] - sorPotentials[1][i]);
+    numDifferent += (sorSeg[i] == multigridSeg[i] || margin < 2.0f * sk_potentialTolerance) ? 0 : 1;
+  }
+
+  CHECK_EQ(numDifferent, std::size_t{0});
+}
+
+ENTROPY_TEST(poissonMultigridFallsBackToSor)
+{
+  const SeededVolume volume = makeSeededVolume();
+
+  PoissonSolverSettings sorSettings;
+  sorSettings.m_useMultigrid = false;
+  sorSettings.m_relativeTolerance = 1.0e-6f;
+  sorSettings.m_maxSorIterations = 20000;
+
+  // One cycle does not reach the tolerance, so the potentials are finished by SOR
+  PoissonSolverSettings multigridSettings = sorSettings;
+  multigridSettings.m_useMultigrid = true;
+  multigridSettings.m_maxMultigridCycles = 1;
+
+  const auto sorPotentials = solve(volume, sorSettings);
+  const auto fallbackPotentials = solve(volume, multigridSettings);
+
+  for (std::size_t p = 0; p < sorPotentials.size(); ++p)
+  {
+    CHECK(maxDifference(sorPotentials[p], fallbackPotentials[p]) < sk_potentialTolerance);
+  }
+}
@@ -0,0 +1,182 @@
+#include "Testing.h"
+
+#include "common/Profiler.h"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr std::size_t sk_numThreads = 4;
+constexpr std::size_t sk_numCallsPerThread = 100;
+
+/// Statistics of a stage, if it has any
+std::optional<Profiler::StageStats> findStats(const Profiler& profiler, const std::string& name)
+{
+  for (const Profiler::StageStats& s : profiler.stats())
+  {
+    if (name == s.m_name)
+    {
+      return s;
+    }
+  }
+
+  return std::nullopt;
+}
+
+/// Record calls of one millisecond of a frame stage and a background stage on several threads,
+/// which exit before the frame ends, and on the calling thread
+void recordOnThreads(Profiler& profiler, Profiler::StageId frameId, Profiler::StageId backgroundId)
+{
+  auto recordCalls = [&profiler, frameId, backgroundId]()
+  {
+    const Profiler::Clock::time_point start = Profiler::Clock::now();
+    const Profiler::Clock::time_point end = start + std::chrono::milliseconds(1);
+
+    for (std::size_t i = 0; i < sk_numCallsPerThread; ++i)
+    {
+      profiler.record(frameId, Profiler::StageKind::Frame, start, end);
+      profiler.record(backgroundId, Profiler::StageKind::Background, start, end);
+    }
+  };
+
+  std::vector<std::thread> threads;
+
+  for (std::size_t t = 0; t < sk_numThreads; ++t)
+  {
+    threads.emplace_back(recordCalls);
+  }
+
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  recordCalls();
+}
+
+} // namespace
+
+ENTROPY_TEST(profilerInternsStageNames)
+{
+  Profiler& profiler = Profiler::instance();
+
+  // Equal names at different addresses share an ID
+  static const char sk_name[] = "Interned stage";
+  static const std::string sk_copy(sk_name);
+
+  const Profiler::StageId id = profiler.stageId(sk_name);
+  CHECK_EQ(profiler.stageId(sk_copy.c_str()), id);
+  CHECK_EQ(profiler.stageId(sk_name), id);
+  CHECK(profiler.stageId("Other interned stage") != id);
+}
+
+ENTROPY_TEST(profilerSumsFrameStagesOverThreads)
+{
+  Profiler& profiler = Profiler::instance();
+  profiler.setEnabled(true);
+  profiler.clearStats();
+
+  const Profiler::StageId frameId = profiler.stageId("Frame stage on threads");
+  const Profiler::StageId backgroundId = profiler.stageId("Background stage on threads");
+
+  constexpr std::size_t numCalls = (sk_numThreads + 1) * sk_numCallsPerThread;
+
+  for (std::size_t frame = 1; frame <= 3; ++frame)
+  {
+    recordOnThreads(profiler, frameId, backgroundId);
+
+    {
+      PROFILE_SCOPE("Frame scope");
+      PROFILE_BACKGROUND_SCOPE("Background scope");
+    }
+
+    profiler.endFrame();
+
+    const auto stats = findStats(profiler, "Frame stage on threads");
+    REQUIRE(stats.has_value());
+    CHECK_EQ(stats->m_numFrames, frame);
+    CHECK_EQ(stats->m_numCalls, numCalls);
+    CHECK_NEAR(stats->m_lastMs, static_cast<double>(numCalls), 1.0e-6);
+    CHECK_NEAR(stats->m_avgMs, static_cast<double>(numCalls), 1.0e-6);
+
+    const auto scopeStats = findStats(profiler, "Frame scope");
+    REQUIRE(scopeStats.has_value());
+    CHECK_EQ(scopeStats->m_numCalls, std::size_t{1});
+  }
+
+  // Background stages are not summed per frame
+  CHECK(!findStats(profiler, "Background stage on threads"));
+  CHECK(!findStats(profiler, "Background scope"));
+
+  // Times recorded since the last frame are cleared too
+  recordOnThreads(profiler, frameId, backgroundId);
+  profiler.clearStats();
+  profiler.endFrame();
+  CHECK(!findStats(profiler, "Frame stage on threads"));
+
+  profiler.setEnabled(false);
+}
+
+ENTROPY_TEST(profilerTracesAllStagesOverThreads)
+{
+  Profiler& profiler = Profiler::instance();
+  profiler.setEnabled(true);
+
+  const Profiler::StageId frameId = profiler.stageId("Traced frame stage");
+  const Profiler::StageId backgroundId = profiler.stageId("Traced \"background\" stage");
+
+  // Events recorded before the trace starts are not traced
+  recordOnThreads(profiler, frameId, backgroundId);
+
+  profiler.startTrace();
+  CHECK(profiler.isTracing());
+  CHECK_EQ(profiler.numTraceEvents(), std::size_t{0});
+
+  recordOnThreads(profiler, frameId, backgroundId);
+  profiler.endFrame();
+
+  constexpr std::size_t numEvents = 2 * (sk_numThreads + 1) * sk_numCallsPerThread;
+  CHECK_EQ(profiler.numTraceEvents(), numEvents);
+
+  profiler.stopTrace();
+  CHECK(!profiler.isTracing());
+
+  // Events are not recorded after the trace stops
+  recordOnThreads(profiler, frameId, backgroundId);
+  CHECK_EQ(profiler.numTraceEvents(), numEvents);
+
+  const fs::path fileName = fs::temp_directory_path() / "entropy_profiler_trace.json";
+  REQUIRE(profiler.writeTrace(fileName));
+
+  std::ifstream file(fileName);
+  const std::string trace{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  file.close();
+  fs::remove(fileName);
+
+  auto count = [&trace](const std::string& str)
+  {
+    std::size_t n = 0;
+
+    for (std::size_t pos = trace.find(str); std::string::npos != pos;
+         pos = trace.find(str, pos + 1))
+    {
+      ++n;
+    }
+
+    return n;
+  };
+
+  CHECK_EQ(count("\"ph\":\"X\""), numEvents);
+  CHECK_EQ(count("\"name\":\"Traced frame stage\""), numEvents / 2);
+  CHECK_EQ(count("\"name\":\"Traced \\\"background\\\" stage\""), numEvents / 2);
+
+  profiler.setEnabled(false);
+}
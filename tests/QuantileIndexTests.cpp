@@ -0,0 +1,200 @@
+#include "Testing.h"
+
+#include "image/QuantileIndex.h"
+#include "image/QuantileIndex.tpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/// Quantile of a sorted copy, as computed by convertQuantileToValue
+template<typename T>
+double referenceQuantileToValue(const std::vector<T>& sorted, double quantile, bool interpolate)
+{
+  const std::size_t N = sorted.size();
+  const double index = (1.0 - quantile) * -0.5 + quantile * (static_cast<double>(N) - 0.5);
+  const auto left = static_cast<std::size_t>(std::max<int64_t>(std::floor(index), 0));
+  const auto right = static_cast<std::size_t>(
+    std::min<int64_t>(std::ceil(index), static_cast<int64_t>(N) - 1)
+  );
+
+  if (!interpolate)
+  {
+    return static_cast<double>(sorted[left]);
+  }
+
+  const double t = index - static_cast<double>(left);
+  return (1.0 - t) * static_cast<double>(sorted[left]) + t * static_cast<double>(sorted[right]);
+}
+
+template<typename T>
+std::vector<T> sortedCopy(std::vector<T> values)
+{
+  std::sort(std::begin(values), std::end(values));
+  return values;
+}
+
+} // namespace
+
+ENTROPY_TEST(quantileIndexIsExactForInt16)
+{
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> dist(-3000, 3000);
+
+  std::vector<int16_t> values(200000);
+  for (auto& v : values)
+  {
+    v = static_cast<int16_t>(dist(rng));
+  }
+
+  // A large background of a single value, as in most images
+  std::fill_n(std::begin(values), 50000, int16_t{0});
+
+  const QuantileIndex index = buildQuantileIndex(values.data(), values.size());
+  const std::vector<int16_t> sorted = sortedCopy(values);
+
+  REQUIRE(index.isExact());
+  CHECK_EQ(index.numElements(), values.size());
+  CHECK_EQ(index.minimum(), static_cast<double>(sorted.front()));
+  CHECK_EQ(index.maximum(), static_cast<double>(sorted.back()));
+
+  for (std::size_t rank = 0; rank < sorted.size(); rank += 97)
+  {
+    CHECK_EQ(index.valueAtRank(rank), static_cast<double>(sorted[rank]));
+  }
+
+  for (int v = -3100; v <= 3100; v += 13)
+  {
+    const auto value = static_cast<int16_t>(v);
+    const auto lower = std::lower_bound(std::begin(sorted), std::end(sorted), value);
+    const auto upper = std::upper_bound(std::begin(sorted), std::end(sorted), value);
+
+    CHECK_EQ(index.countLess(v), static_cast<std::size_t>(lower - std::begin(sorted)));
+    CHECK_EQ(index.countLessOrEqual(v), static_cast<std::size_t>(upper - std::begin(sorted)));
+
+    const QuantileOfValue Q = index.valueToQuantile(v);
+    CHECK_EQ(Q.foundValue, std::end(sorted) != lower);
+  }
+
+  for (int q = 0; q <= 100; ++q)
+  {
+    const double quantile = q / 100.0;
+    CHECK_EQ(index.quantileToValue(quantile), referenceQuantileToValue(sorted, quantile, false));
+  }
+}
+
+ENTROPY_TEST(quantileIndexReadsStridedComponents)
+{
+  constexpr std::size_t sk_numComps = 3;
+
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  std::vector<uint8_t> interleaved(sk_numComps * 10000);
+  std::vector<uint8_t> comp1;
+
+  for (std::size_t i = 0; i < interleaved.size(); ++i)
+  {
+    interleaved[i] = static_cast<uint8_t>(dist(rng));
+
+    if (1 == i % sk_numComps)
+    {
+      comp1.push_back(interleaved[i]);
+    }
+  }
+
+  const QuantileIndex index
+    = buildQuantileIndex(interleaved.data() + 1, comp1.size(), sk_numComps);
+  const std::vector<uint8_t> sorted = sortedCopy(comp1);
+
+  REQUIRE(index.numElements() == comp1.size());
+
+  for (std::size_t rank = 0; rank < sorted.size(); ++rank)
+  {
+    CHECK_EQ(index.valueAtRank(rank), static_cast<double>(sorted[rank]));
+  }
+}
+
+ENTROPY_TEST(quantileIndexBoundsErrorOfFloatValues)
+{
+  std::mt19937 rng(3);
+  std::normal_distribution<float> dist(100.0f, 40.0f);
+
+  std::vector<float> values(300000);
+  for (auto& v : values)
+  {
+    v = dist(rng);
+  }
+
+  // Background that must stay exact, and NaNs that must be excluded
+  std::fill_n(std::begin(values), 30000, -1024.0f);
+  values[40000] = std::numeric_limits<float>::quiet_NaN();
+  values[40001] = std::numeric_limits<float>::quiet_NaN();
+
+  std::vector<float> finite;
+  std::copy_if(
+    std::begin(values),
+    std::end(values),
+    std::back_inserter(finite),
+    [](float v) { return !std::isnan(v); }
+  );
+
+  const QuantileIndex index = buildQuantileIndex(values.data(), values.size());
+  const std::vector<float> sorted = sortedCopy(finite);
+
+  REQUIRE(index.numElements() == sorted.size());
+  CHECK_EQ(index.minimum(), static_cast<double>(sorted.front()));
+  CHECK_EQ(index.maximum(), static_cast<double>(sorted.back()));
+  CHECK_EQ(index.valueAtRank(0), -1024.0);
+  CHECK_EQ(index.valueAtRank(29999), -1024.0);
+
+  // Relative error of 2^-11 per bin, plus the absolute error near zero
+  auto tolerance = [](double v) { return std::abs(v) / 2048.0 + 1.0e-6; };
+
+  for (std::size_t rank = 0; rank < sorted.size(); rank += 101)
+  {
+    const double expected = static_cast<double>(sorted[rank]);
+    CHECK_NEAR(index.valueAtRank(rank), expected, tolerance(expected));
+  }
+
+  for (int q = 0; q <= 100; ++q)
+  {
+    const double quantile = q / 100.0;
+    const double expected = referenceQuantileToValue(sorted, quantile, true);
+    CHECK_NEAR(index.quantileToValue(quantile), expected, tolerance(expected));
+  }
+}
+
+ENTROPY_TEST(quantileIndexBinsWideInt32Ranges)
+{
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<int32_t> dist(-100000000, 100000000);
+
+  std::vector<int32_t> values(100000);
+  for (auto& v : values)
+  {
+    v = dist(rng);
+  }
+
+  const QuantileIndex index = buildQuantileIndex(values.data(), values.size());
+  const std::vector<int32_t> sorted = sortedCopy(values);
+
+  REQUIRE(index.numElements() == sorted.size());
+  CHECK(!index.isExact());
+  CHECK_EQ(index.minimum(), static_cast<double>(sorted.front()));
+  CHECK_EQ(index.maximum(), static_cast<double>(sorted.back()));
+
+  // The range spans about 2^28 values, so each of the 2^20 bins is 2^8 values wide
+  constexpr double sk_binWidth = 256.0;
+
+  for (std::size_t rank = 0; rank < sorted.size(); rank += 37)
+  {
+    CHECK_NEAR(index.valueAtRank(rank), static_cast<double>(sorted[rank]), sk_binWidth);
+  }
+}
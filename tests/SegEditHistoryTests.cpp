@@ -0,0 +1,306 @@
+#include "Testing.h"
+#include "TestImages.h"
+
+#include "logic/segmentation/SegEditHistory.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/// Dimensions that are not multiples of the brick size, so that there are partial bricks
+const glm::ivec3 sk_dims{40, 35, 20};
+
+std::size_t voxelIndex(int x, int y, int z)
+{
+  return (static_cast<std::size_t>(z) * sk_dims.y + y) * sk_dims.x + x;
+}
+
+/// Labels that are constant over large regions, as in most segmentations
+std::vector<uint16_t> makeLabels()
+{
+  std::vector<uint16_t> labels(static_cast<std::size_t>(sk_dims.x) * sk_dims.y * sk_dims.z, 0);
+
+  for (int z = 0; z < sk_dims.z; ++z)
+  {
+    for (int y = 0; y < sk_dims.y; ++y)
+    {
+      for (int x = 0; x < sk_dims.x; ++x)
+      {
+        labels[voxelIndex(x, y, z)] = static_cast<uint16_t>((z < 8 ? 1 : 0) + (y < 10 ? 300 : 0));
+      }
+    }
+  }
+
+  return labels;
+}
+
+/// Segmentation with a single UID, edited through the history
+struct EditedSeg
+{
+  uuids::uuid m_uid;
+  Image m_seg;
+
+  SegEditHistory::GetSegFunc getSeg()
+  {
+    return [this](const uuids::uuid& uid) { return (uid == m_uid) ? &m_seg : nullptr; };
+  }
+
+  /// Save a block, then set its voxels to a value
+  void paintBlock(
+    SegEditHistory& history, const glm::ivec3& offset, const glm::ivec3& size, uint16_t value
+  )
+  {
+    history.saveBlock(m_uid, m_seg, glm::uvec3{offset}, glm::uvec3{size});
+
+    uint16_t* buffer = static_cast<uint16_t*>(m_seg.bufferAsVoid(0));
+
+    for (int z = offset.z; z < offset.z + size.z; ++z)
+    {
+      for (int y = offset.y; y < offset.y + size.y; ++y)
+      {
+        for (int x = offset.x; x < offset.x + size.x; ++x)
+        {
+          buffer[voxelIndex(x, y, z)] = value;
+        }
+      }
+    }
+  }
+
+  std::vector<uint16_t> values() const
+  {
+    return testing::imageValues<uint16_t>(m_seg);
+  }
+};
+
+EditedSeg makeEditedSeg()
+{
+  return EditedSeg{uuids::uuid{}, testing::makeTestSeg(sk_dims, makeLabels())};
+}
+
+} // namespace
+
+ENTROPY_TEST(segEditHistoryUndoesAndRedoesEdits)
+{
+  EditedSeg s = makeEditedSeg();
+  SegEditHistory history(std::size_t{1} << 24);
+
+  const std::vector<uint16_t> original = s.values();
+
+  // Edit spanning partial bricks at the image boundary
+  s.paintBlock(history, {30, 28, 12}, {10, 7, 8}, 7);
+  CHECK(history.isEditOpen());
+
+  std::size_t numChanged = 0;
+  history.endEdit(
+    s.getSeg(),
+    [&numChanged](const SegEditHistory::SegChanges& changes)
+    {
+      CHECK(changes.m_isComplete);
+      CHECK(changes.m_dataVersionBefore < changes.m_dataVersionAfter);
+      numChanged += changes.m_voxels.size();
+    }
+  );
+
+  CHECK(!history.isEditOpen());
+  CHECK_EQ(numChanged, std::size_t{10 * 7 * 8});
+
+  const std::vector<uint16_t> afterFirst = s.values();
+
+  // Two overlapping blocks in one edit
+  s.paintBlock(history, {0, 0, 0}, {20, 20, 5}, 9);
+  s.paintBlock(history, {10, 10, 2}, {20, 20, 5}, 11);
+  history.endEdit(s.getSeg());
+
+  const std::vector<uint16_t> afterSecond = s.values();
+  CHECK(afterFirst != afterSecond);
+
+  REQUIRE(history.undo(s.getSeg()));
+  CHECK(s.values() == afterFirst);
+
+  REQUIRE(history.undo(s.getSeg()));
+  CHECK(s.values() == original);
+  CHECK(!history.canUndo());
+  CHECK(!history.undo(s.getSeg()));
+
+  REQUIRE(history.redo(s.getSeg()));
+  CHECK(s.values() == afterFirst);
+
+  REQUIRE(history.redo(s.getSeg()));
+  CHECK(s.values() == afterSecond);
+  CHECK(!history.canRedo());
+
+  // A new edit after an undo clears the redo steps
+  REQUIRE(history.undo(s.getSeg()));
+  s.paintBlock(history, {5, 5, 5}, {2, 2, 2}, 13);
+  history.endEdit(s.getSeg());
+  CHECK(!history.canRedo());
+
+  // Undo marks only the changed bricks as dirty
+  s.m_seg.dirtyBricks().clear();
+  REQUIRE(history.undo(s.getSeg()));
+  CHECK_EQ(s.m_seg.dirtyBricks().numDirtyBricks(), std::size_t{1});
+  CHECK(s.values() == afterFirst);
+}
+
+ENTROPY_TEST(segEditHistoryIgnoresUnchangedBricks)
+{
+  EditedSeg s = makeEditedSeg();
+  SegEditHistory history(std::size_t{1} << 24);
+
+  // Saving voxels without changing them adds no step
+  history.saveBlock(s.m_uid, s.m_seg, glm::uvec3{0}, glm::uvec3{sk_dims});
+  history.endEdit(s.getSeg());
+
+  CHECK(!history.canUndo());
+  CHECK_EQ(history.memoryUsage(), std::size_t{0});
+}
+
+ENTROPY_TEST(segEditHistoryUndoesWholeImageFills)
+{
+  EditedSeg s = makeEditedSeg();
+  SegEditHistory history(std::size_t{1} << 24);
+
+  const std::vector<uint16_t> original = s.values();
+  const std::vector<uint16_t> cleared(original.size(), 0);
+
+  // The open edit is ended before the fill, as a separate step
+  s.paintBlock(history, {1, 1, 1}, {3, 3, 3}, 5);
+  const std::vector<uint16_t> painted = s.values();
+
+  std::size_t numChanged = 0;
+  std::size_t numReports = 0;
+
+  REQUIRE(history.fillSeg(
+    s.m_uid,
+    s.m_seg,
+    0,
+    s.getSeg(),
+    [&](const SegEditHistory::SegChanges& changes)
+    {
+      ++numReports;
+      numChanged += changes.m_voxels.size();
+    }
+  ));
+
+  CHECK(!history.isEditOpen());
+  CHECK(s.values() == cleared);
+  CHECK_EQ(numReports, std::size_t{2});
+
+  std::size_t numNonZero = 0;
+  for (uint16_t v : painted)
+  {
+    numNonZero += (0 != v) ? 1 : 0;
+  }
+  CHECK_EQ(numChanged, std::size_t{27} + numNonZero);
+
+  // The history holds runs, not a copy of the segmentation
+  CHECK(history.memoryUsage() < original.size() * sizeof(uint16_t) / 4);
+
+  REQUIRE(history.undo(s.getSeg()));
+  CHECK(s.values() == painted);
+
+  REQUIRE(history.undo(s.getSeg()));
+  CHECK(s.values() == original);
+
+  REQUIRE(history.redo(s.getSeg()));
+  REQUIRE(history.redo(s.getSeg()));
+  CHECK(s.values() == cleared);
+
+  // Filling a cleared segmentation changes nothing and adds no step
+  REQUIRE(history.undo(s.getSeg()));
+  REQUIRE(history.redo(s.getSeg()));
+  REQUIRE(history.fillSeg(s.m_uid, s.m_seg, 0, s.getSeg()));
+  REQUIRE(history.undo(s.getSeg()));
+  CHECK(s.values() == painted);
+}
+
+ENTROPY_TEST(segEditHistoryEvictsOldestEditsOverBudget)
+{
+  EditedSeg s = makeEditedSeg();
+  SegEditHistory history(std::size_t{1} << 24);
+
+  std::mt19937 rng(13);
+  std::uniform_int_distribution<int> label(1, 1000);
+
+  // Edit that changes one whole brick to random labels, so that edits have about the same size
+  auto editBrick = [&](int i)
+  {
+    const glm::ivec3 offset{0, 16, 0};
+    history.saveBlock(s.m_uid, s.m_seg, glm::uvec3{offset}, glm::uvec3{16});
+
+    uint16_t* buffer = static_cast<uint16_t*>(s.m_seg.bufferAsVoid(0));
+    for (int z = 0; z < 16; ++z)
+    {
+      for (int y = 0; y < 16; ++y)
+      {
+        for (int x = 0; x < 16; ++x)
+        {
+          buffer[voxelIndex(offset.x + x, offset.y + y, offset.z + z)]
+            = static_cast<uint16_t>(1000 * (i + 1) + label(rng));
+        }
+      }
+    }
+
+    history.endEdit(s.getSeg());
+  };
+
+  // Measure an edit from random labels to random labels
+  editBrick(0);
+  history.clear();
+  editBrick(1);
+
+  const std::size_t editSize = history.memoryUsage();
+  REQUIRE(0 < editSize);
+
+  history.clear();
+  CHECK_EQ(history.memoryUsage(), std::size_t{0});
+
+  // Room for two and a half edits
+  history.setMemoryBudget(editSize * 5 / 2);
+  CHECK_EQ(history.memoryBudget(), editSize * 5 / 2);
+
+  std::vector<std::vector<uint16_t> > states{s.values()};
+
+  for (int i = 1; i <= 5; ++i)
+  {
+    editBrick(1 + i);
+    states.push_back(s.values());
+    CHECK(history.memoryUsage() <= history.memoryBudget());
+  }
+
+  // Only the last two edits remain
+  REQUIRE(history.undo(s.getSeg()));
+  CHECK(s.values() == states[4]);
+  REQUIRE(history.undo(s.getSeg()));
+  CHECK(s.values() == states[3]);
+  CHECK(!history.canUndo());
+
+  // Lowering the budget drops the farthest redo step
+  history.setMemoryBudget(editSize * 3 / 2);
+  REQUIRE(history.redo(s.getSeg()));
+  CHECK(s.values() == states[4]);
+  CHECK(!history.canRedo());
+
+  history.setMemoryBudget(0);
+  CHECK(!history.canUndo());
+  CHECK_EQ(history.memoryUsage(), std::size_t{0});
+}
+
+ENTROPY_TEST(segEditHistoryRemovesSegmentations)
+{
+  EditedSeg s = makeEditedSeg();
+  SegEditHistory history(std::size_t{1} << 24);
+
+  s.paintBlock(history, {0, 0, 0}, {4, 4, 4}, 3);
+  history.endEdit(s.getSeg());
+  REQUIRE(history.canUndo());
+
+  history.removeSeg(s.m_uid);
+  CHECK(!history.canUndo());
+  CHECK_EQ(history.memoryUsage(), std::size_t{0});
+}
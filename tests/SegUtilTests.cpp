@@ -0,0 +1,634 @@
+#include "Testing.h"
+#include "TestImages.h"
+
+#include "common/SegmentationTypes.h"
+#include "image/SegUtil.h"
+#include "logic/camera/MathUtility.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <random>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+const glm::ivec3 sk_dims{23, 19, 17};
+
+std::size_t numVoxels()
+{
+  return static_cast<std::size_t>(sk_dims.x) * sk_dims.y * sk_dims.z;
+}
+
+std::size_t voxelIndex(const glm::ivec3& v)
+{
+  return (static_cast<std::size_t>(v.z) * sk_dims.y + v.y) * sk_dims.x + v.x;
+}
+
+/// Is a neighbor offset in a neighborhood?
+bool isNeighbor(const glm::ivec3& d, RegionGrowConnectivity connectivity)
+{
+  const int n = std::abs(d.x) + std::abs(d.y) + std::abs(d.z);
+
+  switch (connectivity)
+  {
+  case RegionGrowConnectivity::Neighbors6:
+    return 1 == n;
+  case RegionGrowConnectivity::Neighbors18:
+    return 1 <= n && n <= 2;
+  case RegionGrowConnectivity::Neighbors26:
+    return 1 <= n;
+  }
+
+  return false;
+}
+
+/// Region grown from a seed, found by a breadth-first search that visits one voxel and one
+/// neighbor at a time
+struct BruteForceRegion
+{
+  std::vector<uint16_t> m_labels; //!< Segmentation with the region painted
+  std::size_t m_numVoxels = 0;    //!< Number of voxels in the region
+  glm::ivec3 m_min{0};            //!< Min corner of the region
+  glm::ivec3 m_max{0};            //!< Max corner of the region
+};
+
+BruteForceRegion bruteForceRegionGrowing(
+  const std::vector<uint16_t>& labels,
+  const std::vector<float>& image,
+  uint16_t labelToPaint,
+  uint16_t labelToReplace,
+  bool brushReplacesBgWithFg,
+  const glm::ivec3& seed,
+  double low,
+  double high,
+  RegionGrowConnectivity connectivity,
+  std::optional<int> sliceAxis
+)
+{
+  auto isInRegion = [&](const glm::ivec3& v)
+  {
+    if (glm::any(glm::lessThan(v, glm::ivec3{0})) || glm::any(glm::greaterThanEqual(v, sk_dims)))
+    {
+      return false;
+    }
+
+    if (sliceAxis && v[*sliceAxis] != seed[*sliceAxis])
+    {
+      return false;
+    }
+
+    const std::size_t i = voxelIndex(v);
+    const double value = static_cast<double>(image[i]);
+    return low <= value && value <= high && (!brushReplacesBgWithFg || labelToReplace == labels[i]);
+  };
+
+  BruteForceRegion region;
+  region.m_labels = labels;
+
+  if (!isInRegion(seed))
+  {
+    return region;
+  }
+
+  std::vector<bool> visited(numVoxels(), false);
+  std::deque<glm::ivec3> queue{seed};
+  visited[voxelIndex(seed)] = true;
+  region.m_min = seed;
+  region.m_max = seed;
+
+  while (!queue.empty())
+  {
+    const glm::ivec3 v = queue.front();
+    queue.pop_front();
+
+    region.m_labels[voxelIndex(v)] = labelToPaint;
+    ++region.m_numVoxels;
+    region.m_min = glm::min(region.m_min, v);
+    region.m_max = glm::max(region.m_max, v);
+
+    for (int dz = -1; dz <= 1; ++dz)
+    {
+      for (int dy = -1; dy <= 1; ++dy)
+      {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+          const glm::ivec3 d{dx, dy, dz};
+          const glm::ivec3 n = v + d;
+
+          if (isNeighbor(d, connectivity) && isInRegion(n) && !visited[voxelIndex(n)])
+          {
+            visited[voxelIndex(n)] = true;
+            queue.push_back(n);
+          }
+        }
+      }
+    }
+  }
+
+  return region;
+}
+
+/// Grow a region in a segmentation and check it against the brute-force search
+/// @return The brute-force region
+BruteForceRegion checkRegionGrowing(
+  const std::vector<uint16_t>& labels,
+  const std::vector<float>& image,
+  uint16_t labelToPaint,
+  uint16_t labelToReplace,
+  bool brushReplacesBgWithFg,
+  const glm::ivec3& seed,
+  double low,
+  double high,
+  RegionGrowConnectivity connectivity,
+  std::optional<int> sliceAxis
+)
+{
+  Image seg = testing::makeTestSeg(sk_dims, labels);
+  const Image img = testing::makeTestImage(
+    sk_dims, ComponentType::Float32, image.data(), Image::ImageRepresentation::Image
+  );
+
+  const std::size_t numFilled = fillSegmentationByRegionGrowing(
+    seg,
+    img,
+    0,
+    labelToPaint,
+    labelToReplace,
+    brushReplacesBgWithFg,
+    seed,
+    low,
+    high,
+    connectivity,
+    sliceAxis,
+    {}
+  );
+
+  BruteForceRegion expected = bruteForceRegionGrowing(
+    labels,
+    image,
+    labelToPaint,
+    labelToReplace,
+    brushReplacesBgWithFg,
+    seed,
+    low,
+    high,
+    connectivity,
+    sliceAxis
+  );
+
+  const std::vector<uint16_t> actual = testing::imageValues<uint16_t>(seg);
+
+  std::size_t numWrong = 0;
+
+  for (std::size_t i = 0; i < numVoxels(); ++i)
+  {
+    numWrong += (actual[i] == expected.m_labels[i]) ? 0 : 1;
+  }
+
+  CHECK_EQ(numWrong, std::size_t{0});
+  CHECK_EQ(numFilled, expected.m_numVoxels);
+
+  return expected;
+}
+
+/// Image of random values in [0, 1)
+std::vector<float> randomImage(std::mt19937& rng)
+{
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  std::vector<float> image(numVoxels());
+
+  for (float& v : image)
+  {
+    v = dist(rng);
+  }
+
+  return image;
+}
+
+constexpr RegionGrowConnectivity sk_connectivities[] = {
+  RegionGrowConnectivity::Neighbors6,
+  RegionGrowConnectivity::Neighbors18,
+  RegionGrowConnectivity::Neighbors26
+};
+
+/// Brush stroke in the test volume
+struct Stroke
+{
+  bool m_isRound = false;
+  bool m_is3d = false;
+  int m_size = 1;
+  glm::vec4 m_viewPlane{0.0f};       //!< View plane of a 2D brush, in voxel coordinates
+  std::vector<glm::ivec3> m_centers; //!< Centers of the brush dabs along the stroke
+};
+
+using VoxelSet = std::set<std::tuple<int, int, int> >;
+
+/// Voxels painted by one dab of a brush, as found by the previous painting code, which tested
+/// each voxel of the brush box (3D) or flood filled the view plane one voxel at a time (2D)
+VoxelSet previousBrushVoxels(const Stroke& stroke, const glm::ivec3& c)
+{
+  const float radius = static_cast<float>(stroke.m_size - 1);
+
+  auto isInsideBrush = [&](const glm::vec3& d)
+  {
+    if (!stroke.m_isRound)
+    {
+      return std::max(std::max(std::abs(d.x), std::abs(d.y)), std::abs(d.z)) <= radius;
+    }
+    return d.x * d.x + d.y * d.y + d.z * d.z <= radius * radius;
+  };
+
+  auto isInSeg = [](const glm::ivec3& v)
+  { return glm::all(glm::lessThanEqual(glm::ivec3{0}, v)) && glm::all(glm::lessThan(v, sk_dims)); };
+
+  auto intersectsPlane = [&stroke](const glm::ivec3& v)
+  {
+    const glm::vec3 q{v};
+    return math::testAABBoxPlaneIntersection(q, q + glm::vec3{0.5f}, stroke.m_viewPlane);
+  };
+
+  auto key = [](const glm::ivec3& v) { return std::make_tuple(v.x, v.y, v.z); };
+
+  VoxelSet voxels;
+
+  if (stroke.m_is3d)
+  {
+    const int r = stroke.m_size - 1;
+
+    for (int k = -r; k <= r; ++k)
+    {
+      for (int j = -r; j <= r; ++j)
+      {
+        for (int i = -r; i <= r; ++i)
+        {
+          const glm::ivec3 d{i, j, k};
+          if (isInSeg(c + d) && isInsideBrush(glm::vec3{d}))
+          {
+            voxels.insert(key(c + d));
+          }
+        }
+      }
+    }
+
+    return voxels;
+  }
+
+  std::queue<glm::ivec3> toTest;
+  VoxelSet processed;
+
+  if (isInSeg(c) && intersectsPlane(c))
+  {
+    toTest.push(c);
+    processed.insert(key(c));
+  }
+
+  while (!toTest.empty())
+  {
+    const glm::ivec3 q = toTest.front();
+    toTest.pop();
+
+    if (!isInsideBrush(glm::vec3{q - c}))
+    {
+      continue;
+    }
+
+    voxels.insert(key(q));
+
+    for (int a = 0; a < 3; ++a)
+    {
+      for (const int step : {-1, 1})
+      {
+        glm::ivec3 n = q;
+        n[a] += step;
+
+        if (0 == processed.count(key(n)) && intersectsPlane(n) && isInSeg(n))
+        {
+          toTest.push(n);
+          processed.insert(key(n));
+        }
+      }
+    }
+  }
+
+  return voxels;
+}
+
+/// Paint a stroke and check each dab against the voxels painted by the previous code, including
+/// the block of voxels saved before each dab
+void checkStroke(const Stroke& stroke, bool replacesBgWithFg)
+{
+  constexpr uint16_t sk_labelToPaint = 5;
+  constexpr uint16_t sk_labelToReplace = 1;
+
+  std::vector<uint16_t> expected(numVoxels());
+  for (std::size_t i = 0; i < expected.size(); ++i)
+  {
+    expected[i] = static_cast<uint16_t>((i / 3) % 3);
+  }
+
+  Image seg = testing::makeTestSeg(sk_dims, expected);
+
+  std::size_t numWrongBlocks = 0;
+  std::size_t numPainted = 0;
+
+  for (const glm::ivec3& c : stroke.m_centers)
+  {
+    const VoxelSet voxels = previousBrushVoxels(stroke, c);
+
+    glm::ivec3 minVoxel{std::numeric_limits<int>::max()};
+    glm::ivec3 maxVoxel{std::numeric_limits<int>::lowest()};
+
+    for (const auto& [x, y, z] : voxels)
+    {
+      const glm::ivec3 v{x, y, z};
+      minVoxel = glm::min(minVoxel, v);
+      maxVoxel = glm::max(maxVoxel, v);
+
+      uint16_t& label = expected[voxelIndex(v)];
+      if (!replacesBgWithFg || sk_labelToReplace == label)
+      {
+        label = sk_labelToPaint;
+      }
+    }
+
+    std::vector<std::pair<glm::uvec3, glm::uvec3> > savedBlocks;
+
+    paintSegmentation(
+      seg,
+      sk_labelToPaint,
+      sk_labelToReplace,
+      replacesBgWithFg,
+      stroke.m_isRound,
+      stroke.m_is3d,
+      true,
+      stroke.m_size,
+      c,
+      stroke.m_viewPlane,
+      [&savedBlocks](const glm::uvec3& offset, const glm::uvec3& size)
+      { savedBlocks.emplace_back(offset, size); }
+    );
+
+    // The block saved before painting bounds the voxels of the brush
+    if (voxels.empty())
+    {
+      numWrongBlocks += savedBlocks.empty() ? 0 : 1;
+    }
+    else
+    {
+      const bool isBounding = (1 == savedBlocks.size())
+                              && glm::uvec3{minVoxel} == savedBlocks.front().first
+                              && glm::uvec3{maxVoxel - minVoxel + 1} == savedBlocks.front().second;
+      numWrongBlocks += isBounding ? 0 : 1;
+    }
+
+    numPainted += voxels.size();
+  }
+
+  const std::vector<uint16_t> actual = testing::imageValues<uint16_t>(seg);
+
+  std::size_t numWrong = 0;
+  for (std::size_t i = 0; i < numVoxels(); ++i)
+  {
+    numWrong += (actual[i] == expected[i]) ? 0 : 1;
+  }
+
+  CHECK_EQ(numWrong, std::size_t{0});
+  CHECK_EQ(numWrongBlocks, std::size_t{0});
+  CHECK(0 < numPainted);
+}
+
+/// Centers of a stroke from one corner of the volume to past the opposite corner, so that the
+/// brush is clipped by the boundary at both ends
+std::vector<glm::ivec3> strokeCenters(const glm::vec3& from, const glm::vec3& to)
+{
+  std::vector<glm::ivec3> centers;
+
+  for (int i = 0; i <= 20; ++i)
+  {
+    centers.push_back(glm::ivec3{glm::round(glm::mix(from, to, static_cast<float>(i) / 20.0f))});
+  }
+
+  return centers;
+}
+
+} // namespace
+
+ENTROPY_TEST(regionGrowingMatchesBruteForce)
+{
+  // Thresholds that keep about half of the voxels grow large, branching regions, and a threshold
+  // that keeps few voxels grows regions that differ most by connectivity. Seeds at corners,
+  // edges, and faces grow regions along the boundary.
+  std::mt19937 rng(29);
+  const std::vector<float> image = randomImage(rng);
+  const std::vector<uint16_t> labels(numVoxels(), 0);
+
+  const glm::ivec3 last = sk_dims - 1;
+  std::vector<glm::ivec3> seeds{
+    {0, 0, 0}, last, {last.x, 0, 0}, {0, last.y, last.z}, {11, 0, 8}, {last.x, 9, 8}, {11, 9, 8}
+  };
+
+  for (int i = 0; i < 8; ++i)
+  {
+    seeds.push_back(
+      {std::uniform_int_distribution<int>(0, last.x)(rng),
+       std::uniform_int_distribution<int>(0, last.y)(rng),
+       std::uniform_int_distribution<int>(0, last.z)(rng)}
+    );
+  }
+
+  const std::vector<std::optional<int> > sliceAxes{std::nullopt, 0, 1, 2};
+  const std::vector<std::pair<double, double> > thresholds{{0.0, 0.5}, {0.3, 0.9}, {0.8, 1.0}};
+
+  std::size_t numGrown = 0;
+  std::size_t numAtBoundary = 0;
+
+  for (const RegionGrowConnectivity connectivity : sk_connectivities)
+  {
+    for (const glm::ivec3& seed : seeds)
+    {
+      for (const std::optional<int>& sliceAxis : sliceAxes)
+      {
+        for (const auto& [low, high] : thresholds)
+        {
+          const BruteForceRegion region = checkRegionGrowing(
+            labels, image, 1, 0, false, seed, low, high, connectivity, sliceAxis
+          );
+
+          numGrown += (1 < region.m_numVoxels) ? 1 : 0;
+
+          const bool atBoundary = (glm::ivec3{0} == region.m_min && last == region.m_max);
+          numAtBoundary += (atBoundary && 0 < region.m_numVoxels) ? 1 : 0;
+        }
+      }
+    }
+  }
+
+  // Many regions are grown, and some span the volume from face to opposite face
+  CHECK(100 < numGrown);
+  CHECK(10 < numAtBoundary);
+}
+
+ENTROPY_TEST(regionGrowingOnlyReplacesLabel)
+{
+  // Bands of labels restrict the region to the voxels of the label to replace
+  std::mt19937 rng(31);
+  const std::vector<float> image = randomImage(rng);
+
+  std::vector<uint16_t> labels(numVoxels());
+  for (std::size_t i = 0; i < labels.size(); ++i)
+  {
+    labels[i] = static_cast<uint16_t>((i / 5) % 3);
+  }
+
+  for (const RegionGrowConnectivity connectivity : sk_connectivities)
+  {
+    for (const glm::ivec3& seed : {glm::ivec3{0}, glm::ivec3{5, 18, 16}, glm::ivec3{22, 3, 9}})
+    {
+      const uint16_t labelToReplace = labels[voxelIndex(seed)];
+
+      checkRegionGrowing(
+        labels, image, 7, labelToReplace, true, seed, 0.0, 0.7, connectivity, std::nullopt
+      );
+      checkRegionGrowing(labels, image, 7, labelToReplace, true, seed, 0.0, 0.7, connectivity, 2);
+    }
+  }
+}
+
+ENTROPY_TEST(regionGrowingFollowsConnectivity)
+{
+  // Chains of voxels from the corner (0, 0, 0) that are joined only by edges or by vertices
+  std::vector<float> image(numVoxels(), 0.0f);
+  const std::vector<uint16_t> labels(numVoxels(), 0);
+
+  for (int i = 0; i < 10; ++i)
+  {
+    image[voxelIndex({i, i, 0})] = 1.0f;         // edge-connected, on the face z = 0
+    image[voxelIndex({i, 0, i})] = 1.0f;         // edge-connected, on the face y = 0
+    image[voxelIndex({0, i + 1, i + 1})] = 1.0f; // edge-connected, on the face x = 0
+  }
+
+  for (int i = 0; i < 17; ++i)
+  {
+    image[voxelIndex({22 - i, 18 - i, 16 - i})] = 1.0f; // vertex-connected, from the far corner
+  }
+
+  const glm::ivec3 origin{0};
+  const glm::ivec3 far = sk_dims - 1;
+
+  auto grow = [&](const glm::ivec3& seed, RegionGrowConnectivity c, std::optional<int> sliceAxis)
+  {
+    return checkRegionGrowing(labels, image, 1, 0, false, seed, 1.0, 1.0, c, sliceAxis)
+      .m_numVoxels;
+  };
+
+  CHECK_EQ(grow(origin, RegionGrowConnectivity::Neighbors6, std::nullopt), std::size_t{1});
+  CHECK_EQ(grow(origin, RegionGrowConnectivity::Neighbors18, std::nullopt), std::size_t{29});
+  CHECK_EQ(grow(far, RegionGrowConnectivity::Neighbors18, std::nullopt), std::size_t{1});
+  CHECK_EQ(grow(far, RegionGrowConnectivity::Neighbors26, std::nullopt), std::size_t{17});
+
+  // On the slice z = 0, only the chain in that slice is grown
+  CHECK_EQ(grow(origin, RegionGrowConnectivity::Neighbors26, 2), std::size_t{10});
+}
+
+ENTROPY_TEST(regionGrowingFromInvalidSeed)
+{
+  std::mt19937 rng(37);
+  const std::vector<float> image = randomImage(rng);
+  const std::vector<uint16_t> labels(numVoxels(), 0);
+
+  // A seed outside of the threshold range or of the volume grows no region
+  std::size_t seedIndex = 0;
+  while (image[seedIndex] <= 0.5f)
+  {
+    ++seedIndex;
+  }
+
+  const int i = static_cast<int>(seedIndex);
+  const glm::ivec3 seed{i % sk_dims.x, (i / sk_dims.x) % sk_dims.y, i / (sk_dims.x * sk_dims.y)};
+  Image seg = testing::makeTestSeg(sk_dims, labels);
+  const Image img = testing::makeTestImage(
+    sk_dims, ComponentType::Float32, image.data(), Image::ImageRepresentation::Image
+  );
+
+  for (const glm::ivec3& v : {seed, glm::ivec3{-1, 0, 0}, glm::ivec3{0, sk_dims.y, 0}})
+  {
+    CHECK_EQ(
+      fillSegmentationByRegionGrowing(
+        seg, img, 0, 1, 0, false, v, 0.0, 0.5, RegionGrowConnectivity::Neighbors26, {}, {}
+      ),
+      std::size_t{0}
+    );
+  }
+
+  CHECK(testing::imageValues<uint16_t>(seg) == labels);
+}
+
+ENTROPY_TEST(brushStroke3dMatchesPreviousPainting)
+{
+  for (const bool isRound : {false, true})
+  {
+    for (const int size : {1, 2, 3, 5, 8})
+    {
+      Stroke stroke;
+      stroke.m_isRound = isRound;
+      stroke.m_is3d = true;
+      stroke.m_size = size;
+      stroke.m_centers = strokeCenters(glm::vec3{-2.0f}, glm::vec3{sk_dims + 1});
+
+      checkStroke(stroke, false);
+      checkStroke(stroke, true);
+    }
+  }
+}
+
+ENTROPY_TEST(brushStroke2dMatchesPreviousPainting)
+{
+  // Views along the voxel axes, and an oblique view through which the brush is not connected
+  // along whole rows of voxels
+  const glm::vec3 obliqueNormal = glm::normalize(glm::vec3{1.0f, 2.0f, 3.5f});
+  const glm::vec3 center{11.0f, 9.0f, 8.0f};
+
+  const std::vector<glm::vec4> viewPlanes{
+    {0.0f, 0.0f, 1.0f, -8.0f},
+    {0.0f, 1.0f, 0.0f, 0.0f},
+    {1.0f, 0.0f, 0.0f, -22.0f},
+    {obliqueNormal, -glm::dot(obliqueNormal, center) + 0.2f}
+  };
+
+  for (const glm::vec4& plane : viewPlanes)
+  {
+    // Stroke along the view plane, from outside of the volume to inside of it
+    const glm::vec3 n{plane};
+    const glm::vec3 onPlane = center - (glm::dot(n, center) + plane.w) * n;
+    const glm::vec3 along = glm::normalize(glm::cross(n, glm::vec3{0.3f, 0.5f, 0.8f}));
+
+    for (const bool isRound : {false, true})
+    {
+      for (const int size : {1, 2, 4, 7})
+      {
+        Stroke stroke;
+        stroke.m_isRound = isRound;
+        stroke.m_is3d = false;
+        stroke.m_size = size;
+        stroke.m_viewPlane = plane;
+        stroke.m_centers = strokeCenters(onPlane - 16.0f * along, onPlane + 16.0f * along);
+
+        checkStroke(stroke, false);
+        checkStroke(stroke, true);
+      }
+    }
+  }
+}
@@ -0,0 +1,226 @@
+#include "Testing.h"
+#include "TestImages.h"
+
+#include "logic/segmentation/SparseSeeds.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+
+std::size_t voxelIndex(const glm::ivec3& dims, int x, int y, int z)
+{
+  return (static_cast<std::size_t>(z) * dims.y + y) * dims.x + x;
+}
+
+/// Sparse seeds: short strokes of a few labels along x, as drawn with a brush
+std::vector<uint16_t> makeSeedLabels(const glm::ivec3& dims, unsigned int seed)
+{
+  std::vector<uint16_t> labels(static_cast<std::size_t>(dims.x) * dims.y * dims.z, 0);
+
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> dx(0, dims.x - 1);
+  std::uniform_int_distribution<int> dy(0, dims.y - 1);
+  std::uniform_int_distribution<int> dz(0, dims.z - 1);
+  std::uniform_int_distribution<int> length(1, 12);
+  std::uniform_int_distribution<int> label(1, 4);
+
+  for (int i = 0; i < 300; ++i)
+  {
+    const int x = dx(rng);
+    const int y = dy(rng);
+    const int z = dz(rng);
+    const int n = std::min(length(rng), dims.x - x);
+    const auto value = static_cast<uint16_t>(100 * label(rng));
+
+    std::fill_n(std::begin(labels) + voxelIndex(dims, x, y, z), n, value);
+  }
+
+  return labels;
+}
+
+std::vector<uint16_t> rasterize(const SparseSeeds& seeds)
+{
+  const glm::ivec3& dims = seeds.dims();
+  std::vector<uint16_t> buffer(static_cast<std::size_t>(dims.x) * dims.y * dims.z, 0);
+  seeds.rasterize(buffer.data(), [](LabelType label) { return static_cast<uint16_t>(label); });
+  return buffer;
+}
+
+} // namespace
+
+ENTROPY_TEST(sparseSeedsRoundTripSegmentations)
+{
+  // Enough slices for the segmentation to be scanned in several slabs
+  const glm::ivec3 dims{64, 48, 200};
+  const std::vector<uint16_t> labels = makeSeedLabels(dims, 3);
+
+  const std::optional<SparseSeeds> seeds
+    = SparseSeeds::fromSegmentation(testing::makeTestSeg(dims, labels));
+
+  REQUIRE(seeds);
+  CHECK(seeds->dims() == dims);
+  CHECK(rasterize(*seeds) == labels);
+
+  std::size_t numNonZero = 0;
+  for (uint16_t v : labels)
+  {
+    numNonZero += (0 != v) ? 1 : 0;
+  }
+  CHECK_EQ(seeds->numSeedVoxels(), numNonZero);
+  CHECK(0 < seeds->numBytes());
+
+  for (const auto& [label, runs] : seeds->runs())
+  {
+    CHECK(0 < label);
+
+    for (std::size_t i = 0; i < runs.size(); ++i)
+    {
+      const SparseSeeds::Run& run = runs[i];
+      CHECK(0 < run.m_length);
+
+      // Runs are maximal: the voxels before and after a run have other labels
+      const std::size_t first = voxelIndex(dims, run.m_x, run.m_y, run.m_z);
+      CHECK(0 == run.m_x || labels[first - 1] != label);
+      CHECK(dims.x == run.m_x + run.m_length || labels[first + run.m_length] != label);
+
+      // Runs are sorted by (z, y, x) and do not overlap
+      if (0 < i)
+      {
+        const SparseSeeds::Run& prev = runs[i - 1];
+        CHECK(
+          std::tie(prev.m_z, prev.m_y, prev.m_x) < std::tie(run.m_z, run.m_y, run.m_x)
+          && (prev.m_z != run.m_z || prev.m_y != run.m_y || prev.m_x + prev.m_length < run.m_x)
+        );
+      }
+    }
+  }
+}
+
+ENTROPY_TEST(sparseSeedsBoundRegionsOfInterest)
+{
+  const glm::ivec3 dims{50, 40, 30};
+
+  SparseSeeds empty(dims);
+  CHECK(!empty.boundingBox());
+  CHECK(empty.regionOfInterest(5).m_offset == glm::ivec3{0});
+  CHECK(empty.regionOfInterest(5).m_size == dims);
+
+  SparseSeeds seeds(dims);
+  seeds.addRun(1, {10, 5, 3, 4});
+  seeds.addRun(1, {2, 20, 3, 1});
+  seeds.addRun(2, {30, 8, 25, 15});
+  seeds.addRun(3, {0, 0, 0, 0}); // Empty runs are not added
+
+  const std::optional<SparseSeeds::Box> bbox = seeds.boundingBox();
+  REQUIRE(bbox);
+  CHECK(bbox->m_offset == glm::ivec3(2, 5, 3));
+  CHECK(bbox->m_size == glm::ivec3(43, 16, 23));
+  CHECK_EQ(seeds.numSeedVoxels(), std::size_t{20});
+
+  // Padding is clamped to the image
+  const SparseSeeds::Box roi = seeds.regionOfInterest(4);
+  CHECK(roi.m_offset == glm::ivec3(0, 1, 0));
+  CHECK(roi.m_size == glm::ivec3(49, 24, 30));
+
+  CHECK(seeds.regionOfInterest(-3).m_size == bbox->m_size);
+
+  // Label 3 has no runs, so it has no index
+  const LabelIndexMaps withBackground = seeds.labelIndexMaps(true);
+  CHECK_EQ(withBackground.labelToIndex.size(), std::size_t{3});
+  CHECK_EQ(withBackground.labelToIndex.at(0), std::size_t{0});
+  CHECK_EQ(withBackground.labelToIndex.at(2), std::size_t{2});
+  CHECK_EQ(withBackground.indexToLabel.at(1), LabelType{1});
+
+  const LabelIndexMaps withoutBackground = seeds.labelIndexMaps(false);
+  CHECK_EQ(withoutBackground.labelToIndex.size(), std::size_t{2});
+  CHECK_EQ(withoutBackground.labelToIndex.at(1), std::size_t{0});
+  CHECK_EQ(withoutBackground.indexToLabel.at(1), LabelType{2});
+}
+
+ENTROPY_TEST(sparseSeedsCropToBoxes)
+{
+  const glm::ivec3 dims{40, 30, 20};
+  const std::vector<uint16_t> labels = makeSeedLabels(dims, 5);
+
+  const std::optional<SparseSeeds> seeds
+    = SparseSeeds::fromSegmentation(testing::makeTestSeg(dims, labels));
+  REQUIRE(seeds);
+
+  // Runs that cross the sides of the box along x are clipped
+  const SparseSeeds::Box box{glm::ivec3(7, 4, 2), glm::ivec3(21, 17, 11)};
+  const SparseSeeds cropped = seeds->crop(box);
+  REQUIRE(cropped.dims() == box.m_size);
+
+  const std::vector<uint16_t> croppedLabels = rasterize(cropped);
+  std::size_t numWrong = 0;
+
+  for (int z = 0; z < box.m_size.z; ++z)
+  {
+    for (int y = 0; y < box.m_size.y; ++y)
+    {
+      for (int x = 0; x < box.m_size.x; ++x)
+      {
+        const uint16_t expected = labels[voxelIndex(
+          dims, box.m_offset.x + x, box.m_offset.y + y, box.m_offset.z + z
+        )];
+        numWrong += (croppedLabels[voxelIndex(box.m_size, x, y, z)] != expected) ? 1 : 0;
+      }
+    }
+  }
+
+  CHECK_EQ(numWrong, std::size_t{0});
+}
+
+ENTROPY_TEST(sparseSeedsCopyAndPasteBoxes)
+{
+  const glm::ivec3 dims{23, 17, 13};
+
+  std::vector<float> values(static_cast<std::size_t>(dims.x) * dims.y * dims.z);
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    values[i] = 0.5f * static_cast<float>(i);
+  }
+
+  const Image image = testing::makeTestImage(
+    dims, ComponentType::Float32, values.data(), Image::ImageRepresentation::Image
+  );
+
+  const SparseSeeds::Box box{glm::ivec3(3, 2, 1), glm::ivec3(10, 11, 12)};
+
+  CHECK(!copyComponentBox(image, 1, box));
+
+  const std::optional<std::vector<float> > boxValues = copyComponentBox(image, 0, box);
+  REQUIRE(boxValues);
+  REQUIRE(boxValues->size() == box.numVoxels());
+
+  // Pasting the box back, negated, writes exactly the voxels of the box
+  std::vector<float> pasted = values;
+  pasteBox(boxValues->data(), box, dims, pasted.data(), [](float v) { return -v; });
+
+  std::size_t numWrong = 0;
+
+  for (int z = 0; z < dims.z; ++z)
+  {
+    for (int y = 0; y < dims.y; ++y)
+    {
+      for (int x = 0; x < dims.x; ++x)
+      {
+        const glm::ivec3 p{x, y, z};
+        const bool inBox = glm::all(glm::greaterThanEqual(p, box.m_offset))
+                           && glm::all(glm::lessThan(p, box.m_offset + box.m_size));
+
+        const std::size_t i = voxelIndex(dims, x, y, z);
+        numWrong += (pasted[i] != (inBox ? -values[i] : values[i])) ? 1 : 0;
+      }
+    }
+  }
+
+  CHECK_EQ(numWrong, std::size_t{0});
+}
@@ -0,0 +1,206 @@
+#include "Testing.h"
+#include "TestImages.h"
+
+#include "mesh/SurfaceNets.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+const glm::ivec3 sk_dims{12, 10, 9};
+
+std::size_t voxelIndex(int x, int y, int z)
+{
+  return (static_cast<std::size_t>(z) * sk_dims.y + y) * sk_dims.x + x;
+}
+
+void fillBox(
+  std::vector<uint16_t>& labels, const glm::ivec3& lo, const glm::ivec3& hi, uint16_t value
+)
+{
+  for (int z = lo.z; z < hi.z; ++z)
+  {
+    for (int y = lo.y; y < hi.y; ++y)
+    {
+      for (int x = lo.x; x < hi.x; ++x)
+      {
+        labels[voxelIndex(x, y, z)] = value;
+      }
+    }
+  }
+}
+
+/// Boxes of labels 1 and 2 that share a face, a slab of label 3 that shares a face with label 2 and
+/// touches five sides of the image, and a voxel of label 4 that is not meshed
+std::vector<uint16_t> makeLabels()
+{
+  std::vector<uint16_t> labels(static_cast<std::size_t>(sk_dims.x) * sk_dims.y * sk_dims.z, 0);
+
+  fillBox(labels, {1, 2, 2}, {5, 7, 6}, 1);
+  fillBox(labels, {5, 2, 2}, {9, 7, 6}, 2);
+  fillBox(labels, {9, 0, 0}, {12, 10, 9}, 3);
+  fillBox(labels, {1, 8, 7}, {2, 9, 8}, 4);
+
+  return labels;
+}
+
+/// Triangle as the positions of its vertices, rotated to start at the smallest one, so that
+/// triangles with the same vertices and orientation compare equal
+using Triangle = std::array<std::array<float, 3>, 3>;
+
+Triangle triangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+  Triangle t{{{p0.x, p0.y, p0.z}, {p1.x, p1.y, p1.z}, {p2.x, p2.y, p2.z}}};
+  std::rotate(std::begin(t), std::min_element(std::begin(t), std::end(t)), std::end(t));
+  return t;
+}
+
+/// Check that a mesh is a closed, consistently oriented surface of genus zero
+void checkClosed(const IsosurfaceMesh& mesh)
+{
+  REQUIRE(0 == mesh.m_indices.size() % 3);
+  CHECK_EQ(mesh.m_normals.size(), mesh.m_positions.size());
+
+  // Each directed edge is in one triangle, and the opposite edge is in another one
+  std::set<std::pair<uint32_t, uint32_t> > edges;
+  std::size_t numRepeated = 0;
+
+  for (std::size_t t = 0; t < mesh.m_indices.size(); t += 3)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      const uint32_t a = mesh.m_indices[t + c];
+      const uint32_t b = mesh.m_indices[t + (c + 1) % 3];
+
+      CHECK(a != b);
+      numRepeated += edges.emplace(a, b).second ? 0 : 1;
+    }
+  }
+
+  std::size_t numUnmatched = 0;
+
+  for (const auto& [a, b] : edges)
+  {
+    numUnmatched += edges.count({b, a}) ? 0 : 1;
+  }
+
+  CHECK_EQ(numRepeated, std::size_t{0});
+  CHECK_EQ(numUnmatched, std::size_t{0});
+
+  // Euler characteristic of a sphere
+  const auto numVertices = static_cast<long>(mesh.m_positions.size());
+  const auto numEdges = static_cast<long>(edges.size() / 2);
+  const auto numFaces = static_cast<long>(mesh.m_indices.size() / 3);
+  CHECK_EQ(numVertices - numEdges + numFaces, 2L);
+}
+
+/// Signed volume enclosed by a mesh, which is positive if its triangles face out
+float enclosedVolume(const IsosurfaceMesh& mesh)
+{
+  float volume = 0.0f;
+
+  for (std::size_t t = 0; t < mesh.m_indices.size(); t += 3)
+  {
+    const glm::vec3& p0 = mesh.m_positions[mesh.m_indices[t]];
+    const glm::vec3& p1 = mesh.m_positions[mesh.m_indices[t + 1]];
+    const glm::vec3& p2 = mesh.m_positions[mesh.m_indices[t + 2]];
+    volume += glm::dot(p0, glm::cross(p1, p2)) / 6.0f;
+  }
+
+  return volume;
+}
+
+/// Number of triangles of mesh a whose reverse is a triangle of mesh b
+std::size_t numSharedTriangles(const IsosurfaceMesh& a, const IsosurfaceMesh& b)
+{
+  std::set<Triangle> reversed;
+
+  for (std::size_t t = 0; t < b.m_indices.size(); t += 3)
+  {
+    reversed.insert(triangle(
+      b.m_positions[b.m_indices[t]],
+      b.m_positions[b.m_indices[t + 2]],
+      b.m_positions[b.m_indices[t + 1]]
+    ));
+  }
+
+  std::size_t numShared = 0;
+
+  for (std::size_t t = 0; t < a.m_indices.size(); t += 3)
+  {
+    const Triangle tri = triangle(
+      a.m_positions[a.m_indices[t]],
+      a.m_positions[a.m_indices[t + 1]],
+      a.m_positions[a.m_indices[t + 2]]
+    );
+
+    numShared += reversed.count(tri);
+  }
+
+  return numShared;
+}
+
+} // namespace
+
+ENTROPY_TEST(surfaceNetsMeshesAreClosedAndShareBoundaries)
+{
+  const Image seg = testing::makeTestSeg(sk_dims, makeLabels());
+
+  // Voxels of labels 1, 2, and 3
+  const std::map<LabelType, float> numVoxels{{1, 80.0f}, {2, 80.0f}, {3, 270.0f}};
+
+  for (int smoothingIterations : {0, 3})
+  {
+    const auto meshes = extractLabelSurfaces(seg, {1, 2, 3, 7}, smoothingIterations);
+    REQUIRE(meshes);
+
+    // Labels that are not in the segmentation or not requested have no mesh
+    REQUIRE(3 == meshes->size());
+
+    for (const auto& [label, mesh] : *meshes)
+    {
+      checkClosed(mesh);
+
+      // The surface is within half a voxel of the voxel faces, and corners are cut
+      const float volume = enclosedVolume(mesh);
+      CHECK(0.5f * numVoxels.at(label) < volume);
+      CHECK(volume < numVoxels.at(label));
+    }
+
+    // The faces between labels 1 and 2 and between labels 2 and 3 are 5 x 4 voxels. Each voxel
+    // face is a quad of two triangles, which both meshes have with opposite orientations.
+    const IsosurfaceMesh& mesh1 = meshes->at(1);
+    const IsosurfaceMesh& mesh2 = meshes->at(2);
+    const IsosurfaceMesh& mesh3 = meshes->at(3);
+
+    CHECK_EQ(numSharedTriangles(mesh1, mesh2), std::size_t{40});
+    CHECK_EQ(numSharedTriangles(mesh2, mesh1), std::size_t{40});
+    CHECK_EQ(numSharedTriangles(mesh2, mesh3), std::size_t{40});
+    CHECK_EQ(numSharedTriangles(mesh1, mesh3), std::size_t{0});
+  }
+}
+
+ENTROPY_TEST(surfaceNetsMeshesSingleVoxels)
+{
+  // A lone voxel is a box of six quads, with one vertex in each of the cells at its corners
+  const Image seg = testing::makeTestSeg(sk_dims, makeLabels());
+  const auto meshes = extractLabelSurfaces(seg, {4}, 0);
+
+  REQUIRE(meshes);
+  REQUIRE(1 == meshes->size());
+
+  const IsosurfaceMesh& mesh = meshes->at(4);
+  checkClosed(mesh);
+  CHECK_EQ(mesh.m_positions.size(), std::size_t{8});
+  CHECK_EQ(mesh.m_indices.size(), std::size_t{3 * 12});
+}
@@ -0,0 +1,336 @@
+#include "Testing.h"
+
+#include "common/ParallelFor.h"
+#include "common/TaskScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+/// Time after which a task that has not finished is taken to be deadlocked
+constexpr std::chrono::seconds sk_timeout{20};
+
+template<class T>
+bool finishes(const std::future<T>& future)
+{
+  return std::future_status::ready == future.wait_for(sk_timeout);
+}
+
+/// Does a future hold the broken promise error of a task that was dropped before it ran?
+template<class T>
+bool isBrokenPromise(std::future<T>& future)
+{
+  try
+  {
+    future.get();
+  }
+  catch (const std::future_error& e)
+  {
+    return std::future_errc::broken_promise == e.code();
+  }
+
+  return false;
+}
+
+/// Task that occupies a worker until it is released
+class BlockingTask
+{
+public:
+  BlockingTask()
+    : m_release(m_releasePromise.get_future().share())
+  {
+  }
+
+  /// Submit the task and wait for it to start running
+  std::future<void> start(TaskScheduler& scheduler, TaskPriority priority)
+  {
+    // Shared with the task, which may still be in set_value() when this function returns
+    auto started = std::make_shared<std::promise<void> >();
+    std::future<void> isStarted = started->get_future();
+
+    std::future<void> done = scheduler.submit(
+      priority,
+      [release = m_release, started](const TaskToken&)
+      {
+        started->set_value();
+        release.wait();
+      }
+    );
+
+    isStarted.wait();
+    return done;
+  }
+
+  void release()
+  {
+    m_releasePromise.set_value();
+  }
+
+private:
+  std::promise<void> m_releasePromise;
+  std::shared_future<void> m_release;
+};
+
+/// Task that runs until it is cancelled
+void runUntilCancelled(const TaskToken& token, std::atomic<bool>& started)
+{
+  started = true;
+
+  while (!token.isCancelled())
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+/// Sum of f(i) over [0, N), computed by nested data-parallel loops
+std::size_t nestedParallelSum(std::size_t N, std::size_t minChunkSize)
+{
+  std::vector<std::size_t> chunkSums(parallel::numThreads(), 0);
+
+  parallel::forEachChunk(
+    N,
+    minChunkSize,
+    [&chunkSums, minChunkSize](std::size_t c, std::size_t begin, std::size_t end)
+    {
+      std::vector<std::size_t> innerSums(parallel::numThreads(), 0);
+
+      parallel::forEachChunk(
+        end - begin,
+        minChunkSize / 4,
+        [&innerSums, begin](std::size_t ic, std::size_t ib, std::size_t ie)
+        {
+          for (std::size_t i = begin + ib; i < begin + ie; ++i)
+          {
+            innerSums[ic] += i % 7;
+          }
+        }
+      );
+
+      chunkSums[c] = std::accumulate(std::begin(innerSums), std::end(innerSums), std::size_t{0});
+    }
+  );
+
+  return std::accumulate(std::begin(chunkSums), std::end(chunkSums), std::size_t{0});
+}
+
+std::size_t serialSum(std::size_t N)
+{
+  std::size_t sum = 0;
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    sum += i % 7;
+  }
+
+  return sum;
+}
+
+} // namespace
+
+ENTROPY_TEST(taskSchedulerRunsInteractiveTasksBeforeBackgroundTasks)
+{
+  TaskScheduler scheduler(1);
+
+  // Queue tasks of both priorities behind a task that occupies the only worker
+  BlockingTask blocker;
+  std::future<void> blocked = blocker.start(scheduler, TaskPriority::Interactive);
+
+  std::mutex mutex;
+  std::string order;
+
+  auto record = [&mutex, &order](char name)
+  {
+    return [&mutex, &order, name](const TaskToken&)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(name);
+    };
+  };
+
+  std::vector<std::future<void> > futures;
+  futures.emplace_back(scheduler.submit(TaskPriority::Background, record('a')));
+  futures.emplace_back(scheduler.submit(TaskPriority::Interactive, record('A')));
+  futures.emplace_back(scheduler.submit(TaskPriority::Background, record('b')));
+  futures.emplace_back(scheduler.submit(TaskPriority::Interactive, record('B')));
+
+  CHECK_EQ(scheduler.numPendingTasks(), std::size_t{5});
+
+  blocker.release();
+  REQUIRE(finishes(blocked));
+
+  for (auto& future : futures)
+  {
+    REQUIRE(finishes(future));
+  }
+
+  // Tasks of the same priority run in the order in which they were submitted
+  CHECK_EQ(order, std::string("ABab"));
+}
+
+ENTROPY_TEST(taskSchedulerKeepsAWorkerForInteractiveTasks)
+{
+  TaskScheduler scheduler(2);
+
+  // One of the two workers runs background tasks, so a second background task stays queued
+  BlockingTask backgroundBlocker;
+  std::future<void> blocked = backgroundBlocker.start(scheduler, TaskPriority::Background);
+
+  std::atomic<bool> queuedBackgroundRan{false};
+  std::future<void> queuedBackground = scheduler.submit(
+    TaskPriority::Background,
+    [&queuedBackgroundRan](const TaskToken&) { queuedBackgroundRan = true; }
+  );
+
+  std::future<int> interactive
+    = scheduler.submit(TaskPriority::Interactive, [](const TaskToken&) { return 42; });
+
+  REQUIRE(finishes(interactive));
+  CHECK_EQ(interactive.get(), 42);
+  CHECK(!queuedBackgroundRan);
+
+  backgroundBlocker.release();
+  REQUIRE(finishes(blocked));
+  REQUIRE(finishes(queuedBackground));
+  CHECK(queuedBackgroundRan);
+}
+
+ENTROPY_TEST(taskSchedulerCancelsQueuedAndRunningTasks)
+{
+  TaskScheduler scheduler(1);
+
+  // A task that is cancelled while it runs returns early
+  TaskToken runningToken;
+  std::atomic<bool> runningStarted{false};
+
+  std::future<bool> running = scheduler.submit(
+    TaskPriority::Interactive,
+    [&runningStarted](const TaskToken& token)
+    {
+      runUntilCancelled(token, runningStarted);
+      return token.isCancelled();
+    },
+    runningToken
+  );
+
+  // A task that is cancelled while it is queued is not run
+  TaskToken queuedToken;
+  std::atomic<bool> queuedRan{false};
+
+  std::future<void> queued = scheduler.submit(
+    TaskPriority::Interactive,
+    [&queuedRan](const TaskToken&) { queuedRan = true; },
+    queuedToken
+  );
+
+  while (!runningStarted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  queuedToken.cancel();
+  runningToken.cancel();
+
+  REQUIRE(finishes(running));
+  CHECK(running.get());
+
+  REQUIRE(finishes(queued));
+  CHECK(isBrokenPromise(queued));
+  CHECK(!queuedRan);
+
+  // Other tasks still run after cancellations
+  std::future<int> next
+    = scheduler.submit(TaskPriority::Interactive, [](const TaskToken&) { return 7; });
+  REQUIRE(finishes(next));
+  CHECK_EQ(next.get(), 7);
+}
+
+ENTROPY_TEST(taskSchedulerRunsNestedParallelLoopsWithoutDeadlock)
+{
+  const std::size_t N = 200000;
+  const std::size_t expected = serialSum(N);
+
+  // Loops in tasks split into subtasks of the tasks' workers. More tasks than workers run loops at
+  // once, including background tasks whose subtasks cannot take the worker kept for interactive
+  // tasks, and with a single worker that must run all of its subtasks itself.
+  for (std::size_t numWorkers : {1, 2, 4})
+  {
+    TaskScheduler scheduler(numWorkers);
+    std::vector<std::future<std::size_t> > sums;
+
+    for (std::size_t t = 0; t < 3 * numWorkers; ++t)
+    {
+      const TaskPriority priority = (0 == t % 2) ? TaskPriority::Interactive
+                                                 : TaskPriority::Background;
+
+      sums.emplace_back(
+        scheduler.submit(priority, [N](const TaskToken&) { return nestedParallelSum(N, 1000); })
+      );
+    }
+
+    for (auto& sum : sums)
+    {
+      REQUIRE(finishes(sum));
+      CHECK_EQ(sum.get(), expected);
+    }
+  }
+}
+
+ENTROPY_TEST(taskSchedulerShutsDownWithQueuedTasks)
+{
+  TaskScheduler scheduler(1);
+
+  std::atomic<bool> runningStarted{false};
+  std::future<void> running = scheduler.submit(
+    TaskPriority::Interactive,
+    [&runningStarted](const TaskToken& token) { runUntilCancelled(token, runningStarted); }
+  );
+
+  std::atomic<std::size_t> numQueuedRan{0};
+  std::vector<std::future<void> > queued;
+
+  for (int i = 0; i < 4; ++i)
+  {
+    const TaskPriority priority = (0 == i % 2) ? TaskPriority::Interactive
+                                               : TaskPriority::Background;
+
+    queued.emplace_back(
+      scheduler.submit(priority, [&numQueuedRan](const TaskToken&) { ++numQueuedRan; })
+    );
+  }
+
+  while (!runningStarted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // Shutdown cancels the running task, drops the queued tasks, and joins the worker
+  scheduler.shutdown();
+
+  CHECK(finishes(running));
+
+  for (auto& future : queued)
+  {
+    CHECK(isBrokenPromise(future));
+  }
+
+  CHECK_EQ(numQueuedRan.load(), std::size_t{0});
+  CHECK_EQ(scheduler.numPendingTasks(), std::size_t{0});
+
+  // Tasks submitted after shutdown are dropped
+  std::future<int> late
+    = scheduler.submit(TaskPriority::Interactive, [](const TaskToken&) { return 1; });
+  CHECK(isBrokenPromise(late));
+
+  // Shutting down again does nothing
+  scheduler.shutdown();
+}
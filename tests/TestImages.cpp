@@ -0,0 +1,80 @@
+#include "TestImages.h"
+
+#include "image/ImageHeader.h"
+#include "image/ImageIoInfo.h"
+#include "image/ImageUtility.h"
+
+namespace
+{
+
+uint32_t componentSizeInBytes(const ComponentType& compType)
+{
+  switch (compType)
+  {
+  case ComponentType::Int8:
+  case ComponentType::UInt8:
+    return 1;
+  case ComponentType::Int16:
+  case ComponentType::UInt16:
+    return 2;
+  case ComponentType::Int32:
+  case ComponentType::UInt32:
+  case ComponentType::Float32:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+} // namespace
+
+namespace testing
+{
+
+Image makeTestImage(
+  const glm::ivec3& dims,
+  const ComponentType& compType,
+  const void* values,
+  const Image::ImageRepresentation& imageRep
+)
+{
+  const std::size_t numPixels = static_cast<std::size_t>(dims.x) * dims.y * dims.z;
+  const uint32_t compSize = componentSizeInBytes(compType);
+
+  ImageIoInfo ioInfo;
+  ioInfo.m_fileInfo.m_fileName = "<test>";
+
+  ioInfo.m_componentInfo.m_componentType = toItkComponentType(compType);
+  ioInfo.m_componentInfo.m_componentTypeString = componentTypeString(compType);
+  ioInfo.m_componentInfo.m_componentSizeInBytes = compSize;
+
+  ioInfo.m_pixelInfo.m_pixelType = itk::IOPixelEnum::SCALAR;
+  ioInfo.m_pixelInfo.m_pixelTypeString = "scalar";
+  ioInfo.m_pixelInfo.m_numComponents = 1;
+  ioInfo.m_pixelInfo.m_pixelStrideInBytes = compSize;
+
+  ioInfo.m_sizeInfo.m_imageSizeInComponents = numPixels;
+  ioInfo.m_sizeInfo.m_imageSizeInPixels = numPixels;
+  ioInfo.m_sizeInfo.m_imageSizeInBytes = numPixels * compSize;
+
+  ioInfo.m_spaceInfo.m_numDimensions = 3;
+  ioInfo.m_spaceInfo.m_dimensions = {
+    static_cast<std::size_t>(dims.x), static_cast<std::size_t>(dims.y),
+    static_cast<std::size_t>(dims.z)
+  };
+  ioInfo.m_spaceInfo.m_origin = {0.0, 0.0, 0.0};
+  ioInfo.m_spaceInfo.m_spacing = {1.0, 1.0, 1.0};
+  ioInfo.m_spaceInfo.m_directions = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+
+  const ImageHeader header(ioInfo, ioInfo, false);
+
+  return Image(
+    header,
+    "test",
+    imageRep,
+    Image::MultiComponentBufferType::SeparateImages,
+    std::vector<const void*>{values}
+  );
+}
+
+} // namespace testing
@@ -0,0 +1,66 @@
+#ifndef ENTROPY_TEST_IMAGES_H
+#define ENTROPY_TEST_IMAGES_H
+
+#include "common/Types.h"
+#include "image/Image.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace testing
+{
+
+/// Component type of the values of a buffer
+template<typename T>
+constexpr ComponentType componentTypeOf()
+{
+  if constexpr (std::is_same_v<T, uint8_t>)
+    return ComponentType::UInt8;
+  else if constexpr (std::is_same_v<T, uint16_t>)
+    return ComponentType::UInt16;
+  else if constexpr (std::is_same_v<T, uint32_t>)
+    return ComponentType::UInt32;
+  else if constexpr (std::is_same_v<T, float>)
+    return ComponentType::Float32;
+  else
+    static_assert(std::is_same_v<T, float>, "Unsupported test image component type");
+}
+
+/**
+ * @brief Create a scalar image with unit spacing, zero origin, and identity directions
+ *
+ * @param[in] dims Image dimensions, in voxels
+ * @param[in] compType Component type
+ * @param[in] values Voxel values, in x-fastest order, which are copied
+ * @param[in] imageRep Indicates whether this is an image or a segmentation
+ */
+Image makeTestImage(
+  const glm::ivec3& dims,
+  const ComponentType& compType,
+  const void* values,
+  const Image::ImageRepresentation& imageRep
+);
+
+/// Create a segmentation from voxel values, in x-fastest order
+template<typename T>
+Image makeTestSeg(const glm::ivec3& dims, const std::vector<T>& values)
+{
+  return makeTestImage(
+    dims, componentTypeOf<T>(), values.data(), Image::ImageRepresentation::Segmentation
+  );
+}
+
+/// Copy the voxel values of the first component of an image
+template<typename T>
+std::vector<T> imageValues(const Image& image)
+{
+  const T* buffer = static_cast<const T*>(image.bufferAsVoid(0));
+  return std::vector<T>(buffer, buffer + image.header().numPixels());
+}
+
+} // namespace testing
+
+#endif // ENTROPY_TEST_IMAGES_H
@@ -0,0 +1,98 @@
+#include "Testing.h"
+
+#include "common/TaskScheduler.h"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <string>
+
+namespace
+{
+std::size_t s_numFailedChecks = 0;
+} // namespace
+
+namespace testing
+{
+
+std::vector<TestCase>& registeredTests()
+{
+  static std::vector<TestCase> s_tests;
+  return s_tests;
+}
+
+TestRegistrar::TestRegistrar(const char* name, std::function<void()> run)
+{
+  registeredTests().push_back(TestCase{name, std::move(run)});
+}
+
+void reportFailure(const char* file, int line, const std::string& message)
+{
+  ++s_numFailedChecks;
+  std::printf("  %s:%d: check failed: %s\n", file, line, message.c_str());
+}
+
+} // namespace testing
+
+/**
+ * Runs the registered tests whose names contain the first argument (or all tests if there is no
+ * argument). Returns 0 iff all of them pass.
+ */
+int main(int argc, char* argv[])
+{
+  spdlog::set_level(spdlog::level::warn);
+
+  const std::string filter = (1 < argc) ? argv[1] : "";
+
+  // Data-parallel loops run on this scheduler, as they do in the application
+  TaskScheduler scheduler;
+
+  std::size_t numRun = 0;
+  std::size_t numFailed = 0;
+
+  for (const auto& test : testing::registeredTests())
+  {
+    if (std::string::npos == test.m_name.find(filter))
+    {
+      continue;
+    }
+
+    std::printf("[ RUN  ] %s\n", test.m_name.c_str());
+    std::fflush(stdout);
+
+    const std::size_t numFailedChecksBefore = s_numFailedChecks;
+    const auto start = std::chrono::steady_clock::now();
+
+    try
+    {
+      test.m_run();
+    }
+    catch (const testing::RequireFailure&)
+    {
+    }
+    catch (const std::exception& e)
+    {
+      testing::reportFailure(__FILE__, __LINE__, std::string("exception: ") + e.what());
+    }
+
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start
+    );
+
+    const bool passed = (numFailedChecksBefore == s_numFailedChecks);
+    std::printf(
+      "[ %s ] %s (%lld ms)\n",
+      passed ? " OK " : "FAIL",
+      test.m_name.c_str(),
+      static_cast<long long>(ms.count())
+    );
+
+    ++numRun;
+    numFailed += passed ? 0 : 1;
+  }
+
+  std::printf("%zu of %zu tests passed\n", numRun - numFailed, numRun);
+  return (0 == numFailed && 0 < numRun) ? 0 : 1;
+}
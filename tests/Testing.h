@@ -0,0 +1,107 @@
+#ifndef ENTROPY_TESTING_H
+#define ENTROPY_TESTING_H
+
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Minimal test harness for the modules of Entropy that do not need OpenGL.
+ *
+ * Tests are defined at namespace scope with \c ENTROPY_TEST and register themselves before
+ * \c main runs. Each \c CHECK that fails is reported and fails its test, which keeps running;
+ * a \c REQUIRE that fails also ends its test.
+ */
+namespace testing
+{
+
+/// Registered test
+struct TestCase
+{
+  std::string m_name;
+  std::function<void()> m_run;
+};
+
+/// All registered tests, in registration order
+std::vector<TestCase>& registeredTests();
+
+/// Registers a test when constructed
+struct TestRegistrar
+{
+  TestRegistrar(const char* name, std::function<void()> run);
+};
+
+/// Report a failed check of the running test
+void reportFailure(const char* file, int line, const std::string& message);
+
+/// Thrown by a failed \c REQUIRE to end the running test
+struct RequireFailure
+{
+};
+
+/// Describe two values that were compared
+template<typename A, typename B>
+std::string describe(const char* expression, const A& a, const B& b)
+{
+  std::ostringstream ss;
+  ss << expression << " (" << a << " vs. " << b << ")";
+  return ss.str();
+}
+
+} // namespace testing
+
+#define ENTROPY_TEST_CONCAT_IMPL(a, b) a##b
+#define ENTROPY_TEST_CONCAT(a, b) ENTROPY_TEST_CONCAT_IMPL(a, b)
+
+/// Define and register a test
+#define ENTROPY_TEST(name)                                                                         \
+  static void name();                                                                              \
+  static const testing::TestRegistrar ENTROPY_TEST_CONCAT(name, _registrar)(#name, &name);         \
+  static void name()
+
+#define CHECK(condition)                                                                           \
+  do                                                                                               \
+  {                                                                                                \
+    if (!(condition))                                                                              \
+    {                                                                                              \
+      testing::reportFailure(__FILE__, __LINE__, #condition);                                      \
+    }                                                                                              \
+  } while (false)
+
+#define CHECK_EQ(a, b)                                                                             \
+  do                                                                                               \
+  {                                                                                                \
+    const auto& checkA = (a);                                                                      \
+    const auto& checkB = (b);                                                                      \
+    if (!(checkA == checkB))                                                                       \
+    {                                                                                              \
+      testing::reportFailure(__FILE__, __LINE__, testing::describe(#a " == " #b, checkA, checkB)); \
+    }                                                                                              \
+  } while (false)
+
+#define CHECK_NEAR(a, b, tolerance)                                                                \
+  do                                                                                               \
+  {                                                                                                \
+    const double checkA = static_cast<double>(a);                                                  \
+    const double checkB = static_cast<double>(b);                                                  \
+    if (!(std::abs(checkA - checkB) <= (tolerance)))                                               \
+    {                                                                                              \
+      testing::reportFailure(                                                                      \
+        __FILE__, __LINE__, testing::describe(#a " ~= " #b, checkA, checkB)                        \
+      );                                                                                           \
+    }                                                                                              \
+  } while (false)
+
+#define REQUIRE(condition)                                                                         \
+  do                                                                                               \
+  {                                                                                                \
+    if (!(condition))                                                                              \
+    {                                                                                              \
+      testing::reportFailure(__FILE__, __LINE__, #condition);                                      \
+      throw testing::RequireFailure();                                                             \
+    }                                                                                              \
+  } while (false)
+
+#endif // ENTROPY_TESTING_H